@@ -0,0 +1,163 @@
+#include "common.hlsli"
+#include "gpu_scene.hlsli"
+#include "clustered_light_culling.hlsli"
+
+cbuffer CB : register(b1)
+{
+    uint c_lightCount;
+    uint c_viewLightsBuffer; //float4 per light : view space bounding sphere, w < 0 if outside the frustum
+    uint c_lightGridsBuffer;
+    uint c_lightIndicesBuffer;
+
+    uint c_lightIndexCounterBuffer;
+    uint c_maxLightIndexCount;
+    uint c_tileSize;
+    uint c_sliceCount;
+
+    float c_maxSliceDepth;
+    uint c_hzbMip;
+    uint2 c_hzbMipSize;
+};
+
+float4 GetLightBoundingSphere(LocalLightData light)
+{
+    switch (light.GetLocalLightType())
+    {
+        case LocalLightType::Spot:
+            return ConeBoundingSphere(light.position, -light.direction, light.radius, light.spotAngles.z);
+        default:
+            return float4(light.position, light.radius);
+    }
+}
+
+[numthreads(CLUSTERED_LIGHT_CULLING_GROUP_SIZE, 1, 1)]
+void transform_lights(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint lightIndex = dispatchThreadID.x;
+    if (lightIndex >= c_lightCount)
+    {
+        return;
+    }
+
+    float4 sphere = GetLightBoundingSphere(GetLocalLightData(lightIndex));
+
+    bool visible = true;
+    for (uint i = 0; i < 6; ++i)
+    {
+        float4 plane = GetCameraCB().culling.planes[i];
+        if (dot(sphere.xyz, plane.xyz) + plane.w + sphere.w < 0)
+        {
+            visible = false;
+        }
+    }
+
+    RWStructuredBuffer<float4> viewLightsBuffer = ResourceDescriptorHeap[c_viewLightsBuffer];
+    viewLightsBuffer[lightIndex] = visible ? float4(mul(GetCameraCB().mtxView, float4(sphere.xyz, 1.0)).xyz, sphere.w) : float4(0.0, 0.0, 0.0, -1.0);
+}
+
+groupshared uint s_waveLightCounts[CLUSTERED_LIGHT_CULLING_GROUP_SIZE / 4]; //waves have at least 4 lanes
+groupshared uint s_lightOffset;
+groupshared uint s_lightCount;
+
+//tests 64 lights at a time, the visible ones are compacted with the wave prefix counts in light order,
+//so that the list of a cluster does not depend on the wave size or the scheduling. returns the number of visible lights
+uint CullLights(uint threadIndex, ClusterAABB aabb, bool write)
+{
+    StructuredBuffer<float4> viewLightsBuffer = ResourceDescriptorHeap[c_viewLightsBuffer];
+    RWStructuredBuffer<uint> lightIndicesBuffer = ResourceDescriptorHeap[c_lightIndicesBuffer];
+
+    uint waveIndex = threadIndex / WaveGetLaneCount();
+    uint waveCount = (CLUSTERED_LIGHT_CULLING_GROUP_SIZE + WaveGetLaneCount() - 1) / WaveGetLaneCount();
+    uint visibleCount = 0;
+
+    for (uint first = 0; first < c_lightCount; first += CLUSTERED_LIGHT_CULLING_GROUP_SIZE)
+    {
+        uint lightIndex = first + threadIndex;
+
+        bool visible = false;
+        if (lightIndex < c_lightCount)
+        {
+            float4 sphere = viewLightsBuffer[lightIndex];
+            visible = sphere.w >= 0.0 && TestSphereAABB(sphere.xyz, sphere.w, aabb.minPoint, aabb.maxPoint);
+        }
+
+        uint waveVisibleCount = WaveActiveCountBits(visible);
+        uint wavePrefix = WavePrefixCountBits(visible);
+
+        if (WaveIsFirstLane())
+        {
+            s_waveLightCounts[waveIndex] = waveVisibleCount;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        if (write && visible)
+        {
+            uint offset = visibleCount + wavePrefix;
+            for (uint wave = 0; wave < waveIndex; ++wave)
+            {
+                offset += s_waveLightCounts[wave];
+            }
+
+            if (offset < s_lightCount)
+            {
+                lightIndicesBuffer[s_lightOffset + offset] = lightIndex;
+            }
+        }
+
+        for (uint wave = 0; wave < waveCount; ++wave)
+        {
+            visibleCount += s_waveLightCounts[wave];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    return visibleCount;
+}
+
+//one group per cluster : counts its lights, allocates its range in the index list, then writes them
+[numthreads(CLUSTERED_LIGHT_CULLING_GROUP_SIZE, 1, 1)]
+void cull_lights(uint3 groupID : SV_GroupID, uint groupIndex : SV_GroupIndex)
+{
+    uint2 tileCount = (SceneCB.renderSize + c_tileSize - 1) / c_tileSize;
+    uint clusterIndex = groupID.x + groupID.y * tileCount.x + groupID.z * tileCount.x * tileCount.y;
+
+    RWStructuredBuffer<uint2> lightGridsBuffer = ResourceDescriptorHeap[c_lightGridsBuffer];
+
+    float zNear = GetCameraCB().nearZ;
+    float2 tileDepthBounds = GetTileDepthBounds(LoadTileHZBDepth(groupID.xy, c_tileSize, c_hzbMip, c_hzbMipSize), zNear);
+    float2 depthRange = GetClusterDepthRange(groupID.z, c_sliceCount, zNear, c_maxSliceDepth, tileDepthBounds);
+
+    if (depthRange.x > depthRange.y)
+    {
+        if (groupIndex == 0)
+        {
+            lightGridsBuffer[clusterIndex] = uint2(0, 0);
+        }
+        return;
+    }
+
+    ClusterAABB aabb = GetClusterAABB(groupID.x, groupID.y, c_tileSize, depthRange.x, depthRange.y, float2(SceneCB.renderSize), GetCameraCB().mtxProjectionInverse);
+
+    uint lightCount = CullLights(groupIndex, aabb, false);
+
+    if (groupIndex == 0)
+    {
+        RWBuffer<uint> counterBuffer = ResourceDescriptorHeap[c_lightIndexCounterBuffer];
+
+        uint offset;
+        InterlockedAdd(counterBuffer[0], lightCount, offset);
+
+        //the lights which do not fit are dropped
+        lightCount = offset < c_maxLightIndexCount ? min(lightCount, c_maxLightIndexCount - offset) : 0;
+
+        s_lightOffset = offset;
+        s_lightCount = lightCount;
+        lightGridsBuffer[clusterIndex] = uint2(offset, lightCount);
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    if (s_lightCount > 0)
+    {
+        CullLights(groupIndex, aabb, true);
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+//cluster bounds and light tests of the clustered light lists,
+//shared by clustered_light_culling.hlsl and its CPU reference in ClusteredLightLists
+
+static const uint CLUSTERED_LIGHT_CULLING_GROUP_SIZE = 64;
+
+struct ClusterAABB
+{
+    float3 minPoint; //view space
+    float3 maxPoint;
+};
+
+inline float GetClusterSliceDepth(uint slice, uint sliceCount, float zNear, float zFar)
+{
+    return zNear * pow(zFar / zNear, (float)slice / (float)sliceCount);
+}
+
+//direction of the view ray through a screen position, at the far plane (ndc z is 0 with the reversed infinite projection)
+inline float3 GetClusterViewRay(float2 screenPos, float2 renderSize, float4x4 mtxProjectionInverse)
+{
+    float2 screenUV = screenPos / renderSize;
+    float2 ndcPos = (screenUV * 2.0f - 1.0f) * float2(1.0f, -1.0f);
+
+    float4 viewPos = mul(mtxProjectionInverse, float4(ndcPos.x, ndcPos.y, 0.0f, 1.0f));
+    return float3(viewPos.x, viewPos.y, viewPos.z);
+}
+
+//bounds of the part of a tile frustum between two view depths
+inline ClusterAABB GetClusterAABB(uint tileX, uint tileY, uint tileSize, float nearDepth, float farDepth, float2 renderSize, float4x4 mtxProjectionInverse)
+{
+    float3 rayMin = GetClusterViewRay(float2((float)tileX, (float)tileY) * (float)tileSize, renderSize, mtxProjectionInverse);
+    float3 rayMax = GetClusterViewRay(float2((float)(tileX + 1), (float)(tileY + 1)) * (float)tileSize, renderSize, mtxProjectionInverse);
+
+    float3 minPointNear = rayMin * (nearDepth / rayMin.z);
+    float3 minPointFar = rayMin * (farDepth / rayMin.z);
+    float3 maxPointNear = rayMax * (nearDepth / rayMax.z);
+    float3 maxPointFar = rayMax * (farDepth / rayMax.z);
+
+    ClusterAABB aabb;
+    aabb.minPoint = min(min(minPointNear, minPointFar), min(maxPointNear, maxPointFar));
+    aabb.maxPoint = max(max(minPointNear, minPointFar), max(maxPointNear, maxPointFar));
+    return aabb;
+}
+
+//view depth bounds of a tile from its min/max HZB depth (x : nearest, y : farthest), empty if it only has sky
+inline float2 GetTileDepthBounds(float2 hzbDepth, float zNear)
+{
+    if (hzbDepth.y == 0.0f)
+    {
+        return float2(1.0f, 0.0f);
+    }
+
+    //reversed z, the far plane is at infinity
+    return float2(zNear / hzbDepth.y, zNear / hzbDepth.x);
+}
+
+//view depth range of a slice, clipped to the depth bounds of the tile (x : nearest, y : farthest).
+//the tile bounds are widened a little since the HZB keeps them in half floats, an empty range means the cluster has no pixels
+inline float2 GetClusterDepthRange(uint slice, uint sliceCount, float zNear, float maxSliceDepth, float2 tileDepthBounds)
+{
+    if (tileDepthBounds.x > tileDepthBounds.y)
+    {
+        return float2(1.0f, 0.0f);
+    }
+
+    float sliceNear = GetClusterSliceDepth(slice, sliceCount, zNear, maxSliceDepth);
+    float sliceFar = GetClusterSliceDepth(slice + 1, sliceCount, zNear, maxSliceDepth);
+
+    //pixels beyond the last slice are shaded with it
+    float tileNear = clamp(tileDepthBounds.x * (1.0f - 1.0f / 512.0f), zNear, maxSliceDepth);
+    float tileFar = clamp(tileDepthBounds.y * (1.0f + 1.0f / 512.0f), zNear, maxSliceDepth);
+
+    return float2(max(sliceNear, tileNear), min(sliceFar, tileFar));
+}
+
+inline bool TestSphereAABB(float3 position, float radius, float3 aabbMin, float3 aabbMax)
+{
+    float3 closestPoint = clamp(position, aabbMin, aabbMax);
+    float distanceSquared = dot(closestPoint - position, closestPoint - position);
+    return distanceSquared <= radius * radius;
+}
+
+#ifndef __cplusplus
+
+//min/max depth of a tile, from the HZB mip where the tile covers at most 2x2 texels
+float2 LoadTileHZBDepth(uint2 tile, uint tileSize, uint hzbMip, uint2 hzbMipSize)
+{
+    Texture2D<float2> hzbTexture = ResourceDescriptorHeap[SceneCB.sceneHZBSRV];
+
+    float2 tileMin = tile * tileSize;
+    float2 tileMax = min((tile + 1) * tileSize, SceneCB.renderSize);
+
+    uint2 texelMin = uint2(tileMin * hzbMipSize / SceneCB.renderSize);
+    uint2 texelMax = min(uint2(ceil(tileMax * hzbMipSize / SceneCB.renderSize)) - 1, hzbMipSize - 1);
+
+    float2 depth00 = hzbTexture.Load(uint3(texelMin.x, texelMin.y, hzbMip));
+    float2 depth10 = hzbTexture.Load(uint3(texelMax.x, texelMin.y, hzbMip));
+    float2 depth01 = hzbTexture.Load(uint3(texelMin.x, texelMax.y, hzbMip));
+    float2 depth11 = hzbTexture.Load(uint3(texelMax.x, texelMax.y, hzbMip));
+
+    return float2(min(min(depth00.x, depth10.x), min(depth01.x, depth11.x)), max(max(depth00.y, depth10.y), max(depth01.y, depth11.y)));
+}
+
+#endif
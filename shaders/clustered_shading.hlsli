@@ -24,10 +24,22 @@ uint GetLightGridIndex(uint2 screenPos, float depth)
 // x : offset, y : count
 uint2 GetLightGridData(uint lightGridIndex)
 {
+    if (SceneCB.lightGridsBufferSRV != INVALID_RESOURCE_INDEX)
+    {
+        StructuredBuffer<uint2> lightGridsBuffer = ResourceDescriptorHeap[SceneCB.lightGridsBufferSRV];
+        return lightGridsBuffer[lightGridIndex];
+    }
+    
     return LoadSceneConstantBuffer<uint2>(SceneCB.lightGridsAddress + lightGridIndex * sizeof(uint2));
 }
 
 uint GetLightIndex(uint lightIndicesOffset)
 {
+    if (SceneCB.lightIndicesBufferSRV != INVALID_RESOURCE_INDEX)
+    {
+        StructuredBuffer<uint> lightIndicesBuffer = ResourceDescriptorHeap[SceneCB.lightIndicesBufferSRV];
+        return lightIndicesBuffer[lightIndicesOffset];
+    }
+    
     return LoadSceneConstantBuffer<uint>(SceneCB.lightIndicesAddress + lightIndicesOffset * sizeof(uint));
 }
\ No newline at end of file
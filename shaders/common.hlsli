@@ -349,12 +349,33 @@ float3 SpecularIBL(float3 N, float3 V, float roughness, float3 specular)
     return SpecularIBL(prefilteredColor, N, V, roughness, specular);
 }
 
+// real L2 SH basis
+void EvaluateSH9(float3 dir, out float basis[9])
+{
+    basis[0] = 0.282095;
+    basis[1] = 0.488603 * dir.y;
+    basis[2] = 0.488603 * dir.z;
+    basis[3] = 0.488603 * dir.x;
+    basis[4] = 1.092548 * dir.x * dir.y;
+    basis[5] = 1.092548 * dir.y * dir.z;
+    basis[6] = 0.315392 * (3.0 * dir.z * dir.z - 1.0);
+    basis[7] = 1.092548 * dir.x * dir.z;
+    basis[8] = 0.546274 * (dir.x * dir.x - dir.y * dir.y);
+}
+
 float3 DiffuseIBL(float3 N)
 {
-    TextureCube envTexture = ResourceDescriptorHeap[SceneCB.skyDiffuseIBLTexture];
-    SamplerState linearSampler = SamplerDescriptorHeap[SceneCB.bilinearClampSampler];
+    StructuredBuffer<float4> shBuffer = ResourceDescriptorHeap[SceneCB.skyDiffuseSHBuffer];
 
-    return envTexture.SampleLevel(linearSampler, N, 0.0).xyz;
+    float basis[9];
+    EvaluateSH9(N, basis);
+
+    float3 irradiance = 0.0;
+    for (uint i = 0; i < 9; ++i)
+    {
+        irradiance += shBuffer[i].xyz * basis[i];
+    }
+    return max(irradiance, 0.0);
 }
 
 // "Texture Level-of-Detail Strategies for Real-Time Ray Tracing"
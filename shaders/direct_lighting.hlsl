@@ -3,6 +3,11 @@
 #include "clustered_shading.hlsli"
 #include "debug.hlsli"
 
+#if LIGHT_TREE_SAMPLING
+#include "light_tree.hlsli"
+#include "random.hlsli"
+#endif
+
 cbuffer CB : register(b0)
 {
     uint c_diffuseRT;
@@ -23,6 +28,46 @@ static Texture2D customDataRT = ResourceDescriptorHeap[c_customDataRT];
 static Texture2D<float> shadowRT = ResourceDescriptorHeap[c_shadowRT];
 static RWTexture2D<float4> outTexture = ResourceDescriptorHeap[c_outputRT];
 
+#if LIGHT_TREE_SAMPLING
+cbuffer LightTreeCB : register(b1)
+{
+    uint c_lightTreeNodesBuffer;
+    uint c_lightTreeCutsBuffer;
+    uint c_lightTreeTileSize;
+    uint c_lightTreeTileCountX;
+
+    uint c_lightTreeSampleCount;
+    uint c_lightTreeHybridLightCount;
+};
+
+//unbiased estimate of all the local lights, from lights sampled with the light tree cut of the pixel's tile
+float3 SampleLocalLights(uint2 pos, float3 worldPos, ShadingModel shadingModel, float3 V, float3 N, float3 diffuse, float3 specular, float roughness, float4 customData)
+{
+    StructuredBuffer<LightTreeCut> cutsBuffer = ResourceDescriptorHeap[c_lightTreeCutsBuffer];
+    uint2 tile = pos / c_lightTreeTileSize;
+    LightTreeCut cut = cutsBuffer[tile.x + tile.y * c_lightTreeTileCountX];
+
+    //the importance bounds the cosine of the shading normal, which the clear coat base and hair do not use
+    bool useNormal = shadingModel == ShadingModel::Default || shadingModel == ShadingModel::Anisotropy || shadingModel == ShadingModel::Sheen;
+    float3 importanceNormal = useNormal ? N : float3(0.0, 0.0, 0.0);
+
+    PRNG rng = PRNG::Create(pos, SceneCB.renderSize);
+    float3 lighting = 0.0;
+
+    for (uint i = 0; i < c_lightTreeSampleCount; ++i)
+    {
+        LightTreeSample lightSample = SampleLightTree(c_lightTreeNodesBuffer, cut, worldPos, importanceNormal, rng.RandomFloat());
+        if (lightSample.lightIndex != LIGHT_TREE_INVALID_INDEX)
+        {
+            LocalLightData light = GetLocalLightData(lightSample.lightIndex);
+            lighting += CalculateLocalLight(light, worldPos, shadingModel, V, N, diffuse, specular, roughness, customData) / lightSample.pdf;
+        }
+    }
+
+    return lighting / c_lightTreeSampleCount;
+}
+#endif
+
 [numthreads(8, 8, 1)]
 void main(uint3 dispatchThreadID : SV_DispatchThreadID)
 {
@@ -57,6 +102,14 @@ void main(uint3 dispatchThreadID : SV_DispatchThreadID)
         //debug::PrintInt(screenPos, float3(1, 1, 1), lightGrid.y);
     }
     
+#if LIGHT_TREE_SAMPLING
+    //hybrid : the clusters with many lights sample them instead
+    if (lightGrid.y > c_lightTreeHybridLightCount)
+    {
+        lighting += SampleLocalLights(pos, worldPos, shadingModel, V, N, diffuse, specular, roughness, customData);
+    }
+    else
+#endif
     for (uint i = 0; i < lightGrid.y; ++i)
     {
         uint lightIndex = GetLightIndex(lightGrid.x + i);
@@ -64,6 +117,8 @@ void main(uint3 dispatchThreadID : SV_DispatchThreadID)
         
         lighting += CalculateLocalLight(light, worldPos, shadingModel, V, N, diffuse, specular, roughness, customData);
     }
+#elif LIGHT_TREE_SAMPLING
+    lighting += SampleLocalLights(pos, worldPos, shadingModel, V, N, diffuse, specular, roughness, customData);
 #else
     for (uint i = 0; i < SceneCB.localLightCount; ++i)
     {
@@ -126,7 +126,7 @@ struct SceneConstant
     float mipBias;
     uint skyCubeTexture;
     uint skySpecularIBLTexture;
-    uint skyDiffuseIBLTexture;
+    uint skyDiffuseSHBuffer;
 
     uint sheenETexture;
     uint tonyMcMapfaceTexture;
@@ -141,6 +141,13 @@ struct SceneConstant
     float2 lightGridSliceParams;
     uint lightGridTileSize;
     uint lightGridSliceCount;
+
+    uint sceneMaterialBufferSRV;
+    uint textureStreamingFeedbackUAV;
+    uint textureStreamingResidencyAddress;
+    uint lightGridsBufferSRV;   //set when the light lists are culled on the GPU, instead of lightGridsAddress
+    
+    uint lightIndicesBufferSRV; //set when the light lists are culled on the GPU, instead of lightIndicesAddress
 };
 
 #ifndef __cplusplus
@@ -7,6 +7,12 @@ enum class InstanceType : uint
     Model,
 };
 
+//instance masks of the scene tlas
+static const uint RT_INSTANCE_MASK_OPAQUE = 0x1;
+static const uint RT_INSTANCE_MASK_ALPHA_TEST = 0x2;     //has alpha tested geometries
+static const uint RT_INSTANCE_MASK_DYNAMIC = 0x4;        //skinned, or moved by physics
+static const uint RT_INSTANCE_MASK_DEFAULT = RT_INSTANCE_MASK_OPAQUE | RT_INSTANCE_MASK_ALPHA_TEST | RT_INSTANCE_MASK_DYNAMIC;
+
 struct InstanceData
 {
     uint instanceType;
@@ -25,7 +31,7 @@ struct InstanceData
     uint tangentBufferAddress;
     
     uint bVertexAnimation;
-    uint materialDataAddress;
+    uint materialIndex; //in the scene material buffer
     uint objectID;
     float scale;
     
@@ -0,0 +1,184 @@
+#include "ray_trace.hlsli"
+#include "random.hlsli"
+#include "importance_sampling.hlsli"
+#include "local_light.hlsli"
+#include "hash_grid_radiance_cache.hlsli"
+
+cbuffer CB : register(b1)
+{
+    HashGridRadianceCacheParams c_params;
+
+    uint c_activeCellsBuffer;
+    uint c_activeCellCountBuffer;
+    uint c_indirectArgsBuffer;
+    uint c_maxSampleCount;
+
+    uint c_maxAge;
+    uint c_bReset;
+};
+
+//one thread per slot : evicts the cells which were not queried for c_maxAge frames, and lists the others for the update
+[numthreads(64, 1, 1)]
+void compact_cells(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint slot = dispatchThreadID.x;
+    if (slot >= c_params.capacity)
+    {
+        return;
+    }
+
+    RWBuffer<uint> keysBuffer = ResourceDescriptorHeap[c_params.keysBuffer];
+    RWStructuredBuffer<HashGridCell> cellsBuffer = ResourceDescriptorHeap[c_params.cellsBuffer];
+
+    if (c_bReset)
+    {
+        keysBuffer[slot] = HASH_GRID_EMPTY_KEY;
+        cellsBuffer[slot] = (HashGridCell)0;
+        return;
+    }
+
+    bool active = false;
+    if (keysBuffer[slot] != HASH_GRID_EMPTY_KEY)
+    {
+        if (HashGridIsCellExpired(cellsBuffer[slot], c_params.frameIndex, c_maxAge))
+        {
+            keysBuffer[slot] = HASH_GRID_EMPTY_KEY;
+            cellsBuffer[slot].sampleCount = 0;
+        }
+        else
+        {
+            active = true;
+        }
+    }
+
+    RWBuffer<uint> activeCellsBuffer = ResourceDescriptorHeap[c_activeCellsBuffer];
+    RWBuffer<uint> activeCellCountBuffer = ResourceDescriptorHeap[c_activeCellCountBuffer];
+
+    uint waveActiveCount = WaveActiveCountBits(active);
+    uint offset;
+    if (WaveIsFirstLane())
+    {
+        InterlockedAdd(activeCellCountBuffer[0], waveActiveCount, offset);
+    }
+    offset = WaveReadLaneFirst(offset) + WavePrefixCountBits(active);
+
+    if (active)
+    {
+        activeCellsBuffer[offset] = slot;
+    }
+}
+
+[numthreads(1, 1, 1)]
+void prepare_update_args()
+{
+    Buffer<uint> activeCellCountBuffer = ResourceDescriptorHeap[c_activeCellCountBuffer];
+    RWBuffer<uint> indirectArgsBuffer = ResourceDescriptorHeap[c_indirectArgsBuffer];
+
+    indirectArgsBuffer[0] = (activeCellCountBuffer[0] + 63) / 64;
+    indirectArgsBuffer[1] = 1;
+    indirectArgsBuffer[2] = 1;
+}
+
+//lighting of the hit point : the sun and a local light picked uniformly, like the path tracer, plus its own cell for the next bounces.
+//the hit cells are only read, so that the cells do not keep each other alive
+float3 ShadeHit(RayDesc ray, rt::HitInfo hitInfo, rt::RayCone cone, inout PRNG rng)
+{
+    rt::MaterialData material = rt::GetMaterial(ray, hitInfo, cone);
+    float3 V = -ray.Direction;
+    float3 N = material.worldNormal;
+    float roughness = lerp(material.roughness, 1.0, 0.5); //reduce fireflies
+
+    RayDesc shadowRay;
+    shadowRay.Origin = hitInfo.position + N * 0.01;
+    shadowRay.Direction = SceneCB.lightDir;
+    shadowRay.TMin = 0.00001;
+    shadowRay.TMax = 1000.0;
+
+    float3 radiance = material.emissive;
+    if (rt::TraceVisibilityRay(shadowRay))
+    {
+        radiance += DefaultBRDF(SceneCB.lightDir, V, N, material.diffuse, material.specular, roughness) * SceneCB.lightColor * saturate(dot(N, SceneCB.lightDir));
+    }
+
+    if (SceneCB.localLightCount > 0)
+    {
+        uint lightIndex = min(uint(rng.RandomFloat() * SceneCB.localLightCount), SceneCB.localLightCount - 1);
+        LocalLightData light = GetLocalLightData(lightIndex);
+
+        float3 toLight = light.position - hitInfo.position;
+        float distance = length(toLight);
+
+        shadowRay.Direction = toLight / distance;
+        shadowRay.TMax = distance;
+
+        if (distance < light.radius && rt::TraceVisibilityRay(shadowRay))
+        {
+            radiance += CalculateLocalLight(light, hitInfo.position, ShadingModel::Default, V, N, material.diffuse, material.specular, roughness, 0) * SceneCB.localLightCount;
+        }
+    }
+
+    HashGridCellKey key = HashGridComputeKey(c_params, hitInfo.position, N);
+    uint slot = HashGridFindCell(c_params.keysBuffer, c_params.capacity, key);
+    if (slot != HASH_GRID_INVALID_SLOT)
+    {
+        RWStructuredBuffer<HashGridCell> cellsBuffer = ResourceDescriptorHeap[c_params.cellsBuffer];
+        HashGridCell cell = cellsBuffer[slot];
+
+        if (cell.sampleCount > 0)
+        {
+            radiance += cell.radiance * material.diffuse;
+        }
+    }
+
+    return radiance;
+}
+
+//one thread per active cell : traces a cosine distributed ray from the cell and adds its radiance to the cell.
+//a hit may read a neighbour cell before or after its own update of this frame
+[numthreads(64, 1, 1)]
+void update_cells(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    Buffer<uint> activeCellCountBuffer = ResourceDescriptorHeap[c_activeCellCountBuffer];
+    if (dispatchThreadID.x >= activeCellCountBuffer[0])
+    {
+        return;
+    }
+
+    Buffer<uint> activeCellsBuffer = ResourceDescriptorHeap[c_activeCellsBuffer];
+    RWStructuredBuffer<HashGridCell> cellsBuffer = ResourceDescriptorHeap[c_params.cellsBuffer];
+
+    uint slot = activeCellsBuffer[dispatchThreadID.x];
+    HashGridCell cell = cellsBuffer[slot];
+
+    PRNG rng;
+    rng.seed = TEA(uint2(slot, SceneCB.frameIndex), 3);
+
+    RayDesc ray;
+    ray.Origin = cell.position + cell.normal * 0.01;
+    ray.Direction = SampleCosHemisphere(rng.RandomFloat2(), cell.normal); //the pdf cancels the cosine of the mean radiance
+    ray.TMin = 0.00001;
+    ray.TMax = 1000.0;
+
+    rt::RayCone cone = rt::RayCone::FromGBuffer(length(cell.position - c_params.cameraPosition));
+    rt::HitInfo hitInfo = (rt::HitInfo)0;
+
+    float3 radiance;
+    if (rt::TraceRay(ray, hitInfo))
+    {
+        cone.Propagate(0.03, hitInfo.rayT);
+        radiance = ShadeHit(ray, hitInfo, cone, rng);
+    }
+    else
+    {
+        TextureCube skyTexture = ResourceDescriptorHeap[SceneCB.skyCubeTexture];
+        SamplerState linearSampler = SamplerDescriptorHeap[SceneCB.bilinearClampSampler];
+        radiance = skyTexture.SampleLevel(linearSampler, ray.Direction, 0).xyz;
+    }
+
+    if (any(isnan(radiance)) || any(isinf(radiance)))
+    {
+        radiance = 0.0;
+    }
+
+    cellsBuffer[slot] = HashGridAddSample(cell, min(radiance, 65504.0), c_maxSampleCount);
+}
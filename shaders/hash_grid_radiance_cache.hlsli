@@ -0,0 +1,254 @@
+#pragma once
+
+//world space radiance cache of HashGridRadianceCache, shared by hash_grid_radiance_cache.hlsl, its consumers and the CPU tests.
+//a cell is keyed by its quantized position, the dominant axis of its normal and its level, the cells grow with the distance to the camera.
+//the keys live in an open addressing table : a 32 bits hash picks the first slot, a second hash is stored as the checksum of the key
+
+static const uint HASH_GRID_MAX_PROBES = 16;
+static const uint HASH_GRID_EMPTY_KEY = 0;
+static const uint HASH_GRID_INVALID_SLOT = 0xffffffff;
+
+struct HashGridRadianceCacheParams
+{
+    uint keysBuffer; //RWBuffer<uint> of the checksums, HASH_GRID_EMPTY_KEY for the free slots
+    uint cellsBuffer; //RWStructuredBuffer<HashGridCell>
+    uint capacity; //power of two
+    uint frameIndex;
+
+    float3 cameraPosition;
+    float cellSize; //at level 0
+
+    float lodScale; //world size of a cell at a distance of 1, the cells are about that many pixels wide on screen
+    uint maxLevel;
+    uint minSampleCount; //the queries miss until their cell has that many samples
+    uint padding;
+};
+
+struct HashGridCell
+{
+    float3 position; //of the query which allocated the cell, its update rays start there
+    uint lastUsedFrame;
+
+    float3 normal;
+    uint sampleCount;
+
+    float3 radiance; //mean incoming radiance over the cosine weighted hemisphere, the indirect diffuse lighting of the cell is radiance * albedo
+    float padding;
+};
+
+struct HashGridCellKey
+{
+    uint hash;
+    uint checksum; //never HASH_GRID_EMPTY_KEY
+};
+
+struct HashGridSlot
+{
+    uint index; //HASH_GRID_INVALID_SLOT if all the probed slots are taken
+    bool inserted;
+};
+
+//https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+inline uint HashGridPcg(uint value)
+{
+    uint state = value * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+//https://github.com/Cyan4973/xxHash, the 32 bits version for a single value
+inline uint HashGridXxhash32(uint value)
+{
+    uint h32 = value + 374761393u;
+    h32 = 668265263u * ((h32 << 17) | (h32 >> (32 - 17)));
+    h32 = 2246822519u * (h32 ^ (h32 >> 15));
+    h32 = 3266489917u * (h32 ^ (h32 >> 13));
+    return h32 ^ (h32 >> 16);
+}
+
+//the coarsest level whose cells are not larger than lodScale times the distance to the camera
+inline uint HashGridLevel(HashGridRadianceCacheParams params, float3 position)
+{
+    float targetSize = length(position - params.cameraPosition) * params.lodScale;
+    if (targetSize < params.cellSize * 2.0f)
+    {
+        return 0;
+    }
+
+    return min((uint)floor(log2(targetSize / params.cellSize)), params.maxLevel);
+}
+
+inline float HashGridLevelCellSize(HashGridRadianceCacheParams params, uint level)
+{
+    return params.cellSize * (float)(1u << level);
+}
+
+//one of the 6 axis directions, so that the noise of flat surfaces does not split their cells
+inline uint HashGridNormalDirection(float3 normal)
+{
+    float3 n2 = normal * normal;
+    if (n2.x >= n2.y && n2.x >= n2.z)
+    {
+        return normal.x >= 0.0f ? 0 : 1;
+    }
+
+    if (n2.y >= n2.z)
+    {
+        return normal.y >= 0.0f ? 2 : 3;
+    }
+
+    return normal.z >= 0.0f ? 4 : 5;
+}
+
+inline HashGridCellKey HashGridComputeKey(HashGridRadianceCacheParams params, float3 position, float3 normal)
+{
+    uint level = HashGridLevel(params, position);
+    float size = HashGridLevelCellSize(params, level);
+    uint x = (uint)(int)floor(position.x / size);
+    uint y = (uint)(int)floor(position.y / size);
+    uint z = (uint)(int)floor(position.z / size);
+    uint levelDirection = level | (HashGridNormalDirection(normal) << 8);
+
+    HashGridCellKey key;
+    key.hash = HashGridPcg(HashGridPcg(HashGridPcg(HashGridPcg(x) + y) + z) + levelDirection);
+    key.checksum = HashGridXxhash32(HashGridXxhash32(HashGridXxhash32(HashGridXxhash32(x) + y) + z) + levelDirection);
+    key.checksum = key.checksum == HASH_GRID_EMPTY_KEY ? 1 : key.checksum;
+    return key;
+}
+
+#ifdef __cplusplus
+typedef uint* HashGridKeys; //the CPU version is for the single threaded tests
+
+inline uint HashGridLoadKey(HashGridKeys keys, uint slot)
+{
+    return keys[slot];
+}
+
+inline uint HashGridCompareExchangeKey(HashGridKeys keys, uint slot, uint value)
+{
+    uint previous = keys[slot];
+    if (previous == HASH_GRID_EMPTY_KEY)
+    {
+        keys[slot] = value;
+    }
+    return previous;
+}
+#else
+typedef uint HashGridKeys; //descriptor index of a RWBuffer<uint>
+
+uint HashGridLoadKey(HashGridKeys keys, uint slot)
+{
+    RWBuffer<uint> keysBuffer = ResourceDescriptorHeap[keys];
+    return keysBuffer[slot];
+}
+
+uint HashGridCompareExchangeKey(HashGridKeys keys, uint slot, uint value)
+{
+    RWBuffer<uint> keysBuffer = ResourceDescriptorHeap[keys];
+
+    uint previous;
+    InterlockedCompareExchange(keysBuffer[slot], HASH_GRID_EMPTY_KEY, value, previous);
+    return previous;
+}
+#endif
+
+//looks at all the probed slots, the evictions leave holes before the slots of the remaining keys
+inline uint HashGridFindCell(HashGridKeys keys, uint capacity, HashGridCellKey key)
+{
+    for (uint i = 0; i < HASH_GRID_MAX_PROBES; ++i)
+    {
+        uint slot = (key.hash + i) & (capacity - 1);
+        if (HashGridLoadKey(keys, slot) == key.checksum)
+        {
+            return slot;
+        }
+    }
+
+    return HASH_GRID_INVALID_SLOT;
+}
+
+//the threads inserting the same key claim the free slots in the same order, so they end up in the same one
+inline HashGridSlot HashGridFindOrInsertCell(HashGridKeys keys, uint capacity, HashGridCellKey key)
+{
+    HashGridSlot result;
+    result.index = HashGridFindCell(keys, capacity, key);
+    result.inserted = false;
+
+    if (result.index != HASH_GRID_INVALID_SLOT)
+    {
+        return result;
+    }
+
+    for (uint i = 0; i < HASH_GRID_MAX_PROBES; ++i)
+    {
+        uint slot = (key.hash + i) & (capacity - 1);
+        uint previous = HashGridCompareExchangeKey(keys, slot, key.checksum);
+
+        if (previous == HASH_GRID_EMPTY_KEY || previous == key.checksum)
+        {
+            result.index = slot;
+            result.inserted = previous == HASH_GRID_EMPTY_KEY;
+            return result;
+        }
+    }
+
+    return result;
+}
+
+inline HashGridCell HashGridCreateCell(float3 position, float3 normal, uint frameIndex)
+{
+    HashGridCell cell;
+    cell.position = position;
+    cell.lastUsedFrame = frameIndex;
+    cell.normal = normal;
+    cell.sampleCount = 0;
+    cell.radiance = float3(0.0f, 0.0f, 0.0f);
+    cell.padding = 0.0f;
+    return cell;
+}
+
+//running mean of the first samples, then an exponential moving average which forgets the old lighting
+inline HashGridCell HashGridAddSample(HashGridCell cell, float3 radiance, uint maxSampleCount)
+{
+    cell.sampleCount = min(cell.sampleCount + 1, maxSampleCount);
+    cell.radiance += (radiance - cell.radiance) / (float)cell.sampleCount;
+    return cell;
+}
+
+inline bool HashGridIsCellExpired(HashGridCell cell, uint frameIndex, uint maxAge)
+{
+    return frameIndex - cell.lastUsedFrame > maxAge;
+}
+
+#ifndef __cplusplus
+//the cached radiance of the cell of a surface point, for the consumer passes. the missing cells are allocated,
+//and the update pass keeps tracing rays for the cells queried in the last frames. false until the cell has converged enough
+bool QueryRadianceCache(HashGridRadianceCacheParams params, float3 position, float3 normal, out float3 radiance)
+{
+    radiance = 0.0;
+
+    HashGridCellKey key = HashGridComputeKey(params, position, normal);
+    HashGridSlot slot = HashGridFindOrInsertCell(params.keysBuffer, params.capacity, key);
+    if (slot.index == HASH_GRID_INVALID_SLOT)
+    {
+        return false;
+    }
+
+    RWStructuredBuffer<HashGridCell> cellsBuffer = ResourceDescriptorHeap[params.cellsBuffer];
+    if (slot.inserted)
+    {
+        cellsBuffer[slot.index] = HashGridCreateCell(position, normal, params.frameIndex);
+        return false;
+    }
+
+    //a cell inserted by another thread of this pass may not be written yet, the evictions reset its sample count
+    HashGridCell cell = cellsBuffer[slot.index];
+    if (cell.lastUsedFrame != params.frameIndex)
+    {
+        cellsBuffer[slot.index].lastUsedFrame = params.frameIndex;
+    }
+
+    radiance = cell.radiance;
+    return cell.sampleCount >= params.minSampleCount;
+}
+#endif
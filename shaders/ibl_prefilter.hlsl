@@ -103,35 +103,83 @@ void specular_filter(uint3 dispatchThreadID : SV_DispatchThreadID)
     outputTexture[dispatchThreadID] = float4(prefilteredColor / totalWeight, 1.0);
 }
 
-[numthreads(8, 8, 1)]
-void diffuse_filter(uint3 dispatchThreadID : SV_DispatchThreadID)
+groupshared float3 s_reduction[256];
+
+float3 GroupSum(float3 value, uint groupIndex)
 {
-    SamplerState linearSampler = SamplerDescriptorHeap[SceneCB.bilinearClampSampler];
-    TextureCube inputTexture = ResourceDescriptorHeap[c_inputTexture];
-    RWTexture2DArray<float4> outputTexture = ResourceDescriptorHeap[c_outputTexture];
+    s_reduction[groupIndex] = value;
+    GroupMemoryBarrierWithGroupSync();
 
-    float2 uv = (float2(dispatchThreadID.xy) + 0.5) / c_cubeSize;
-    float2 xy = uv * 2.0f - float2(1.0f, 1.0f);
-    xy.y = -xy.y;
-    uint slice = dispatchThreadID.z;
-    float3 N = normalize(ups[slice] * xy.y + rights[slice] * xy.x + views[slice]);
+    for (uint stride = 128; stride > 0; stride >>= 1)
+    {
+        if (groupIndex < stride)
+        {
+            s_reduction[groupIndex] += s_reduction[groupIndex + stride];
+        }
+        GroupMemoryBarrierWithGroupSync();
+    }
 
-    float3 irradiance = 0.0;
+    float3 sum = s_reduction[0];
+    GroupMemoryBarrierWithGroupSync();
+    return sum;
+}
 
-    const uint sampleCount = 64 * 1024;
-    for (uint i = 0; i < sampleCount; ++i)
+// projects the radiance of the cubemap to L2 SH, then convolves it with the clamped cosine lobe
+// "An Efficient Representation for Irradiance Environment Maps", Ramamoorthi and Hanrahan 2001
+[numthreads(256, 1, 1)]
+void diffuse_sh(uint groupIndex : SV_GroupIndex)
+{
+    Texture2DArray inputTexture = ResourceDescriptorHeap[c_inputTexture];
+    RWStructuredBuffer<float4> outputBuffer = ResourceDescriptorHeap[c_outputTexture];
+
+    uint size = max(c_cubeSize >> c_mip, 1);
+    uint texelCount = size * size * 6;
+
+    float3 sh[9];
+    for (uint k = 0; k < 9; ++k)
     {
-        float2 random = Hammersley(i, sampleCount);
-        float3 L = SampleCosHemisphere(random, N);
+        sh[k] = 0.0;
+    }
+    float weightSum = 0.0;
 
-        float NdotL = saturate(dot(N, L));
-        float pdf = NdotL / M_PI;
+    for (uint i = groupIndex; i < texelCount; i += 256)
+    {
+        uint slice = i / (size * size);
+        uint x = i % size;
+        uint y = (i / size) % size;
+
+        float2 xy = (float2(x, y) + 0.5) / size * 2.0 - 1.0;
+        xy.y = -xy.y;
+        float3 dir = ups[slice] * xy.y + rights[slice] * xy.x + views[slice];
 
-        float3 diffuseBRDF = DiffuseBRDF(inputTexture.SampleLevel(linearSampler, L, 0.0).xyz);
-        irradiance += diffuseBRDF * NdotL / pdf;
+        // solid angle of the texel is proportional to (1 + u^2 + v^2)^(-3/2)
+        float weight = pow(dot(dir, dir), -1.5);
+        dir = normalize(dir);
+
+        float3 radiance = inputTexture.Load(int4(x, y, slice, c_mip)).xyz * weight;
+
+        float basis[9];
+        EvaluateSH9(dir, basis);
+
+        for (uint k = 0; k < 9; ++k)
+        {
+            sh[k] += radiance * basis[k];
+        }
+        weightSum += weight;
     }
 
-    irradiance /= sampleCount;
+    weightSum = GroupSum(weightSum.xxx, groupIndex).x;
+
+    // cosine lobe : PI, 2PI/3, PI/4 per band, then divided by PI for the lambertian brdf
+    static const float bandScale[9] = { 1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25 };
+
+    for (uint k = 0; k < 9; ++k)
+    {
+        float3 coefficient = GroupSum(sh[k], groupIndex) * (4.0 * M_PI / weightSum) * bandScale[k];
 
-    outputTexture[dispatchThreadID] = float4(irradiance, 1.0);
-}
\ No newline at end of file
+        if (groupIndex == 0)
+        {
+            outputBuffer[k] = float4(coefficient, 0.0);
+        }
+    }
+}
@@ -0,0 +1,336 @@
+#pragma once
+
+//light tree of the tiled light trees, shared by tiled_light_trees.hlsl, direct_lighting.hlsl and the CPU builder in TiledLightTrees.
+//each node bounds the positions, energy, range and emission cone of its lights, see "Importance Sampling of Many Lights with Adaptive Tree Splitting".
+//a tile picks a cut of the tree from its bounds, then a pixel picks a node of the cut and walks down to a light,
+//both with probabilities proportional to the node importances at its position
+
+static const uint LIGHT_TREE_MAX_CUT_SIZE = 32;
+static const uint LIGHT_TREE_LEAF_BIT = 0x80000000;
+static const uint LIGHT_TREE_INVALID_INDEX = 0xffffffff;
+static const float LIGHT_TREE_PI = 3.14159265f;
+static const float LIGHT_TREE_ANGLE_EPSILON = 1.0e-3f; //keeps the cone tests conservative against rounding
+
+struct LightTreeNode
+{
+    float3 boundsMin;
+    uint child; //the two children are at child and child + 1, leaves have the light index and LIGHT_TREE_LEAF_BIT
+
+    float3 boundsMax;
+    float energy; //sum of the light luminances
+
+    float3 axis; //emission cone : the lights face at most thetaO away from the axis, and emit thetaE around it
+    float thetaO;
+
+    float thetaE;
+    float maxRadius; //largest light range
+    float minFalloff;
+    uint parent;
+};
+
+struct LightTreeCut
+{
+    uint nodeCount;
+    uint nodes[LIGHT_TREE_MAX_CUT_SIZE];
+};
+
+struct LightTreeSample
+{
+    uint lightIndex; //LIGHT_TREE_INVALID_INDEX if no light reaches the position
+    float pdf;
+};
+
+#ifdef __cplusplus
+typedef const LightTreeNode* LightTreeNodes;
+
+inline LightTreeNode GetLightTreeNode(LightTreeNodes nodes, uint index)
+{
+    return nodes[index];
+}
+#else
+typedef uint LightTreeNodes; //descriptor index of a StructuredBuffer<LightTreeNode>
+
+LightTreeNode GetLightTreeNode(LightTreeNodes nodes, uint index)
+{
+    StructuredBuffer<LightTreeNode> nodesBuffer = ResourceDescriptorHeap[nodes];
+    return nodesBuffer[index];
+}
+#endif
+
+inline bool IsLightTreeLeaf(LightTreeNode node)
+{
+    return (node.child & LIGHT_TREE_LEAF_BIT) != 0;
+}
+
+//an upper bound of the light the node can send to a surface at the position, 0 only if none of its lights reaches it.
+//the window of the point light attenuation is taken at the closest point of the bounds. the local lights emit evenly in their cone,
+//so the orientation bound is a test instead of the cosine of the paper. normal can be 0 for the shading models lit from behind
+inline float LightTreeImportance(LightTreeNode node, float3 position, float3 normal)
+{
+    float3 closestPoint = clamp(position, node.boundsMin, node.boundsMax);
+    float closestDistance = length(closestPoint - position);
+    if (node.energy <= 0.0f || closestDistance >= node.maxRadius)
+    {
+        return 0.0f;
+    }
+
+    float s2 = (closestDistance / node.maxRadius) * (closestDistance / node.maxRadius);
+    float attenuation = (1.0f - s2) * (1.0f - s2) / (1.0f + node.minFalloff * s2);
+
+    //angle of the bounding sphere seen from the position
+    float3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+    float radius = length(node.boundsMax - node.boundsMin) * 0.5f;
+    float3 toCenter = center - position;
+    float centerDistance = length(toCenter);
+    float thetaU = centerDistance > radius ? asin(radius / centerDistance) : LIGHT_TREE_PI;
+
+    if (thetaU < LIGHT_TREE_PI && node.thetaO + node.thetaE < LIGHT_TREE_PI)
+    {
+        float theta = acos(clamp(-dot(node.axis, toCenter) / centerDistance, -1.0f, 1.0f));
+        if (theta - node.thetaO - thetaU >= node.thetaE + LIGHT_TREE_ANGLE_EPSILON)
+        {
+            return 0.0f;
+        }
+    }
+
+    float cosIncidence = 1.0f;
+    if (thetaU < LIGHT_TREE_PI && dot(normal, normal) > 0.0f)
+    {
+        float thetaI = acos(clamp(dot(normal, toCenter) / centerDistance, -1.0f, 1.0f));
+        float thetaIPrime = max(thetaI - thetaU, 0.0f);
+        if (thetaIPrime >= LIGHT_TREE_PI * 0.5f)
+        {
+            return 0.0f;
+        }
+        cosIncidence = cos(thetaIPrime);
+    }
+
+    return node.energy * attenuation * cosIncidence;
+}
+
+inline float LightTreeBoxDistance(LightTreeNode node, float3 boxMin, float3 boxMax)
+{
+    float3 d = max(max(node.boundsMin - boxMax, boxMin - node.boundsMax), float3(0.0f, 0.0f, 0.0f));
+    return length(d);
+}
+
+//whether any light of the node can reach a point of the box
+inline bool LightTreeReachesBox(LightTreeNode node, float3 boxMin, float3 boxMax)
+{
+    return node.energy > 0.0f && LightTreeBoxDistance(node, boxMin, boxMax) < node.maxRadius;
+}
+
+//how much the importance of a node can change over a box, the cut splits the largest one first
+inline float LightTreeCutPriority(LightTreeNode node, float3 boxMin, float3 boxMax)
+{
+    if (IsLightTreeLeaf(node))
+    {
+        return -1.0f;
+    }
+
+    float3 extent = node.boundsMax - node.boundsMin;
+    float distance = LightTreeBoxDistance(node, boxMin, boxMax);
+    return node.energy * dot(extent, extent) / max(distance * distance, 1.0e-6f);
+}
+
+//the nodes which can light the box, each light reaching it is under exactly one of them
+inline LightTreeCut BuildLightTreeCut(LightTreeNodes nodes, float3 boxMin, float3 boxMax)
+{
+    LightTreeCut cut;
+    cut.nodeCount = 0;
+
+    float priorities[LIGHT_TREE_MAX_CUT_SIZE];
+
+    LightTreeNode root = GetLightTreeNode(nodes, 0);
+    if (LightTreeReachesBox(root, boxMin, boxMax))
+    {
+        cut.nodes[0] = 0;
+        priorities[0] = LightTreeCutPriority(root, boxMin, boxMax);
+        cut.nodeCount = 1;
+    }
+
+    //the pruned children free their slot, so a split can also shrink the cut
+    for (uint iteration = 0; iteration < LIGHT_TREE_MAX_CUT_SIZE * 4; ++iteration)
+    {
+        uint selected = LIGHT_TREE_INVALID_INDEX;
+        float selectedPriority = 0.0f;
+        for (uint i = 0; i < cut.nodeCount; ++i)
+        {
+            if (priorities[i] > selectedPriority)
+            {
+                selected = i;
+                selectedPriority = priorities[i];
+            }
+        }
+
+        if (selected == LIGHT_TREE_INVALID_INDEX)
+        {
+            break;
+        }
+
+        uint firstChild = GetLightTreeNode(nodes, cut.nodes[selected]).child;
+        LightTreeNode left = GetLightTreeNode(nodes, firstChild);
+        LightTreeNode right = GetLightTreeNode(nodes, firstChild + 1);
+        bool leftReaches = LightTreeReachesBox(left, boxMin, boxMax);
+        bool rightReaches = LightTreeReachesBox(right, boxMin, boxMax);
+
+        if (leftReaches && rightReaches)
+        {
+            if (cut.nodeCount == LIGHT_TREE_MAX_CUT_SIZE)
+            {
+                break;
+            }
+
+            cut.nodes[selected] = firstChild;
+            priorities[selected] = LightTreeCutPriority(left, boxMin, boxMax);
+            cut.nodes[cut.nodeCount] = firstChild + 1;
+            priorities[cut.nodeCount] = LightTreeCutPriority(right, boxMin, boxMax);
+            cut.nodeCount++;
+        }
+        else if (leftReaches || rightReaches)
+        {
+            cut.nodes[selected] = leftReaches ? firstChild : firstChild + 1;
+            priorities[selected] = LightTreeCutPriority(leftReaches ? left : right, boxMin, boxMax);
+        }
+        else
+        {
+            cut.nodeCount--;
+            cut.nodes[selected] = cut.nodes[cut.nodeCount];
+            priorities[selected] = priorities[cut.nodeCount];
+        }
+    }
+
+    return cut;
+}
+
+//picks a light under the cut, u in [0, 1) is rescaled after each choice to make the next one
+inline LightTreeSample SampleLightTree(LightTreeNodes nodes, LightTreeCut cut, float3 position, float3 normal, float u)
+{
+    LightTreeSample result;
+    result.lightIndex = LIGHT_TREE_INVALID_INDEX;
+    result.pdf = 0.0f;
+
+    float importances[LIGHT_TREE_MAX_CUT_SIZE];
+    float totalImportance = 0.0f;
+    for (uint i = 0; i < cut.nodeCount; ++i)
+    {
+        importances[i] = LightTreeImportance(GetLightTreeNode(nodes, cut.nodes[i]), position, normal);
+        totalImportance += importances[i];
+    }
+
+    if (totalImportance <= 0.0f)
+    {
+        return result;
+    }
+
+    float target = u * totalImportance;
+    float cdf = 0.0f;
+    uint selected = 0;
+    float selectedCdf = 0.0f;
+    for (uint j = 0; j < cut.nodeCount; ++j)
+    {
+        if (importances[j] > 0.0f)
+        {
+            selected = j;
+            selectedCdf = cdf;
+            cdf += importances[j];
+
+            if (target < cdf)
+            {
+                break;
+            }
+        }
+    }
+
+    float pdf = importances[selected] / totalImportance;
+    u = min((target - selectedCdf) / importances[selected], 0.99999994f);
+
+    LightTreeNode node = GetLightTreeNode(nodes, cut.nodes[selected]);
+    while (!IsLightTreeLeaf(node))
+    {
+        LightTreeNode left = GetLightTreeNode(nodes, node.child);
+        LightTreeNode right = GetLightTreeNode(nodes, node.child + 1);
+        float leftImportance = LightTreeImportance(left, position, normal);
+        float rightImportance = LightTreeImportance(right, position, normal);
+        float importance = leftImportance + rightImportance;
+
+        //the bounds of the parent were looser than the ones of its children
+        if (importance <= 0.0f)
+        {
+            return result;
+        }
+
+        float leftProbability = leftImportance / importance;
+        float rightProbability = rightImportance / importance;
+
+        if (u < leftProbability)
+        {
+            u = min(u / leftProbability, 0.99999994f);
+            pdf *= leftProbability;
+            node = left;
+        }
+        else
+        {
+            u = clamp((u - leftProbability) / rightProbability, 0.0f, 0.99999994f);
+            pdf *= rightProbability;
+            node = right;
+        }
+    }
+
+    result.lightIndex = node.child & ~LIGHT_TREE_LEAF_BIT;
+    result.pdf = pdf;
+    return result;
+}
+
+//probability of SampleLightTree picking the light of a leaf, 0 if the leaf is not under the cut
+inline float LightTreePdf(LightTreeNodes nodes, LightTreeCut cut, float3 position, float3 normal, uint leafIndex)
+{
+    float pdf = 1.0f;
+    uint nodeIndex = leafIndex;
+
+    while (true)
+    {
+        uint cutSlot = LIGHT_TREE_INVALID_INDEX;
+        for (uint i = 0; i < cut.nodeCount; ++i)
+        {
+            if (cut.nodes[i] == nodeIndex)
+            {
+                cutSlot = i;
+            }
+        }
+
+        if (cutSlot != LIGHT_TREE_INVALID_INDEX)
+        {
+            float totalImportance = 0.0f;
+            float importance = 0.0f;
+            for (uint j = 0; j < cut.nodeCount; ++j)
+            {
+                float nodeImportance = LightTreeImportance(GetLightTreeNode(nodes, cut.nodes[j]), position, normal);
+                totalImportance += nodeImportance;
+                importance = j == cutSlot ? nodeImportance : importance;
+            }
+
+            return importance > 0.0f ? pdf * (importance / totalImportance) : 0.0f;
+        }
+
+        if (nodeIndex == 0)
+        {
+            return 0.0f;
+        }
+
+        LightTreeNode parent = GetLightTreeNode(nodes, GetLightTreeNode(nodes, nodeIndex).parent);
+        float leftImportance = LightTreeImportance(GetLightTreeNode(nodes, parent.child), position, normal);
+        float rightImportance = LightTreeImportance(GetLightTreeNode(nodes, parent.child + 1), position, normal);
+        float importance = nodeIndex == parent.child ? leftImportance : rightImportance;
+
+        if (importance <= 0.0f)
+        {
+            return 0.0f;
+        }
+
+        pdf *= importance / (leftImportance + rightImportance);
+        nodeIndex = GetLightTreeNode(nodes, nodeIndex).parent;
+    }
+
+    return 0.0f;
+}
@@ -1,3 +1,6 @@
+//only the base pass requests the streamed mips, the other passes sample the same textures
+#define TEXTURE_STREAMING_FEEDBACK 1
+
 #include "model.hlsli"
 #include "random.hlsli"
 #include "shading_model.hlsli"
@@ -10,7 +10,8 @@ namespace model
 
 ModelMaterialConstant GetMaterialConstant(uint instance_id)
 {
-    return LoadSceneConstantBuffer<ModelMaterialConstant>(GetInstanceData(instance_id).materialDataAddress);
+    ByteAddressBuffer materialBuffer = ResourceDescriptorHeap[SceneCB.sceneMaterialBufferSRV];
+    return materialBuffer.Load<ModelMaterialConstant>(sizeof(ModelMaterialConstant) * GetInstanceData(instance_id).materialIndex);
 }
 
 struct Vertex
@@ -178,16 +179,50 @@ SamplerState GetMaterialSampler()
 #endif
 }
     
+#if TEXTURE_STREAMING_FEEDBACK
+//requests the finest mip this pixel needs, reduced per wave to keep the atomics few
+void WriteTextureStreamingFeedback(Texture2D texture, SamplerState textureSampler, float2 uv, uint streamingIndex)
+{
+    float lod = texture.CalculateLevelOfDetail(textureSampler, uv) + SceneCB.mipBias;
+    uint mip = (uint)max(floor(lod), 0.0);
+
+    //waterfall over the textures of the wave : each iteration writes the one of the first remaining lane, then its lanes leave the loop
+    while (true)
+    {
+        if (WaveReadLaneFirst(streamingIndex) == streamingIndex)
+        {
+            uint minMip = WaveActiveMin(mip);
+            if (WaveIsFirstLane())
+            {
+                RWByteAddressBuffer feedbackBuffer = ResourceDescriptorHeap[SceneCB.textureStreamingFeedbackUAV];
+                feedbackBuffer.InterlockedMin(streamingIndex * 4, minMip);
+            }
+            break;
+        }
+    }
+}
+#endif
+
 float4 SampleMaterialTexture(MaterialTextureInfo textureInfo, float2 uv, float mipLOD)
 {
     Texture2D texture = GetMaterialTexture2D(textureInfo.index);
     SamplerState linearSampler = GetMaterialSampler();
     uv = textureInfo.TransformUV(uv);
 
+    //streamed textures are clamped to their resident mips
+    float minLOD = 0.0;
+    if (textureInfo.streamingIndex != INVALID_STREAMING_INDEX)
+    {
+        minLOD = LoadSceneConstantBuffer<float>(SceneCB.textureStreamingResidencyAddress + textureInfo.streamingIndex * 4);
+#if TEXTURE_STREAMING_FEEDBACK
+        WriteTextureStreamingFeedback(texture, linearSampler, uv, textureInfo.streamingIndex);
+#endif
+    }
+
 #ifdef RAY_TRACING
-    return texture.SampleLevel(linearSampler, uv, mipLOD);
+    return texture.SampleLevel(linearSampler, uv, max(mipLOD, minLOD));
 #else
-    return texture.Sample(linearSampler, uv);
+    return texture.Sample(linearSampler, uv, int2(0, 0), minLOD);
 #endif
 }
 
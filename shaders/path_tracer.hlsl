@@ -3,6 +3,7 @@
 #include "importance_sampling.hlsli"
 #include "local_light.hlsli"
 #include "debug.hlsli"
+#include "hash_grid_radiance_cache.hlsli"
 
 cbuffer PathTracingConstants : register(b1)
 {
@@ -17,6 +18,10 @@ cbuffer PathTracingConstants : register(b1)
     uint c_sampleNum;
     
     uint c_outputTexture;
+    uint c_radianceCacheBounce;
+    uint2 c_padding;
+
+    HashGridRadianceCacheParams c_radianceCache;
 };
 
 float ProbabilityToSampleDiffuse(float3 diffuse, float3 specular)
@@ -120,6 +125,16 @@ void path_tracing(uint3 dispatchThreadID : SV_DispatchThreadID)
         
         radiance += (lighting + emissive) * throughput / pdf;
 
+#if RADIANCE_CACHE
+        //the cache has the indirect diffuse lighting of the vertex, the path ends there
+        float3 cachedRadiance;
+        if (i >= c_radianceCacheBounce && QueryRadianceCache(c_radianceCache, position, N, cachedRadiance))
+        {
+            radiance += cachedRadiance * diffuse * throughput / pdf;
+            break;
+        }
+#endif
+
         if (i == c_maxRayLength)
         {
             break;
@@ -23,26 +23,30 @@ namespace rt
 
             ModelMaterialConstant material = model::GetMaterialConstant(instanceID);
 
-            Texture2D texture = model::GetMaterialTexture2D(material.albedoTexture.index != INVALID_RESOURCE_INDEX ? material.albedoTexture.index : material.diffuseTexture.index);
-            SamplerState linearSampler = SamplerDescriptorHeap[SceneCB.bilinearRepeatSampler];
+            MaterialTextureInfo alphaTexture = material.albedoTexture;
+            if (alphaTexture.index == INVALID_RESOURCE_INDEX)
+            {
+                alphaTexture = material.diffuseTexture;
+            }
 
-            float alpha = texture.SampleLevel(linearSampler, uv, 0).a;
+            //clamped to the resident mips of the streamed textures, like the other material samples
+            float alpha = model::SampleMaterialTexture(alphaTexture, uv, 0.0).a;
             return alpha > material.alphaCutoff;
         }
 
         return true;
     }
 
-    bool TraceVisibilityRay(RayDesc ray)
+    bool TraceVisibilityRay(RayDesc ray, uint instanceMask = RT_INSTANCE_MASK_DEFAULT)
     {
         RaytracingAccelerationStructure raytracingAS = ResourceDescriptorHeap[SceneCB.sceneRayTracingTLAS];
 
         RayQuery<RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH | RAY_FLAG_SKIP_CLOSEST_HIT_SHADER | RAY_FLAG_SKIP_PROCEDURAL_PRIMITIVES> q;
-        q.TraceRayInline(raytracingAS, RAY_FLAG_NONE, 0xFF, ray);
+        q.TraceRayInline(raytracingAS, RAY_FLAG_NONE, instanceMask, ray);
 
         while (q.Proceed())
         {
-            uint instanceID = q.CandidateInstanceID();
+            uint instanceID = q.CandidateInstanceID() + q.CandidateGeometryIndex(); //the geometries of a blas have consecutive instance data
             uint primitiveIndex = q.CandidatePrimitiveIndex();
             float3 barycentricCoordinates = GetBarycentricCoordinates(q.CandidateTriangleBarycentrics());
 
@@ -66,16 +70,16 @@ namespace rt
         bool bFrontFace;
     };
 
-    bool TraceRay(RayDesc ray, out HitInfo hitInfo)
+    bool TraceRay(RayDesc ray, out HitInfo hitInfo, uint instanceMask = RT_INSTANCE_MASK_DEFAULT)
     {
         RaytracingAccelerationStructure raytracingAS = ResourceDescriptorHeap[SceneCB.sceneRayTracingTLAS];
 
         RayQuery<RAY_FLAG_NONE> q;
-        q.TraceRayInline(raytracingAS, RAY_FLAG_NONE, 0xFF, ray);
+        q.TraceRayInline(raytracingAS, RAY_FLAG_NONE, instanceMask, ray);
 
         while (q.Proceed())
         {
-            uint instanceID = q.CandidateInstanceID();
+            uint instanceID = q.CandidateInstanceID() + q.CandidateGeometryIndex(); //the geometries of a blas have consecutive instance data
             uint primitiveIndex = q.CandidatePrimitiveIndex();
             float3 barycentricCoordinates = GetBarycentricCoordinates(q.CandidateTriangleBarycentrics());
 
@@ -94,7 +98,7 @@ namespace rt
         hitInfo.position = q.WorldRayOrigin() + q.WorldRayDirection() * q.CommittedRayT();
         hitInfo.rayT = q.CommittedRayT();
         hitInfo.barycentricCoordinates = GetBarycentricCoordinates(q.CommittedTriangleBarycentrics());
-        hitInfo.instanceID = q.CommittedInstanceID();
+        hitInfo.instanceID = q.CommittedInstanceID() + q.CommittedGeometryIndex();
         hitInfo.primitiveIndex = q.CommittedPrimitiveIndex();
         hitInfo.bFrontFace = q.CommittedTriangleFrontFace();
 
@@ -2,20 +2,39 @@
 #include "../ray_trace.hlsli"
 #include "../random.hlsli"
 #include "../importance_sampling.hlsli"
+#include "../hash_grid_radiance_cache.hlsli"
 
-cbuffer CB : register(b0)
+cbuffer CB : register(b1)
 {
     uint c_halfDepthNormalTexture;
     uint c_historyIrradiance;
     uint c_outputRadianceUAV;
     uint c_outputRayDirection;
+
+    HashGridRadianceCacheParams c_radianceCache;
+}
+
+float3 GetCachedIndirectDiffuseLighting(float3 position, rt::MaterialData material)
+{
+#if RADIANCE_CACHE || RADIANCE_CACHE_REPLACE
+    float3 cachedRadiance;
+    if (QueryRadianceCache(c_radianceCache, position, material.worldNormal, cachedRadiance))
+    {
+        return cachedRadiance * material.diffuse;
+    }
+#endif
+    return 0.0;
 }
 
 float3 GetIndirectDiffuseLighting(float3 position, rt::MaterialData material)
 {
+#if RADIANCE_CACHE_REPLACE
+    return GetCachedIndirectDiffuseLighting(position, material);
+#endif
+
     if (c_historyIrradiance == INVALID_RESOURCE_INDEX)
     {
-        return 0.0;
+        return GetCachedIndirectDiffuseLighting(position, material);
     }
     
     Texture2D historyIrradianceTexture = ResourceDescriptorHeap[c_historyIrradiance];
@@ -32,7 +51,7 @@ float3 GetIndirectDiffuseLighting(float3 position, rt::MaterialData material)
     if (any(prevUV < 0.0) || any(prevUV > 1.0) ||
         abs(GetLinearDepth(prevNdcPos.z) - prevLinearDepth) > 0.05)
     {
-        return 0.0; //todo : maybe some kind of world radiance cache
+        return GetCachedIndirectDiffuseLighting(position, material); //off screen or disoccluded
     }
     
     float3 irradiance = historyIrradianceTexture.SampleLevel(linearSampler, prevUV, 0).xyz;
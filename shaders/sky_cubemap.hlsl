@@ -1,7 +1,7 @@
 #include "common.hlsli"
 #include "atmosphere.hlsli"
 
-cbuffer CB : register(b0)
+cbuffer CB0 : register(b0)
 {
     uint c_cubeTextureUAV;
     uint c_cubeTextureSize;
@@ -9,6 +9,13 @@ cbuffer CB : register(b0)
     uint c_hdriTexture;
 };
 
+cbuffer CB1 : register(b1)
+{
+    float3 c_lightDir;
+    uint c_face;
+    float3 c_lightColor;
+};
+
 static const float3 views[6] =
 {
     float3(1.0f, 0.0f, 0.0f),  // X+
@@ -51,7 +58,7 @@ void main(uint3 dispatchThreadID : SV_DispatchThreadID)
     float2 xy = uv * 2.0f - float2(1.0f, 1.0f);
     xy.y = -xy.y;
 
-    uint slice = dispatchThreadID.z;
+    uint slice = dispatchThreadID.z + c_face;
     float3 dir = normalize(ups[slice] * xy.y + rights[slice] * xy.x + views[slice]);
 
 #if HDRI_TEXTURE
@@ -77,13 +84,13 @@ void main(uint3 dispatchThreadID : SV_DispatchThreadID)
         }
     }
 
-    float3 lightDir = SceneCB.lightDir;
-    float3 lightColor = SceneCB.lightColor;
+    float3 lightDir = c_lightDir;
+    float3 lightColor = c_lightColor;
 
     float3 transmittance;
     float3 color = IntegrateScattering(rayStart, rayDir, rayLength, lightDir, lightColor, 64, transmittance);
 #endif
 
     RWTexture2DArray<float3> cubeTexture = ResourceDescriptorHeap[c_cubeTextureUAV];
-    cubeTexture[dispatchThreadID] = color;
+    cubeTexture[uint3(dispatchThreadID.xy, slice)] = color;
 }
\ No newline at end of file
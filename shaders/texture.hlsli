@@ -1,11 +1,14 @@
 #pragma once
 
+#define INVALID_STREAMING_INDEX (0x7FFFFFFF)
+
 struct MaterialTextureInfo
 {
     uint index;
     uint width : 16;
     uint height : 16;
-    uint bTransform;
+    uint bTransform : 1;
+    uint streamingIndex : 31; //in TextureStreamer, INVALID_STREAMING_INDEX if the texture is fully resident
     float rotation;
     
     float2 offset;
@@ -17,6 +20,7 @@ struct MaterialTextureInfo
         index = GFX_INVALID_RESOURCE;
         width = height = 0;
         bTransform = false;
+        streamingIndex = INVALID_STREAMING_INDEX;
         rotation = 0.0f;
     }
 #else
@@ -0,0 +1,59 @@
+#include "common.hlsli"
+#include "gpu_scene.hlsli"
+#include "clustered_light_culling.hlsli"
+#include "light_tree.hlsli"
+
+cbuffer CB : register(b1)
+{
+    uint c_nodesBuffer;
+    uint c_nodeCount;
+    uint c_cutsBuffer;
+    uint c_tileSize;
+
+    uint2 c_tileCount;
+    uint c_hzbMip;
+    uint c_padding;
+
+    uint2 c_hzbMipSize;
+};
+
+//one thread per tile : the cut of the light tree for the world space bounds of the tile's pixels
+[numthreads(8, 8, 1)]
+void build_cuts(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint2 tile = dispatchThreadID.xy;
+    if (any(tile >= c_tileCount))
+    {
+        return;
+    }
+
+    LightTreeCut cut;
+    cut.nodeCount = 0;
+
+    float zNear = GetCameraCB().nearZ;
+    float2 depthBounds = GetTileDepthBounds(LoadTileHZBDepth(tile, c_tileSize, c_hzbMip, c_hzbMipSize), zNear);
+
+    if (c_nodeCount > 0 && depthBounds.x <= depthBounds.y)
+    {
+        //widened for the half float HZB
+        float nearDepth = max(depthBounds.x * (1.0 - 1.0 / 512.0), zNear);
+        float farDepth = depthBounds.y * (1.0 + 1.0 / 512.0);
+        ClusterAABB aabb = GetClusterAABB(tile.x, tile.y, c_tileSize, nearDepth, farDepth, float2(SceneCB.renderSize), GetCameraCB().mtxProjectionInverse);
+
+        float3 boundsMin = 1.0e30;
+        float3 boundsMax = -1.0e30;
+        for (uint i = 0; i < 8; ++i)
+        {
+            float3 corner = float3((i & 1) ? aabb.maxPoint.x : aabb.minPoint.x, (i & 2) ? aabb.maxPoint.y : aabb.minPoint.y, (i & 4) ? aabb.maxPoint.z : aabb.minPoint.z);
+            float3 worldCorner = mul(GetCameraCB().mtxViewInverse, float4(corner, 1.0)).xyz;
+
+            boundsMin = min(boundsMin, worldCorner);
+            boundsMax = max(boundsMax, worldCorner);
+        }
+
+        cut = BuildLightTreeCut(c_nodesBuffer, boundsMin, boundsMax);
+    }
+
+    RWStructuredBuffer<LightTreeCut> cutsBuffer = ResourceDescriptorHeap[c_cutsBuffer];
+    cutsBuffer[tile.x + tile.y * c_tileCount.x] = cut;
+}
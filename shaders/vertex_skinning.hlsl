@@ -1,75 +1,117 @@
 #include "common.hlsli"
 #include "gpu_scene.hlsli"
+#include "vertex_skinning.hlsli"
 
 cbuffer CB : register(b1)
 {
-    uint c_vertexCount;
+    uint c_jobCount;
+    uint c_jobBufferAddress;  //in the scene constant buffer, sorted by firstGroup
+    uint c_groupOffset;       //added to the group index, to dispatch a single job
+    uint c_groupCountX;       //the groups are wrapped in y above the dispatch size limit
+};
 
-    uint c_staticPosBufferAddress;
-    uint c_staticNormalBufferAddress;
-    uint c_staticTangentBufferAddress;
+VertexSkinningJob LoadJob(uint index)
+{
+    return LoadSceneConstantBuffer<VertexSkinningJob>(c_jobBufferAddress + sizeof(VertexSkinningJob) * index);
+}
 
-    uint c_animPosBufferAddress;
-    uint c_animNormalBufferAddress;
-    uint c_animTangentBufferAddress;
+//the last job whose first group is not after group_index
+uint FindJob(uint group_index)
+{
+    uint first = 0;
+    uint last = c_jobCount - 1;
 
-    uint c_jointIDBufferAddress;
-    uint c_jointWeightBufferAddress;
-    uint c_jointMatrixBufferAddress;
-};
+    while (first < last)
+    {
+        uint middle = (first + last + 1) / 2;
+        uint firstGroup = LoadSceneConstantBuffer<uint>(c_jobBufferAddress + sizeof(VertexSkinningJob) * middle);
+
+        if (firstGroup <= group_index)
+        {
+            first = middle;
+        }
+        else
+        {
+            last = middle - 1;
+        }
+    }
+
+    return first;
+}
+
+float4x4 LoadJointMatrix(uint address, uint joint)
+{
+    float4x4 jointMatrix = LoadSceneConstantBuffer<float4x4>(address + sizeof(float4x4) * joint);
+#if !GFX_BACKEND_VULKAN
+    jointMatrix = transpose(jointMatrix);
+#endif
+    return jointMatrix;
+}
 
-[numthreads(64, 1, 1)]
-void main(uint3 dispatchThreadID : SV_DispatchThreadID)
+float4 SkinPosition(uint address, uint16_t4 jointID, float4 jointWeight, float3 pos)
 {
-    uint vertex_id = dispatchThreadID.x;
-    if (vertex_id >= c_vertexCount)
+    return mul(LoadJointMatrix(address, jointID.x), float4(pos, 1.0)) * jointWeight.x +
+        mul(LoadJointMatrix(address, jointID.y), float4(pos, 1.0)) * jointWeight.y +
+        mul(LoadJointMatrix(address, jointID.z), float4(pos, 1.0)) * jointWeight.z +
+        mul(LoadJointMatrix(address, jointID.w), float4(pos, 1.0)) * jointWeight.w;
+}
+
+[numthreads(VERTEX_SKINNING_GROUP_SIZE, 1, 1)]
+void main(uint3 groupID : SV_GroupID, uint3 groupThreadID : SV_GroupThreadID)
+{
+    uint group_index = groupID.y * c_groupCountX + groupID.x + c_groupOffset;
+
+    VertexSkinningJob job = LoadJob(FindJob(group_index));
+
+    uint vertex_id = (group_index - job.firstGroup) * VERTEX_SKINNING_GROUP_SIZE + groupThreadID.x;
+    if (vertex_id >= job.vertexCount)
     {
         return;
     }
 
-    uint16_t4 jointID = LoadSceneStaticBuffer<uint16_t4>(c_jointIDBufferAddress, vertex_id);
-    float4x4 jointMatrix0 = LoadSceneConstantBuffer<float4x4>(c_jointMatrixBufferAddress + sizeof(float4x4) * jointID.x);
-    float4x4 jointMatrix1 = LoadSceneConstantBuffer<float4x4>(c_jointMatrixBufferAddress + sizeof(float4x4) * jointID.y);
-    float4x4 jointMatrix2 = LoadSceneConstantBuffer<float4x4>(c_jointMatrixBufferAddress + sizeof(float4x4) * jointID.z);
-    float4x4 jointMatrix3 = LoadSceneConstantBuffer<float4x4>(c_jointMatrixBufferAddress + sizeof(float4x4) * jointID.w);
-#if !GFX_BACKEND_VULKAN
-    jointMatrix0 = transpose(jointMatrix0);
-    jointMatrix1 = transpose(jointMatrix1);
-    jointMatrix2 = transpose(jointMatrix2);
-    jointMatrix3 = transpose(jointMatrix3);
-#endif
-    float4 jointWeight = LoadSceneStaticBuffer<float4>(c_jointWeightBufferAddress, vertex_id);
+    uint16_t4 jointID = LoadSceneStaticBuffer<uint16_t4>(job.jointIDBufferAddress, vertex_id);
+    float4x4 jointMatrix0 = LoadJointMatrix(job.jointMatrixBufferAddress, jointID.x);
+    float4x4 jointMatrix1 = LoadJointMatrix(job.jointMatrixBufferAddress, jointID.y);
+    float4x4 jointMatrix2 = LoadJointMatrix(job.jointMatrixBufferAddress, jointID.z);
+    float4x4 jointMatrix3 = LoadJointMatrix(job.jointMatrixBufferAddress, jointID.w);
+    float4 jointWeight = LoadSceneStaticBuffer<float4>(job.jointWeightBufferAddress, vertex_id);
 
-    float3 pos = LoadSceneStaticBuffer<float3>(c_staticPosBufferAddress, vertex_id);
+    float3 pos = LoadSceneStaticBuffer<float3>(job.staticPosBufferAddress, vertex_id);
 
     float4 skinned_pos = mul(jointMatrix0, float4(pos, 1.0)) * jointWeight.x +
         mul(jointMatrix1, float4(pos, 1.0)) * jointWeight.y +
         mul(jointMatrix2, float4(pos, 1.0)) * jointWeight.z +
         mul(jointMatrix3, float4(pos, 1.0)) * jointWeight.w;
 
-    StoreSceneAnimationBuffer<float3>(c_animPosBufferAddress, vertex_id, skinned_pos.xyz);
+    StoreSceneAnimationBuffer<float3>(job.animPosBufferAddress, vertex_id, skinned_pos.xyz);
+
+    if (job.prevJointMatrixBufferAddress != INVALID_ADDRESS)
+    {
+        float4 prev_pos = SkinPosition(job.prevJointMatrixBufferAddress, jointID, jointWeight, pos);
+        StoreSceneAnimationBuffer<float3>(job.prevAnimPosBufferAddress, vertex_id, prev_pos.xyz);
+    }
 
-    if (c_staticNormalBufferAddress != INVALID_ADDRESS)
+    if (job.staticNormalBufferAddress != INVALID_ADDRESS)
     {
-        float3 normal = LoadSceneStaticBuffer<float3>(c_staticNormalBufferAddress, vertex_id);
+        float3 normal = LoadSceneStaticBuffer<float3>(job.staticNormalBufferAddress, vertex_id);
 
         float4 skinned_normal = mul(jointMatrix0, float4(normal, 0.0)) * jointWeight.x +
             mul(jointMatrix1, float4(normal, 0.0)) * jointWeight.y +
             mul(jointMatrix2, float4(normal, 0.0)) * jointWeight.z +
             mul(jointMatrix3, float4(normal, 0.0)) * jointWeight.w;
-        
-        StoreSceneAnimationBuffer<float3>(c_animNormalBufferAddress, vertex_id, skinned_normal.xyz);
+
+        StoreSceneAnimationBuffer<float3>(job.animNormalBufferAddress, vertex_id, skinned_normal.xyz);
     }
 
-    if (c_staticTangentBufferAddress != INVALID_ADDRESS)
+    if (job.staticTangentBufferAddress != INVALID_ADDRESS)
     {
-        float4 tangent = LoadSceneStaticBuffer<float4>(c_staticTangentBufferAddress, vertex_id);
+        float4 tangent = LoadSceneStaticBuffer<float4>(job.staticTangentBufferAddress, vertex_id);
 
         float4 skinned_tangent = mul(jointMatrix0, float4(tangent.xyz, 0.0)) * jointWeight.x +
             mul(jointMatrix1, float4(tangent.xyz, 0.0)) * jointWeight.y +
             mul(jointMatrix2, float4(tangent.xyz, 0.0)) * jointWeight.z +
             mul(jointMatrix3, float4(tangent.xyz, 0.0)) * jointWeight.w;
 
-        StoreSceneAnimationBuffer<float4>(c_animTangentBufferAddress, vertex_id, float4(skinned_tangent.xyz, tangent.w));
+        StoreSceneAnimationBuffer<float4>(job.animTangentBufferAddress, vertex_id, float4(skinned_tangent.xyz, tangent.w));
     }
 }
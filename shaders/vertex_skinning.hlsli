@@ -0,0 +1,28 @@
+#pragma once
+
+static const uint VERTEX_SKINNING_GROUP_SIZE = 64;
+
+//one skinned mesh of the batched skinning pass.
+//the thread groups of all jobs are laid out back to back, firstGroup is the first one of this job
+struct VertexSkinningJob
+{
+    uint firstGroup;
+    uint vertexCount;
+    uint jointIDBufferAddress;
+    uint jointWeightBufferAddress;
+
+    uint staticPosBufferAddress;
+    uint staticNormalBufferAddress;  //INVALID_ADDRESS if the mesh has no normals
+    uint staticTangentBufferAddress; //INVALID_ADDRESS if the mesh has no tangents
+    uint jointMatrixBufferAddress;
+
+    uint animPosBufferAddress;
+    uint animNormalBufferAddress;
+    uint animTangentBufferAddress;
+    uint prevJointMatrixBufferAddress; //INVALID_ADDRESS if the previous positions are not skinned
+
+    uint prevAnimPosBufferAddress;
+    uint _padding0;
+    uint _padding1;
+    uint _padding2;
+};
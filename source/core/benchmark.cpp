@@ -0,0 +1,483 @@
+#include "benchmark.h"
+#include "engine.h"
+#include "utils/profiler.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "enkiTS/TaskScheduler.h"
+#include "EASTL/sort.h"
+#include <fstream>
+
+ScopedCpuEvent::ScopedCpuEvent(const char* group, const char* name)
+{
+    if (Benchmark::GetCurrent() != nullptr)
+    {
+        m_group = group;
+        m_name = name;
+        m_startTime = stm_now();
+    }
+}
+
+ScopedCpuEvent::~ScopedCpuEvent()
+{
+    Benchmark* pBenchmark = Benchmark::GetCurrent();
+    if (m_name != nullptr && pBenchmark != nullptr)
+    {
+        pBenchmark->RecordEvent(m_group, m_name, stm_since(m_startTime));
+    }
+}
+
+bool CameraPath::Load(const eastl::string& file)
+{
+    std::ifstream is(file.c_str());
+    if (is.fail())
+    {
+        return false;
+    }
+
+    m_keys.clear();
+
+    Key key;
+    while (is >> key.position.x >> key.position.y >> key.position.z >> key.rotation.x >> key.rotation.y >> key.rotation.z)
+    {
+        m_keys.push_back(key);
+    }
+
+    return !m_keys.empty();
+}
+
+bool CameraPath::Save(const eastl::string& file) const
+{
+    std::ofstream os(file.c_str());
+    if (os.fail())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_keys.size(); ++i)
+    {
+        const Key& key = m_keys[i];
+        os << key.position.x << " " << key.position.y << " " << key.position.z << " "
+            << key.rotation.x << " " << key.rotation.y << " " << key.rotation.z << "\n";
+    }
+
+    return true;
+}
+
+CameraPath::Key CameraPath::Evaluate(float t) const
+{
+    RE_ASSERT(!m_keys.empty());
+
+    float position = clamp(t, 0.0f, 1.0f) * (m_keys.size() - 1);
+    uint32_t index = eastl::min((uint32_t)position, (uint32_t)m_keys.size() - 1);
+    uint32_t next = eastl::min(index + 1, (uint32_t)m_keys.size() - 1);
+    float frac = position - index;
+
+    const Key& a = m_keys[index];
+    const Key& b = m_keys[next];
+
+    Key key;
+    key.position = lerp(a.position, b.position, frac);
+    key.rotation.x = normalize_angle(a.rotation.x + normalize_angle(b.rotation.x - a.rotation.x) * frac);
+    key.rotation.y = normalize_angle(a.rotation.y + normalize_angle(b.rotation.y - a.rotation.y) * frac);
+    key.rotation.z = normalize_angle(a.rotation.z + normalize_angle(b.rotation.z - a.rotation.z) * frac);
+    return key;
+}
+
+static inline uint32_t WangHash(uint32_t x)
+{
+    x = (x ^ 61) ^ (x >> 16);
+    x *= 9;
+    x = x ^ (x >> 4);
+    x *= 0x27d4eb2d;
+    x = x ^ (x >> 15);
+    return x;
+}
+
+static inline float HashToFloat(uint32_t hash)
+{
+    return float(hash & 0xFFFF) / 65535.0f;
+}
+
+Benchmark::Benchmark(const BenchmarkSettings& settings) : m_settings(settings)
+{
+}
+
+Benchmark::~Benchmark()
+{
+    if (s_pCurrent == this)
+    {
+        s_pCurrent = nullptr;
+    }
+}
+
+eastl::string Benchmark::CreateStressScene(const eastl::string& work_path) const
+{
+    if (m_settings.stress_meshes == 0 && m_settings.stress_lights == 0 && m_settings.stress_bodies == 0 && m_settings.stress_characters == 0)
+    {
+        return "";
+    }
+
+    eastl::string file = work_path + "benchmark_stress.xml";
+
+    std::ofstream os(file.c_str());
+    if (os.fail())
+    {
+        RE_ERROR("[Benchmark] failed to create {}", file);
+        return "";
+    }
+
+    //everything is laid out on a square grid centered at the origin, the camera looks down at it
+    const float spacing = 2.0f;
+    uint32_t grid_size = (uint32_t)ceilf(sqrtf((float)eastl::max(eastl::max(m_settings.stress_meshes, m_settings.stress_lights), m_settings.stress_characters)));
+    float extent = grid_size * spacing * 0.5f;
+
+    os << "<scene>\n";
+    os << "    <skysphere />\n";
+    os << "    <camera position=\"0.0," << extent << "," << -extent * 1.5f << "\" rotation=\"30.0,0.0,0.0\" fov=\"60.0\" znear=\"0.01\" zfar=\"1000.0\"/>\n";
+    os << "    <light type=\"directional\" primary=\"true\" rotation=\"-45.000,45.000,0.000\" intensity=\"1.0\"/>\n";
+
+    for (uint32_t i = 0; i < m_settings.stress_meshes; ++i)
+    {
+        float x = (i % grid_size) * spacing - extent;
+        float z = (i / grid_size) * spacing - extent;
+
+        os << "    <model file=\"model/box.gltf\" position=\"" << x << ",0.0," << z << "\" scale=\"0.5,0.5,0.5\"/>\n";
+    }
+
+    for (uint32_t i = 0; i < m_settings.stress_characters; ++i)
+    {
+        float x = (i % grid_size) * spacing - extent;
+        float z = (i / grid_size) * spacing - extent;
+
+        os << "    <model file=\"model/biped_robot/scene.gltf\" position=\"" << x << ",0.0," << z << "\" scale=\"0.01,0.01,0.01\"/>\n";
+    }
+
+    for (uint32_t i = 0; i < m_settings.stress_lights; ++i)
+    {
+        uint32_t hash = WangHash(i);
+        float x = (i % grid_size) * spacing - extent;
+        float z = (i / grid_size) * spacing - extent;
+        float y = 1.0f + HashToFloat(hash) * 2.0f;
+
+        os << "    <light type=\"point\" position=\"" << x << "," << y << "," << z << "\""
+            << " color=\"" << HashToFloat(hash >> 4) << "," << HashToFloat(hash >> 8) << "," << HashToFloat(hash >> 12) << "\""
+            << " intensity=\"10.0\" radius=\"" << spacing * 2.0f << "\" falloff=\"1.0\"/>\n";
+    }
+
+    os << "</scene>\n";
+
+    return file;
+}
+
+bool Benchmark::Run()
+{
+    Engine* pEngine = Engine::GetInstance();
+    pEngine->SetFixedFrameDeltaTime(m_settings.frame_delta_time);
+
+    if (m_settings.stress_bodies > 0)
+    {
+        SpawnStressRigidBodies();
+    }
+
+    if (!m_settings.camera_path.empty() && !m_cameraPath.Load(m_settings.camera_path))
+    {
+        RE_WARN("[Benchmark] failed to load the camera path : {}", m_settings.camera_path);
+    }
+
+    RE_INFO("[Benchmark] running {} frames ({} warmup frames)", m_settings.frame_count, m_settings.warmup_frames);
+
+    m_threadEvents.clear();
+    for (uint32_t i = 0; i < pEngine->GetTaskScheduler()->GetNumTaskThreads(); ++i)
+    {
+        m_threadEvents.push_back(eastl::make_unique<ThreadEvents>());
+    }
+
+    s_pCurrent = this;
+
+    for (uint32_t i = 0; i < m_settings.warmup_frames + m_settings.frame_count; ++i)
+    {
+        m_bRecording = i >= m_settings.warmup_frames;
+
+        UpdateCamera(i >= m_settings.warmup_frames ? i - m_settings.warmup_frames : 0);
+
+        uint64_t start = stm_now();
+        pEngine->Tick();
+        EndFrame(stm_since(start));
+    }
+
+    s_pCurrent = nullptr;
+    m_bRecording = false;
+    pEngine->SetFixedFrameDeltaTime(0.0f);
+
+    CalcResults();
+    PrintResults();
+
+    if (!m_settings.output.empty() && !SaveResults(m_settings.output))
+    {
+        RE_ERROR("[Benchmark] failed to write the results : {}", m_settings.output);
+    }
+
+    if (!m_settings.baseline.empty())
+    {
+        return CompareBaseline(m_settings.baseline);
+    }
+
+    return true;
+}
+
+void Benchmark::RecordEvent(const char* group, const char* name, uint64_t ticks)
+{
+    if (!m_bRecording)
+    {
+        return;
+    }
+
+    ThreadEvents* thread_events = m_threadEvents[Engine::GetInstance()->GetTaskScheduler()->GetThreadNum()].get();
+    std::lock_guard<std::mutex> lock(thread_events->mutex);
+
+    ThreadEvent& event = thread_events->events[name];
+    event.group = group;
+    event.name = name;
+    event.ticks += ticks;
+}
+
+void Benchmark::SpawnStressRigidBodies()
+{
+    World* pWorld = Engine::GetInstance()->GetWorld();
+
+    //stacked in columns with random velocities so that the bodies keep colliding with each other
+    uint32_t grid_size = (uint32_t)ceilf(sqrtf((float)m_settings.stress_bodies));
+    const float spacing = 1.0f;
+
+    for (uint32_t i = 0; i < m_settings.stress_bodies; ++i)
+    {
+        uint32_t hash = WangHash(i + 0x9e3779b9);
+
+        float3 position;
+        position.x = (i % grid_size) * spacing - grid_size * spacing * 0.5f;
+        position.y = 5.0f + HashToFloat(hash) * 10.0f;
+        position.z = ((i / grid_size) % grid_size) * spacing - grid_size * spacing * 0.5f;
+
+        float3 velocity = float3(HashToFloat(hash >> 4), HashToFloat(hash >> 8), HashToFloat(hash >> 12)) * 2.0f - 1.0f;
+
+        pWorld->SpawnRigidBody(i % 2 == 0, position, velocity);
+    }
+}
+
+void Benchmark::UpdateCamera(uint32_t frame)
+{
+    if (m_cameraPath.IsEmpty())
+    {
+        return;
+    }
+
+    float t = m_settings.frame_count > 1 ? (float)frame / (m_settings.frame_count - 1) : 0.0f;
+    CameraPath::Key key = m_cameraPath.Evaluate(t);
+
+    Camera* pCamera = Engine::GetInstance()->GetWorld()->GetCamera();
+    pCamera->SetPosition(key.position);
+    pCamera->SetRotation(key.rotation);
+}
+
+void Benchmark::EndFrame(uint64_t frame_ticks)
+{
+    if (!m_bRecording)
+    {
+        return;
+    }
+
+    //the same name in several files may have several addresses, they are merged here.
+    //the entries are kept for the next frames, so the task threads don't allocate once every event was seen
+    for (size_t i = 0; i < m_threadEvents.size(); ++i)
+    {
+        std::lock_guard<std::mutex> lock(m_threadEvents[i]->mutex);
+
+        eastl::hash_map<const void*, ThreadEvent>& thread_events = m_threadEvents[i]->events;
+        for (auto iter = thread_events.begin(); iter != thread_events.end(); ++iter)
+        {
+            if (iter->second.ticks > 0)
+            {
+                EventSamples& event = m_events[iter->second.name];
+                event.group = iter->second.group;
+                event.frame_ticks += iter->second.ticks;
+                iter->second.ticks = 0;
+            }
+        }
+    }
+
+    for (auto iter = m_events.begin(); iter != m_events.end(); ++iter)
+    {
+        EventSamples& event = iter->second;
+        if (event.frame_ticks > 0)
+        {
+            event.samples.push_back((float)stm_ms(event.frame_ticks));
+            event.frame_ticks = 0;
+        }
+    }
+
+    m_frameTimes.push_back((float)stm_ms(frame_ticks));
+}
+
+static BenchmarkEventStats CalcEventStats(const eastl::string& group, const eastl::string& name, eastl::vector<float> samples)
+{
+    BenchmarkEventStats stats;
+    stats.group = group;
+    stats.name = name;
+    stats.samples = (uint32_t)samples.size();
+
+    if (samples.empty())
+    {
+        return stats;
+    }
+
+    eastl::sort(samples.begin(), samples.end());
+
+    auto percentile = [&](float p)
+    {
+        size_t index = (size_t)(p * (samples.size() - 1) + 0.5f);
+        return samples[eastl::min(index, samples.size() - 1)];
+    };
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        sum += samples[i];
+    }
+
+    stats.mean = sum / samples.size();
+    stats.p50 = percentile(0.5f);
+    stats.p90 = percentile(0.9f);
+    stats.p99 = percentile(0.99f);
+    stats.max = samples.back();
+
+    return stats;
+}
+
+void Benchmark::CalcResults()
+{
+    m_results.clear();
+    m_results.push_back(CalcEventStats("Frame", "Frame", m_frameTimes));
+
+    for (auto iter = m_events.begin(); iter != m_events.end(); ++iter)
+    {
+        m_results.push_back(CalcEventStats(iter->second.group, iter->first, iter->second.samples));
+    }
+
+    //hash_map has no stable order, sort to make the outputs diffable
+    eastl::sort(m_results.begin() + 1, m_results.end(), [](const BenchmarkEventStats& a, const BenchmarkEventStats& b)
+        {
+            return a.group != b.group ? a.group < b.group : a.name < b.name;
+        });
+}
+
+void Benchmark::PrintResults() const
+{
+    RE_INFO("[Benchmark] {:<10} {:<32} {:>8} {:>8} {:>8} {:>8} {:>8}", "group", "event", "mean", "p50", "p90", "p99", "max");
+
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const BenchmarkEventStats& stats = m_results[i];
+        RE_INFO("[Benchmark] {:<10} {:<32} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f} {:>8.3f}",
+            stats.group, stats.name, stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+    }
+}
+
+bool Benchmark::SaveResults(const eastl::string& file) const
+{
+    std::ofstream os(file.c_str());
+    if (os.fail())
+    {
+        return false;
+    }
+
+    os << "group,event,samples,mean,p50,p90,p99,max\n";
+
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const BenchmarkEventStats& stats = m_results[i];
+        os << stats.group.c_str() << "," << stats.name.c_str() << "," << stats.samples << ","
+            << stats.mean << "," << stats.p50 << "," << stats.p90 << "," << stats.p99 << "," << stats.max << "\n";
+    }
+
+    return true;
+}
+
+bool Benchmark::CompareBaseline(const eastl::string& file) const
+{
+    std::ifstream is(file.c_str());
+    if (is.fail())
+    {
+        RE_ERROR("[Benchmark] failed to load the baseline : {}", file);
+        return false;
+    }
+
+    eastl::hash_map<eastl::string, BenchmarkEventStats> baseline;
+
+    std::string line;
+    std::getline(is, line); //header
+
+    while (std::getline(is, line))
+    {
+        eastl::vector<eastl::string> columns;
+
+        size_t start = 0;
+        while (start <= line.size())
+        {
+            size_t end = line.find(',', start);
+            if (end == std::string::npos)
+            {
+                end = line.size();
+            }
+
+            columns.push_back(line.substr(start, end - start).c_str());
+            start = end + 1;
+        }
+
+        if (columns.size() != 8)
+        {
+            continue;
+        }
+
+        BenchmarkEventStats stats;
+        stats.group = columns[0];
+        stats.name = columns[1];
+        stats.samples = (uint32_t)atoi(columns[2].c_str());
+        stats.mean = (float)atof(columns[3].c_str());
+        stats.p50 = (float)atof(columns[4].c_str());
+        stats.p90 = (float)atof(columns[5].c_str());
+        stats.p99 = (float)atof(columns[6].c_str());
+        stats.max = (float)atof(columns[7].c_str());
+
+        baseline[stats.name] = stats;
+    }
+
+    bool passed = true;
+
+    auto IsRegressed = [&](float current, float reference)
+    {
+        return current - reference > m_settings.regression_min_delta &&
+            current > reference * (1.0f + m_settings.regression_threshold);
+    };
+
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const BenchmarkEventStats& stats = m_results[i];
+
+        auto iter = baseline.find(stats.name);
+        if (iter == baseline.end())
+        {
+            continue;
+        }
+
+        const BenchmarkEventStats& reference = iter->second;
+
+        if (IsRegressed(stats.p50, reference.p50) || IsRegressed(stats.p90, reference.p90))
+        {
+            RE_ERROR("[Benchmark] {} regressed : p50 {:.3f} -> {:.3f} ms, p90 {:.3f} -> {:.3f} ms",
+                stats.name, reference.p50, stats.p50, reference.p90, stats.p90);
+            passed = false;
+        }
+    }
+
+    return passed;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "utils/math.h"
+#include "EASTL/string.h"
+#include "EASTL/vector.h"
+#include "EASTL/hash_map.h"
+#include "EASTL/atomic.h"
+#include "EASTL/unique_ptr.h"
+#include <mutex>
+
+struct BenchmarkSettings
+{
+    uint32_t frame_count = 500;
+    uint32_t warmup_frames = 30; //not included in the results
+    float frame_delta_time = 1.0f / 60.0f;
+
+    eastl::string camera_path; //recorded with CameraPathRecorder, the camera stays still if empty
+    eastl::string output;      //csv of the results
+    eastl::string baseline;    //csv of a previous run to compare against
+
+    float regression_threshold = 0.1f; //relative to the baseline
+    float regression_min_delta = 0.05f; //in ms, smaller changes are considered as noise
+
+    //synthetic stress scene, replaces the scene if any of them is not 0
+    uint32_t stress_meshes = 0;
+    uint32_t stress_lights = 0;
+    uint32_t stress_bodies = 0;
+    uint32_t stress_characters = 0; //skinned and animated
+};
+
+struct BenchmarkEventStats
+{
+    eastl::string group;
+    eastl::string name;
+    uint32_t samples = 0;
+    float mean = 0.0f; //all in ms
+    float p50 = 0.0f;
+    float p90 = 0.0f;
+    float p99 = 0.0f;
+    float max = 0.0f;
+};
+
+class CameraPath
+{
+public:
+    struct Key
+    {
+        float3 position;
+        float3 rotation; //in degrees
+    };
+
+    bool Load(const eastl::string& file);
+    bool Save(const eastl::string& file) const;
+
+    void AddKey(const float3& position, const float3& rotation) { m_keys.push_back({ position, rotation }); }
+    bool IsEmpty() const { return m_keys.empty(); }
+    void Clear() { m_keys.clear(); }
+
+    //t in [0, 1], covers the whole path
+    Key Evaluate(float t) const;
+
+private:
+    eastl::vector<Key> m_keys;
+};
+
+class Benchmark
+{
+public:
+    Benchmark(const BenchmarkSettings& settings);
+    ~Benchmark();
+
+    static Benchmark* GetCurrent() { return s_pCurrent; }
+
+    //generates the stress scene if requested, should be called before Engine::Init
+    eastl::string CreateStressScene(const eastl::string& work_path) const;
+
+    //runs the frames and writes the results, returns false if any event regressed against the baseline
+    bool Run();
+
+    const eastl::vector<BenchmarkEventStats>& GetResults() const { return m_results; }
+
+    //group and name should be string literals, the events are keyed by their address until the end of the frame
+    void RecordEvent(const char* group, const char* name, uint64_t ticks);
+
+private:
+    void SpawnStressRigidBodies();
+    void UpdateCamera(uint32_t frame);
+    void EndFrame(uint64_t frame_ticks);
+    void CalcResults();
+    void PrintResults() const;
+    bool SaveResults(const eastl::string& file) const;
+    bool CompareBaseline(const eastl::string& file) const;
+
+private:
+    static inline Benchmark* s_pCurrent = nullptr;
+
+    BenchmarkSettings m_settings;
+    CameraPath m_cameraPath;
+    eastl::atomic<bool> m_bRecording{ false };
+
+    struct EventSamples
+    {
+        eastl::string group;
+        uint64_t frame_ticks = 0;
+        eastl::vector<float> samples;
+    };
+
+    struct ThreadEvent
+    {
+        const char* group = nullptr;
+        const char* name = nullptr;
+        uint64_t ticks = 0;
+    };
+
+    //the events recorded by each task thread, merged into m_events at the end of the frame.
+    //the lock is only contended then, by the tasks which outlive a frame
+    struct ThreadEvents
+    {
+        std::mutex mutex;
+        eastl::hash_map<const void*, ThreadEvent> events; //by name address
+    };
+
+    eastl::vector<eastl::unique_ptr<ThreadEvents>> m_threadEvents;
+    eastl::hash_map<eastl::string, EventSamples> m_events;
+    eastl::vector<float> m_frameTimes;
+
+    eastl::vector<BenchmarkEventStats> m_results;
+};
+
+//records the camera of the editor, the output can be replayed with BenchmarkSettings::camera_path
+class CameraPathRecorder
+{
+public:
+    void Begin() { m_path.Clear(); m_bRecording = true; }
+    void End(const eastl::string& file) { m_path.Save(file); m_bRecording = false; }
+    bool IsRecording() const { return m_bRecording; }
+
+    void Tick(const float3& position, const float3& rotation)
+    {
+        if (m_bRecording)
+        {
+            m_path.AddKey(position, rotation);
+        }
+    }
+
+private:
+    CameraPath m_path;
+    bool m_bRecording = false;
+};
@@ -2,6 +2,7 @@
 #include "utils/log.h"
 #include "utils/profiler.h"
 #include "utils/system.h"
+#include "renderer/async_texture_loader.h"
 #include "enkiTS/TaskScheduler.h"
 #include "rpmalloc/rpmalloc.h"
 #include "rpmalloc/rpnew.h"
@@ -13,6 +14,7 @@
 #include "sokol/sokol_time.h"
 #include "imgui/imgui.h"
 #include "simpleini/SimpleIni.h"
+#include <filesystem>
 
 Engine* Engine::GetInstance()
 {
@@ -27,6 +29,9 @@ Engine::~Engine()
 
 void Engine::Init(const eastl::string& work_path, void* window_handle, uint32_t window_width, uint32_t window_height)
 {
+    stm_setup();
+    m_startupTime = stm_now();
+
 #if RE_PLATFORM_WINDOWS
     auto console_sink = std::make_shared<spdlog::sinks::msvc_sink_mt>();
 #else
@@ -82,10 +87,14 @@ void Engine::Init(const eastl::string& work_path, void* window_handle, uint32_t
     GfxRenderBackend renderBackend = magic_enum::enum_cast<GfxRenderBackend>(backend).
 #if RE_PLATFORM_WINDOWS
         value_or(GfxRenderBackend::D3D12);
+#elif RE_PLATFORM_LINUX
+        value_or(GfxRenderBackend::Mock);
 #else
         value_or(GfxRenderBackend::Metal);
 #endif
 
+    uint64_t ticks = stm_now();
+
     m_pRenderer = eastl::make_unique<Renderer>();
     m_pRenderer->SetAsyncComputeEnabled(configIni.GetBoolValue("Render", "AsyncCompute"));
     if (!m_pRenderer->CreateDevice(renderBackend, window_handle, window_width, window_height))
@@ -93,12 +102,21 @@ void Engine::Init(const eastl::string& work_path, void* window_handle, uint32_t
         exit(0);
     }
 
+    double renderer_time = stm_ms(stm_laptime(&ticks));
+
     m_pWorld = eastl::make_unique<World>();
-    m_pWorld->LoadScene(m_assetPath + configIni.GetValue("World", "Scene"));
+    if (m_sceneFile.empty())
+    {
+        m_sceneFile = configIni.GetValue("World", "Scene");
+    }
+    m_pWorld->LoadScene(std::filesystem::path(m_sceneFile.c_str()).is_absolute() ? m_sceneFile : m_assetPath + m_sceneFile);
+
+    double scene_time = stm_ms(stm_laptime(&ticks));
 
     m_pEditor = eastl::make_unique<Editor>(m_pRenderer.get());
 
-    stm_setup();
+    RE_INFO("[Engine] startup {:.1f} ms : renderer {:.1f} ms, scene {:.1f} ms, editor {:.1f} ms",
+        stm_ms(stm_since(m_startupTime)), renderer_time, scene_time, stm_ms(stm_since(ticks)));
 }
 
 void Engine::Shut()
@@ -107,6 +125,9 @@ void Engine::Shut()
 
     m_pWorld.reset();
     m_pEditor.reset();
+
+    //the renderer outlives the task scheduler, its texture loads in flight are waited for before
+    m_pRenderer->GetAsyncTextureLoader()->Reset();
     m_pTaskScheduler.reset();
 
     m_pRenderer.reset();
@@ -119,6 +140,10 @@ void Engine::Tick()
     CPU_EVENT("Tick", "Engine::Tick");
 
     m_frameTime = (float)stm_sec(stm_laptime(&m_lastFrameTime));
+    if (m_fixedFrameTime > 0.0f)
+    {
+        m_frameTime = m_fixedFrameTime;
+    }
 
     m_pEditor->NewFrame();
 
@@ -137,5 +162,11 @@ void Engine::Tick()
         m_pRenderer->RenderFrame();
     }
 
+    if (m_startupTime != 0)
+    {
+        RE_INFO("[Engine] first frame after {:.1f} ms", stm_ms(stm_since(m_startupTime)));
+        m_startupTime = 0;
+    }
+
     FrameMark;
 }
@@ -28,6 +28,12 @@ public:
 
     float GetFrameDeltaTime() const { return m_frameTime; }
 
+    //a fixed delta time makes the simulation deterministic, 0 means using the real frame time
+    void SetFixedFrameDeltaTime(float time) { m_fixedFrameTime = time; }
+
+    //overrides the scene in RealEngine.ini, should be called before Init. relative paths are relative to the asset path
+    void SetSceneFile(const eastl::string& file) { m_sceneFile = file; }
+
 public:
     sigslot::signal<void*, uint32_t, uint32_t> WindowResizeSignal;
 
@@ -41,11 +47,14 @@ private:
 
     eastl::unique_ptr<class enki::TaskScheduler> m_pTaskScheduler;
     
+    uint64_t m_startupTime = 0; //reset once the first frame is rendered
     uint64_t m_lastFrameTime = 0;
     float m_frameTime = 0.0f; //in seconds
+    float m_fixedFrameTime = 0.0f;
 
     void* m_windowHandle = nullptr;
     eastl::string m_workPath;
     eastl::string m_assetPath;
     eastl::string m_shaderPath;
+    eastl::string m_sceneFile;
 };
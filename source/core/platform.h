@@ -4,6 +4,10 @@
     #define RE_PLATFORM_WINDOWS 1
 #endif
 
+#ifdef __linux__
+    #define RE_PLATFORM_LINUX 1
+#endif
+
 #ifdef __APPLE__
     #include <TargetConditionals.h>
     
@@ -3,6 +3,8 @@
 #include "im3d_impl.h"
 #include "core/engine.h"
 #include "renderer/texture_loader.h"
+#include "world/resource_cache.h"
+#include "world/animation_system.h"
 #include "utils/assert.h"
 #include "utils/system.h"
 #include "imgui/imgui.h"
@@ -76,11 +78,16 @@ void Editor::Tick()
     DrawGizmo();
     DrawFrameStats();
 
+    Camera* camera = Engine::GetInstance()->GetWorld()->GetCamera();
+    m_cameraPathRecorder.Tick(camera->GetPosition(), camera->GetRotation());
+
     if (m_bShowRenderer)
     {
         ImGui::Begin("Renderer", &m_bShowRenderer);
         
         m_pRenderer->OnGui();
+        ResourceCache::GetInstance()->OnGui();
+        Engine::GetInstance()->GetWorld()->GetAnimationSystem()->OnGui();
 
         ImGui::End();
     }
@@ -204,6 +211,19 @@ void Editor::DrawMenu()
                 ShowRenderGraph();
             }
 
+            bool recording = m_cameraPathRecorder.IsRecording();
+            if (ImGui::MenuItem("Record Camera Path", "", &recording))
+            {
+                if (recording)
+                {
+                    m_cameraPathRecorder.Begin();
+                }
+                else
+                {
+                    m_cameraPathRecorder.End(Engine::GetInstance()->GetWorkPath() + "camera_path.txt");
+                }
+            }
+
             ImGui::MenuItem("Imgui Demo", "", &m_bShowImguiDemo);
 
             ImGui::EndMenu();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "renderer/renderer.h"
+#include "core/benchmark.h"
 #include "EASTL/hash_map.h"
 #include "EASTL/functional.h"
 
@@ -48,6 +49,8 @@ private:
 
     eastl::unique_ptr<Texture2D> m_pGpuMemoryStats;
 
+    CameraPathRecorder m_cameraPathRecorder;
+
     enum class SelectEditMode
     {
         Translate,
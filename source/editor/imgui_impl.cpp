@@ -92,16 +92,20 @@ bool ImGuiImpl::Init()
 
 void ImGuiImpl::NewFrame()
 {
+    ImGuiIO& io = ImGui::GetIO();
+
 #if RE_PLATFORM_WINDOWS
     ImGui_ImplWin32_NewFrame();
 #elif RE_PLATFORM_MAC
     ImGui_ImplOSX_NewFrame(Engine::GetInstance()->GetWindowHandle());
+#else
+    //headless, there is no platform backend to feed the display size and delta time
+    io.DisplaySize = ImVec2((float)m_pRenderer->GetDisplayWidth(), (float)m_pRenderer->GetDisplayHeight());
+    io.DeltaTime = eastl::max(Engine::GetInstance()->GetFrameDeltaTime(), 0.0001f);
 #endif
     ImGui::NewFrame();
 
     ImGuizmo::BeginFrame();
-
-    ImGuiIO& io = ImGui::GetIO();
     ImGuizmo::SetRect(0, 0, io.DisplaySize.x, io.DisplaySize.y);
 }
 
@@ -734,11 +734,18 @@ void D3D12CommandList::MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer*
     ++m_commandCount;
 }
 
-void D3D12CommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas)
+void D3D12CommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
 {
     FlushBarriers();
 
-    m_pCommandList->BuildRaytracingAccelerationStructure(((D3D12RayTracingBLAS*)blas)->GetBuildDesc(), 0, nullptr);
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = *((D3D12RayTracingBLAS*)blas)->GetBuildDesc();
+    if (scratch_buffer)
+    {
+        desc.ScratchAccelerationStructureData = scratch_buffer->GetGpuAddress() + scratch_offset;
+    }
+    RE_ASSERT(desc.ScratchAccelerationStructureData != 0);
+
+    m_pCommandList->BuildRaytracingAccelerationStructure(&desc, 0, nullptr);
     ++m_commandCount;
 }
 
@@ -746,20 +753,69 @@ void D3D12CommandList::UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer
 {
     FlushBarriers();
 
-    D3D12_RAYTRACING_GEOMETRY_DESC geometry;
+    eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometries;
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc;
+    ((D3D12RayTracingBLAS*)blas)->GetUpdateDesc(desc, geometries, vertex_buffer, vertex_buffer_offset);
+
+    m_pCommandList->BuildRaytracingAccelerationStructure(&desc, 0, nullptr);
+    ++m_commandCount;
+}
+
+void D3D12CommandList::RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
+{
+    FlushBarriers();
+
+    eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometries;
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc;
-    ((D3D12RayTracingBLAS*)blas)->GetUpdateDesc(desc, geometry, vertex_buffer, vertex_buffer_offset);
+    ((D3D12RayTracingBLAS*)blas)->GetUpdateDesc(desc, geometries, vertex_buffer, vertex_buffer_offset);
+
+    desc.Inputs.Flags &= ~D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+    desc.SourceAccelerationStructureData = 0;
+    desc.ScratchAccelerationStructureData = scratch_buffer->GetGpuAddress() + scratch_offset;
 
     m_pCommandList->BuildRaytracingAccelerationStructure(&desc, 0, nullptr);
     ++m_commandCount;
 }
 
+void D3D12CommandList::WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset)
+{
+    FlushBarriers();
+
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_DESC desc;
+    desc.DestBuffer = buffer->GetGpuAddress() + offset;
+    desc.InfoType = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_POSTBUILD_INFO_COMPACTED_SIZE;
+
+    D3D12_GPU_VIRTUAL_ADDRESS address = ((D3D12RayTracingBLAS*)blas)->GetGpuAddress();
+    m_pCommandList->EmitRaytracingAccelerationStructurePostbuildInfo(&desc, 1, &address);
+    ++m_commandCount;
+}
+
+void D3D12CommandList::CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src)
+{
+    FlushBarriers();
+
+    m_pCommandList->CopyRaytracingAccelerationStructure(((D3D12RayTracingBLAS*)dst)->GetGpuAddress(), ((D3D12RayTracingBLAS*)src)->GetGpuAddress(),
+        D3D12_RAYTRACING_ACCELERATION_STRUCTURE_COPY_MODE_COMPACT);
+    ++m_commandCount;
+}
+
 void D3D12CommandList::BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
 {
     FlushBarriers();
 
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = {};
-    ((D3D12RayTracingTLAS*)tlas)->GetBuildDesc(desc, instances, instance_count);
+    ((D3D12RayTracingTLAS*)tlas)->GetBuildDesc(desc, instances, instance_count, false);
+
+    m_pCommandList->BuildRaytracingAccelerationStructure(&desc, 0, nullptr);
+    ++m_commandCount;
+}
+
+void D3D12CommandList::UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
+{
+    FlushBarriers();
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = {};
+    ((D3D12RayTracingTLAS*)tlas)->GetBuildDesc(desc, instances, instance_count, true);
 
     m_pCommandList->BuildRaytracingAccelerationStructure(&desc, 0, nullptr);
     ++m_commandCount;
@@ -317,6 +317,11 @@ uint32_t D3D12Device::GetAllocationSize(const GfxTextureDesc& desc)
     return (uint32_t)info.SizeInBytes;
 }
 
+GfxRayTracingBLASSizes D3D12Device::GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc)
+{
+    return D3D12RayTracingBLAS::GetSizes(this, desc);
+}
+
 bool D3D12Device::DumpMemoryStats(const eastl::string& file)
 {
     FILE* f = nullptr;
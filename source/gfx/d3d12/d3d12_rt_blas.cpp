@@ -19,78 +19,140 @@ D3D12RayTracingBLAS::~D3D12RayTracingBLAS()
     pDevice->Delete(m_pScratchAllocation);
 }
 
+static D3D12_RAYTRACING_GEOMETRY_DESC GetGeometryDesc(const GfxRayTracingGeometry& geometry)
+{
+    D3D12_RAYTRACING_GEOMETRY_DESC d3d12_geometry = {};
+    d3d12_geometry.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES; //todo : support AABB
+    d3d12_geometry.Flags = geometry.opaque ? D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE : D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
+    d3d12_geometry.Triangles.IndexFormat = dxgi_format(geometry.index_format);
+    d3d12_geometry.Triangles.VertexFormat = dxgi_format(geometry.vertex_format);
+    d3d12_geometry.Triangles.IndexCount = geometry.index_count;
+    d3d12_geometry.Triangles.VertexCount = geometry.vertex_count;
+    d3d12_geometry.Triangles.IndexBuffer = geometry.index_buffer->GetGpuAddress() + geometry.index_buffer_offset;
+    d3d12_geometry.Triangles.VertexBuffer.StartAddress = geometry.vertex_buffer->GetGpuAddress() + geometry.vertex_buffer_offset;
+    d3d12_geometry.Triangles.VertexBuffer.StrideInBytes = geometry.vertex_stride;
+
+    return d3d12_geometry;
+}
+
+static D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS GetBuildInputs(const GfxRayTracingBLASDesc& desc, const eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& geometries)
+{
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS buildInput;
+    buildInput.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
+    buildInput.Flags = d3d12_rt_as_flags(desc.flags);
+    buildInput.NumDescs = (UINT)geometries.size();
+    buildInput.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
+    buildInput.pGeometryDescs = geometries.data();
+
+    return buildInput;
+}
+
+void* D3D12RayTracingBLAS::GetHandle() const
+{
+    return m_desc.storage_buffer ? m_desc.storage_buffer->GetHandle() : m_pASBuffer;
+}
+
 bool D3D12RayTracingBLAS::Create()
 {
     m_geometries.reserve(m_desc.geometries.size());
 
     for (size_t i = 0; i < m_desc.geometries.size(); ++i)
     {
-        const GfxRayTracingGeometry& geometry = m_desc.geometries[i];
-
-        D3D12_RAYTRACING_GEOMETRY_DESC d3d12_geometry = {};
-        d3d12_geometry.Type = D3D12_RAYTRACING_GEOMETRY_TYPE_TRIANGLES; //todo : support AABB
-        d3d12_geometry.Flags = geometry.opaque ? D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE : D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
-        d3d12_geometry.Triangles.IndexFormat = dxgi_format(geometry.index_format);
-        d3d12_geometry.Triangles.VertexFormat = dxgi_format(geometry.vertex_format);
-        d3d12_geometry.Triangles.IndexCount = geometry.index_count;
-        d3d12_geometry.Triangles.VertexCount = geometry.vertex_count;
-        d3d12_geometry.Triangles.IndexBuffer = geometry.index_buffer->GetGpuAddress() + geometry.index_buffer_offset;
-        d3d12_geometry.Triangles.VertexBuffer.StartAddress = geometry.vertex_buffer->GetGpuAddress() + geometry.vertex_buffer_offset;
-        d3d12_geometry.Triangles.VertexBuffer.StrideInBytes = geometry.vertex_stride;
-
-        m_geometries.push_back(d3d12_geometry);
+        m_geometries.push_back(GetGeometryDesc(m_desc.geometries[i]));
     }
 
     ID3D12Device5* device = (ID3D12Device5*)m_pDevice->GetHandle();
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS buildInput;
-    buildInput.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-    buildInput.Flags = d3d12_rt_as_flags(m_desc.flags);
-    buildInput.NumDescs = (UINT)m_geometries.size();
-    buildInput.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    buildInput.pGeometryDescs = m_geometries.data();
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS buildInput = GetBuildInputs(m_desc, m_geometries);
 
     D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
     device->GetRaytracingAccelerationStructurePrebuildInfo(&buildInput, &info);
 
-    //todo : better memory allocation and compaction like what RTXMU does
+    uint64_t as_size = m_desc.storage_size != 0 ? m_desc.storage_size : info.ResultDataMaxSizeInBytes;
+
+    //placed blases are built with an external scratch buffer, only the update scratch memory is kept
+    uint64_t scratch_size = m_desc.storage_buffer ?
+        ((m_desc.flags & GfxRayTracingASFlagAllowUpdate) ? info.UpdateScratchDataSizeInBytes : 0) :
+        eastl::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes);
+
     D3D12MA::Allocator* pAllocator = ((D3D12Device*)m_pDevice)->GetResourceAllocator();
     D3D12MA::ALLOCATION_DESC allocationDesc = {};
     allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
 
-    CD3DX12_RESOURCE_DESC asBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(info.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    CD3DX12_RESOURCE_DESC scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(eastl::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    pAllocator->CreateResource(&allocationDesc, &asBufferDesc, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nullptr, &m_pASAllocation, IID_PPV_ARGS(&m_pASBuffer));
-    pAllocator->CreateResource(&allocationDesc, &scratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, &m_pScratchAllocation, IID_PPV_ARGS(&m_pScratchBuffer));
+    D3D12_GPU_VIRTUAL_ADDRESS as_address;
+    if (m_desc.storage_buffer)
+    {
+        RE_ASSERT(m_desc.storage_buffer->GetDesc().usage & GfxBufferUsageAccelerationStructure);
+        RE_ASSERT(m_desc.storage_offset % GFX_RT_AS_ALIGNMENT == 0);
+        RE_ASSERT(m_desc.storage_offset + as_size <= m_desc.storage_buffer->GetDesc().size);
 
-    m_pASBuffer->SetName(string_to_wstring(m_name).c_str());
-    m_pASAllocation->SetName(string_to_wstring(m_name).c_str());
+        as_address = m_desc.storage_buffer->GetGpuAddress() + m_desc.storage_offset;
+    }
+    else
+    {
+        CD3DX12_RESOURCE_DESC asBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(as_size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        pAllocator->CreateResource(&allocationDesc, &asBufferDesc, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nullptr, &m_pASAllocation, IID_PPV_ARGS(&m_pASBuffer));
+
+        m_pASBuffer->SetName(string_to_wstring(m_name).c_str());
+        m_pASAllocation->SetName(string_to_wstring(m_name).c_str());
+
+        as_address = m_pASBuffer->GetGPUVirtualAddress();
+    }
+
+    if (scratch_size > 0)
+    {
+        CD3DX12_RESOURCE_DESC scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(scratch_size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        pAllocator->CreateResource(&allocationDesc, &scratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, &m_pScratchAllocation, IID_PPV_ARGS(&m_pScratchBuffer));
+    }
 
     m_buildDesc.Inputs = buildInput;
-    m_buildDesc.DestAccelerationStructureData = m_pASBuffer->GetGPUVirtualAddress();
-    m_buildDesc.ScratchAccelerationStructureData = m_pScratchBuffer->GetGPUVirtualAddress();
+    m_buildDesc.DestAccelerationStructureData = as_address;
+    m_buildDesc.ScratchAccelerationStructureData = m_pScratchBuffer ? m_pScratchBuffer->GetGPUVirtualAddress() : 0;
     m_buildDesc.SourceAccelerationStructureData = 0;
 
     return true;
 }
 
-void D3D12RayTracingBLAS::GetUpdateDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& desc, D3D12_RAYTRACING_GEOMETRY_DESC& geometry, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
+void D3D12RayTracingBLAS::GetUpdateDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& desc, eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& geometries, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
 {
     RE_ASSERT(m_desc.flags & GfxRayTracingASFlagAllowUpdate);
-    RE_ASSERT(m_geometries.size() == 1); //todo : suppport more than 1
+    RE_ASSERT(m_pScratchBuffer != nullptr);
 
-    geometry = m_geometries[0];
-    geometry.Triangles.VertexBuffer.StartAddress = vertex_buffer->GetGpuAddress() + vertex_buffer_offset;
+    //the geometries keep their vertex offsets relative to the first one
+    geometries = m_geometries;
+    for (size_t i = 0; i < geometries.size(); ++i)
+    {
+        int64_t relative_offset = (int64_t)m_desc.geometries[i].vertex_buffer_offset - (int64_t)m_desc.geometries[0].vertex_buffer_offset;
+        geometries[i].Triangles.VertexBuffer.StartAddress = vertex_buffer->GetGpuAddress() + vertex_buffer_offset + relative_offset;
+    }
 
-    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS updateInputs;
-    updateInputs.Type = D3D12_RAYTRACING_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL;
-    updateInputs.Flags = d3d12_rt_as_flags(m_desc.flags) | D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
-    updateInputs.NumDescs = 1;
-    updateInputs.DescsLayout = D3D12_ELEMENTS_LAYOUT_ARRAY;
-    updateInputs.pGeometryDescs = &geometry;
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS updateInputs = GetBuildInputs(m_desc, geometries);
+    updateInputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
 
     desc.Inputs = updateInputs;
-    desc.DestAccelerationStructureData = m_pASBuffer->GetGPUVirtualAddress();
-    desc.SourceAccelerationStructureData = m_pASBuffer->GetGPUVirtualAddress();
+    desc.DestAccelerationStructureData = m_buildDesc.DestAccelerationStructureData;
+    desc.SourceAccelerationStructureData = m_buildDesc.DestAccelerationStructureData;
     desc.ScratchAccelerationStructureData = m_pScratchBuffer->GetGPUVirtualAddress();
 }
+
+GfxRayTracingBLASSizes D3D12RayTracingBLAS::GetSizes(D3D12Device* pDevice, const GfxRayTracingBLASDesc& desc)
+{
+    eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC> geometries;
+    geometries.reserve(desc.geometries.size());
+
+    for (size_t i = 0; i < desc.geometries.size(); ++i)
+    {
+        geometries.push_back(GetGeometryDesc(desc.geometries[i]));
+    }
+
+    D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_INPUTS buildInput = GetBuildInputs(desc, geometries);
+
+    D3D12_RAYTRACING_ACCELERATION_STRUCTURE_PREBUILD_INFO info = {};
+    ((ID3D12Device5*)pDevice->GetHandle())->GetRaytracingAccelerationStructurePrebuildInfo(&buildInput, &info);
+
+    GfxRayTracingBLASSizes sizes;
+    sizes.as_size = (uint32_t)info.ResultDataMaxSizeInBytes;
+    sizes.build_scratch_size = (uint32_t)info.ScratchDataSizeInBytes;
+    sizes.update_scratch_size = (uint32_t)info.UpdateScratchDataSizeInBytes;
+    return sizes;
+}
\ No newline at end of file
@@ -16,13 +16,15 @@ public:
     D3D12RayTracingBLAS(D3D12Device* pDevice, const GfxRayTracingBLASDesc& desc, const eastl::string& name);
     ~D3D12RayTracingBLAS();
 
-    virtual void* GetHandle() const override { return m_pASBuffer; }
+    virtual void* GetHandle() const override;
 
     bool Create();
     const D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC* GetBuildDesc() const { return &m_buildDesc; }
-    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() const { return m_pASBuffer->GetGPUVirtualAddress(); }
+    D3D12_GPU_VIRTUAL_ADDRESS GetGpuAddress() const { return m_buildDesc.DestAccelerationStructureData; }
 
-    void GetUpdateDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& desc, D3D12_RAYTRACING_GEOMETRY_DESC& geometry, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset);
+    void GetUpdateDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& desc, eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC>& geometries, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset);
+
+    static GfxRayTracingBLASSizes GetSizes(D3D12Device* pDevice, const GfxRayTracingBLASDesc& desc);
 
 private:
     eastl::vector<D3D12_RAYTRACING_GEOMETRY_DESC> m_geometries;
@@ -41,7 +41,8 @@ bool D3D12RayTracingTLAS::Create()
     allocationDesc.HeapType = D3D12_HEAP_TYPE_DEFAULT;
 
     CD3DX12_RESOURCE_DESC asBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(info.ResultDataMaxSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
-    CD3DX12_RESOURCE_DESC scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(info.ScratchDataSizeInBytes, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+    UINT64 scratch_size = (m_desc.flags & GfxRayTracingASFlagAllowUpdate) ? eastl::max(info.ScratchDataSizeInBytes, info.UpdateScratchDataSizeInBytes) : info.ScratchDataSizeInBytes;
+    CD3DX12_RESOURCE_DESC scratchBufferDesc = CD3DX12_RESOURCE_DESC::Buffer(scratch_size, D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
     pAllocator->CreateResource(&allocationDesc, &asBufferDesc, D3D12_RESOURCE_STATE_RAYTRACING_ACCELERATION_STRUCTURE, nullptr, &m_pASAllocation, IID_PPV_ARGS(&m_pASBuffer));
     pAllocator->CreateResource(&allocationDesc, &scratchBufferDesc, D3D12_RESOURCE_STATE_COMMON, nullptr, &m_pScratchAllocation, IID_PPV_ARGS(&m_pScratchBuffer));
 
@@ -60,9 +61,10 @@ bool D3D12RayTracingTLAS::Create()
     return true;
 }
 
-void D3D12RayTracingTLAS::GetBuildDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& desc, const GfxRayTracingInstance* instances, uint32_t instance_count)
+void D3D12RayTracingTLAS::GetBuildDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC& desc, const GfxRayTracingInstance* instances, uint32_t instance_count, bool update)
 {
     RE_ASSERT(instance_count <= m_desc.instance_count);
+    RE_ASSERT(!update || (m_desc.flags & GfxRayTracingASFlagAllowUpdate));
 
     if (m_nCurrentInstanceBufferOffset + sizeof(D3D12_RAYTRACING_INSTANCE_DESC) * instance_count > m_nInstanceBufferSize)
     {
@@ -77,6 +79,12 @@ void D3D12RayTracingTLAS::GetBuildDesc(D3D12_BUILD_RAYTRACING_ACCELERATION_STRUC
     desc.DestAccelerationStructureData = m_pASBuffer->GetGPUVirtualAddress();
     desc.ScratchAccelerationStructureData = m_pScratchBuffer->GetGPUVirtualAddress();
 
+    if (update)
+    {
+        desc.Inputs.Flags |= D3D12_RAYTRACING_ACCELERATION_STRUCTURE_BUILD_FLAG_PERFORM_UPDATE;
+        desc.SourceAccelerationStructureData = m_pASBuffer->GetGPUVirtualAddress();
+    }
+
     D3D12_RAYTRACING_INSTANCE_DESC* instanceDescs = (D3D12_RAYTRACING_INSTANCE_DESC*)((char*)m_pInstanceBufferCpuAddress + m_nCurrentInstanceBufferOffset);
     for (uint32_t i = 0; i < instance_count; ++i)
     {
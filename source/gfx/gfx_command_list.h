@@ -71,9 +71,21 @@ public:
     virtual void MultiDispatchIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset) = 0;
     virtual void MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset) = 0;
 
-    virtual void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas) = 0;
+    //scratch_buffer : nullptr to use the scratch memory of the blas, which placed blases don't have
+    virtual void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset) = 0;
+    //all geometries read the new vertex buffer, keeping their vertex offsets relative to the first geometry
     virtual void UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset) = 0;
+    //full build from a new vertex buffer like UpdateRayTracingBLAS, to restore the trace quality lost by successive updates.
+    //the blas should not be compacted, the scratch buffer needs the build scratch size
+    virtual void RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset) = 0;
+    //writes the compacted size as an uint64_t, the buffer should be in GfxAccessComputeUAV
+    virtual void WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset) = 0;
+    //dst should be created with the compacted size of src
+    virtual void CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src) = 0;
     virtual void BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count) = 0;
+    //refits the last build with new transforms, the instances should reference the same blases in the same order.
+    //the tlas should be created with GfxRayTracingASFlagAllowUpdate
+    virtual void UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count) = 0;
 
 protected:
     GfxCommandQueue m_queueType;
@@ -15,6 +15,8 @@ static const uint32_t GFX_MAX_ROOT_CONSTANTS = 8;
 static const uint32_t GFX_MAX_CBV_BINDINGS = 3; //root constants in slot 0
 static const uint32_t GFX_MAX_RESOURCE_DESCRIPTOR_COUNT = 65536;
 static const uint32_t GFX_MAX_SAMPLER_DESCRIPTOR_COUNT = 128;
+static const uint32_t GFX_TILE_SIZE = 64 * 1024; //of sparse resources
+static const uint32_t GFX_RT_AS_ALIGNMENT = 256; //of acceleration structures and their scratch memory
 
 enum class GfxRenderBackend
 {
@@ -121,6 +123,7 @@ enum GfxBufferUsageBit
     GfxBufferUsageRawBuffer         = 1 << 3,
     GfxBufferUsageUnorderedAccess   = 1 << 4,
     GfxBufferUsageShared            = 1 << 5,
+    GfxBufferUsageAccelerationStructure = 1 << 6, //storage of acceleration structures
 };
 using GfxBufferUsageFlags = uint32_t;
 
@@ -753,6 +756,19 @@ struct GfxRayTracingBLASDesc
 {
     eastl::vector<GfxRayTracingGeometry> geometries;
     GfxRayTracingASFlag flags;
+
+    //placed in a buffer created with GfxBufferUsageAccelerationStructure, the blas allocates its own storage if it is nullptr.
+    //a placed blas has no build scratch memory, it should be built with an external scratch buffer
+    IGfxBuffer* storage_buffer = nullptr;
+    uint32_t storage_offset = 0; //aligned to GFX_RT_AS_ALIGNMENT
+    uint32_t storage_size = 0; //0 : the prebuild size, or the compacted size for the destination of a compaction
+};
+
+struct GfxRayTracingBLASSizes
+{
+    uint32_t as_size;
+    uint32_t build_scratch_size;
+    uint32_t update_scratch_size;
 };
 
 struct GfxRayTracingTLASDesc
@@ -47,6 +47,7 @@ public:
     virtual IGfxRayTracingTLAS* CreateRayTracingTLAS(const GfxRayTracingTLASDesc& desc, const eastl::string& name) = 0;
 
     virtual uint32_t GetAllocationSize(const GfxTextureDesc& desc) = 0;
+    virtual GfxRayTracingBLASSizes GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc) = 0;
     virtual bool DumpMemoryStats(const eastl::string& file) = 0;
 
 protected:
@@ -11,7 +11,7 @@ public:
     virtual uint32_t GetRequiredStagingBufferSize() const = 0;
     virtual uint32_t GetRowPitch(uint32_t mip_level = 0) const = 0;
     virtual GfxTilingDesc GetTilingDesc() const = 0;
-    virtual GfxSubresourceTilingDesc GetTilingDesc(uint32_t subresource = 0) const = 0;
+    virtual GfxSubresourceTilingDesc GetTilingDesc(uint32_t subresource) const = 0;
     virtual void* GetSharedHandle() const = 0;
 
 protected:
@@ -608,12 +608,16 @@ void MetalCommandList::MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer*
     //todo
 }
 
-void MetalCommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas)
+void MetalCommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
 {
     BeginASEncoder();
     
     MetalRayTracingBLAS* metalBLAS = (MetalRayTracingBLAS*)blas;
-    m_pASEncoder->buildAccelerationStructure(metalBLAS->GetAccelerationStructure(), metalBLAS->GetDescriptor(), metalBLAS->GetScratchBuffer(), 0);
+    MTL::Buffer* scratch = scratch_buffer ? (MTL::Buffer*)scratch_buffer->GetHandle() : metalBLAS->GetScratchBuffer();
+    NS::UInteger offset = scratch_buffer ? scratch_offset : 0;
+    RE_ASSERT(scratch != nullptr);
+    
+    m_pASEncoder->buildAccelerationStructure(metalBLAS->GetAccelerationStructure(), metalBLAS->GetDescriptor(), scratch, offset);
 }
 
 void MetalCommandList::UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
@@ -626,6 +630,31 @@ void MetalCommandList::UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer
     m_pASEncoder->refitAccelerationStructure(metalBLAS->GetAccelerationStructure(), metalBLAS->GetDescriptor(), metalBLAS->GetAccelerationStructure(), metalBLAS->GetScratchBuffer(), 0);
 }
 
+void MetalCommandList::RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
+{
+    BeginASEncoder();
+    
+    MetalRayTracingBLAS* metalBLAS = (MetalRayTracingBLAS*)blas;
+    metalBLAS->UpdateVertexBuffer(vertex_buffer, vertex_buffer_offset);
+    
+    m_pASEncoder->buildAccelerationStructure(metalBLAS->GetAccelerationStructure(), metalBLAS->GetDescriptor(), (MTL::Buffer*)scratch_buffer->GetHandle(), scratch_offset);
+}
+
+void MetalCommandList::WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset)
+{
+    BeginASEncoder();
+    
+    MetalRayTracingBLAS* metalBLAS = (MetalRayTracingBLAS*)blas;
+    m_pASEncoder->writeCompactedAccelerationStructureSize(metalBLAS->GetAccelerationStructure(), (MTL::Buffer*)buffer->GetHandle(), offset, MTL::DataTypeULong);
+}
+
+void MetalCommandList::CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src)
+{
+    BeginASEncoder();
+    
+    m_pASEncoder->copyAndCompactAccelerationStructure(((MetalRayTracingBLAS*)src)->GetAccelerationStructure(), ((MetalRayTracingBLAS*)dst)->GetAccelerationStructure());
+}
+
 void MetalCommandList::BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
 {
     BeginASEncoder();
@@ -636,6 +665,16 @@ void MetalCommandList::BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRa
     m_pASEncoder->buildAccelerationStructure(metalTLAS->GetAccelerationStructure(), metalTLAS->GetDescriptor(), metalTLAS->GetScratchBuffer(), 0);
 }
 
+void MetalCommandList::UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
+{
+    BeginASEncoder();
+    
+    MetalRayTracingTLAS* metalTLAS = (MetalRayTracingTLAS*)tlas;
+    metalTLAS->UpdateInstance(instances, instance_count);
+    
+    m_pASEncoder->refitAccelerationStructure(metalTLAS->GetAccelerationStructure(), metalTLAS->GetDescriptor(), metalTLAS->GetAccelerationStructure(), metalTLAS->GetScratchBuffer(), 0);
+}
+
 void MetalCommandList::BeginBlitEncoder()
 {
     EndRenderPass();
@@ -68,9 +68,13 @@ public:
     virtual void MultiDispatchIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset) override;
     virtual void MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset) override;
 
-    virtual void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas) override;
+    virtual void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset) override;
     virtual void UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset) override;
+    virtual void RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset) override;
+    virtual void WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset) override;
+    virtual void CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src) override;
     virtual void BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count) override;
+    virtual void UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count) override;
     
 private:
     void BeginBlitEncoder();
@@ -422,6 +422,11 @@ uint32_t MetalDevice::GetAllocationSize(const GfxTextureDesc& desc)
     return (uint32_t)sizeAndAlign.size;
 }
 
+GfxRayTracingBLASSizes MetalDevice::GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc)
+{
+    return MetalRayTracingBLAS::GetSizes(this, desc);
+}
+
 bool MetalDevice::DumpMemoryStats(const eastl::string& file)
 {
     return false;
@@ -24,26 +24,29 @@ MetalRayTracingBLAS::~MetalRayTracingBLAS()
     }
 }
 
+static MTL::AccelerationStructureTriangleGeometryDescriptor* CreateGeometryDescriptor(const GfxRayTracingGeometry& geometry)
+{
+    MTL::AccelerationStructureTriangleGeometryDescriptor* geometryDescriptor = MTL::AccelerationStructureTriangleGeometryDescriptor::alloc()->init();
+    geometryDescriptor->setOpaque(geometry.opaque);
+    geometryDescriptor->setVertexBuffer((MTL::Buffer*)geometry.vertex_buffer->GetHandle());
+    geometryDescriptor->setVertexBufferOffset((NS::UInteger)geometry.vertex_buffer_offset);
+    geometryDescriptor->setVertexStride((NS::UInteger)geometry.vertex_stride);
+    geometryDescriptor->setVertexFormat(ToAttributeFormat(geometry.vertex_format));
+    geometryDescriptor->setIndexBuffer((MTL::Buffer*)geometry.index_buffer->GetHandle());
+    geometryDescriptor->setIndexBufferOffset((NS::UInteger)geometry.index_buffer_offset);
+    geometryDescriptor->setIndexType(geometry.index_format == GfxFormat::R16UI ? MTL::IndexTypeUInt16 : MTL::IndexTypeUInt32);
+    geometryDescriptor->setTriangleCount((NS::UInteger)geometry.index_count / 3);
+
+    return geometryDescriptor;
+}
+
 bool MetalRayTracingBLAS::Create()
 {
     m_geometries.reserve(m_desc.geometries.size());
     
     for (size_t i = 0; i < m_desc.geometries.size(); ++i)
     {
-        const GfxRayTracingGeometry& geometry = m_desc.geometries[i];
-
-        MTL::AccelerationStructureTriangleGeometryDescriptor* geometryDescriptor = MTL::AccelerationStructureTriangleGeometryDescriptor::alloc()->init();
-        geometryDescriptor->setOpaque(geometry.opaque);
-        geometryDescriptor->setVertexBuffer((MTL::Buffer*)geometry.vertex_buffer->GetHandle());
-        geometryDescriptor->setVertexBufferOffset((NS::UInteger)geometry.vertex_buffer_offset);
-        geometryDescriptor->setVertexStride((NS::UInteger)geometry.vertex_stride);
-        geometryDescriptor->setVertexFormat(ToAttributeFormat(geometry.vertex_format));
-        geometryDescriptor->setIndexBuffer((MTL::Buffer*)geometry.index_buffer->GetHandle());
-        geometryDescriptor->setIndexBufferOffset((NS::UInteger)geometry.index_buffer_offset);
-        geometryDescriptor->setIndexType(geometry.index_format == GfxFormat::R16UI ? MTL::IndexTypeUInt16 : MTL::IndexTypeUInt32);
-        geometryDescriptor->setTriangleCount((NS::UInteger)geometry.index_count / 3);
-        
-        m_geometries.push_back(geometryDescriptor);
+        m_geometries.push_back(CreateGeometryDescriptor(m_desc.geometries[i]));
     }
     
     NS::Array* geometryDescriptors = NS::Array::alloc()->init((NS::Object**)m_geometries.data(), (NS::UInteger)m_geometries.size());
@@ -55,19 +58,34 @@ bool MetalRayTracingBLAS::Create()
     MTL::Device* device = (MTL::Device*)m_pDevice->GetHandle();
     MTL::AccelerationStructureSizes asSizes = device->accelerationStructureSizes(m_pDescriptor);
     
-    m_pAccelerationStructure = device->newAccelerationStructure(asSizes.accelerationStructureSize);
-    m_pScratchBuffer = device->newBuffer(eastl::max(asSizes.buildScratchBufferSize, asSizes.refitScratchBufferSize), MTL::ResourceStorageModePrivate);
+    //metal can't place an acceleration structure in a buffer, so the storage buffer is only used for the accounting,
+    //but a compacted blas still gets the smaller allocation
+    NS::UInteger as_size = m_desc.storage_size != 0 ? m_desc.storage_size : asSizes.accelerationStructureSize;
+    m_pAccelerationStructure = device->newAccelerationStructure(as_size);
+    
+    //placed blases are built with an external scratch buffer, only the update scratch memory is kept
+    NS::UInteger scratch_size = m_desc.storage_buffer ?
+        ((m_desc.flags & GfxRayTracingASFlagAllowUpdate) ? asSizes.refitScratchBufferSize : 0) :
+        eastl::max(asSizes.buildScratchBufferSize, asSizes.refitScratchBufferSize);
+    
+    if (scratch_size > 0)
+    {
+        m_pScratchBuffer = device->newBuffer(scratch_size, MTL::ResourceStorageModePrivate);
+    }
     
     geometryDescriptors->release();
     
-    if(m_pAccelerationStructure == nullptr || m_pScratchBuffer == nullptr)
+    if(m_pAccelerationStructure == nullptr || (scratch_size > 0 && m_pScratchBuffer == nullptr))
     {
         RE_ERROR("[MetalRayTracingBLAS] failed to create : {}", m_name);
         return false;
     }
     
     ((MetalDevice*)m_pDevice)->MakeResident(m_pAccelerationStructure);
-    ((MetalDevice*)m_pDevice)->MakeResident(m_pScratchBuffer);
+    if (m_pScratchBuffer)
+    {
+        ((MetalDevice*)m_pDevice)->MakeResident(m_pScratchBuffer);
+    }
     
     NS::String* label = NS::String::alloc()->init(m_name.c_str(), NS::StringEncoding::UTF8StringEncoding);
     m_pAccelerationStructure->setLabel(label);
@@ -80,12 +98,49 @@ bool MetalRayTracingBLAS::Create()
 void MetalRayTracingBLAS::UpdateVertexBuffer(IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
 {
     RE_ASSERT(m_desc.flags & GfxRayTracingASFlagAllowUpdate);
-    RE_ASSERT(m_geometries.size() == 1); //todo : suppport more than 1
     
-    m_geometries[0]->setVertexBuffer((MTL::Buffer*)vertex_buffer->GetHandle());
-    m_geometries[0]->setVertexBufferOffset((NS::UInteger)vertex_buffer_offset);
+    //the geometries keep their vertex offsets relative to the first one
+    for (size_t i = 0; i < m_geometries.size(); ++i)
+    {
+        int64_t relative_offset = (int64_t)m_desc.geometries[i].vertex_buffer_offset - (int64_t)m_desc.geometries[0].vertex_buffer_offset;
+        
+        m_geometries[i]->setVertexBuffer((MTL::Buffer*)vertex_buffer->GetHandle());
+        m_geometries[i]->setVertexBufferOffset((NS::UInteger)(vertex_buffer_offset + relative_offset));
+    }
     
     NS::Array* geometryDescriptors = NS::Array::alloc()->init((NS::Object**)m_geometries.data(), (NS::UInteger)m_geometries.size());
     m_pDescriptor->setGeometryDescriptors(geometryDescriptors);
     geometryDescriptors->release();
 }
+
+GfxRayTracingBLASSizes MetalRayTracingBLAS::GetSizes(MetalDevice* pDevice, const GfxRayTracingBLASDesc& desc)
+{
+    eastl::vector<MTL::AccelerationStructureTriangleGeometryDescriptor*> geometries;
+    geometries.reserve(desc.geometries.size());
+    
+    for (size_t i = 0; i < desc.geometries.size(); ++i)
+    {
+        geometries.push_back(CreateGeometryDescriptor(desc.geometries[i]));
+    }
+    
+    NS::Array* geometryDescriptors = NS::Array::alloc()->init((NS::Object**)geometries.data(), (NS::UInteger)geometries.size());
+    
+    MTL::PrimitiveAccelerationStructureDescriptor* descriptor = MTL::PrimitiveAccelerationStructureDescriptor::alloc()->init();
+    descriptor->setGeometryDescriptors(geometryDescriptors);
+    descriptor->setUsage(ToAccelerationStructureUsage(desc.flags));
+    
+    MTL::AccelerationStructureSizes asSizes = ((MTL::Device*)pDevice->GetHandle())->accelerationStructureSizes(descriptor);
+    
+    descriptor->release();
+    geometryDescriptors->release();
+    for (size_t i = 0; i < geometries.size(); ++i)
+    {
+        geometries[i]->release();
+    }
+    
+    GfxRayTracingBLASSizes sizes;
+    sizes.as_size = (uint32_t)asSizes.accelerationStructureSize;
+    sizes.build_scratch_size = (uint32_t)asSizes.buildScratchBufferSize;
+    sizes.update_scratch_size = (uint32_t)asSizes.refitScratchBufferSize;
+    return sizes;
+}
@@ -16,6 +16,8 @@ public:
     MTL::AccelerationStructure* GetAccelerationStructure() const { return m_pAccelerationStructure; }
     MTL::PrimitiveAccelerationStructureDescriptor* GetDescriptor() const  { return m_pDescriptor; }
     MTL::Buffer* GetScratchBuffer() const { return m_pScratchBuffer; }
+
+    static GfxRayTracingBLASSizes GetSizes(MetalDevice* pDevice, const GfxRayTracingBLASDesc& desc);
     
     virtual void* GetHandle() const override { return m_pAccelerationStructure; }
     
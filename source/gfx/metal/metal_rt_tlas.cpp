@@ -38,7 +38,8 @@ bool MetalRayTracingTLAS::Create()
     MTL::AccelerationStructureSizes asSizes = device->accelerationStructureSizes(m_pDescriptor);
     
     m_pAccelerationStructure = device->newAccelerationStructure(asSizes.accelerationStructureSize);
-    m_pScratchBuffer = device->newBuffer(asSizes.buildScratchBufferSize, MTL::ResourceStorageModePrivate);
+    NS::UInteger scratch_size = (m_desc.flags & GfxRayTracingASFlagAllowUpdate) ? eastl::max(asSizes.buildScratchBufferSize, asSizes.refitScratchBufferSize) : asSizes.buildScratchBufferSize;
+    m_pScratchBuffer = device->newBuffer(scratch_size, MTL::ResourceStorageModePrivate);
     
     if(m_pAccelerationStructure == nullptr || m_pScratchBuffer == nullptr)
     {
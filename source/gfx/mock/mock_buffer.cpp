@@ -15,6 +15,11 @@ MockBuffer::~MockBuffer()
     {
         RE_FREE(m_pCpuAddress);
     }
+
+    if (m_pSimulatedMemory)
+    {
+        RE_FREE(m_pSimulatedMemory);
+    }
 }
 
 bool MockBuffer::Create()
@@ -38,6 +43,21 @@ void* MockBuffer::GetCpuAddress()
     return m_pCpuAddress;
 }
 
+void* MockBuffer::GetSimulatedMemory(bool allocate)
+{
+    if (m_pCpuAddress)
+    {
+        return m_pCpuAddress;
+    }
+
+    if (m_pSimulatedMemory == nullptr && allocate)
+    {
+        m_pSimulatedMemory = RE_ALLOC(m_desc.size);
+        memset(m_pSimulatedMemory, 0, m_desc.size);
+    }
+    return m_pSimulatedMemory;
+}
+
 uint64_t MockBuffer::GetGpuAddress()
 {
     return 0;
@@ -18,6 +18,11 @@ public:
     virtual uint32_t GetRequiredStagingBufferSize() const override;
     virtual void* GetSharedHandle() const override;
 
+    //cpu memory standing in for the gpu memory, so results written by the mock command lists can be read back.
+    //it is allocated on the first simulated write into a gpu only buffer
+    void* GetSimulatedMemory(bool allocate);
+
 private:
     void* m_pCpuAddress = nullptr;
+    void* m_pSimulatedMemory = nullptr;
 };
@@ -1,6 +1,14 @@
 #include "mock_command_list.h"
 #include "mock_device.h"
 #include "mock_swapchain.h"
+#include "mock_descriptor.h"
+#include "mock_buffer.h"
+#include "mock_rt_blas.h"
+#include "mock_rt_tlas.h"
+#include "../gfx.h"
+#include "utils/assert.h"
+#include "utils/fmt.h"
+#include "xxHash/xxhash.h"
 
 MockCommandList::MockCommandList(MockDevice* pDevice, GfxCommandQueue queue_type, const eastl::string& name)
 {
@@ -29,6 +37,13 @@ void MockCommandList::ResetAllocator()
 
 void MockCommandList::Begin()
 {
+    m_bRecording = ((MockDevice*)m_pDevice)->IsCommandRecordingEnabled();
+    m_stream.Clear();
+
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::BeginCommandList, { (uint32_t)m_queueType });
+    }
 }
 
 void MockCommandList::End()
@@ -50,10 +65,19 @@ void MockCommandList::Present(IGfxSwapchain* swapchain)
 
 void MockCommandList::Submit()
 {
+    if (m_bRecording)
+    {
+        ((MockDevice*)m_pDevice)->SubmitCommandStream(m_stream);
+        m_stream.Clear();
+    }
 }
 
 void MockCommandList::ResetState()
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::ResetState, {});
+    }
 }
 
 void MockCommandList::BeginEvent(const eastl::string& event_name, const eastl::string& file, const eastl::string& function, uint32_t line)
@@ -66,46 +90,102 @@ void MockCommandList::EndEvent()
 
 void MockCommandList::CopyBufferToTexture(IGfxTexture* dst_texture, uint32_t mip_level, uint32_t array_slice, IGfxBuffer* src_buffer, uint32_t offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::CopyBufferToTexture, { GetID(dst_texture), GetSubResource(dst_texture, mip_level, array_slice), GetID(src_buffer), offset });
+    }
 }
 
 void MockCommandList::CopyTextureToBuffer(IGfxBuffer* dst_buffer, uint32_t offset, IGfxTexture* src_texture, uint32_t mip_level, uint32_t array_slice)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::CopyTextureToBuffer, { GetID(dst_buffer), offset, GetID(src_texture), GetSubResource(src_texture, mip_level, array_slice) });
+    }
 }
 
 void MockCommandList::CopyBuffer(IGfxBuffer* dst, uint32_t dst_offset, IGfxBuffer* src, uint32_t src_offset, uint32_t size)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::CopyBuffer, { GetID(dst), dst_offset, GetID(src), src_offset, size });
+    }
+
+    //readbacks of the simulated results
+    void* src_data = ((MockBuffer*)src)->GetSimulatedMemory(false);
+    void* dst_data = dst->GetCpuAddress();
+    if (src_data && dst_data)
+    {
+        memcpy((char*)dst_data + dst_offset, (const char*)src_data + src_offset, size);
+    }
 }
 
 void MockCommandList::CopyTexture(IGfxTexture* dst, uint32_t dst_mip, uint32_t dst_array, IGfxTexture* src, uint32_t src_mip, uint32_t src_array)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::CopyTexture, { GetID(dst), GetSubResource(dst, dst_mip, dst_array), GetID(src), GetSubResource(src, src_mip, src_array) });
+    }
 }
 
 void MockCommandList::ClearUAV(IGfxResource* resource, IGfxDescriptor* uav, const float* clear_value)
 {
+    if (m_bRecording)
+    {
+        IGfxResource* uav_resource = uav ? ((MockUnorderedAccessView*)uav)->GetResource() : nullptr;
+        uint32_t heap_index = uav ? uav->GetHeapIndex() : GFX_INVALID_RESOURCE;
+        m_stream.Write(MockCommand::ClearUAV, { GetID(resource), GFX_ALL_SUB_RESOURCE, GetID(uav), heap_index, GetID(uav_resource) });
+    }
 }
 
 void MockCommandList::ClearUAV(IGfxResource* resource, IGfxDescriptor* uav, const uint32_t* clear_value)
 {
+    if (m_bRecording)
+    {
+        IGfxResource* uav_resource = uav ? ((MockUnorderedAccessView*)uav)->GetResource() : nullptr;
+        uint32_t heap_index = uav ? uav->GetHeapIndex() : GFX_INVALID_RESOURCE;
+        m_stream.Write(MockCommand::ClearUAV, { GetID(resource), GFX_ALL_SUB_RESOURCE, GetID(uav), heap_index, GetID(uav_resource) });
+    }
 }
 
 void MockCommandList::WriteBuffer(IGfxBuffer* buffer, uint32_t offset, uint32_t data)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::WriteBuffer, { GetID(buffer), offset, data });
+    }
 }
 
 void MockCommandList::UpdateTileMappings(IGfxTexture* texture, IGfxHeap* heap, uint32_t mapping_count, const GfxTileMapping* mappings)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::UpdateTileMappings, { GetID(texture), GetID(heap), mapping_count });
+    }
 }
 
 void MockCommandList::TextureBarrier(IGfxTexture* texture, uint32_t sub_resource, GfxAccessFlags access_before, GfxAccessFlags access_after)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::TextureBarrier, { GetID(texture), sub_resource, access_before, access_after });
+    }
 }
 
 void MockCommandList::BufferBarrier(IGfxBuffer* buffer, GfxAccessFlags access_before, GfxAccessFlags access_after)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::BufferBarrier, { GetID(buffer), access_before, access_after });
+    }
 }
 
 void MockCommandList::GlobalBarrier(GfxAccessFlags access_before, GfxAccessFlags access_after)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::GlobalBarrier, { access_before, access_after });
+    }
 }
 
 void MockCommandList::FlushBarriers()
@@ -114,14 +194,48 @@ void MockCommandList::FlushBarriers()
 
 void MockCommandList::BeginRenderPass(const GfxRenderPassDesc& render_pass)
 {
+    if (m_bRecording)
+    {
+        //[color count][depth read only][color id, sub resource]...[depth id, sub resource]
+        uint32_t args[MOCK_MAX_COMMAND_ARGS];
+        uint32_t arg_count = 2;
+
+        uint32_t color_count = 0;
+        for (uint32_t i = 0; i < 8; ++i)
+        {
+            const GfxRenderPassColorAttachment& color = render_pass.color[i];
+            if (color.texture != nullptr)
+            {
+                args[arg_count++] = GetID(color.texture);
+                args[arg_count++] = GetSubResource(color.texture, color.mip_slice, color.array_slice);
+                ++color_count;
+            }
+        }
+
+        const GfxRenderPassDepthAttachment& depth = render_pass.depth;
+        args[0] = color_count;
+        args[1] = depth.read_only;
+        args[arg_count++] = GetID(depth.texture);
+        args[arg_count++] = depth.texture ? GetSubResource(depth.texture, depth.mip_slice, depth.array_slice) : 0;
+
+        m_stream.Write(MockCommand::BeginRenderPass, args, arg_count);
+    }
 }
 
 void MockCommandList::EndRenderPass()
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::EndRenderPass, {});
+    }
 }
 
 void MockCommandList::SetPipelineState(IGfxPipelineState* state)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::SetPipelineState, { GetID(state), state ? (uint32_t)state->GetType() : 0 });
+    }
 }
 
 void MockCommandList::SetStencilReference(uint8_t stencil)
@@ -134,6 +248,10 @@ void MockCommandList::SetBlendFactor(const float* blend_factor)
 
 void MockCommandList::SetIndexBuffer(IGfxBuffer* buffer, uint32_t offset, GfxFormat format)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::SetIndexBuffer, { GetID(buffer), offset, (uint32_t)format });
+    }
 }
 
 void MockCommandList::SetViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height)
@@ -146,69 +264,211 @@ void MockCommandList::SetScissorRect(uint32_t x, uint32_t y, uint32_t width, uin
 
 void MockCommandList::SetGraphicsConstants(uint32_t slot, const void* data, size_t data_size)
 {
+    RecordConstants(MockCommand::SetGraphicsConstants, slot, data, data_size);
 }
 
 void MockCommandList::SetComputeConstants(uint32_t slot, const void* data, size_t data_size)
 {
+    RecordConstants(MockCommand::SetComputeConstants, slot, data, data_size);
 }
 
 void MockCommandList::Draw(uint32_t vertex_count, uint32_t instance_count)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::Draw, { vertex_count, instance_count });
+    }
 }
 
 void MockCommandList::DrawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t index_offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::DrawIndexed, { index_count, instance_count, index_offset });
+    }
 }
 
 void MockCommandList::Dispatch(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::Dispatch, { group_count_x, group_count_y, group_count_z });
+    }
 }
 
 void MockCommandList::DispatchMesh(uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::DispatchMesh, { group_count_x, group_count_y, group_count_z });
+    }
 }
 
 void MockCommandList::DrawIndirect(IGfxBuffer* buffer, uint32_t offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::DrawIndirect, { GetID(buffer), offset });
+    }
 }
 
 void MockCommandList::DrawIndexedIndirect(IGfxBuffer* buffer, uint32_t offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::DrawIndexedIndirect, { GetID(buffer), offset });
+    }
 }
 
 void MockCommandList::DispatchIndirect(IGfxBuffer* buffer, uint32_t offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::DispatchIndirect, { GetID(buffer), offset });
+    }
 }
 
 void MockCommandList::DispatchMeshIndirect(IGfxBuffer* buffer, uint32_t offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::DispatchMeshIndirect, { GetID(buffer), offset });
+    }
 }
 
 void MockCommandList::MultiDrawIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::MultiDrawIndirect, { max_count, GetID(args_buffer), args_buffer_offset, GetID(count_buffer), count_buffer_offset });
+    }
 }
 
 void MockCommandList::MultiDrawIndexedIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::MultiDrawIndexedIndirect, { max_count, GetID(args_buffer), args_buffer_offset, GetID(count_buffer), count_buffer_offset });
+    }
 }
 
 void MockCommandList::MultiDispatchIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::MultiDispatchIndirect, { max_count, GetID(args_buffer), args_buffer_offset, GetID(count_buffer), count_buffer_offset });
+    }
 }
 
 void MockCommandList::MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::MultiDispatchMeshIndirect, { max_count, GetID(args_buffer), args_buffer_offset, GetID(count_buffer), count_buffer_offset });
+    }
 }
 
-void MockCommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas)
+void MockCommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
 {
+    if (m_bRecording)
+    {
+        uint32_t scratch_size = scratch_buffer ? ((MockRayTracingBLAS*)blas)->GetSizes().build_scratch_size : 0;
+        m_stream.Write(MockCommand::BuildRayTracingBLAS, { GetID(blas), GetID(scratch_buffer), scratch_offset, scratch_size });
+    }
+
+    RE_ASSERT(scratch_buffer == nullptr || scratch_offset + ((MockRayTracingBLAS*)blas)->GetSizes().build_scratch_size <= scratch_buffer->GetDesc().size);
 }
 
 void MockCommandList::UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::UpdateRayTracingBLAS, { GetID(blas), GetID(vertex_buffer), vertex_buffer_offset });
+    }
+}
+
+void MockCommandList::RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
+{
+    uint32_t scratch_size = ((MockRayTracingBLAS*)blas)->GetSizes().build_scratch_size;
+
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::RebuildRayTracingBLAS, { GetID(blas), GetID(scratch_buffer), scratch_offset, scratch_size, GetID(vertex_buffer), vertex_buffer_offset });
+    }
+
+    RE_ASSERT(blas->GetDesc().flags & GfxRayTracingASFlagAllowUpdate);
+    RE_ASSERT(scratch_offset + scratch_size <= scratch_buffer->GetDesc().size);
+}
+
+void MockCommandList::WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset)
+{
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::WriteRayTracingBLASCompactedSize, { GetID(blas), GetID(buffer), offset });
+    }
+
+    uint64_t size = ((MockRayTracingBLAS*)blas)->GetCompactedSize();
+    void* data = ((MockBuffer*)buffer)->GetSimulatedMemory(true);
+    memcpy((char*)data + offset, &size, sizeof(uint64_t));
+}
+
+void MockCommandList::CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src)
+{
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::CompactRayTracingBLAS, { GetID(dst), GetID(src) });
+    }
+
+    RE_ASSERT(dst->GetDesc().storage_size == 0 || dst->GetDesc().storage_size >= ((MockRayTracingBLAS*)src)->GetCompactedSize());
 }
 
 void MockCommandList::BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
 {
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::BuildRayTracingTLAS, { GetID(tlas), instance_count });
+    }
+
+    ((MockRayTracingTLAS*)tlas)->OnBuild(instances, instance_count);
+}
+
+void MockCommandList::UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
+{
+    if (m_bRecording)
+    {
+        m_stream.Write(MockCommand::UpdateRayTracingTLAS, { GetID(tlas), instance_count });
+    }
+
+    ((MockRayTracingTLAS*)tlas)->OnUpdate(instances, instance_count);
 }
 
+
+uint32_t MockCommandList::GetID(const IGfxResource* resource)
+{
+    return ((MockDevice*)m_pDevice)->GetResourceRegistry()->GetID(resource);
+}
+
+uint32_t MockCommandList::GetSubResource(const IGfxTexture* texture, uint32_t mip_level, uint32_t array_slice) const
+{
+    return CalcSubresource(texture->GetDesc(), mip_level, array_slice);
+}
+
+void MockCommandList::RecordConstants(MockCommand command, uint32_t slot, const void* data, size_t data_size)
+{
+    //the limits of the root signatures of the real backends, which only assert on them
+    if (slot == 0 && data_size > sizeof(uint32_t) * GFX_MAX_ROOT_CONSTANTS)
+    {
+        ((MockDevice*)m_pDevice)->ReportError(fmt::format("{} : {} bytes of root constants in slot 0, at most {} fit", m_name, data_size, sizeof(uint32_t) * GFX_MAX_ROOT_CONSTANTS).c_str());
+    }
+    else if (slot >= GFX_MAX_CBV_BINDINGS)
+    {
+        ((MockDevice*)m_pDevice)->ReportError(fmt::format("{} : constant buffer slot {} is out of range", m_name, slot).c_str());
+    }
+
+    if (m_bRecording)
+    {
+        //only the hash of the data is stored, enough to tell redundant updates
+        uint64_t hash = XXH3_64bits(data, data_size);
+        m_stream.Write(command, { slot, (uint32_t)data_size, (uint32_t)hash, (uint32_t)(hash >> 32) });
+    }
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../gfx_command_list.h"
+#include "mock_command_stream.h"
 
 class MockDevice;
 
@@ -66,7 +67,20 @@ public:
     virtual void MultiDispatchIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset) override;
     virtual void MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer* args_buffer, uint32_t args_buffer_offset, IGfxBuffer* count_buffer, uint32_t count_buffer_offset) override;
 
-    virtual void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas) override;
+    virtual void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset) override;
     virtual void UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset) override;
+    virtual void RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset) override;
+    virtual void WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset) override;
+    virtual void CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src) override;
     virtual void BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count) override;
+    virtual void UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count) override;
+
+private:
+    uint32_t GetID(const IGfxResource* resource);
+    uint32_t GetSubResource(const IGfxTexture* texture, uint32_t mip_level, uint32_t array_slice) const;
+    void RecordConstants(MockCommand command, uint32_t slot, const void* data, size_t data_size);
+
+private:
+    bool m_bRecording = false;
+    MockCommandStream m_stream;
 };
\ No newline at end of file
@@ -0,0 +1,802 @@
+#include "mock_command_stream.h"
+#include "../gfx_resource.h"
+#include "utils/assert.h"
+#include "utils/fmt.h"
+#include "magic_enum/magic_enum.hpp"
+#include <fstream>
+
+static const uint32_t MOCK_STREAM_MAGIC = 0x4B434F4D; //"MOCK"
+static const uint32_t MOCK_STREAM_VERSION = 2; //2 : added the resource names
+
+void MockCommandStream::Write(MockCommand command, std::initializer_list<uint32_t> args)
+{
+    Write(command, args.begin(), (uint32_t)args.size());
+}
+
+void MockCommandStream::Write(MockCommand command, const uint32_t* args, uint32_t arg_count)
+{
+    RE_ASSERT(arg_count <= MOCK_MAX_COMMAND_ARGS);
+
+    size_t offset = m_data.size();
+    m_data.resize(offset + 2 + sizeof(uint32_t) * arg_count);
+    m_data[offset] = (uint8_t)command;
+    m_data[offset + 1] = (uint8_t)arg_count;
+    memcpy(m_data.data() + offset + 2, args, sizeof(uint32_t) * arg_count);
+}
+
+void MockCommandStream::Append(const MockCommandStream& stream)
+{
+    m_data.insert(m_data.end(), stream.m_data.begin(), stream.m_data.end());
+}
+
+bool MockCommandStream::Read(size_t& offset, Command& command) const
+{
+    if (offset + 2 > m_data.size())
+    {
+        return false;
+    }
+
+    command.type = (MockCommand)m_data[offset];
+    command.arg_count = m_data[offset + 1];
+
+    size_t args_size = sizeof(uint32_t) * command.arg_count;
+    if (command.type >= MockCommand::Count || command.arg_count > MOCK_MAX_COMMAND_ARGS || offset + 2 + args_size > m_data.size())
+    {
+        return false;
+    }
+
+    memcpy(command.args, m_data.data() + offset + 2, args_size);
+    offset += 2 + args_size;
+
+    return true;
+}
+
+bool MockCommandStream::Save(const eastl::string& file, const MockResourceRegistry* registry) const
+{
+    std::ofstream os;
+    os.open(file.c_str(), std::ios::binary);
+    if (os.fail())
+    {
+        return false;
+    }
+
+    eastl::vector<eastl::string> names;
+    if (registry)
+    {
+        names = registry->GetNames();
+    }
+
+    //header : magic, version, stream size, name count
+    uint32_t header[4] = { MOCK_STREAM_MAGIC, MOCK_STREAM_VERSION, (uint32_t)m_data.size(), (uint32_t)names.size() };
+    os.write((const char*)header, sizeof(header));
+    os.write((const char*)m_data.data(), m_data.size());
+
+    //each name : [uint32_t length][length chars]
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        uint32_t length = (uint32_t)names[i].size();
+        os.write((const char*)&length, sizeof(length));
+        os.write(names[i].data(), length);
+    }
+
+    return !os.fail();
+}
+
+bool MockCommandStream::Load(const eastl::string& file, MockResourceRegistry* registry)
+{
+    std::ifstream is;
+    is.open(file.c_str(), std::ios::binary);
+    if (is.fail())
+    {
+        return false;
+    }
+
+    uint32_t header[4] = {};
+    is.read((char*)header, sizeof(header));
+    if (is.fail() || header[0] != MOCK_STREAM_MAGIC || header[1] != MOCK_STREAM_VERSION)
+    {
+        return false;
+    }
+
+    m_data.resize(header[2]);
+    is.read((char*)m_data.data(), header[2]);
+
+    eastl::vector<eastl::string> names(header[3]);
+    for (uint32_t i = 0; i < header[3] && !is.fail(); ++i)
+    {
+        uint32_t length = 0;
+        is.read((char*)&length, sizeof(length));
+        if (is.fail())
+        {
+            break;
+        }
+
+        names[i].resize(length);
+        is.read(names[i].data(), length);
+    }
+
+    if (is.fail())
+    {
+        return false;
+    }
+
+    if (registry)
+    {
+        registry->SetNames(names);
+    }
+
+    return true;
+}
+
+uint32_t MockResourceRegistry::GetID(const IGfxResource* resource)
+{
+    if (resource == nullptr)
+    {
+        return GFX_INVALID_RESOURCE;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto iter = m_resourceIDs.find(resource);
+    if (iter != m_resourceIDs.end())
+    {
+        //the address may have been reused by a new resource
+        if (m_names[iter->second] != resource->GetName())
+        {
+            m_names[iter->second] = resource->GetName();
+        }
+        return iter->second;
+    }
+
+    uint32_t id = (uint32_t)m_names.size();
+    m_resourceIDs.insert(eastl::make_pair(resource, id));
+    m_names.push_back(resource->GetName());
+
+    return id;
+}
+
+eastl::string MockResourceRegistry::GetName(uint32_t id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (id < m_names.size())
+    {
+        return m_names[id];
+    }
+    return "";
+}
+
+eastl::vector<eastl::string> MockResourceRegistry::GetNames() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_names;
+}
+
+void MockResourceRegistry::SetNames(const eastl::vector<eastl::string>& names)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_resourceIDs.clear();
+    m_names = names;
+}
+
+void MockResourceRegistry::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_resourceIDs.clear();
+    m_names.clear();
+}
+
+//which args of a command are resource ids, used to print their names
+static bool IsResourceArg(MockCommand type, uint32_t arg)
+{
+    switch (type)
+    {
+    case MockCommand::TextureBarrier:
+    case MockCommand::BufferBarrier:
+    case MockCommand::SetPipelineState:
+    case MockCommand::SetIndexBuffer:
+    case MockCommand::DrawIndirect:
+    case MockCommand::DrawIndexedIndirect:
+    case MockCommand::DispatchIndirect:
+    case MockCommand::DispatchMeshIndirect:
+    case MockCommand::WriteBuffer:
+    case MockCommand::BuildRayTracingTLAS:
+    case MockCommand::UpdateRayTracingTLAS:
+        return arg == 0;
+    case MockCommand::CopyBufferToTexture:
+    case MockCommand::CopyTextureToBuffer:
+    case MockCommand::CopyBuffer:
+    case MockCommand::CopyTexture:
+        return arg == 0 || arg == 2;
+    case MockCommand::ClearUAV:
+        return arg == 0 || arg == 2 || arg == 4;
+    case MockCommand::UpdateTileMappings:
+    case MockCommand::BuildRayTracingBLAS:
+    case MockCommand::UpdateRayTracingBLAS:
+    case MockCommand::WriteRayTracingBLASCompactedSize:
+    case MockCommand::CompactRayTracingBLAS:
+        return arg == 0 || arg == 1;
+    case MockCommand::RebuildRayTracingBLAS:
+        return arg == 0 || arg == 1 || arg == 4; //[blas, scratch buffer, scratch offset, scratch size, vertex buffer, vertex offset]
+    case MockCommand::MultiDrawIndirect:
+    case MockCommand::MultiDrawIndexedIndirect:
+    case MockCommand::MultiDispatchIndirect:
+    case MockCommand::MultiDispatchMeshIndirect:
+        return arg == 1 || arg == 3;
+    case MockCommand::BeginRenderPass:
+        return arg >= 2 && (arg % 2) == 0; //[color count][depth read only][id, sub]...[depth id, depth sub]
+    default:
+        return false;
+    }
+}
+
+eastl::string DescribeMockCommand(const MockCommandStream::Command& command, const MockResourceRegistry* registry)
+{
+    auto name = magic_enum::enum_name(command.type);
+    eastl::string text(name.data(), name.size());
+    text += "(";
+
+    for (uint32_t i = 0; i < command.arg_count; ++i)
+    {
+        if (i > 0)
+        {
+            text += ", ";
+        }
+
+        uint32_t value = command.args[i];
+        if (IsResourceArg(command.type, i))
+        {
+            if (value == GFX_INVALID_RESOURCE)
+            {
+                text += "null";
+            }
+            else
+            {
+                text.append_sprintf("#%u", value);
+
+                if (registry)
+                {
+                    text.append_sprintf(" '%s'", registry->GetName(value).c_str());
+                }
+            }
+        }
+        else
+        {
+            text.append_sprintf("%u", value);
+        }
+    }
+
+    text += ")";
+    return text;
+}
+
+MockFrameStats CalcMockFrameStats(const MockCommandStream& stream)
+{
+    MockFrameStats stats;
+    stats.stream_bytes = (uint32_t)stream.GetSize();
+
+    uint32_t pso = GFX_INVALID_RESOURCE;
+    uint32_t index_buffer[3] = { GFX_INVALID_RESOURCE, 0, 0 };
+    eastl::hash_map<uint32_t, eastl::pair<uint32_t, uint32_t>> constants; //(compute << 16 | slot) -> hash
+
+    MockCommandStream::Command command;
+    size_t offset = 0;
+    while (stream.Read(offset, command))
+    {
+        const uint32_t* args = command.args;
+
+        switch (command.type)
+        {
+        case MockCommand::BeginCommandList:
+        case MockCommand::ResetState:
+            if (command.type == MockCommand::BeginCommandList)
+            {
+                ++stats.command_lists;
+            }
+            pso = GFX_INVALID_RESOURCE;
+            index_buffer[0] = GFX_INVALID_RESOURCE;
+            constants.clear();
+            break;
+        case MockCommand::TextureBarrier:
+        case MockCommand::BufferBarrier:
+        case MockCommand::GlobalBarrier:
+            ++stats.barriers;
+            break;
+        case MockCommand::BeginRenderPass:
+            ++stats.render_passes;
+            break;
+        case MockCommand::SetPipelineState:
+            ++stats.pso_changes;
+            if (args[0] == pso)
+            {
+                ++stats.redundant_pso_changes;
+            }
+            pso = args[0];
+            break;
+        case MockCommand::SetIndexBuffer:
+            ++stats.index_buffer_changes;
+            if (memcmp(index_buffer, args, sizeof(index_buffer)) == 0)
+            {
+                ++stats.redundant_index_buffer_changes;
+            }
+            memcpy(index_buffer, args, sizeof(index_buffer));
+            break;
+        case MockCommand::SetGraphicsConstants:
+        case MockCommand::SetComputeConstants:
+        {
+            ++stats.constant_changes;
+
+            uint32_t key = ((command.type == MockCommand::SetComputeConstants) << 16) | args[0];
+            eastl::pair<uint32_t, uint32_t> hash(args[2], args[3]);
+
+            auto iter = constants.find(key);
+            if (iter != constants.end() && iter->second == hash)
+            {
+                ++stats.redundant_constant_changes;
+            }
+            constants[key] = hash;
+            break;
+        }
+        case MockCommand::Draw:
+        case MockCommand::DrawIndexed:
+        case MockCommand::DrawIndirect:
+        case MockCommand::DrawIndexedIndirect:
+        case MockCommand::MultiDrawIndirect:
+        case MockCommand::MultiDrawIndexedIndirect:
+        case MockCommand::DispatchMesh:
+        case MockCommand::DispatchMeshIndirect:
+        case MockCommand::MultiDispatchMeshIndirect:
+            ++stats.draws;
+            break;
+        case MockCommand::Dispatch:
+        case MockCommand::DispatchIndirect:
+        case MockCommand::MultiDispatchIndirect:
+            ++stats.dispatches;
+            break;
+        case MockCommand::CopyBufferToTexture:
+        case MockCommand::CopyTextureToBuffer:
+        case MockCommand::CopyBuffer:
+        case MockCommand::CopyTexture:
+            ++stats.copies;
+            break;
+        case MockCommand::ClearUAV:
+            ++stats.clears;
+            break;
+        case MockCommand::BuildRayTracingBLAS:
+            ++stats.ray_tracing_builds;
+            if (args[1] != GFX_INVALID_RESOURCE)
+            {
+                stats.blas_scratch_bytes += args[3];
+            }
+            break;
+        case MockCommand::UpdateRayTracingBLAS:
+            ++stats.ray_tracing_builds;
+            ++stats.blas_refits;
+            break;
+        case MockCommand::RebuildRayTracingBLAS:
+            ++stats.ray_tracing_builds;
+            ++stats.blas_rebuilds;
+            stats.blas_scratch_bytes += args[3];
+            break;
+        case MockCommand::BuildRayTracingTLAS:
+            ++stats.ray_tracing_builds;
+            break;
+        case MockCommand::CompactRayTracingBLAS:
+            ++stats.blas_compactions;
+            break;
+        case MockCommand::UpdateRayTracingTLAS:
+            ++stats.ray_tracing_builds;
+            ++stats.tlas_refits;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return stats;
+}
+
+static bool IsSameCommand(const MockCommandStream::Command& lhs, const MockCommandStream::Command& rhs)
+{
+    return lhs.type == rhs.type &&
+        lhs.arg_count == rhs.arg_count &&
+        memcmp(lhs.args, rhs.args, sizeof(uint32_t) * lhs.arg_count) == 0;
+}
+
+eastl::vector<MockCommandDiff> DiffMockCommandStreams(const MockCommandStream& lhs, const MockCommandStream& rhs, uint32_t max_count,
+    const MockResourceRegistry* lhs_registry, const MockResourceRegistry* rhs_registry)
+{
+    if (rhs_registry == nullptr)
+    {
+        rhs_registry = lhs_registry;
+    }
+
+    eastl::vector<MockCommandDiff> diffs;
+
+    size_t lhs_offset = 0;
+    size_t rhs_offset = 0;
+    uint32_t index = 0;
+
+    while (diffs.size() < max_count)
+    {
+        MockCommandStream::Command lhs_command, rhs_command;
+        bool has_lhs = lhs.Read(lhs_offset, lhs_command);
+        bool has_rhs = rhs.Read(rhs_offset, rhs_command);
+
+        if (!has_lhs && !has_rhs)
+        {
+            break;
+        }
+
+        if (has_lhs != has_rhs || !IsSameCommand(lhs_command, rhs_command))
+        {
+            MockCommandDiff diff;
+            diff.command_index = index;
+            diff.lhs = has_lhs ? DescribeMockCommand(lhs_command, lhs_registry) : "";
+            diff.rhs = has_rhs ? DescribeMockCommand(rhs_command, rhs_registry) : "";
+            diffs.push_back(diff);
+        }
+
+        ++index;
+    }
+
+    return diffs;
+}
+
+bool MockCommandValidator::Validate(const MockCommandStream& stream)
+{
+    m_resources.clear();
+    m_scratchRanges.clear();
+    m_errors.clear();
+    m_commandIndex = 0;
+
+    bool in_render_pass = false;
+    bool has_graphics_pso = false;
+    bool has_index_buffer = false;
+
+    MockCommandStream::Command command;
+    size_t offset = 0;
+    while (stream.Read(offset, command))
+    {
+        const uint32_t* args = command.args;
+
+        switch (command.type)
+        {
+        case MockCommand::BeginCommandList:
+        case MockCommand::ResetState:
+            if (in_render_pass)
+            {
+                Error(command, "the previous render pass is not ended");
+                in_render_pass = false;
+            }
+            has_graphics_pso = false;
+            has_index_buffer = false;
+            break;
+        case MockCommand::TextureBarrier:
+            Barrier(command, args[0], args[1], args[2], args[3]);
+            break;
+        case MockCommand::BufferBarrier:
+            Barrier(command, args[0], 0, args[1], args[2]);
+            break;
+        case MockCommand::GlobalBarrier:
+            for (auto iter = m_resources.begin(); iter != m_resources.end(); ++iter)
+            {
+                iter->second.pending_clear = false;
+            }
+
+            if (args[0] & GfxAccessASWrite)
+            {
+                m_scratchRanges.clear();
+            }
+            break;
+        case MockCommand::BeginRenderPass:
+        {
+            if (in_render_pass)
+            {
+                Error(command, "render passes can not be nested");
+            }
+            in_render_pass = true;
+
+            uint32_t color_count = args[0];
+            bool depth_read_only = args[1] != 0;
+            for (uint32_t i = 0; i < color_count; ++i)
+            {
+                CheckAccess(command, args[2 + i * 2], args[3 + i * 2], GfxAccessRTV);
+            }
+
+            const uint32_t* depth = args + 2 + color_count * 2;
+            if (depth[0] != GFX_INVALID_RESOURCE)
+            {
+                CheckAccess(command, depth[0], depth[1], depth_read_only ? GfxAccessMaskDSV : GfxAccessDSV);
+            }
+            break;
+        }
+        case MockCommand::EndRenderPass:
+            if (!in_render_pass)
+            {
+                Error(command, "no render pass to end");
+            }
+            in_render_pass = false;
+            break;
+        case MockCommand::SetPipelineState:
+            //args[1] : 0 graphics, 1 mesh shading, 2 compute
+            if (args[1] != 2)
+            {
+                has_graphics_pso = true;
+            }
+            break;
+        case MockCommand::SetIndexBuffer:
+            CheckAccess(command, args[0], 0, GfxAccessIndexBuffer);
+            has_index_buffer = true;
+            break;
+        case MockCommand::Draw:
+        case MockCommand::DrawIndexed:
+        case MockCommand::DispatchMesh:
+        case MockCommand::DrawIndirect:
+        case MockCommand::DrawIndexedIndirect:
+        case MockCommand::DispatchMeshIndirect:
+        case MockCommand::MultiDrawIndirect:
+        case MockCommand::MultiDrawIndexedIndirect:
+        case MockCommand::MultiDispatchMeshIndirect:
+        {
+            if (!in_render_pass)
+            {
+                Error(command, "draw outside of a render pass");
+            }
+
+            if (!has_graphics_pso)
+            {
+                Error(command, "draw without a graphics pipeline state");
+            }
+
+            bool indexed = command.type == MockCommand::DrawIndexed ||
+                command.type == MockCommand::DrawIndexedIndirect ||
+                command.type == MockCommand::MultiDrawIndexedIndirect;
+            if (indexed && !has_index_buffer)
+            {
+                Error(command, "indexed draw without an index buffer");
+            }
+
+            if (command.type == MockCommand::DrawIndirect ||
+                command.type == MockCommand::DrawIndexedIndirect ||
+                command.type == MockCommand::DispatchMeshIndirect)
+            {
+                CheckAccess(command, args[0], 0, GfxAccessIndirectArgs);
+            }
+            else if (command.type == MockCommand::MultiDrawIndirect ||
+                command.type == MockCommand::MultiDrawIndexedIndirect ||
+                command.type == MockCommand::MultiDispatchMeshIndirect)
+            {
+                CheckAccess(command, args[1], 0, GfxAccessIndirectArgs);
+                CheckAccess(command, args[3], 0, GfxAccessIndirectArgs);
+            }
+
+            CheckPendingClears(command);
+            break;
+        }
+        case MockCommand::Dispatch:
+        case MockCommand::DispatchIndirect:
+        case MockCommand::MultiDispatchIndirect:
+            if (in_render_pass)
+            {
+                Error(command, "dispatch inside of a render pass");
+            }
+
+            if (command.type == MockCommand::DispatchIndirect)
+            {
+                CheckAccess(command, args[0], 0, GfxAccessIndirectArgs);
+            }
+            else if (command.type == MockCommand::MultiDispatchIndirect)
+            {
+                CheckAccess(command, args[1], 0, GfxAccessIndirectArgs);
+                CheckAccess(command, args[3], 0, GfxAccessIndirectArgs);
+            }
+
+            CheckPendingClears(command);
+            break;
+        case MockCommand::CopyBufferToTexture:
+            CheckAccess(command, args[0], args[1], GfxAccessCopyDst);
+            CheckAccess(command, args[2], 0, GfxAccessCopySrc);
+            CheckPendingClears(command);
+            break;
+        case MockCommand::CopyTextureToBuffer:
+            CheckAccess(command, args[0], 0, GfxAccessCopyDst);
+            CheckAccess(command, args[2], args[3], GfxAccessCopySrc);
+            CheckPendingClears(command);
+            break;
+        case MockCommand::CopyBuffer:
+            CheckAccess(command, args[0], 0, GfxAccessCopyDst);
+            CheckAccess(command, args[2], 0, GfxAccessCopySrc);
+            CheckPendingClears(command);
+            break;
+        case MockCommand::CopyTexture:
+            CheckAccess(command, args[0], args[1], GfxAccessCopyDst);
+            CheckAccess(command, args[2], args[3], GfxAccessCopySrc);
+            CheckPendingClears(command);
+            break;
+        case MockCommand::ClearUAV:
+        {
+            //[resource, sub resource, uav, heap index, resource of the uav]
+            CheckAccess(command, args[0], args[1], GfxAccessClearUAV | GfxAccessMaskUAV);
+
+            if (args[3] >= GFX_MAX_RESOURCE_DESCRIPTOR_COUNT)
+            {
+                Error(command, fmt::format("descriptor heap index {} is out of range", args[3]).c_str());
+            }
+
+            if (args[4] != args[0])
+            {
+                Error(command, "the uav does not belong to the cleared resource");
+            }
+
+            if (args[0] != GFX_INVALID_RESOURCE)
+            {
+                m_resources[args[0]].pending_clear = true;
+            }
+            break;
+        }
+        case MockCommand::BuildRayTracingBLAS:
+        case MockCommand::UpdateRayTracingBLAS:
+        case MockCommand::RebuildRayTracingBLAS:
+        case MockCommand::BuildRayTracingTLAS:
+        case MockCommand::UpdateRayTracingTLAS:
+        case MockCommand::CompactRayTracingBLAS:
+            if (in_render_pass)
+            {
+                Error(command, "acceleration structure build inside of a render pass");
+            }
+
+            if ((command.type == MockCommand::BuildRayTracingBLAS || command.type == MockCommand::RebuildRayTracingBLAS) && args[1] != GFX_INVALID_RESOURCE)
+            {
+                //[blas, scratch buffer, scratch offset, scratch size]
+                CheckScratchOverlap(command, args[1], args[2], args[3]);
+            }
+            CheckPendingClears(command);
+            break;
+        case MockCommand::WriteRayTracingBLASCompactedSize:
+            if (in_render_pass)
+            {
+                Error(command, "acceleration structure query inside of a render pass");
+            }
+            CheckAccess(command, args[1], 0, GfxAccessComputeUAV);
+            break;
+        default:
+            break;
+        }
+
+        ++m_commandIndex;
+    }
+
+    if (offset != stream.GetSize())
+    {
+        m_errors.push_back(fmt::format("corrupted stream at byte {}", offset).c_str());
+    }
+
+    if (in_render_pass)
+    {
+        m_errors.push_back("the last render pass is not ended");
+    }
+
+    return m_errors.empty();
+}
+
+GfxAccessFlags MockCommandValidator::GetAccess(uint32_t resource, uint32_t sub_resource) const
+{
+    auto iter = m_resources.find(resource);
+    if (iter == m_resources.end())
+    {
+        return 0;
+    }
+
+    const ResourceState& state = iter->second;
+
+    auto sub_iter = state.sub_resources.find(sub_resource);
+    if (sub_iter != state.sub_resources.end())
+    {
+        return sub_iter->second;
+    }
+    return state.whole;
+}
+
+void MockCommandValidator::Barrier(const MockCommandStream::Command& command, uint32_t resource, uint32_t sub_resource, GfxAccessFlags before, GfxAccessFlags after)
+{
+    if (resource == GFX_INVALID_RESOURCE)
+    {
+        Error(command, "barrier on a null resource");
+        return;
+    }
+
+    ResourceState& state = m_resources[resource];
+    state.pending_clear = false;
+
+    //aliasing barriers discard the previous content, the tracked access does not matter
+    bool check = !(before & GfxAccessDiscard);
+
+    if (sub_resource == GFX_ALL_SUB_RESOURCE)
+    {
+        if (check)
+        {
+            if (state.whole != 0 && state.whole != before)
+            {
+                Error(command, fmt::format("access_before {:#x} does not match the tracked access {:#x}", before, state.whole).c_str());
+            }
+
+            for (auto iter = state.sub_resources.begin(); iter != state.sub_resources.end(); ++iter)
+            {
+                if (iter->second != before)
+                {
+                    Error(command, fmt::format("access_before {:#x} does not match the tracked access {:#x} of sub resource {}", before, iter->second, iter->first).c_str());
+                }
+            }
+        }
+
+        state.whole = after;
+        state.sub_resources.clear();
+    }
+    else
+    {
+        GfxAccessFlags current = GetAccess(resource, sub_resource);
+        if (check && current != 0 && current != before)
+        {
+            Error(command, fmt::format("access_before {:#x} does not match the tracked access {:#x}", before, current).c_str());
+        }
+
+        state.sub_resources[sub_resource] = after;
+    }
+}
+
+void MockCommandValidator::CheckAccess(const MockCommandStream::Command& command, uint32_t resource, uint32_t sub_resource, GfxAccessFlags required)
+{
+    if (resource == GFX_INVALID_RESOURCE)
+    {
+        Error(command, "null resource");
+        return;
+    }
+
+    //resources which have no barrier in this frame are in their initial access, which is not recorded
+    GfxAccessFlags access = GetAccess(resource, sub_resource == GFX_ALL_SUB_RESOURCE ? 0 : sub_resource);
+    if (access != 0 && (access & required) == 0)
+    {
+        Error(command, fmt::format("resource #{} is in access {:#x}, requires {:#x}", resource, access, required).c_str());
+    }
+}
+
+void MockCommandValidator::CheckPendingClears(const MockCommandStream::Command& command)
+{
+    for (auto iter = m_resources.begin(); iter != m_resources.end(); ++iter)
+    {
+        if (iter->second.pending_clear)
+        {
+            eastl::string name = m_pRegistry ? m_pRegistry->GetName(iter->first) : "";
+            Error(command, fmt::format("missing uav barrier after ClearUAV of resource #{} '{}'", iter->first, name).c_str());
+
+            iter->second.pending_clear = false;
+        }
+    }
+}
+
+void MockCommandValidator::CheckScratchOverlap(const MockCommandStream::Command& command, uint32_t resource, uint32_t offset, uint32_t size)
+{
+    uint32_t begin = offset;
+    uint32_t end = offset + size;
+
+    for (size_t i = 0; i < m_scratchRanges.size(); ++i)
+    {
+        const auto& range = m_scratchRanges[i];
+        if (range.first == resource && begin < range.second.second && range.second.first < end)
+        {
+            Error(command, fmt::format("scratch memory [{}, {}) overlaps [{}, {}) of another build without a barrier in between",
+                begin, end, range.second.first, range.second.second).c_str());
+            break;
+        }
+    }
+
+    m_scratchRanges.push_back({ resource, { begin, end } });
+}
+
+void MockCommandValidator::Error(const MockCommandStream::Command& command, const eastl::string& message)
+{
+    m_errors.push_back(fmt::format("[{}] {} : {}", m_commandIndex, DescribeMockCommand(command, m_pRegistry), message).c_str());
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "../gfx_defines.h"
+#include "EASTL/hash_map.h"
+#include <initializer_list>
+#include <mutex>
+
+class IGfxResource;
+class MockResourceRegistry;
+
+//the mock backend can record everything submitted to it as a compact binary stream,
+//so a frame can be validated, diffed against a previous capture, or just counted.
+enum class MockCommand : uint8_t
+{
+    BeginCommandList,
+    ResetState,
+
+    TextureBarrier,
+    BufferBarrier,
+    GlobalBarrier,
+
+    BeginRenderPass,
+    EndRenderPass,
+    SetPipelineState,
+    SetIndexBuffer,
+    SetGraphicsConstants,
+    SetComputeConstants,
+
+    Draw,
+    DrawIndexed,
+    Dispatch,
+    DispatchMesh,
+    DrawIndirect,
+    DrawIndexedIndirect,
+    DispatchIndirect,
+    DispatchMeshIndirect,
+    MultiDrawIndirect,
+    MultiDrawIndexedIndirect,
+    MultiDispatchIndirect,
+    MultiDispatchMeshIndirect,
+
+    CopyBufferToTexture,
+    CopyTextureToBuffer,
+    CopyBuffer,
+    CopyTexture,
+    ClearUAV,
+    WriteBuffer,
+    UpdateTileMappings,
+
+    BuildRayTracingBLAS,
+    UpdateRayTracingBLAS,
+    BuildRayTracingTLAS,
+    WriteRayTracingBLASCompactedSize,
+    CompactRayTracingBLAS,
+    UpdateRayTracingTLAS,
+    RebuildRayTracingBLAS,
+
+    Count,
+};
+
+static const uint32_t MOCK_MAX_COMMAND_ARGS = 32;
+
+//a command is stored as : [uint8_t command][uint8_t arg count][arg count * uint32_t]
+//resources are stored as ids from MockResourceRegistry, so captures of different runs can be compared
+class MockCommandStream
+{
+public:
+    struct Command
+    {
+        MockCommand type = MockCommand::Count;
+        uint32_t arg_count = 0;
+        uint32_t args[MOCK_MAX_COMMAND_ARGS] = {};
+    };
+
+    void Clear() { m_data.clear(); }
+    bool IsEmpty() const { return m_data.empty(); }
+    size_t GetSize() const { return m_data.size(); }
+
+    void Write(MockCommand command, std::initializer_list<uint32_t> args);
+    void Write(MockCommand command, const uint32_t* args, uint32_t arg_count);
+    void Append(const MockCommandStream& stream);
+
+    //returns false at the end of the stream, or if the stream is corrupted
+    bool Read(size_t& offset, Command& command) const;
+
+    //the names of the registry are saved along with the stream, and loaded back into the registry if it is not null
+    bool Save(const eastl::string& file, const MockResourceRegistry* registry = nullptr) const;
+    bool Load(const eastl::string& file, MockResourceRegistry* registry = nullptr);
+
+private:
+    eastl::vector<uint8_t> m_data;
+};
+
+//assigns ids to resources in first use order, thread safe
+class MockResourceRegistry
+{
+public:
+    uint32_t GetID(const IGfxResource* resource);
+    eastl::string GetName(uint32_t id) const;
+
+    eastl::vector<eastl::string> GetNames() const;
+    void SetNames(const eastl::vector<eastl::string>& names); //for loaded captures, which have no live resources
+
+    void Clear();
+
+private:
+    mutable std::mutex m_mutex;
+    eastl::hash_map<const IGfxResource*, uint32_t> m_resourceIDs;
+    eastl::vector<eastl::string> m_names;
+};
+
+struct MockFrameStats
+{
+    uint32_t command_lists = 0;
+    uint32_t stream_bytes = 0;
+
+    uint32_t draws = 0;         //including indirect draws
+    uint32_t dispatches = 0;    //including indirect dispatches
+    uint32_t barriers = 0;
+    uint32_t render_passes = 0;
+    uint32_t copies = 0;
+    uint32_t clears = 0;
+    uint32_t ray_tracing_builds = 0;
+    uint32_t blas_compactions = 0;
+    uint32_t blas_scratch_bytes = 0; //external scratch memory used by the blas builds
+    uint32_t tlas_refits = 0;
+    uint32_t blas_refits = 0;
+    uint32_t blas_rebuilds = 0; //of updatable blases from new vertices
+
+    //"changes" counts every bind call, "redundant" the ones which set what is already bound
+    uint32_t pso_changes = 0;
+    uint32_t redundant_pso_changes = 0;
+    uint32_t constant_changes = 0;
+    uint32_t redundant_constant_changes = 0;
+    uint32_t index_buffer_changes = 0;
+    uint32_t redundant_index_buffer_changes = 0;
+
+    uint32_t GetStateChanges() const { return pso_changes + constant_changes + index_buffer_changes; }
+};
+
+struct MockCommandDiff
+{
+    uint32_t command_index = 0;
+    eastl::string lhs; //empty if the command is missing on this side
+    eastl::string rhs;
+};
+
+eastl::string DescribeMockCommand(const MockCommandStream::Command& command, const MockResourceRegistry* registry = nullptr);
+
+MockFrameStats CalcMockFrameStats(const MockCommandStream& stream);
+
+//returns the mismatched commands of the two streams, up to max_count
+//rhs_registry defaults to lhs_registry, for two streams of the same run
+eastl::vector<MockCommandDiff> DiffMockCommandStreams(const MockCommandStream& lhs, const MockCommandStream& rhs, uint32_t max_count = 32,
+    const MockResourceRegistry* lhs_registry = nullptr, const MockResourceRegistry* rhs_registry = nullptr);
+
+//tracks the access of each resource from the barriers, and reports :
+//  - barriers whose access_before does not match the tracked access
+//  - copies, clears, render targets, index buffers and indirect args used in a wrong access
+//  - draws or dispatches after ClearUAV without a barrier in between (missing UAV barrier)
+//  - descriptors out of range or not matching the cleared resource
+//  - draws without a pso or outside a render pass, dispatches inside a render pass
+//  - blas builds whose scratch memory overlaps another build without a barrier in between
+class MockCommandValidator
+{
+public:
+    MockCommandValidator(const MockResourceRegistry* registry = nullptr) : m_pRegistry(registry) {}
+
+    //returns false if any error was found
+    bool Validate(const MockCommandStream& stream);
+
+    const eastl::vector<eastl::string>& GetErrors() const { return m_errors; }
+
+private:
+    struct ResourceState
+    {
+        GfxAccessFlags whole = 0; //0 : unknown
+        eastl::hash_map<uint32_t, GfxAccessFlags> sub_resources;
+        bool pending_clear = false;
+    };
+
+    GfxAccessFlags GetAccess(uint32_t resource, uint32_t sub_resource) const;
+    void Barrier(const MockCommandStream::Command& command, uint32_t resource, uint32_t sub_resource, GfxAccessFlags before, GfxAccessFlags after);
+    void CheckAccess(const MockCommandStream::Command& command, uint32_t resource, uint32_t sub_resource, GfxAccessFlags required);
+    void CheckPendingClears(const MockCommandStream::Command& command);
+    void CheckScratchOverlap(const MockCommandStream::Command& command, uint32_t resource, uint32_t offset, uint32_t size);
+    void Error(const MockCommandStream::Command& command, const eastl::string& message);
+
+private:
+    const MockResourceRegistry* m_pRegistry = nullptr;
+    eastl::hash_map<uint32_t, ResourceState> m_resources;
+    eastl::vector<eastl::pair<uint32_t, eastl::pair<uint32_t, uint32_t>>> m_scratchRanges; //resource -> [begin, end), since the last barrier
+    eastl::vector<eastl::string> m_errors;
+    uint32_t m_commandIndex = 0;
+};
@@ -11,10 +11,12 @@ MockShaderResourceView::MockShaderResourceView(MockDevice* pDevice, IGfxResource
 
 MockShaderResourceView::~MockShaderResourceView()
 {
+    ((MockDevice*)m_pDevice)->DeleteResourceDescriptor(m_heapIndex);
 }
 
 bool MockShaderResourceView::Create()
 {
+    m_heapIndex = ((MockDevice*)m_pDevice)->AllocateResourceDescriptor();
     return true;
 }
 
@@ -25,7 +27,7 @@ void* MockShaderResourceView::GetHandle() const
 
 uint32_t MockShaderResourceView::GetHeapIndex() const
 {
-    return 0;
+    return m_heapIndex;
 }
 
 MockUnorderedAccessView::MockUnorderedAccessView(MockDevice* pDevice, IGfxResource* pResource, const GfxUnorderedAccessViewDesc& desc, const eastl::string& name)
@@ -38,10 +40,12 @@ MockUnorderedAccessView::MockUnorderedAccessView(MockDevice* pDevice, IGfxResour
 
 MockUnorderedAccessView::~MockUnorderedAccessView()
 {
+    ((MockDevice*)m_pDevice)->DeleteResourceDescriptor(m_heapIndex);
 }
 
 bool MockUnorderedAccessView::Create()
 {
+    m_heapIndex = ((MockDevice*)m_pDevice)->AllocateResourceDescriptor();
     return true;
 }
 
@@ -52,7 +56,7 @@ void* MockUnorderedAccessView::GetHandle() const
 
 uint32_t MockUnorderedAccessView::GetHeapIndex() const
 {
-    return 0;
+    return m_heapIndex;
 }
 
 MockConstantBufferView::MockConstantBufferView(MockDevice* pDevice, IGfxBuffer* buffer, const GfxConstantBufferViewDesc& desc, const eastl::string& name)
@@ -65,10 +69,12 @@ MockConstantBufferView::MockConstantBufferView(MockDevice* pDevice, IGfxBuffer*
 
 MockConstantBufferView::~MockConstantBufferView()
 {
+    ((MockDevice*)m_pDevice)->DeleteResourceDescriptor(m_heapIndex);
 }
 
 bool MockConstantBufferView::Create()
 {
+    m_heapIndex = ((MockDevice*)m_pDevice)->AllocateResourceDescriptor();
     return true;
 }
 
@@ -79,7 +85,7 @@ void* MockConstantBufferView::GetHandle() const
 
 uint32_t MockConstantBufferView::GetHeapIndex() const
 {
-    return 0;
+    return m_heapIndex;
 }
 
 MockSampler::MockSampler(MockDevice* pDevice, const GfxSamplerDesc& desc, const eastl::string& name)
@@ -91,10 +97,12 @@ MockSampler::MockSampler(MockDevice* pDevice, const GfxSamplerDesc& desc, const
 
 MockSampler::~MockSampler()
 {
+    ((MockDevice*)m_pDevice)->DeleteSampler(m_heapIndex);
 }
 
 bool MockSampler::Create()
 {
+    m_heapIndex = ((MockDevice*)m_pDevice)->AllocateSampler();
     return true;
 }
 
@@ -105,5 +113,5 @@ void* MockSampler::GetHandle() const
 
 uint32_t MockSampler::GetHeapIndex() const
 {
-    return 0;
+    return m_heapIndex;
 }
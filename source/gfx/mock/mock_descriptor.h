@@ -18,6 +18,7 @@ public:
 private:
     IGfxResource* m_pResource = nullptr;
     GfxShaderResourceViewDesc m_desc = {};
+    uint32_t m_heapIndex = GFX_INVALID_RESOURCE;
 };
 
 class MockUnorderedAccessView : public IGfxDescriptor
@@ -31,9 +32,12 @@ public:
     virtual void* GetHandle() const override;
     virtual uint32_t GetHeapIndex() const override;
 
+    IGfxResource* GetResource() const { return m_pResource; }
+
 private:
     IGfxResource* m_pResource = nullptr;
     GfxUnorderedAccessViewDesc m_desc = {};
+    uint32_t m_heapIndex = GFX_INVALID_RESOURCE;
 };
 
 class MockConstantBufferView : public IGfxDescriptor
@@ -50,6 +54,7 @@ public:
 private:
     IGfxBuffer* m_pBuffer = nullptr;
     GfxConstantBufferViewDesc m_desc = {};
+    uint32_t m_heapIndex = GFX_INVALID_RESOURCE;
 };
 
 class MockSampler : public IGfxDescriptor
@@ -65,4 +70,5 @@ public:
 
 private:
     GfxSamplerDesc m_desc;
+    uint32_t m_heapIndex = GFX_INVALID_RESOURCE;
 };
\ No newline at end of file
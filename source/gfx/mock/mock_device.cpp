@@ -11,6 +11,8 @@
 #include "mock_rt_blas.h"
 #include "mock_rt_tlas.h"
 #include "../gfx.h"
+#include "utils/assert.h"
+#include "utils/log.h"
 
 MockDevice::MockDevice(const GfxDeviceDesc& desc)
 {
@@ -37,6 +39,11 @@ void MockDevice::BeginFrame()
 
 void MockDevice::EndFrame()
 {
+    if (m_bRecording)
+    {
+        EndFrameRecording();
+    }
+
     ++m_frameID;
 }
 
@@ -242,3 +249,141 @@ bool MockDevice::DumpMemoryStats(const eastl::string& file)
 {
     return false;
 }
+
+GfxRayTracingBLASSizes MockDevice::GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc)
+{
+    return MockRayTracingBLAS::GetSizes(desc);
+}
+
+void MockDevice::PlaceAccelerationStructure(const IGfxBuffer* buffer, uint32_t offset, uint32_t size, const eastl::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_placementMutex);
+
+    eastl::hash_map<uint32_t, uint32_t>& placements = m_placedAS[buffer];
+    for (auto iter = placements.begin(); iter != placements.end(); ++iter)
+    {
+        if (offset < iter->first + iter->second && iter->first < offset + size)
+        {
+            ReportError(fmt::format("{} [{}, {}) overlaps a live acceleration structure at [{}, {}) of {}",
+                name, offset, offset + size, iter->first, iter->first + iter->second, buffer->GetName()).c_str());
+            break;
+        }
+    }
+
+    placements[offset] = size;
+}
+
+void MockDevice::RemoveAccelerationStructure(const IGfxBuffer* buffer, uint32_t offset)
+{
+    std::lock_guard<std::mutex> lock(m_placementMutex);
+
+    auto iter = m_placedAS.find(buffer);
+    if (iter != m_placedAS.end())
+    {
+        iter->second.erase(offset);
+    }
+}
+
+void MockDevice::ReportError(const eastl::string& message)
+{
+    RE_ERROR("[MockDevice] {}", message);
+
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+    m_totalErrorCount++;
+}
+
+uint32_t MockDevice::AllocateResourceDescriptor()
+{
+    std::lock_guard<std::mutex> lock(m_descriptorMutex);
+
+    if (!m_freeResourceDescriptors.empty())
+    {
+        uint32_t index = m_freeResourceDescriptors.back();
+        m_freeResourceDescriptors.pop_back();
+        return index;
+    }
+
+    RE_ASSERT(m_nResourceDescriptorCount < GFX_MAX_RESOURCE_DESCRIPTOR_COUNT);
+    return m_nResourceDescriptorCount++;
+}
+
+uint32_t MockDevice::AllocateSampler()
+{
+    std::lock_guard<std::mutex> lock(m_descriptorMutex);
+
+    if (!m_freeSamplers.empty())
+    {
+        uint32_t index = m_freeSamplers.back();
+        m_freeSamplers.pop_back();
+        return index;
+    }
+
+    RE_ASSERT(m_nSamplerCount < GFX_MAX_SAMPLER_DESCRIPTOR_COUNT);
+    return m_nSamplerCount++;
+}
+
+void MockDevice::DeleteResourceDescriptor(uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(m_descriptorMutex);
+
+    if (index != GFX_INVALID_RESOURCE)
+    {
+        m_freeResourceDescriptors.push_back(index);
+    }
+}
+
+void MockDevice::DeleteSampler(uint32_t index)
+{
+    std::lock_guard<std::mutex> lock(m_descriptorMutex);
+
+    if (index != GFX_INVALID_RESOURCE)
+    {
+        m_freeSamplers.push_back(index);
+    }
+}
+
+void MockDevice::EnableCommandRecording(bool enable, const eastl::string& capture_path)
+{
+    m_bRecording = enable;
+    m_capturePath = capture_path;
+
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+    m_frameStream.Clear();
+}
+
+void MockDevice::SubmitCommandStream(const MockCommandStream& stream)
+{
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+    m_frameStream.Append(stream);
+}
+
+void MockDevice::EndFrameRecording()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        eastl::swap(m_lastFrameStream, m_frameStream);
+        m_frameStream.Clear();
+    }
+
+    m_lastFrameStats = CalcMockFrameStats(m_lastFrameStream);
+
+    MockCommandValidator validator(&m_resourceRegistry);
+    validator.Validate(m_lastFrameStream);
+    m_lastFrameErrors = validator.GetErrors();
+    m_totalErrorCount += (uint32_t)m_lastFrameErrors.size();
+
+    const uint32_t max_logged_errors = 16;
+    for (size_t i = 0; i < eastl::min(m_lastFrameErrors.size(), (size_t)max_logged_errors); ++i)
+    {
+        RE_WARN("[MockDevice] frame {} : {}", m_frameID, m_lastFrameErrors[i]);
+    }
+
+    if (!m_capturePath.empty())
+    {
+        eastl::string file = m_capturePath + fmt::format("frame_{}.bin", m_frameID).c_str();
+        if (!m_lastFrameStream.Save(file, &m_resourceRegistry))
+        {
+            RE_ERROR("[MockDevice] failed to save the command stream : {}", file);
+        }
+    }
+}
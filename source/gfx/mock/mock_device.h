@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../gfx_device.h"
+#include "mock_command_stream.h"
 
 class MockDevice : public IGfxDevice
 {
@@ -31,5 +32,53 @@ public:
     virtual IGfxRayTracingTLAS* CreateRayTracingTLAS(const GfxRayTracingTLASDesc& desc, const eastl::string& name) override;
 
     virtual uint32_t GetAllocationSize(const GfxTextureDesc& desc) override;
+    virtual GfxRayTracingBLASSizes GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc) override;
     virtual bool DumpMemoryStats(const eastl::string& file) override;
+
+    uint32_t AllocateResourceDescriptor();
+    uint32_t AllocateSampler();
+    void DeleteResourceDescriptor(uint32_t index);
+    void DeleteSampler(uint32_t index);
+
+    //command stream recording, each frame is validated in EndFrame and the errors are logged
+    void EnableCommandRecording(bool enable, const eastl::string& capture_path = "");
+    bool IsCommandRecordingEnabled() const { return m_bRecording; }
+    void SubmitCommandStream(const MockCommandStream& stream);
+
+    //placed acceleration structures, an overlap of two live ones is counted as a validation error
+    void PlaceAccelerationStructure(const IGfxBuffer* buffer, uint32_t offset, uint32_t size, const eastl::string& name);
+    void RemoveAccelerationStructure(const IGfxBuffer* buffer, uint32_t offset);
+
+    //misuse found outside of the command streams, e.g. by the resources
+    void ReportError(const eastl::string& message);
+
+    MockResourceRegistry* GetResourceRegistry() { return &m_resourceRegistry; }
+    const MockCommandStream& GetLastFrameStream() const { return m_lastFrameStream; }
+    const MockFrameStats& GetLastFrameStats() const { return m_lastFrameStats; }
+    const eastl::vector<eastl::string>& GetLastFrameErrors() const { return m_lastFrameErrors; }
+    uint32_t GetTotalErrorCount() const { return m_totalErrorCount; }
+
+private:
+    void EndFrameRecording();
+
+private:
+    std::mutex m_descriptorMutex; //the descriptors are created and released from the task threads
+    uint32_t m_nResourceDescriptorCount = 0;
+    uint32_t m_nSamplerCount = 0;
+    eastl::vector<uint32_t> m_freeResourceDescriptors;
+    eastl::vector<uint32_t> m_freeSamplers;
+
+    bool m_bRecording = false;
+    eastl::string m_capturePath; //saves the stream of every frame if not empty
+
+    std::mutex m_streamMutex;
+    MockResourceRegistry m_resourceRegistry;
+    MockCommandStream m_frameStream;
+    MockCommandStream m_lastFrameStream;
+    MockFrameStats m_lastFrameStats;
+    eastl::vector<eastl::string> m_lastFrameErrors;
+    uint32_t m_totalErrorCount = 0;
+
+    std::mutex m_placementMutex;
+    eastl::hash_map<const IGfxBuffer*, eastl::hash_map<uint32_t, uint32_t>> m_placedAS; //buffer -> offset -> size
 };
\ No newline at end of file
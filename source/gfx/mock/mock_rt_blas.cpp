@@ -1,5 +1,17 @@
 #include "mock_rt_blas.h"
 #include "mock_device.h"
+#include "../gfx_buffer.h"
+#include "utils/math.h"
+
+static uint32_t GetTriangleCount(const GfxRayTracingBLASDesc& desc)
+{
+    uint32_t triangle_count = 0;
+    for (size_t i = 0; i < desc.geometries.size(); ++i)
+    {
+        triangle_count += desc.geometries[i].index_count / 3;
+    }
+    return triangle_count;
+}
 
 MockRayTracingBLAS::MockRayTracingBLAS(MockDevice* pDevice, const GfxRayTracingBLASDesc& desc, const eastl::string& name)
 {
@@ -10,10 +22,28 @@ MockRayTracingBLAS::MockRayTracingBLAS(MockDevice* pDevice, const GfxRayTracingB
 
 MockRayTracingBLAS::~MockRayTracingBLAS()
 {
+    if (m_desc.storage_buffer)
+    {
+        ((MockDevice*)m_pDevice)->RemoveAccelerationStructure(m_desc.storage_buffer, m_desc.storage_offset);
+    }
 }
 
 bool MockRayTracingBLAS::Create()
 {
+    m_sizes = GetSizes(m_desc);
+    m_nTriangleCount = GetTriangleCount(m_desc);
+
+    if (m_desc.storage_buffer)
+    {
+        uint32_t size = m_desc.storage_size != 0 ? m_desc.storage_size : m_sizes.as_size;
+
+        RE_ASSERT(m_desc.storage_buffer->GetDesc().usage & GfxBufferUsageAccelerationStructure);
+        RE_ASSERT(m_desc.storage_offset % GFX_RT_AS_ALIGNMENT == 0);
+        RE_ASSERT(m_desc.storage_offset + size <= m_desc.storage_buffer->GetDesc().size);
+
+        ((MockDevice*)m_pDevice)->PlaceAccelerationStructure(m_desc.storage_buffer, m_desc.storage_offset, size, m_name);
+    }
+
     return true;
 }
 
@@ -21,3 +51,19 @@ void* MockRayTracingBLAS::GetHandle() const
 {
     return nullptr;
 }
+
+uint32_t MockRayTracingBLAS::GetCompactedSize() const
+{
+    return RoundUpPow2(256 + m_nTriangleCount * 36, GFX_RT_AS_ALIGNMENT);
+}
+
+GfxRayTracingBLASSizes MockRayTracingBLAS::GetSizes(const GfxRayTracingBLASDesc& desc)
+{
+    uint32_t triangle_count = GetTriangleCount(desc);
+
+    GfxRayTracingBLASSizes sizes;
+    sizes.as_size = RoundUpPow2(256 + triangle_count * 64, GFX_RT_AS_ALIGNMENT);
+    sizes.build_scratch_size = RoundUpPow2(256 + triangle_count * 32, GFX_RT_AS_ALIGNMENT);
+    sizes.update_scratch_size = RoundUpPow2(256 + triangle_count * 8, GFX_RT_AS_ALIGNMENT);
+    return sizes;
+}
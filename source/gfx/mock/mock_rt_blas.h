@@ -13,4 +13,14 @@ public:
     bool Create();
 
     virtual void* GetHandle() const override;
-};
\ No newline at end of file
+
+    const GfxRayTracingBLASSizes& GetSizes() const { return m_sizes; }
+    uint32_t GetCompactedSize() const;
+
+    //simulated from the triangle count, a compacted blas is a bit more than half of its prebuild size
+    static GfxRayTracingBLASSizes GetSizes(const GfxRayTracingBLASDesc& desc);
+
+private:
+    GfxRayTracingBLASSizes m_sizes = {};
+    uint32_t m_nTriangleCount = 0;
+};
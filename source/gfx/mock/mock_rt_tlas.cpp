@@ -1,5 +1,6 @@
 #include "mock_rt_tlas.h"
 #include "mock_device.h"
+#include "utils/fmt.h"
 
 MockRayTracingTLAS::MockRayTracingTLAS(MockDevice* pDevice, const GfxRayTracingTLASDesc& desc, const eastl::string& name)
 {
@@ -21,3 +22,43 @@ void* MockRayTracingTLAS::GetHandle() const
 {
     return nullptr;
 }
+
+void MockRayTracingTLAS::OnBuild(const GfxRayTracingInstance* instances, uint32_t instance_count)
+{
+    MockDevice* device = (MockDevice*)m_pDevice;
+    if (instance_count > m_desc.instance_count)
+    {
+        device->ReportError(fmt::format("{} is built with {} instances, created for {}", m_name, instance_count, m_desc.instance_count).c_str());
+    }
+
+    m_builtBLASes.resize(instance_count);
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        m_builtBLASes[i] = instances[i].blas;
+    }
+    m_bBuilt = true;
+}
+
+void MockRayTracingTLAS::OnUpdate(const GfxRayTracingInstance* instances, uint32_t instance_count)
+{
+    MockDevice* device = (MockDevice*)m_pDevice;
+    if (!(m_desc.flags & GfxRayTracingASFlagAllowUpdate))
+    {
+        device->ReportError(fmt::format("{} is refitted without GfxRayTracingASFlagAllowUpdate", m_name).c_str());
+    }
+
+    if (!m_bBuilt || instance_count != (uint32_t)m_builtBLASes.size())
+    {
+        device->ReportError(fmt::format("{} is refitted with {} instances, the last build had {}", m_name, instance_count, m_builtBLASes.size()).c_str());
+        return;
+    }
+
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        if (instances[i].blas != m_builtBLASes[i])
+        {
+            device->ReportError(fmt::format("{} is refitted with a different blas for instance {}", m_name, i).c_str());
+            return;
+        }
+    }
+}
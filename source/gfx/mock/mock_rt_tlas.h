@@ -12,5 +12,13 @@ public:
 
     bool Create();
 
+    //the instances of the last build, a refit is checked against them
+    void OnBuild(const GfxRayTracingInstance* instances, uint32_t instance_count);
+    void OnUpdate(const GfxRayTracingInstance* instances, uint32_t instance_count);
+
     virtual void* GetHandle() const override;
+
+private:
+    eastl::vector<const IGfxRayTracingBLAS*> m_builtBLASes;
+    bool m_bBuilt = false;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "mock_texture.h"
 #include "mock_device.h"
 #include "../gfx.h"
+#include "utils/math.h"
 
 MockTexture::MockTexture(MockDevice* pDevice, const GfxTextureDesc& desc, const eastl::string& name)
 {
@@ -36,14 +37,101 @@ uint32_t MockTexture::GetRowPitch(uint32_t mip_level) const
     return GetFormatRowPitch(m_desc.format, width) * GetFormatBlockHeight(m_desc.format);
 }
 
+//follows the D3D12 standard tile shapes : 64KB tiles, as square as possible with width >= height,
+//mips smaller than a tile in any dimension are packed together
+bool MockTexture::GetTileShape(uint32_t& tile_width, uint32_t& tile_height) const
+{
+    uint32_t block_width = GetFormatBlockWidth(m_desc.format);
+    uint32_t block_height = GetFormatBlockHeight(m_desc.format);
+    uint32_t block_size = GetFormatRowPitch(m_desc.format, block_width);
+
+    if (m_desc.alloc_type != GfxAllocationType::Sparse || m_desc.type != GfxTextureType::Texture2D ||
+        block_size == 0 || !IsPow2(block_size))
+    {
+        return false;
+    }
+
+    uint32_t block_count_log2 = (uint32_t)log2f((float)(GFX_TILE_SIZE / block_size));
+    tile_width = (1 << ((block_count_log2 + 1) / 2)) * block_width;
+    tile_height = (1 << (block_count_log2 / 2)) * block_height;
+    return true;
+}
+
+uint32_t MockTexture::GetStandardMips(uint32_t tile_width, uint32_t tile_height) const
+{
+    uint32_t standard_mips = 0;
+    for (uint32_t mip = 0; mip < m_desc.mip_levels; ++mip)
+    {
+        if ((m_desc.width >> mip) < tile_width || (m_desc.height >> mip) < tile_height)
+        {
+            break;
+        }
+        ++standard_mips;
+    }
+    return standard_mips;
+}
+
 GfxTilingDesc MockTexture::GetTilingDesc() const
 {
-    return GfxTilingDesc();
+    GfxTilingDesc info = {};
+
+    uint32_t tile_width, tile_height;
+    if (!GetTileShape(tile_width, tile_height))
+    {
+        return info;
+    }
+
+    info.tile_width = tile_width;
+    info.tile_height = tile_height;
+    info.tile_depth = 1;
+    info.standard_mips = GetStandardMips(tile_width, tile_height);
+    info.packed_mips = m_desc.mip_levels - info.standard_mips;
+
+    for (uint32_t mip = 0; mip < info.standard_mips; ++mip)
+    {
+        info.tile_count += DivideRoudingUp(m_desc.width >> mip, tile_width) * DivideRoudingUp(m_desc.height >> mip, tile_height);
+    }
+
+    uint32_t packed_size = 0;
+    uint32_t block_height = GetFormatBlockHeight(m_desc.format);
+    for (uint32_t mip = info.standard_mips; mip < m_desc.mip_levels; ++mip)
+    {
+        uint32_t height = eastl::max(m_desc.height >> mip, block_height);
+        packed_size += GetRowPitch(mip) * (height / block_height);
+    }
+
+    info.packed_mip_tiles = DivideRoudingUp(packed_size, GFX_TILE_SIZE);
+    info.tile_count = (info.tile_count + info.packed_mip_tiles) * m_desc.array_size;
+
+    return info;
 }
 
 GfxSubresourceTilingDesc MockTexture::GetTilingDesc(uint32_t subresource) const
 {
-    return GfxSubresourceTilingDesc();
+    GfxSubresourceTilingDesc info = {};
+
+    uint32_t tile_width, tile_height;
+    if (!GetTileShape(tile_width, tile_height))
+    {
+        return info;
+    }
+
+    uint32_t mip = subresource % m_desc.mip_levels;
+    uint32_t standard_mips = GetStandardMips(tile_width, tile_height);
+
+    for (uint32_t i = 0; i < eastl::min(mip, standard_mips); ++i)
+    {
+        info.tile_offset += DivideRoudingUp(m_desc.width >> i, tile_width) * DivideRoudingUp(m_desc.height >> i, tile_height);
+    }
+
+    if (mip < standard_mips)
+    {
+        info.width = DivideRoudingUp(m_desc.width >> mip, tile_width);
+        info.height = DivideRoudingUp(m_desc.height >> mip, tile_height);
+        info.depth = 1;
+    }
+
+    return info;
 }
 
 void* MockTexture::GetSharedHandle() const
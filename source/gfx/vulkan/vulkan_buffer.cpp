@@ -43,6 +43,11 @@ bool VulkanBuffer::Create()
         createInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
     }
 
+    if (m_desc.usage & GfxBufferUsageAccelerationStructure)
+    {
+        createInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR;
+    }
+
     if (m_desc.usage & GfxBufferUsageTypedBuffer)
     {
         if (m_desc.usage & GfxBufferUsageUnorderedAccess)
@@ -755,13 +755,19 @@ void VulkanCommandList::MultiDispatchMeshIndirect(uint32_t max_count, IGfxBuffer
         (VkBuffer)count_buffer->GetHandle(), count_buffer_offset, max_count, sizeof(GfxDispatchCommand));
 }
 
-void VulkanCommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas)
+void VulkanCommandList::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
 {
     FlushBarriers();
     
     VkAccelerationStructureBuildGeometryInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
     ((VulkanRayTracingBLAS*)blas)->GetBuildInfo(info);
 
+    if (scratch_buffer)
+    {
+        info.scratchData.deviceAddress = scratch_buffer->GetGpuAddress() + scratch_offset;
+    }
+    RE_ASSERT(info.scratchData.deviceAddress != 0);
+
     const VkAccelerationStructureBuildRangeInfoKHR* rangeInfo = ((VulkanRayTracingBLAS*)blas)->GetBuildRangeInfo();
     vkCmdBuildAccelerationStructuresKHR(m_commandBuffer, 1, &info, &rangeInfo);
 }
@@ -770,21 +776,89 @@ void VulkanCommandList::UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffe
 {
     FlushBarriers();
     
-    VkAccelerationStructureGeometryKHR geometry = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR };
+    eastl::vector<VkAccelerationStructureGeometryKHR> geometries;
     VkAccelerationStructureBuildGeometryInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
-    ((VulkanRayTracingBLAS*)blas)->GetUpdateInfo(info, geometry, vertex_buffer, vertex_buffer_offset);
+    ((VulkanRayTracingBLAS*)blas)->GetUpdateInfo(info, geometries, vertex_buffer, vertex_buffer_offset);
 
     const VkAccelerationStructureBuildRangeInfoKHR* rangeInfo = ((VulkanRayTracingBLAS*)blas)->GetBuildRangeInfo();
     vkCmdBuildAccelerationStructuresKHR(m_commandBuffer, 1, &info, &rangeInfo);
 }
 
+void VulkanCommandList::RebuildRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, IGfxBuffer* scratch_buffer, uint32_t scratch_offset)
+{
+    FlushBarriers();
+
+    eastl::vector<VkAccelerationStructureGeometryKHR> geometries;
+    VkAccelerationStructureBuildGeometryInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
+    ((VulkanRayTracingBLAS*)blas)->GetUpdateInfo(info, geometries, vertex_buffer, vertex_buffer_offset);
+
+    info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    info.srcAccelerationStructure = VK_NULL_HANDLE;
+    info.scratchData.deviceAddress = scratch_buffer->GetGpuAddress() + scratch_offset;
+
+    const VkAccelerationStructureBuildRangeInfoKHR* rangeInfo = ((VulkanRayTracingBLAS*)blas)->GetBuildRangeInfo();
+    vkCmdBuildAccelerationStructuresKHR(m_commandBuffer, 1, &info, &rangeInfo);
+}
+
+void VulkanCommandList::WriteRayTracingBLASCompactedSize(IGfxRayTracingBLAS* blas, IGfxBuffer* buffer, uint32_t offset)
+{
+    FlushBarriers();
+
+    VulkanRayTracingBLAS* vulkanBLAS = (VulkanRayTracingBLAS*)blas;
+    VkAccelerationStructureKHR accelerationStructure = (VkAccelerationStructureKHR)vulkanBLAS->GetHandle();
+    VkQueryPool queryPool = vulkanBLAS->GetCompactedSizeQueryPool();
+    RE_ASSERT(queryPool != VK_NULL_HANDLE);
+
+    vkCmdResetQueryPool(m_commandBuffer, queryPool, 0, 1);
+    vkCmdWriteAccelerationStructuresPropertiesKHR(m_commandBuffer, 1, &accelerationStructure, VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, 0);
+    vkCmdCopyQueryPoolResults(m_commandBuffer, queryPool, 0, 1, (VkBuffer)buffer->GetHandle(), offset, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+    //the copy is a transfer, while the buffer is expected to be accessed as an uav
+    VkMemoryBarrier2 barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+    barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+    VkDependencyInfo dependency = { VK_STRUCTURE_TYPE_DEPENDENCY_INFO };
+    dependency.memoryBarrierCount = 1;
+    dependency.pMemoryBarriers = &barrier;
+    vkCmdPipelineBarrier2(m_commandBuffer, &dependency);
+}
+
+void VulkanCommandList::CompactRayTracingBLAS(IGfxRayTracingBLAS* dst, IGfxRayTracingBLAS* src)
+{
+    FlushBarriers();
+
+    VkCopyAccelerationStructureInfoKHR info = { VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR };
+    info.src = (VkAccelerationStructureKHR)src->GetHandle();
+    info.dst = (VkAccelerationStructureKHR)dst->GetHandle();
+    info.mode = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+
+    vkCmdCopyAccelerationStructureKHR(m_commandBuffer, &info);
+}
+
 void VulkanCommandList::BuildRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
 {
     FlushBarriers();
 
     VkAccelerationStructureGeometryKHR geometry = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR };
     VkAccelerationStructureBuildGeometryInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
-    ((VulkanRayTracingTLAS*)tlas)->GetBuildInfo(info, geometry, instances, instance_count);
+    ((VulkanRayTracingTLAS*)tlas)->GetBuildInfo(info, geometry, instances, instance_count, false);
+
+    VkAccelerationStructureBuildRangeInfoKHR rangeInfo = { instance_count };
+    const VkAccelerationStructureBuildRangeInfoKHR* pRangeInfo = &rangeInfo;
+
+    vkCmdBuildAccelerationStructuresKHR(m_commandBuffer, 1, &info, &pRangeInfo);
+}
+
+void VulkanCommandList::UpdateRayTracingTLAS(IGfxRayTracingTLAS* tlas, const GfxRayTracingInstance* instances, uint32_t instance_count)
+{
+    FlushBarriers();
+
+    VkAccelerationStructureGeometryKHR geometry = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR };
+    VkAccelerationStructureBuildGeometryInfoKHR info = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
+    ((VulkanRayTracingTLAS*)tlas)->GetBuildInfo(info, geometry, instances, instance_count, true);
 
     VkAccelerationStructureBuildRangeInfoKHR rangeInfo = { instance_count };
     const VkAccelerationStructureBuildRangeInfoKHR* pRangeInfo = &rangeInfo;
@@ -340,6 +340,11 @@ uint32_t VulkanDevice::GetAllocationSize(const GfxTextureDesc& desc)
     return (uint32_t)requirements.memoryRequirements.size;
 }
 
+GfxRayTracingBLASSizes VulkanDevice::GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc)
+{
+    return VulkanRayTracingBLAS::GetSizes(this, desc);
+}
+
 bool VulkanDevice::DumpMemoryStats(const eastl::string& file)
 {
     return false;
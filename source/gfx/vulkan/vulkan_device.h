@@ -52,6 +52,7 @@ public:
     virtual IGfxRayTracingTLAS* CreateRayTracingTLAS(const GfxRayTracingTLASDesc& desc, const eastl::string& name) override;
 
     virtual uint32_t GetAllocationSize(const GfxTextureDesc& desc) override;
+    virtual GfxRayTracingBLASSizes GetRayTracingBLASSizes(const GfxRayTracingBLASDesc& desc) override;
     virtual bool DumpMemoryStats(const eastl::string& file) override;
 
     VkInstance GetInstance() const { return m_instance; }
@@ -18,13 +18,34 @@ VulkanRayTracingBLAS::~VulkanRayTracingBLAS()
     device->Delete(m_asBufferAllocation);
     device->Delete(m_scratchBuffer);
     device->Delete(m_scratchBufferAllocation);
+    device->Delete(m_compactedSizeQueryPool);
+}
+
+static VkAccelerationStructureGeometryKHR GetGeometry(const GfxRayTracingGeometry& geometry)
+{
+    VkAccelerationStructureGeometryKHR vkGeometry = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR };
+    vkGeometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
+    vkGeometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
+    vkGeometry.geometry.triangles.vertexFormat = ToVulkanFormat(geometry.vertex_format);
+    vkGeometry.geometry.triangles.vertexData.deviceAddress = geometry.vertex_buffer->GetGpuAddress() + geometry.vertex_buffer_offset;
+    vkGeometry.geometry.triangles.vertexStride = geometry.vertex_stride;
+    vkGeometry.geometry.triangles.maxVertex = geometry.vertex_count - 1;
+    vkGeometry.geometry.triangles.indexType = geometry.index_format == GfxFormat::R16UI ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    vkGeometry.geometry.triangles.indexData.deviceAddress = geometry.index_buffer->GetGpuAddress() + geometry.index_buffer_offset;
+
+    if (geometry.opaque)
+    {
+        vkGeometry.flags |= VK_GEOMETRY_OPAQUE_BIT_KHR;
+    }
+
+    return vkGeometry;
 }
 
 bool VulkanRayTracingBLAS::Create()
 {
     m_geometries.reserve(m_desc.geometries.size());
     m_rangeInfos.reserve(m_desc.geometries.size());
-    
+
     eastl::vector<uint32_t> primitiveCounts;
     primitiveCounts.reserve(m_desc.geometries.size());
 
@@ -32,22 +53,7 @@ bool VulkanRayTracingBLAS::Create()
     {
         const GfxRayTracingGeometry& geometry = m_desc.geometries[i];
 
-        VkAccelerationStructureGeometryKHR vkGeometry = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR };
-        vkGeometry.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
-        vkGeometry.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-        vkGeometry.geometry.triangles.vertexFormat = ToVulkanFormat(geometry.vertex_format);
-        vkGeometry.geometry.triangles.vertexData.deviceAddress = geometry.vertex_buffer->GetGpuAddress() + geometry.vertex_buffer_offset;
-        vkGeometry.geometry.triangles.vertexStride = geometry.vertex_stride;
-        vkGeometry.geometry.triangles.maxVertex = geometry.vertex_count - 1;
-        vkGeometry.geometry.triangles.indexType = geometry.index_format == GfxFormat::R16UI ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
-        vkGeometry.geometry.triangles.indexData.deviceAddress = geometry.index_buffer->GetGpuAddress() + geometry.index_buffer_offset;
-
-        if (geometry.opaque)
-        {
-            vkGeometry.flags |= VK_GEOMETRY_OPAQUE_BIT_KHR;
-        }
-
-        m_geometries.push_back(vkGeometry);
+        m_geometries.push_back(GetGeometry(geometry));
         m_rangeInfos.push_back({ geometry.index_count / 3 });
         primitiveCounts.push_back(geometry.index_count / 3);
     }
@@ -60,27 +66,53 @@ bool VulkanRayTracingBLAS::Create()
     VkAccelerationStructureBuildSizesInfoKHR sizeInfo = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR };
     vkGetAccelerationStructureBuildSizesKHR(device, VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, primitiveCounts.data(), &sizeInfo);
 
-    //todo : better memory allocation and compaction like what RTXMU does
+    VkDeviceSize as_size = m_desc.storage_size != 0 ? m_desc.storage_size : sizeInfo.accelerationStructureSize;
+
+    //placed blases are built with an external scratch buffer, only the update scratch memory is kept
+    VkDeviceSize scratch_size = m_desc.storage_buffer ?
+        ((m_desc.flags & GfxRayTracingASFlagAllowUpdate) ? sizeInfo.updateScratchSize : 0) :
+        eastl::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize);
+
     VmaAllocationCreateInfo allocationInfo = {};
     allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-    
+
     VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-    bufferInfo.size = sizeInfo.accelerationStructureSize;
-    bufferInfo.usage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | 
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | 
+    bufferInfo.usage = VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT |
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
         VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR;
 
     VmaAllocator allocator = ((VulkanDevice*)m_pDevice)->GetVmaAllocator();
-    vmaCreateBuffer(allocator, &bufferInfo, &allocationInfo, &m_asBuffer, &m_asBufferAllocation, nullptr);
-
-    bufferInfo.size = eastl::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize);
-    vmaCreateBuffer(allocator, &bufferInfo, &allocationInfo, &m_scratchBuffer, &m_scratchBufferAllocation, nullptr);
 
     VkAccelerationStructureCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR };
-    createInfo.buffer = m_asBuffer;
-    createInfo.size = sizeInfo.accelerationStructureSize;
+    createInfo.size = as_size;
     createInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
 
+    if (m_desc.storage_buffer)
+    {
+        RE_ASSERT(m_desc.storage_buffer->GetDesc().usage & GfxBufferUsageAccelerationStructure);
+        RE_ASSERT(m_desc.storage_offset % GFX_RT_AS_ALIGNMENT == 0);
+        RE_ASSERT(m_desc.storage_offset + as_size <= m_desc.storage_buffer->GetDesc().size);
+
+        createInfo.buffer = (VkBuffer)m_desc.storage_buffer->GetHandle();
+        createInfo.offset = m_desc.storage_offset;
+    }
+    else
+    {
+        bufferInfo.size = as_size;
+        vmaCreateBuffer(allocator, &bufferInfo, &allocationInfo, &m_asBuffer, &m_asBufferAllocation, nullptr);
+
+        SetDebugName(device, VK_OBJECT_TYPE_BUFFER, m_asBuffer, m_name.c_str());
+        vmaSetAllocationName(allocator, m_asBufferAllocation, m_name.c_str());
+
+        createInfo.buffer = m_asBuffer;
+    }
+
+    if (scratch_size > 0)
+    {
+        bufferInfo.size = scratch_size;
+        vmaCreateBuffer(allocator, &bufferInfo, &allocationInfo, &m_scratchBuffer, &m_scratchBufferAllocation, nullptr);
+    }
+
     VkResult result = vkCreateAccelerationStructureKHR(device, &createInfo, nullptr, &m_accelerationStructure);
     if (result != VK_SUCCESS)
     {
@@ -88,9 +120,16 @@ bool VulkanRayTracingBLAS::Create()
         return false;
     }
 
+    if (m_desc.flags & GfxRayTracingASFlagAllowCompaction)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+        queryPoolInfo.queryType = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+        queryPoolInfo.queryCount = 1;
+
+        vkCreateQueryPool(device, &queryPoolInfo, nullptr, &m_compactedSizeQueryPool);
+    }
+
     SetDebugName(device, VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR, m_accelerationStructure, m_name.c_str());
-    SetDebugName(device, VK_OBJECT_TYPE_BUFFER, m_asBuffer, m_name.c_str());
-    vmaSetAllocationName(allocator, m_asBufferAllocation, m_name.c_str());
 
     return true;
 }
@@ -121,17 +160,51 @@ void VulkanRayTracingBLAS::GetBuildInfo(VkAccelerationStructureBuildGeometryInfo
     }
 }
 
-void VulkanRayTracingBLAS::GetUpdateInfo(VkAccelerationStructureBuildGeometryInfoKHR& info, VkAccelerationStructureGeometryKHR& geometry, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
+void VulkanRayTracingBLAS::GetUpdateInfo(VkAccelerationStructureBuildGeometryInfoKHR& info, eastl::vector<VkAccelerationStructureGeometryKHR>& geometries, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
 {
     RE_ASSERT(m_desc.flags & GfxRayTracingASFlagAllowUpdate);
-    RE_ASSERT(m_geometries.size() == 1); //todo : suppport more than 1
+    RE_ASSERT(m_scratchBuffer != VK_NULL_HANDLE);
 
-    geometry = m_geometries[0];
-    geometry.geometry.triangles.vertexData.deviceAddress = vertex_buffer->GetGpuAddress() + vertex_buffer_offset;
+    //the geometries keep their vertex offsets relative to the first one
+    geometries = m_geometries;
+    for (size_t i = 0; i < geometries.size(); ++i)
+    {
+        int64_t relative_offset = (int64_t)m_desc.geometries[i].vertex_buffer_offset - (int64_t)m_desc.geometries[0].vertex_buffer_offset;
+        geometries[i].geometry.triangles.vertexData.deviceAddress = vertex_buffer->GetGpuAddress() + vertex_buffer_offset + relative_offset;
+    }
 
     GetBuildInfo(info);
     info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
     info.srcAccelerationStructure = m_accelerationStructure;
-    info.pGeometries = &geometry;
+    info.pGeometries = geometries.data();
 }
 
+GfxRayTracingBLASSizes VulkanRayTracingBLAS::GetSizes(VulkanDevice* pDevice, const GfxRayTracingBLASDesc& desc)
+{
+    eastl::vector<VkAccelerationStructureGeometryKHR> geometries;
+    eastl::vector<uint32_t> primitiveCounts;
+    geometries.reserve(desc.geometries.size());
+    primitiveCounts.reserve(desc.geometries.size());
+
+    for (size_t i = 0; i < desc.geometries.size(); ++i)
+    {
+        geometries.push_back(GetGeometry(desc.geometries[i]));
+        primitiveCounts.push_back(desc.geometries[i].index_count / 3);
+    }
+
+    VkAccelerationStructureBuildGeometryInfoKHR buildInfo = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR };
+    buildInfo.type = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+    buildInfo.flags = ToVulkanAccelerationStructureFlags(desc.flags);
+    buildInfo.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    buildInfo.geometryCount = (uint32_t)geometries.size();
+    buildInfo.pGeometries = geometries.data();
+
+    VkAccelerationStructureBuildSizesInfoKHR sizeInfo = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR };
+    vkGetAccelerationStructureBuildSizesKHR((VkDevice)pDevice->GetHandle(), VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &buildInfo, primitiveCounts.data(), &sizeInfo);
+
+    GfxRayTracingBLASSizes sizes;
+    sizes.as_size = (uint32_t)sizeInfo.accelerationStructureSize;
+    sizes.build_scratch_size = (uint32_t)sizeInfo.buildScratchSize;
+    sizes.update_scratch_size = (uint32_t)sizeInfo.updateScratchSize;
+    return sizes;
+}
@@ -16,8 +16,11 @@ public:
     bool Create();
     VkDeviceAddress GetGpuAddress() const;
     void GetBuildInfo(VkAccelerationStructureBuildGeometryInfoKHR& info);
-    void GetUpdateInfo(VkAccelerationStructureBuildGeometryInfoKHR& info, VkAccelerationStructureGeometryKHR& geometry, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset);
+    void GetUpdateInfo(VkAccelerationStructureBuildGeometryInfoKHR& info, eastl::vector<VkAccelerationStructureGeometryKHR>& geometries, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset);
     const VkAccelerationStructureBuildRangeInfoKHR* GetBuildRangeInfo() const { return m_rangeInfos.data(); }
+    VkQueryPool GetCompactedSizeQueryPool() const { return m_compactedSizeQueryPool; }
+
+    static GfxRayTracingBLASSizes GetSizes(VulkanDevice* pDevice, const GfxRayTracingBLASDesc& desc);
 
 private:
     VkAccelerationStructureKHR m_accelerationStructure = VK_NULL_HANDLE;
@@ -25,6 +28,7 @@ private:
     VmaAllocation m_asBufferAllocation = VK_NULL_HANDLE;
     VkBuffer m_scratchBuffer = VK_NULL_HANDLE;
     VmaAllocation m_scratchBufferAllocation = VK_NULL_HANDLE;
+    VkQueryPool m_compactedSizeQueryPool = VK_NULL_HANDLE;
 
     eastl::vector<VkAccelerationStructureGeometryKHR> m_geometries;
     eastl::vector<VkAccelerationStructureBuildRangeInfoKHR> m_rangeInfos;
@@ -56,7 +56,7 @@ bool VulkanRayTracingTLAS::Create()
     VmaAllocator allocator = ((VulkanDevice*)m_pDevice)->GetVmaAllocator();
     vmaCreateBuffer(allocator, &bufferInfo, &allocationInfo, &m_asBuffer, &m_asBufferAllocation, nullptr);
 
-    bufferInfo.size = sizeInfo.buildScratchSize;
+    bufferInfo.size = (m_desc.flags & GfxRayTracingASFlagAllowUpdate) ? eastl::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize) : sizeInfo.buildScratchSize;
     vmaCreateBuffer(allocator, &bufferInfo, &allocationInfo, &m_scratchBuffer, &m_scratchBufferAllocation, nullptr);
 
     VkAccelerationStructureCreateInfoKHR createInfo = { VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR };
@@ -101,9 +101,10 @@ VkDeviceAddress VulkanRayTracingTLAS::GetGpuAddress() const
 }
 
 void VulkanRayTracingTLAS::GetBuildInfo(VkAccelerationStructureBuildGeometryInfoKHR& info, VkAccelerationStructureGeometryKHR& geometry,
-    const GfxRayTracingInstance* instances, uint32_t instance_count)
+    const GfxRayTracingInstance* instances, uint32_t instance_count, bool update)
 {
     RE_ASSERT(instance_count <= m_desc.instance_count);
+    RE_ASSERT(!update || (m_desc.flags & GfxRayTracingASFlagAllowUpdate));
 
     if (m_currentInstanceBufferOffset + sizeof(VkAccelerationStructureInstanceKHR) * instance_count > m_instanceBufferSize)
     {
@@ -116,7 +117,8 @@ void VulkanRayTracingTLAS::GetBuildInfo(VkAccelerationStructureBuildGeometryInfo
 
     info.type = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
     info.flags = ToVulkanAccelerationStructureFlags(m_desc.flags);
-    info.mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    info.mode = update ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    info.srcAccelerationStructure = update ? m_accelerationStructure : VK_NULL_HANDLE;
     info.dstAccelerationStructure = m_accelerationStructure;
     info.geometryCount = 1;
     info.pGeometries = &geometry;
@@ -16,7 +16,7 @@ public:
     bool Create();
     VkDeviceAddress GetGpuAddress() const;
     void GetBuildInfo(VkAccelerationStructureBuildGeometryInfoKHR& info, VkAccelerationStructureGeometryKHR& geometry,
-        const GfxRayTracingInstance* instances, uint32_t instance_count);
+        const GfxRayTracingInstance* instances, uint32_t instance_count, bool update);
 
 private:
     VkAccelerationStructureKHR m_accelerationStructure = VK_NULL_HANDLE;
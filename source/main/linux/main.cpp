@@ -0,0 +1,265 @@
+#include "core/engine.h"
+#include "core/benchmark.h"
+#include "renderer/renderer.h"
+#include "renderer/vertex_skinning.h"
+#include "gfx/mock/mock_device.h"
+#include "utils/log.h"
+#include "rpmalloc/rpmalloc.h"
+#include <unistd.h>
+#include <limits.h>
+#include <filesystem>
+
+// headless entry, there is no window and no real swapchain :
+// the mock backend renders into a virtual backbuffer of a fixed size.
+// usage : RealEngine [-scene sponza.xml] [-frames 100] [-width 1920] [-height 1080]
+//
+// benchmark : RealEngine -benchmark result.csv [-baseline baseline.csv] [-threshold 0.1] [-camera_path camera_path.txt]
+//             [-warmup 30] [-stress_meshes N] [-stress_lights N] [-stress_bodies N] [-stress_characters N]
+// returns 1 if any cpu event regressed against the baseline
+//
+// command validation : RealEngine -validate 1 [-capture_path captures/]
+// records the command stream of every frame, logs the validation errors and the stats of the last frame,
+// -capture_path also saves the streams to be diffed later, returns 2 if any frame failed the validation
+//
+// capture diff : RealEngine -diff_captures captures/frame_10.bin other_captures/frame_10.bin
+// loads two saved command streams, logs their first mismatched commands with the resource names, returns 3 if they differ
+//
+// the self tests of the engine systems are in RealEngineTests, see source/tests/main.cpp
+
+static eastl::string GetWorkPath()
+{
+    char exe_file[PATH_MAX] = {};
+    ssize_t length = readlink("/proc/self/exe", exe_file, PATH_MAX - 1);
+    if (length <= 0)
+    {
+        return "./";
+    }
+
+    eastl::string work_path(exe_file, length);
+
+    size_t last_slash = work_path.find_last_of('/');
+    return work_path.substr(0, last_slash + 1);
+}
+
+static MockDevice* GetMockDevice()
+{
+    IGfxDevice* device = Engine::GetInstance()->GetRenderer()->GetDevice();
+    if (device->GetDesc().backend != GfxRenderBackend::Mock)
+    {
+        return nullptr;
+    }
+    return (MockDevice*)device;
+}
+
+static void EnableCommandRecording(bool enable, const eastl::string& capture_path)
+{
+    MockDevice* device = GetMockDevice();
+    if (device && enable)
+    {
+        eastl::string path = capture_path;
+        if (!path.empty())
+        {
+            if (path.back() != '/')
+            {
+                path += "/";
+            }
+            std::filesystem::create_directories(path.c_str());
+        }
+
+        device->EnableCommandRecording(true, path);
+    }
+}
+
+static bool ReportCommandValidation()
+{
+    MockDevice* device = GetMockDevice();
+    if (device == nullptr)
+    {
+        RE_WARN("command validation requires the mock backend");
+        return true;
+    }
+
+    const MockFrameStats& stats = device->GetLastFrameStats();
+    RE_INFO("last frame : {} command lists, {} bytes, {} draws, {} dispatches, {} barriers, {} render passes, {} copies",
+        stats.command_lists, stats.stream_bytes, stats.draws, stats.dispatches, stats.barriers, stats.render_passes, stats.copies);
+    RE_INFO("state changes : pso {} ({} redundant), constants {} ({} redundant), index buffer {} ({} redundant)",
+        stats.pso_changes, stats.redundant_pso_changes, stats.constant_changes, stats.redundant_constant_changes,
+        stats.index_buffer_changes, stats.redundant_index_buffer_changes);
+    RE_INFO("ray tracing : {} as builds ({} tlas refits, {} blas refits, {} blas rebuilds), {} blas compactions, {} bytes of blas scratch",
+        stats.ray_tracing_builds, stats.tlas_refits, stats.blas_refits, stats.blas_rebuilds, stats.blas_compactions, stats.blas_scratch_bytes);
+    const VertexSkinningStats& skinning = Engine::GetInstance()->GetRenderer()->GetVertexSkinning()->GetStats();
+    RE_INFO("vertex skinning : {} meshes, {} vertices in {} dispatches", skinning.jobs, skinning.vertices, skinning.dispatches);
+    RE_INFO("validation errors : {}", device->GetTotalErrorCount());
+
+    return device->GetTotalErrorCount() == 0;
+}
+
+static bool DiffCaptures(const eastl::string& lhs_file, const eastl::string& rhs_file)
+{
+    MockCommandStream lhs, rhs;
+    MockResourceRegistry lhs_registry, rhs_registry;
+
+    if (!lhs.Load(lhs_file, &lhs_registry))
+    {
+        RE_ERROR("failed to load the capture : {}", lhs_file);
+        return false;
+    }
+
+    if (!rhs.Load(rhs_file, &rhs_registry))
+    {
+        RE_ERROR("failed to load the capture : {}", rhs_file);
+        return false;
+    }
+
+    eastl::vector<MockCommandDiff> diffs = DiffMockCommandStreams(lhs, rhs, 32, &lhs_registry, &rhs_registry);
+    for (size_t i = 0; i < diffs.size(); ++i)
+    {
+        RE_INFO("command {} :", diffs[i].command_index);
+        RE_INFO("  < {}", diffs[i].lhs.empty() ? "(missing)" : diffs[i].lhs);
+        RE_INFO("  > {}", diffs[i].rhs.empty() ? "(missing)" : diffs[i].rhs);
+    }
+
+    RE_INFO("{} and {} : {} bytes and {} bytes, {} mismatched commands{}", lhs_file, rhs_file, lhs.GetSize(), rhs.GetSize(),
+        diffs.size(), diffs.size() == 32 ? " (stopped at 32)" : "");
+
+    return diffs.empty();
+}
+
+int main(int argc, char* argv[])
+{
+    rpmalloc_initialize();
+
+    uint32_t frame_count = 100;
+    uint32_t width = 1920;
+    uint32_t height = 1080;
+    bool benchmark = false;
+    BenchmarkSettings settings;
+    bool validate = false;
+    eastl::string capture_path;
+    eastl::string diff_lhs, diff_rhs;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const char* arg = argv[i];
+        const char* value = argv[i + 1];
+
+        if (strcmp(arg, "-scene") == 0)
+        {
+            Engine::GetInstance()->SetSceneFile(value);
+        }
+        else if (strcmp(arg, "-frames") == 0)
+        {
+            frame_count = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-width") == 0)
+        {
+            width = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-height") == 0)
+        {
+            height = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-benchmark") == 0)
+        {
+            benchmark = true;
+            settings.output = value;
+        }
+        else if (strcmp(arg, "-baseline") == 0)
+        {
+            settings.baseline = value;
+        }
+        else if (strcmp(arg, "-threshold") == 0)
+        {
+            settings.regression_threshold = (float)atof(value);
+        }
+        else if (strcmp(arg, "-camera_path") == 0)
+        {
+            settings.camera_path = value;
+        }
+        else if (strcmp(arg, "-warmup") == 0)
+        {
+            settings.warmup_frames = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-stress_meshes") == 0)
+        {
+            settings.stress_meshes = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-stress_lights") == 0)
+        {
+            settings.stress_lights = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-stress_bodies") == 0)
+        {
+            settings.stress_bodies = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-stress_characters") == 0)
+        {
+            settings.stress_characters = (uint32_t)atoi(value);
+        }
+        else if (strcmp(arg, "-validate") == 0)
+        {
+            validate = atoi(value) != 0;
+        }
+        else if (strcmp(arg, "-capture_path") == 0)
+        {
+            validate = true;
+            capture_path = value;
+        }
+        else if (strcmp(arg, "-diff_captures") == 0 && i + 2 < argc)
+        {
+            //the only option with two values
+            diff_lhs = value;
+            diff_rhs = argv[i + 2];
+            ++i;
+        }
+    }
+
+    if (!diff_lhs.empty())
+    {
+        //no engine needed, the captures carry the resource names
+        return DiffCaptures(diff_lhs, diff_rhs) ? 0 : 3;
+    }
+
+    eastl::string work_path = GetWorkPath();
+    int exit_code = 0;
+
+    if (benchmark)
+    {
+        settings.frame_count = frame_count;
+
+        Benchmark runner(settings);
+
+        eastl::string stress_scene = runner.CreateStressScene(work_path);
+        if (!stress_scene.empty())
+        {
+            Engine::GetInstance()->SetSceneFile(stress_scene);
+        }
+
+        Engine::GetInstance()->Init(work_path, nullptr, width, height);
+        EnableCommandRecording(validate, capture_path);
+
+        if (!runner.Run())
+        {
+            exit_code = 1;
+        }
+    }
+    else
+    {
+        Engine::GetInstance()->Init(work_path, nullptr, width, height);
+        EnableCommandRecording(validate, capture_path);
+
+        for (uint32_t i = 0; i < frame_count; ++i)
+        {
+            Engine::GetInstance()->Tick();
+        }
+    }
+
+    if (validate && !ReportCommandValidation())
+    {
+        exit_code = 2;
+    }
+
+    Engine::GetInstance()->Shut();
+
+    return exit_code;
+}
@@ -0,0 +1,251 @@
+#include "async_texture_loader.h"
+#include "core/engine.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+
+AsyncTextureLoader::AsyncTextureLoader(uint32_t max_requests)
+{
+    m_pTaskScheduler = Engine::GetInstance()->GetTaskScheduler();
+    m_nMaxRequests = eastl::max(max_requests, 1u);
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+    Reset();
+}
+
+void AsyncTextureLoader::Request(const eastl::string& file, bool srgb)
+{
+    eastl::vector<LoadRequest*> launches;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_requests.find(file) != m_requests.end())
+        {
+            return;
+        }
+
+        LoadRequest* request = new LoadRequest;
+        request->file = file;
+        request->srgb = srgb;
+        m_requests.emplace(file, eastl::unique_ptr<LoadRequest>(request));
+        m_pendingRequests.push_back(request);
+
+        if (m_stats.requests++ == 0)
+        {
+            m_nFirstRequestTime = stm_now();
+        }
+
+        while (m_nInflightRequests < m_nMaxRequests && !m_pendingRequests.empty())
+        {
+            launches.push_back(m_pendingRequests.front());
+            m_pendingRequests.pop_front();
+            Launch(launches.back());
+        }
+
+        SampleQueueDepth();
+    }
+
+    for (size_t i = 0; i < launches.size(); ++i)
+    {
+        Pipe(launches[i]);
+    }
+}
+
+eastl::unique_ptr<TextureLoader> AsyncTextureLoader::Acquire(const eastl::string& file, bool srgb)
+{
+    LoadRequest* request = nullptr;
+    bool run_inline = false;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        auto iter = m_requests.find(file);
+        if (iter == m_requests.end() || iter->second->srgb != srgb)
+        {
+            return nullptr;
+        }
+
+        request = iter->second.get();
+        if (!request->launched)
+        {
+            m_pendingRequests.erase(eastl::find(m_pendingRequests.begin(), m_pendingRequests.end(), request));
+            request->launched = true;
+            run_inline = true;
+        }
+        else
+        {
+            //the task may not be in the pipe yet, waiting for it before would return at once
+            m_pipedCondition.wait(lock, [request]() { return request->piped; });
+        }
+    }
+
+    if (run_inline)
+    {
+        Execute(request);
+    }
+    else
+    {
+        m_pTaskScheduler->WaitforTask(request->task.get());
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    eastl::unique_ptr<TextureLoader> loader;
+    if (request->succeeded)
+    {
+        loader = eastl::move(request->loader);
+    }
+    m_requests.erase(file);
+
+    return loader;
+}
+
+bool AsyncTextureLoader::IsCompleted(const eastl::string& file) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto iter = m_requests.find(file);
+    return iter == m_requests.end() || iter->second->completed;
+}
+
+void AsyncTextureLoader::Reset()
+{
+    //a completion may launch one more task until the fifo is cleared, so wait until nothing was in flight.
+    //a task can complete before Pipe marks it, so the launched tasks are waited for once they are all in the pipe
+    uint32_t inflight_requests;
+    do
+    {
+        eastl::vector<enki::TaskSet*> tasks;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_pendingRequests.clear();
+            m_pipedCondition.wait(lock, [this]()
+                {
+                    for (auto iter = m_requests.begin(); iter != m_requests.end(); ++iter)
+                    {
+                        if (iter->second->task && !iter->second->piped)
+                        {
+                            return false;
+                        }
+                    }
+                    return true;
+                });
+            inflight_requests = m_nInflightRequests;
+
+            for (auto iter = m_requests.begin(); iter != m_requests.end(); ++iter)
+            {
+                if (iter->second->task)
+                {
+                    tasks.push_back(iter->second->task.get());
+                }
+            }
+        }
+
+        for (size_t i = 0; i < tasks.size(); ++i)
+        {
+            m_pTaskScheduler->WaitforTask(tasks[i]);
+        }
+    } while (inflight_requests > 0);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_stats.requests > 0)
+    {
+        AsyncTextureLoadStats stats = m_stats;
+        stats.seconds = stm_sec(m_nLastCompletionTime - m_nFirstRequestTime);
+
+        RE_INFO("[AsyncTextureLoader] {} textures, {:.1f} MB in {:.1f} ms, {:.1f} MB/s, queue depth max {} average {:.1f}",
+            stats.requests, stats.bytes / (1024.0 * 1024.0), stats.seconds * 1000.0, stats.GetThroughput(),
+            stats.max_queue_depth, stats.average_queue_depth);
+    }
+
+    m_requests.clear();
+    m_stats = AsyncTextureLoadStats();
+    m_nFirstRequestTime = m_nLastCompletionTime = 0;
+    m_nQueueDepthSum = 0;
+    m_nQueueDepthSamples = 0;
+}
+
+AsyncTextureLoadStats AsyncTextureLoader::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    AsyncTextureLoadStats stats = m_stats;
+    if (m_nLastCompletionTime > m_nFirstRequestTime)
+    {
+        stats.seconds = stm_sec(m_nLastCompletionTime - m_nFirstRequestTime);
+    }
+    return stats;
+}
+
+void AsyncTextureLoader::Launch(LoadRequest* request)
+{
+    request->launched = true;
+    request->task = eastl::make_unique<enki::TaskSet>(1,
+        [this, request](enki::TaskSetPartition range, uint32_t threadnum)
+        {
+            Execute(request);
+            OnCompleted();
+        });
+
+    m_nInflightRequests++;
+}
+
+void AsyncTextureLoader::Pipe(LoadRequest* request)
+{
+    //outside of the lock, enkiTS may run tasks inline when its pipe is full
+    m_pTaskScheduler->AddTaskSetToPipe(request->task.get());
+
+    //notified under the lock, Reset may destroy the loader as soon as it is released
+    std::lock_guard<std::mutex> lock(m_mutex);
+    request->piped = true;
+    m_pipedCondition.notify_all();
+}
+
+void AsyncTextureLoader::Execute(LoadRequest* request)
+{
+    request->loader = eastl::make_unique<TextureLoader>();
+    request->succeeded = request->loader->Load(request->file, request->srgb);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    request->completed = true;
+    m_stats.bytes += request->loader->GetFileSize();
+    m_nLastCompletionTime = stm_now();
+}
+
+void AsyncTextureLoader::OnCompleted()
+{
+    LoadRequest* next = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_nInflightRequests--;
+
+        if (!m_pendingRequests.empty())
+        {
+            next = m_pendingRequests.front();
+            m_pendingRequests.pop_front();
+            Launch(next);
+        }
+
+        SampleQueueDepth();
+    }
+
+    if (next)
+    {
+        Pipe(next);
+    }
+}
+
+void AsyncTextureLoader::SampleQueueDepth()
+{
+    uint32_t depth = m_nInflightRequests + (uint32_t)m_pendingRequests.size();
+
+    m_stats.max_queue_depth = eastl::max(m_stats.max_queue_depth, depth);
+    m_nQueueDepthSum += depth;
+    m_nQueueDepthSamples++;
+    m_stats.average_queue_depth = (float)m_nQueueDepthSum / m_nQueueDepthSamples;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "texture_loader.h"
+#include "EASTL/unique_ptr.h"
+#include "EASTL/hash_map.h"
+#include "EASTL/deque.h"
+#include "enkiTS/TaskScheduler.h"
+#include <mutex>
+#include <condition_variable>
+
+struct AsyncTextureLoadStats
+{
+    uint32_t requests = 0;
+    uint64_t bytes = 0;         //of the mapped files
+    double seconds = 0.0;       //from the first request to the last completion
+    uint32_t max_queue_depth = 0;
+    float average_queue_depth = 0.0f; //sampled at each request and completion
+
+    double GetThroughput() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; } //MB/s
+};
+
+//maps and decodes textures on task threads, with at most max_requests of them in flight.
+//the requests waiting for a slot are kept in a fifo, Acquire runs a waiting request inline.
+class AsyncTextureLoader
+{
+public:
+    AsyncTextureLoader(uint32_t max_requests = 8);
+    ~AsyncTextureLoader();
+
+    void Request(const eastl::string& file, bool srgb);
+
+    //returns nullptr if the file was not requested with the same srgb, or failed to load
+    eastl::unique_ptr<TextureLoader> Acquire(const eastl::string& file, bool srgb);
+
+    //true once the file was loaded or if it was not requested, Acquire then doesn't wait
+    bool IsCompleted(const eastl::string& file) const;
+
+    //waits for the requests in flight, then drops the results which were never acquired
+    void Reset();
+
+    AsyncTextureLoadStats GetStats() const;
+
+private:
+    struct LoadRequest
+    {
+        eastl::string file;
+        bool srgb = false;
+        bool launched = false;
+        bool piped = false; //the task is added to the pipe outside of m_mutex, a launched task can't be waited for before
+        eastl::unique_ptr<TextureLoader> loader;
+        bool succeeded = false;
+        bool completed = false;
+        eastl::unique_ptr<enki::TaskSet> task;
+    };
+
+    void Launch(LoadRequest* request); //m_mutex should be locked
+    void Pipe(LoadRequest* request); //m_mutex should not be locked
+    void Execute(LoadRequest* request);
+    void OnCompleted();
+    void SampleQueueDepth(); //m_mutex should be locked
+
+private:
+    enki::TaskScheduler* m_pTaskScheduler = nullptr;
+    uint32_t m_nMaxRequests = 8;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_pipedCondition;
+    eastl::hash_map<eastl::string, eastl::unique_ptr<LoadRequest>> m_requests;
+    eastl::deque<LoadRequest*> m_pendingRequests;
+    uint32_t m_nInflightRequests = 0;
+
+    AsyncTextureLoadStats m_stats;
+    uint64_t m_nFirstRequestTime = 0;
+    uint64_t m_nLastCompletionTime = 0;
+    uint64_t m_nQueueDepthSum = 0;
+    uint32_t m_nQueueDepthSamples = 0;
+};
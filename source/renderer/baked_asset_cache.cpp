@@ -0,0 +1,87 @@
+#include "baked_asset_cache.h"
+#include "core/engine.h"
+#include "utils/fmt.h"
+#include "utils/log.h"
+#include "utils/memory_mapped_file.h"
+#include "xxHash/xxhash.h"
+#include <filesystem>
+#include <fstream>
+
+static const uint32_t BAKED_ASSET_MAGIC = 0x4B414252; //"RBAK"
+
+struct BakedAssetHeader
+{
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t version;
+    uint64_t size;
+    uint64_t hash; //of the data, a partially written blob is rejected
+};
+
+BakedAssetCache::BakedAssetCache()
+{
+    m_cachePath = Engine::GetInstance()->GetWorkPath() + "baked_cache/";
+}
+
+bool BakedAssetCache::Load(const eastl::string& name, uint64_t version, eastl::vector<uint8_t>& data) const
+{
+    MemoryMappedFile file;
+    if (!file.Open(GetFile(name, version)) || file.GetSize() < sizeof(BakedAssetHeader))
+    {
+        return false;
+    }
+
+    BakedAssetHeader header;
+    memcpy(&header, file.GetData(), sizeof(BakedAssetHeader));
+
+    const uint8_t* blob = file.GetData() + sizeof(BakedAssetHeader);
+    if (header.magic != BAKED_ASSET_MAGIC ||
+        header.version != version ||
+        header.size != file.GetSize() - sizeof(BakedAssetHeader) ||
+        header.hash != XXH3_64bits(blob, (size_t)header.size))
+    {
+        RE_WARN("[BakedAssetCache] {} is corrupted, it will be baked again", GetFile(name, version));
+        return false;
+    }
+
+    data.resize((size_t)header.size);
+    memcpy(data.data(), blob, (size_t)header.size);
+    return true;
+}
+
+bool BakedAssetCache::Save(const eastl::string& name, uint64_t version, const void* data, size_t size) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(m_cachePath.c_str(), error);
+
+    BakedAssetHeader header = {};
+    header.magic = BAKED_ASSET_MAGIC;
+    header.version = version;
+    header.size = size;
+    header.hash = XXH3_64bits(data, size);
+
+    eastl::string file = GetFile(name, version);
+
+    std::ofstream os;
+    os.open(file.c_str(), std::ios::binary);
+    if (os.fail())
+    {
+        RE_WARN("[BakedAssetCache] failed to write {}", file);
+        return false;
+    }
+    os.write((const char*)&header, sizeof(header));
+    os.write((const char*)data, size);
+    os.close();
+
+    return !os.fail();
+}
+
+uint64_t BakedAssetCache::MakeVersion(const eastl::string& text, uint64_t seed)
+{
+    return XXH3_64bits_withSeed(text.data(), text.size(), seed);
+}
+
+eastl::string BakedAssetCache::GetFile(const eastl::string& name, uint64_t version) const
+{
+    return m_cachePath + fmt::format("{}_{:016x}.bin", name.c_str(), version).c_str();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "EASTL/string.h"
+#include "EASTL/vector.h"
+
+//outputs of the startup generators are written to work_path/baked_cache/ as raw blobs, keyed by a name and a version hash.
+//the version should cover everything the output depends on, a stale blob is then never read again.
+//Load and Save have no shared state, they can be called from task threads
+class BakedAssetCache
+{
+public:
+    BakedAssetCache();
+
+    //returns false if there is no blob of this version, or it is corrupted
+    bool Load(const eastl::string& name, uint64_t version, eastl::vector<uint8_t>& data) const;
+    bool Save(const eastl::string& name, uint64_t version, const void* data, size_t size) const;
+
+    static uint64_t MakeVersion(const eastl::string& text, uint64_t seed = 0); //e.g. a list of source files with their timestamps
+
+private:
+    eastl::string GetFile(const eastl::string& name, uint64_t version) const;
+
+private:
+    eastl::string m_cachePath;
+};
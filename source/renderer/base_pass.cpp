@@ -1,8 +1,8 @@
 #include "base_pass.h"
 #include "renderer.h"
 #include "hierarchical_depth_buffer.h"
+#include "core/engine.h"
 #include "utils/profiler.h"
-#include "EASTL/map.h"
 
 struct FirstPhaseInstanceCullingData
 {
@@ -61,12 +61,6 @@ BasePass::BasePass(Renderer* pRenderer)
     m_pBuildIndirectCommandPSO = pRenderer->GetPipelineState(desc, "indirect command PSO");
 }
 
-RenderBatch& BasePass::AddBatch()
-{
-    LinearAllocator* allocator = m_pRenderer->GetConstantAllocator();
-    return m_instances.emplace_back(*allocator);
-}
-
 void BasePass::Render1stPhase(RenderGraph* pRenderGraph)
 {
     RENDER_GRAPH_EVENT(pRenderGraph, "BasePass 1st phase");
@@ -444,32 +438,43 @@ void BasePass::MergeBatches()
     m_indirectBatches.clear();
     m_nonGpuDrivenBatches.clear();
 
-    struct MergedBatch
+    //sorted by pso first, so the batches sharing a pso are contiguous and merged into one indirect batch
+    float3 view_pos = Engine::GetInstance()->GetWorld()->GetCamera()->GetPosition();
+    eastl::vector<uint32_t> order = SortRenderBatches(m_instances, RenderBatchPass::Base, view_pos);
+
+    eastl::vector<uint2> meshletList;
+    uint32_t meshletListOffset = 0;
+
+    auto flushMeshletList = [&]()
     {
-        eastl::vector<RenderBatch> batches;
-        uint32_t meshletCount;
+        if (!meshletList.empty())
+        {
+            IndirectBatch& batch = m_indirectBatches.back();
+            batch.originMeshletListAddress = m_pRenderer->AllocateSceneConstant(meshletList.data(), sizeof(uint2) * (uint32_t)meshletList.size());
+            batch.originMeshletCount = (uint32_t)meshletList.size();
+            batch.meshletListBufferOffset = meshletListOffset;
+
+            meshletListOffset += (uint32_t)meshletList.size();
+            meshletList.clear();
+        }
     };
-    eastl::map<IGfxPipelineState*, MergedBatch> mergedBatches;
 
-    for (size_t i = 0; i < m_instances.size(); ++i)
+    for (size_t i = 0; i < order.size(); ++i)
     {
-        const RenderBatch& batch = m_instances[i];
+        const RenderBatch& batch = m_instances[order[i]];
         if (batch.pso->GetType() == GfxPipelineType::MeshShading)
         {
             m_nTotalMeshletCount += batch.meshletCount;
 
-            auto iter = mergedBatches.find(batch.pso);
-            if (iter != mergedBatches.end())
+            if (m_indirectBatches.empty() || m_indirectBatches.back().pso != batch.pso)
             {
-                iter->second.meshletCount += batch.meshletCount;
-                iter->second.batches.push_back(batch);
+                flushMeshletList();
+                m_indirectBatches.push_back({ batch.pso, 0, 0, meshletListOffset });
             }
-            else
+
+            for (uint32_t m = 0; m < batch.meshletCount; ++m)
             {
-                MergedBatch mergedBatch;
-                mergedBatch.batches.push_back(batch);
-                mergedBatch.meshletCount = batch.meshletCount;
-                mergedBatches.insert(eastl::make_pair(batch.pso, mergedBatch));
+                meshletList.emplace_back(batch.instanceIndex, m);
             }
         }
         else
@@ -478,29 +483,7 @@ void BasePass::MergeBatches()
         }
     }
 
-    uint32_t meshletListOffset = 0;
-    for (auto iter = mergedBatches.begin(); iter != mergedBatches.end(); ++iter)
-    {
-        const MergedBatch& batch = iter->second;
-
-        eastl::vector<uint2> meshletList;
-        meshletList.reserve(batch.meshletCount);
-
-        for (size_t i = 0; i < batch.batches.size(); ++i)
-        {
-            uint32_t instanceIndex = batch.batches[i].instanceIndex;
-            for (size_t m = 0; m < batch.batches[i].meshletCount; ++m)
-            {
-                meshletList.emplace_back(instanceIndex, (uint32_t)m);
-            }
-        }
-
-        uint32_t meshletListAddress = m_pRenderer->AllocateSceneConstant(meshletList.data(), sizeof(uint2) * (uint32_t)meshletList.size());
-
-        m_indirectBatches.push_back({ iter->first, meshletListAddress, batch.meshletCount, meshletListOffset });
-
-        meshletListOffset += batch.meshletCount;
-    }
+    flushMeshletList();
 
     m_instances.clear();
 }
@@ -580,9 +563,11 @@ void BasePass::Flush2ndPhaseBatches(IGfxCommandList* pCommandList, RGBuffer* pIn
         pCommandList->DispatchMeshIndirect(pIndirectCommandBuffer->GetBuffer(), sizeof(uint3) * (uint32_t)i);
     }
 
+    //already sorted in MergeBatches
+    RenderBatchStateCache state(pCommandList);
     for (size_t i = 0; i < m_nonGpuDrivenBatches.size(); ++i)
     {
-        DrawBatch(pCommandList, m_nonGpuDrivenBatches[i]);
+        DrawBatch(state, m_nonGpuDrivenBatches[i]);
     }
 }
 
@@ -10,7 +10,7 @@ class BasePass
 public:
     BasePass(Renderer* pRenderer);
 
-    RenderBatch& AddBatch();
+    eastl::vector<RenderBatch>& GetBatches() { return m_instances; }
     void Render1stPhase(RenderGraph* pRenderGraph);
     void Render2ndPhase(RenderGraph* pRenderGraph);
 
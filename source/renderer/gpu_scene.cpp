@@ -1,7 +1,13 @@
 #include "gpu_scene.h"
 #include "renderer.h"
+#include "ray_tracing_blas_builder.h"
+#include "utils/gui_util.h"
+#include "utils/log.h"
+#include "xxHash/xxhash.h"
+#include "magic_enum/magic_enum.hpp"
 
 #define MAX_CONSTANT_BUFFER_SIZE (8 * 1024 * 1024)
+#define INITIAL_MATERIAL_COUNT (16 * 1024)
 #define ALLOCATION_ALIGNMENT (4)
 
 GpuScene::GpuScene(Renderer* pRenderer)
@@ -16,6 +22,9 @@ GpuScene::GpuScene(Renderer* pRenderer)
     m_pSceneAnimationBuffer.reset(pRenderer->CreateRawBuffer(nullptr, animation_buffer_size, "GpuScene::m_pSceneAnimationBuffer", GfxMemoryType::GpuOnly, true));
     m_pSceneAnimationBufferAllocator = eastl::make_unique<OffsetAllocator::Allocator>(animation_buffer_size);
 
+    m_nMaterialCapacity = INITIAL_MATERIAL_COUNT;
+    m_pMaterialBuffer.reset(pRenderer->CreateRawBuffer(nullptr, sizeof(ModelMaterialConstant) * m_nMaterialCapacity, "GpuScene::m_pMaterialBuffer"));
+
     for (int i = 0; i < GFX_MAX_INFLIGHT_FRAMES; ++i)
     {
         m_pConstantBuffer[i].reset(pRenderer->CreateRawBuffer(nullptr, MAX_CONSTANT_BUFFER_SIZE, "GpuScene::m_pConstantBuffer", GfxMemoryType::CpuToGpu));
@@ -70,7 +79,7 @@ void GpuScene::Update()
     {
         GfxRayTracingTLASDesc desc;
         desc.instance_count = max(rt_instance_count, 1);
-        desc.flags = GfxRayTracingASFlagPreferFastBuild;
+        desc.flags = GfxRayTracingASFlagPreferFastTrace | GfxRayTracingASFlagAllowUpdate;
 
         IGfxDevice* device = m_pRenderer->GetDevice();
         m_pSceneTLAS.reset(device->CreateRayTracingTLAS(desc, "GpuScene::m_pSceneTLAS"));
@@ -78,19 +87,46 @@ void GpuScene::Update()
         GfxShaderResourceViewDesc srvDesc;
         srvDesc.type = GfxShaderResourceViewType::RayTracingTLAS;
         m_pSceneTLASSRV.reset(device->CreateShaderResourceView(m_pSceneTLAS.get(), srvDesc, "GpuScene::m_pSceneTLAS"));
+
+        m_tlasTracker.Invalidate();
     }
 
     m_localLightsDataAddress = m_pRenderer->AllocateSceneConstant(m_localLightsData.data(), sizeof(LocalLightData) * GetLocalLightCount());
 }
 
-void GpuScene::BuildRayTracingAS(IGfxCommandList* pCommandList)
+void GpuScene::BuildRayTracingAS(IGfxCommandList* pCommandList, bool blas_updated)
 {
     GPU_EVENT(pCommandList, "BuildTLAS");
 
-    pCommandList->BuildRayTracingTLAS(m_pSceneTLAS.get(), m_raytracingInstances.data(), (uint32_t)m_raytracingInstances.size());
-    pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskSRV);
+    //resolved at build time, since a compaction may have replaced the blas. the ones not built yet are skipped
+    uint32_t instance_count = 0;
+    for (size_t i = 0; i < m_raytracingInstances.size(); ++i)
+    {
+        if (m_raytracingBLASes[i]->IsBuilt())
+        {
+            m_raytracingInstances[instance_count] = m_raytracingInstances[i];
+            m_raytracingInstances[instance_count].blas = m_raytracingBLASes[i]->GetBLAS();
+            instance_count++;
+        }
+    }
+
+    //the tlas is kept across frames : rebuilt when instances were added or removed, refitted when only transforms changed
+    switch (m_tlasTracker.Update(m_raytracingInstances.data(), instance_count, blas_updated))
+    {
+    case RayTracingTLASUpdate::Rebuild:
+        pCommandList->BuildRayTracingTLAS(m_pSceneTLAS.get(), m_raytracingInstances.data(), instance_count);
+        pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskSRV);
+        break;
+    case RayTracingTLASUpdate::Refit:
+        pCommandList->UpdateRayTracingTLAS(m_pSceneTLAS.get(), m_raytracingInstances.data(), instance_count);
+        pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskSRV);
+        break;
+    default:
+        break;
+    }
 
     m_raytracingInstances.clear();
+    m_raytracingBLASes.clear();
 }
 
 uint32_t GpuScene::AllocateConstantBuffer(uint32_t size)
@@ -103,9 +139,10 @@ uint32_t GpuScene::AllocateConstantBuffer(uint32_t size)
     return address;
 }
 
-uint32_t GpuScene::AddInstance(const InstanceData& data, IGfxRayTracingBLAS* blas, GfxRayTracingInstanceFlag flags)
+uint32_t GpuScene::AddInstance(const InstanceData& data, RayTracingBLAS* blas, uint32_t instance_mask, GfxRayTracingInstanceFlag flags)
 {
     m_instanceData.push_back(data);
+    m_nMaterialReferenceSize += sizeof(ModelMaterialConstant);
     uint32_t instance_id = (uint32_t)m_instanceData.size() - 1;
 
     if (blas)
@@ -113,19 +150,117 @@ uint32_t GpuScene::AddInstance(const InstanceData& data, IGfxRayTracingBLAS* bla
         float4x4 transform = transpose(data.mtxWorld);
 
         GfxRayTracingInstance instance;
-        instance.blas = blas;
+        instance.blas = nullptr;
         memcpy(instance.transform, &transform, sizeof(float) * 12);
         instance.instance_id = instance_id;
-        instance.instance_mask = 0xFF; //todo
+        instance.instance_mask = instance_mask;
         instance.flags = flags;
 
         m_raytracingInstances.push_back(instance);
+        m_raytracingBLASes.push_back(blas);
     }
 
     return instance_id;
 }
 
 
+uint32_t GpuScene::AddMaterial(const ModelMaterialConstant& data)
+{
+    uint64_t hash = XXH3_64bits(&data, sizeof(ModelMaterialConstant));
+
+    auto iter = m_materialMap.find(hash);
+    if (iter != m_materialMap.end() && memcmp(&m_materials[iter->second].data, &data, sizeof(ModelMaterialConstant)) == 0)
+    {
+        m_materials[iter->second].refCount++;
+        return iter->second;
+    }
+
+    uint32_t index;
+    if (!m_freeMaterials.empty())
+    {
+        index = m_freeMaterials.back();
+        m_freeMaterials.pop_back();
+    }
+    else
+    {
+        if (m_materials.size() == m_nMaterialCapacity)
+        {
+            GrowMaterialBuffer();
+        }
+        index = (uint32_t)m_materials.size();
+        m_materials.emplace_back();
+    }
+
+    Material& material = m_materials[index];
+    material.data = data;
+    material.hash = hash;
+    material.refCount = 1;
+
+    //on a hash collision, the new slot is just not shared
+    if (iter == m_materialMap.end())
+    {
+        m_materialMap.insert(eastl::make_pair(hash, index));
+    }
+
+    m_pRenderer->UploadBuffer(m_pMaterialBuffer->GetBuffer(), sizeof(ModelMaterialConstant) * index, &data, sizeof(ModelMaterialConstant));
+    m_nMaterialUploadSize += sizeof(ModelMaterialConstant);
+
+    return index;
+}
+
+//the material indices are kept, so the table is copied to a buffer twice as large
+void GpuScene::GrowMaterialBuffer()
+{
+    m_nMaterialCapacity *= 2;
+
+    //the frames in flight and this frame's pending uploads still use the old buffer
+    m_retiredMaterialBuffers.push_back(eastl::make_pair(eastl::move(m_pMaterialBuffer), m_pRenderer->GetFrameID()));
+    m_pMaterialBuffer.reset(m_pRenderer->CreateRawBuffer(nullptr, sizeof(ModelMaterialConstant) * m_nMaterialCapacity, "GpuScene::m_pMaterialBuffer"));
+
+    eastl::vector<ModelMaterialConstant> materials(m_materials.size());
+    for (size_t i = 0; i < m_materials.size(); ++i)
+    {
+        materials[i] = m_materials[i].data;
+    }
+
+    uint32_t size = sizeof(ModelMaterialConstant) * (uint32_t)materials.size();
+    m_pRenderer->UploadBuffer(m_pMaterialBuffer->GetBuffer(), 0, materials.data(), size);
+    m_nMaterialUploadSize += size;
+
+    RE_INFO("[GpuScene] material buffer grown to {} materials", m_nMaterialCapacity);
+}
+
+void GpuScene::ReleaseMaterial(uint32_t index)
+{
+    if (index >= m_materials.size())
+    {
+        return;
+    }
+
+    Material& material = m_materials[index];
+    RE_ASSERT(material.refCount > 0);
+
+    if (--material.refCount == 0)
+    {
+        auto iter = m_materialMap.find(material.hash);
+        if (iter != m_materialMap.end() && iter->second == index)
+        {
+            m_materialMap.erase(iter);
+        }
+
+        m_pendingMaterialFrees.push_back(eastl::make_pair(index, m_pRenderer->GetFrameID()));
+    }
+}
+
+const ModelMaterialConstant* GpuScene::GetMaterial(uint32_t index) const
+{
+    if (index >= m_materials.size() || m_materials[index].refCount == 0)
+    {
+        return nullptr;
+    }
+    return &m_materials[index].data;
+}
+
 uint32_t GpuScene::AddLocalLight(const LocalLightData& data)
 {
     m_localLightsData.push_back(data);
@@ -137,6 +272,57 @@ void GpuScene::ResetFrameData()
     m_instanceData.clear();
     m_localLightsData.clear();
     m_nConstantBufferOffset = 0;
+
+    m_nLastFrameMaterialUploadSize = m_nMaterialUploadSize;
+    m_nLastFrameMaterialReferenceSize = m_nMaterialReferenceSize;
+    m_nMaterialUploadSize = 0;
+    m_nMaterialReferenceSize = 0;
+
+    //a released slot can be reused once no frame in flight is reading it
+    uint64_t frame_id = m_pRenderer->GetFrameID();
+    for (size_t i = 0; i < m_pendingMaterialFrees.size();)
+    {
+        if (m_pendingMaterialFrees[i].second + GFX_MAX_INFLIGHT_FRAMES <= frame_id)
+        {
+            m_freeMaterials.push_back(m_pendingMaterialFrees[i].first);
+            m_pendingMaterialFrees.erase_unsorted(m_pendingMaterialFrees.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    for (size_t i = 0; i < m_retiredMaterialBuffers.size();)
+    {
+        if (m_retiredMaterialBuffers[i].second + GFX_MAX_INFLIGHT_FRAMES <= frame_id)
+        {
+            m_retiredMaterialBuffers.erase(m_retiredMaterialBuffers.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void GpuScene::OnGui()
+{
+    if (ImGui::CollapsingHeader("GpuScene"))
+    {
+        ImGui::Text("Materials : %u", GetMaterialCount());
+        ImGui::Text("Material uploads : %u bytes (%u bytes if uploaded per instance)", m_nLastFrameMaterialUploadSize, m_nLastFrameMaterialReferenceSize);
+
+        const RayTracingTLASStats& tlas = m_tlasTracker.GetStats();
+        ImGui::Text("TLAS : %s, %u instances (%u static, %u moved)", magic_enum::enum_name(tlas.update).data(), tlas.instances, tlas.static_instances, tlas.moved_instances);
+        ImGui::Text("TLAS updates : %u rebuilds, %u refits, %u skipped", tlas.rebuilds, tlas.refits, tlas.skipped_builds);
+
+        int max_refits = (int)m_tlasTracker.GetMaxRefits();
+        if (ImGui::SliderInt("TLAS max refits", &max_refits, 0, 256))
+        {
+            m_tlasTracker.SetMaxRefits((uint32_t)max_refits);
+        }
+    }
 }
 
 void GpuScene::BeginAnimationUpdate(IGfxCommandList* pCommandList)
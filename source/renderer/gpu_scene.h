@@ -3,9 +3,13 @@
 #include "resource/raw_buffer.h"
 #include "utils/math.h"
 #include "OffsetAllocator/offsetAllocator.hpp"
+#include "ray_tracing_tlas_tracker.h"
 #include "gpu_scene.hlsli"
+#include "model_constants.hlsli"
+#include "EASTL/hash_map.h"
 
 class Renderer;
+class RayTracingBLAS;
 
 class GpuScene
 {
@@ -21,16 +25,29 @@ public:
 
     uint32_t AllocateConstantBuffer(uint32_t size);
 
-    uint32_t AddInstance(const InstanceData& data, IGfxRayTracingBLAS* blas, GfxRayTracingInstanceFlag flags);
+    //instance_mask is a combination of RT_INSTANCE_MASK_*, ignored without a blas
+    uint32_t AddInstance(const InstanceData& data, RayTracingBLAS* blas, uint32_t instance_mask, GfxRayTracingInstanceFlag flags);
     uint32_t GetInstanceCount() const { return (uint32_t)m_instanceData.size(); }
 
+    //materials are deduplicated by content, each unique one lives in a stable slot of a persistent buffer,
+    //which is uploaded only when the slot is created. slots are reference counted
+    uint32_t AddMaterial(const ModelMaterialConstant& data);
+    void ReleaseMaterial(uint32_t index);
+    const ModelMaterialConstant* GetMaterial(uint32_t index) const;
+    uint32_t GetMaterialCount() const { return (uint32_t)m_materials.size() - (uint32_t)m_freeMaterials.size(); }
+
+    //bytes actually uploaded, and what uploading the material of every instance would have cost
+    uint32_t GetMaterialUploadSize() const { return m_nLastFrameMaterialUploadSize; }
+    uint32_t GetMaterialReferenceSize() const { return m_nLastFrameMaterialReferenceSize; }
+
     uint32_t AddLocalLight(const LocalLightData& data);
     uint32_t GetLocalLightCount() const { return (uint32_t)m_localLightsData.size(); }
     const LocalLightData* GetLocalLights() const { return m_localLightsData.data(); }
 
     void Update();
-    void BuildRayTracingAS(IGfxCommandList* pCommandList);
+    void BuildRayTracingAS(IGfxCommandList* pCommandList, bool blas_updated); //blas_updated : some blases were refitted or rebuilt
     void ResetFrameData();
+    void OnGui();
 
     void BeginAnimationUpdate(IGfxCommandList* pCommandList);
     void EndAnimationUpdate(IGfxCommandList* pCommandList);
@@ -42,6 +59,8 @@ public:
     IGfxDescriptor* GetSceneAnimationBufferSRV() const { return m_pSceneAnimationBuffer->GetSRV(); }
     IGfxDescriptor* GetSceneAnimationBufferUAV() const { return m_pSceneAnimationBuffer->GetUAV(); }
 
+    IGfxDescriptor* GetSceneMaterialBufferSRV() const { return m_pMaterialBuffer->GetSRV(); }
+
     IGfxBuffer* GetSceneConstantBuffer() const;
     IGfxDescriptor* GetSceneConstantSRV() const;
 
@@ -50,6 +69,9 @@ public:
 
     IGfxDescriptor* GetRayTracingTLASSRV() const { return m_pSceneTLASSRV.get(); }
 
+private:
+    void GrowMaterialBuffer();
+
 private:
     Renderer* m_pRenderer = nullptr;
 
@@ -65,10 +87,30 @@ private:
     eastl::unique_ptr<RawBuffer> m_pSceneAnimationBuffer;
     eastl::unique_ptr<OffsetAllocator::Allocator> m_pSceneAnimationBufferAllocator;
 
+    struct Material
+    {
+        ModelMaterialConstant data;
+        uint64_t hash = 0;
+        uint32_t refCount = 0;
+    };
+    eastl::vector<Material> m_materials;
+    eastl::hash_map<uint64_t, uint32_t> m_materialMap; //content hash -> slot
+    eastl::vector<uint32_t> m_freeMaterials;
+    eastl::vector<eastl::pair<uint32_t, uint64_t>> m_pendingMaterialFrees; //(slot, frame id), may still be used by the frames in flight
+    eastl::unique_ptr<RawBuffer> m_pMaterialBuffer;
+    eastl::vector<eastl::pair<eastl::unique_ptr<RawBuffer>, uint64_t>> m_retiredMaterialBuffers; //(buffer, frame id), replaced by a larger one
+    uint32_t m_nMaterialCapacity = 0;
+    uint32_t m_nMaterialUploadSize = 0;
+    uint32_t m_nMaterialReferenceSize = 0;
+    uint32_t m_nLastFrameMaterialUploadSize = 0;
+    uint32_t m_nLastFrameMaterialReferenceSize = 0;
+
     eastl::unique_ptr<RawBuffer> m_pConstantBuffer[GFX_MAX_INFLIGHT_FRAMES]; //todo : change to gpu memory, and only update dirty regions
     uint32_t m_nConstantBufferOffset = 0;
 
     eastl::unique_ptr<IGfxRayTracingTLAS> m_pSceneTLAS;
     eastl::unique_ptr<IGfxDescriptor> m_pSceneTLASSRV;
     eastl::vector<GfxRayTracingInstance> m_raytracingInstances;
+    eastl::vector<RayTracingBLAS*> m_raytracingBLASes; //of each instance
+    RayTracingTLASTracker m_tlasTracker;
 };
\ No newline at end of file
@@ -1,13 +1,30 @@
 #include "clustered_light_lists.h"
 #include "../renderer.h"
+#include "../hierarchical_depth_buffer.h"
+#include "utils/gui_util.h"
 #include "utils/profiler.h"
 #include "utils/parallel_for.h"
-#include "EASTL/atomic.h"
+#include "utils/log.h"
+#include "EASTL/bitset.h"
+#include "clustered_light_culling.hlsli"
 
-// todo : need a cvar system
-static const uint32_t tileSize = 64;
-static const uint32_t sliceCount = 16;
-static const float maxSliceDepth = 500.0f;
+//cbuffer of clustered_light_culling.hlsl
+struct ClusteredLightCullingCB
+{
+    uint32_t lightCount;
+    uint32_t viewLightsBuffer;
+    uint32_t lightGridsBuffer;
+    uint32_t lightIndicesBuffer;
+
+    uint32_t lightIndexCounterBuffer;
+    uint32_t maxLightIndexCount;
+    uint32_t tileSize;
+    uint32_t sliceCount;
+
+    float maxSliceDepth;
+    uint32_t hzbMip;
+    uint2 hzbMipSize;
+};
 
 inline float4 GetLightBoudingSphere(const LocalLightData& light)
 {
@@ -25,39 +42,231 @@ inline float4 GetLightBoudingSphere(const LocalLightData& light)
     return float4();
 }
 
-inline float GetSliceDepth(uint32_t sliceIndex, uint32_t sliceCount, float zNear, float zFar)
+void ClusteredLightLists::BuildClusterBounds(uint32_t width, uint32_t height, const float4x4& mtxInvProjection, float zNear, float3* aabbMin, float3* aabbMax)
 {
-    return zNear * powf(zFar / zNear, (float)sliceIndex / (float)sliceCount);
-}
+    const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
+    const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
+    const uint32_t tilesPerSlice = tileCountX * tileCountY;
 
-inline float3 ToViewSpace(float2 screenPos, uint32_t width, uint32_t height, const float4x4& mtxInvProjection)
-{
-    float2 screenUV = float2(screenPos) / float2(width, height);
-    float2 ndcPos = (screenUV * 2.0f - 1.0f) * float2(1.0f, -1.0f);
+    ParallelFor(tilesPerSlice * sliceCount, [&](uint32_t index)
+        {
+            uint32_t sliceIndex = index / tilesPerSlice;
+            uint32_t tileIndex = index % tilesPerSlice;
+
+            float tileNearDepth = GetClusterSliceDepth(sliceIndex, sliceCount, zNear, maxSliceDepth);
+            float tileFarDepth = GetClusterSliceDepth(sliceIndex + 1, sliceCount, zNear, maxSliceDepth);
 
-    float3 viewPos = mul(mtxInvProjection, float4(ndcPos, 0.0, 1.0)).xyz();
-    return viewPos;
+            ClusterAABB aabb = GetClusterAABB(tileIndex % tileCountX, tileIndex / tileCountX, tileSize, tileNearDepth, tileFarDepth, float2(width, height), mtxInvProjection);
+            aabbMin[index] = aabb.minPoint;
+            aabbMax[index] = aabb.maxPoint;
+        });
 }
 
-inline float3 LineIntersectionWithZPlane(float3 start, float3 end, float zPlane)
+void ClusteredLightBinner::Bin(const Light* lights, uint32_t light_count, uint32_t tile_count_x, uint32_t tile_count_y, uint32_t slice_count,
+    const float3* aabb_min, const float3* aabb_max)
 {
-    float3 direction = end - start;
-    float3 normal = float3(0.0f, 0.0f, 1.0f);
+    const uint32_t tiles_per_slice = tile_count_x * tile_count_y;
+    const uint32_t cluster_count = tiles_per_slice * slice_count;
+    const uint32_t word_count = DivideRoudingUp(light_count, 32);
+
+    m_lightGrids.resize(cluster_count);
+    m_lightIndices.clear();
+
+    if (light_count == 0)
+    {
+        eastl::fill(m_lightGrids.begin(), m_lightGrids.end(), uint2(0, 0));
+        return;
+    }
+
+    //SoA copy, the padding lights are far enough to fail every test
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        m_lightPositions[axis].resize(word_count * 32);
+
+        for (uint32_t i = 0; i < light_count; ++i)
+        {
+            m_lightPositions[axis][i] = lights[i].position[axis];
+        }
+        eastl::fill(m_lightPositions[axis].begin() + light_count, m_lightPositions[axis].end(), FLT_MAX);
+    }
+
+    m_lightRadii.resize(word_count * 32);
+    for (uint32_t i = 0; i < light_count; ++i)
+    {
+        m_lightRadii[i] = lights[i].radius;
+    }
+    eastl::fill(m_lightRadii.begin() + light_count, m_lightRadii.end(), 0.0f);
+
+    //rows : one per slice (z), then one per slice and tile column (x), then one per slice and tile row (y)
+    const uint32_t column_row_offset = slice_count;
+    const uint32_t tile_row_offset = slice_count + slice_count * tile_count_x;
+    const uint32_t row_count = tile_row_offset + slice_count * tile_count_y;
+
+    m_rowBounds.resize(row_count);
+
+    for (uint32_t slice = 0; slice < slice_count; ++slice)
+    {
+        uint32_t first_cluster = slice * tiles_per_slice;
+        m_rowBounds[slice] = float2(aabb_min[first_cluster].z, aabb_max[first_cluster].z);
+
+        for (uint32_t x = 0; x < tile_count_x; ++x)
+        {
+            m_rowBounds[column_row_offset + slice * tile_count_x + x] = float2(FLT_MAX, -FLT_MAX);
+        }
+
+        for (uint32_t y = 0; y < tile_count_y; ++y)
+        {
+            m_rowBounds[tile_row_offset + slice * tile_count_y + y] = float2(FLT_MAX, -FLT_MAX);
+        }
+
+        for (uint32_t tile = 0; tile < tiles_per_slice; ++tile)
+        {
+            uint32_t cluster = first_cluster + tile;
+
+            float2& slice_bounds = m_rowBounds[slice];
+            slice_bounds = float2(eastl::min(slice_bounds.x, aabb_min[cluster].z), eastl::max(slice_bounds.y, aabb_max[cluster].z));
+
+            float2& column_bounds = m_rowBounds[column_row_offset + slice * tile_count_x + tile % tile_count_x];
+            column_bounds = float2(eastl::min(column_bounds.x, aabb_min[cluster].x), eastl::max(column_bounds.y, aabb_max[cluster].x));
+
+            float2& row_bounds = m_rowBounds[tile_row_offset + slice * tile_count_y + tile / tile_count_x];
+            row_bounds = float2(eastl::min(row_bounds.x, aabb_min[cluster].y), eastl::max(row_bounds.y, aabb_max[cluster].y));
+        }
+    }
+
+    //the distance along one axis is never larger than the distance to a cluster inside the row, so the masks keep every light of the exact test
+    m_rowMasks.resize(row_count * word_count);
+
+    ParallelFor(row_count, [&](uint32_t row)
+        {
+            uint32_t axis = row < column_row_offset ? 2 : (row < tile_row_offset ? 0 : 1);
+            const float* positions = m_lightPositions[axis].data();
+            const float* radii = m_lightRadii.data();
+
+            hlslpp::float4 row_min(m_rowBounds[row].x);
+            hlslpp::float4 row_max(m_rowBounds[row].y);
+            hlslpp::float4 zero(0.0f);
+            hlslpp::float4 bit_weights(1.0f, 2.0f, 4.0f, 8.0f);
+
+            uint32_t* masks = &m_rowMasks[row * word_count];
+
+            for (uint32_t word = 0; word < word_count; ++word)
+            {
+                uint32_t bits = 0;
+
+                for (uint32_t j = 0; j < 32; j += 4)
+                {
+                    uint32_t i = word * 32 + j;
+                    hlslpp::float4 position(positions[i], positions[i + 1], positions[i + 2], positions[i + 3]);
+                    hlslpp::float4 radius(radii[i], radii[i + 1], radii[i + 2], radii[i + 3]);
+
+                    hlslpp::float4 distance = hlslpp::max(hlslpp::max(row_min - position, position - row_max), zero);
+                    hlslpp::float4 inside = distance * distance <= radius * radius;
+
+                    bits |= (uint32_t)hlslpp::dot(inside, bit_weights) << j;
+                }
+
+                masks[word] = bits;
+            }
+        });
+
+    //the candidates of a cluster are the lights in its slice, column and row masks
+    auto bin_cluster = [&](uint32_t cluster, uint32_t* output)
+    {
+        uint32_t slice = cluster / tiles_per_slice;
+        uint32_t tile = cluster % tiles_per_slice;
+
+        const uint32_t* slice_mask = &m_rowMasks[slice * word_count];
+        const uint32_t* column_mask = &m_rowMasks[(column_row_offset + slice * tile_count_x + tile % tile_count_x) * word_count];
+        const uint32_t* row_mask = &m_rowMasks[(tile_row_offset + slice * tile_count_y + tile / tile_count_x) * word_count];
+
+        uint32_t count = 0;
+
+        for (uint32_t word = 0; word < word_count; ++word)
+        {
+            uint32_t bits = slice_mask[word] & column_mask[word] & row_mask[word];
+
+            while (bits != 0)
+            {
+                uint32_t i = word * 32 + eastl::GetFirstBit(bits);
+                bits &= bits - 1;
+
+                if (TestSphereAABB(lights[i].position, lights[i].radius, aabb_min[cluster], aabb_max[cluster]))
+                {
+                    if (output)
+                    {
+                        output[count] = lights[i].index;
+                    }
+                    ++count;
+                }
+            }
+        }
+
+        return count;
+    };
+
+    //counts first, so that the lists are written in place without per cluster allocations
+    ParallelFor(cluster_count, [&](uint32_t cluster)
+        {
+            m_lightGrids[cluster].y = bin_cluster(cluster, nullptr);
+        });
+
+    uint32_t offset = 0;
+    for (uint32_t cluster = 0; cluster < cluster_count; ++cluster)
+    {
+        m_lightGrids[cluster].x = offset;
+        offset += m_lightGrids[cluster].y;
+    }
+
+    m_lightIndices.resize(offset);
 
-    float t = (zPlane - dot(normal, start)) / dot(normal, direction);
-    return start + t * direction;
+    ParallelFor(cluster_count, [&](uint32_t cluster)
+        {
+            if (m_lightGrids[cluster].y > 0)
+            {
+                bin_cluster(cluster, &m_lightIndices[m_lightGrids[cluster].x]);
+            }
+        });
 }
 
-inline bool TestSphereAABB(float3 position, float radius, float3 aabbMin, float3 aabbMax)
+void ClusteredLightBinner::BinReference(const Light* lights, uint32_t light_count, uint32_t tile_count_x, uint32_t tile_count_y, uint32_t slice_count,
+    const float3* aabb_min, const float3* aabb_max)
 {
-    float3 closestPoint = clamp(position, aabbMin, aabbMax);
-    float distanceSquared = dot(closestPoint - position, closestPoint - position);
-    return distanceSquared <= radius * radius;
+    const uint32_t cluster_count = tile_count_x * tile_count_y * slice_count;
+
+    eastl::vector<eastl::vector<uint32_t>> clusters(cluster_count);
+
+    ParallelFor(cluster_count, [&](uint32_t cluster)
+        {
+            for (uint32_t i = 0; i < light_count; ++i)
+            {
+                if (TestSphereAABB(lights[i].position, lights[i].radius, aabb_min[cluster], aabb_max[cluster]))
+                {
+                    clusters[cluster].push_back(lights[i].index);
+                }
+            }
+        });
+
+    m_lightGrids.resize(cluster_count);
+    m_lightIndices.clear();
+
+    for (uint32_t cluster = 0; cluster < cluster_count; ++cluster)
+    {
+        m_lightGrids[cluster] = uint2((uint32_t)m_lightIndices.size(), (uint32_t)clusters[cluster].size());
+        m_lightIndices.insert(m_lightIndices.end(), clusters[cluster].begin(), clusters[cluster].end());
+    }
 }
 
 ClusteredLightLists::ClusteredLightLists(Renderer* pRenderer)
 {
     m_pRenderer = pRenderer;
+
+    GfxComputePipelineDesc desc;
+    desc.cs = pRenderer->GetShader("clustered_light_culling.hlsl", "transform_lights", GfxShaderType::CS);
+    m_pTransformLightsPSO = pRenderer->GetPipelineState(desc, "ClusteredLightLists/transform lights PSO");
+
+    desc.cs = pRenderer->GetShader("clustered_light_culling.hlsl", "cull_lights", GfxShaderType::CS);
+    m_pCullLightsPSO = pRenderer->GetPipelineState(desc, "ClusteredLightLists/cull lights PSO");
 }
 
 ClusteredLightLists::~ClusteredLightLists()
@@ -72,113 +281,181 @@ void ClusteredLightLists::Build(uint32_t width, uint32_t height)
     const LocalLightData* lights = m_pRenderer->GetLocalLights();
     const Camera* camera = Engine::GetInstance()->GetWorld()->GetCamera();
 
-    struct ViewSpaceLight
-    {
-        float3 position;
-        float radius;
-        uint lightIndex;
-    };
-    
-    eastl::vector<ViewSpaceLight> viewSpaceLights(lightCount);
-    eastl::atomic<uint32_t> viewSpaceLightCount = 0;
-
     // cull lights & transform to view space
-    ParallelFor(lightCount, [&](uint32_t index)
-        {
-            float4 boudingSphere = GetLightBoudingSphere(lights[index]);
+    m_lights.resize(lightCount);
+    m_lightVisible.resize(lightCount);
 
-            if (FrustumCull(camera->GetFrustumPlanes(), 6, boudingSphere.xyz(), boudingSphere.w))
+    if (lightCount > 0)
+    {
+        ParallelFor(lightCount, [&](uint32_t index)
             {
-                ViewSpaceLight viewSpaceLight;
-                viewSpaceLight.position = mul(camera->GetViewMatrix(), float4(boudingSphere.xyz(), 1.0)).xyz();
-                viewSpaceLight.radius = boudingSphere.w;
-                viewSpaceLight.lightIndex = index;
-
-                uint32_t viewSpaceLightIndex = viewSpaceLightCount.fetch_add(1);
-                viewSpaceLights[viewSpaceLightIndex] = viewSpaceLight;
-            }
-        });
+                float4 boudingSphere = GetLightBoudingSphere(lights[index]);
 
-    viewSpaceLights.resize(viewSpaceLightCount);
+                m_lightVisible[index] = FrustumCull(camera->GetFrustumPlanes(), 6, boudingSphere.xyz(), boudingSphere.w);
+                m_lights[index].position = mul(camera->GetViewMatrix(), float4(boudingSphere.xyz(), 1.0)).xyz();
+                m_lights[index].radius = boudingSphere.w;
+                m_lights[index].index = index;
+            });
+    }
 
+    // compacted in the light order, so that the lists do not depend on the scheduling
+    uint32_t visibleLightCount = 0;
+    for (uint32_t i = 0; i < lightCount; ++i)
+    {
+        if (m_lightVisible[i])
+        {
+            m_lights[visibleLightCount++] = m_lights[i];
+        }
+    }
 
     const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
     const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
-    const uint32_t tilesPerSlice = tileCountX * tileCountY;
-    const uint32_t cellCount = tilesPerSlice * sliceCount;
+    const uint32_t cellCount = tileCountX * tileCountY * sliceCount;
 
-    struct Cluster
-    {
-        float3 aabbMin;
-        float3 aabbMax;
-        eastl::vector<uint32_t> lightIndices;
-    };
-    eastl::vector<Cluster> clusters(cellCount);
+    m_clusterMin.resize(cellCount);
+    m_clusterMax.resize(cellCount);
+    BuildClusterBounds(width, height, inverse(camera->GetProjectionMatrix()), camera->GetZNear(), m_clusterMin.data(), m_clusterMax.data());
 
-    eastl::atomic<uint32_t> lightIndicesCount = 0;
-    float4x4 mtxInvProjection = inverse(camera->GetProjectionMatrix());
+    m_binner.Bin(m_lights.data(), visibleLightCount, tileCountX, tileCountY, sliceCount, m_clusterMin.data(), m_clusterMax.data());
 
-    // build the cluster grid & assign lights to clusters
-    ParallelFor(cellCount, [&](uint32_t index)
-        {
-            uint32_t sliceIndex = index / tilesPerSlice;
-            uint32_t tileIndex = index % tilesPerSlice;
-            uint32_t tileX = tileIndex % tileCountX;
-            uint32_t tileY = tileIndex / tileCountX;
+    const eastl::vector<uint2>& lightGrids = m_binner.GetLightGrids();
+    const eastl::vector<uint32_t>& lightIndices = m_binner.GetLightIndices();
+
+    m_lightGridBufferAddress = m_pRenderer->AllocateSceneConstant(lightGrids.data(), sizeof(uint2) * (uint32_t)lightGrids.size());
+    m_lightIndicesBufferAddress = m_pRenderer->AllocateSceneConstant(lightIndices.data(), sizeof(uint32_t) * (uint32_t)lightIndices.size());
+}
+
+void ClusteredLightLists::AddCullingPass(RenderGraph* pRenderGraph, uint32_t width, uint32_t height)
+{
+    RENDER_GRAPH_EVENT(pRenderGraph, "ClusteredLightCulling");
+
+    const uint32_t lightCount = m_pRenderer->GetLocalLightCount();
+    const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
+    const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
+    const uint32_t cellCount = tileCountX * tileCountY * sliceCount;
+    const uint32_t maxLightIndexCount = cellCount * maxAverageLightsPerCluster;
 
-            float2 screenSpaceTileMin = float2(tileX, tileY) * tileSize;
-            float2 screenSpaceTileMax = float2(tileX + 1, tileY + 1) * tileSize;
-            
-            float3 viewSpaceTileMin = ToViewSpace(screenSpaceTileMin, width, height, mtxInvProjection);
-            float3 viewSpaceTileMax = ToViewSpace(screenSpaceTileMax, width, height, mtxInvProjection);
+    HZB* pHZB = m_pRenderer->GetHZB();
 
-            float tileNearDepth = GetSliceDepth(sliceIndex, sliceCount, camera->GetZNear(), maxSliceDepth);
-            float tileFarDepth = GetSliceDepth(sliceIndex + 1, sliceCount, camera->GetZNear(), maxSliceDepth);
+    //the HZB mip where a tile covers at most 2x2 texels
+    float hzbTileExtent = eastl::max((float)tileSize * pHZB->GetHZBWidth() / width, (float)tileSize * pHZB->GetHZBHeight() / height);
+    uint32_t hzbMip = eastl::min((uint32_t)ceilf(log2f(hzbTileExtent)), pHZB->GetHZBMipCount() - 1);
+    uint2 hzbMipSize = uint2(eastl::max(pHZB->GetHZBWidth() >> hzbMip, 1u), eastl::max(pHZB->GetHZBHeight() >> hzbMip, 1u));
 
-            float3 minPointNear = LineIntersectionWithZPlane(float3(0.0), viewSpaceTileMin, tileNearDepth);
-            float3 minPointFar = LineIntersectionWithZPlane(float3(0.0), viewSpaceTileMin, tileFarDepth);
-            float3 maxPointNear = LineIntersectionWithZPlane(float3(0.0), viewSpaceTileMax, tileNearDepth);
-            float3 maxPointFar = LineIntersectionWithZPlane(float3(0.0), viewSpaceTileMax, tileFarDepth);
+    struct TransformLightsData
+    {
+        RGHandle viewLights;
+        RGHandle lightIndexCounter;
+    };
 
-            Cluster& cluster = clusters[index];
+    auto transform_pass = pRenderGraph->AddPass<TransformLightsData>("Transform Lights", RenderPassType::Compute,
+        [&](TransformLightsData& data, RGBuilder& builder)
+        {
+            RGBuffer::Desc desc;
+            desc.stride = sizeof(float4);
+            desc.size = desc.stride * eastl::max(lightCount, 1u);
+            desc.usage = GfxBufferUsageStructuredBuffer;
+            data.viewLights = builder.Create<RGBuffer>(desc, "ClusteredLightLists view lights");
+            data.viewLights = builder.Write(data.viewLights);
+
+            desc.stride = sizeof(uint32_t);
+            desc.size = sizeof(uint32_t);
+            desc.format = GfxFormat::R32UI;
+            desc.usage = GfxBufferUsageTypedBuffer;
+            data.lightIndexCounter = builder.Create<RGBuffer>(desc, "ClusteredLightLists light index counter");
+            data.lightIndexCounter = builder.Write(data.lightIndexCounter);
+        },
+        [=](const TransformLightsData& data, IGfxCommandList* pCommandList)
+        {
+            RGBuffer* viewLights = pRenderGraph->GetBuffer(data.viewLights);
+            RGBuffer* lightIndexCounter = pRenderGraph->GetBuffer(data.lightIndexCounter);
 
-            cluster.aabbMin = min(min(minPointNear, minPointFar), min(maxPointNear, maxPointFar));
-            cluster.aabbMax = max(max(minPointNear, minPointFar), max(maxPointNear, maxPointFar));
+            uint32_t clear_value[4] = { 0, 0, 0, 0 };
+            pCommandList->ClearUAV(lightIndexCounter->GetBuffer(), lightIndexCounter->GetUAV(), clear_value);
+            pCommandList->BufferBarrier(lightIndexCounter->GetBuffer(), GfxAccessClearUAV, GfxAccessComputeUAV);
 
-            for (uint32_t i = 0; i < viewSpaceLights.size(); ++i)
+            if (lightCount > 0)
             {
-                if (TestSphereAABB(viewSpaceLights[i].position, viewSpaceLights[i].radius, cluster.aabbMin, cluster.aabbMax))
-                {
-                    cluster.lightIndices.push_back(viewSpaceLights[i].lightIndex);
+                ClusteredLightCullingCB cb = {};
+                cb.lightCount = lightCount;
+                cb.viewLightsBuffer = viewLights->GetUAV()->GetHeapIndex();
 
-                    lightIndicesCount++;
-                }
+                pCommandList->SetPipelineState(m_pTransformLightsPSO);
+                pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+                pCommandList->Dispatch(DivideRoudingUp(lightCount, CLUSTERED_LIGHT_CULLING_GROUP_SIZE), 1, 1);
             }
         });
 
-    // compact the light lists
-    eastl::vector<uint32_t> lightIndices(lightIndicesCount);
-    eastl::vector<uint2> lightGrids(cellCount);
+    struct CullLightsData
+    {
+        RGHandle sceneHZB;
+        RGHandle viewLights;
+        RGHandle lightIndexCounter;
+        RGHandle lightGrids;
+        RGHandle lightIndices;
+    };
 
-    eastl::atomic<uint32_t> lightIndicesOffset = 0;
+    auto cull_pass = pRenderGraph->AddPass<CullLightsData>("Cull Lights", RenderPassType::Compute,
+        [&](CullLightsData& data, RGBuilder& builder)
+        {
+            for (uint32_t i = 0; i < pHZB->GetHZBMipCount(); ++i)
+            {
+                data.sceneHZB = builder.Read(pHZB->GetSceneHZBMip(i), i);
+            }
 
-    ParallelFor(cellCount, [&](uint32_t index)
+            data.viewLights = builder.Read(transform_pass->viewLights);
+            data.lightIndexCounter = builder.Write(transform_pass->lightIndexCounter);
+
+            RGBuffer::Desc desc;
+            desc.stride = sizeof(uint2);
+            desc.size = desc.stride * cellCount;
+            desc.usage = GfxBufferUsageStructuredBuffer;
+            data.lightGrids = builder.Create<RGBuffer>(desc, "ClusteredLightLists light grids");
+            data.lightGrids = builder.Write(data.lightGrids);
+
+            desc.stride = sizeof(uint32_t);
+            desc.size = desc.stride * maxLightIndexCount;
+            data.lightIndices = builder.Create<RGBuffer>(desc, "ClusteredLightLists light indices");
+            data.lightIndices = builder.Write(data.lightIndices);
+        },
+        [=](const CullLightsData& data, IGfxCommandList* pCommandList)
         {
-            Cluster& cluster = clusters[index];
+            ClusteredLightCullingCB cb;
+            cb.lightCount = lightCount;
+            cb.viewLightsBuffer = pRenderGraph->GetBuffer(data.viewLights)->GetSRV()->GetHeapIndex();
+            cb.lightGridsBuffer = pRenderGraph->GetBuffer(data.lightGrids)->GetUAV()->GetHeapIndex();
+            cb.lightIndicesBuffer = pRenderGraph->GetBuffer(data.lightIndices)->GetUAV()->GetHeapIndex();
+            cb.lightIndexCounterBuffer = pRenderGraph->GetBuffer(data.lightIndexCounter)->GetUAV()->GetHeapIndex();
+            cb.maxLightIndexCount = maxLightIndexCount;
+            cb.tileSize = tileSize;
+            cb.sliceCount = sliceCount;
+            cb.maxSliceDepth = maxSliceDepth;
+            cb.hzbMip = hzbMip;
+            cb.hzbMipSize = hzbMipSize;
+
+            pCommandList->SetPipelineState(m_pCullLightsPSO);
+            pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+            pCommandList->Dispatch(tileCountX, tileCountY, sliceCount);
+        });
 
-            uint32_t lightCount = (uint32_t)cluster.lightIndices.size();
-            uint32_t offset = lightIndicesOffset.fetch_add(lightCount);
+    m_lightGridsBuffer = cull_pass->lightGrids;
+    m_lightIndicesBuffer = cull_pass->lightIndices;
+    m_nGpuCullingFrame = m_pRenderer->GetFrameID();
+}
 
-            lightGrids[index] = uint2(offset, lightCount);
+RGHandle ClusteredLightLists::GetLightGridsBuffer() const
+{
+    return m_nGpuCullingFrame == m_pRenderer->GetFrameID() ? m_lightGridsBuffer : RGHandle();
+}
 
-            if (lightCount > 0)
-            {
-                memcpy(lightIndices.data() + offset, cluster.lightIndices.data(), sizeof(uint32_t) * lightCount);
-            }
-        });
+RGHandle ClusteredLightLists::GetLightIndicesBuffer() const
+{
+    return m_nGpuCullingFrame == m_pRenderer->GetFrameID() ? m_lightIndicesBuffer : RGHandle();
+}
 
-    m_lightGridBufferAddress = m_pRenderer->AllocateSceneConstant(lightGrids.data(), sizeof(uint2) * (uint32_t)lightGrids.size());
-    m_lightIndicesBufferAddress = m_pRenderer->AllocateSceneConstant(lightIndices.data(), sizeof(uint32_t) * (uint32_t)lightIndices.size());
+void ClusteredLightLists::OnGui()
+{
+    ImGui::Checkbox("GPU Light Culling##ClusteredLightLists", &m_bGpuCulling);
 }
 
 uint32_t ClusteredLightLists::GetTileSize() const
@@ -2,6 +2,44 @@
 
 #include "../render_graph.h"
 
+//bins view space light spheres into the clusters of a froxel grid.
+//each slice, each column of tiles in a slice and each row of tiles in a slice has a bitmask of the lights its bounds can touch,
+//built by testing the lights along a single axis, 4 at a time. a cluster ANDs the words of its three masks to get its candidates,
+//which then get the exact sphere/AABB test. the output is one contiguous index list, in the cluster order,
+//with the lights of each cluster in the input order
+class ClusteredLightBinner
+{
+public:
+    struct Light
+    {
+        float3 position; //view space
+        float radius;
+        uint32_t index;
+    };
+
+    //the cluster bounds are in view space, in the grid order : x, then y, then slice
+    void Bin(const Light* lights, uint32_t light_count, uint32_t tile_count_x, uint32_t tile_count_y, uint32_t slice_count,
+        const float3* aabb_min, const float3* aabb_max);
+
+    //tests every light against every cluster, the former implementation, for comparison
+    void BinReference(const Light* lights, uint32_t light_count, uint32_t tile_count_x, uint32_t tile_count_y, uint32_t slice_count,
+        const float3* aabb_min, const float3* aabb_max);
+
+    const eastl::vector<uint2>& GetLightGrids() const { return m_lightGrids; } //x : offset, y : count
+    const eastl::vector<uint32_t>& GetLightIndices() const { return m_lightIndices; }
+
+private:
+    //all the buffers are kept across frames
+    eastl::vector<float> m_lightPositions[3]; //SoA, padded to a multiple of 4 lights
+    eastl::vector<float> m_lightRadii;
+
+    eastl::vector<float2> m_rowBounds; //min/max along the axis of each row
+    eastl::vector<uint32_t> m_rowMasks;
+
+    eastl::vector<uint2> m_lightGrids;
+    eastl::vector<uint32_t> m_lightIndices;
+};
+
 class ClusteredLightLists
 {
 public:
@@ -11,13 +49,50 @@ public:
     void Build(uint32_t width, uint32_t height);
     uint32_t GetLightGridBufferAddress() const { return m_lightGridBufferAddress; }
     uint32_t GetLightIndicesBufferAddress() const { return m_lightIndicesBufferAddress; }
+
+    //builds the lists on the GPU instead, with the cluster depths clipped to the scene HZB. Build is not needed then
+    void AddCullingPass(RenderGraph* pRenderGraph, uint32_t width, uint32_t height);
+    bool IsGpuCullingEnabled() const { return m_bGpuCulling; }
+
+    //output of this frame's culling pass, invalid if the lists were built on the CPU
+    RGHandle GetLightGridsBuffer() const;
+    RGHandle GetLightIndicesBuffer() const;
+
+    void OnGui();
     uint32_t GetTileSize() const;
     uint32_t GetSliceCount() const;
     float2 GetSliceParams(class Camera* camera) const;
 
+private:
+    friend bool TestLightBinning();
+    friend bool TestLightCulling();
+
+    //the cluster bounds in view space, in the grid order : x, then y, then slice
+    static void BuildClusterBounds(uint32_t width, uint32_t height, const float4x4& mtxInvProjection, float zNear, float3* aabbMin, float3* aabbMax);
+
+    // todo : need a cvar system
+    static constexpr uint32_t tileSize = 64;
+    static constexpr uint32_t sliceCount = 16;
+    static constexpr float maxSliceDepth = 500.0f;
+    static constexpr uint32_t maxAverageLightsPerCluster = 32; //size of the GPU light index list
+
 private:
     Renderer* m_pRenderer = nullptr;
 
+    eastl::vector<ClusteredLightBinner::Light> m_lights;
+    eastl::vector<uint8_t> m_lightVisible;
+    eastl::vector<float3> m_clusterMin;
+    eastl::vector<float3> m_clusterMax;
+    ClusteredLightBinner m_binner;
+
     uint32_t m_lightGridBufferAddress = 0;
     uint32_t m_lightIndicesBufferAddress = 0;
-};
\ No newline at end of file
+
+    IGfxPipelineState* m_pTransformLightsPSO = nullptr;
+    IGfxPipelineState* m_pCullLightsPSO = nullptr;
+
+    bool m_bGpuCulling = false;
+    uint64_t m_nGpuCullingFrame = uint64_t(-1);
+    RGHandle m_lightGridsBuffer;
+    RGHandle m_lightIndicesBuffer;
+};
@@ -22,28 +22,46 @@ void DirectLighting::OnGui()
     if (ImGui::CollapsingHeader("Direct Lighting"))
     {
         ImGui::Combo("Mode##DirectLighting", (int*)&m_mode, "Clustered\0TiledTree\0Hybrid\0ReSTIR\0\0", (int)DirectLightingMode::Num);
+
+        if (m_mode == DirectLightingMode::Clustered || m_mode == DirectLightingMode::Hybrid)
+        {
+            m_pClusteredLightLists->OnGui();
+        }
+
+        if (m_mode == DirectLightingMode::TiledTree || m_mode == DirectLightingMode::Hybrid)
+        {
+            m_pTiledLightTrees->OnGui();
+        }
     }
 }
 
 RGHandle DirectLighting::AddPass(RenderGraph* pRenderGraph, RGHandle diffuse, RGHandle specular, RGHandle normal, 
     RGHandle customData, RGHandle depth, RGHandle shadow, uint32_t width, uint32_t height)
 {
-    switch (m_mode)
+    bool clusteredLightLists = m_mode == DirectLightingMode::Clustered || m_mode == DirectLightingMode::Hybrid;
+    bool lightTreeSampling = m_mode == DirectLightingMode::TiledTree || m_mode == DirectLightingMode::Hybrid;
+
+    if (clusteredLightLists)
+    {
+        if (m_pClusteredLightLists->IsGpuCullingEnabled())
+        {
+            m_pClusteredLightLists->AddCullingPass(pRenderGraph, width, height);
+        }
+        else
+        {
+            m_pClusteredLightLists->Build(width, height);
+        }
+    }
+
+    RGHandle lightTreeCuts;
+    if (lightTreeSampling)
+    {
+        lightTreeCuts = m_pTiledLightTrees->AddCutsPass(pRenderGraph, width, height);
+    }
+
+    if (m_mode == DirectLightingMode::ReSTIR)
     {
-    case DirectLightingMode::Clustered:
-        m_pClusteredLightLists->Build(width, height);
-        break;
-    case DirectLightingMode::TiledTree:
-        //todo
-        break;
-    case DirectLightingMode::Hybrid:
-        //todo
-        break;
-    case DirectLightingMode::ReSTIR:
         //todo
-        break;
-    default:
-        break;
     }
 
     struct DirectLightingData
@@ -54,6 +72,9 @@ RGHandle DirectLighting::AddPass(RenderGraph* pRenderGraph, RGHandle diffuse, RG
         RGHandle customDataRT;
         RGHandle depthRT;
         RGHandle shadow;
+        RGHandle lightGrids;
+        RGHandle lightIndices;
+        RGHandle lightTreeCuts;
         RGHandle output;
     };
 
@@ -67,6 +88,19 @@ RGHandle DirectLighting::AddPass(RenderGraph* pRenderGraph, RGHandle diffuse, RG
             data.depthRT = builder.Read(depth);
             data.shadow = builder.Read(shadow);
 
+            //light lists culled on the GPU, read through the scene constants
+            RGHandle lightGrids = m_pClusteredLightLists->GetLightGridsBuffer();
+            if (lightGrids.IsValid())
+            {
+                data.lightGrids = builder.Read(lightGrids);
+                data.lightIndices = builder.Read(m_pClusteredLightLists->GetLightIndicesBuffer());
+            }
+
+            if (lightTreeCuts.IsValid())
+            {
+                data.lightTreeCuts = builder.Read(lightTreeCuts);
+            }
+
             RGTexture::Desc desc;
             desc.width = width;
             desc.height = height;
@@ -84,6 +118,7 @@ RGHandle DirectLighting::AddPass(RenderGraph* pRenderGraph, RGHandle diffuse, RG
                 pRenderGraph->GetTexture(data.depthRT),
                 pRenderGraph->GetTexture(data.shadow),
                 pRenderGraph->GetTexture(data.output),
+                data.lightTreeCuts.IsValid() ? pRenderGraph->GetBuffer(data.lightTreeCuts) : nullptr,
                 width, height);
         });
 
@@ -91,7 +126,7 @@ RGHandle DirectLighting::AddPass(RenderGraph* pRenderGraph, RGHandle diffuse, RG
 }
 
 void DirectLighting::Render(IGfxCommandList* pCommandList, RGTexture* diffuse, RGTexture* specular, RGTexture* normal,
-    RGTexture* customData, RGTexture* depth, RGTexture* shadow, RGTexture* output, uint32_t width, uint32_t height)
+    RGTexture* customData, RGTexture* depth, RGTexture* shadow, RGTexture* output, RGBuffer* lightTreeCuts, uint32_t width, uint32_t height)
 {
     uint cb[] =
     {
@@ -111,6 +146,13 @@ void DirectLighting::Render(IGfxCommandList* pCommandList, RGTexture* diffuse, R
     case DirectLightingMode::Clustered:
         defines.push_back("CLUSTERED_SHADING=1");
         break;
+    case DirectLightingMode::TiledTree:
+        defines.push_back("LIGHT_TREE_SAMPLING=1");
+        break;
+    case DirectLightingMode::Hybrid:
+        defines.push_back("CLUSTERED_SHADING=1");
+        defines.push_back("LIGHT_TREE_SAMPLING=1");
+        break;
     default:
         break;
     }
@@ -121,5 +163,11 @@ void DirectLighting::Render(IGfxCommandList* pCommandList, RGTexture* diffuse, R
 
     pCommandList->SetPipelineState(pPSO);
     pCommandList->SetComputeConstants(0, cb, sizeof(cb));
+
+    if (lightTreeCuts)
+    {
+        m_pTiledLightTrees->SetShadingConstants(pCommandList, lightTreeCuts, width);
+    }
+
     pCommandList->Dispatch(DivideRoudingUp(width, 8), DivideRoudingUp(height, 8), 1);
 }
@@ -26,7 +26,7 @@ public:
 
 private:
     void Render(IGfxCommandList* pCommandList, RGTexture* diffuse, RGTexture* specular, RGTexture* normal,
-        RGTexture* customData, RGTexture* depth, RGTexture* shadow, RGTexture* output, uint32_t width, uint32_t height);
+        RGTexture* customData, RGTexture* depth, RGTexture* shadow, RGTexture* output, RGBuffer* lightTreeCuts, uint32_t width, uint32_t height);
 
 private:
     Renderer* m_pRenderer = nullptr;
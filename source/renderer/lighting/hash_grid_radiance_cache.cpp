@@ -1,9 +1,230 @@
 #include "hash_grid_radiance_cache.h"
+#include "../renderer.h"
+#include "core/engine.h"
+#include "utils/gui_util.h"
+#include "utils/log.h"
+
+//cbuffer of hash_grid_radiance_cache.hlsl
+struct HashGridRadianceCacheCB
+{
+    HashGridRadianceCacheParams params;
+
+    uint32_t activeCellsBuffer;
+    uint32_t activeCellCountBuffer;
+    uint32_t indirectArgsBuffer;
+    uint32_t maxSampleCount;
+
+    uint32_t maxAge;
+    uint32_t bReset;
+};
 
 HashGridRadianceCache::HashGridRadianceCache(Renderer* pRenderer)
 {
+    m_pRenderer = pRenderer;
+
+    GfxComputePipelineDesc desc;
+    desc.cs = pRenderer->GetShader("hash_grid_radiance_cache.hlsl", "compact_cells", GfxShaderType::CS);
+    m_pCompactPSO = pRenderer->GetPipelineState(desc, "HashGridRadianceCache/compact PSO");
+
+    desc.cs = pRenderer->GetShader("hash_grid_radiance_cache.hlsl", "prepare_update_args", GfxShaderType::CS);
+    m_pPrepareArgsPSO = pRenderer->GetPipelineState(desc, "HashGridRadianceCache/prepare args PSO");
+
+    desc.cs = pRenderer->GetShader("hash_grid_radiance_cache.hlsl", "update_cells", GfxShaderType::CS);
+    m_pUpdatePSO = pRenderer->GetPipelineState(desc, "HashGridRadianceCache/update PSO");
+}
+
+HashGridRadianceCache::~HashGridRadianceCache() = default;
+
+void HashGridRadianceCache::OnGui()
+{
+    if (ImGui::CollapsingHeader("Radiance Cache"))
+    {
+        ImGui::Checkbox("Enable##RadianceCache", &m_bEnable);
+
+        if (ImGui::SliderInt("Capacity (log2)##RadianceCache", (int*)&m_nCapacityLog2, 12, 21))
+        {
+            m_pKeysBuffer.reset();
+            m_pCellsBuffer.reset();
+        }
+
+        m_bReset |= ImGui::SliderFloat("Cell Size##RadianceCache", &m_cellSize, 0.01f, 1.0f);
+        m_bReset |= ImGui::SliderFloat("Pixels Per Cell##RadianceCache", &m_pixelsPerCell, 1.0f, 64.0f);
+        m_bReset |= ImGui::SliderInt("Max Level##RadianceCache", (int*)&m_nMaxLevel, 0, 16);
+        ImGui::SliderInt("Max Samples##RadianceCache", (int*)&m_nMaxSampleCount, 1, 256);
+        ImGui::SliderInt("Min Samples##RadianceCache", (int*)&m_nMinSampleCount, 1, 64);
+        ImGui::SliderInt("Max Age##RadianceCache", (int*)&m_nMaxAge, 1, 600);
+
+        if (ImGui::Button("Reset##RadianceCache"))
+        {
+            m_bReset = true;
+        }
+    }
+}
+
+void HashGridRadianceCache::CreateBuffers()
+{
+    uint32_t capacity = 1u << m_nCapacityLog2;
+    m_pKeysBuffer.reset(m_pRenderer->CreateTypedBuffer(nullptr, GfxFormat::R32UI, capacity, "HashGridRadianceCache::m_pKeysBuffer", GfxMemoryType::GpuOnly, true));
+    m_pCellsBuffer.reset(m_pRenderer->CreateStructuredBuffer(nullptr, sizeof(HashGridCell), capacity, "HashGridRadianceCache::m_pCellsBuffer", GfxMemoryType::GpuOnly, true));
+    m_bReset = true;
+}
+
+void HashGridRadianceCache::AddPass(RenderGraph* pRenderGraph)
+{
+    m_keys = RGHandle();
+    m_cells = RGHandle();
+
+    if (!m_bEnable)
+    {
+        return;
+    }
+
+    RENDER_GRAPH_EVENT(pRenderGraph, "HashGridRadianceCache");
+
+    if (m_pKeysBuffer == nullptr)
+    {
+        CreateBuffers();
+    }
+
+    m_keys = pRenderGraph->Import(m_pKeysBuffer->GetBuffer(), GfxAccessComputeUAV);
+    m_cells = pRenderGraph->Import(m_pCellsBuffer->GetBuffer(), GfxAccessComputeUAV);
+
+    uint32_t capacity = 1u << m_nCapacityLog2;
+    bool reset = m_bReset;
+    m_bReset = false;
+
+    struct CompactPassData
+    {
+        RGHandle keys;
+        RGHandle cells;
+        RGHandle activeCells;
+        RGHandle activeCellCount;
+    };
+
+    auto compact_pass = pRenderGraph->AddPass<CompactPassData>("HashGridRadianceCache - compact", RenderPassType::Compute,
+        [&](CompactPassData& data, RGBuilder& builder)
+        {
+            data.keys = builder.Write(m_keys);
+            data.cells = builder.Write(m_cells);
+
+            RGBuffer::Desc desc;
+            desc.stride = sizeof(uint32_t);
+            desc.size = sizeof(uint32_t) * capacity;
+            desc.format = GfxFormat::R32UI;
+            desc.usage = GfxBufferUsageTypedBuffer;
+            data.activeCells = builder.Write(builder.Create<RGBuffer>(desc, "HashGridRadianceCache active cells"));
+
+            desc.size = sizeof(uint32_t);
+            data.activeCellCount = builder.Write(builder.Create<RGBuffer>(desc, "HashGridRadianceCache active cell count"));
+        },
+        [=](const CompactPassData& data, IGfxCommandList* pCommandList)
+        {
+            RGBuffer* activeCellCount = pRenderGraph->GetBuffer(data.activeCellCount);
+
+            uint32_t clear_value[4] = { 0, 0, 0, 0 };
+            pCommandList->ClearUAV(activeCellCount->GetBuffer(), activeCellCount->GetUAV(), clear_value);
+            pCommandList->BufferBarrier(activeCellCount->GetBuffer(), GfxAccessClearUAV, GfxAccessComputeUAV);
+
+            HashGridRadianceCacheCB cb = {};
+            cb.params = GetParams();
+            cb.activeCellsBuffer = pRenderGraph->GetBuffer(data.activeCells)->GetUAV()->GetHeapIndex();
+            cb.activeCellCountBuffer = activeCellCount->GetUAV()->GetHeapIndex();
+            cb.maxAge = m_nMaxAge;
+            cb.bReset = reset;
+
+            pCommandList->SetPipelineState(m_pCompactPSO);
+            pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+            pCommandList->Dispatch(DivideRoudingUp(capacity, 64), 1, 1);
+        });
+
+    struct PrepareArgsPassData
+    {
+        RGHandle activeCellCount;
+        RGHandle indirectArgs;
+    };
+
+    auto prepare_args_pass = pRenderGraph->AddPass<PrepareArgsPassData>("HashGridRadianceCache - prepare args", RenderPassType::Compute,
+        [&](PrepareArgsPassData& data, RGBuilder& builder)
+        {
+            data.activeCellCount = builder.Read(compact_pass->activeCellCount);
+
+            RGBuffer::Desc desc;
+            desc.stride = sizeof(uint32_t);
+            desc.size = sizeof(uint32_t) * 3;
+            desc.format = GfxFormat::R32UI;
+            desc.usage = GfxBufferUsageTypedBuffer;
+            data.indirectArgs = builder.Write(builder.Create<RGBuffer>(desc, "HashGridRadianceCache update args"));
+        },
+        [=](const PrepareArgsPassData& data, IGfxCommandList* pCommandList)
+        {
+            HashGridRadianceCacheCB cb = {};
+            cb.activeCellCountBuffer = pRenderGraph->GetBuffer(data.activeCellCount)->GetSRV()->GetHeapIndex();
+            cb.indirectArgsBuffer = pRenderGraph->GetBuffer(data.indirectArgs)->GetUAV()->GetHeapIndex();
+
+            pCommandList->SetPipelineState(m_pPrepareArgsPSO);
+            pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+            pCommandList->Dispatch(1, 1, 1);
+        });
+
+    struct UpdatePassData
+    {
+        RGHandle keys;
+        RGHandle cells;
+        RGHandle activeCells;
+        RGHandle activeCellCount;
+        RGHandle indirectArgs;
+    };
+
+    auto update_pass = pRenderGraph->AddPass<UpdatePassData>("HashGridRadianceCache - update", RenderPassType::Compute,
+        [&](UpdatePassData& data, RGBuilder& builder)
+        {
+            data.keys = builder.Write(compact_pass->keys);
+            data.cells = builder.Write(compact_pass->cells);
+            data.activeCells = builder.Read(compact_pass->activeCells);
+            data.activeCellCount = builder.Read(prepare_args_pass->activeCellCount);
+            data.indirectArgs = builder.ReadIndirectArg(prepare_args_pass->indirectArgs);
+
+            builder.SkipCulling(); //the cells are updated even in the frames nothing queries them
+        },
+        [=](const UpdatePassData& data, IGfxCommandList* pCommandList)
+        {
+            HashGridRadianceCacheCB cb = {};
+            cb.params = GetParams();
+            cb.activeCellsBuffer = pRenderGraph->GetBuffer(data.activeCells)->GetSRV()->GetHeapIndex();
+            cb.activeCellCountBuffer = pRenderGraph->GetBuffer(data.activeCellCount)->GetSRV()->GetHeapIndex();
+            cb.maxSampleCount = m_nMaxSampleCount;
+
+            pCommandList->SetPipelineState(m_pUpdatePSO);
+            pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+            pCommandList->DispatchIndirect(pRenderGraph->GetBuffer(data.indirectArgs)->GetBuffer(), 0);
+        });
+
+    m_keys = update_pass->keys;
+    m_cells = update_pass->cells;
+}
+
+void HashGridRadianceCache::AddQuery(RGBuilder& builder)
+{
+    RE_ASSERT(m_keys.IsValid() && m_cells.IsValid());
+
+    m_keys = builder.Write(m_keys);
+    m_cells = builder.Write(m_cells);
 }
 
-HashGridRadianceCache::~HashGridRadianceCache()
+HashGridRadianceCacheParams HashGridRadianceCache::GetParams() const
 {
+    Camera* camera = Engine::GetInstance()->GetWorld()->GetCamera();
+    float pixelSize = 2.0f * tanf(radians(camera->GetFov()) * 0.5f) / m_pRenderer->GetRenderHeight(); //at a distance of 1
+
+    HashGridRadianceCacheParams params = {};
+    params.keysBuffer = m_pKeysBuffer->GetUAV()->GetHeapIndex();
+    params.cellsBuffer = m_pCellsBuffer->GetUAV()->GetHeapIndex();
+    params.capacity = 1u << m_nCapacityLog2;
+    params.frameIndex = (uint32_t)m_pRenderer->GetFrameID();
+    params.cameraPosition = camera->GetPosition();
+    params.cellSize = m_cellSize;
+    params.lodScale = pixelSize * m_pixelsPerCell;
+    params.maxLevel = m_nMaxLevel;
+    params.minSampleCount = m_nMinSampleCount;
+    return params;
 }
@@ -1,15 +1,56 @@
 #pragma once
 
 #include "../render_graph.h"
+#include "hash_grid_radiance_cache.hlsli"
+
+class TypedBuffer;
+class StructuredBuffer;
 
 // https://gpuopen.com/download/publications/GPUOpen2022_GI1_0.pdf
 
+//world space radiance cache in a spatial hash : the consumers query the cells of their secondary hits with QueryRadianceCache, which allocates
+//the missing ones. every frame, the cells nobody queried for a while are evicted and the others trace a ray to accumulate their radiance,
+//their own hits read the cache again, so the lighting gets more bounces over the frames. it only stores the diffuse lighting
 class HashGridRadianceCache
 {
 public:
     HashGridRadianceCache(Renderer* pRenderer);
     ~HashGridRadianceCache();
 
+    void OnGui();
+
+    //evicts the stale cells, then updates the others. it must come before the consumer passes of the frame
+    void AddPass(RenderGraph* pRenderGraph);
+
+    bool IsEnabled() const { return m_bEnable; }
+
+    //orders a consumer pass after the update and the previous consumers, since they may all allocate cells
+    void AddQuery(RGBuilder& builder);
+
+    //for the cbuffers of the consumers
+    HashGridRadianceCacheParams GetParams() const;
+
+private:
+    void CreateBuffers();
+
 private:
+    Renderer* m_pRenderer = nullptr;
+    IGfxPipelineState* m_pCompactPSO = nullptr;
+    IGfxPipelineState* m_pPrepareArgsPSO = nullptr;
+    IGfxPipelineState* m_pUpdatePSO = nullptr;
+
+    eastl::unique_ptr<TypedBuffer> m_pKeysBuffer;
+    eastl::unique_ptr<StructuredBuffer> m_pCellsBuffer;
+    RGHandle m_keys;
+    RGHandle m_cells;
 
-};
\ No newline at end of file
+    bool m_bEnable = true;
+    bool m_bReset = true;
+    uint32_t m_nCapacityLog2 = 18;
+    float m_cellSize = 0.1f; //meters, at level 0
+    float m_pixelsPerCell = 8.0f;
+    uint32_t m_nMaxLevel = 12;
+    uint32_t m_nMaxSampleCount = 32; //the cells average about that many frames
+    uint32_t m_nMinSampleCount = 4;
+    uint32_t m_nMaxAge = 60; //frames without any query before a cell is evicted
+};
@@ -29,6 +29,7 @@ void LightingProcessor::OnGui()
     m_pDirectLighting->OnGui();
     m_pReflection->OnGui();
     m_pReSTIRGI->OnGui();
+    m_pRadianceCache->OnGui();
 }
 
 RGHandle LightingProcessor::AddPass(RenderGraph* pRenderGraph, RGHandle depth, RGHandle linear_depth, RGHandle velocity, uint32_t width, uint32_t height)
@@ -44,6 +45,8 @@ RGHandle LightingProcessor::AddPass(RenderGraph* pRenderGraph, RGHandle depth, R
 
     RGHandle half_normal_depth = ExtractHalfDepthNormal(pRenderGraph, depth, normal, width, height);
 
+    m_pRadianceCache->AddPass(pRenderGraph);
+
     RGHandle gtao = m_pGTAO->AddPass(pRenderGraph, depth, normal, width, height);
     RGHandle shadow = m_pRTShdow->AddPass(pRenderGraph, depth, normal, velocity, width, height);
     RGHandle direct_lighting = m_pDirectLighting->AddPass(pRenderGraph, diffuse, specular, normal, customData, depth, shadow, width, height);
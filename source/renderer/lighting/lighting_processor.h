@@ -12,6 +12,7 @@ public:
     RGHandle AddPass(RenderGraph* pRenderGraph, RGHandle depth, RGHandle linear_depth, RGHandle velocity, uint32_t width, uint32_t height);
     
     class ClusteredLightLists* GetClusteredLightLists() const;
+    class HashGridRadianceCache* GetRadianceCache() const { return m_pRadianceCache.get(); }
 
 private:
     RGHandle CompositeLight(RenderGraph* pRenderGraph, RGHandle depth, RGHandle ao, RGHandle direct_lighting, 
@@ -1,6 +1,7 @@
 #include "restir_gi.h"
 #include "gi_denoiser.h"
 #include "gi_denoiser_nrd.h"
+#include "hash_grid_radiance_cache.h"
 #include "../renderer.h"
 #include "utils/gui_util.h"
 #include "utils/fmt.h"
@@ -10,9 +11,6 @@ ReSTIRGI::ReSTIRGI(Renderer* pRenderer)
     m_pRenderer = pRenderer;
 
     GfxComputePipelineDesc desc;
-    desc.cs = pRenderer->GetShader("restir_gi/initial_sampling.hlsl", "main", GfxShaderType::CS);
-    m_pInitialSamplingPSO = pRenderer->GetPipelineState(desc, "ReSTIR GI/initial sampling PSO");
-
     desc.cs = pRenderer->GetShader("restir_gi/temporal_resampling.hlsl", "main", GfxShaderType::CS);
     m_pTemporalResamplingPSO = pRenderer->GetPipelineState(desc, "ReSTIR GI/temporal resampling PSO");
 
@@ -46,6 +44,8 @@ void ReSTIRGI::OnGui()
         {
             m_pDenoiser->InvalidateHistory();
         }
+
+        ImGui::Combo("Radiance Cache##ReSTIR GI", (int*)&m_radianceCacheMode, "None\0Fallback\0Replace\0\0", 3);
     }
 }
 
@@ -61,6 +61,9 @@ RGHandle ReSTIRGI::AddPass(RenderGraph* pRenderGraph, RGHandle halfDepthNormal,
     uint32_t half_width = (width + 1) / 2;
     uint32_t half_height = (height + 1) / 2;
 
+    HashGridRadianceCache* pRadianceCache = m_pRenderer->GetRadianceCache();
+    bool radianceCache = m_radianceCacheMode != RadianceCacheMode::None && pRadianceCache->IsEnabled();
+
     struct RaytracePassData
     {
         RGHandle halfDepthNormal;
@@ -98,6 +101,11 @@ RGHandle ReSTIRGI::AddPass(RenderGraph* pRenderGraph, RGHandle halfDepthNormal,
 
             desc.format = GfxFormat::R32UI;
             data.outputRayDirection = builder.Write(builder.Create<RGTexture>(desc, "ReSTIR GI/candidate ray direction"));
+
+            if (radianceCache)
+            {
+                pRadianceCache->AddQuery(builder);
+            }
         },
         [=](const RaytracePassData& data, IGfxCommandList* pCommandList)
         {
@@ -105,7 +113,7 @@ RGHandle ReSTIRGI::AddPass(RenderGraph* pRenderGraph, RGHandle halfDepthNormal,
                 pRenderGraph->GetTexture(data.halfDepthNormal),
                 pRenderGraph->GetTexture(data.outputRadiance),
                 pRenderGraph->GetTexture(data.outputRayDirection),
-                half_width, half_height);
+                half_width, half_height, radianceCache);
         });
 
     RGHandle radiance = raytrace_pass->outputRadiance;
@@ -343,9 +351,19 @@ IGfxDescriptor* ReSTIRGI::GetOutputIrradianceSRV() const
     }
 }
 
-void ReSTIRGI::InitialSampling(IGfxCommandList* pCommandList, RGTexture* halfDepthNormal, RGTexture* outputRadiance, RGTexture* outputRayDirection, uint32_t width, uint32_t height)
+void ReSTIRGI::InitialSampling(IGfxCommandList* pCommandList, RGTexture* halfDepthNormal, RGTexture* outputRadiance, RGTexture* outputRayDirection, uint32_t width, uint32_t height, bool radianceCache)
 {
-    pCommandList->SetPipelineState(m_pInitialSamplingPSO);
+    eastl::vector<eastl::string> defines;
+    if (radianceCache)
+    {
+        defines.push_back(m_radianceCacheMode == RadianceCacheMode::Replace ? "RADIANCE_CACHE_REPLACE=1" : "RADIANCE_CACHE=1");
+    }
+
+    GfxComputePipelineDesc psoDesc;
+    psoDesc.cs = m_pRenderer->GetShader("restir_gi/initial_sampling.hlsl", "main", GfxShaderType::CS, defines);
+    IGfxPipelineState* pso = m_pRenderer->GetPipelineState(psoDesc, "ReSTIR GI/initial sampling PSO");
+
+    pCommandList->SetPipelineState(pso);
 
     struct CB
     {
@@ -353,6 +371,8 @@ void ReSTIRGI::InitialSampling(IGfxCommandList* pCommandList, RGTexture* halfDep
         uint historyIrradiance;
         uint outputRadianceUAV;
         uint outputRayDirectionUAV;
+
+        HashGridRadianceCacheParams radianceCache;
     };
 
     CB constants;
@@ -373,8 +393,9 @@ void ReSTIRGI::InitialSampling(IGfxCommandList* pCommandList, RGTexture* halfDep
     }
     constants.outputRadianceUAV = outputRadiance->GetUAV()->GetHeapIndex();
     constants.outputRayDirectionUAV = outputRayDirection->GetUAV()->GetHeapIndex();
+    constants.radianceCache = radianceCache ? m_pRenderer->GetRadianceCache()->GetParams() : HashGridRadianceCacheParams();
 
-    pCommandList->SetComputeConstants(0, &constants, sizeof(constants));
+    pCommandList->SetComputeConstants(1, &constants, sizeof(constants));
     pCommandList->Dispatch(DivideRoudingUp(width, 8), DivideRoudingUp(height, 8), 1);
 }
 
@@ -16,7 +16,7 @@ public:
     IGfxDescriptor* GetOutputIrradianceSRV() const;
 
 private:
-    void InitialSampling(IGfxCommandList* pCommandList, RGTexture* halfDepthNormal, RGTexture* outputRadiance, RGTexture* outputRayDirection, uint32_t width, uint32_t height);
+    void InitialSampling(IGfxCommandList* pCommandList, RGTexture* halfDepthNormal, RGTexture* outputRadiance, RGTexture* outputRayDirection, uint32_t width, uint32_t height, bool radianceCache);
     void TemporalResampling(IGfxCommandList* pCommandList, RGTexture* halfDepthNormal, RGTexture* velocity, 
         RGTexture* candidateRadiance, RGTexture* candidateRayDirection, uint32_t width, uint32_t height, bool historyInvalid);
     void SpatialResampling(IGfxCommandList* pCommandList, RGTexture* halfDepthNormal,
@@ -31,7 +31,6 @@ private:
 private:
     Renderer* m_pRenderer;
 
-    IGfxPipelineState* m_pInitialSamplingPSO = nullptr;
     IGfxPipelineState* m_pTemporalResamplingPSO = nullptr;
     IGfxPipelineState* m_pSpatialResamplingPSO = nullptr;
 
@@ -65,4 +64,13 @@ private:
 #else
     DenoiserType m_denoiserType = DenoiserType::Custom;
 #endif
+
+    enum class RadianceCacheMode
+    {
+        None,
+        Fallback, //for the indirect lighting of the hits missing in the history
+        Replace, //for the indirect lighting of all the hits, instead of the reprojected history
+    };
+
+    RadianceCacheMode m_radianceCacheMode = RadianceCacheMode::Fallback;
 };
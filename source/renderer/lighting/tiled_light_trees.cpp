@@ -1,9 +1,530 @@
 #include "tiled_light_trees.h"
+#include "../renderer.h"
+#include "../hierarchical_depth_buffer.h"
+#include "utils/gui_util.h"
+#include "utils/profiler.h"
+#include "utils/parallel_for.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "EASTL/algorithm.h"
+
+// todo : need a cvar system
+static const uint32_t tileSize = 16;
+static const uint32_t binCount = 12;
+static const uint32_t parallelBuildLightCount = 1024; //subtrees with fewer lights are built by a single task
+
+//cbuffer of tiled_light_trees.hlsl
+struct TiledLightTreesCutsCB
+{
+    uint32_t nodesBuffer;
+    uint32_t nodeCount;
+    uint32_t cutsBuffer;
+    uint32_t tileSize;
+
+    uint2 tileCount;
+    uint32_t hzbMip;
+    uint32_t _padding;
+
+    uint2 hzbMipSize;
+};
+
+//cbuffer b1 of direct_lighting.hlsl
+struct LightTreeShadingCB
+{
+    uint32_t nodesBuffer;
+    uint32_t cutsBuffer;
+    uint32_t tileSize;
+    uint32_t tileCountX;
+
+    uint32_t sampleCount;
+    uint32_t hybridLightCount;
+};
+
+float LightTree::GetLightEnergy(const LocalLightData& light)
+{
+    return dot(light.color, float3(0.2126729f, 0.7151522f, 0.0721750f));
+}
+
+static LightTreeNode GetLightNode(const LocalLightData& light)
+{
+    LightTreeNode node = {};
+    node.boundsMin = light.position;
+    node.boundsMax = light.position;
+    node.energy = LightTree::GetLightEnergy(light);
+    node.maxRadius = light.radius;
+    node.minFalloff = light.falloff;
+
+    if ((LocalLightType)light.type == LocalLightType::Spot)
+    {
+        node.axis = -light.direction;
+        node.thetaO = 0.0f;
+        node.thetaE = eastl::min(light.spotAngles.z, PI);
+    }
+    else
+    {
+        //rect lights are bounded like point lights
+        node.axis = float3(0.0f, 0.0f, 1.0f);
+        node.thetaO = PI;
+        node.thetaE = PI * 0.5f;
+    }
+
+    return node;
+}
+
+//the smallest cone around both, from the paper
+static void MergeCones(const LightTreeNode& a, const LightTreeNode& b, LightTreeNode& node)
+{
+    const LightTreeNode& wide = a.thetaO >= b.thetaO ? a : b;
+    const LightTreeNode& narrow = a.thetaO >= b.thetaO ? b : a;
+
+    node.axis = wide.axis;
+    node.thetaO = wide.thetaO;
+    node.thetaE = eastl::max(a.thetaE, b.thetaE);
+
+    if (wide.thetaO >= PI)
+    {
+        return;
+    }
+
+    float cosThetaD = eastl::clamp(dot(wide.axis, narrow.axis), -1.0f, 1.0f);
+    float thetaD = acosf(cosThetaD);
+    if (eastl::min(thetaD + narrow.thetaO, PI) <= wide.thetaO)
+    {
+        return;
+    }
+
+    float thetaO = (wide.thetaO + thetaD + narrow.thetaO) * 0.5f;
+    float3 ortho = narrow.axis - wide.axis * cosThetaD;
+    float orthoLength = length(ortho);
+
+    if (thetaO >= PI || orthoLength < 1.0e-6f)
+    {
+        node.thetaO = PI;
+        return;
+    }
+
+    float thetaR = thetaO - wide.thetaO;
+    node.axis = normalize(wide.axis * cosf(thetaR) + ortho * (sinf(thetaR) / orthoLength));
+    node.thetaO = thetaO;
+}
+
+static LightTreeNode MergeNodes(const LightTreeNode& a, const LightTreeNode& b)
+{
+    LightTreeNode node = {};
+    node.boundsMin = min(a.boundsMin, b.boundsMin);
+    node.boundsMax = max(a.boundsMax, b.boundsMax);
+    node.energy = a.energy + b.energy;
+    node.maxRadius = eastl::max(a.maxRadius, b.maxRadius);
+    node.minFalloff = eastl::min(a.minFalloff, b.minFalloff);
+    MergeCones(a, b, node);
+    return node;
+}
+
+static float OrientationMeasure(float thetaO, float thetaE)
+{
+    //the whole sphere, most nodes with point lights
+    if (thetaO >= PI)
+    {
+        return 4.0f * PI;
+    }
+
+    float thetaW = eastl::min(thetaO + thetaE, PI);
+    return 2.0f * PI * (1.0f - cosf(thetaO)) +
+        0.5f * PI * (2.0f * thetaW * sinf(thetaO) - cosf(thetaO - 2.0f * thetaW) - 2.0f * thetaO * sinf(thetaO) + cosf(thetaO));
+}
+
+//surface area orientation cost, the extents are clamped so that lights on a line or a plane still have an area
+static float NodeCost(const LightTreeNode& node, float minExtent)
+{
+    float3 extent = max(node.boundsMax - node.boundsMin, float3(minExtent));
+    float area = 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    return node.energy * area * OrientationMeasure(node.thetaO, node.thetaE);
+}
+
+static inline uint32_t GetBin(float position, float boundsMin, float scale, uint32_t bin_count)
+{
+    return eastl::min((uint32_t)((position - boundsMin) * scale), bin_count - 1);
+}
+
+void LightTree::SplitTask(const BuildTask& task, BuildTask& left, BuildTask& right)
+{
+    uint32_t* order = m_lightOrder.data() + task.first;
+
+    //the lights are points, their bounds are the centroid bounds
+    float3 boundsMin = m_lightNodes[order[0]].boundsMin;
+    float3 boundsMax = boundsMin;
+    for (uint32_t i = 1; i < task.count; ++i)
+    {
+        boundsMin = min(boundsMin, m_lightNodes[order[i]].boundsMin);
+        boundsMax = max(boundsMax, m_lightNodes[order[i]].boundsMin);
+    }
+
+    float3 extent = boundsMax - boundsMin;
+    float maxExtent = eastl::max(extent.x, eastl::max(extent.y, extent.z));
+    float minExtent = maxExtent / 64.0f;
+
+    struct Bin
+    {
+        LightTreeNode node;
+        uint32_t count;
+
+        void Add(const LightTreeNode& other, uint32_t other_count)
+        {
+            if (other_count > 0)
+            {
+                node = count > 0 ? MergeNodes(node, other) : other;
+                count += other_count;
+            }
+        }
+    };
+
+    //the small nodes have fewer bins, most of the splits are near the leaves
+    const uint32_t splitBinCount = eastl::min(binCount, task.count);
+
+    float3 scale = float3(0.0f);
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        scale[axis] = extent[axis] > 0.0f ? splitBinCount / extent[axis] : 0.0f;
+    }
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    uint32_t bestBin = 0;
+
+    for (int axis = 0; axis < 3 && maxExtent > 0.0f; ++axis)
+    {
+        if (extent[axis] <= 0.0f)
+        {
+            continue;
+        }
+
+        Bin bins[binCount];
+        for (uint32_t i = 0; i < splitBinCount; ++i)
+        {
+            bins[i].count = 0;
+        }
+
+        for (uint32_t i = 0; i < task.count; ++i)
+        {
+            const LightTreeNode& light = m_lightNodes[order[i]];
+            bins[GetBin(light.boundsMin[axis], boundsMin[axis], scale[axis], splitBinCount)].Add(light, 1);
+        }
+
+        Bin rightBins[binCount];
+        rightBins[splitBinCount - 1] = bins[splitBinCount - 1];
+        for (uint32_t i = splitBinCount - 1; i-- > 1;)
+        {
+            rightBins[i] = rightBins[i + 1];
+            rightBins[i].Add(bins[i].node, bins[i].count);
+        }
+
+        //the cost is regularized against thin splits along the short axes
+        Bin leftBin;
+        leftBin.count = 0;
+        for (uint32_t i = 0; i + 1 < splitBinCount; ++i)
+        {
+            leftBin.Add(bins[i].node, bins[i].count);
+            if (leftBin.count == 0 || rightBins[i + 1].count == 0)
+            {
+                continue;
+            }
+
+            float cost = (NodeCost(leftBin.node, minExtent) + NodeCost(rightBins[i + 1].node, minExtent)) * maxExtent / extent[axis];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = i;
+            }
+        }
+    }
+
+    uint32_t leftCount = task.count / 2;
+    if (bestAxis >= 0)
+    {
+        uint32_t* middle = eastl::partition(order, order + task.count,
+            [&](uint32_t light)
+            {
+                return GetBin(m_lightNodes[light].boundsMin[bestAxis], boundsMin[bestAxis], scale[bestAxis], splitBinCount) <= bestBin;
+            });
+        leftCount = (uint32_t)(middle - order);
+    }
+
+    uint32_t child = task.descendants;
+    m_nodes[task.node].child = child;
+    m_nodes[child].parent = task.node;
+    m_nodes[child + 1].parent = task.node;
+
+    left = { child, task.first, leftCount, child + 2, task.depth + 1 };
+    right = { child + 1, task.first + leftCount, task.count - leftCount, child + 2 * leftCount, task.depth + 1 };
+}
+
+uint32_t LightTree::BuildSubtree(const BuildTask& task)
+{
+    uint32_t depth = 0;
+
+    eastl::vector<BuildTask> stack;
+    stack.push_back(task);
+
+    while (!stack.empty())
+    {
+        BuildTask current = stack.back();
+        stack.pop_back();
+
+        if (current.count == 1)
+        {
+            uint32_t light = m_lightOrder[current.first];
+            m_nodes[current.node].child = light | LIGHT_TREE_LEAF_BIT;
+            m_lightLeaves[light] = current.node;
+            depth = eastl::max(depth, current.depth);
+            continue;
+        }
+
+        BuildTask left, right;
+        SplitTask(current, left, right);
+        stack.push_back(right);
+        stack.push_back(left);
+    }
+
+    return depth;
+}
+
+void LightTree::Build(const LocalLightData* lights, uint32_t light_count, bool parallel)
+{
+    m_nodes.resize(light_count > 0 ? 2 * light_count - 1 : 0);
+    m_lightNodes.resize(light_count);
+    m_lightOrder.resize(light_count);
+    m_lightLeaves.resize(light_count);
+    m_nDepth = 0;
+    m_cost = 0.0f;
+
+    if (light_count == 0)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < light_count; ++i)
+    {
+        m_lightNodes[i] = GetLightNode(lights[i]);
+        m_lightOrder[i] = i;
+    }
+
+    m_nodes[0].parent = LIGHT_TREE_INVALID_INDEX;
+
+    //the first levels are split serially, until the subtrees are small enough to be a task each
+    BuildTask root = { 0, 0, light_count, 1, 0 };
+    eastl::vector<BuildTask> tasks;
+    eastl::vector<BuildTask> subtrees;
+    tasks.push_back(root);
+
+    while (!tasks.empty())
+    {
+        BuildTask task = tasks.back();
+        tasks.pop_back();
+
+        if (!parallel || task.count <= parallelBuildLightCount)
+        {
+            subtrees.push_back(task);
+            continue;
+        }
+
+        BuildTask left, right;
+        SplitTask(task, left, right);
+        tasks.push_back(left);
+        tasks.push_back(right);
+    }
+
+    eastl::vector<uint32_t> depths(subtrees.size());
+    if (parallel)
+    {
+        ParallelFor((uint32_t)subtrees.size(), [&](uint32_t i)
+            {
+                depths[i] = BuildSubtree(subtrees[i]);
+            });
+    }
+    else
+    {
+        depths[0] = BuildSubtree(subtrees[0]);
+    }
+
+    for (size_t i = 0; i < depths.size(); ++i)
+    {
+        m_nDepth = eastl::max(m_nDepth, depths[i]);
+    }
+
+    Refit(lights, light_count);
+}
+
+void LightTree::Refit(const LocalLightData* lights, uint32_t light_count)
+{
+    RE_ASSERT(light_count == GetLightCount());
+
+    m_cost = 0.0f;
+
+    //the children come after their parent
+    for (uint32_t i = (uint32_t)m_nodes.size(); i-- > 0;)
+    {
+        LightTreeNode& node = m_nodes[i];
+        uint32_t child = node.child;
+        uint32_t parent = node.parent;
+
+        if (child & LIGHT_TREE_LEAF_BIT)
+        {
+            node = GetLightNode(lights[child & ~LIGHT_TREE_LEAF_BIT]);
+        }
+        else
+        {
+            node = MergeNodes(m_nodes[child], m_nodes[child + 1]);
+            m_cost += NodeCost(node, 0.0f);
+        }
+
+        node.child = child;
+        node.parent = parent;
+    }
+}
 
 TiledLightTrees::TiledLightTrees(Renderer* pRenderer)
 {
+    m_pRenderer = pRenderer;
+
+    GfxComputePipelineDesc desc;
+    desc.cs = pRenderer->GetShader("tiled_light_trees.hlsl", "build_cuts", GfxShaderType::CS);
+    m_pBuildCutsPSO = pRenderer->GetPipelineState(desc, "TiledLightTrees/build cuts PSO");
 }
 
 TiledLightTrees::~TiledLightTrees()
 {
 }
+
+void TiledLightTrees::Update()
+{
+    CPU_EVENT("Render", "TiledLightTrees::Update");
+
+    uint64_t start = stm_now();
+
+    const uint32_t lightCount = m_pRenderer->GetLocalLightCount();
+    const LocalLightData* lights = m_pRenderer->GetLocalLights();
+
+    //the leaves keep their light index, a refit is only possible with the same light count
+    bool rebuild = lightCount != m_tree.GetLightCount() || m_tree.GetNodes().empty();
+    if (!rebuild)
+    {
+        m_tree.Refit(lights, lightCount);
+        rebuild = m_tree.GetCost() > m_buildCost * m_rebuildCostRatio;
+    }
+
+    if (rebuild)
+    {
+        m_tree.Build(lights, lightCount);
+        m_buildCost = m_tree.GetCost();
+    }
+
+    const eastl::vector<LightTreeNode>& nodes = m_tree.GetNodes();
+
+    uint32_t frame_index = m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
+    eastl::unique_ptr<StructuredBuffer>& nodesBuffer = m_pNodesBuffer[frame_index];
+
+    if (nodesBuffer == nullptr || nodesBuffer->GetBuffer()->GetDesc().size < sizeof(LightTreeNode) * nodes.size())
+    {
+        uint32_t capacity = 1024;
+        while (capacity < (uint32_t)nodes.size())
+        {
+            capacity *= 2;
+        }
+
+        nodesBuffer.reset(m_pRenderer->CreateStructuredBuffer(nullptr, sizeof(LightTreeNode), capacity, "TiledLightTrees::m_pNodesBuffer", GfxMemoryType::CpuToGpu));
+    }
+
+    if (!nodes.empty())
+    {
+        memcpy(nodesBuffer->GetBuffer()->GetCpuAddress(), nodes.data(), sizeof(LightTreeNode) * nodes.size());
+    }
+
+    m_stats.lights = lightCount;
+    m_stats.nodes = (uint32_t)nodes.size();
+    m_stats.depth = m_tree.GetDepth();
+    m_stats.rebuilt = rebuild;
+    m_stats.costRatio = m_buildCost > 0.0f ? m_tree.GetCost() / m_buildCost : 1.0f;
+    m_stats.updateTime = (float)stm_ms(stm_since(start));
+}
+
+RGHandle TiledLightTrees::AddCutsPass(RenderGraph* pRenderGraph, uint32_t width, uint32_t height)
+{
+    RENDER_GRAPH_EVENT(pRenderGraph, "TiledLightTrees");
+
+    Update();
+
+    const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
+    const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
+    const uint32_t nodeCount = (uint32_t)m_tree.GetNodes().size();
+    IGfxDescriptor* pNodesSRV = m_pNodesBuffer[m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES]->GetSRV();
+
+    HZB* pHZB = m_pRenderer->GetHZB();
+
+    //the HZB mip where a tile covers at most 2x2 texels
+    float hzbTileExtent = eastl::max((float)tileSize * pHZB->GetHZBWidth() / width, (float)tileSize * pHZB->GetHZBHeight() / height);
+    uint32_t hzbMip = eastl::min((uint32_t)ceilf(log2f(hzbTileExtent)), pHZB->GetHZBMipCount() - 1);
+    uint2 hzbMipSize = uint2(eastl::max(pHZB->GetHZBWidth() >> hzbMip, 1u), eastl::max(pHZB->GetHZBHeight() >> hzbMip, 1u));
+
+    struct BuildCutsData
+    {
+        RGHandle sceneHZB;
+        RGHandle cuts;
+    };
+
+    auto cuts_pass = pRenderGraph->AddPass<BuildCutsData>("Build Light Tree Cuts", RenderPassType::Compute,
+        [&](BuildCutsData& data, RGBuilder& builder)
+        {
+            for (uint32_t i = 0; i < pHZB->GetHZBMipCount(); ++i)
+            {
+                data.sceneHZB = builder.Read(pHZB->GetSceneHZBMip(i), i);
+            }
+
+            RGBuffer::Desc desc;
+            desc.stride = sizeof(LightTreeCut);
+            desc.size = desc.stride * tileCountX * tileCountY;
+            desc.usage = GfxBufferUsageStructuredBuffer;
+            data.cuts = builder.Create<RGBuffer>(desc, "TiledLightTrees cuts");
+            data.cuts = builder.Write(data.cuts);
+        },
+        [=](const BuildCutsData& data, IGfxCommandList* pCommandList)
+        {
+            TiledLightTreesCutsCB cb = {};
+            cb.nodesBuffer = pNodesSRV->GetHeapIndex();
+            cb.nodeCount = nodeCount;
+            cb.cutsBuffer = pRenderGraph->GetBuffer(data.cuts)->GetUAV()->GetHeapIndex();
+            cb.tileSize = tileSize;
+            cb.tileCount = uint2(tileCountX, tileCountY);
+            cb.hzbMip = hzbMip;
+            cb.hzbMipSize = hzbMipSize;
+
+            pCommandList->SetPipelineState(m_pBuildCutsPSO);
+            pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+            pCommandList->Dispatch(DivideRoudingUp(tileCountX, 8), DivideRoudingUp(tileCountY, 8), 1);
+        });
+
+    return cuts_pass->cuts;
+}
+
+void TiledLightTrees::SetShadingConstants(IGfxCommandList* pCommandList, RGBuffer* cuts, uint32_t width) const
+{
+    LightTreeShadingCB cb;
+    cb.nodesBuffer = m_pNodesBuffer[m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES]->GetSRV()->GetHeapIndex();
+    cb.cutsBuffer = cuts->GetSRV()->GetHeapIndex();
+    cb.tileSize = tileSize;
+    cb.tileCountX = DivideRoudingUp(width, tileSize);
+    cb.sampleCount = m_nSampleCount;
+    cb.hybridLightCount = m_nHybridLightCount;
+
+    pCommandList->SetComputeConstants(1, &cb, sizeof(cb));
+}
+
+void TiledLightTrees::OnGui()
+{
+    ImGui::Text("%u lights, %u nodes, depth %u", m_stats.lights, m_stats.nodes, m_stats.depth);
+    ImGui::Text("%s in %.2f ms, cost %.2fx the last build", m_stats.rebuilt ? "Rebuilt" : "Refitted", m_stats.updateTime, m_stats.costRatio);
+
+    ImGui::SliderInt("Samples##TiledLightTrees", (int*)&m_nSampleCount, 1, 16);
+    ImGui::SliderInt("Hybrid Light Count##TiledLightTrees", (int*)&m_nHybridLightCount, 0, 64);
+    ImGui::SliderFloat("Rebuild Cost Ratio##TiledLightTrees", &m_rebuildCostRatio, 1.0f, 4.0f);
+}
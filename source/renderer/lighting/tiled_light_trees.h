@@ -1,12 +1,98 @@
 #pragma once
 
 #include "../render_graph.h"
+#include "gpu_scene.hlsli"
+#include "light_tree.hlsli"
+
+class StructuredBuffer;
 
 // https://anteru.net/files/2017/TiledLightTrees-preprint.pdf
 
+//binary BVH over the local lights, with one light per leaf. the build splits the lights with the binned surface area orientation heuristic,
+//the nodes of a subtree with n lights take 2n - 1 consecutive slots, so that the subtrees below the first levels are built in parallel
+//with the same result as a serial build. a node always comes before its children, the refit updates them in the reverse order
+class LightTree
+{
+public:
+    void Build(const LocalLightData* lights, uint32_t light_count, bool parallel = true);
+
+    //updates the bounds, energy and cones of the nodes for the moved lights, the light count must be the one of the last build
+    void Refit(const LocalLightData* lights, uint32_t light_count);
+
+    //sum of the surface area orientation cost of the interior nodes, it grows as the refits degrade the tree
+    float GetCost() const { return m_cost; }
+
+    uint32_t GetLightCount() const { return (uint32_t)m_lightLeaves.size(); }
+    uint32_t GetDepth() const { return m_nDepth; }
+    const eastl::vector<LightTreeNode>& GetNodes() const { return m_nodes; }
+    const eastl::vector<uint32_t>& GetLightLeaves() const { return m_lightLeaves; } //leaf node of each light
+
+    static float GetLightEnergy(const LocalLightData& light); //luminance of the light color, the energy of its leaf
+
+private:
+    struct BuildTask
+    {
+        uint32_t node;
+        uint32_t first; //range in m_lightOrder
+        uint32_t count;
+        uint32_t descendants; //first slot of the nodes below
+        uint32_t depth;
+    };
+
+    void SplitTask(const BuildTask& task, BuildTask& left, BuildTask& right);
+    uint32_t BuildSubtree(const BuildTask& task); //returns the depth of its deepest leaf
+
+private:
+    eastl::vector<LightTreeNode> m_nodes;
+    eastl::vector<LightTreeNode> m_lightNodes; //a leaf for each light, before the tree is built
+    eastl::vector<uint32_t> m_lightOrder;
+    eastl::vector<uint32_t> m_lightLeaves;
+    uint32_t m_nDepth = 0;
+    float m_cost = 0.0f;
+};
+
+struct TiledLightTreesStats
+{
+    //last frame
+    uint32_t lights = 0;
+    uint32_t nodes = 0;
+    uint32_t depth = 0;
+    bool rebuilt = false;
+    float costRatio = 1.0f; //cost of the tree relative to its last build
+    float updateTime = 0.0f; //ms
+};
+
+//importance sampling of the local lights with a light tree : a pass picks a cut of the tree for each screen tile from its depth bounds,
+//then the lighting pass samples the lights of each pixel from the cut of its tile
 class TiledLightTrees
 {
 public:
     TiledLightTrees(Renderer* pRenderer);
     ~TiledLightTrees();
-};
\ No newline at end of file
+
+    //refits or rebuilds the tree for this frame's local lights and adds the pass building the tile cuts, returns the cuts buffer
+    RGHandle AddCutsPass(RenderGraph* pRenderGraph, uint32_t width, uint32_t height);
+
+    //cbuffer b1 of direct_lighting.hlsl with LIGHT_TREE_SAMPLING
+    void SetShadingConstants(IGfxCommandList* pCommandList, RGBuffer* cuts, uint32_t width) const;
+
+    const TiledLightTreesStats& GetStats() const { return m_stats; }
+    void OnGui();
+
+private:
+    void Update();
+
+private:
+    Renderer* m_pRenderer = nullptr;
+    IGfxPipelineState* m_pBuildCutsPSO = nullptr;
+
+    LightTree m_tree;
+    float m_buildCost = 0.0f;
+    eastl::unique_ptr<StructuredBuffer> m_pNodesBuffer[GFX_MAX_INFLIGHT_FRAMES];
+
+    float m_rebuildCostRatio = 1.5f; //rebuilds once a refitted tree costs that much more than after its build
+    uint32_t m_nSampleCount = 4;
+    uint32_t m_nHybridLightCount = 16; //the hybrid mode samples the tree in the clusters with more lights than this
+
+    TiledLightTreesStats m_stats;
+};
@@ -1,5 +1,7 @@
 #include "marschner_hair_lut.h"
 #include "renderer.h"
+#include "baked_asset_cache.h"
+#include "utils/fmt.h"
 #include "utils/parallel_for.h"
 
 // reference:
@@ -14,6 +16,9 @@ static const uint32_t textureDepth = 32;
 static const float indexOfRefraction = 1.55f;
 static const float absorption = 0.2f;
 
+//bump it when the generators change
+static const uint32_t MARSCHNER_HAIR_LUT_VERSION = 1;
+
 // https://en.wikipedia.org/wiki/Normal_distribution
 float NormalDistribution(float sigma, float x_mu)
 {
@@ -220,15 +225,52 @@ MarschnerHairLUT::MarschnerHairLUT(Renderer* pRenderer)
     m_pRenderer = pRenderer;
 }
 
-void MarschnerHairLUT::Generate()
+void MarschnerHairLUT::Generate(const BakedAssetCache* cache)
 {
+    eastl::string parameters = fmt::format("{}x{}x{} {} {}", textureWidth, textureHeight, textureDepth, indexOfRefraction, absorption).c_str();
+    uint64_t version = BakedAssetCache::MakeVersion(parameters, MARSCHNER_HAIR_LUT_VERSION);
+
+    const size_t sizeM = textureWidth * textureHeight * textureDepth;
+    const size_t sizeN = textureWidth * textureHeight;
+
+    eastl::vector<uint8_t> data;
+    m_bBaked = cache->Load("marschner_hair_lut", version, data) && data.size() == (sizeM + sizeN) * sizeof(ushort4);
+    if (m_bBaked)
+    {
+        m_M.resize(sizeM);
+        m_N.resize(sizeN);
+        memcpy(m_M.data(), data.data(), sizeM * sizeof(ushort4));
+        memcpy(m_N.data(), data.data() + sizeM * sizeof(ushort4), sizeN * sizeof(ushort4));
+        return;
+    }
+
     GenerateM();
     GenerateN();
+
+    data.resize((sizeM + sizeN) * sizeof(ushort4));
+    memcpy(data.data(), m_M.data(), sizeM * sizeof(ushort4));
+    memcpy(data.data() + sizeM * sizeof(ushort4), m_N.data(), sizeN * sizeof(ushort4));
+    cache->Save("marschner_hair_lut", version, data.data(), data.size());
+}
+
+void MarschnerHairLUT::CreateTextures()
+{
+    m_pM.reset(m_pRenderer->CreateTexture3D(textureWidth, textureHeight, textureDepth, 1, GfxFormat::RGBA16F, 0, "MarschnerHairLUT::M"));
+    m_pRenderer->UploadTexture(m_pM->GetTexture(), &m_M[0]);
+
+    m_pN.reset(m_pRenderer->CreateTexture2D(textureWidth, textureHeight, 1, GfxFormat::RGBA16F, 0, "MarschnerHairLUT::N"));
+    m_pRenderer->UploadTexture(m_pN->GetTexture(), &m_N[0]);
+
+    m_M.clear();
+    m_M.shrink_to_fit();
+    m_N.clear();
+    m_N.shrink_to_fit();
 }
 
 void MarschnerHairLUT::GenerateM()
 {
-    eastl::vector<ushort4> M(textureWidth * textureHeight * textureDepth);
+    eastl::vector<ushort4>& M = m_M;
+    M.resize(textureWidth * textureHeight * textureDepth);
 
     for (uint32_t z = 0; z < textureDepth; ++z)
     {
@@ -268,14 +310,12 @@ void MarschnerHairLUT::GenerateM()
                 );
             });
     }
-
-    m_pM.reset(m_pRenderer->CreateTexture3D(textureWidth, textureHeight, textureDepth, 1, GfxFormat::RGBA16F, 0, "MarschnerHairLUT::M"));
-    m_pRenderer->UploadTexture(m_pM->GetTexture(), &M[0]);
 }
 
 void MarschnerHairLUT::GenerateN()
 {
-    eastl::vector<ushort4> N(textureWidth * textureHeight);
+    eastl::vector<ushort4>& N = m_N;
+    N.resize(textureWidth * textureHeight);
 
     ParallelFor(textureWidth * textureHeight, [&](uint32_t index)
         {
@@ -300,7 +340,4 @@ void MarschnerHairLUT::GenerateN()
                 FloatToHalf(value.w)
             );
         });
-
-    m_pN.reset(m_pRenderer->CreateTexture2D(textureWidth, textureHeight, 1, GfxFormat::RGBA16F, 0, "MarschnerHairLUT::N"));
-    m_pRenderer->UploadTexture(m_pN->GetTexture(), &N[0]);
 }
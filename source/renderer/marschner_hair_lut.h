@@ -2,15 +2,21 @@
 
 #include "resource/texture_2d.h"
 #include "resource/texture_3d.h"
+#include "utils/math.h"
 
 class Renderer;
+class BakedAssetCache;
 
 class MarschnerHairLUT
 {
 public:
     MarschnerHairLUT(Renderer* pRenderer);
     
-    void Generate();
+    //reads the baked luts, or generates and bakes them. can run on a task thread
+    void Generate(const BakedAssetCache* cache);
+    void CreateTextures();
+
+    bool IsBaked() const { return m_bBaked; }
 
     Texture3D* GetM() const { return m_pM.get(); }
     Texture2D* GetN() const { return m_pN.get(); }
@@ -24,4 +30,9 @@ private:
 
     eastl::unique_ptr<Texture3D> m_pM;
     eastl::unique_ptr<Texture2D> m_pN;
+
+    //rgba16f, released once uploaded
+    eastl::vector<ushort4> m_M;
+    eastl::vector<ushort4> m_N;
+    bool m_bBaked = false;
 };
\ No newline at end of file
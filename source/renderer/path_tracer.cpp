@@ -2,6 +2,7 @@
 #include "renderer.h"
 #include "oidn.h"
 #include "base_pass.h"
+#include "lighting/hash_grid_radiance_cache.h"
 #include "core/engine.h"
 #include "utils/gui_util.h"
 
@@ -16,6 +17,9 @@ PathTracer::PathTracer(Renderer* pRenderer)
     psoDesc.cs = pRenderer->GetShader("path_tracer.hlsl", "path_tracing", GfxShaderType::CS);
     m_pPathTracingPSO = pRenderer->GetPipelineState(psoDesc, "PathTracing PSO");
 
+    psoDesc.cs = pRenderer->GetShader("path_tracer.hlsl", "path_tracing", GfxShaderType::CS, { "RADIANCE_CACHE=1" });
+    m_pPathTracingRadianceCachePSO = pRenderer->GetPipelineState(psoDesc, "PathTracing radiance cache PSO");
+
     psoDesc.cs = pRenderer->GetShader("path_tracer.hlsl", "accumulation", GfxShaderType::CS);
     m_pAccumulationPSO = pRenderer->GetPipelineState(psoDesc, "PathTracing accumulation PSO");
 }
@@ -32,6 +36,8 @@ void PathTracer::OnGui()
 #endif
         m_bHistoryInvalid |= ImGui::SliderInt("Max Ray Length##PathTracer", (int*)&m_maxRayLength, 1, 16);
         m_bHistoryInvalid |= ImGui::SliderInt("Max Samples##PathTracer", (int*)&m_spp, 1, 8192);
+        m_bHistoryInvalid |= ImGui::Checkbox("Enable Radiance Cache##PathTracer", &m_bEnableRadianceCache);
+        m_bHistoryInvalid |= ImGui::SliderInt("Radiance Cache Bounce##PathTracer", (int*)&m_radianceCacheBounce, 0, 16);
     }
 }
 
@@ -64,6 +70,13 @@ RGHandle PathTracer::AddPass(RenderGraph* pRenderGraph, RGHandle depth, uint32_t
 
     if (m_currentSampleIndex < m_spp)
     {
+        HashGridRadianceCache* pRadianceCache = m_pRenderer->GetRadianceCache();
+        bool radianceCache = m_bEnableRadianceCache && pRadianceCache->IsEnabled();
+        if (radianceCache)
+        {
+            pRadianceCache->AddPass(pRenderGraph);
+        }
+
         struct PathTracingData
         {
             RGHandle diffuseRT;
@@ -91,6 +104,11 @@ RGHandle PathTracer::AddPass(RenderGraph* pRenderGraph, RGHandle depth, uint32_t
                 desc.format = GfxFormat::RGBA16F;
                 data.output = builder.Create<RGTexture>(desc, "PathTracing output");
                 data.output = builder.Write(data.output);
+
+                if (radianceCache)
+                {
+                    pRadianceCache->AddQuery(builder);
+                }
             },
             [=](const PathTracingData& data, IGfxCommandList* pCommandList)
             {
@@ -101,7 +119,7 @@ RGHandle PathTracer::AddPass(RenderGraph* pRenderGraph, RGHandle depth, uint32_t
                 pRenderGraph->GetTexture(data.emissiveRT),
                 pRenderGraph->GetTexture(data.depthRT),
                 pRenderGraph->GetTexture(data.output),
-                width, height);
+                width, height, radianceCache);
             });
 
         tracingOutput = pt_pass->output;
@@ -196,22 +214,46 @@ RGHandle PathTracer::AddPass(RenderGraph* pRenderGraph, RGHandle depth, uint32_t
 }
 
 void PathTracer::PathTrace(IGfxCommandList* pCommandList, RGTexture* diffuse, RGTexture* specular, RGTexture* normal, RGTexture* emissive, RGTexture* depth,
-    RGTexture* output, uint32_t width, uint32_t height)
+    RGTexture* output, uint32_t width, uint32_t height, bool radianceCache)
 {
-    pCommandList->SetPipelineState(m_pPathTracingPSO);
-
-    uint32_t constants[9] = {
-        diffuse->GetSRV()->GetHeapIndex(),
-        specular->GetSRV()->GetHeapIndex(),
-        normal->GetSRV()->GetHeapIndex(),
-        emissive->GetSRV()->GetHeapIndex(),
-        depth->GetSRV()->GetHeapIndex(),
-        m_maxRayLength,
-        m_currentSampleIndex,
-        m_spp,
-        output->GetUAV()->GetHeapIndex()
+    pCommandList->SetPipelineState(radianceCache ? m_pPathTracingRadianceCachePSO : m_pPathTracingPSO);
+
+    struct CB
+    {
+        uint diffuseRT;
+        uint specularRT;
+        uint normalRT;
+        uint emissiveRT;
+
+        uint depthRT;
+        uint maxRayLength;
+        uint currentSampleIndex;
+        uint sampleNum;
+
+        uint outputTexture;
+        uint radianceCacheBounce;
+        uint padding[2];
+
+        HashGridRadianceCacheParams radianceCache;
     };
-    pCommandList->SetComputeConstants(1, constants, sizeof(constants));
+
+    CB constants = {};
+    constants.diffuseRT = diffuse->GetSRV()->GetHeapIndex();
+    constants.specularRT = specular->GetSRV()->GetHeapIndex();
+    constants.normalRT = normal->GetSRV()->GetHeapIndex();
+    constants.emissiveRT = emissive->GetSRV()->GetHeapIndex();
+    constants.depthRT = depth->GetSRV()->GetHeapIndex();
+    constants.maxRayLength = m_maxRayLength;
+    constants.currentSampleIndex = m_currentSampleIndex;
+    constants.sampleNum = m_spp;
+    constants.outputTexture = output->GetUAV()->GetHeapIndex();
+    constants.radianceCacheBounce = m_radianceCacheBounce;
+    if (radianceCache)
+    {
+        constants.radianceCache = m_pRenderer->GetRadianceCache()->GetParams();
+    }
+
+    pCommandList->SetComputeConstants(1, &constants, sizeof(constants));
     pCommandList->Dispatch(DivideRoudingUp(width, 8), DivideRoudingUp(height, 8), 1);
 }
 
@@ -14,7 +14,7 @@ public:
 
 private:
     void PathTrace(IGfxCommandList* pCommandList, RGTexture* diffuse, RGTexture* specular, RGTexture* normal, RGTexture* emissive, RGTexture* depth, 
-        RGTexture* output, uint32_t width, uint32_t height);
+        RGTexture* output, uint32_t width, uint32_t height, bool radianceCache);
     void Accumulate(IGfxCommandList* pCommandList, 
         RGTexture* inputColor, RGTexture* outputColor, 
         RGTexture* inputAlbedo, RGTexture* outputAlbedo,
@@ -30,6 +30,7 @@ private:
 #endif
 
     IGfxPipelineState* m_pPathTracingPSO = nullptr;
+    IGfxPipelineState* m_pPathTracingRadianceCachePSO = nullptr;
     IGfxPipelineState* m_pAccumulationPSO = nullptr;
 
     eastl::unique_ptr<Texture2D> m_pHistoryColor;
@@ -42,4 +43,6 @@ private:
     bool m_bEnableAccumulation = true;
     bool m_bHistoryInvalid = true;
     bool m_bEnableOIDN = true;
+    bool m_bEnableRadianceCache = false; //biased, the paths end in the cache after m_radianceCacheBounce bounces
+    uint m_radianceCacheBounce = 1;
 };
\ No newline at end of file
@@ -62,6 +62,8 @@ PipelineStateCache::PipelineStateCache(Renderer* pRenderer)
 
 IGfxPipelineState* PipelineStateCache::GetPipelineState(const GfxGraphicsPipelineDesc& desc, const eastl::string& name)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     auto iter = m_cachedGraphicsPSO.find(desc);
     if (iter != m_cachedGraphicsPSO.end())
     {
@@ -79,6 +81,8 @@ IGfxPipelineState* PipelineStateCache::GetPipelineState(const GfxGraphicsPipelin
 
 IGfxPipelineState* PipelineStateCache::GetPipelineState(const GfxMeshShadingPipelineDesc& desc, const eastl::string& name)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     auto iter = m_cachedMeshShadingPSO.find(desc);
     if (iter != m_cachedMeshShadingPSO.end())
     {
@@ -96,6 +100,8 @@ IGfxPipelineState* PipelineStateCache::GetPipelineState(const GfxMeshShadingPipe
 
 IGfxPipelineState* PipelineStateCache::GetPipelineState(const GfxComputePipelineDesc& desc, const eastl::string& name)
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     auto iter = m_cachedComputePSO.find(desc);
     if (iter != m_cachedComputePSO.end())
     {
@@ -4,6 +4,7 @@
 #include "xxHash/xxhash.h"
 #include "EASTL/hash_map.h"
 #include "EASTL/unique_ptr.h"
+#include <mutex>
 
 //cityhash Hash128to64
 inline uint64_t hash_combine_64(uint64_t hash0, uint64_t hash1)
@@ -81,6 +82,8 @@ public:
 
 private:
     Renderer* m_pRenderer;
+    std::mutex m_mutex; //materials may create their PSOs from the worker threads
+
     eastl::hash_map<GfxGraphicsPipelineDesc, eastl::unique_ptr<IGfxPipelineState>> m_cachedGraphicsPSO;
     eastl::hash_map<GfxMeshShadingPipelineDesc, eastl::unique_ptr<IGfxPipelineState>> m_cachedMeshShadingPSO;
     eastl::hash_map<GfxComputePipelineDesc, eastl::unique_ptr<IGfxPipelineState>> m_cachedComputePSO;
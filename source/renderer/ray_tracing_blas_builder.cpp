@@ -0,0 +1,382 @@
+#include "ray_tracing_blas_builder.h"
+#include "renderer.h"
+#include "utils/gui_util.h"
+#include "utils/log.h"
+#include "utils/math.h"
+#include "utils/profiler.h"
+#include "fmt/format.h"
+
+#define MAX_BLAS_BUILDS_PER_FRAME (1024)
+
+RayTracingBLASBuilder::RayTracingBLASBuilder(Renderer* pRenderer)
+{
+    m_pRenderer = pRenderer;
+
+    IGfxDevice* pDevice = pRenderer->GetDevice();
+
+    GfxBufferDesc desc;
+    desc.size = sizeof(uint64_t) * MAX_BLAS_BUILDS_PER_FRAME;
+    desc.usage = GfxBufferUsageRawBuffer | GfxBufferUsageUnorderedAccess;
+    m_pSizeBuffer.reset(pDevice->CreateBuffer(desc, "RayTracingBLASBuilder::m_pSizeBuffer"));
+
+    for (uint32_t i = 0; i < GFX_MAX_INFLIGHT_FRAMES; ++i)
+    {
+        GfxBufferDesc readbackDesc;
+        readbackDesc.size = desc.size;
+        readbackDesc.memory_type = GfxMemoryType::GpuToCpu;
+        m_pSizeReadbackBuffer[i].reset(pDevice->CreateBuffer(readbackDesc, "RayTracingBLASBuilder::m_pSizeReadbackBuffer"));
+    }
+}
+
+RayTracingBLASBuilder::~RayTracingBLASBuilder()
+{
+    if (m_nTotalBuilds > 0)
+    {
+        RayTracingBLASStats stats = GetStats();
+
+        RE_INFO("[RayTracingBLASBuilder] {} builds, {} compactions : {} blases ({} compacted) in {:.1f} MB, {:.1f} MB uncompacted, {:.1f} MB of pools",
+            m_nTotalBuilds, m_nTotalCompactions, stats.blas_count, stats.compacted_count,
+            stats.storage_bytes / (1024.0 * 1024.0), stats.uncompacted_bytes / (1024.0 * 1024.0), stats.pool_bytes / (1024.0 * 1024.0));
+    }
+
+    //the blases should be destroyed before the pools they are placed in
+    m_pendingDeletions.clear();
+    m_blases.clear();
+    m_pools.clear();
+}
+
+RayTracingBLAS* RayTracingBLASBuilder::CreateBLAS(const GfxRayTracingBLASDesc& desc, const eastl::string& name)
+{
+    IGfxDevice* pDevice = m_pRenderer->GetDevice();
+
+    eastl::unique_ptr<RayTracingBLAS> blas = eastl::make_unique<RayTracingBLAS>();
+    blas->m_sizes = pDevice->GetRayTracingBLASSizes(desc);
+    blas->m_nStorageSize = RoundUpPow2(blas->m_sizes.as_size, GFX_RT_AS_ALIGNMENT);
+
+    if (!AllocateStorage(blas->m_nStorageSize, blas->m_nPool, blas->m_allocation))
+    {
+        RE_ERROR("[RayTracingBLASBuilder] failed to allocate {} bytes for {}", blas->m_nStorageSize, name);
+        return nullptr;
+    }
+
+    GfxRayTracingBLASDesc placedDesc = desc;
+    placedDesc.storage_buffer = m_pools[blas->m_nPool].buffer.get();
+    placedDesc.storage_offset = blas->m_allocation.offset * GFX_RT_AS_ALIGNMENT;
+    placedDesc.storage_size = 0;
+
+    blas->m_pBLAS.reset(pDevice->CreateRayTracingBLAS(placedDesc, name));
+    if (blas->m_pBLAS == nullptr)
+    {
+        m_pools[blas->m_nPool].allocator->free(blas->m_allocation);
+        return nullptr;
+    }
+
+    blas->m_nIndex = (uint32_t)m_blases.size();
+    m_pendingBuilds.push_back(blas.get());
+    m_blases.push_back(eastl::move(blas));
+
+    return m_blases.back().get();
+}
+
+void RayTracingBLASBuilder::ReleaseBLAS(RayTracingBLAS* blas)
+{
+    if (blas == nullptr)
+    {
+        return;
+    }
+
+    auto iter = eastl::find(m_pendingBuilds.begin(), m_pendingBuilds.end(), blas);
+    if (iter != m_pendingBuilds.end())
+    {
+        m_pendingBuilds.erase(iter);
+    }
+
+    for (uint32_t i = 0; i < GFX_MAX_INFLIGHT_FRAMES; ++i)
+    {
+        eastl::replace(m_sizeQueries[i].begin(), m_sizeQueries[i].end(), blas, (RayTracingBLAS*)nullptr);
+    }
+
+    FreeStorage(eastl::move(blas->m_pBLAS), blas->m_nPool, blas->m_allocation);
+
+    uint32_t index = blas->m_nIndex;
+    RE_ASSERT(m_blases[index].get() == blas);
+
+    m_blases[index] = eastl::move(m_blases.back());
+    m_blases[index]->m_nIndex = index;
+    m_blases.pop_back();
+}
+
+void RayTracingBLASBuilder::Build(IGfxCommandList* pCommandList)
+{
+    FlushPendingDeletions();
+
+    CompactBLASes(pCommandList);
+    BuildBLASes(pCommandList);
+}
+
+RayTracingBLASStats RayTracingBLASBuilder::GetStats() const
+{
+    RayTracingBLASStats stats;
+    stats.blas_count = (uint32_t)m_blases.size();
+
+    for (size_t i = 0; i < m_blases.size(); ++i)
+    {
+        const RayTracingBLAS* blas = m_blases[i].get();
+        if (blas->m_state == RayTracingBLAS::State::Compacted)
+        {
+            stats.compacted_count++;
+        }
+        stats.storage_bytes += blas->m_nStorageSize;
+        stats.uncompacted_bytes += RoundUpPow2(blas->m_sizes.as_size, GFX_RT_AS_ALIGNMENT);
+    }
+
+    for (size_t i = 0; i < m_pools.size(); ++i)
+    {
+        stats.pool_bytes += m_pools[i].buffer->GetDesc().size;
+    }
+
+    stats.scratch_bytes = m_pScratchBuffer ? m_pScratchBuffer->GetDesc().size : 0;
+    stats.builds = m_nBuilds;
+    stats.deferred_builds = m_nDeferredBuilds;
+    stats.compactions = m_nCompactions;
+    return stats;
+}
+
+void RayTracingBLASBuilder::OnGui()
+{
+    if (ImGui::CollapsingHeader("Ray Tracing BLAS"))
+    {
+        RayTracingBLASStats stats = GetStats();
+
+        ImGui::Text("BLAS : %u, %u compacted", stats.blas_count, stats.compacted_count);
+        ImGui::Text("Storage : %.1f MB (%.1f MB uncompacted) in %.1f MB of pools", stats.storage_bytes / (1024.0f * 1024.0f),
+            stats.uncompacted_bytes / (1024.0f * 1024.0f), stats.pool_bytes / (1024.0f * 1024.0f));
+        ImGui::Text("Scratch : %.1f MB", stats.scratch_bytes / (1024.0f * 1024.0f));
+        ImGui::Text("Last frame : %u builds, %u deferred, %u compactions", stats.builds, stats.deferred_builds, stats.compactions);
+        ImGui::SliderInt("Max Builds##RayTracingBLASBuilder", (int*)&m_nMaxBuildsPerFrame, 16, MAX_BLAS_BUILDS_PER_FRAME);
+    }
+}
+
+bool RayTracingBLASBuilder::AllocateStorage(uint32_t size, uint32_t& pool, OffsetAllocator::Allocation& allocation)
+{
+    uint32_t units = size / GFX_RT_AS_ALIGNMENT;
+
+    for (uint32_t i = 0; i < (uint32_t)m_pools.size(); ++i)
+    {
+        allocation = m_pools[i].allocator->allocate(units);
+        if (allocation.offset != OffsetAllocator::Allocation::NO_SPACE)
+        {
+            pool = i;
+            return true;
+        }
+    }
+
+    //a blas larger than the pool size gets a dedicated pool
+    GfxBufferDesc desc;
+    desc.size = eastl::max(m_nPoolSize, size);
+    desc.usage = GfxBufferUsageAccelerationStructure;
+
+    eastl::string name = fmt::format("RayTracingBLASBuilder::m_pools[{}]", m_pools.size()).c_str();
+    IGfxBuffer* buffer = m_pRenderer->GetDevice()->CreateBuffer(desc, name);
+    if (buffer == nullptr)
+    {
+        return false;
+    }
+
+    Pool newPool;
+    newPool.buffer.reset(buffer);
+    newPool.allocator = eastl::make_unique<OffsetAllocator::Allocator>(desc.size / GFX_RT_AS_ALIGNMENT);
+
+    allocation = newPool.allocator->allocate(units);
+    pool = (uint32_t)m_pools.size();
+    m_pools.push_back(eastl::move(newPool));
+
+    return allocation.offset != OffsetAllocator::Allocation::NO_SPACE;
+}
+
+void RayTracingBLASBuilder::FreeStorage(eastl::unique_ptr<IGfxRayTracingBLAS> blas, uint32_t pool, OffsetAllocator::Allocation allocation)
+{
+    //may still be traced by the frames in flight
+    PendingDeletion deletion;
+    deletion.blas = eastl::move(blas);
+    deletion.pool = pool;
+    deletion.allocation = allocation;
+    deletion.frame = m_pRenderer->GetFrameID();
+    m_pendingDeletions.push_back(eastl::move(deletion));
+}
+
+void RayTracingBLASBuilder::FlushPendingDeletions()
+{
+    uint64_t frame_id = m_pRenderer->GetFrameID();
+
+    for (size_t i = 0; i < m_pendingDeletions.size();)
+    {
+        if (m_pendingDeletions[i].frame + GFX_MAX_INFLIGHT_FRAMES <= frame_id)
+        {
+            m_pendingDeletions[i].blas.reset();
+            m_pools[m_pendingDeletions[i].pool].allocator->free(m_pendingDeletions[i].allocation);
+
+            m_pendingDeletions.erase_unsorted(m_pendingDeletions.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void RayTracingBLASBuilder::CompactBLASes(IGfxCommandList* pCommandList)
+{
+    m_nCompactions = 0;
+
+    uint32_t frame_index = m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
+    eastl::vector<RayTracingBLAS*>& queries = m_sizeQueries[frame_index];
+    if (queries.empty())
+    {
+        return;
+    }
+
+    GPU_EVENT(pCommandList, "CompactBLAS");
+
+    IGfxDevice* pDevice = m_pRenderer->GetDevice();
+    const uint64_t* compacted_sizes = (const uint64_t*)m_pSizeReadbackBuffer[frame_index]->GetCpuAddress();
+
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        RayTracingBLAS* blas = queries[i];
+        if (blas == nullptr)
+        {
+            continue; //released
+        }
+
+        uint32_t compacted_size = RoundUpPow2((uint32_t)compacted_sizes[i], GFX_RT_AS_ALIGNMENT);
+        if (compacted_size == 0 || compacted_size >= blas->m_nStorageSize)
+        {
+            continue;
+        }
+
+        uint32_t pool;
+        OffsetAllocator::Allocation allocation;
+        if (!AllocateStorage(compacted_size, pool, allocation))
+        {
+            continue;
+        }
+
+        GfxRayTracingBLASDesc desc = blas->m_pBLAS->GetDesc();
+        desc.storage_buffer = m_pools[pool].buffer.get();
+        desc.storage_offset = allocation.offset * GFX_RT_AS_ALIGNMENT;
+        desc.storage_size = compacted_size;
+
+        IGfxRayTracingBLAS* compacted = pDevice->CreateRayTracingBLAS(desc, blas->m_pBLAS->GetName());
+        if (compacted == nullptr)
+        {
+            m_pools[pool].allocator->free(allocation);
+            continue;
+        }
+
+        pCommandList->CompactRayTracingBLAS(compacted, blas->m_pBLAS.get());
+
+        FreeStorage(eastl::move(blas->m_pBLAS), blas->m_nPool, blas->m_allocation);
+
+        blas->m_pBLAS.reset(compacted);
+        blas->m_nPool = pool;
+        blas->m_allocation = allocation;
+        blas->m_nStorageSize = compacted_size;
+        blas->m_state = RayTracingBLAS::State::Compacted;
+
+        m_nCompactions++;
+    }
+
+    queries.clear();
+    m_nTotalCompactions += m_nCompactions;
+
+    if (m_nCompactions > 0)
+    {
+        pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskAS);
+    }
+}
+
+void RayTracingBLASBuilder::BuildBLASes(IGfxCommandList* pCommandList)
+{
+    m_nBuilds = 0;
+    m_nDeferredBuilds = 0;
+
+    if (m_pendingBuilds.empty())
+    {
+        return;
+    }
+
+    GPU_EVENT(pCommandList, "BuildBLAS");
+
+    //the builds of a batch use disjoint ranges of the scratch buffer, so they can overlap on the gpu
+    uint32_t max_builds = eastl::min(m_nMaxBuildsPerFrame, (uint32_t)MAX_BLAS_BUILDS_PER_FRAME);
+    uint32_t scratch_size = 0;
+    uint32_t build_count = 0;
+
+    for (; build_count < (uint32_t)m_pendingBuilds.size() && build_count < max_builds; ++build_count)
+    {
+        uint32_t size = RoundUpPow2(m_pendingBuilds[build_count]->m_sizes.build_scratch_size, GFX_RT_AS_ALIGNMENT);
+        if (build_count > 0 && scratch_size + size > m_nScratchBudget)
+        {
+            break;
+        }
+        scratch_size += size;
+    }
+
+    IGfxBuffer* scratch_buffer = GetScratchBuffer(scratch_size);
+
+    uint32_t frame_index = m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
+    eastl::vector<RayTracingBLAS*>& queries = m_sizeQueries[frame_index];
+
+    uint32_t scratch_offset = 0;
+    for (uint32_t i = 0; i < build_count; ++i)
+    {
+        RayTracingBLAS* blas = m_pendingBuilds[i];
+        pCommandList->BuildRayTracingBLAS(blas->GetBLAS(), scratch_buffer, scratch_offset);
+        scratch_offset += RoundUpPow2(blas->m_sizes.build_scratch_size, GFX_RT_AS_ALIGNMENT);
+
+        blas->m_state = RayTracingBLAS::State::Built;
+
+        if (blas->GetBLAS()->GetDesc().flags & GfxRayTracingASFlagAllowCompaction)
+        {
+            queries.push_back(blas);
+        }
+    }
+
+    m_pendingBuilds.erase(m_pendingBuilds.begin(), m_pendingBuilds.begin() + build_count);
+
+    m_nBuilds = build_count;
+    m_nDeferredBuilds = (uint32_t)m_pendingBuilds.size();
+    m_nTotalBuilds += build_count;
+
+    pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskAS);
+
+    if (!queries.empty())
+    {
+        IGfxBuffer* size_buffer = m_pSizeBuffer.get();
+
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            pCommandList->WriteRayTracingBLASCompactedSize(queries[i]->GetBLAS(), size_buffer, sizeof(uint64_t) * (uint32_t)i);
+        }
+
+        pCommandList->BufferBarrier(size_buffer, GfxAccessComputeUAV, GfxAccessCopySrc);
+        pCommandList->CopyBuffer(m_pSizeReadbackBuffer[frame_index].get(), 0, size_buffer, 0, sizeof(uint64_t) * (uint32_t)queries.size());
+        pCommandList->BufferBarrier(size_buffer, GfxAccessCopySrc, GfxAccessComputeUAV);
+    }
+}
+
+IGfxBuffer* RayTracingBLASBuilder::GetScratchBuffer(uint32_t size)
+{
+    if (m_pScratchBuffer == nullptr || m_pScratchBuffer->GetDesc().size < size)
+    {
+        GfxBufferDesc desc;
+        desc.size = eastl::max(m_nScratchBudget, size);
+        desc.usage = GfxBufferUsageRawBuffer | GfxBufferUsageUnorderedAccess;
+
+        //the previous one is released with the deferred deletion of the device
+        m_pScratchBuffer.reset(m_pRenderer->GetDevice()->CreateBuffer(desc, "RayTracingBLASBuilder::m_pScratchBuffer"));
+    }
+
+    return m_pScratchBuffer.get();
+}
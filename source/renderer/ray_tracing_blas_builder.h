@@ -0,0 +1,122 @@
+#pragma once
+
+#include "gpu_scene.h"
+
+class Renderer;
+
+//a blas placed in the storage pool of RayTracingBLASBuilder.
+//its IGfxRayTracingBLAS is replaced when it gets compacted, so GetBLAS should be called every frame instead of being cached
+class RayTracingBLAS
+{
+public:
+    IGfxRayTracingBLAS* GetBLAS() const { return m_pBLAS.get(); }
+    bool IsBuilt() const { return m_state != State::Pending; }
+    bool IsCompacted() const { return m_state == State::Compacted; }
+    const GfxRayTracingBLASSizes& GetSizes() const { return m_sizes; }
+
+private:
+    friend class RayTracingBLASBuilder;
+
+    enum class State
+    {
+        Pending,
+        Built,
+        Compacted,
+    };
+
+    eastl::unique_ptr<IGfxRayTracingBLAS> m_pBLAS;
+    State m_state = State::Pending;
+    GfxRayTracingBLASSizes m_sizes = {};
+
+    uint32_t m_nPool = 0;
+    OffsetAllocator::Allocation m_allocation;
+    uint32_t m_nStorageSize = 0;
+
+    uint32_t m_nIndex = 0; //in RayTracingBLASBuilder::m_blases
+};
+
+struct RayTracingBLASStats
+{
+    uint32_t blas_count = 0;
+    uint32_t compacted_count = 0;
+    uint64_t storage_bytes = 0;     //placed in the pools
+    uint64_t uncompacted_bytes = 0; //if nothing was compacted
+    uint64_t pool_bytes = 0;
+    uint32_t scratch_bytes = 0;
+
+    //last frame
+    uint32_t builds = 0;
+    uint32_t deferred_builds = 0;
+    uint32_t compactions = 0;
+};
+
+//places blases in large shared buffers instead of one allocation each, and builds them in batches sharing one scratch buffer.
+//the builds of a frame are capped by the scratch budget, the rest waits for the next frame (a blas larger than the budget grows it).
+//blases created with GfxRayTracingASFlagAllowCompaction have their compacted size read back GFX_MAX_INFLIGHT_FRAMES later,
+//then are copied into a smaller allocation. freed storage is reused after GFX_MAX_INFLIGHT_FRAMES.
+class RayTracingBLASBuilder
+{
+public:
+    RayTracingBLASBuilder(Renderer* pRenderer);
+    ~RayTracingBLASBuilder();
+
+    //the storage of the desc is ignored, the blas is built by the next calls to Build
+    RayTracingBLAS* CreateBLAS(const GfxRayTracingBLASDesc& desc, const eastl::string& name);
+    void ReleaseBLAS(RayTracingBLAS* blas);
+
+    //compacts the blases whose size was read back, then builds the pending ones
+    void Build(IGfxCommandList* pCommandList);
+
+    RayTracingBLASStats GetStats() const;
+    void OnGui();
+
+    //shared with the other as builds recorded after Build, which is finished with a barrier
+    IGfxBuffer* GetScratchBuffer(uint32_t size);
+
+private:
+    struct Pool
+    {
+        eastl::unique_ptr<IGfxBuffer> buffer;
+        eastl::unique_ptr<OffsetAllocator::Allocator> allocator; //in GFX_RT_AS_ALIGNMENT units
+    };
+
+    struct PendingDeletion
+    {
+        eastl::unique_ptr<IGfxRayTracingBLAS> blas;
+        uint32_t pool;
+        OffsetAllocator::Allocation allocation;
+        uint64_t frame;
+    };
+
+    bool AllocateStorage(uint32_t size, uint32_t& pool, OffsetAllocator::Allocation& allocation);
+    void FreeStorage(eastl::unique_ptr<IGfxRayTracingBLAS> blas, uint32_t pool, OffsetAllocator::Allocation allocation);
+    void FlushPendingDeletions();
+
+    void CompactBLASes(IGfxCommandList* pCommandList);
+    void BuildBLASes(IGfxCommandList* pCommandList);
+
+private:
+    Renderer* m_pRenderer = nullptr;
+
+    eastl::vector<eastl::unique_ptr<RayTracingBLAS>> m_blases;
+    eastl::vector<RayTracingBLAS*> m_pendingBuilds;
+    eastl::vector<PendingDeletion> m_pendingDeletions;
+
+    eastl::vector<Pool> m_pools;
+    uint32_t m_nPoolSize = 64 * 1024 * 1024;
+
+    eastl::unique_ptr<IGfxBuffer> m_pScratchBuffer;
+    uint32_t m_nScratchBudget = 32 * 1024 * 1024;
+    uint32_t m_nMaxBuildsPerFrame = 256;
+
+    //compacted sizes are written to m_pSizeBuffer, then copied to the readback buffer of the frame
+    eastl::unique_ptr<IGfxBuffer> m_pSizeBuffer;
+    eastl::unique_ptr<IGfxBuffer> m_pSizeReadbackBuffer[GFX_MAX_INFLIGHT_FRAMES];
+    eastl::vector<RayTracingBLAS*> m_sizeQueries[GFX_MAX_INFLIGHT_FRAMES];
+
+    uint32_t m_nBuilds = 0;
+    uint32_t m_nDeferredBuilds = 0;
+    uint32_t m_nCompactions = 0;
+    uint32_t m_nTotalBuilds = 0;
+    uint32_t m_nTotalCompactions = 0;
+};
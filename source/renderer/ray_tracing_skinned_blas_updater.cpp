@@ -0,0 +1,182 @@
+#include "ray_tracing_skinned_blas_updater.h"
+#include "ray_tracing_blas_builder.h"
+#include "renderer.h"
+#include "core/engine.h"
+#include "utils/gui_util.h"
+#include "utils/log.h"
+
+RayTracingSkinnedBLASUpdater::RayTracingSkinnedBLASUpdater(Renderer* pRenderer)
+{
+    m_pRenderer = pRenderer;
+}
+
+RayTracingSkinnedBLASUpdater::~RayTracingSkinnedBLASUpdater()
+{
+    if (m_stats.total_refits + m_stats.total_rebuilds > 0)
+    {
+        RE_INFO("[RayTracingSkinnedBLASUpdater] {} refits, {} rebuilds", m_stats.total_refits, m_stats.total_rebuilds);
+    }
+}
+
+void RayTracingSkinnedBLASUpdater::Update(RayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, const float3& center, float radius, bool animated)
+{
+    m_requests.push_back({ blas, vertex_buffer, vertex_buffer_offset, center, radius, animated });
+}
+
+void RayTracingSkinnedBLASUpdater::Remove(RayTracingBLAS* blas)
+{
+    m_states.erase(blas);
+
+    for (size_t i = 0; i < m_requests.size(); ++i)
+    {
+        if (m_requests[i].blas == blas)
+        {
+            m_requests.erase(m_requests.begin() + i);
+            break;
+        }
+    }
+}
+
+uint32_t RayTracingSkinnedBLASUpdater::GetUpdateInterval(const float3& center, float radius) const
+{
+    Camera* camera = Engine::GetInstance()->GetWorld()->GetCamera();
+    if (!::FrustumCull(camera->GetFrustumPlanes(), 6, center, radius))
+    {
+        return m_nHiddenInterval; //still seen by shadows and reflections
+    }
+
+    float distance = length(center - camera->GetPosition());
+    if (distance <= radius)
+    {
+        return 1;
+    }
+
+    //the interval doubles each time the screen size halves
+    float screen_size = radius / (distance * tanf(radians(camera->GetFov()) * 0.5f));
+    uint32_t interval = 1;
+    while (screen_size < m_fullRateScreenSize && interval < m_nMaxVisibleInterval)
+    {
+        screen_size *= 2.0f;
+        interval *= 2;
+    }
+    return interval;
+}
+
+uint32_t RayTracingSkinnedBLASUpdater::Build(IGfxCommandList* pCommandList)
+{
+    uint32_t requests = (uint32_t)m_requests.size();
+    uint32_t deferred = 0;
+    uint32_t paused = 0;
+
+    struct Rebuild
+    {
+        const Request* request;
+        uint32_t scratch_offset;
+    };
+    eastl::vector<const Request*> refit_list;
+    eastl::vector<Rebuild> rebuild_list;
+    uint32_t scratch_size = 0;
+
+    for (size_t i = 0; i < m_requests.size(); ++i)
+    {
+        const Request& request = m_requests[i];
+        if (!request.blas->IsBuilt())
+        {
+            continue; //its first build reads the bind pose, it is rebuilt once built
+        }
+
+        State& state = m_states[request.blas];
+        state.frames_since_update++;
+
+        if (!request.animated && !state.dirty)
+        {
+            paused++;
+            continue;
+        }
+
+        //a paused animation gets its last pose without waiting for the interval
+        bool due = state.needs_rebuild || !request.animated || state.frames_since_update >= GetUpdateInterval(request.center, request.radius);
+        if (!due)
+        {
+            state.dirty = true;
+            deferred++;
+            continue;
+        }
+
+        bool rebuild = (state.needs_rebuild || state.refits_since_rebuild >= m_nMaxRefits) &&
+            !request.blas->IsCompacted() && rebuild_list.size() < m_nMaxRebuildsPerFrame;
+
+        if (rebuild)
+        {
+            rebuild_list.push_back({ &request, scratch_size });
+            scratch_size += RoundUpPow2(request.blas->GetSizes().build_scratch_size, GFX_RT_AS_ALIGNMENT);
+            state.refits_since_rebuild = 0;
+            state.needs_rebuild = false;
+        }
+        else
+        {
+            refit_list.push_back(&request);
+            state.refits_since_rebuild++;
+        }
+
+        state.frames_since_update = 0;
+        state.dirty = false;
+    }
+
+    if (!refit_list.empty() || !rebuild_list.empty())
+    {
+        GPU_EVENT(pCommandList, "UpdateSkinnedBLAS");
+
+        if (!rebuild_list.empty())
+        {
+            //the builds of RayTracingBLASBuilder are finished with a barrier, so its scratch buffer can be reused
+            IGfxBuffer* scratch_buffer = m_pRenderer->GetBLASBuilder()->GetScratchBuffer(scratch_size);
+
+            for (size_t i = 0; i < rebuild_list.size(); ++i)
+            {
+                const Request* request = rebuild_list[i].request;
+                pCommandList->RebuildRayTracingBLAS(request->blas->GetBLAS(), request->vertex_buffer, request->vertex_buffer_offset,
+                    scratch_buffer, rebuild_list[i].scratch_offset);
+            }
+        }
+
+        for (size_t i = 0; i < refit_list.size(); ++i)
+        {
+            const Request* request = refit_list[i];
+            pCommandList->UpdateRayTracingBLAS(request->blas->GetBLAS(), request->vertex_buffer, request->vertex_buffer_offset);
+        }
+
+        pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskAS);
+    }
+
+    uint32_t refits = (uint32_t)refit_list.size();
+    uint32_t rebuilds = (uint32_t)rebuild_list.size();
+
+    m_stats.requests = requests;
+    m_stats.refits = refits;
+    m_stats.rebuilds = rebuilds;
+    m_stats.deferred = deferred;
+    m_stats.paused = paused;
+    m_stats.total_refits += refits;
+    m_stats.total_rebuilds += rebuilds;
+
+    m_requests.clear();
+
+    return refits + rebuilds;
+}
+
+void RayTracingSkinnedBLASUpdater::OnGui()
+{
+    if (ImGui::CollapsingHeader("Ray Tracing Skinned BLAS"))
+    {
+        ImGui::Text("Last frame : %u blases, %u refits, %u rebuilds, %u deferred, %u paused",
+            m_stats.requests, m_stats.refits, m_stats.rebuilds, m_stats.deferred, m_stats.paused);
+        ImGui::Text("Total : %u refits, %u rebuilds", m_stats.total_refits, m_stats.total_rebuilds);
+
+        ImGui::SliderFloat("Full Rate Screen Size##RayTracingSkinnedBLASUpdater", &m_fullRateScreenSize, 0.0f, 1.0f);
+        ImGui::SliderInt("Max Visible Interval##RayTracingSkinnedBLASUpdater", (int*)&m_nMaxVisibleInterval, 1, 16);
+        ImGui::SliderInt("Hidden Interval##RayTracingSkinnedBLASUpdater", (int*)&m_nHiddenInterval, 1, 32);
+        ImGui::SliderInt("Max Refits##RayTracingSkinnedBLASUpdater", (int*)&m_nMaxRefits, 1, 128);
+        ImGui::SliderInt("Max Rebuilds##RayTracingSkinnedBLASUpdater", (int*)&m_nMaxRebuildsPerFrame, 0, 64);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "utils/math.h"
+#include "gfx/gfx.h"
+#include "EASTL/hash_map.h"
+
+class Renderer;
+class RayTracingBLAS;
+
+struct RayTracingSkinnedBLASStats
+{
+    //last frame
+    uint32_t requests = 0;
+    uint32_t refits = 0;
+    uint32_t rebuilds = 0;
+    uint32_t deferred = 0; //not due this frame
+    uint32_t paused = 0;   //animation paused, already up to date
+
+    uint32_t total_refits = 0;
+    uint32_t total_rebuilds = 0;
+};
+
+//schedules the updates of skinned blases, and records the due ones in one batch after the blas builds.
+//a blas is refitted every frame when it is large on screen, at a lower rate when it is small or outside of the frustum,
+//and is not touched while its animation is paused. after max_refits refits it is rebuilt instead to restore the trace quality
+class RayTracingSkinnedBLASUpdater
+{
+public:
+    RayTracingSkinnedBLASUpdater(Renderer* pRenderer);
+    ~RayTracingSkinnedBLASUpdater();
+
+    //called every frame for each skinned blas with its current vertices and world bounds,
+    //animated is false when the pose did not change since the last frame
+    void Update(RayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, const float3& center, float radius, bool animated);
+    void Remove(RayTracingBLAS* blas);
+
+    //returns the number of blases updated, which the tlas needs to be refitted for
+    uint32_t Build(IGfxCommandList* pCommandList);
+
+    const RayTracingSkinnedBLASStats& GetStats() const { return m_stats; }
+    void OnGui();
+
+private:
+    uint32_t GetUpdateInterval(const float3& center, float radius) const;
+
+private:
+    Renderer* m_pRenderer = nullptr;
+
+    struct Request
+    {
+        RayTracingBLAS* blas;
+        IGfxBuffer* vertex_buffer;
+        uint32_t vertex_buffer_offset;
+        float3 center;
+        float radius;
+        bool animated;
+    };
+    eastl::vector<Request> m_requests;
+
+    struct State
+    {
+        uint32_t frames_since_update = 0;
+        uint32_t refits_since_rebuild = 0;
+        bool dirty = true; //the blas does not match the last pose
+        bool needs_rebuild = true; //its first build used the bind pose
+    };
+    eastl::hash_map<RayTracingBLAS*, State> m_states;
+
+    float m_fullRateScreenSize = 0.25f; //bounding sphere diameter over the screen height, above which a blas is refitted every frame
+    uint32_t m_nMaxVisibleInterval = 4;
+    uint32_t m_nHiddenInterval = 8;
+    uint32_t m_nMaxRefits = 32;
+    uint32_t m_nMaxRebuildsPerFrame = 8;
+
+    RayTracingSkinnedBLASStats m_stats;
+};
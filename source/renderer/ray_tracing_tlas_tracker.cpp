@@ -0,0 +1,70 @@
+#include "ray_tracing_tlas_tracker.h"
+
+static bool IsSameTopology(const GfxRayTracingInstance& a, const GfxRayTracingInstance& b)
+{
+    return a.blas == b.blas && a.instance_id == b.instance_id && a.instance_mask == b.instance_mask && a.flags == b.flags;
+}
+
+static bool IsSameTransform(const GfxRayTracingInstance& a, const GfxRayTracingInstance& b)
+{
+    return memcmp(a.transform, b.transform, sizeof(a.transform)) == 0;
+}
+
+RayTracingTLASUpdate RayTracingTLASTracker::Update(const GfxRayTracingInstance* instances, uint32_t instance_count, bool blas_updated)
+{
+    bool topology_changed = !m_bValid || instance_count != (uint32_t)m_instances.size();
+    uint32_t moved_instances = 0;
+
+    if (topology_changed)
+    {
+        moved_instances = instance_count;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            if (!IsSameTopology(instances[i], m_instances[i]))
+            {
+                topology_changed = true;
+                moved_instances = instance_count;
+                break;
+            }
+
+            if (!IsSameTransform(instances[i], m_instances[i]))
+            {
+                moved_instances++;
+            }
+        }
+    }
+
+    RayTracingTLASUpdate update;
+    bool changed = moved_instances > 0 || blas_updated;
+
+    if (topology_changed || (changed && m_nRefits >= m_nMaxRefits))
+    {
+        update = RayTracingTLASUpdate::Rebuild;
+        m_nRefits = 0;
+        m_stats.rebuilds++;
+    }
+    else if (changed)
+    {
+        update = RayTracingTLASUpdate::Refit;
+        m_nRefits++;
+        m_stats.refits++;
+    }
+    else
+    {
+        update = RayTracingTLASUpdate::None;
+        m_stats.skipped_builds++;
+    }
+
+    m_instances.assign(instances, instances + instance_count);
+    m_bValid = true;
+
+    m_stats.update = update;
+    m_stats.instances = instance_count;
+    m_stats.moved_instances = moved_instances;
+    m_stats.static_instances = instance_count - moved_instances;
+
+    return update;
+}
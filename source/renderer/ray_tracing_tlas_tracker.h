@@ -0,0 +1,46 @@
+#pragma once
+
+#include "gfx/gfx.h"
+
+enum class RayTracingTLASUpdate
+{
+    None,    //nothing changed, the last build is still valid
+    Refit,   //only transforms or blas contents changed
+    Rebuild, //instances were added, removed or changed their blas, mask or flags
+};
+
+struct RayTracingTLASStats
+{
+    //last frame
+    RayTracingTLASUpdate update = RayTracingTLASUpdate::None;
+    uint32_t instances = 0;
+    uint32_t static_instances = 0; //same transform as in the previous frame
+    uint32_t moved_instances = 0;
+
+    uint32_t rebuilds = 0;
+    uint32_t refits = 0;
+    uint32_t skipped_builds = 0;
+};
+
+//diffs the instance list of each frame against the previous one, to decide how the tlas should be updated.
+//refits degrade the tlas quality as instances move, so it is rebuilt after max_refits consecutive refits
+class RayTracingTLASTracker
+{
+public:
+    //blas_updated : the bounds of some blases changed, so the tlas needs at least a refit
+    RayTracingTLASUpdate Update(const GfxRayTracingInstance* instances, uint32_t instance_count, bool blas_updated = false);
+    void Invalidate() { m_bValid = false; } //the next update rebuilds, e.g. after the tlas was recreated
+
+    void SetMaxRefits(uint32_t count) { m_nMaxRefits = count; }
+    uint32_t GetMaxRefits() const { return m_nMaxRefits; }
+
+    const RayTracingTLASStats& GetStats() const { return m_stats; }
+
+private:
+    eastl::vector<GfxRayTracingInstance> m_instances; //of the previous update
+    bool m_bValid = false;
+    uint32_t m_nRefits = 0; //since the last rebuild
+    uint32_t m_nMaxRefits = 64;
+
+    RayTracingTLASStats m_stats;
+};
@@ -0,0 +1,75 @@
+#include "render_batch.h"
+#include "EASTL/hash_map.h"
+#include "EASTL/sort.h"
+
+uint64_t MakeRenderBatchSortKey(RenderBatchPass pass, uint32_t pso_id, uint32_t material_id, float depth)
+{
+    //for positive floats the bit pattern has the same order as the value,
+    //the upper 20 bits keep the exponent and 11 bits of mantissa
+    uint32_t depth_bits = 0;
+    if (depth > 0.0f)
+    {
+        memcpy(&depth_bits, &depth, sizeof(float));
+        depth_bits >>= 12;
+    }
+
+    return ((uint64_t)pass << 60) |
+        ((uint64_t)(pso_id & 0xFFFFF) << 40) |
+        ((uint64_t)(material_id & 0xFFFFF) << 20) |
+        (uint64_t)(depth_bits & 0xFFFFF);
+}
+
+eastl::vector<uint32_t> SortRenderBatches(const eastl::vector<RenderBatch>& batches, RenderBatchPass pass, const float3& view_pos)
+{
+    eastl::hash_map<const IGfxPipelineState*, uint32_t> psoIDs;
+
+    eastl::vector<eastl::pair<uint64_t, uint32_t>> keys;
+    keys.reserve(batches.size());
+
+    for (uint32_t i = 0; i < (uint32_t)batches.size(); ++i)
+    {
+        const RenderBatch& batch = batches[i];
+
+        auto iter = psoIDs.find(batch.pso);
+        if (iter == psoIDs.end())
+        {
+            iter = psoIDs.insert(eastl::make_pair(batch.pso, (uint32_t)psoIDs.size())).first;
+        }
+
+        float depth = length(batch.center - view_pos);
+        keys.emplace_back(MakeRenderBatchSortKey(pass, iter->second, batch.materialID, depth), i);
+    }
+
+    //the index breaks the ties, so equal keys keep the submission order
+    eastl::sort(keys.begin(), keys.end());
+
+    eastl::vector<uint32_t> order(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        order[i] = keys[i].second;
+    }
+
+    return order;
+}
+
+void DrawBatches(IGfxCommandList* pCommandList, const eastl::vector<RenderBatch>& batches, RenderBatchPass pass, const float3& view_pos, bool sort)
+{
+    RenderBatchStateCache state(pCommandList);
+
+    if (sort)
+    {
+        eastl::vector<uint32_t> order = SortRenderBatches(batches, pass, view_pos);
+
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            DrawBatch(state, batches[order[i]]);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < batches.size(); ++i)
+        {
+            DrawBatch(state, batches[i]);
+        }
+    }
+}
@@ -4,12 +4,13 @@
 #include "utils/math.h"
 #include "utils/linear_allocator.h"
 #include "utils/profiler.h"
+#include "EASTL/sort.h"
 
 #define MAX_RENDER_BATCH_CB_COUNT GFX_MAX_CBV_BINDINGS
 
 struct RenderBatch
 {
-    RenderBatch(LinearAllocator& cb_allocator) : m_allocator(cb_allocator)
+    RenderBatch(ThreadLinearAllocator& cb_allocator, uint32_t thread_index) : m_allocator(cb_allocator), m_threadIndex(thread_index)
     {
         ib = nullptr;
     }
@@ -46,6 +47,7 @@ struct RenderBatch
     uint32_t meshletCount = 0;
     uint32_t instanceIndex = 0;
     uint32_t vertex_count = 0;
+    uint32_t materialID = 0; //only used for sorting
 
     void SetPipelineState(IGfxPipelineState* pPSO)
     {
@@ -58,7 +60,7 @@ struct RenderBatch
 
         if (cb[slot].data == nullptr || cb[slot].data_size < data_size)
         {
-            cb[slot].data = m_allocator.Alloc((uint32_t)data_size);
+            cb[slot].data = m_allocator.Alloc(m_threadIndex, (uint32_t)data_size);
         }
 
         cb[slot].data_size = (uint32_t)data_size;
@@ -90,20 +92,107 @@ struct RenderBatch
     }
 
 private:
-    LinearAllocator& m_allocator;
+    ThreadLinearAllocator& m_allocator;
+    uint32_t m_threadIndex; //batches are filled on the thread which added them
 };
 
-inline void DrawBatch(IGfxCommandList* pCommandList, const RenderBatch& batch)
+//filters the binds which would not change the state of the command list.
+//the state is not tracked across render passes or command lists, use one instance per pass
+class RenderBatchStateCache
+{
+public:
+    RenderBatchStateCache(IGfxCommandList* pCommandList) : m_pCommandList(pCommandList) {}
+
+    IGfxCommandList* GetCommandList() const { return m_pCommandList; }
+
+    void SetPipelineState(IGfxPipelineState* pso)
+    {
+        if (m_pPSO != pso)
+        {
+            m_pCommandList->SetPipelineState(pso);
+            m_pPSO = pso;
+        }
+    }
+
+    void SetGraphicsConstants(uint32_t slot, const void* data, uint32_t data_size)
+    {
+        if (!m_graphicsConstants[slot].Equals(data, data_size))
+        {
+            m_pCommandList->SetGraphicsConstants(slot, data, data_size);
+            m_graphicsConstants[slot].Set(data, data_size);
+        }
+    }
+
+    void SetComputeConstants(uint32_t slot, const void* data, uint32_t data_size)
+    {
+        if (!m_computeConstants[slot].Equals(data, data_size))
+        {
+            m_pCommandList->SetComputeConstants(slot, data, data_size);
+            m_computeConstants[slot].Set(data, data_size);
+        }
+    }
+
+    //the index buffers of different meshes usually only differ in offset,
+    //so it is bound once at offset 0 and the offset is applied to the draw. returns the index offset
+    uint32_t SetIndexBuffer(IGfxBuffer* buffer, uint32_t offset, GfxFormat format)
+    {
+        uint32_t index_size = format == GfxFormat::R16UI ? 2 : 4;
+        uint32_t bind_offset = offset % index_size == 0 ? 0 : offset;
+
+        if (m_pIndexBuffer != buffer || m_indexBufferOffset != bind_offset || m_indexBufferFormat != format)
+        {
+            m_pCommandList->SetIndexBuffer(buffer, bind_offset, format);
+            m_pIndexBuffer = buffer;
+            m_indexBufferOffset = bind_offset;
+            m_indexBufferFormat = format;
+        }
+
+        return (offset - bind_offset) / index_size;
+    }
+
+private:
+    struct Constants
+    {
+        uint8_t data[256];
+        uint32_t size = 0; //0 : unknown
+
+        bool Equals(const void* other, uint32_t other_size) const
+        {
+            return size != 0 && size == other_size && memcmp(data, other, size) == 0;
+        }
+
+        void Set(const void* other, uint32_t other_size)
+        {
+            //larger constant buffers are not cached, they are always set
+            size = other_size <= sizeof(data) ? other_size : 0;
+            if (size != 0)
+            {
+                memcpy(data, other, size);
+            }
+        }
+    };
+
+    IGfxCommandList* m_pCommandList = nullptr;
+    IGfxPipelineState* m_pPSO = nullptr;
+    Constants m_graphicsConstants[MAX_RENDER_BATCH_CB_COUNT];
+    Constants m_computeConstants[MAX_RENDER_BATCH_CB_COUNT];
+    IGfxBuffer* m_pIndexBuffer = nullptr;
+    uint32_t m_indexBufferOffset = 0;
+    GfxFormat m_indexBufferFormat = GfxFormat::Unknown;
+};
+
+inline void DrawBatch(RenderBatchStateCache& state, const RenderBatch& batch)
 {
+    IGfxCommandList* pCommandList = state.GetCommandList();
     GPU_EVENT(pCommandList, batch.label);
 
-    pCommandList->SetPipelineState(batch.pso);
+    state.SetPipelineState(batch.pso);
 
     for (int i = 0; i < MAX_RENDER_BATCH_CB_COUNT; ++i)
     {
         if (batch.cb[i].data != nullptr)
         {
-            pCommandList->SetGraphicsConstants(i, batch.cb[i].data, batch.cb[i].data_size);
+            state.SetGraphicsConstants(i, batch.cb[i].data, batch.cb[i].data_size);
         }
     }
 
@@ -113,8 +202,8 @@ inline void DrawBatch(IGfxCommandList* pCommandList, const RenderBatch& batch)
     }
     else if(batch.ib != nullptr)
     {
-        pCommandList->SetIndexBuffer(batch.ib, batch.ib_offset, batch.ib_format);
-        pCommandList->DrawIndexed(batch.index_count);
+        uint32_t index_offset = state.SetIndexBuffer(batch.ib, batch.ib_offset, batch.ib_format);
+        pCommandList->DrawIndexed(batch.index_count, 1, index_offset);
     }
     else
     {
@@ -122,9 +211,34 @@ inline void DrawBatch(IGfxCommandList* pCommandList, const RenderBatch& batch)
     }
 }
 
+inline void DrawBatch(IGfxCommandList* pCommandList, const RenderBatch& batch)
+{
+    RenderBatchStateCache state(pCommandList);
+    DrawBatch(state, batch);
+}
+
+enum class RenderBatchPass
+{
+    Base,
+    Forward,
+    Velocity,
+    ObjectID,
+    Gui,
+};
+
+//pass(4 bits) | pso(20 bits) | material(20 bits) | depth(20 bits)
+uint64_t MakeRenderBatchSortKey(RenderBatchPass pass, uint32_t pso_id, uint32_t material_id, float depth);
+
+//returns the batch indices ordered by MakeRenderBatchSortKey, front to back within the same pso and material.
+//pso ids are assigned in the order they first appear, so the result is deterministic
+eastl::vector<uint32_t> SortRenderBatches(const eastl::vector<RenderBatch>& batches, RenderBatchPass pass, const float3& view_pos);
+
+//draws the batches in the sorted order if sort is true, or in the submission order (eg. for blending)
+void DrawBatches(IGfxCommandList* pCommandList, const eastl::vector<RenderBatch>& batches, RenderBatchPass pass, const float3& view_pos, bool sort = true);
+
 struct ComputeBatch
 {
-    ComputeBatch(LinearAllocator& cb_allocator) : m_allocator(cb_allocator)
+    ComputeBatch(ThreadLinearAllocator& cb_allocator, uint32_t thread_index) : m_allocator(cb_allocator), m_threadIndex(thread_index)
     {
     }
 
@@ -152,7 +266,7 @@ struct ComputeBatch
 
         if (cb[slot].data == nullptr || cb[slot].data_size < data_size)
         {
-            cb[slot].data = m_allocator.Alloc((uint32_t)data_size);
+            cb[slot].data = m_allocator.Alloc(m_threadIndex, (uint32_t)data_size);
         }
 
         cb[slot].data_size = (uint32_t)data_size;
@@ -167,22 +281,104 @@ struct ComputeBatch
     }
 
 private:
-    LinearAllocator& m_allocator;
+    ThreadLinearAllocator& m_allocator;
+    uint32_t m_threadIndex; //batches are filled on the thread which added them
 };
 
-inline void DispatchBatch(IGfxCommandList* pCommandList, const ComputeBatch& batch)
+inline void DispatchBatch(RenderBatchStateCache& state, const ComputeBatch& batch)
 {
+    IGfxCommandList* pCommandList = state.GetCommandList();
     GPU_EVENT(pCommandList, batch.label);
 
-    pCommandList->SetPipelineState(batch.pso);
+    state.SetPipelineState(batch.pso);
 
     for (int i = 0; i < MAX_RENDER_BATCH_CB_COUNT; ++i)
     {
         if (batch.cb[i].data != nullptr)
         {
-            pCommandList->SetComputeConstants(i, batch.cb[i].data, batch.cb[i].data_size);
+            state.SetComputeConstants(i, batch.cb[i].data, batch.cb[i].data_size);
         }
     }
 
     pCommandList->Dispatch(batch.dispatch_x, batch.dispatch_y, batch.dispatch_z);
-}
\ No newline at end of file
+}
+
+inline void DispatchBatch(IGfxCommandList* pCommandList, const ComputeBatch& batch)
+{
+    RenderBatchStateCache state(pCommandList);
+    DispatchBatch(state, batch);
+}
+
+//batches added from multiple threads, each thread appends to its own list without locking.
+//every batch is tagged with a key, Merge outputs them in the key order so the result does not depend on the scheduling
+template<typename T>
+class ThreadBatchList
+{
+public:
+    void Init(uint32_t thread_count)
+    {
+        m_threadLists.resize(thread_count);
+    }
+
+    T& Add(ThreadLinearAllocator& cb_allocator, uint32_t thread_index, uint64_t key)
+    {
+        ThreadList& list = m_threadLists[thread_index];
+        list.keys.push_back(key);
+        return list.batches.emplace_back(cb_allocator, thread_index);
+    }
+
+    //for the lists of plain items, which are not recorded with a constant buffer allocator
+    void Add(uint32_t thread_index, uint64_t key, const T& item)
+    {
+        ThreadList& list = m_threadLists[thread_index];
+        list.keys.push_back(key);
+        list.batches.push_back(item);
+    }
+
+    //appends the batches of all threads to output, and clears the thread lists
+    void Merge(eastl::vector<T>& output)
+    {
+        struct Entry
+        {
+            uint64_t key;
+            uint32_t thread;
+            uint32_t index;
+
+            bool operator<(const Entry& other) const
+            {
+                return key < other.key || (key == other.key && thread < other.thread);
+            }
+        };
+
+        eastl::vector<Entry> entries;
+        for (uint32_t t = 0; t < (uint32_t)m_threadLists.size(); ++t)
+        {
+            for (uint32_t i = 0; i < (uint32_t)m_threadLists[t].keys.size(); ++i)
+            {
+                entries.push_back({ m_threadLists[t].keys[i], t, i });
+            }
+        }
+
+        eastl::sort(entries.begin(), entries.end());
+
+        output.reserve(output.size() + entries.size());
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            output.push_back(m_threadLists[entries[i].thread].batches[entries[i].index]);
+        }
+
+        for (size_t t = 0; t < m_threadLists.size(); ++t)
+        {
+            m_threadLists[t].keys.clear();
+            m_threadLists[t].batches.clear();
+        }
+    }
+
+private:
+    struct ThreadList
+    {
+        eastl::vector<uint64_t> keys;
+        eastl::vector<T> batches;
+    };
+    eastl::vector<ThreadList> m_threadLists;
+};
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "renderer.h"
 #include "texture_loader.h"
+#include "async_texture_loader.h"
+#include "baked_asset_cache.h"
 #include "shader_compiler.h"
 #include "shader_cache.h"
 #include "pipeline_cache.h"
@@ -11,15 +13,22 @@
 #include "marschner_hair_lut.h"
 #include "base_pass.h"
 #include "path_tracer.h"
+#include "ray_tracing_blas_builder.h"
+#include "ray_tracing_skinned_blas_updater.h"
 #include "sky_cubemap.h"
+#include "texture_streamer.h"
+#include "vertex_skinning.h"
 #include "stbn.h"
 #include "lighting/lighting_processor.h"
 #include "lighting/clustered_light_lists.h"
 #include "post_processing/post_processor.h"
 #include "core/engine.h"
+#include "enkiTS/TaskScheduler.h"
 #include "utils/profiler.h"
 #include "utils/log.h"
+#include "utils/parallel_for.h"
 #include "fmt/format.h"
+#include "sokol/sokol_time.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 #include "lodepng/lodepng.h"
@@ -30,7 +39,17 @@ Renderer::Renderer()
     m_pShaderCache = eastl::make_unique<ShaderCache>(this);
     m_pShaderCompiler = eastl::make_unique<ShaderCompiler>(this);
     m_pPipelineCache = eastl::make_unique<PipelineStateCache>(this);
-    m_cbAllocator = eastl::make_unique<LinearAllocator>(8 * 1024 * 1024);
+
+    uint32_t thread_count = Engine::GetInstance()->GetTaskScheduler()->GetNumTaskThreads();
+    m_cbAllocator = eastl::make_unique<ThreadLinearAllocator>(8 * 1024 * 1024, thread_count);
+    m_batchOrders.resize(thread_count);
+    m_basePassThreadBatchs.Init(thread_count);
+    m_forwardPassThreadBatchs.Init(thread_count);
+    m_velocityPassThreadBatchs.Init(thread_count);
+    m_idPassThreadBatchs.Init(thread_count);
+    m_animationThreadBatchs.Init(thread_count);
+
+    m_pAsyncTextureLoader = eastl::make_unique<AsyncTextureLoader>();
 
     Engine::GetInstance()->WindowResizeSignal.connect(&Renderer::OnWindowResize, this);
 }
@@ -103,6 +122,9 @@ bool Renderer::CreateDevice(GfxRenderBackend backend, void* window_handle, uint3
 
     m_pRenderGraph = eastl::make_unique<RenderGraph>(this);
     m_pGpuScene = eastl::make_unique<GpuScene>(this);
+    m_pBLASBuilder = eastl::make_unique<RayTracingBLASBuilder>(this);
+    m_pSkinnedBLASUpdater = eastl::make_unique<RayTracingSkinnedBLASUpdater>(this);
+    m_pVertexSkinning = eastl::make_unique<VertexSkinning>(this, Engine::GetInstance()->GetTaskScheduler()->GetNumTaskThreads());
     m_pHZB = eastl::make_unique<HZB>(this);
     m_pBasePass = eastl::make_unique<BasePass>(this);
     m_pLightingProcessor = eastl::make_unique<LightingProcessor>(this);
@@ -113,6 +135,11 @@ bool Renderer::CreateDevice(GfxRenderBackend backend, void* window_handle, uint3
     m_pPathTracer = eastl::make_unique<PathTracer>(this);
     m_pSkyCubeMap = eastl::make_unique<SkyCubeMap>(this);
 
+    if (backend == GfxRenderBackend::D3D12 || backend == GfxRenderBackend::Mock)
+    {
+        m_pTextureStreamer = eastl::make_unique<TextureStreamer>(this, 512 * 1024 * 1024);
+    }
+
     return true;
 }
 
@@ -120,11 +147,18 @@ void Renderer::RenderFrame()
 {
     CPU_EVENT("Render", "Renderer::RenderFrame");
 
+    MergeBatches();
     m_pGpuScene->Update();
 
     BuildRenderGraph(m_outputColorHandle, m_outputDepthHandle);
 
     BeginFrame();
+
+    if (m_pTextureStreamer)
+    {
+        m_pTextureStreamer->Update();
+    }
+
     UploadResources();
     Render();
     EndFrame();
@@ -156,7 +190,7 @@ void Renderer::UploadResources()
 {
     CPU_EVENT("Render", "Renderer::UploadResources");
 
-    if (m_pendingTextureUploads.empty() && m_pendingBufferUpload.empty())
+    if (m_pendingTextureUploads.empty() && m_pendingBufferUpload.empty() && m_pendingTileMappings.empty())
     {
         return;
     }
@@ -169,6 +203,12 @@ void Renderer::UploadResources()
     {
         GPU_EVENT(pUploadCommandList, "Renderer::UploadResources");
 
+        for (size_t i = 0; i < m_pendingTileMappings.size(); ++i)
+        {
+            const TileMappingUpdate& update = m_pendingTileMappings[i];
+            pUploadCommandList->UpdateTileMappings(update.texture, update.heap, (uint32_t)update.mappings.size(), update.mappings.data());
+        }
+
         for (size_t i = 0; i < m_pendingBufferUpload.size(); ++i)
         {
             const BufferUpload& upload = m_pendingBufferUpload[i];
@@ -203,19 +243,23 @@ void Renderer::UploadResources()
 
     m_pendingBufferUpload.clear();
     m_pendingTextureUploads.clear();
+    m_pendingTileMappings.clear();
 }
 
 void Renderer::FlushComputePass(IGfxCommandList* pCommandList)
 {
-    if (!m_animationBatchs.empty())
+    if (!m_animationBatchs.empty() || m_pVertexSkinning->HasJobs())
     {
         GPU_EVENT(pCommandList, "Animation Pass");
 
         m_pGpuScene->BeginAnimationUpdate(pCommandList);
 
+        m_pVertexSkinning->Dispatch(pCommandList);
+
+        RenderBatchStateCache state(pCommandList);
         for (size_t i = 0; i < m_animationBatchs.size(); ++i)
         {
-            DispatchBatch(pCommandList, m_animationBatchs[i]);
+            DispatchBatch(state, m_animationBatchs[i]);
         }
 
         m_pGpuScene->EndAnimationUpdate(pCommandList);
@@ -240,33 +284,10 @@ void Renderer::BuildRayTracingAS(IGfxCommandList* pGraphicsCommandList, IGfxComm
         IGfxCommandList* pCommandList = m_bEnableAsyncCompute ? pComputeCommandList : pGraphicsCommandList;
         GPU_EVENT(pCommandList, "BuildRayTracingAS");
 
-        if (!m_pendingBLASBuilds.empty())
-        {
-            GPU_EVENT(pCommandList, "BuildBLAS");
-
-            for (size_t i = 0; i < m_pendingBLASBuilds.size(); ++i)
-            {
-                pCommandList->BuildRayTracingBLAS(m_pendingBLASBuilds[i]);
-            }
-            m_pendingBLASBuilds.clear();
-
-            pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskAS);
-        }
+        m_pBLASBuilder->Build(pCommandList);
+        uint32_t skinned_updates = m_pSkinnedBLASUpdater->Build(pCommandList);
 
-        if (!m_pendingBLASUpdates.empty())
-        {
-            GPU_EVENT(pCommandList, "UpdateBLAS");
-
-            for (size_t i = 0; i < m_pendingBLASUpdates.size(); ++i)
-            {
-                pCommandList->UpdateRayTracingBLAS(m_pendingBLASUpdates[i].blas, m_pendingBLASUpdates[i].vertex_buffer, m_pendingBLASUpdates[i].vertex_buffer_offset);
-            }
-            m_pendingBLASUpdates.clear();
-
-            pCommandList->GlobalBarrier(GfxAccessMaskAS, GfxAccessMaskAS);
-        }
-
-        m_pGpuScene->BuildRayTracingAS(pCommandList);
+        m_pGpuScene->BuildRayTracingAS(pCommandList, skinned_updates > 0);
     }
 }
 
@@ -297,12 +318,22 @@ void Renderer::Render()
 
     m_pSkyCubeMap->Update(pCommandList);
 
+    if (m_pTextureStreamer)
+    {
+        m_pTextureStreamer->ClearFeedback(pCommandList);
+    }
+
     World* world = Engine::GetInstance()->GetWorld();
     Camera* camera = world->GetCamera();
     camera->DrawViewFrustum(pCommandList);
 
     m_pRenderGraph->Execute(this, pCommandList, pComputeCommandList);
 
+    if (m_pTextureStreamer)
+    {
+        m_pTextureStreamer->CopyFeedback(pCommandList);
+    }
+
     RenderBackbufferPass(pCommandList, m_outputColorHandle, m_outputDepthHandle);
 }
 
@@ -343,9 +374,10 @@ void Renderer::RenderBackbufferPass(IGfxCommandList* pCommandList, RGHandle colo
 
     CopyToBackbuffer(pCommandList, color, depth, needUpscaleDepth);
 
+    RenderBatchStateCache state(pCommandList);
     for (size_t i = 0; i < m_guiBatchs.size(); ++i)
     {
-        DrawBatch(pCommandList, m_guiBatchs[i]);
+        DrawBatch(state, m_guiBatchs[i]);
     }
 
     m_pGpuDebugLine->Draw(pCommandList);
@@ -538,17 +570,47 @@ void Renderer::CreateCommonResources()
     m_pShadowSampler.reset(m_pDevice->CreateSampler(desc, "Renderer::m_pShadowSampler"));
 
     eastl::string asset_path = Engine::GetInstance()->GetAssetPath();
-    m_pPreintegratedGFTexture.reset(CreateTexture2D(asset_path + "textures/PreintegratedGF.dds", false));
-    m_pSheenETexture.reset(CreateTexture2D(asset_path + "textures/Sheen_ash_E.dds", false));
-    m_pTonyMcMapface.reset(CreateTexture3D(asset_path + "textures/tony_mc_mapface/tony_mc_mapface.dds", false));
+    uint64_t ticks = stm_now();
+
+    //decoded on task threads while the lookup tables are loaded, the sky cubemap acquires the hdri later
+    m_pAsyncTextureLoader->Request(asset_path + "textures/blue_noise/LDR_RGBA_0.png", false);
+    m_pAsyncTextureLoader->Request(SkyCubeMap::GetDefaultHDRI(), false);
 
+    //the luts are read from the baked cache, or generated and baked, in parallel. textures are created on this thread
+    BakedAssetCache baked_cache;
     m_pMarschnerHairLUT = eastl::make_unique<MarschnerHairLUT>(this);
-    m_pMarschnerHairLUT->Generate();
+    m_pSTBN = eastl::make_unique<STBN>(this);
+
+    double lut_times[2] = {};
+    ParallelFor(2, [&](uint32_t i)
+        {
+            uint64_t lut_ticks = stm_now();
+            if (i == 0)
+            {
+                m_pMarschnerHairLUT->Generate(&baked_cache);
+            }
+            else
+            {
+                m_pSTBN->Load(asset_path + "textures/blue_noise/STBN/", &baked_cache);
+            }
+            lut_times[i] = stm_ms(stm_since(lut_ticks));
+        });
+
+    double lut_time = stm_ms(stm_laptime(&ticks));
+
+    m_pMarschnerHairLUT->CreateTextures();
+    m_pSTBN->CreateTextures();
 
+    m_pPreintegratedGFTexture.reset(CreateTexture2D(asset_path + "textures/PreintegratedGF.dds", false));
+    m_pSheenETexture.reset(CreateTexture2D(asset_path + "textures/Sheen_ash_E.dds", false));
+    m_pTonyMcMapface.reset(CreateTexture3D(asset_path + "textures/tony_mc_mapface/tony_mc_mapface.dds", false));
     m_pBlueNoise.reset(CreateTexture2D(asset_path + "textures/blue_noise/LDR_RGBA_0.png", false));
 
-    m_pSTBN = eastl::make_unique<STBN>(this);
-    m_pSTBN->Load(asset_path + "textures/blue_noise/STBN/");
+    double texture_time = stm_ms(stm_laptime(&ticks));
+
+    RE_INFO("[Renderer] lookup tables {:.1f} ms (hair LUT {:.1f} ms {}, STBN {:.1f} ms {}), textures {:.1f} ms",
+        lut_time, lut_times[0], m_pMarschnerHairLUT->IsBaked() ? "baked" : "generated",
+        lut_times[1], m_pSTBN->IsBaked() ? "baked" : "decoded", texture_time);
 
     m_pSPDCounterBuffer.reset(CreateTypedBuffer(nullptr, GfxFormat::R32UI, 1, "Renderer::m_pSPDCounterBuffer", GfxMemoryType::GpuOnly, true));
 
@@ -600,6 +662,9 @@ void Renderer::SetupGlobalConstants(IGfxCommandList* pCommandList)
     sceneCB.sceneAnimationBufferSRV = m_pGpuScene->GetSceneAnimationBufferSRV()->GetHeapIndex();
     sceneCB.sceneAnimationBufferUAV = m_pGpuScene->GetSceneAnimationBufferUAV()->GetHeapIndex();
     sceneCB.instanceDataAddress = m_pGpuScene->GetInstanceDataAddress();
+    sceneCB.sceneMaterialBufferSRV = m_pGpuScene->GetSceneMaterialBufferSRV()->GetHeapIndex();
+    sceneCB.textureStreamingFeedbackUAV = m_pTextureStreamer ? m_pTextureStreamer->GetFeedbackUAV()->GetHeapIndex() : GFX_INVALID_RESOURCE;
+    sceneCB.textureStreamingResidencyAddress = m_pTextureStreamer ? m_pTextureStreamer->GetResidencyAddress() : 0;
     sceneCB.sceneRayTracingTLAS = m_pGpuScene->GetRayTracingTLASSRV()->GetHeapIndex();
     sceneCB.bShowMeshlets = m_bShowMeshlets;
     sceneCB.secondPhaseMeshletsListUAV = occlusionCulledMeshletsBuffer->GetUAV()->GetHeapIndex();
@@ -642,7 +707,7 @@ void Renderer::SetupGlobalConstants(IGfxCommandList* pCommandList)
     sceneCB.aniso16xSampler = m_pAniso16xSampler->GetHeapIndex();
     sceneCB.skyCubeTexture = m_pSkyCubeMap->GetCubeTexture()->GetSRV()->GetHeapIndex();
     sceneCB.skySpecularIBLTexture = m_pSkyCubeMap->GetSpecularCubeTexture()->GetSRV()->GetHeapIndex();
-    sceneCB.skyDiffuseIBLTexture = m_pSkyCubeMap->GetDiffuseCubeTexture()->GetSRV()->GetHeapIndex();
+    sceneCB.skyDiffuseSHBuffer = m_pSkyCubeMap->GetDiffuseSHBuffer()->GetSRV()->GetHeapIndex();
     sceneCB.preintegratedGFTexture = m_pPreintegratedGFTexture->GetSRV()->GetHeapIndex();
     sceneCB.blueNoiseTexture = m_pBlueNoise->GetSRV()->GetHeapIndex();
     sceneCB.sheenETexture = m_pSheenETexture->GetSRV()->GetHeapIndex();
@@ -665,6 +730,11 @@ void Renderer::SetupGlobalConstants(IGfxCommandList* pCommandList)
     sceneCB.lightGridSliceCount = clusteredLightLists->GetSliceCount();
     sceneCB.lightGridSliceParams = clusteredLightLists->GetSliceParams(camera);
 
+    RGHandle lightGridsBufferHandle = clusteredLightLists->GetLightGridsBuffer();
+    RGHandle lightIndicesBufferHandle = clusteredLightLists->GetLightIndicesBuffer();
+    sceneCB.lightGridsBufferSRV = lightGridsBufferHandle.IsValid() ? m_pRenderGraph->GetBuffer(lightGridsBufferHandle)->GetSRV()->GetHeapIndex() : GFX_INVALID_RESOURCE;
+    sceneCB.lightIndicesBufferSRV = lightIndicesBufferHandle.IsValid() ? m_pRenderGraph->GetBuffer(lightIndicesBufferHandle)->GetSRV()->GetHeapIndex() : GFX_INVALID_RESOURCE;
+
     if (pCommandList->GetQueue() == GfxCommandQueue::Graphics)
     {
         pCommandList->SetGraphicsConstants(2, &sceneCB, sizeof(sceneCB));
@@ -815,14 +885,44 @@ RawBuffer* Renderer::CreateRawBuffer(const void* data, uint32_t size, const east
     return buffer;
 }
 
-Texture2D* Renderer::CreateTexture2D(const eastl::string& file, bool srgb)
+Texture2D* Renderer::CreateTexture2D(const eastl::string& file, bool srgb, bool streaming)
 {
-    TextureLoader loader;
-    if (!loader.Load(file, srgb))
+    eastl::unique_ptr<TextureLoader> loader = LoadTexture2D(file, srgb);
+    if (loader == nullptr)
     {
         return nullptr;
     }
 
+    return CreateTexture2D(*loader, file, srgb, streaming);
+}
+
+eastl::unique_ptr<TextureLoader> Renderer::LoadTexture2D(const eastl::string& file, bool srgb)
+{
+    //prefetched files were already mapped and decoded on task threads
+    eastl::unique_ptr<TextureLoader> loader = m_pAsyncTextureLoader->Acquire(file, srgb);
+    if (loader == nullptr)
+    {
+        loader = eastl::make_unique<TextureLoader>();
+        if (!loader->Load(file, srgb))
+        {
+            return nullptr;
+        }
+    }
+
+    return loader;
+}
+
+Texture2D* Renderer::CreateTexture2D(const TextureLoader& loader, const eastl::string& file, bool srgb, bool streaming)
+{
+    if (streaming && m_pTextureStreamer)
+    {
+        Texture2D* texture = m_pTextureStreamer->CreateTexture(loader, file, srgb);
+        if (texture)
+        {
+            return texture;
+        }
+    }
+
     Texture2D* texture = CreateTexture2D(loader.GetWidth(), loader.GetHeight(), loader.GetMipLevels(), loader.GetFormat(), 0, file);
     if (texture)
     {
@@ -977,9 +1077,24 @@ uint32_t Renderer::AllocateSceneConstant(const void* data, uint32_t size)
     return address;
 }
 
-uint32_t Renderer::AddInstance(const InstanceData& data, IGfxRayTracingBLAS* blas, GfxRayTracingInstanceFlag flags)
+uint32_t Renderer::AddSceneMaterial(const ModelMaterialConstant& data)
+{
+    return m_pGpuScene->AddMaterial(data);
+}
+
+void Renderer::ReleaseSceneMaterial(uint32_t index)
+{
+    m_pGpuScene->ReleaseMaterial(index);
+}
+
+const ModelMaterialConstant* Renderer::GetSceneMaterial(uint32_t index) const
+{
+    return m_pGpuScene->GetMaterial(index);
+}
+
+uint32_t Renderer::AddInstance(const InstanceData& data, RayTracingBLAS* blas, uint32_t instance_mask, GfxRayTracingInstanceFlag flags)
 {
-    return m_pGpuScene->AddInstance(data, blas, flags);
+    return m_pGpuScene->AddInstance(data, blas, instance_mask, flags);
 }
 
 uint32_t Renderer::AddLocalLight(const LocalLightData& data)
@@ -987,7 +1102,7 @@ uint32_t Renderer::AddLocalLight(const LocalLightData& data)
     return m_pGpuScene->AddLocalLight(data);
 }
 
-inline void image_copy(char* dst_data, uint32_t dst_row_pitch, char* src_data, uint32_t src_row_pitch, uint32_t row_num, uint32_t d)
+inline void image_copy(char* dst_data, uint32_t dst_row_pitch, const char* src_data, uint32_t src_row_pitch, uint32_t row_num, uint32_t d)
 {
     uint32_t src_slice_size = src_row_pitch * row_num;
     uint32_t dst_slice_size = dst_row_pitch * row_num;
@@ -995,7 +1110,7 @@ inline void image_copy(char* dst_data, uint32_t dst_row_pitch, char* src_data, u
     for (uint32_t z = 0; z < d; z++)
     {
         char* dst_slice = dst_data + dst_slice_size * z;
-        char* src_slice = src_data + src_slice_size * z;
+        const char* src_slice = src_data + src_slice_size * z;
 
         for (uint32_t row = 0; row < row_num; ++row)
         {
@@ -1055,6 +1170,40 @@ void Renderer::UploadTexture(IGfxTexture* texture, const void* data)
     }
 }
 
+void Renderer::UploadTexture(IGfxTexture* texture, uint32_t mip_level, uint32_t array_slice, const void* data)
+{
+    uint32_t frame_index = m_pDevice->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
+    StagingBufferAllocator* pAllocator = m_pStagingBufferAllocator[frame_index].get();
+
+    const GfxTextureDesc& desc = texture->GetDesc();
+
+    uint32_t w = max(desc.width >> mip_level, GetFormatBlockWidth(desc.format));
+    uint32_t h = max(desc.height >> mip_level, GetFormatBlockHeight(desc.format));
+    uint32_t d = max(desc.depth >> mip_level, 1u);
+
+    uint32_t src_row_pitch = GetFormatRowPitch(desc.format, w) * GetFormatBlockHeight(desc.format);
+    uint32_t dst_row_pitch = texture->GetRowPitch(mip_level);
+    uint32_t row_num = h / GetFormatBlockHeight(desc.format);
+
+    StagingBuffer buffer = pAllocator->Allocate(dst_row_pitch * row_num * d);
+
+    char* dst_data = (char*)buffer.buffer->GetCpuAddress() + buffer.offset;
+    image_copy(dst_data, dst_row_pitch, (const char*)data, src_row_pitch, row_num, d);
+
+    TextureUpload upload;
+    upload.texture = texture;
+    upload.mip_level = mip_level;
+    upload.array_slice = array_slice;
+    upload.staging_buffer = buffer;
+    upload.offset = 0;
+    m_pendingTextureUploads.push_back(upload);
+}
+
+void Renderer::UpdateTileMappings(IGfxTexture* texture, IGfxHeap* heap, const eastl::vector<GfxTileMapping>& mappings)
+{
+    m_pendingTileMappings.push_back({ texture, heap, mappings });
+}
+
 void Renderer::UploadBuffer(IGfxBuffer* buffer, uint32_t offset, const void* data, uint32_t data_size)
 {
     uint32_t frame_index = m_pDevice->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
@@ -1072,19 +1221,60 @@ void Renderer::UploadBuffer(IGfxBuffer* buffer, uint32_t offset, const void* dat
     m_pendingBufferUpload.push_back(upload);
 }
 
-void Renderer::BuildRayTracingBLAS(IGfxRayTracingBLAS* blas)
+RayTracingBLAS* Renderer::CreateRayTracingBLAS(const GfxRayTracingBLASDesc& desc, const eastl::string& name)
 {
-    m_pendingBLASBuilds.push_back(blas);
+    return m_pBLASBuilder->CreateBLAS(desc, name);
 }
 
-void Renderer::UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset)
+void Renderer::ReleaseRayTracingBLAS(RayTracingBLAS* blas)
 {
-    m_pendingBLASUpdates.push_back({ blas, vertex_buffer, vertex_buffer_offset });
+    m_pSkinnedBLASUpdater->Remove(blas);
+    m_pBLASBuilder->ReleaseBLAS(blas);
 }
 
-RenderBatch& Renderer::AddBasePassBatch()
+void Renderer::UpdateRayTracingBLAS(RayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, const float3& center, float radius, bool animated)
 {
-    return m_pBasePass->AddBatch();
+    m_pSkinnedBLASUpdater->Update(blas, vertex_buffer, vertex_buffer_offset, center, radius, animated);
+}
+
+uint32_t Renderer::GetThreadIndex() const
+{
+    return Engine::GetInstance()->GetTaskScheduler()->GetThreadNum();
+}
+
+void Renderer::SetBatchOrder(uint32_t order)
+{
+    BatchOrder& batchOrder = m_batchOrders[GetThreadIndex()];
+    batchOrder.order = order;
+    batchOrder.sequence = 0;
+}
+
+void Renderer::AddVertexSkinningJob(const VertexSkinningJob& job)
+{
+    m_pVertexSkinning->AddJob(GetThreadIndex(), GetBatchKey(), job);
+}
+
+uint64_t Renderer::GetBatchKey()
+{
+    BatchOrder& batchOrder = m_batchOrders[GetThreadIndex()];
+    return ((uint64_t)batchOrder.order << 32) | batchOrder.sequence++;
+}
+
+void Renderer::MergeBatches()
+{
+    CPU_EVENT("Render", "Renderer::MergeBatches");
+
+    m_basePassThreadBatchs.Merge(m_pBasePass->GetBatches());
+    m_forwardPassThreadBatchs.Merge(m_forwardPassBatchs);
+    m_velocityPassThreadBatchs.Merge(m_velocityPassBatchs);
+    m_idPassThreadBatchs.Merge(m_idPassBatchs);
+    m_animationThreadBatchs.Merge(m_animationBatchs);
+    m_pVertexSkinning->Upload();
+
+    for (size_t i = 0; i < m_batchOrders.size(); ++i)
+    {
+        m_batchOrders[i] = BatchOrder();
+    }
 }
 
 StagingBufferAllocator* Renderer::GetStagingBufferAllocator() const
@@ -1094,6 +1284,11 @@ StagingBufferAllocator* Renderer::GetStagingBufferAllocator() const
     return pAllocator;
 }
 
+HashGridRadianceCache* Renderer::GetRadianceCache() const
+{
+    return m_pLightingProcessor->GetRadianceCache();
+}
+
 void Renderer::SaveTexture(const eastl::string& file, const void* data, uint32_t width, uint32_t height, GfxFormat format)
 {
     if (strstr(file.c_str(), ".png"))
@@ -1153,6 +1348,15 @@ void Renderer::OnGui()
     World* world = Engine::GetInstance()->GetWorld();
     world->GetCamera()->OnGui();
 
+    m_pGpuScene->OnGui();
+    m_pBLASBuilder->OnGui();
+    m_pSkinnedBLASUpdater->OnGui();
+    m_pVertexSkinning->OnGui();
+
+    if (m_pTextureStreamer)
+    {
+        m_pTextureStreamer->OnGui();
+    }
     m_pSkyCubeMap->OnGui();
     m_pLightingProcessor->OnGui();
     m_pPathTracer->OnGui();
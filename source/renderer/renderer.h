@@ -88,7 +88,9 @@ public:
     TypedBuffer* CreateTypedBuffer(const void* data, GfxFormat format, uint32_t element_count, const eastl::string& name, GfxMemoryType memory_type = GfxMemoryType::GpuOnly, bool uav = false);
     RawBuffer* CreateRawBuffer(const void* data, uint32_t size, const eastl::string& name, GfxMemoryType memory_type = GfxMemoryType::GpuOnly, bool uav = false);
 
-    Texture2D* CreateTexture2D(const eastl::string& file, bool srgb);
+    Texture2D* CreateTexture2D(const eastl::string& file, bool srgb, bool streaming = false); //streamed textures should only be sampled with SampleMaterialTexture
+    eastl::unique_ptr<class TextureLoader> LoadTexture2D(const eastl::string& file, bool srgb); //thread safe, nullptr if the file failed to load
+    Texture2D* CreateTexture2D(const class TextureLoader& loader, const eastl::string& file, bool srgb, bool streaming); //not thread safe, enqueues the upload
     Texture2D* CreateTexture2D(uint32_t width, uint32_t height, uint32_t levels, GfxFormat format, GfxTextureUsageFlags flags, const eastl::string& name);
     Texture3D* CreateTexture3D(const eastl::string& file, bool srgb);
     Texture3D* CreateTexture3D(uint32_t width, uint32_t height, uint32_t depth, uint32_t levels, GfxFormat format, GfxTextureUsageFlags flags, const eastl::string& name);
@@ -110,7 +112,11 @@ public:
 
     uint32_t AllocateSceneConstant(const void* data, uint32_t size);
 
-    uint32_t AddInstance(const InstanceData& data, IGfxRayTracingBLAS* blas, GfxRayTracingInstanceFlag flags);
+    uint32_t AddSceneMaterial(const ModelMaterialConstant& data);
+    void ReleaseSceneMaterial(uint32_t index);
+    const ModelMaterialConstant* GetSceneMaterial(uint32_t index) const;
+
+    uint32_t AddInstance(const InstanceData& data, class RayTracingBLAS* blas, uint32_t instance_mask, GfxRayTracingInstanceFlag flags);
     uint32_t GetInstanceCount() const { return m_pGpuScene->GetInstanceCount(); }
 
     uint32_t AddLocalLight(const LocalLightData& data);
@@ -128,24 +134,41 @@ public:
     void SetAsyncComputeEnabled(bool value) { m_bEnableAsyncCompute = value; }
 
     void UploadTexture(IGfxTexture* texture, const void* data);
+    void UploadTexture(IGfxTexture* texture, uint32_t mip_level, uint32_t array_slice, const void* data);
+    void UpdateTileMappings(IGfxTexture* texture, IGfxHeap* heap, const eastl::vector<GfxTileMapping>& mappings); //executed before the uploads
     void UploadBuffer(IGfxBuffer* buffer, uint32_t offset, const void* data, uint32_t data_size);
-    void BuildRayTracingBLAS(IGfxRayTracingBLAS* blas);
-    void UpdateRayTracingBLAS(IGfxRayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset);
-
-    LinearAllocator* GetConstantAllocator() const { return m_cbAllocator.get(); }
-    RenderBatch& AddBasePassBatch();
-    RenderBatch& AddForwardPassBatch() { return m_forwardPassBatchs.emplace_back(*m_cbAllocator); }
-    RenderBatch& AddVelocityPassBatch() { return m_velocityPassBatchs.emplace_back(*m_cbAllocator); }
-    RenderBatch& AddObjectIDPassBatch() { return m_idPassBatchs.emplace_back(*m_cbAllocator); }
-    RenderBatch& AddGuiPassBatch() { return m_guiBatchs.emplace_back(*m_cbAllocator); }
-    ComputeBatch& AddAnimationBatch() { return m_animationBatchs.emplace_back(*m_cbAllocator); }
+    class RayTracingBLAS* CreateRayTracingBLAS(const GfxRayTracingBLASDesc& desc, const eastl::string& name); //built in the next frames
+    void ReleaseRayTracingBLAS(class RayTracingBLAS* blas);
+    //skinned blases, refitted at a rate depending on their screen size (see RayTracingSkinnedBLASUpdater)
+    void UpdateRayTracingBLAS(class RayTracingBLAS* blas, IGfxBuffer* vertex_buffer, uint32_t vertex_buffer_offset, const float3& center, float radius, bool animated);
+
+    ThreadLinearAllocator* GetConstantAllocator() const { return m_cbAllocator.get(); }
+    uint32_t GetThreadIndex() const;
+
+    //batches can be added from the task threads, they are merged at the beginning of RenderFrame
+    //sorted by (order, add sequence), so the result does not depend on the scheduling.
+    //each object should call SetBatchOrder with a unique order on its thread before adding its batches
+    void SetBatchOrder(uint32_t order);
+    RenderBatch& AddBasePassBatch() { return m_basePassThreadBatchs.Add(*m_cbAllocator, GetThreadIndex(), GetBatchKey()); }
+    RenderBatch& AddForwardPassBatch() { return m_forwardPassThreadBatchs.Add(*m_cbAllocator, GetThreadIndex(), GetBatchKey()); }
+    RenderBatch& AddVelocityPassBatch() { return m_velocityPassThreadBatchs.Add(*m_cbAllocator, GetThreadIndex(), GetBatchKey()); }
+    RenderBatch& AddObjectIDPassBatch() { return m_idPassThreadBatchs.Add(*m_cbAllocator, GetThreadIndex(), GetBatchKey()); }
+    RenderBatch& AddGuiPassBatch() { return m_guiBatchs.emplace_back(*m_cbAllocator, GetThreadIndex()); } //main thread only
+    ComputeBatch& AddAnimationBatch() { return m_animationThreadBatchs.Add(*m_cbAllocator, GetThreadIndex(), GetBatchKey()); }
+    void AddVertexSkinningJob(const struct VertexSkinningJob& job); //all jobs are skinned by one dispatch in the animation pass
 
     void SetupGlobalConstants(IGfxCommandList* pCommandList);
 
     class HZB* GetHZB() const { return m_pHZB.get(); }
+    class TextureStreamer* GetTextureStreamer() const { return m_pTextureStreamer.get(); }
+    class AsyncTextureLoader* GetAsyncTextureLoader() const { return m_pAsyncTextureLoader.get(); }
+    class RayTracingBLASBuilder* GetBLASBuilder() const { return m_pBLASBuilder.get(); }
+    class RayTracingSkinnedBLASUpdater* GetSkinnedBLASUpdater() const { return m_pSkinnedBLASUpdater.get(); }
+    class VertexSkinning* GetVertexSkinning() const { return m_pVertexSkinning.get(); }
     class BasePass* GetBassPass() const { return m_pBasePass.get(); }
     class SkyCubeMap* GetSkyCubeMap() const { return m_pSkyCubeMap.get(); }
     StagingBufferAllocator* GetStagingBufferAllocator() const;
+    class HashGridRadianceCache* GetRadianceCache() const;
 
     bool IsHistoryTextureValid() const { return m_bHistoryValid; }
     RGHandle GetPrevSceneDepthHandle() const { return m_prevSceneDepthHandle; }
@@ -166,6 +189,9 @@ private:
     void BuildRenderGraph(RGHandle& outColor, RGHandle& outDepth);
     void EndFrame();
 
+    uint64_t GetBatchKey();
+    void MergeBatches();
+
     void ForwardPass(RGHandle& color, RGHandle& depth);
     RGHandle VelocityPass(RGHandle& depth);
     RGHandle LinearizeDepthPass(RGHandle depth);
@@ -188,6 +214,11 @@ private:
     eastl::unique_ptr<class ShaderCache> m_pShaderCache;
     eastl::unique_ptr<class PipelineStateCache> m_pPipelineCache;
     eastl::unique_ptr<class GpuScene> m_pGpuScene;
+    eastl::unique_ptr<class TextureStreamer> m_pTextureStreamer; //nullptr if sparse textures are not supported
+    eastl::unique_ptr<class AsyncTextureLoader> m_pAsyncTextureLoader;
+    eastl::unique_ptr<class RayTracingBLASBuilder> m_pBLASBuilder;
+    eastl::unique_ptr<class RayTracingSkinnedBLASUpdater> m_pSkinnedBLASUpdater;
+    eastl::unique_ptr<class VertexSkinning> m_pVertexSkinning;
 
     RendererOutput m_outputType = RendererOutput::Default;
     TemporalSuperResolution m_upscaleMode = TemporalSuperResolution::None;
@@ -199,7 +230,14 @@ private:
     float m_upscaleRatio = 1.0f;
     float m_mipBias = 0.0f;
 
-    eastl::unique_ptr<LinearAllocator> m_cbAllocator;
+    eastl::unique_ptr<ThreadLinearAllocator> m_cbAllocator;
+
+    struct alignas(64) BatchOrder
+    {
+        uint32_t order = 0;
+        uint32_t sequence = 0;
+    };
+    eastl::vector<BatchOrder> m_batchOrders; //per thread
 
     eastl::unique_ptr<IGfxFence> m_pFrameFence;
     uint64_t m_nCurrentFrameFenceValue = 0;
@@ -225,6 +263,14 @@ private:
     };
     eastl::vector<TextureUpload> m_pendingTextureUploads;
 
+    struct TileMappingUpdate
+    {
+        IGfxTexture* texture;
+        IGfxHeap* heap;
+        eastl::vector<GfxTileMapping> mappings;
+    };
+    eastl::vector<TileMappingUpdate> m_pendingTileMappings;
+
     struct BufferUpload
     {
         IGfxBuffer* buffer;
@@ -233,15 +279,6 @@ private:
     };
     eastl::vector<BufferUpload> m_pendingBufferUpload;
 
-    struct BLASUpdate
-    {
-        IGfxRayTracingBLAS* blas;
-        IGfxBuffer* vertex_buffer;
-        uint32_t vertex_buffer_offset;
-    };
-    eastl::vector<BLASUpdate> m_pendingBLASUpdates;
-    eastl::vector<IGfxRayTracingBLAS*> m_pendingBLASBuilds;
-
     eastl::unique_ptr<IGfxDescriptor> m_pAniso2xSampler;
     eastl::unique_ptr<IGfxDescriptor> m_pAniso4xSampler;
     eastl::unique_ptr<IGfxDescriptor> m_pAniso8xSampler;
@@ -312,4 +349,10 @@ private:
     eastl::vector<RenderBatch> m_velocityPassBatchs;
     eastl::vector<RenderBatch> m_idPassBatchs;
     eastl::vector<RenderBatch> m_guiBatchs;
+
+    ThreadBatchList<RenderBatch> m_basePassThreadBatchs;
+    ThreadBatchList<RenderBatch> m_forwardPassThreadBatchs;
+    ThreadBatchList<RenderBatch> m_velocityPassThreadBatchs;
+    ThreadBatchList<RenderBatch> m_idPassThreadBatchs;
+    ThreadBatchList<ComputeBatch> m_animationThreadBatchs;
 };
@@ -5,9 +5,12 @@
 #include "lighting/lighting_processor.h"
 #include "post_processing/post_processor.h"
 #include "core/engine.h"
+#include "utils/profiler.h"
 
 void Renderer::BuildRenderGraph(RGHandle& outColor, RGHandle& outDepth)
 {
+    CPU_EVENT("Render", "Renderer::BuildRenderGraph");
+
     m_pRenderGraph->Clear();
 
     ImportPrevFrameTextures();
@@ -118,10 +121,9 @@ void Renderer::ForwardPass(RGHandle& color, RGHandle& depth)
         },
         [&](const ForwardPassData& data, IGfxCommandList* pCommandList)
         {
-            for (size_t i = 0; i < m_forwardPassBatchs.size(); ++i)
-            {
-                DrawBatch(pCommandList, m_forwardPassBatchs[i]);
-            }
+            //not sorted, the batches may be blended
+            float3 view_pos = Engine::GetInstance()->GetWorld()->GetCamera()->GetPosition();
+            DrawBatches(pCommandList, m_forwardPassBatchs, RenderBatchPass::Forward, view_pos, false);
         });
 
     color = forward_pass->outSceneColorRT;
@@ -152,10 +154,8 @@ RGHandle Renderer::VelocityPass(RGHandle& depth)
         },
         [&](const ObjectVelocityPassData& data, IGfxCommandList* pCommandList)
         {
-            for (size_t i = 0; i < m_velocityPassBatchs.size(); ++i)
-            {
-                DrawBatch(pCommandList, m_velocityPassBatchs[i]);
-            }
+            float3 view_pos = Engine::GetInstance()->GetWorld()->GetCamera()->GetPosition();
+            DrawBatches(pCommandList, m_velocityPassBatchs, RenderBatchPass::Velocity, view_pos);
         });
 
     struct CameraVelocityPassData
@@ -254,11 +254,7 @@ void Renderer::ObjectIDPass(RGHandle& depth)
             [&](const IDPassData& data, IGfxCommandList* pCommandList)
             {
                 World* world = Engine::GetInstance()->GetWorld();
-
-                for (size_t i = 0; i < m_idPassBatchs.size(); ++i)
-                {
-                    DrawBatch(pCommandList, m_idPassBatchs[i]);
-                }
+                DrawBatches(pCommandList, m_idPassBatchs, RenderBatchPass::ObjectID, world->GetCamera()->GetPosition());
             });
 
         depth = id_pass->sceneDepthTexture;
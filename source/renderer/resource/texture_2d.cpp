@@ -1,6 +1,7 @@
 #include "texture_2d.h"
 #include "core/engine.h"
 #include "../renderer.h"
+#include "../texture_streamer.h"
 #include "utils/system.h"
 
 Texture2D::Texture2D(const eastl::string& name)
@@ -8,7 +9,15 @@ Texture2D::Texture2D(const eastl::string& name)
     m_name = name;
 }
 
-bool Texture2D::Create(uint32_t width, uint32_t height, uint32_t levels, GfxFormat format, GfxTextureUsageFlags flags)
+Texture2D::~Texture2D()
+{
+    if (m_nStreamingIndex != GFX_INVALID_RESOURCE)
+    {
+        Engine::GetInstance()->GetRenderer()->GetTextureStreamer()->RemoveTexture(this);
+    }
+}
+
+bool Texture2D::Create(uint32_t width, uint32_t height, uint32_t levels, GfxFormat format, GfxTextureUsageFlags flags, bool sparse)
 {
     Renderer* pRenderer = Engine::GetInstance()->GetRenderer();
     IGfxDevice* pDevice = pRenderer->GetDevice();
@@ -25,6 +34,11 @@ bool Texture2D::Create(uint32_t width, uint32_t height, uint32_t levels, GfxForm
         desc.alloc_type = GfxAllocationType::Committed;
     }
 
+    if (sparse)
+    {
+        desc.alloc_type = GfxAllocationType::Sparse;
+    }
+
     m_pTexture.reset(pDevice->CreateTexture(desc, m_name));
     if (m_pTexture == nullptr)
     {
@@ -9,15 +9,21 @@ class Texture2D
 {
 public:
     Texture2D(const eastl::string& name);
+    ~Texture2D();
 
-    bool Create(uint32_t width, uint32_t height, uint32_t levels, GfxFormat format, GfxTextureUsageFlags flags);
+    //sparse textures have no memory bound, their tiles are mapped by TextureStreamer
+    bool Create(uint32_t width, uint32_t height, uint32_t levels, GfxFormat format, GfxTextureUsageFlags flags, bool sparse = false);
 
     IGfxTexture* GetTexture() const { return m_pTexture.get(); }
     IGfxDescriptor* GetSRV() const { return m_pSRV.get(); }
     IGfxDescriptor* GetUAV(uint32_t mip = 0) const;
 
+    uint32_t GetStreamingIndex() const { return m_nStreamingIndex; }
+    void SetStreamingIndex(uint32_t index) { m_nStreamingIndex = index; }
+
 protected:
     eastl::string m_name;
+    uint32_t m_nStreamingIndex = GFX_INVALID_RESOURCE;
 
     eastl::unique_ptr<IGfxTexture> m_pTexture;
     eastl::unique_ptr<IGfxDescriptor> m_pSRV;
@@ -70,6 +70,8 @@ IGfxShader* ShaderCache::GetShader(const eastl::string& file, const eastl::strin
     desc.defines = defines;
     desc.flags = flags;
 
+    std::lock_guard<std::mutex> lock(m_mutex);
+
     auto iter = m_cachedShaders.find(desc);
     if (iter != m_cachedShaders.end())
     {
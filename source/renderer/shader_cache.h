@@ -3,6 +3,7 @@
 #include "../gfx/gfx.h"
 #include "EASTL/hash_map.h"
 #include "EASTL/unique_ptr.h"
+#include <mutex>
 
 namespace eastl
 {
@@ -43,6 +44,8 @@ private:
 
 private:
     Renderer* m_pRenderer;
+    std::mutex m_mutex; //materials may create their shaders from the worker threads
+
     eastl::hash_map<GfxShaderDesc, eastl::unique_ptr<IGfxShader>> m_cachedShaders;
     eastl::hash_map<eastl::string, eastl::string> m_cachedFile;
 };
\ No newline at end of file
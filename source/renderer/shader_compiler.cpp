@@ -75,6 +75,9 @@ ShaderCompiler::ShaderCompiler(Renderer* pRenderer) : m_pRenderer(pRenderer)
 {
 #if RE_PLATFORM_WINDOWS
     HMODULE dxc = LoadLibrary(L"dxcompiler.dll");
+#elif RE_PLATFORM_LINUX
+    eastl::string lib = Engine::GetInstance()->GetWorkPath() + "libdxcompiler.so";
+    void* dxc = dlopen(lib.c_str(), RTLD_LAZY);
 #else
     eastl::string lib = Engine::GetInstance()->GetWorkPath() + "libdxcompiler.dylib";
     void* dxc = dlopen(lib.c_str(), RTLD_LAZY);
@@ -145,6 +148,19 @@ bool ShaderCompiler::Compile(const eastl::string& source, const eastl::string& f
     GfxShaderType type, const eastl::vector<eastl::string>& defines, GfxShaderCompilerFlags flags,
     eastl::vector<uint8_t>& output_blob)
 {
+    if (m_pDxcCompiler == nullptr)
+    {
+        //the mock backend never consumes shader bytecode, so headless runs don't require dxc
+        if (m_pRenderer->GetDevice()->GetDesc().backend == GfxRenderBackend::Mock)
+        {
+            output_blob.clear();
+            return true;
+        }
+
+        RE_ERROR("[ShaderCompiler] dxc is not loaded, failed to compile shader : {}, {}", file, entry_point);
+        return false;
+    }
+
     DxcBuffer sourceBuffer;
     sourceBuffer.Ptr = source.data();
     sourceBuffer.Size = source.length();
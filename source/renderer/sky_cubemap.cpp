@@ -2,6 +2,7 @@
 #include "renderer.h"
 #include "core/engine.h"
 #include "utils/gui_util.h"
+#include "utils/fmt.h"
 #include "ImFileDialog/ImFileDialog.h"
 
 #define A_CPU
@@ -25,14 +26,23 @@ SkyCubeMap::SkyCubeMap(Renderer* pRenderer)
     desc.cs = pRenderer->GetShader("ibl_prefilter.hlsl", "specular_filter", GfxShaderType::CS);
     m_pSpecularFilterPSO = pRenderer->GetPipelineState(desc, "IBL specular PSO");
 
-    desc.cs = pRenderer->GetShader("ibl_prefilter.hlsl", "diffuse_filter", GfxShaderType::CS);
-    m_pDiffuseFilterPSO = pRenderer->GetPipelineState(desc, "IBL diffuse PSO");
+    desc.cs = pRenderer->GetShader("ibl_prefilter.hlsl", "diffuse_sh", GfxShaderType::CS);
+    m_pDiffuseSHPSO = pRenderer->GetPipelineState(desc, "IBL diffuse SH PSO");
 
-    m_pTexture.reset(pRenderer->CreateTextureCube(128, 128, 8, GfxFormat::R11G11B10F, GfxTextureUsageUnorderedAccess, "SkyCubeMap::m_pTexture"));
-    m_pSpecularTexture.reset(pRenderer->CreateTextureCube(128, 128, 8, GfxFormat::R11G11B10F, GfxTextureUsageUnorderedAccess, "SkyCubeMap::m_pSpecularTexture"));
-    m_pDiffuseTexture.reset(pRenderer->CreateTextureCube(128, 128, 1, GfxFormat::R11G11B10F, GfxTextureUsageUnorderedAccess, "SkyCubeMap::m_pDiffuseTexture"));
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        OutputSet& set = m_sets[i];
+        set.cube.reset(pRenderer->CreateTextureCube(128, 128, 8, GfxFormat::R11G11B10F, GfxTextureUsageUnorderedAccess, fmt::format("SkyCubeMap::m_sets[{}].cube", i).c_str()));
+        set.specular.reset(pRenderer->CreateTextureCube(128, 128, 8, GfxFormat::R11G11B10F, GfxTextureUsageUnorderedAccess, fmt::format("SkyCubeMap::m_sets[{}].specular", i).c_str()));
+        set.diffuseSH.reset(pRenderer->CreateStructuredBuffer(nullptr, sizeof(float4), 9, fmt::format("SkyCubeMap::m_sets[{}].diffuseSH", i).c_str(), GfxMemoryType::GpuOnly, true));
+    }
+
+    m_pHDRITexture.reset(pRenderer->CreateTexture2D(GetDefaultHDRI(), false));
+}
 
-    m_pHDRITexture.reset(pRenderer->CreateTexture2D(Engine::GetInstance()->GetAssetPath() + "textures/hdri/rural_landscape_1k.hdr", false));
+eastl::string SkyCubeMap::GetDefaultHDRI()
+{
+    return Engine::GetInstance()->GetAssetPath() + "textures/hdri/rural_landscape_1k.hdr";
 }
 
 void SkyCubeMap::OnGui()
@@ -42,6 +52,7 @@ void SkyCubeMap::OnGui()
         if (ImGui::Combo("Source##SkyCubeMap", (int*)&m_source, "Realtime\0HDRI\0\0"))
         {
             m_bDirty = true;
+            m_bBuilding = false; //restarts at once, the back set is left in a valid state after each step
         }
 
         if (ifd::FileDialog::Instance().IsDone("Select HDRI"))
@@ -52,6 +63,7 @@ void SkyCubeMap::OnGui()
                 m_pHDRITexture.reset(m_pRenderer->CreateTexture2D(file, false));
 
                 m_bDirty = true;
+                m_bBuilding = false;
             }
             ifd::FileDialog::Instance().Close();
         }
@@ -65,14 +77,24 @@ void SkyCubeMap::OnGui()
         {
             ifd::FileDialog::Instance().Open("Select HDRI", "Select HDRI", "HDRI file (*.hdr){.hdr},.*");
         }
+
+        ImGui::Checkbox("Incremental Update##SkyCubeMap", &m_bIncrementalUpdate);
+        ImGui::SliderFloat("Budget (M samples/frame)##SkyCubeMap", &m_stepBudget, 0.5f, 16.0f, "%.1f");
+
+        if (m_bBuilding)
+        {
+            ImGui::Text("Building : step %u/%u", m_nStep, GetStepCount());
+        }
+        ImGui::Text("Last update took %u frames", m_nLastBuildFrames);
     }
 }
 
 void SkyCubeMap::Update(IGfxCommandList* pCommandList)
 {
+    ILight* light = Engine::GetInstance()->GetWorld()->GetPrimaryLight();
+
     if (m_source == SkySource::Realtime)
     {
-        ILight* light = Engine::GetInstance()->GetWorld()->GetPrimaryLight();
         if (m_prevLightDir != light->GetLightDirection() ||
             m_prevLightColor != light->GetLightColor() ||
             m_prevLightIntensity != light->GetLightIntensity())
@@ -84,42 +106,142 @@ void SkyCubeMap::Update(IGfxCommandList* pCommandList)
         }
     }
 
-    if (m_bDirty)
+    //a change during a build is picked up by the next one, so a moving sun still gets published regularly
+    if (m_bDirty && !m_bBuilding)
     {
         m_bDirty = false;
+        m_bBuilding = true;
+        m_nStep = 0;
+        m_nBuildFrames = 0;
 
-        GPU_EVENT(pCommandList, "SkyCubeMap");
+        //the first build fills the published set in place, nothing was rendered with it yet
+        m_bImmediate = !m_bIncrementalUpdate || m_source == SkySource::HDRI || !m_sets[m_nCurrentSet].initialized;
+        m_nTargetSet = m_bImmediate ? m_nCurrentSet : 1 - m_nCurrentSet;
 
-        UpdateCubeTexture(pCommandList);
+        m_buildLightDir = light->GetLightDirection();
+        m_buildLightColor = light->GetLightColor() * light->GetLightIntensity();
+    }
 
-        bool first_frame = m_pRenderer->GetFrameID() == 0;
-        if (!first_frame)
-        {
-            pCommandList->TextureBarrier(m_pSpecularTexture->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessMaskSRV, GfxAccessComputeUAV);
-            pCommandList->TextureBarrier(m_pDiffuseTexture->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessMaskSRV, GfxAccessComputeUAV);
-        }
+    if (!m_bBuilding)
+    {
+        return;
+    }
 
-        UpdateSpecularCubeTexture(pCommandList);
-        UpdateDiffuseCubeTexture(pCommandList);
+    GPU_EVENT(pCommandList, "SkyCubeMap");
+
+    OutputSet& set = m_sets[m_nTargetSet];
+    if (!set.initialized)
+    {
+        InitializeSet(pCommandList, set);
+    }
 
-        pCommandList->TextureBarrier(m_pSpecularTexture->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessComputeUAV, GfxAccessMaskSRV);
-        pCommandList->TextureBarrier(m_pDiffuseTexture->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessComputeUAV, GfxAccessMaskSRV);
+    uint32_t step_count = GetStepCount();
+    float budget = m_stepBudget;
+
+    do
+    {
+        budget -= GetStepCost(m_nStep);
+        ExecuteStep(pCommandList, m_nStep++);
+    } while (m_nStep < step_count && (m_bImmediate || GetStepCost(m_nStep) <= budget));
+
+    m_nBuildFrames++;
+
+    if (m_nStep == step_count)
+    {
+        m_nCurrentSet = m_nTargetSet;
+        m_bBuilding = false;
+        m_nLastBuildFrames = m_nBuildFrames;
     }
 }
 
-void SkyCubeMap::UpdateCubeTexture(IGfxCommandList* pCommandList)
+//steps : 6 cube faces, the cube mips, one step per specular mip, the diffuse SH
+uint32_t SkyCubeMap::GetStepCount() const
 {
-    GPU_EVENT(pCommandList, "Generate SkyCubeMap");
+    return 6 + 1 + m_sets[0].specular->GetTexture()->GetDesc().mip_levels + 1;
+}
+
+float SkyCubeMap::GetStepCost(uint32_t step) const
+{
+    const GfxTextureDesc& desc = m_sets[0].cube->GetTexture()->GetDesc();
+    const uint32_t size = desc.width;
+    const uint32_t specular_mips = m_sets[0].specular->GetTexture()->GetDesc().mip_levels;
 
-    bool first_frame = m_pRenderer->GetFrameID() == 0;
-    if (!first_frame)
+    float samples;
+    if (step < 6)
     {
-        pCommandList->TextureBarrier(m_pTexture->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessMaskSRV, GfxAccessComputeUAV);
+        samples = size * size * (m_source == SkySource::Realtime ? 64.0f : 1.0f); //64 scattering steps
     }
+    else if (step == 6)
+    {
+        samples = size * size * 6 * 4.0f / 3.0f;
+    }
+    else if (step < 7 + specular_mips)
+    {
+        uint32_t mip = step - 7;
+        uint32_t mip_size = eastl::max(size >> mip, 1u);
+        samples = mip_size * mip_size * 6 * (mip == 0 ? 1.0f : 64.0f); //64 GGX samples
+    }
+    else
+    {
+        uint32_t mip_size = eastl::max(size >> 2, 1u);
+        samples = mip_size * mip_size * 6.0f;
+    }
+
+    return samples / 1000000.0f;
+}
+
+void SkyCubeMap::ExecuteStep(IGfxCommandList* pCommandList, uint32_t step)
+{
+    const uint32_t specular_mips = m_sets[0].specular->GetTexture()->GetDesc().mip_levels;
+
+    if (step < 6)
+    {
+        UpdateCubeFace(pCommandList, step);
+    }
+    else if (step == 6)
+    {
+        GenerateCubeMips(pCommandList);
+    }
+    else if (step < 7 + specular_mips)
+    {
+        UpdateSpecularMip(pCommandList, step - 7);
+    }
+    else
+    {
+        UpdateDiffuseSH(pCommandList);
+    }
+}
+
+//between steps, every resource of a set is kept in the SRV state
+void SkyCubeMap::InitializeSet(IGfxCommandList* pCommandList, OutputSet& set)
+{
+    pCommandList->TextureBarrier(set.cube->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessComputeUAV, GfxAccessMaskSRV);
+    pCommandList->TextureBarrier(set.specular->GetTexture(), GFX_ALL_SUB_RESOURCE, GfxAccessComputeUAV, GfxAccessMaskSRV);
+    pCommandList->BufferBarrier(set.diffuseSH->GetBuffer(), GfxAccessComputeUAV, GfxAccessMaskSRV);
+
+    set.initialized = true;
+}
+
+static void CubeMipBarrier(IGfxCommandList* pCommandList, IGfxTexture* texture, uint32_t mip, GfxAccessFlags access_before, GfxAccessFlags access_after)
+{
+    for (uint32_t slice = 0; slice < 6; ++slice)
+    {
+        uint32_t subresource = CalcSubresource(texture->GetDesc(), mip, slice);
+        pCommandList->TextureBarrier(texture, subresource, access_before, access_after);
+    }
+}
+
+void SkyCubeMap::UpdateCubeFace(IGfxCommandList* pCommandList, uint32_t face)
+{
+    GPU_EVENT(pCommandList, fmt::format("Generate SkyCubeMap face {}", face).c_str());
+
+    TextureCube* texture = m_sets[m_nTargetSet].cube.get();
+    uint32_t subresource = CalcSubresource(texture->GetTexture()->GetDesc(), 0, face);
+    pCommandList->TextureBarrier(texture->GetTexture(), subresource, GfxAccessMaskSRV, GfxAccessComputeUAV);
 
     pCommandList->SetPipelineState(m_source == SkySource::Realtime ? m_pRealtimeSkyPSO : m_pTexturedSkyPSO);
 
-    struct CB
+    struct CB0
     {
         uint cubeTextureUAV;
         uint cubeTextureSize;
@@ -127,22 +249,41 @@ void SkyCubeMap::UpdateCubeTexture(IGfxCommandList* pCommandList)
         uint hdriTexture;
     };
 
-    uint32_t size = m_pTexture->GetTexture()->GetDesc().width;
+    struct CB1
+    {
+        float3 lightDir; //of the build, faces updated on different frames see the same sun
+        uint face;
+        float3 lightColor;
+        uint _padding;
+    };
 
-    CB cb = { m_pTexture->GetUAV(0)->GetHeapIndex(), size, 1.0f / size, m_pHDRITexture->GetSRV()->GetHeapIndex() };
-    pCommandList->SetComputeConstants(0, &cb, sizeof(cb));
-    pCommandList->Dispatch(DivideRoudingUp(size, 8), DivideRoudingUp(size, 8), 6);
+    uint32_t size = texture->GetTexture()->GetDesc().width;
 
-    const GfxTextureDesc& textureDesc = m_pTexture->GetTexture()->GetDesc();
+    CB0 cb0 = { texture->GetUAV(0)->GetHeapIndex(), size, 1.0f / size, m_pHDRITexture->GetSRV()->GetHeapIndex() };
+    pCommandList->SetComputeConstants(0, &cb0, sizeof(cb0));
 
-    for (uint32_t slice = 0; slice < 6; ++slice)
+    CB1 cb1 = { m_buildLightDir, face, m_buildLightColor, 0 };
+    pCommandList->SetComputeConstants(1, &cb1, sizeof(cb1));
+    pCommandList->Dispatch(DivideRoudingUp(size, 8), DivideRoudingUp(size, 8), 1);
+
+    pCommandList->TextureBarrier(texture->GetTexture(), subresource, GfxAccessComputeUAV, GfxAccessMaskSRV);
+}
+
+void SkyCubeMap::GenerateCubeMips(IGfxCommandList* pCommandList)
+{
+    //needed in specular filtering
+    //todo : sometimes the last mip is zero, check it again later
+    GPU_EVENT(pCommandList, "Generate SkyCubeMap mips");
+
+    TextureCube* texture = m_sets[m_nTargetSet].cube.get();
+    const GfxTextureDesc& textureDesc = texture->GetTexture()->GetDesc();
+    uint32_t size = textureDesc.width;
+
+    for (uint32_t mip = 1; mip < textureDesc.mip_levels; ++mip)
     {
-        uint32_t subresource = CalcSubresource(textureDesc, 0, slice);
-        pCommandList->TextureBarrier(m_pTexture->GetTexture(), subresource, GfxAccessComputeUAV, GfxAccessComputeSRV);
+        CubeMipBarrier(pCommandList, texture->GetTexture(), mip, GfxAccessMaskSRV, GfxAccessComputeUAV);
     }
 
-    //generate mipmaps, needed in specular filtering
-    //todo : sometimes the last mip is zero, check it again later
     pCommandList->SetPipelineState(m_pGenerateMipsPSO);
 
     varAU2(dispatchThreadGroupCountXY);
@@ -173,12 +314,12 @@ void SkyCubeMap::UpdateCubeTexture(IGfxCommandList* pCommandList)
     constants.invInputSize[0] = 1.0f / size;
     constants.invInputSize[1] = 1.0f / size;
 
-    constants.c_imgSrc = m_pTexture->GetArraySRV()->GetHeapIndex();
+    constants.c_imgSrc = texture->GetArraySRV()->GetHeapIndex();
     constants.c_spdGlobalAtomicUAV = m_pRenderer->GetSPDCounterBuffer()->GetUAV()->GetHeapIndex();
 
     for (uint32_t i = 0; i < textureDesc.mip_levels - 1; ++i)
     {
-        constants.c_imgDst[i].x = m_pTexture->GetUAV(i + 1)->GetHeapIndex();
+        constants.c_imgDst[i].x = texture->GetUAV(i + 1)->GetHeapIndex();
     }
 
     pCommandList->SetComputeConstants(1, &constants, sizeof(constants));
@@ -188,54 +329,57 @@ void SkyCubeMap::UpdateCubeTexture(IGfxCommandList* pCommandList)
     uint32_t dispatchZ = 6; //array slice
     pCommandList->Dispatch(dispatchX, dispatchY, dispatchZ);
 
-    for (uint32_t slice = 0; slice < 6; ++slice)
+    for (uint32_t mip = 1; mip < textureDesc.mip_levels; ++mip)
     {
-        for (uint32_t mip = 1; mip < textureDesc.mip_levels; ++mip)
-        {
-            uint32_t subresource = CalcSubresource(textureDesc, mip, slice);
-            pCommandList->TextureBarrier(m_pTexture->GetTexture(), subresource, GfxAccessComputeUAV, GfxAccessMaskSRV);
-        }
+        CubeMipBarrier(pCommandList, texture->GetTexture(), mip, GfxAccessComputeUAV, GfxAccessMaskSRV);
     }
 }
 
-void SkyCubeMap::UpdateSpecularCubeTexture(IGfxCommandList* pCommandList)
+void SkyCubeMap::UpdateSpecularMip(IGfxCommandList* pCommandList, uint32_t mip)
 {
-    GPU_EVENT(pCommandList, "IBL specular filter");
+    GPU_EVENT(pCommandList, fmt::format("IBL specular filter mip {}", mip).c_str());
+
+    TextureCube* texture = m_sets[m_nTargetSet].cube.get();
+    TextureCube* specularTexture = m_sets[m_nTargetSet].specular.get();
+    const GfxTextureDesc& textureDesc = specularTexture->GetTexture()->GetDesc();
+
+    CubeMipBarrier(pCommandList, specularTexture->GetTexture(), mip, GfxAccessMaskSRV, GfxAccessComputeUAV);
 
     pCommandList->SetPipelineState(m_pSpecularFilterPSO);
 
-    const GfxTextureDesc& textureDesc = m_pSpecularTexture->GetTexture()->GetDesc();
-    for (uint32_t i = 0; i < textureDesc.mip_levels; ++i)
-    {
-        uint32_t cb[5] = {
-            i == 0 ? m_pTexture->GetArraySRV()->GetHeapIndex() : m_pTexture->GetSRV()->GetHeapIndex(),
-            m_pSpecularTexture->GetUAV(i)->GetHeapIndex(), 
-            textureDesc.width,
-            i,
-            textureDesc.mip_levels
-        };
-        pCommandList->SetComputeConstants(0, cb, sizeof(cb));
+    uint32_t cb[5] = {
+        mip == 0 ? texture->GetArraySRV()->GetHeapIndex() : texture->GetSRV()->GetHeapIndex(),
+        specularTexture->GetUAV(mip)->GetHeapIndex(),
+        textureDesc.width,
+        mip,
+        textureDesc.mip_levels
+    };
+    pCommandList->SetComputeConstants(0, cb, sizeof(cb));
 
-        uint32_t size = textureDesc.width >> i;
-        pCommandList->Dispatch(DivideRoudingUp(size, 8), DivideRoudingUp(size, 8), 6);
-    }
+    uint32_t size = eastl::max(textureDesc.width >> mip, 1u);
+    pCommandList->Dispatch(DivideRoudingUp(size, 8), DivideRoudingUp(size, 8), 6);
+
+    CubeMipBarrier(pCommandList, specularTexture->GetTexture(), mip, GfxAccessComputeUAV, GfxAccessMaskSRV);
 }
 
-void SkyCubeMap::UpdateDiffuseCubeTexture(IGfxCommandList* pCommandList)
+void SkyCubeMap::UpdateDiffuseSH(IGfxCommandList* pCommandList)
 {
-    GPU_EVENT(pCommandList, "IBL diffuse filter");
+    GPU_EVENT(pCommandList, "IBL diffuse SH");
 
-    bool first_frame = m_pRenderer->GetFrameID() == 0;
-    if (!first_frame)
-    {
-    }
+    TextureCube* texture = m_sets[m_nTargetSet].cube.get();
+    StructuredBuffer* shBuffer = m_sets[m_nTargetSet].diffuseSH.get();
+    const GfxTextureDesc& textureDesc = texture->GetTexture()->GetDesc();
 
-    pCommandList->SetPipelineState(m_pDiffuseFilterPSO);
+    pCommandList->BufferBarrier(shBuffer->GetBuffer(), GfxAccessMaskSRV, GfxAccessComputeUAV);
 
-    const GfxTextureDesc& textureDesc = m_pSpecularTexture->GetTexture()->GetDesc();
-    uint32_t size = textureDesc.width;
+    pCommandList->SetPipelineState(m_pDiffuseSHPSO);
+
+    //irradiance is low frequency, a 32x32 mip is plenty for L2 SH
+    uint32_t mip = eastl::min(2u, textureDesc.mip_levels - 1);
 
-    uint32_t cb[3] = { m_pTexture->GetSRV()->GetHeapIndex(), m_pDiffuseTexture->GetUAV(0)->GetHeapIndex(), size };
+    uint32_t cb[5] = { texture->GetArraySRV()->GetHeapIndex(), shBuffer->GetUAV()->GetHeapIndex(), textureDesc.width, mip, textureDesc.mip_levels };
     pCommandList->SetComputeConstants(0, cb, sizeof(cb));
-    pCommandList->Dispatch(DivideRoudingUp(size, 8), DivideRoudingUp(size, 8), 6);
+    pCommandList->Dispatch(1, 1, 1);
+
+    pCommandList->BufferBarrier(shBuffer->GetBuffer(), GfxAccessComputeUAV, GfxAccessMaskSRV);
 }
@@ -3,24 +3,43 @@
 #include "render_graph.h"
 #include "resource/texture_2d.h"
 #include "resource/texture_cube.h"
-#include "resource/typed_buffer.h"
+#include "resource/structured_buffer.h"
 
+//the sky cubemap, its prefiltered specular mips and the diffuse irradiance as L2 SH.
+//the outputs are double buffered : the realtime sky is rebuilt a few steps per frame into the back set,
+//which is only published once complete, so consumers never see a half updated cubemap
 class SkyCubeMap
 {
 public:
     SkyCubeMap(Renderer* pRenderer);
 
+    static eastl::string GetDefaultHDRI();
+
     void OnGui();
     void Update(IGfxCommandList* pCommandList);
 
-    TextureCube* GetCubeTexture() const { return m_pTexture.get(); }
-    TextureCube* GetSpecularCubeTexture() const { return m_pSpecularTexture.get(); }
-    TextureCube* GetDiffuseCubeTexture() const { return m_pDiffuseTexture.get(); }
+    TextureCube* GetCubeTexture() const { return m_sets[m_nCurrentSet].cube.get(); }
+    TextureCube* GetSpecularCubeTexture() const { return m_sets[m_nCurrentSet].specular.get(); }
+    StructuredBuffer* GetDiffuseSHBuffer() const { return m_sets[m_nCurrentSet].diffuseSH.get(); } //9 float4, irradiance / PI
 
 private:
-    void UpdateCubeTexture(IGfxCommandList* pCommandList);
-    void UpdateSpecularCubeTexture(IGfxCommandList* pCommandList);
-    void UpdateDiffuseCubeTexture(IGfxCommandList* pCommandList);
+    struct OutputSet
+    {
+        eastl::unique_ptr<TextureCube> cube;
+        eastl::unique_ptr<TextureCube> specular;
+        eastl::unique_ptr<StructuredBuffer> diffuseSH;
+        bool initialized = false; //resources are in their initial UAV state until the first step
+    };
+
+    uint32_t GetStepCount() const;
+    float GetStepCost(uint32_t step) const; //in million samples, a rough estimate of its gpu time
+    void ExecuteStep(IGfxCommandList* pCommandList, uint32_t step);
+
+    void InitializeSet(IGfxCommandList* pCommandList, OutputSet& set);
+    void UpdateCubeFace(IGfxCommandList* pCommandList, uint32_t face);
+    void GenerateCubeMips(IGfxCommandList* pCommandList);
+    void UpdateSpecularMip(IGfxCommandList* pCommandList, uint32_t mip);
+    void UpdateDiffuseSH(IGfxCommandList* pCommandList);
 
 private:
     Renderer* m_pRenderer;
@@ -28,12 +47,13 @@ private:
     IGfxPipelineState* m_pRealtimeSkyPSO = nullptr;
     IGfxPipelineState* m_pGenerateMipsPSO = nullptr;
     IGfxPipelineState* m_pSpecularFilterPSO = nullptr;
-    IGfxPipelineState* m_pDiffuseFilterPSO = nullptr;
+    IGfxPipelineState* m_pDiffuseSHPSO = nullptr;
 
     eastl::unique_ptr<Texture2D> m_pHDRITexture;
-    eastl::unique_ptr<TextureCube> m_pTexture;
-    eastl::unique_ptr<TextureCube> m_pSpecularTexture;
-    eastl::unique_ptr<TextureCube> m_pDiffuseTexture;
+
+    OutputSet m_sets[2];
+    uint32_t m_nCurrentSet = 0; //the published one
+    uint32_t m_nTargetSet = 0;  //the one being built
 
     enum class SkySource
     {
@@ -47,4 +67,16 @@ private:
     float3 m_prevLightDir;
     float3 m_prevLightColor;
     float m_prevLightIntensity = 0.0f;
-};
\ No newline at end of file
+
+    //the build in progress
+    bool m_bBuilding = false;
+    bool m_bImmediate = false; //all steps in one frame, in place
+    uint32_t m_nStep = 0;
+    uint32_t m_nBuildFrames = 0;
+    float3 m_buildLightDir;
+    float3 m_buildLightColor;
+
+    bool m_bIncrementalUpdate = true;
+    float m_stepBudget = 2.0f; //million samples per frame, at least one step runs each frame
+    uint32_t m_nLastBuildFrames = 0;
+};
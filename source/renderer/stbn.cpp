@@ -1,86 +1,154 @@
 #include "stbn.h"
 #include "renderer.h"
+#include "baked_asset_cache.h"
 #include "texture_loader.h"
 #include "utils/fmt.h"
-#include "utils/memory.h"
+#include "utils/log.h"
+#include "utils/parallel_for.h"
+#include "EASTL/atomic.h"
+#include <filesystem>
 
-STBN::STBN(Renderer* renderer)
+static const uint32_t STBN_VERSION = 1;
+static const uint32_t STBN_SIZE = 128;
+static const uint32_t STBN_SLICES = 64;
+
+static const uint32_t SCALAR_SLICE_SIZE = STBN_SIZE * STBN_SIZE;
+static const uint32_t VEC3_SLICE_SIZE = STBN_SIZE * STBN_SIZE * 4;
+static const uint32_t VEC2_SLICE_SIZE = STBN_SIZE * STBN_SIZE * 2;
+
+static const uint32_t SCALAR_OFFSET = 0;
+static const uint32_t VEC3_OFFSET = SCALAR_OFFSET + SCALAR_SLICE_SIZE * STBN_SLICES;
+static const uint32_t VEC2_OFFSET = VEC3_OFFSET + VEC3_SLICE_SIZE * STBN_SLICES;
+static const uint32_t STBN_DATA_SIZE = VEC2_OFFSET + VEC2_SLICE_SIZE * STBN_SLICES;
+
+static eastl::string GetSliceFile(const eastl::string& path, uint32_t type, uint32_t slice)
 {
-    m_renderer = renderer;
+    switch (type)
+    {
+    case 0:
+        return fmt::format("{}stbn_scalar_2Dx1Dx1D_128x128x64x1_{}.png", path.c_str(), slice).c_str();
+    case 1:
+        return fmt::format("{}stbn_vec3_2Dx1D_128x128x64_{}.png", path.c_str(), slice).c_str();
+    default:
+        return fmt::format("{}stbn_vec2_2Dx1D_128x128x64_{}.png", path.c_str(), slice).c_str();
+    }
 }
 
-void STBN::Load(const eastl::string& path)
+//changes if any slice is edited
+static uint64_t GetVersion(const eastl::string& path)
 {
-    uint8_t* data = nullptr;
-
-    // scalar
-    for (uint32_t i = 0; i < 64; ++i)
+    eastl::string text;
+    for (uint32_t type = 0; type < 3; ++type)
     {
-        TextureLoader loader;
-        loader.Load(fmt::format("{}stbn_scalar_2Dx1Dx1D_128x128x64x1_{}.png", path.c_str(), i).c_str(), false);
-
-        if (i == 0)
+        for (uint32_t i = 0; i < STBN_SLICES; ++i)
         {
-            data = (uint8_t*)RE_ALLOC(loader.GetDataSize() * 64);
-        }
+            eastl::string file = GetSliceFile(path, type, i);
 
-        memcpy(data + loader.GetDataSize() * i, loader.GetData(), loader.GetDataSize());
-    }
+            std::error_code error;
+            uint64_t size = std::filesystem::file_size(file.c_str(), error);
+            uint64_t time = std::filesystem::last_write_time(file.c_str(), error).time_since_epoch().count();
 
-    m_scalarTexture.reset(m_renderer->CreateTexture2DArray(128, 128, 1, 64, GfxFormat::R8UNORM, 0, "STBN scalar"));
-    if (m_scalarTexture)
-    {
-        m_renderer->UploadTexture(m_scalarTexture->GetTexture(), data);
+            text += fmt::format("{} {} {};", file.c_str(), size, time).c_str();
+        }
     }
+    return BakedAssetCache::MakeVersion(text, STBN_VERSION);
+}
 
-    // vec3
-    for (uint32_t i = 0; i < 64; ++i)
-    {
-        TextureLoader loader;
-        loader.Load(fmt::format("{}stbn_vec3_2Dx1D_128x128x64_{}.png", path.c_str(), i).c_str(), false);
+STBN::STBN(Renderer* renderer)
+{
+    m_renderer = renderer;
+}
 
-        if (i == 0)
-        {
-            data = (uint8_t*)RE_REALLOC(data, loader.GetDataSize() * 64);
-        }
+void STBN::Load(const eastl::string& path, const BakedAssetCache* cache)
+{
+    uint64_t version = GetVersion(path);
 
-        memcpy(data + loader.GetDataSize() * i, loader.GetData(), loader.GetDataSize());
+    m_bBaked = cache->Load("stbn", version, m_data) && m_data.size() == STBN_DATA_SIZE;
+    if (m_bBaked)
+    {
+        return;
     }
 
-    m_vec3Texture.reset(m_renderer->CreateTexture2DArray(128, 128, 1, 64, GfxFormat::RGBA8UNORM, 0, "STBN vec3"));
-    if (m_vec3Texture)
+    if (Decode(path))
     {
-        m_renderer->UploadTexture(m_vec3Texture->GetTexture(), data);
+        cache->Save("stbn", version, m_data.data(), m_data.size());
     }
+}
 
-    // vec2
-    for (uint32_t i = 0; i < 64; ++i)
-    {
-        TextureLoader loader;
-        loader.Load(fmt::format("{}stbn_vec2_2Dx1D_128x128x64_{}.png", path.c_str(), i).c_str(), false);
+bool STBN::Decode(const eastl::string& path)
+{
+    m_data.resize(STBN_DATA_SIZE);
 
-        uint32_t sliceSize = loader.GetDataSize() / 2;
+    eastl::atomic<uint32_t> failures = 0;
 
-        if (i == 0)
+    //the 192 slices are decoded in parallel, each one writes its own part of m_data
+    ParallelFor(STBN_SLICES * 3, [&](uint32_t index)
         {
-            data = (uint8_t*)RE_REALLOC(data, sliceSize * 64);
-        }
+            uint32_t type = index / STBN_SLICES;
+            uint32_t slice = index % STBN_SLICES;
+
+            TextureLoader loader;
+            if (!loader.Load(GetSliceFile(path, type, slice), false) ||
+                loader.GetWidth() != STBN_SIZE || loader.GetHeight() != STBN_SIZE)
+            {
+                failures++;
+                return;
+            }
+
+            switch (type)
+            {
+            case 0:
+                memcpy(m_data.data() + SCALAR_OFFSET + SCALAR_SLICE_SIZE * slice, loader.GetData(), SCALAR_SLICE_SIZE);
+                break;
+            case 1:
+                memcpy(m_data.data() + VEC3_OFFSET + VEC3_SLICE_SIZE * slice, loader.GetData(), VEC3_SLICE_SIZE);
+                break;
+            default:
+            {
+                uint8_t* dst = m_data.data() + VEC2_OFFSET + VEC2_SLICE_SIZE * slice;
+                const byte4* src = (const byte4*)loader.GetData();
+
+                // rgba8 -> rg8
+                for (uint32_t j = 0; j < STBN_SIZE * STBN_SIZE; ++j)
+                {
+                    dst[j * 2 + 0] = src[j].x;
+                    dst[j * 2 + 1] = src[j].y;
+                }
+                break;
+            }
+            }
+        });
+
+    if (failures > 0)
+    {
+        RE_WARN("[STBN] failed to load {} slices from {}", failures.load(), path);
+        return false;
+    }
+    return true;
+}
 
-        byte4* srcData = (byte4*)loader.GetData();
+void STBN::CreateTextures()
+{
+    m_data.resize(STBN_DATA_SIZE); //all zero if the slices failed to load
 
-        // rgba8 -> rg8
-        for (uint32_t j = 0; j < loader.GetWidth() * loader.GetHeight(); ++j)
-        {
-            data[sliceSize * i + j * 2 + 0] = srcData[j].x;
-            data[sliceSize * i + j * 2 + 1] = srcData[j].y;
-        }
+    m_scalarTexture.reset(m_renderer->CreateTexture2DArray(STBN_SIZE, STBN_SIZE, 1, STBN_SLICES, GfxFormat::R8UNORM, 0, "STBN scalar"));
+    if (m_scalarTexture)
+    {
+        m_renderer->UploadTexture(m_scalarTexture->GetTexture(), m_data.data() + SCALAR_OFFSET);
+    }
+
+    m_vec3Texture.reset(m_renderer->CreateTexture2DArray(STBN_SIZE, STBN_SIZE, 1, STBN_SLICES, GfxFormat::RGBA8UNORM, 0, "STBN vec3"));
+    if (m_vec3Texture)
+    {
+        m_renderer->UploadTexture(m_vec3Texture->GetTexture(), m_data.data() + VEC3_OFFSET);
     }
 
-    m_vec2Texture.reset(m_renderer->CreateTexture2DArray(128, 128, 1, 64, GfxFormat::RG8UNORM, 0, "STBN vec2"));
+    m_vec2Texture.reset(m_renderer->CreateTexture2DArray(STBN_SIZE, STBN_SIZE, 1, STBN_SLICES, GfxFormat::RG8UNORM, 0, "STBN vec2"));
     if (m_vec2Texture)
     {
-        m_renderer->UploadTexture(m_vec2Texture->GetTexture(), data);
+        m_renderer->UploadTexture(m_vec2Texture->GetTexture(), m_data.data() + VEC2_OFFSET);
     }
 
-    RE_FREE(data);
+    m_data.clear();
+    m_data.shrink_to_fit();
 }
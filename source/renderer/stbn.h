@@ -2,19 +2,32 @@
 
 #include "resource/texture_2d_array.h"
 
+class BakedAssetCache;
+
 class STBN
 {
 public:
     STBN(Renderer* renderer);
-    void Load(const eastl::string& path);
+
+    //reads the baked blob, or decodes the slices in parallel and bakes them. can run on a task thread
+    void Load(const eastl::string& path, const BakedAssetCache* cache);
+    void CreateTextures();
+
+    bool IsBaked() const { return m_bBaked; } //true if it was read from the cache
 
     IGfxDescriptor* GetScalarTextureSRV() const { return m_scalarTexture->GetSRV(); }
     IGfxDescriptor* GetVec2TextureSRV() const { return m_vec2Texture->GetSRV(); }
     IGfxDescriptor* GetVec3TextureSRV() const { return m_vec3Texture->GetSRV(); }
 
+private:
+    bool Decode(const eastl::string& path);
+
 private:
     Renderer* m_renderer = nullptr;
     eastl::unique_ptr<Texture2DArray> m_scalarTexture;
     eastl::unique_ptr<Texture2DArray> m_vec2Texture;
     eastl::unique_ptr<Texture2DArray> m_vec3Texture;
-};
\ No newline at end of file
+
+    eastl::vector<uint8_t> m_data; //scalar r8, vec3 rgba8, vec2 rg8 slices, released once uploaded
+    bool m_bBaked = false;
+};
@@ -0,0 +1,1142 @@
+#include "texture_cooker.h"
+#include "core/engine.h"
+#include "utils/log.h"
+#include "utils/math.h"
+#include "utils/parallel_for.h"
+#include "xxHash/xxhash.h"
+#include "ddspp/ddspp.h"
+#include "stb/stb_image.h"
+#include "stb/stb_image_resize.h"
+#include "sokol/sokol_time.h"
+#include "magic_enum/magic_enum.hpp"
+#include <fstream>
+#include <filesystem>
+
+//bump it when the cooked output changes, to invalidate the cache
+static const uint32_t TEXTURE_COOKER_VERSION = 1;
+
+struct CookImage
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    eastl::vector<float4> pixels;
+
+    float4& At(uint32_t x, uint32_t y) { return pixels[y * width + x]; }
+    const float4& At(uint32_t x, uint32_t y) const { return pixels[y * width + x]; }
+};
+
+inline float SRGBToLinear(float value)
+{
+    return value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+inline float LinearToSRGB(float value)
+{
+    return value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+}
+
+inline uint8_t FloatToUnorm8(float value)
+{
+    return (uint8_t)(eastl::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+//mip generation
+
+static float Bessel0(float x)
+{
+    float sum = 1.0f;
+    float term = 1.0f;
+    for (int k = 1; k < 32; ++k)
+    {
+        float t = x / (2.0f * k);
+        term *= t * t;
+        sum += term;
+        if (term < sum * 1e-7f)
+        {
+            break;
+        }
+    }
+    return sum;
+}
+
+static float KaiserSinc(float x, float width, float alpha)
+{
+    float sinc = fabsf(x) < 1e-4f ? 1.0f : sinf(M_PI * x) / (M_PI * x);
+
+    float t = x / width;
+    float window = fabsf(t) < 1.0f ? Bessel0(alpha * sqrtf(1.0f - t * t)) / Bessel0(alpha) : 0.0f;
+
+    return sinc * window;
+}
+
+//a 2x downsample, source texel 2x+k contributes to destination texel x with KAISER_WEIGHTS[k - KAISER_FIRST_TAP]
+static const int KAISER_FIRST_TAP = -5;
+static const int KAISER_TAP_COUNT = 12;
+
+struct KaiserKernel
+{
+    float weights[KAISER_TAP_COUNT];
+
+    KaiserKernel()
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < KAISER_TAP_COUNT; ++i)
+        {
+            //distance between the texel centers, in destination texels
+            float distance = ((float)(KAISER_FIRST_TAP + i) - 0.5f) * 0.5f;
+            weights[i] = KaiserSinc(distance, 3.0f, 4.0f);
+            sum += weights[i];
+        }
+
+        for (int i = 0; i < KAISER_TAP_COUNT; ++i)
+        {
+            weights[i] /= sum;
+        }
+    }
+};
+
+inline uint32_t WrapCoord(int x, uint32_t size)
+{
+    int wrapped = x % (int)size;
+    return wrapped < 0 ? wrapped + size : wrapped;
+}
+
+static void DownsampleBox(const CookImage& src, CookImage& dst)
+{
+    uint32_t sx = src.width > 1 ? 2 : 1;
+    uint32_t sy = src.height > 1 ? 2 : 1;
+    float scale = 1.0f / (sx * sy);
+
+    ParallelFor(dst.height, [&](uint32_t y)
+        {
+            for (uint32_t x = 0; x < dst.width; ++x)
+            {
+                float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+                for (uint32_t j = 0; j < sy; ++j)
+                {
+                    for (uint32_t i = 0; i < sx; ++i)
+                    {
+                        sum += src.At(x * sx + i, y * sy + j);
+                    }
+                }
+                dst.At(x, y) = sum * scale;
+            }
+        });
+}
+
+//separable, with wrap addressing since most material textures tile
+static void DownsampleKaiser(const CookImage& src, CookImage& dst)
+{
+    static const KaiserKernel kernel;
+
+    CookImage horizontal;
+    horizontal.width = dst.width;
+    horizontal.height = src.height;
+    horizontal.pixels.resize(horizontal.width * horizontal.height);
+
+    ParallelFor(src.height, [&](uint32_t y)
+        {
+            for (uint32_t x = 0; x < dst.width; ++x)
+            {
+                if (src.width == 1)
+                {
+                    horizontal.At(x, y) = src.At(x, y);
+                    continue;
+                }
+
+                float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+                for (int i = 0; i < KAISER_TAP_COUNT; ++i)
+                {
+                    sum += src.At(WrapCoord(2 * x + KAISER_FIRST_TAP + i, src.width), y) * kernel.weights[i];
+                }
+                horizontal.At(x, y) = sum;
+            }
+        });
+
+    ParallelFor(dst.height, [&](uint32_t y)
+        {
+            for (uint32_t x = 0; x < dst.width; ++x)
+            {
+                float4 sum = float4(0.0f, 0.0f, 0.0f, 0.0f);
+                if (src.height == 1)
+                {
+                    sum = horizontal.At(x, y);
+                }
+                else
+                {
+                    for (int i = 0; i < KAISER_TAP_COUNT; ++i)
+                    {
+                        sum += horizontal.At(x, WrapCoord(2 * y + KAISER_FIRST_TAP + i, src.height)) * kernel.weights[i];
+                    }
+                }
+
+                //negative lobes may ring outside of the valid range
+                dst.At(x, y) = clamp(sum, float4(0.0f, 0.0f, 0.0f, 0.0f), float4(1.0f, 1.0f, 1.0f, 1.0f));
+            }
+        });
+}
+
+static void RenormalizeNormals(CookImage& image)
+{
+    ParallelFor(image.height, [&](uint32_t y)
+        {
+            for (uint32_t x = 0; x < image.width; ++x)
+            {
+                float4& pixel = image.At(x, y);
+                float3 normal = pixel.xyz() * 2.0f - 1.0f;
+                float length = linalg::length(normal);
+                normal = length > 1e-5f ? normal / length : float3(0.0f, 0.0f, 1.0f);
+                pixel = float4(normal * 0.5f + 0.5f, pixel.w);
+            }
+        });
+}
+
+//block compression, every block is 4x4 rgba8 texels
+
+typedef uint8_t ColorBlock[16][4];
+
+struct BitWriter
+{
+    uint8_t* data;
+    uint32_t position = 0;
+
+    void Write(uint32_t value, uint32_t bits)
+    {
+        for (uint32_t i = 0; i < bits; ++i, ++position)
+        {
+            if (value & (1u << i))
+            {
+                data[position / 8] |= 1u << (position % 8);
+            }
+        }
+    }
+};
+
+struct BitReader
+{
+    const uint8_t* data;
+    uint32_t position = 0;
+
+    uint32_t Read(uint32_t bits)
+    {
+        uint32_t value = 0;
+        for (uint32_t i = 0; i < bits; ++i, ++position)
+        {
+            value |= ((data[position / 8] >> (position % 8)) & 1u) << i;
+        }
+        return value;
+    }
+};
+
+template<int N>
+inline float SquaredError(const float* a, const uint8_t* b)
+{
+    float error = 0.0f;
+    for (int c = 0; c < N; ++c)
+    {
+        float d = a[c] - (float)b[c];
+        error += d * d;
+    }
+    return error;
+}
+
+//principal axis of the first N channels, by power iteration
+template<int N>
+static void PrincipalAxis(const ColorBlock block, float mean[N], float axis[N])
+{
+    for (int c = 0; c < N; ++c)
+    {
+        mean[c] = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            mean[c] += block[i][c];
+        }
+        mean[c] /= 16.0f;
+    }
+
+    float covariance[N][N] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int a = 0; a < N; ++a)
+        {
+            for (int b = 0; b < N; ++b)
+            {
+                covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+            }
+        }
+    }
+
+    for (int c = 0; c < N; ++c)
+    {
+        axis[c] = 1.0f;
+    }
+
+    for (int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[N] = {};
+        float length = 0.0f;
+        for (int a = 0; a < N; ++a)
+        {
+            for (int b = 0; b < N; ++b)
+            {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length = eastl::max(length, fabsf(next[a]));
+        }
+
+        if (length < 1e-6f)
+        {
+            break;
+        }
+
+        for (int c = 0; c < N; ++c)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+}
+
+//endpoints minimizing the squared error for fixed interpolation weights
+template<int N>
+static bool LeastSquaresEndpoints(const ColorBlock block, const float weights[16], float e0[N], float e1[N])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[N] = {}, bx[N] = {};
+
+    for (int i = 0; i < 16; ++i)
+    {
+        float b = weights[i];
+        float a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+
+        for (int c = 0; c < N; ++c)
+        {
+            ax[c] += a * block[i][c];
+            bx[c] += b * block[i][c];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+    {
+        return false;
+    }
+
+    for (int c = 0; c < N; ++c)
+    {
+        e0[c] = eastl::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+        e1[c] = eastl::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+//BC1
+
+inline uint16_t PackRGB565(const float color[3])
+{
+    uint32_t r = (uint32_t)(eastl::clamp(color[0], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    uint32_t g = (uint32_t)(eastl::clamp(color[1], 0.0f, 255.0f) * 63.0f / 255.0f + 0.5f);
+    uint32_t b = (uint32_t)(eastl::clamp(color[2], 0.0f, 255.0f) * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void UnpackRGB565(uint16_t color, uint8_t output[4])
+{
+    uint32_t r = (color >> 11) & 31;
+    uint32_t g = (color >> 5) & 63;
+    uint32_t b = color & 31;
+    output[0] = (uint8_t)((r << 3) | (r >> 2));
+    output[1] = (uint8_t)((g << 2) | (g >> 4));
+    output[2] = (uint8_t)((b << 3) | (b >> 2));
+    output[3] = 255;
+}
+
+static void GetBC1Palette(uint16_t c0, uint16_t c1, uint8_t palette[4][4])
+{
+    UnpackRGB565(c0, palette[0]);
+    UnpackRGB565(c1, palette[1]);
+
+    for (int c = 0; c < 3; ++c)
+    {
+        if (c0 > c1)
+        {
+            palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        }
+        else
+        {
+            palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+}
+
+//4 color mode only, so it can be used for the color block of BC3 too
+static float FitBC1(const ColorBlock block, uint16_t c0, uint16_t c1, uint32_t& indices, float weights[16])
+{
+    static const float index_weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    uint8_t palette[4][4];
+    GetBC1Palette(c0, c1, palette);
+
+    float error = 0.0f;
+    indices = 0;
+
+    for (int i = 0; i < 16; ++i)
+    {
+        float pixel[3] = { (float)block[i][0], (float)block[i][1], (float)block[i][2] };
+
+        uint32_t best_index = 0;
+        float best_error = FLT_MAX;
+        for (uint32_t p = 0; p < (c0 == c1 ? 1u : 4u); ++p)
+        {
+            float e = SquaredError<3>(pixel, palette[p]);
+            if (e < best_error)
+            {
+                best_error = e;
+                best_index = p;
+            }
+        }
+
+        indices |= best_index << (2 * i);
+        weights[i] = index_weights[best_index];
+        error += best_error;
+    }
+
+    return error;
+}
+
+static void EncodeBC1(const ColorBlock block, uint8_t* output)
+{
+    float mean[3], axis[3];
+    PrincipalAxis<3>(block, mean, axis);
+
+    float min_t = FLT_MAX, max_t = -FLT_MAX;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 3; ++c)
+        {
+            t += (block[i][c] - mean[c]) * axis[c];
+        }
+        min_t = eastl::min(min_t, t);
+        max_t = eastl::max(max_t, t);
+    }
+
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; ++c)
+    {
+        e0[c] = mean[c] + axis[c] * max_t;
+        e1[c] = mean[c] + axis[c] * min_t;
+    }
+
+    uint16_t best_c0 = 0, best_c1 = 0;
+    uint32_t best_indices = 0;
+    float best_error = FLT_MAX;
+
+    for (int iteration = 0; iteration < 3; ++iteration)
+    {
+        uint16_t c0 = PackRGB565(e0);
+        uint16_t c1 = PackRGB565(e1);
+        if (c0 < c1)
+        {
+            eastl::swap(c0, c1);
+        }
+
+        uint32_t indices;
+        float weights[16];
+        float error = FitBC1(block, c0, c1, indices, weights);
+        if (error < best_error)
+        {
+            best_error = error;
+            best_c0 = c0;
+            best_c1 = c1;
+            best_indices = indices;
+        }
+
+        if (best_error == 0.0f || !LeastSquaresEndpoints<3>(block, weights, e0, e1))
+        {
+            break;
+        }
+    }
+
+    memcpy(output, &best_c0, 2);
+    memcpy(output + 2, &best_c1, 2);
+    memcpy(output + 4, &best_indices, 4);
+}
+
+static void DecodeBC1(const uint8_t* input, ColorBlock block)
+{
+    uint16_t c0, c1;
+    uint32_t indices;
+    memcpy(&c0, input, 2);
+    memcpy(&c1, input + 2, 2);
+    memcpy(&indices, input + 4, 4);
+
+    uint8_t palette[4][4];
+    GetBC1Palette(c0, c1, palette);
+
+    for (int i = 0; i < 16; ++i)
+    {
+        memcpy(block[i], palette[(indices >> (2 * i)) & 3], 4);
+    }
+}
+
+//BC4, 8 interpolated values mode only
+
+static void GetBC4Palette(uint8_t a0, uint8_t a1, uint8_t palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+
+    for (int i = 1; i < 7; ++i)
+    {
+        if (a0 > a1)
+        {
+            palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1 + 3) / 7);
+        }
+        else
+        {
+            palette[i + 1] = i < 5 ? (uint8_t)(((5 - i) * a0 + i * a1 + 2) / 5) : (i == 5 ? 0 : 255);
+        }
+    }
+}
+
+static void EncodeBC4(const ColorBlock block, uint32_t channel, uint8_t* output)
+{
+    uint8_t min_value = 255, max_value = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        min_value = eastl::min(min_value, block[i][channel]);
+        max_value = eastl::max(max_value, block[i][channel]);
+    }
+
+    memset(output, 0, 8);
+    output[0] = max_value;
+    output[1] = min_value;
+
+    if (min_value == max_value)
+    {
+        return;
+    }
+
+    uint8_t palette[8];
+    GetBC4Palette(max_value, min_value, palette);
+
+    BitWriter writer = { output + 2 };
+    for (int i = 0; i < 16; ++i)
+    {
+        uint32_t best_index = 0;
+        int best_error = INT_MAX;
+        for (uint32_t p = 0; p < 8; ++p)
+        {
+            int error = abs((int)palette[p] - (int)block[i][channel]);
+            if (error < best_error)
+            {
+                best_error = error;
+                best_index = p;
+            }
+        }
+        writer.Write(best_index, 3);
+    }
+}
+
+static void DecodeBC4(const uint8_t* input, uint32_t channel, ColorBlock block)
+{
+    uint8_t palette[8];
+    GetBC4Palette(input[0], input[1], palette);
+
+    BitReader reader = { input + 2 };
+    for (int i = 0; i < 16; ++i)
+    {
+        block[i][channel] = palette[reader.Read(3)];
+    }
+}
+
+//BC7, mode 6 only : a single subset with 7 bits rgba endpoints, a p-bit per endpoint and 4 bits indices
+
+static const uint32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline uint8_t BC7Interpolate(uint8_t e0, uint8_t e1, uint32_t weight)
+{
+    return (uint8_t)(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+static float FitBC7Mode6(const ColorBlock block, const uint8_t e0[4], const uint8_t e1[4], uint8_t indices[16], float weights[16])
+{
+    uint8_t palette[16][4];
+    for (int p = 0; p < 16; ++p)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            palette[p][c] = BC7Interpolate(e0[c], e1[c], BC7_WEIGHTS4[p]);
+        }
+    }
+
+    float axis[4];
+    float axis_length = 0.0f;
+    for (int c = 0; c < 4; ++c)
+    {
+        axis[c] = (float)e1[c] - (float)e0[c];
+        axis_length += axis[c] * axis[c];
+    }
+
+    float error = 0.0f;
+    for (int i = 0; i < 16; ++i)
+    {
+        float pixel[4] = { (float)block[i][0], (float)block[i][1], (float)block[i][2], (float)block[i][3] };
+
+        //the projection on the endpoints gives the index up to the rounding of the weights
+        float t = 0.0f;
+        if (axis_length > 0.0f)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                t += (pixel[c] - e0[c]) * axis[c];
+            }
+            t /= axis_length;
+        }
+        int guess = eastl::clamp((int)(t * 15.0f + 0.5f), 0, 15);
+
+        uint32_t best_index = guess;
+        float best_error = FLT_MAX;
+        for (int p = eastl::max(guess - 1, 0); p <= eastl::min(guess + 1, 15); ++p)
+        {
+            float e = SquaredError<4>(pixel, palette[p]);
+            if (e < best_error)
+            {
+                best_error = e;
+                best_index = p;
+            }
+        }
+
+        indices[i] = (uint8_t)best_index;
+        weights[i] = BC7_WEIGHTS4[best_index] / 64.0f;
+        error += best_error;
+    }
+
+    return error;
+}
+
+static void EncodeBC7Mode6(const ColorBlock block, uint8_t* output)
+{
+    float mean[4], axis[4];
+    PrincipalAxis<4>(block, mean, axis);
+
+    float min_t = FLT_MAX, max_t = -FLT_MAX;
+    for (int i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            t += (block[i][c] - mean[c]) * axis[c];
+        }
+        min_t = eastl::min(min_t, t);
+        max_t = eastl::max(max_t, t);
+    }
+
+    float e0[4], e1[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        e0[c] = mean[c] + axis[c] * min_t;
+        e1[c] = mean[c] + axis[c] * max_t;
+    }
+
+    uint8_t best_q0[4] = {}, best_q1[4] = {};
+    uint32_t best_p0 = 0, best_p1 = 0;
+    uint8_t best_indices[16] = {};
+    float best_error = FLT_MAX;
+
+    for (int iteration = 0; iteration < 2; ++iteration)
+    {
+        float best_weights[16] = {};
+
+        for (uint32_t pbits = 0; pbits < 4; ++pbits)
+        {
+            uint32_t p0 = pbits & 1;
+            uint32_t p1 = pbits >> 1;
+
+            uint8_t q0[4], q1[4], v0[4], v1[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                q0[c] = (uint8_t)eastl::clamp((int)((e0[c] - p0) * 0.5f + 0.5f), 0, 127);
+                q1[c] = (uint8_t)eastl::clamp((int)((e1[c] - p1) * 0.5f + 0.5f), 0, 127);
+                v0[c] = (uint8_t)((q0[c] << 1) | p0);
+                v1[c] = (uint8_t)((q1[c] << 1) | p1);
+            }
+
+            uint8_t indices[16];
+            float weights[16];
+            float error = FitBC7Mode6(block, v0, v1, indices, weights);
+            if (error < best_error)
+            {
+                best_error = error;
+                memcpy(best_q0, q0, 4);
+                memcpy(best_q1, q1, 4);
+                best_p0 = p0;
+                best_p1 = p1;
+                memcpy(best_indices, indices, 16);
+                memcpy(best_weights, weights, sizeof(weights));
+            }
+        }
+
+        if (best_error == 0.0f || !LeastSquaresEndpoints<4>(block, best_weights, e0, e1))
+        {
+            break;
+        }
+    }
+
+    //the msb of the first index is implicitly 0
+    if (best_indices[0] & 8)
+    {
+        eastl::swap(best_q0, best_q1);
+        eastl::swap(best_p0, best_p1);
+        for (int i = 0; i < 16; ++i)
+        {
+            best_indices[i] = 15 - best_indices[i];
+        }
+    }
+
+    memset(output, 0, 16);
+    BitWriter writer = { output };
+    writer.Write(1 << 6, 7);
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.Write(best_q0[c], 7);
+        writer.Write(best_q1[c], 7);
+    }
+    writer.Write(best_p0, 1);
+    writer.Write(best_p1, 1);
+    for (int i = 0; i < 16; ++i)
+    {
+        writer.Write(best_indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+static void DecodeBC7Mode6(const uint8_t* input, ColorBlock block)
+{
+    BitReader reader = { input };
+    if (reader.Read(7) != (1 << 6))
+    {
+        memset(block, 0, sizeof(ColorBlock));
+        return;
+    }
+
+    uint8_t e0[4], e1[4];
+    for (int c = 0; c < 4; ++c)
+    {
+        e0[c] = (uint8_t)(reader.Read(7) << 1);
+        e1[c] = (uint8_t)(reader.Read(7) << 1);
+    }
+
+    uint32_t p0 = reader.Read(1);
+    uint32_t p1 = reader.Read(1);
+    for (int c = 0; c < 4; ++c)
+    {
+        e0[c] |= p0;
+        e1[c] |= p1;
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        uint32_t index = reader.Read(i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; ++c)
+        {
+            block[i][c] = BC7Interpolate(e0[c], e1[c], BC7_WEIGHTS4[index]);
+        }
+    }
+}
+
+static uint32_t GetBlockSize(GfxFormat format)
+{
+    switch (format)
+    {
+    case GfxFormat::BC1UNORM:
+    case GfxFormat::BC1SRGB:
+    case GfxFormat::BC4UNORM:
+        return 8;
+    default:
+        return 16;
+    }
+}
+
+static void EncodeBlock(GfxFormat format, const ColorBlock block, uint8_t* output)
+{
+    switch (format)
+    {
+    case GfxFormat::BC1UNORM:
+    case GfxFormat::BC1SRGB:
+        EncodeBC1(block, output);
+        break;
+    case GfxFormat::BC3UNORM:
+    case GfxFormat::BC3SRGB:
+        EncodeBC4(block, 3, output);
+        EncodeBC1(block, output + 8);
+        break;
+    case GfxFormat::BC4UNORM:
+        EncodeBC4(block, 0, output);
+        break;
+    case GfxFormat::BC5UNORM:
+        EncodeBC4(block, 0, output);
+        EncodeBC4(block, 1, output + 8);
+        break;
+    case GfxFormat::BC7UNORM:
+    case GfxFormat::BC7SRGB:
+        EncodeBC7Mode6(block, output);
+        break;
+    default:
+        RE_ASSERT(false);
+        break;
+    }
+}
+
+static void DecodeBlock(GfxFormat format, const uint8_t* input, ColorBlock block)
+{
+    memset(block, 0, sizeof(ColorBlock));
+
+    switch (format)
+    {
+    case GfxFormat::BC1UNORM:
+    case GfxFormat::BC1SRGB:
+        DecodeBC1(input, block);
+        break;
+    case GfxFormat::BC3UNORM:
+    case GfxFormat::BC3SRGB:
+        DecodeBC1(input + 8, block);
+        DecodeBC4(input, 3, block);
+        break;
+    case GfxFormat::BC4UNORM:
+        DecodeBC4(input, 0, block);
+        break;
+    case GfxFormat::BC5UNORM:
+        DecodeBC4(input, 0, block);
+        DecodeBC4(input + 8, 1, block);
+        break;
+    case GfxFormat::BC7UNORM:
+    case GfxFormat::BC7SRGB:
+        DecodeBC7Mode6(input, block);
+        break;
+    default:
+        RE_ASSERT(false);
+        break;
+    }
+}
+
+static ddspp::DXGIFormat GetDXGIFormat(GfxFormat format)
+{
+    switch (format)
+    {
+    case GfxFormat::BC1UNORM:
+        return ddspp::BC1_UNORM;
+    case GfxFormat::BC1SRGB:
+        return ddspp::BC1_UNORM_SRGB;
+    case GfxFormat::BC3UNORM:
+        return ddspp::BC3_UNORM;
+    case GfxFormat::BC3SRGB:
+        return ddspp::BC3_UNORM_SRGB;
+    case GfxFormat::BC4UNORM:
+        return ddspp::BC4_UNORM;
+    case GfxFormat::BC5UNORM:
+        return ddspp::BC5_UNORM;
+    case GfxFormat::BC7UNORM:
+        return ddspp::BC7_UNORM;
+    case GfxFormat::BC7SRGB:
+        return ddspp::BC7_UNORM_SRGB;
+    default:
+        RE_ASSERT(false);
+        return ddspp::UNKNOWN;
+    }
+}
+
+static uint32_t GetCompareChannels(TextureUsage usage)
+{
+    switch (usage)
+    {
+    case TextureUsage::Albedo:
+    case TextureUsage::Linear:
+        return 4;
+    case TextureUsage::Emissive:
+    case TextureUsage::ORM:
+        return 3;
+    case TextureUsage::Normal:
+        return 2;
+    case TextureUsage::Mask:
+    default:
+        return 1;
+    }
+}
+
+TextureCooker::TextureCooker(const TextureCookSettings& settings)
+{
+    m_settings = settings;
+    m_cachePath = Engine::GetInstance()->GetWorkPath() + "texture_cache/";
+}
+
+GfxFormat TextureCooker::GetFormat(TextureUsage usage, bool has_alpha) const
+{
+    switch (usage)
+    {
+    case TextureUsage::Albedo:
+        if (m_settings.fast)
+        {
+            return has_alpha ? GfxFormat::BC3SRGB : GfxFormat::BC1SRGB;
+        }
+        return GfxFormat::BC7SRGB;
+    case TextureUsage::Emissive:
+        return GfxFormat::BC1SRGB;
+    case TextureUsage::Normal:
+        return GfxFormat::BC5UNORM;
+    case TextureUsage::ORM:
+        return m_settings.fast ? GfxFormat::BC1UNORM : GfxFormat::BC7UNORM;
+    case TextureUsage::Linear:
+        return m_settings.fast ? GfxFormat::BC3UNORM : GfxFormat::BC7UNORM;
+    case TextureUsage::Mask:
+    default:
+        return GfxFormat::BC4UNORM;
+    }
+}
+
+eastl::string TextureCooker::GetCookedFile(const eastl::string& file, TextureUsage usage)
+{
+    if (file.find(".dds") != eastl::string::npos)
+    {
+        return file;
+    }
+
+    std::ifstream is;
+    is.open(file.c_str(), std::ios::binary);
+    if (is.fail())
+    {
+        return file;
+    }
+
+    is.seekg(0, std::ios::end);
+    uint32_t length = (uint32_t)is.tellg();
+    is.seekg(0, std::ios::beg);
+
+    eastl::vector<uint8_t> data(length);
+    is.read((char*)data.data(), length);
+    is.close();
+
+    uint64_t seed = TEXTURE_COOKER_VERSION | ((uint64_t)usage << 8) | ((uint64_t)m_settings.mip_filter << 16) | ((uint64_t)m_settings.fast << 24);
+    uint64_t hash = XXH3_64bits_withSeed(data.data(), data.size(), seed);
+    eastl::string cooked_file = m_cachePath + fmt::format("{:016x}.dds", hash).c_str();
+
+    if (std::filesystem::exists(cooked_file.c_str()))
+    {
+        return cooked_file;
+    }
+
+    eastl::vector<uint8_t> dds;
+    TextureCookStats stats;
+    if (!Cook(data.data(), length, usage, dds, stats))
+    {
+        return file;
+    }
+
+    std::filesystem::create_directories(m_cachePath.c_str());
+
+    std::ofstream os;
+    os.open(cooked_file.c_str(), std::ios::binary);
+    if (os.fail())
+    {
+        RE_WARN("[TextureCooker] failed to write {}", cooked_file);
+        return file;
+    }
+    os.write((const char*)dds.data(), dds.size());
+    os.close();
+
+    RE_INFO("[TextureCooker] {} : {}x{}, {} mips, {}, {} KB -> {} KB, mips {:.1f} ms, compression {:.1f} ms, PSNR {:.2f} dB",
+        file, stats.width, stats.height, stats.mip_levels, magic_enum::enum_name(stats.format),
+        stats.source_size / 1024, stats.cooked_size / 1024, stats.mip_time, stats.compression_time, stats.psnr);
+
+    return cooked_file;
+}
+
+bool TextureCooker::Cook(const uint8_t* data, uint32_t size, TextureUsage usage, eastl::vector<uint8_t>& dds, TextureCookStats& stats)
+{
+    if (stbi_is_hdr_from_memory(data, (int)size))
+    {
+        return false;
+    }
+
+    int x, y, comp;
+    stbi_uc* pixels = stbi_load_from_memory(data, (int)size, &x, &y, &comp, 4);
+    if (pixels == nullptr)
+    {
+        return false;
+    }
+
+    //the top mip of a BC texture should be made of whole blocks
+    if (x < 4 || y < 4)
+    {
+        stbi_image_free(pixels);
+        return false;
+    }
+
+    uint64_t ticks = stm_now();
+    bool srgb = IsSRGB(usage);
+    bool has_alpha = false;
+
+    CookImage source;
+    source.width = x;
+    source.height = y;
+    source.pixels.resize(x * y);
+
+    for (int i = 0; i < x * y; ++i)
+    {
+        const stbi_uc* pixel = pixels + i * 4;
+        float4 color = float4(pixel[0], pixel[1], pixel[2], pixel[3]) / 255.0f;
+        if (srgb)
+        {
+            color = float4(SRGBToLinear(color.x), SRGBToLinear(color.y), SRGBToLinear(color.z), color.w);
+        }
+        source.pixels[i] = color;
+        has_alpha |= pixel[3] != 255;
+    }
+    stbi_image_free(pixels);
+
+    eastl::vector<CookImage> mips(1);
+    if (IsPow2(source.width) && IsPow2(source.height))
+    {
+        mips[0] = eastl::move(source);
+    }
+    else
+    {
+        mips[0].width = 1 << (uint32_t)ceilf(log2f((float)source.width));
+        mips[0].height = 1 << (uint32_t)ceilf(log2f((float)source.height));
+        mips[0].pixels.resize(mips[0].width * mips[0].height);
+
+        stbir_resize_float((const float*)source.pixels.data(), source.width, source.height, 0,
+            (float*)mips[0].pixels.data(), mips[0].width, mips[0].height, 0, 4);
+    }
+
+    if (usage == TextureUsage::Normal)
+    {
+        RenormalizeNormals(mips[0]);
+    }
+
+    uint32_t mip_levels = (uint32_t)log2f((float)eastl::max(mips[0].width, mips[0].height)) + 1;
+    mips.resize(mip_levels);
+
+    for (uint32_t mip = 1; mip < mip_levels; ++mip)
+    {
+        const CookImage& src = mips[mip - 1];
+        CookImage& dst = mips[mip];
+        dst.width = eastl::max(src.width / 2, 1u);
+        dst.height = eastl::max(src.height / 2, 1u);
+        dst.pixels.resize(dst.width * dst.height);
+
+        if (m_settings.mip_filter == MipFilter::Kaiser)
+        {
+            DownsampleKaiser(src, dst);
+        }
+        else
+        {
+            DownsampleBox(src, dst);
+        }
+
+        if (usage == TextureUsage::Normal)
+        {
+            RenormalizeNormals(dst);
+        }
+    }
+
+    stats.mip_time = (float)stm_ms(stm_now() - ticks);
+    ticks = stm_now();
+
+    GfxFormat format = GetFormat(usage, has_alpha);
+    uint32_t block_size = GetBlockSize(format);
+
+    ddspp::Header header;
+    ddspp::HeaderDXT10 header_dxt10;
+    ddspp::encode_header(GetDXGIFormat(format), mips[0].width, mips[0].height, 1, ddspp::Texture2D, mip_levels, 1, header, header_dxt10);
+
+    uint32_t header_size = sizeof(uint32_t) + sizeof(ddspp::Header) + sizeof(ddspp::HeaderDXT10);
+    uint32_t data_size = 0;
+    for (uint32_t mip = 0; mip < mip_levels; ++mip)
+    {
+        data_size += DivideRoudingUp(mips[mip].width, 4) * DivideRoudingUp(mips[mip].height, 4) * block_size;
+    }
+
+    dds.resize(header_size + data_size);
+    memcpy(dds.data(), &ddspp::internal::DDS_MAGIC, sizeof(uint32_t));
+    memcpy(dds.data() + sizeof(uint32_t), &header, sizeof(ddspp::Header));
+    memcpy(dds.data() + sizeof(uint32_t) + sizeof(ddspp::Header), &header_dxt10, sizeof(ddspp::HeaderDXT10));
+
+    double squared_error = 0.0;
+    uint32_t compare_channels = GetCompareChannels(usage);
+    uint8_t* output = dds.data() + header_size;
+
+    for (uint32_t mip = 0; mip < mip_levels; ++mip)
+    {
+        const CookImage& image = mips[mip];
+        uint32_t blocks_x = DivideRoudingUp(image.width, 4);
+        uint32_t blocks_y = DivideRoudingUp(image.height, 4);
+
+        eastl::vector<double> row_errors(mip == 0 ? blocks_y : 0);
+
+        ParallelFor(blocks_y, [&](uint32_t by)
+            {
+                for (uint32_t bx = 0; bx < blocks_x; ++bx)
+                {
+                    //blocks of the mips smaller than 4x4 repeat the edge texels
+                    ColorBlock block;
+                    for (uint32_t i = 0; i < 16; ++i)
+                    {
+                        const float4& pixel = image.At(eastl::min(bx * 4 + i % 4, image.width - 1), eastl::min(by * 4 + i / 4, image.height - 1));
+                        for (uint32_t c = 0; c < 4; ++c)
+                        {
+                            block[i][c] = FloatToUnorm8(srgb && c < 3 ? LinearToSRGB(pixel[c]) : pixel[c]);
+                        }
+                    }
+
+                    uint8_t* block_data = output + (by * blocks_x + bx) * block_size;
+                    EncodeBlock(format, block, block_data);
+
+                    if (mip == 0)
+                    {
+                        ColorBlock decoded;
+                        DecodeBlock(format, block_data, decoded);
+
+                        for (uint32_t i = 0; i < 16; ++i)
+                        {
+                            for (uint32_t c = 0; c < compare_channels; ++c)
+                            {
+                                double d = (double)block[i][c] - (double)decoded[i][c];
+                                row_errors[by] += d * d;
+                            }
+                        }
+                    }
+                }
+            });
+
+        for (size_t i = 0; i < row_errors.size(); ++i)
+        {
+            squared_error += row_errors[i];
+        }
+
+        output += blocks_x * blocks_y * block_size;
+    }
+
+    double mse = squared_error / ((double)mips[0].width * mips[0].height * compare_channels);
+
+    stats.compression_time = (float)stm_ms(stm_now() - ticks);
+    stats.psnr = mse > 0.0 ? (float)(10.0 * log10(255.0 * 255.0 / mse)) : 100.0f;
+    stats.width = mips[0].width;
+    stats.height = mips[0].height;
+    stats.mip_levels = mip_levels;
+    stats.format = format;
+    stats.cooked_size = data_size;
+    stats.source_size = 0;
+    for (uint32_t mip = 0; mip < mip_levels; ++mip)
+    {
+        stats.source_size += mips[mip].width * mips[mip].height * 4;
+    }
+
+    return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "gfx/gfx_defines.h"
+
+//decides the block format of a cooked texture, and which channels are compared for the PSNR
+enum class TextureUsage
+{
+    Albedo,     //srgb rgba : BC7, or BC1/BC3 in fast mode
+    Emissive,   //srgb rgb : BC1
+    Normal,     //tangent space normal in rg : BC5, renormalized in each mip
+    ORM,        //linear rgb, e.g. occlusion/roughness/metallic : BC7, or BC1 in fast mode
+    Linear,     //linear rgba : BC7, or BC3 in fast mode
+    Mask,       //single channel in r : BC4
+};
+
+enum class MipFilter
+{
+    Box,
+    Kaiser,
+};
+
+struct TextureCookSettings
+{
+    MipFilter mip_filter = MipFilter::Kaiser;
+    bool fast = false; //BC1/BC3 instead of BC7
+};
+
+struct TextureCookStats
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mip_levels = 0;
+    GfxFormat format = GfxFormat::Unknown;
+    uint32_t source_size = 0; //as an uncompressed rgba8 mip chain
+    uint32_t cooked_size = 0;
+    float mip_time = 0.0f; //ms
+    float compression_time = 0.0f; //ms
+    float psnr = 0.0f; //of the top mip, in dB
+};
+
+//cooks png/jpg textures into dds files with a full mip chain in a BC format, which TextureLoader reads directly.
+//cooked files are cached by the hash of the source file and the settings, so each texture is only cooked once.
+class TextureCooker
+{
+public:
+    TextureCooker(const TextureCookSettings& settings = TextureCookSettings());
+
+    //returns the cooked dds file, or the source file if it can't be cooked (dds/hdr sources, textures smaller than a block)
+    eastl::string GetCookedFile(const eastl::string& file, TextureUsage usage);
+
+    //cooks an encoded image in memory into a dds file
+    bool Cook(const uint8_t* data, uint32_t size, TextureUsage usage, eastl::vector<uint8_t>& dds, TextureCookStats& stats);
+
+    static bool IsSRGB(TextureUsage usage) { return usage == TextureUsage::Albedo || usage == TextureUsage::Emissive; }
+
+private:
+    GfxFormat GetFormat(TextureUsage usage, bool has_alpha) const;
+
+private:
+    TextureCookSettings m_settings;
+    eastl::string m_cachePath;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gfx/gfx.h"
+#include "utils/memory_mapped_file.h"
 
 class TextureLoader
 {
@@ -8,6 +9,7 @@ public:
     TextureLoader();
     ~TextureLoader();
 
+    //the file is memory mapped, dds data is used from the mapping directly and stays valid as long as the loader
     bool Load(const eastl::string& file, bool srgb);
 
     uint32_t GetWidth() const { return m_width; }
@@ -19,6 +21,7 @@ public:
 
     void* GetData() const { return m_pDecompressedData != nullptr ? m_pDecompressedData : m_pTextureData; }
     uint32_t GetDataSize() const { return m_textureSize; }
+    uint32_t GetFileSize() const { return (uint32_t)m_file.GetSize(); }
 
     bool Resize(uint32_t width, uint32_t height);
 
@@ -39,5 +42,5 @@ private:
     void* m_pDecompressedData = nullptr;
     uint32_t m_textureSize = 0;
 
-    eastl::vector<uint8_t> m_fileData;
+    MemoryMappedFile m_file;
 };
\ No newline at end of file
@@ -0,0 +1,492 @@
+#include "texture_streamer.h"
+#include "texture_loader.h"
+#include "async_texture_loader.h"
+#include "renderer.h"
+#include "utils/gui_util.h"
+#include "utils/log.h"
+#include "EASTL/sort.h"
+
+#define MAX_STREAMING_TEXTURE_COUNT (4096)
+
+TextureStreamer::TextureStreamer(Renderer* pRenderer, uint32_t budget)
+{
+    m_pRenderer = pRenderer;
+
+    IGfxDevice* pDevice = pRenderer->GetDevice();
+
+    m_nTileCount = budget / GFX_TILE_SIZE;
+
+    GfxHeapDesc heapDesc;
+    heapDesc.size = m_nTileCount * GFX_TILE_SIZE;
+    m_pHeap.reset(pDevice->CreateHeap(heapDesc, "TextureStreamer::m_pHeap"));
+
+    //popped from the back, so the heap is filled from the beginning
+    m_freeTiles.reserve(m_nTileCount);
+    for (uint32_t i = 0; i < m_nTileCount; ++i)
+    {
+        m_freeTiles.push_back(m_nTileCount - 1 - i);
+    }
+
+    const uint32_t feedback_size = sizeof(uint32_t) * MAX_STREAMING_TEXTURE_COUNT;
+    m_pFeedbackBuffer.reset(pRenderer->CreateRawBuffer(nullptr, feedback_size, "TextureStreamer::m_pFeedbackBuffer", GfxMemoryType::GpuOnly, true));
+
+    for (uint32_t i = 0; i < GFX_MAX_INFLIGHT_FRAMES; ++i)
+    {
+        GfxBufferDesc desc;
+        desc.size = feedback_size;
+        desc.memory_type = GfxMemoryType::GpuToCpu;
+        m_pFeedbackReadbackBuffer[i].reset(pDevice->CreateBuffer(desc, "TextureStreamer::m_pFeedbackReadbackBuffer"));
+    }
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+Texture2D* TextureStreamer::CreateTexture(const TextureLoader& loader, const eastl::string& file, bool srgb)
+{
+    if (loader.GetArraySize() != 1 || loader.GetDepth() != 1 || loader.GetMipLevels() == 1)
+    {
+        return nullptr;
+    }
+
+    if (m_freeIndices.empty() && m_textures.size() >= MAX_STREAMING_TEXTURE_COUNT)
+    {
+        return nullptr;
+    }
+
+    Texture2D* texture = new Texture2D(file);
+    if (!texture->Create(loader.GetWidth(), loader.GetHeight(), loader.GetMipLevels(), loader.GetFormat(), 0, true))
+    {
+        delete texture;
+        return nullptr;
+    }
+
+    //textures which fit in the packed mips are not worth streaming
+    GfxTilingDesc tiling = texture->GetTexture()->GetTilingDesc();
+    if (tiling.standard_mips == 0)
+    {
+        delete texture;
+        return nullptr;
+    }
+
+    eastl::unique_ptr<StreamedTexture> streamedTexture = eastl::make_unique<StreamedTexture>();
+    streamedTexture->texture = texture;
+    streamedTexture->file = file;
+    streamedTexture->srgb = srgb;
+    streamedTexture->standardMips = tiling.standard_mips;
+    streamedTexture->residentMip = tiling.standard_mips;
+    streamedTexture->requestedMip = tiling.standard_mips;
+    streamedTexture->mipTiles.resize(tiling.standard_mips);
+
+    if (!AllocateTiles(tiling.packed_mip_tiles, GFX_INVALID_RESOURCE, streamedTexture->packedTiles))
+    {
+        RE_WARN("TextureStreamer : out of tiles for the packed mips of {}", file);
+        delete texture;
+        return nullptr;
+    }
+
+    GfxFormat format = loader.GetFormat();
+    uint32_t block_width = GetFormatBlockWidth(format);
+    uint32_t block_height = GetFormatBlockHeight(format);
+    uint32_t offset = 0;
+
+    for (uint32_t mip = 0; mip < loader.GetMipLevels(); ++mip)
+    {
+        uint32_t width = max(loader.GetWidth() >> mip, block_width);
+        uint32_t height = max(loader.GetHeight() >> mip, block_height);
+
+        streamedTexture->mipOffsets.push_back(offset);
+        offset += GetFormatRowPitch(format, width) * (height / block_height);
+    }
+
+    uint32_t index;
+    if (!m_freeIndices.empty())
+    {
+        index = m_freeIndices.back();
+        m_freeIndices.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)m_textures.size();
+        m_textures.emplace_back();
+    }
+
+    texture->SetStreamingIndex(index);
+    MapPackedMips(streamedTexture.get(), (const uint8_t*)loader.GetData());
+
+    m_textures[index] = eastl::move(streamedTexture);
+    m_nTotalSize += (uint64_t)tiling.tile_count * GFX_TILE_SIZE;
+
+    return texture;
+}
+
+void TextureStreamer::RemoveTexture(Texture2D* texture)
+{
+    uint32_t index = texture->GetStreamingIndex();
+    RE_ASSERT(index < m_textures.size() && m_textures[index]->texture == texture);
+
+    StreamedTexture* streamedTexture = m_textures[index].get();
+    for (size_t i = 0; i < streamedTexture->mipTiles.size(); ++i)
+    {
+        FreeTiles(streamedTexture->mipTiles[i]);
+    }
+    FreeTiles(streamedTexture->packedTiles);
+    ReleaseFile(streamedTexture);
+
+    m_nTotalSize -= (uint64_t)texture->GetTexture()->GetTilingDesc().tile_count * GFX_TILE_SIZE;
+
+    m_textures[index].reset();
+    m_freeIndices.push_back(index);
+    texture->SetStreamingIndex(GFX_INVALID_RESOURCE);
+}
+
+void TextureStreamer::Update()
+{
+    CPU_EVENT("Render", "TextureStreamer::Update");
+
+    uint32_t frame_index = m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
+
+    if (m_bFeedbackReady[frame_index])
+    {
+        const uint32_t* feedback = (const uint32_t*)m_pFeedbackReadbackBuffer[frame_index]->GetCpuAddress();
+        ProcessFeedback(feedback, (uint32_t)m_textures.size());
+
+        m_bFeedbackReady[frame_index] = false;
+    }
+    else
+    {
+        ProcessFeedback(nullptr, 0);
+    }
+
+    UpdateResidency();
+}
+
+void TextureStreamer::ProcessFeedback(const uint32_t* requested_mips, uint32_t count)
+{
+    uint64_t frame = m_pRenderer->GetFrameID();
+
+    for (size_t i = 0; i < m_pendingFreeTiles.size();)
+    {
+        if (m_pendingFreeTiles[i].second + GFX_MAX_INFLIGHT_FRAMES <= frame)
+        {
+            m_freeTiles.push_back(m_pendingFreeTiles[i].first);
+            m_pendingFreeTiles.erase_unsorted(m_pendingFreeTiles.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    eastl::vector<uint32_t> requests;
+
+    for (uint32_t i = 0; i < min(count, (uint32_t)m_textures.size()); ++i)
+    {
+        StreamedTexture* texture = m_textures[i].get();
+        if (texture == nullptr || requested_mips[i] == GFX_INVALID_RESOURCE)
+        {
+            continue;
+        }
+
+        texture->requestedMip = min(requested_mips[i], texture->standardMips);
+        texture->lastUsedFrame = frame;
+
+        //the missing mips are uploaded in a later frame if the file is still loading
+        if (texture->residentMip > texture->requestedMip && ReadFile(texture))
+        {
+            requests.push_back(i);
+        }
+    }
+
+    //one mip per texture in each round, so all visible textures get sharper at the same pace
+    m_nUploadedTiles = 0;
+    m_nEvictedTiles = 0;
+    bool progress = true;
+
+    while (progress && m_nUploadedTiles < m_nMaxUploadTilesPerFrame)
+    {
+        progress = false;
+
+        for (size_t i = 0; i < requests.size() && m_nUploadedTiles < m_nMaxUploadTilesPerFrame; ++i)
+        {
+            StreamedTexture* texture = m_textures[requests[i]].get();
+            if (texture->residentMip > texture->requestedMip && MapMip(requests[i], texture->residentMip - 1))
+            {
+                progress = true;
+            }
+        }
+    }
+
+    //the files are kept while some mips are missing, or until the textures have not been visible for a few frames
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        StreamedTexture* texture = m_textures[i].get();
+        if (texture == nullptr || (!texture->loading && texture->loader == nullptr))
+        {
+            continue;
+        }
+
+        bool needed = texture->residentMip > texture->requestedMip && texture->lastUsedFrame + GFX_MAX_INFLIGHT_FRAMES > frame;
+        if (!needed && (!texture->loading || m_pRenderer->GetAsyncTextureLoader()->IsCompleted(texture->file)))
+        {
+            ReleaseFile(texture);
+        }
+    }
+}
+
+void TextureStreamer::ClearFeedback(IGfxCommandList* pCommandList)
+{
+    GPU_EVENT(pCommandList, "TextureStreamer clear feedback");
+
+    IGfxBuffer* buffer = m_pFeedbackBuffer->GetBuffer();
+    pCommandList->BufferBarrier(buffer, GfxAccessCopySrc, GfxAccessClearUAV);
+
+    uint32_t clear_value[4] = { GFX_INVALID_RESOURCE, GFX_INVALID_RESOURCE, GFX_INVALID_RESOURCE, GFX_INVALID_RESOURCE };
+    pCommandList->ClearUAV(buffer, m_pFeedbackBuffer->GetUAV(), clear_value);
+    pCommandList->BufferBarrier(buffer, GfxAccessClearUAV, GfxAccessMaskUAV);
+}
+
+void TextureStreamer::CopyFeedback(IGfxCommandList* pCommandList)
+{
+    GPU_EVENT(pCommandList, "TextureStreamer copy feedback");
+
+    uint32_t frame_index = m_pRenderer->GetFrameID() % GFX_MAX_INFLIGHT_FRAMES;
+
+    IGfxBuffer* buffer = m_pFeedbackBuffer->GetBuffer();
+    pCommandList->BufferBarrier(buffer, GfxAccessMaskUAV, GfxAccessCopySrc);
+    pCommandList->CopyBuffer(m_pFeedbackReadbackBuffer[frame_index].get(), 0, buffer, 0, buffer->GetDesc().size);
+
+    m_bFeedbackReady[frame_index] = true;
+}
+
+uint32_t TextureStreamer::GetResidentMip(uint32_t streaming_index) const
+{
+    if (streaming_index >= m_textures.size() || m_textures[streaming_index] == nullptr)
+    {
+        return GFX_INVALID_RESOURCE;
+    }
+    return m_textures[streaming_index]->residentMip;
+}
+
+void TextureStreamer::OnGui()
+{
+    if (ImGui::CollapsingHeader("Texture Streaming"))
+    {
+        ImGui::Text("Textures : %u", GetTextureCount());
+        ImGui::Text("Resident : %.1f MB / %.1f MB budget", GetResidentSize() / (1024.0f * 1024.0f), GetBudget() / (1024.0f * 1024.0f));
+        ImGui::Text("Fully loaded : %.1f MB", GetTotalSize() / (1024.0f * 1024.0f));
+        ImGui::Text("Last frame : %u tiles uploaded, %u tiles evicted", m_nUploadedTiles, m_nEvictedTiles);
+        ImGui::SliderInt("Max Uploaded Tiles##TextureStreamer", (int*)&m_nMaxUploadTilesPerFrame, 16, 1024);
+    }
+}
+
+bool TextureStreamer::AllocateTiles(uint32_t count, uint32_t exclude_index, eastl::vector<uint32_t>& tiles)
+{
+    //evicted tiles only become free after GFX_MAX_INFLIGHT_FRAMES, they are counted so that nothing more is evicted meanwhile
+    while (m_freeTiles.size() + m_pendingFreeTiles.size() < count)
+    {
+        if (!EvictMip(exclude_index))
+        {
+            break;
+        }
+    }
+
+    if (m_freeTiles.size() < count)
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        tiles.push_back(m_freeTiles.back());
+        m_freeTiles.pop_back();
+    }
+
+    return true;
+}
+
+void TextureStreamer::FreeTiles(eastl::vector<uint32_t>& tiles)
+{
+    //the old mappings are left as they are, nothing samples them after the residency is updated
+    uint64_t frame = m_pRenderer->GetFrameID();
+
+    for (size_t i = 0; i < tiles.size(); ++i)
+    {
+        m_pendingFreeTiles.push_back(eastl::make_pair(tiles[i], frame));
+    }
+    tiles.clear();
+}
+
+bool TextureStreamer::EvictMip(uint32_t exclude_index)
+{
+    uint64_t frame = m_pRenderer->GetFrameID();
+    StreamedTexture* victim = nullptr;
+
+    for (uint32_t i = 0; i < (uint32_t)m_textures.size(); ++i)
+    {
+        StreamedTexture* texture = m_textures[i].get();
+        if (texture == nullptr || i == exclude_index || texture->residentMip >= texture->standardMips)
+        {
+            continue;
+        }
+
+        //the finest resident mip is still needed if it was requested in this frame
+        bool needed = texture->lastUsedFrame == frame && texture->residentMip >= texture->requestedMip;
+        if (needed)
+        {
+            continue;
+        }
+
+        //least recently used first, then the finest mip
+        if (victim == nullptr || texture->lastUsedFrame < victim->lastUsedFrame ||
+            (texture->lastUsedFrame == victim->lastUsedFrame && texture->residentMip < victim->residentMip))
+        {
+            victim = texture;
+        }
+    }
+
+    if (victim == nullptr)
+    {
+        return false;
+    }
+
+    eastl::vector<uint32_t>& tiles = victim->mipTiles[victim->residentMip];
+    m_nEvictedTiles += (uint32_t)tiles.size();
+    FreeTiles(tiles);
+
+    victim->residentMip++;
+    return true;
+}
+
+bool TextureStreamer::ReadFile(StreamedTexture* texture)
+{
+    if (texture->loader || texture->loadFailed)
+    {
+        return texture->loader != nullptr;
+    }
+
+    AsyncTextureLoader* pLoader = m_pRenderer->GetAsyncTextureLoader();
+
+    if (!texture->loading)
+    {
+        pLoader->Request(texture->file, texture->srgb);
+        texture->loading = true;
+    }
+
+    if (!pLoader->IsCompleted(texture->file))
+    {
+        return false;
+    }
+
+    texture->loading = false;
+    texture->loader = pLoader->Acquire(texture->file, texture->srgb);
+
+    const GfxTextureDesc& desc = texture->texture->GetTexture()->GetDesc();
+    if (texture->loader == nullptr ||
+        texture->loader->GetWidth() != desc.width || texture->loader->GetHeight() != desc.height ||
+        texture->loader->GetMipLevels() != desc.mip_levels || texture->loader->GetFormat() != desc.format)
+    {
+        RE_WARN("TextureStreamer : failed to read {} again, its missing mips are not streamed", texture->file);
+        texture->loader.reset();
+        texture->loadFailed = true;
+        return false;
+    }
+
+    return true;
+}
+
+void TextureStreamer::ReleaseFile(StreamedTexture* texture)
+{
+    if (texture->loading)
+    {
+        //waits for the request if it is still in flight
+        m_pRenderer->GetAsyncTextureLoader()->Acquire(texture->file, texture->srgb);
+        texture->loading = false;
+    }
+
+    texture->loader.reset();
+}
+
+bool TextureStreamer::MapMip(uint32_t index, uint32_t mip)
+{
+    StreamedTexture* texture = m_textures[index].get();
+    IGfxTexture* gfxTexture = texture->texture->GetTexture();
+
+    GfxSubresourceTilingDesc tiling = gfxTexture->GetTilingDesc(mip);
+    uint32_t tile_count = tiling.width * tiling.height;
+
+    eastl::vector<uint32_t>& tiles = texture->mipTiles[mip];
+    if (!AllocateTiles(tile_count, index, tiles))
+    {
+        return false;
+    }
+
+    eastl::vector<GfxTileMapping> mappings;
+    mappings.reserve(tile_count);
+
+    for (uint32_t y = 0; y < tiling.height; ++y)
+    {
+        for (uint32_t x = 0; x < tiling.width; ++x)
+        {
+            GfxTileMapping mapping = {};
+            mapping.type = GfxTileMappingType::Map;
+            mapping.subresource = mip;
+            mapping.x = x;
+            mapping.y = y;
+            mapping.tile_count = 1;
+            mapping.heap_offset = tiles[y * tiling.width + x];
+            mappings.push_back(mapping);
+        }
+    }
+
+    //the mappings and the upload are executed before the frame, so the mip can be sampled right away
+    m_pRenderer->UpdateTileMappings(gfxTexture, m_pHeap.get(), mappings);
+    m_pRenderer->UploadTexture(gfxTexture, mip, 0, (const uint8_t*)texture->loader->GetData() + texture->mipOffsets[mip]);
+
+    texture->residentMip = mip;
+    m_nUploadedTiles += tile_count;
+
+    return true;
+}
+
+void TextureStreamer::MapPackedMips(StreamedTexture* texture, const uint8_t* data)
+{
+    IGfxTexture* gfxTexture = texture->texture->GetTexture();
+
+    eastl::vector<GfxTileMapping> mappings;
+    mappings.reserve(texture->packedTiles.size());
+
+    for (uint32_t i = 0; i < (uint32_t)texture->packedTiles.size(); ++i)
+    {
+        GfxTileMapping mapping = {};
+        mapping.type = GfxTileMappingType::Map;
+        mapping.subresource = texture->standardMips;
+        mapping.x = i; //tile index in the packed mips
+        mapping.tile_count = 1;
+        mapping.heap_offset = texture->packedTiles[i];
+        mappings.push_back(mapping);
+    }
+
+    m_pRenderer->UpdateTileMappings(gfxTexture, m_pHeap.get(), mappings);
+
+    for (uint32_t mip = texture->standardMips; mip < gfxTexture->GetDesc().mip_levels; ++mip)
+    {
+        m_pRenderer->UploadTexture(gfxTexture, mip, 0, data + texture->mipOffsets[mip]);
+    }
+}
+
+void TextureStreamer::UpdateResidency()
+{
+    eastl::vector<float> residency(max((uint32_t)m_textures.size(), 1u), 0.0f);
+
+    for (size_t i = 0; i < m_textures.size(); ++i)
+    {
+        if (m_textures[i])
+        {
+            residency[i] = (float)m_textures[i]->residentMip;
+        }
+    }
+
+    m_nResidencyAddress = m_pRenderer->AllocateSceneConstant(residency.data(), sizeof(float) * (uint32_t)residency.size());
+}
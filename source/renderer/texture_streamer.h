@@ -0,0 +1,95 @@
+#pragma once
+
+#include "resource/raw_buffer.h"
+#include "EASTL/unique_ptr.h"
+
+class Renderer;
+class Texture2D;
+class TextureLoader;
+
+//streams the mips of large material textures into sparse textures, backed by a fixed size tile pool.
+//the base pass writes the finest mip each streamed texture needs into a feedback buffer, which is read back
+//GFX_MAX_INFLIGHT_FRAMES later. missing mips are then mapped and uploaded, and the least recently used ones
+//are evicted when the pool is full. the packed mip tail of each texture is always resident.
+//only the packed mips are uploaded from the loader at creation, the other ones are read from the file again
+//through the AsyncTextureLoader when they are requested, and the file is released once nothing more is missing.
+class TextureStreamer
+{
+public:
+    TextureStreamer(Renderer* pRenderer, uint32_t budget);
+    ~TextureStreamer();
+
+    //returns nullptr if the texture can't be streamed, it should be created as a regular texture then
+    Texture2D* CreateTexture(const TextureLoader& loader, const eastl::string& file, bool srgb);
+    void RemoveTexture(Texture2D* texture);
+
+    //reads the feedback of this frame index back, should be called after waiting for its fence
+    void Update();
+
+    //requested_mips[streaming index] : finest mip needed by each texture, GFX_INVALID_RESOURCE if not visible
+    void ProcessFeedback(const uint32_t* requested_mips, uint32_t count);
+
+    void ClearFeedback(IGfxCommandList* pCommandList);
+    void CopyFeedback(IGfxCommandList* pCommandList);
+
+    IGfxDescriptor* GetFeedbackUAV() const { return m_pFeedbackBuffer->GetUAV(); }
+    uint32_t GetResidencyAddress() const { return m_nResidencyAddress; } //min LOD of each texture, in the scene constant buffer
+
+    uint32_t GetTextureCount() const { return (uint32_t)(m_textures.size() - m_freeIndices.size()); }
+    uint32_t GetResidentMip(uint32_t streaming_index) const;
+    uint64_t GetBudget() const { return (uint64_t)m_nTileCount * GFX_TILE_SIZE; }
+    uint64_t GetResidentSize() const { return (uint64_t)(m_nTileCount - m_freeTiles.size()) * GFX_TILE_SIZE; }
+    uint64_t GetTotalSize() const { return m_nTotalSize; } //if every streamed texture was fully loaded
+
+    void OnGui();
+
+private:
+    struct StreamedTexture
+    {
+        Texture2D* texture = nullptr;
+        eastl::string file;
+        bool srgb = false;
+        bool loading = false; //requested from the AsyncTextureLoader
+        bool loadFailed = false;
+        eastl::unique_ptr<TextureLoader> loader; //only while some requested mips are missing
+        eastl::vector<uint32_t> mipOffsets; //in the loader data
+
+        uint32_t standardMips = 0;
+        uint32_t residentMip = 0;  //finest resident mip, standardMips if only the packed tail is resident
+        uint32_t requestedMip = 0;
+        uint64_t lastUsedFrame = 0;
+
+        eastl::vector<eastl::vector<uint32_t>> mipTiles; //heap tiles of each standard mip
+        eastl::vector<uint32_t> packedTiles;
+    };
+
+    bool AllocateTiles(uint32_t count, uint32_t exclude_index, eastl::vector<uint32_t>& tiles);
+    void FreeTiles(eastl::vector<uint32_t>& tiles);
+    bool EvictMip(uint32_t exclude_index);
+    bool ReadFile(StreamedTexture* texture); //returns false while the file is loading
+    void ReleaseFile(StreamedTexture* texture);
+    bool MapMip(uint32_t index, uint32_t mip);
+    void MapPackedMips(StreamedTexture* texture, const uint8_t* data);
+    void UpdateResidency();
+
+private:
+    Renderer* m_pRenderer = nullptr;
+
+    eastl::unique_ptr<IGfxHeap> m_pHeap;
+    uint32_t m_nTileCount = 0;
+    eastl::vector<uint32_t> m_freeTiles;
+    eastl::vector<eastl::pair<uint32_t, uint64_t>> m_pendingFreeTiles; //(tile, frame id), may still be sampled by the frames in flight
+
+    eastl::vector<eastl::unique_ptr<StreamedTexture>> m_textures; //indexed by the streaming index
+    eastl::vector<uint32_t> m_freeIndices;
+    uint64_t m_nTotalSize = 0;
+
+    eastl::unique_ptr<RawBuffer> m_pFeedbackBuffer;
+    eastl::unique_ptr<IGfxBuffer> m_pFeedbackReadbackBuffer[GFX_MAX_INFLIGHT_FRAMES];
+    bool m_bFeedbackReady[GFX_MAX_INFLIGHT_FRAMES] = {};
+
+    uint32_t m_nResidencyAddress = 0;
+    uint32_t m_nMaxUploadTilesPerFrame = 256;
+    uint32_t m_nUploadedTiles = 0;
+    uint32_t m_nEvictedTiles = 0;
+};
@@ -0,0 +1,106 @@
+#include "vertex_skinning.h"
+#include "renderer.h"
+#include "utils/gui_util.h"
+#include "utils/profiler.h"
+
+static const uint32_t MAX_DISPATCH_GROUP_COUNT = 65535;
+
+VertexSkinning::VertexSkinning(Renderer* pRenderer, uint32_t thread_count)
+{
+    m_pRenderer = pRenderer;
+    m_threadJobs.Init(thread_count);
+
+    GfxComputePipelineDesc desc;
+    desc.cs = pRenderer->GetShader("vertex_skinning.hlsl", "main", GfxShaderType::CS);
+    m_pPSO = pRenderer->GetPipelineState(desc, "vertex skinning PSO");
+}
+
+void VertexSkinning::AddJob(uint32_t thread_index, uint64_t key, const VertexSkinningJob& job)
+{
+    m_threadJobs.Add(thread_index, key, job);
+}
+
+void VertexSkinning::Upload()
+{
+    m_jobs.clear();
+    m_threadJobs.Merge(m_jobs);
+
+    m_nGroupCount = 0;
+    uint32_t vertex_count = 0;
+
+    for (size_t i = 0; i < m_jobs.size(); ++i)
+    {
+        m_jobs[i].firstGroup = m_nGroupCount;
+
+        m_nGroupCount += DivideRoudingUp(m_jobs[i].vertexCount, VERTEX_SKINNING_GROUP_SIZE);
+        vertex_count += m_jobs[i].vertexCount;
+    }
+
+    if (!m_jobs.empty())
+    {
+        m_jobBufferAddress = m_pRenderer->AllocateSceneConstant(m_jobs.data(), sizeof(VertexSkinningJob) * (uint32_t)m_jobs.size());
+    }
+
+    m_stats.jobs = (uint32_t)m_jobs.size();
+    m_stats.vertices = vertex_count;
+    m_stats.groups = m_nGroupCount;
+    m_stats.dispatches = 0;
+}
+
+void VertexSkinning::Dispatch(IGfxCommandList* pCommandList)
+{
+    if (m_nGroupCount == 0)
+    {
+        m_jobs.clear();
+        return;
+    }
+
+    GPU_EVENT(pCommandList, "VertexSkinning");
+
+    pCommandList->SetPipelineState(m_pPSO);
+
+    if (m_bBatched)
+    {
+        uint32_t group_count_x = eastl::min(m_nGroupCount, MAX_DISPATCH_GROUP_COUNT);
+        uint32_t group_count_y = DivideRoudingUp(m_nGroupCount, group_count_x);
+
+        uint32_t cb[4] = { (uint32_t)m_jobs.size(), m_jobBufferAddress, 0, group_count_x };
+        pCommandList->SetComputeConstants(1, cb, sizeof(cb));
+        pCommandList->Dispatch(group_count_x, group_count_y, 1);
+
+        m_stats.dispatches = 1;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < (uint32_t)m_jobs.size(); ++i)
+        {
+            uint32_t group_count = DivideRoudingUp(m_jobs[i].vertexCount, VERTEX_SKINNING_GROUP_SIZE);
+            if (group_count == 0)
+            {
+                continue;
+            }
+
+            uint32_t group_count_x = eastl::min(group_count, MAX_DISPATCH_GROUP_COUNT);
+            uint32_t group_count_y = DivideRoudingUp(group_count, group_count_x);
+
+            uint32_t cb[4] = { 1, m_jobBufferAddress + (uint32_t)sizeof(VertexSkinningJob) * i, m_jobs[i].firstGroup, group_count_x };
+            pCommandList->SetComputeConstants(1, cb, sizeof(cb));
+            pCommandList->Dispatch(group_count_x, group_count_y, 1);
+
+            m_stats.dispatches++;
+        }
+    }
+
+    m_jobs.clear();
+}
+
+void VertexSkinning::OnGui()
+{
+    if (ImGui::CollapsingHeader("Vertex Skinning"))
+    {
+        ImGui::Text("Last frame : %u meshes, %u vertices, %u thread groups, %u dispatches", m_stats.jobs, m_stats.vertices, m_stats.groups, m_stats.dispatches);
+
+        ImGui::Checkbox("Single Dispatch##VertexSkinning", &m_bBatched);
+        ImGui::Checkbox("Skin Previous Positions##VertexSkinning", &m_bSkinPreviousPositions);
+    }
+}
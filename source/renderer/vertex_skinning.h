@@ -0,0 +1,53 @@
+#pragma once
+
+#include "render_batch.h"
+#include "vertex_skinning.hlsli"
+#include "EASTL/vector.h"
+
+class Renderer;
+
+struct VertexSkinningStats
+{
+    //last frame
+    uint32_t jobs = 0;
+    uint32_t vertices = 0;
+    uint32_t groups = 0;
+    uint32_t dispatches = 0;
+};
+
+//skins all the skinned meshes of the frame in one pass : the jobs are packed in the scene constant buffer,
+//and one dispatch covers the thread groups of all of them, each group finding its job with a binary search.
+//the previous positions can be skinned in the same pass from the previous joint matrices, instead of keeping the last output
+class VertexSkinning
+{
+public:
+    VertexSkinning(Renderer* pRenderer, uint32_t thread_count);
+
+    //can be called from the task threads, the jobs are ordered by their batch key so the result does not depend on the scheduling
+    void AddJob(uint32_t thread_index, uint64_t key, const VertexSkinningJob& job);
+
+    //gathers the jobs of all threads, assigns their thread groups and uploads them
+    void Upload();
+    void Dispatch(IGfxCommandList* pCommandList);
+    bool HasJobs() const { return !m_jobs.empty(); }
+
+    bool IsPreviousPositionEnabled() const { return m_bSkinPreviousPositions; }
+
+    const VertexSkinningStats& GetStats() const { return m_stats; }
+    void OnGui();
+
+private:
+    Renderer* m_pRenderer = nullptr;
+    IGfxPipelineState* m_pPSO = nullptr;
+
+    ThreadBatchList<VertexSkinningJob> m_threadJobs;
+
+    eastl::vector<VertexSkinningJob> m_jobs;
+    uint32_t m_jobBufferAddress = 0;
+    uint32_t m_nGroupCount = 0;
+
+    bool m_bBatched = true; //one dispatch per job if false, for comparison
+    bool m_bSkinPreviousPositions = false;
+
+    VertexSkinningStats m_stats;
+};
@@ -64,6 +64,8 @@ set(METAL_FILES
 
 set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/source.cmake
+    ${SOURCE_ROOT}/core/benchmark.cpp
+    ${SOURCE_ROOT}/core/benchmark.h
     ${SOURCE_ROOT}/core/eastl_allocator.cpp
     ${SOURCE_ROOT}/core/engine.cpp
     ${SOURCE_ROOT}/core/engine.h
@@ -78,6 +80,8 @@ set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/gfx/mock/mock_buffer.h
     ${SOURCE_ROOT}/gfx/mock/mock_command_list.cpp
     ${SOURCE_ROOT}/gfx/mock/mock_command_list.h
+    ${SOURCE_ROOT}/gfx/mock/mock_command_stream.cpp
+    ${SOURCE_ROOT}/gfx/mock/mock_command_stream.h
     ${SOURCE_ROOT}/gfx/mock/mock_descriptor.cpp
     ${SOURCE_ROOT}/gfx/mock/mock_descriptor.h
     ${SOURCE_ROOT}/gfx/mock/mock_device.cpp
@@ -247,6 +251,10 @@ set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/renderer/resource/texture_cube.h
     ${SOURCE_ROOT}/renderer/resource/typed_buffer.cpp
     ${SOURCE_ROOT}/renderer/resource/typed_buffer.h
+    ${SOURCE_ROOT}/renderer/async_texture_loader.cpp
+    ${SOURCE_ROOT}/renderer/async_texture_loader.h
+    ${SOURCE_ROOT}/renderer/baked_asset_cache.cpp
+    ${SOURCE_ROOT}/renderer/baked_asset_cache.h
     ${SOURCE_ROOT}/renderer/base_pass.cpp
     ${SOURCE_ROOT}/renderer/base_pass.h
     ${SOURCE_ROOT}/renderer/clear_uav.cpp
@@ -271,6 +279,13 @@ set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/renderer/path_tracer.h
     ${SOURCE_ROOT}/renderer/pipeline_cache.cpp
     ${SOURCE_ROOT}/renderer/pipeline_cache.h
+    ${SOURCE_ROOT}/renderer/ray_tracing_blas_builder.cpp
+    ${SOURCE_ROOT}/renderer/ray_tracing_blas_builder.h
+    ${SOURCE_ROOT}/renderer/ray_tracing_skinned_blas_updater.cpp
+    ${SOURCE_ROOT}/renderer/ray_tracing_skinned_blas_updater.h
+    ${SOURCE_ROOT}/renderer/ray_tracing_tlas_tracker.cpp
+    ${SOURCE_ROOT}/renderer/ray_tracing_tlas_tracker.h
+    ${SOURCE_ROOT}/renderer/render_batch.cpp
     ${SOURCE_ROOT}/renderer/render_batch.h
     ${SOURCE_ROOT}/renderer/render_graph.cpp
     ${SOURCE_ROOT}/renderer/render_graph.h
@@ -296,8 +311,14 @@ set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/renderer/staging_buffer_allocator.h
     ${SOURCE_ROOT}/renderer/stbn.cpp
     ${SOURCE_ROOT}/renderer/stbn.h
+    ${SOURCE_ROOT}/renderer/texture_cooker.cpp
+    ${SOURCE_ROOT}/renderer/texture_cooker.h
     ${SOURCE_ROOT}/renderer/texture_loader.cpp
     ${SOURCE_ROOT}/renderer/texture_loader.h
+    ${SOURCE_ROOT}/renderer/texture_streamer.cpp
+    ${SOURCE_ROOT}/renderer/texture_streamer.h
+    ${SOURCE_ROOT}/renderer/vertex_skinning.cpp
+    ${SOURCE_ROOT}/renderer/vertex_skinning.h
     ${SOURCE_ROOT}/utils/assert.h
     ${SOURCE_ROOT}/utils/autorelease_pool.h
     ${SOURCE_ROOT}/utils/fmt.h
@@ -306,12 +327,21 @@ set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/utils/log.h
     ${SOURCE_ROOT}/utils/math.h
     ${SOURCE_ROOT}/utils/memory.h
+    ${SOURCE_ROOT}/utils/memory_mapped_file.h
     ${SOURCE_ROOT}/utils/parallel_for.h
     ${SOURCE_ROOT}/utils/profiler.h
     ${SOURCE_ROOT}/utils/string.h
     ${SOURCE_ROOT}/utils/system.h
     ${SOURCE_ROOT}/world/animation.cpp
     ${SOURCE_ROOT}/world/animation.h
+    ${SOURCE_ROOT}/world/animation_blend.cpp
+    ${SOURCE_ROOT}/world/animation_blend.h
+    ${SOURCE_ROOT}/world/animation_compression.cpp
+    ${SOURCE_ROOT}/world/animation_compression.h
+    ${SOURCE_ROOT}/world/animation_state_machine.cpp
+    ${SOURCE_ROOT}/world/animation_state_machine.h
+    ${SOURCE_ROOT}/world/animation_system.cpp
+    ${SOURCE_ROOT}/world/animation_system.h
     ${SOURCE_ROOT}/world/billboard_sprite.cpp
     ${SOURCE_ROOT}/world/billboard_sprite.h
     ${SOURCE_ROOT}/world/camera.cpp
@@ -346,6 +376,22 @@ set(ENGINE_SRC_FILES
     ${SOURCE_ROOT}/world/world.h
 )
 
+# self tests, built as RealEngineTests on Linux
+set(TEST_FILES
+    ${SOURCE_ROOT}/tests/animation_blend_tests.cpp
+    ${SOURCE_ROOT}/tests/animation_compression_tests.cpp
+    ${SOURCE_ROOT}/tests/animation_state_machine_tests.cpp
+    ${SOURCE_ROOT}/tests/animation_system_tests.cpp
+    ${SOURCE_ROOT}/tests/animation_tests.cpp
+    ${SOURCE_ROOT}/tests/async_texture_loader_tests.cpp
+    ${SOURCE_ROOT}/tests/clustered_light_lists_tests.cpp
+    ${SOURCE_ROOT}/tests/hash_grid_radiance_cache_tests.cpp
+    ${SOURCE_ROOT}/tests/main.cpp
+    ${SOURCE_ROOT}/tests/ray_tracing_tlas_tracker_tests.cpp
+    ${SOURCE_ROOT}/tests/tests.h
+    ${SOURCE_ROOT}/tests/tiled_light_trees_tests.cpp
+)
+
 if(CMAKE_SYSTEM_NAME STREQUAL "Windows")
     list(APPEND ENGINE_SRC_FILES 
         ${D3D12_FILES}
@@ -358,6 +404,10 @@ elseif(CMAKE_SYSTEM_NAME STREQUAL "Darwin")
         ${SOURCE_ROOT}/main/mac/main.cpp
         ${SOURCE_ROOT}/renderer/shader_compiler_metal.cpp
     )
+elseif(CMAKE_SYSTEM_NAME STREQUAL "Linux")
+    list(APPEND ENGINE_SRC_FILES 
+        ${SOURCE_ROOT}/main/linux/main.cpp
+    )
 elseif(CMAKE_SYSTEM_NAME STREQUAL "iOS")
     list(APPEND ENGINE_SRC_FILES 
         ${METAL_FILES}
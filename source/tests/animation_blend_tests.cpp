@@ -0,0 +1,204 @@
+#include "tests.h"
+#include "world/animation_blend.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+
+static float GetPoseError(const AnimationPose& a, const AnimationPose& b)
+{
+    float error = 0.0f;
+    for (size_t i = 0; i < a.translations.size(); ++i)
+    {
+        error = eastl::max(error, maxelem(abs(a.translations[i] - b.translations[i])));
+        error = eastl::max(error, 1.0f - fabsf(dot(a.rotations[i], b.rotations[i]))); //q and -q are the same rotation
+        error = eastl::max(error, maxelem(abs(a.scales[i] - b.scales[i])));
+    }
+    return error;
+}
+
+static AnimationPose MakeTestPose(uint32_t node_count, float seed)
+{
+    AnimationPose pose;
+    pose.translations.resize(node_count);
+    pose.rotations.resize(node_count);
+    pose.scales.resize(node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        float phase = seed + i * 0.37f;
+        pose.translations[i] = float3(sinf(phase), cosf(phase * 1.3f), 0.5f * sinf(phase * 0.7f));
+        pose.rotations[i] = rotation_quat(normalize(float3(sinf(phase), 1.0f, cosf(phase))), 2.0f * sinf(phase * 1.7f));
+        pose.scales[i] = float3(1.0f + 0.2f * sinf(phase), 1.0f, 1.0f - 0.1f * cosf(phase));
+    }
+    return pose;
+}
+
+bool TestAnimationBlending()
+{
+    const float tolerance = 1e-5f;
+    uint32_t failures = 0;
+
+    auto check = [&](const char* name, float error)
+    {
+        if (error > tolerance)
+        {
+            RE_ERROR("[AnimationBlending] {} failed, error {}", name, error);
+            ++failures;
+        }
+    };
+
+    //0 - 1 - 2 - 3
+    //     \- 4 - 5
+    eastl::vector<int32_t> node_parents = { -1, 0, 1, 2, 1, 4 };
+    AnimationHierarchy hierarchy;
+    hierarchy.Build(node_parents);
+    uint32_t node_count = hierarchy.GetNodeCount();
+
+    AnimationPose a = MakeTestPose(node_count, 0.0f);
+    AnimationPose b = MakeTestPose(node_count, 2.0f);
+    AnimationPose c = MakeTestPose(node_count, 4.0f);
+    AnimationPoseBlender blender;
+    AnimationPose result = a;
+
+    //single pose, and a pose with itself
+    {
+        const AnimationPose* poses[] = { &b, &b };
+        float weights[] = { 0.3f, 0.7f };
+        BlendPoses(poses, weights, nullptr, 1, blender, result);
+        check("single pose", GetPoseError(result, b));
+
+        result = a;
+        BlendPoses(poses, weights, nullptr, 2, blender, result);
+        check("pose with itself", GetPoseError(result, b));
+    }
+
+    //zero weights pick the other pose
+    {
+        const AnimationPose* poses[] = { &a, &b };
+        float weights[] = { 0.0f, 1.0f };
+        result = c;
+        BlendPoses(poses, weights, nullptr, 2, blender, result);
+        check("zero weight", GetPoseError(result, b));
+    }
+
+    //two poses against linalg lerp/qnlerp, with b rotations negated to test the hemisphere flip
+    {
+        AnimationPose negated_b = b;
+        for (uint32_t i = 0; i < node_count; ++i)
+        {
+            negated_b.rotations[i] = -negated_b.rotations[i];
+        }
+
+        AnimationPose expected = a;
+        for (uint32_t i = 0; i < node_count; ++i)
+        {
+            expected.translations[i] = lerp(a.translations[i], b.translations[i], 0.25f);
+            expected.rotations[i] = qnlerp(a.rotations[i], b.rotations[i], 0.25f);
+            expected.scales[i] = lerp(a.scales[i], b.scales[i], 0.25f);
+        }
+
+        const AnimationPose* poses[] = { &a, &negated_b };
+        float weights[] = { 0.75f, 0.25f };
+        BlendPoses(poses, weights, nullptr, 2, blender, result);
+        check("two poses", GetPoseError(result, expected));
+
+        result = a;
+        OverridePose(result, negated_b, 0.25f);
+        check("override", GetPoseError(result, expected));
+    }
+
+    //weights are normalized
+    {
+        const AnimationPose* poses[] = { &a, &b, &c };
+        float weights[] = { 1.0f, 2.0f, 1.0f };
+        float normalized_weights[] = { 0.25f, 0.5f, 0.25f };
+
+        AnimationPose expected = a;
+        BlendPoses(poses, normalized_weights, nullptr, 3, blender, expected);
+        BlendPoses(poses, weights, nullptr, 3, blender, result);
+        check("weight normalization", GetPoseError(result, expected));
+    }
+
+    //a mask on node 4 affects only 4 and 5, the other nodes keep the base pose
+    {
+        AnimationMask mask;
+        mask.Build(hierarchy, 4);
+
+        uint32_t masked_nodes = 0;
+        for (uint32_t i = 0; i < node_count; ++i)
+        {
+            uint32_t node = hierarchy.indexToNode[i];
+            bool expected = node == 4 || node == 5;
+            masked_nodes += (mask.weights[i] == 1.0f) == expected ? 1 : 0;
+        }
+        check("mask nodes", (float)(node_count - masked_nodes));
+
+        AnimationPose expected = a;
+        for (uint32_t i = 0; i < node_count; ++i)
+        {
+            if (mask.weights[i] > 0.0f)
+            {
+                expected.translations[i] = b.translations[i];
+                expected.rotations[i] = b.rotations[i];
+                expected.scales[i] = b.scales[i];
+            }
+        }
+
+        const AnimationPose* poses[] = { &a, &b };
+        const AnimationMask* masks[] = { nullptr, &mask };
+        float weights[] = { 0.0f, 1.0f };
+        result = a;
+        BlendPoses(poses, weights, masks, 2, blender, result);
+        check("masked blend", GetPoseError(result, expected));
+
+        result = a;
+        OverridePose(result, b, 1.0f, &mask);
+        check("masked override", GetPoseError(result, expected));
+    }
+
+    //additive : the difference of b to a, added on a, gives b back. a zero weight keeps the pose
+    {
+        AnimationPose additive;
+        MakeAdditivePose(b, a, additive);
+
+        result = a;
+        AddPose(result, additive, 1.0f);
+        check("additive", GetPoseError(result, b));
+
+        result = c;
+        AddPose(result, additive, 0.0f);
+        check("additive zero weight", GetPoseError(result, c));
+
+        //an additive made from the same pose twice is the identity
+        MakeAdditivePose(c, c, additive);
+        result = b;
+        AddPose(result, additive, 0.6f);
+        check("identity additive", GetPoseError(result, b));
+    }
+
+    //blending throughput on a 64 nodes pose
+    {
+        const uint32_t bench_nodes = 64;
+        const uint32_t iterations = 20000;
+
+        AnimationPose pose0 = MakeTestPose(bench_nodes, 0.0f);
+        AnimationPose pose1 = MakeTestPose(bench_nodes, 1.0f);
+        AnimationPose pose2 = MakeTestPose(bench_nodes, 2.0f);
+        AnimationPose output = pose0;
+
+        const AnimationPose* poses[] = { &pose0, &pose1, &pose2 };
+        float weights[] = { 0.5f, 0.3f, 0.2f };
+
+        uint64_t start = stm_now();
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            weights[0] = 0.5f + 0.1f * (i & 1);
+            BlendPoses(poses, weights, nullptr, 3, blender, output);
+        }
+        double ns_per_node = stm_ns(stm_since(start)) / ((double)iterations * bench_nodes * 3);
+
+        RE_INFO("[AnimationBlending] 3 poses x {} nodes : {:.2f} ns per node and pose", bench_nodes, ns_per_node);
+    }
+
+    RE_INFO("[AnimationBlending] {} failures", failures);
+    return failures == 0;
+}
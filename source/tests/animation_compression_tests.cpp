@@ -0,0 +1,190 @@
+#include "tests.h"
+#include "world/animation_compression.h"
+#include "utils/log.h"
+#include "EASTL/algorithm.h"
+
+//global positions of every node and of a point at leaf_length below each node, for the local poses sampled from a clip
+static void ComputeNodePositions(const AnimationCompressionSettings& settings, const AnimationClip& clip, const AnimationSample& sample,
+    const eastl::vector<uint32_t>& order, eastl::vector<float3>& positions)
+{
+    uint32_t node_count = (uint32_t)settings.parents.size();
+
+    eastl::vector<float3> translations(settings.restTranslations.begin(), settings.restTranslations.end());
+    eastl::vector<float4> rotations(node_count, float4(0.0f, 0.0f, 0.0f, 1.0f));
+    eastl::vector<float3> scales(node_count, float3(1.0f, 1.0f, 1.0f));
+
+    for (uint32_t i = 0; i < clip.GetTrackCount(); ++i)
+    {
+        uint32_t node = clip.GetTargetNode(i);
+        switch (clip.GetMode(i))
+        {
+        case AnimationChannelMode::Translation:
+            translations[node] = sample.GetFloat3(i);
+            break;
+        case AnimationChannelMode::Rotation:
+            rotations[node] = sample.GetFloat4(i);
+            break;
+        case AnimationChannelMode::Scale:
+            scales[node] = sample.GetFloat3(i);
+            break;
+        }
+    }
+
+    eastl::vector<float4x4> globals(node_count);
+    positions.resize(node_count * 2);
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        uint32_t node = order[i];
+        float4x4 local = mul(translation_matrix(translations[node]), mul(rotation_matrix(rotations[node]), scaling_matrix(scales[node])));
+        globals[node] = settings.parents[node] < 0 ? local : mul(globals[settings.parents[node]], local);
+
+        positions[node * 2] = globals[node][3].xyz();
+        positions[node * 2 + 1] = mul(globals[node], float4(0.0f, settings.leafLength, 0.0f, 1.0f)).xyz();
+    }
+}
+
+bool TestAnimationCompression()
+{
+    //a humanoid like skeleton : root, spine and head, two arms, two legs
+    AnimationCompressionSettings settings;
+    settings.tolerance = 0.001f;
+    settings.leafLength = 0.1f;
+
+    auto add_node = [&](int32_t parent, const float3& translation)
+    {
+        settings.parents.push_back(parent);
+        settings.restTranslations.push_back(translation);
+        return (int32_t)settings.parents.size() - 1;
+    };
+
+    int32_t root = add_node(-1, float3(0.0f, 1.0f, 0.0f));
+    int32_t spine = root;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        spine = add_node(spine, float3(0.0f, 0.15f, 0.0f));
+    }
+    add_node(add_node(spine, float3(0.0f, 0.1f, 0.0f)), float3(0.0f, 0.15f, 0.0f));
+
+    for (float side = -1.0f; side <= 1.0f; side += 2.0f)
+    {
+        int32_t arm = add_node(spine, float3(side * 0.15f, 0.0f, 0.0f));
+        for (uint32_t i = 0; i < 4; ++i)
+        {
+            arm = add_node(arm, float3(side * 0.15f, 0.0f, 0.0f));
+        }
+
+        int32_t leg = add_node(root, float3(side * 0.1f, -0.05f, 0.0f));
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            leg = add_node(leg, float3(0.0f, -0.25f, 0.0f));
+        }
+    }
+
+    uint32_t node_count = (uint32_t)settings.parents.size();
+
+    //10 seconds at 60 fps : smooth motion on most joints, a few constant tracks, the root walks forward
+    const uint32_t key_count = 600;
+    const float frame_time = 1.0f / 60.0f;
+
+    eastl::vector<AnimationChannel> channels;
+    for (uint32_t node = 0; node < node_count; ++node)
+    {
+        AnimationChannel rotation;
+        rotation.targetNode = node;
+        rotation.mode = AnimationChannelMode::Rotation;
+
+        bool constant = node % 5 == 4;
+        for (uint32_t k = 0; k < key_count; ++k)
+        {
+            float t = k * frame_time;
+            float phase = node * 0.7f;
+            float3 axis = normalize(float3(sinf(phase), 1.0f, cosf(phase)));
+            float angle = constant ? 0.3f : 0.6f * sinf(t * (1.5f + 0.1f * node) + phase) + 0.1f * sinf(t * 7.0f);
+            rotation.keyframes.push_back(eastl::make_pair(t, rotation_quat(axis, angle)));
+        }
+        channels.push_back(eastl::move(rotation));
+    }
+
+    AnimationChannel translation;
+    translation.targetNode = (uint32_t)root;
+    translation.mode = AnimationChannelMode::Translation;
+
+    AnimationChannel scale;
+    scale.targetNode = (uint32_t)spine;
+    scale.mode = AnimationChannelMode::Scale;
+
+    for (uint32_t k = 0; k < key_count; ++k)
+    {
+        float t = k * frame_time;
+        translation.keyframes.push_back(eastl::make_pair(t, float4(0.1f * sinf(t * 2.0f), 1.0f + 0.05f * sinf(t * 4.0f), 1.5f * t, 0.0f)));
+
+        float s = 1.0f + 0.05f * sinf(t * 3.0f);
+        scale.keyframes.push_back(eastl::make_pair(t, float4(s, s, s, 0.0f)));
+    }
+    channels.push_back(eastl::move(translation));
+    channels.push_back(eastl::move(scale));
+
+    AnimationClip raw_clip("synthetic_raw", channels);
+    AnimationClip compressed_clip("synthetic", channels, &settings);
+
+    //the clips convert the values to the engine handedness, which does not change the lengths
+    eastl::vector<uint32_t> order;
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        if (settings.parents[i] < 0)
+        {
+            order.push_back(i);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        for (uint32_t c = 0; c < node_count; ++c)
+        {
+            if (settings.parents[c] == (int32_t)order[i])
+            {
+                order.push_back(c);
+            }
+        }
+    }
+
+    AnimationCursor raw_cursor, compressed_cursor;
+    raw_clip.InitCursor(raw_cursor);
+    compressed_clip.InitCursor(compressed_cursor);
+
+    AnimationSample raw_sample, compressed_sample;
+    eastl::vector<float3> raw_positions, compressed_positions;
+
+    const uint32_t sample_count = 2000;
+    float max_error = 0.0f;
+    double total_error = 0.0;
+
+    for (uint32_t i = 0; i < sample_count; ++i)
+    {
+        float time = raw_clip.GetDuration() * i / (sample_count - 1);
+
+        raw_clip.Sample(time, raw_cursor, raw_sample);
+        compressed_clip.Sample(time, compressed_cursor, compressed_sample);
+
+        ComputeNodePositions(settings, raw_clip, raw_sample, order, raw_positions);
+        ComputeNodePositions(settings, compressed_clip, compressed_sample, order, compressed_positions);
+
+        for (size_t p = 0; p < raw_positions.size(); ++p)
+        {
+            float error = length(raw_positions[p] - compressed_positions[p]);
+            max_error = eastl::max(max_error, error);
+            total_error += error;
+        }
+    }
+
+    float mean_error = (float)(total_error / (sample_count * node_count * 2));
+    bool success = max_error <= settings.tolerance;
+
+    RE_INFO("[AnimationCompression] {} nodes, {} of {} keys kept, {:.1f} KB vs {:.1f} KB raw ({:.1f} KB as float4 keyframes)",
+        node_count, compressed_clip.GetKeyCount(), compressed_clip.GetRawKeyCount(), compressed_clip.GetMemorySize() / 1024.0f,
+        raw_clip.GetMemorySize() / 1024.0f, compressed_clip.GetRawKeyCount() * sizeof(eastl::pair<float, float4>) / 1024.0f);
+    RE_INFO("[AnimationCompression] position error : max {:.3f} mm, mean {:.4f} mm, tolerance {:.3f} mm : {}",
+        max_error * 1000.0f, mean_error * 1000.0f, settings.tolerance * 1000.0f, success ? "passed" : "FAILED");
+
+    return success;
+}
@@ -0,0 +1,160 @@
+#include "tests.h"
+#include "world/animation_state_machine.h"
+#include "utils/log.h"
+
+//a clip holding the same translation and rotation on every node from 0 to duration
+static eastl::shared_ptr<AnimationClip> MakeTestClip(const char* name, uint32_t node_count, float seed, float duration)
+{
+    eastl::vector<AnimationChannel> channels;
+    for (uint32_t node = 0; node < node_count; ++node)
+    {
+        float phase = seed + node * 0.61f;
+
+        AnimationChannel translation;
+        translation.targetNode = node;
+        translation.mode = AnimationChannelMode::Translation;
+        translation.keyframes.push_back(eastl::make_pair(0.0f, float4(sinf(phase), 1.0f, cosf(phase), 0.0f)));
+        translation.keyframes.push_back(eastl::make_pair(duration, float4(sinf(phase), 1.0f, cosf(phase), 0.0f)));
+        channels.push_back(translation);
+
+        AnimationChannel rotation;
+        rotation.targetNode = node;
+        rotation.mode = AnimationChannelMode::Rotation;
+        rotation.keyframes.push_back(eastl::make_pair(0.0f, rotation_quat(normalize(float3(sinf(phase), 1.0f, 0.5f)), phase)));
+        rotation.keyframes.push_back(eastl::make_pair(duration, rotation_quat(normalize(float3(sinf(phase), 1.0f, 0.5f)), phase)));
+        channels.push_back(rotation);
+    }
+
+    return eastl::make_shared<AnimationClip>(name, channels);
+}
+
+bool TestAnimationStateMachine()
+{
+    const float tolerance = 1e-5f;
+    uint32_t failures = 0;
+
+    auto check = [&](const char* name, const AnimationPose& pose, const AnimationPose& expected)
+    {
+        float error = 0.0f;
+        for (size_t i = 0; i < pose.translations.size(); ++i)
+        {
+            error = eastl::max(error, maxelem(abs(pose.translations[i] - expected.translations[i])));
+            error = eastl::max(error, 1.0f - fabsf(dot(pose.rotations[i], expected.rotations[i])));
+        }
+
+        if (error > tolerance)
+        {
+            RE_ERROR("[AnimationStateMachine] {} failed, error {}", name, error);
+            ++failures;
+        }
+    };
+
+    //0 - 1 - 2
+    //     \- 3
+    eastl::vector<int32_t> node_parents = { -1, 0, 1, 1 };
+    eastl::vector<eastl::string> node_names = { "root", "spine", "head", "arm" };
+    AnimationHierarchy hierarchy;
+    hierarchy.Build(node_parents);
+    uint32_t node_count = hierarchy.GetNodeCount();
+
+    eastl::vector<eastl::shared_ptr<AnimationClip>> clips;
+    clips.push_back(MakeTestClip("idle", node_count, 0.0f, 1.0f));
+    clips.push_back(MakeTestClip("walk", node_count, 1.5f, 1.0f));
+
+    //an additive wave of the arm : identity at 0, rotated from 1s
+    {
+        eastl::vector<AnimationChannel> channels(1);
+        channels[0].targetNode = 3;
+        channels[0].mode = AnimationChannelMode::Rotation;
+        channels[0].keyframes.push_back(eastl::make_pair(0.0f, float4(0.0f, 0.0f, 0.0f, 1.0f)));
+        channels[0].keyframes.push_back(eastl::make_pair(1.0f, rotation_quat(float3(0.0f, 0.0f, 1.0f), 0.8f)));
+        channels[0].keyframes.push_back(eastl::make_pair(4.0f, rotation_quat(float3(0.0f, 0.0f, 1.0f), 0.8f)));
+        clips.push_back(eastl::make_shared<AnimationClip>("wave", channels));
+    }
+
+    AnimationStateMachineDesc desc;
+    desc.parameters = { { "speed", 0.0f }, { "wave", 0.0f } };
+    desc.states = { { "idle", "idle" }, { "walk", "walk" } };
+
+    AnimationTransitionDesc transition;
+    transition.from = "idle";
+    transition.to = "walk";
+    transition.duration = 0.5f;
+    transition.conditions.push_back({ "speed", AnimationConditionOp::Greater, 0.5f });
+    desc.transitions.push_back(transition);
+
+    AnimationLayerDesc layer;
+    layer.clip = "wave";
+    layer.mask = "arm";
+    layer.weightParameter = "wave";
+    layer.additive = true;
+    desc.layers.push_back(layer);
+
+    AnimationPose rest_pose;
+    rest_pose.translations.resize(node_count, float3(0.0f, 0.5f, 0.0f));
+    rest_pose.rotations.resize(node_count, float4(0.0f, 0.0f, 0.0f, 1.0f));
+    rest_pose.scales.resize(node_count, float3(1.0f, 1.0f, 1.0f));
+
+    AnimationStateMachine state_machine(desc, clips);
+    state_machine.Bind(hierarchy, node_names, rest_pose);
+
+    //the expected poses, sampled directly from the clips
+    AnimationPose idle = rest_pose;
+    AnimationPose walk = rest_pose;
+    Animation idle_animation(clips[0]);
+    Animation walk_animation(clips[1]);
+    idle_animation.Bind(hierarchy);
+    walk_animation.Bind(hierarchy);
+    idle_animation.Update(0.0f, idle);
+    walk_animation.Update(0.0f, walk);
+
+    AnimationPose pose;
+    state_machine.Update(0.1f, pose);
+    check("initial state", pose, idle);
+
+    //no transition before the condition is met
+    state_machine.Update(0.1f, pose);
+    check("condition not met", pose, idle);
+
+    //half way through the cross fade
+    state_machine.SetParameter("speed", 1.0f);
+    state_machine.Update(0.25f, pose);
+
+    AnimationPoseBlender blender;
+    AnimationPose expected = idle;
+    {
+        const AnimationPose* poses[] = { &idle, &walk };
+        float weights[] = { 0.5f, 0.5f };
+        BlendPoses(poses, weights, nullptr, 2, blender, expected);
+    }
+    check("cross fade", pose, expected);
+    if (!state_machine.IsInTransition())
+    {
+        RE_ERROR("[AnimationStateMachine] the transition did not start");
+        ++failures;
+    }
+
+    state_machine.Update(0.25f, pose);
+    check("transition end", pose, walk);
+    if (state_machine.IsInTransition() || state_machine.GetCurrentState() != 1)
+    {
+        RE_ERROR("[AnimationStateMachine] the transition did not end");
+        ++failures;
+    }
+
+    //the additive layer starts when its weight parameter is set, and only rotates the arm
+    state_machine.SetParameter("wave", 1.0f);
+    state_machine.Update(2.0f, pose);
+
+    expected = walk;
+    uint32_t arm = hierarchy.nodeToIndex[3];
+    AnimationPose wave = rest_pose;
+    Animation wave_animation(clips[2]);
+    wave_animation.Bind(hierarchy);
+    wave_animation.Update(2.0f, wave);
+    expected.rotations[arm] = normalize(qmul(walk.rotations[arm], wave.rotations[arm]));
+    check("additive layer", pose, expected);
+
+    RE_INFO("[AnimationStateMachine] {} failures", failures);
+    return failures == 0;
+}
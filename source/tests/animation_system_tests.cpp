@@ -0,0 +1,321 @@
+#include "tests.h"
+#include "world/animation_system.h"
+#include "world/animation.h"
+#include "world/skeleton.h"
+#include "utils/parallel_for.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+
+//the global transforms computed the way SkeletalMesh did before the hierarchy was flattened
+static void ComputeGlobalTransformRecursive(uint32_t node, const eastl::vector<eastl::vector<uint32_t>>& children, const AnimationHierarchy& hierarchy,
+    const AnimationPose& pose, const float4x4& parent_transform, float4x4* transforms)
+{
+    uint32_t index = hierarchy.nodeToIndex[node];
+    float4x4 T = translation_matrix(pose.translations[index]);
+    float4x4 R = rotation_matrix(pose.rotations[index]);
+    float4x4 S = scaling_matrix(pose.scales[index]);
+    transforms[node] = mul(parent_transform, mul(T, mul(R, S)));
+
+    for (size_t i = 0; i < children[node].size(); ++i)
+    {
+        ComputeGlobalTransformRecursive(children[node][i], children, hierarchy, pose, transforms[node], transforms);
+    }
+}
+
+bool TestSkeletonEvaluation()
+{
+    const uint32_t character_count = GetTestSettings().skeleton_characters;
+
+    //a 64 nodes humanoid like hierarchy : a spine, and limbs of 6 nodes branching from its top.
+    //node ids are shuffled so that they are not sorted by depth, as in gltf files
+    const uint32_t node_count = 64;
+    auto node_id = [](uint32_t i) { return (i * 37) % node_count; };
+
+    eastl::vector<int32_t> node_parents(node_count);
+    eastl::vector<float3> rest_translations(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        int32_t parent = i == 0 ? -1 : (i > 4 && i % 6 == 5 ? 4 : (int32_t)i - 1);
+        node_parents[node_id(i)] = parent < 0 ? -1 : (int32_t)node_id(parent);
+        rest_translations[node_id(i)] = i == 0 ? float3(0.0f, 1.0f, 0.0f) : float3(0.02f * (i % 6), 0.1f, 0.0f);
+    }
+
+    AnimationHierarchy hierarchy;
+    hierarchy.Build(node_parents);
+
+    //10 seconds at 30 fps, rotations on every node, translations and scales on some
+    const uint32_t key_count = 300;
+    eastl::vector<AnimationChannel> channels;
+    for (uint32_t node = 0; node < node_count; ++node)
+    {
+        for (uint32_t mode = 0; mode < 3; ++mode)
+        {
+            if (mode != (uint32_t)AnimationChannelMode::Rotation && node % 8 != 0)
+            {
+                continue;
+            }
+
+            AnimationChannel channel;
+            channel.targetNode = node;
+            channel.mode = (AnimationChannelMode)mode;
+
+            for (uint32_t k = 0; k < key_count; ++k)
+            {
+                float t = k / 30.0f;
+                float phase = t * (1.0f + 0.03f * node);
+                float4 value;
+                switch (channel.mode)
+                {
+                case AnimationChannelMode::Rotation:
+                    value = rotation_quat(normalize(float3(sinf(phase), 1.0f, cosf(phase))), 0.5f * sinf(phase * 2.0f));
+                    break;
+                case AnimationChannelMode::Translation:
+                    value = float4(rest_translations[node] + 0.05f * float3(sinf(phase), cosf(phase), 0.0f), 0.0f);
+                    break;
+                default:
+                    value = float4(1.0f + 0.1f * sinf(phase), 1.0f, 1.0f, 0.0f);
+                    break;
+                }
+                channel.keyframes.push_back(eastl::make_pair(t, value));
+            }
+            channels.push_back(eastl::move(channel));
+        }
+    }
+    eastl::shared_ptr<AnimationClip> clip = eastl::make_shared<AnimationClip>("benchmark", channels);
+
+    AnimationPose rest_pose;
+    rest_pose.translations.resize(node_count);
+    rest_pose.rotations.resize(node_count, float4(0.0f, 0.0f, 0.0f, 1.0f));
+    rest_pose.scales.resize(node_count, float3(1.0f, 1.0f, 1.0f));
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        rest_pose.translations[i] = rest_translations[hierarchy.indexToNode[i]];
+    }
+
+    eastl::vector<float4x4> rest_transforms(node_count);
+    hierarchy.ComputeGlobalTransforms(rest_pose, rest_transforms.data());
+
+    Skeleton skeleton("benchmark");
+    skeleton.m_joints.resize(node_count);
+    skeleton.m_inverseBindMatrices.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        skeleton.m_joints[i] = i;
+        skeleton.m_inverseBindMatrices[i] = inverse(rest_transforms[hierarchy.nodeToIndex[i]]);
+    }
+    skeleton.Bind(hierarchy);
+
+    struct Character
+    {
+        eastl::unique_ptr<Animation> animation;
+        AnimationPose pose;
+        eastl::vector<float4x4> global_transforms;
+    };
+    eastl::vector<Character> characters(character_count);
+    for (uint32_t i = 0; i < character_count; ++i)
+    {
+        characters[i].animation = eastl::make_unique<Animation>(clip);
+        characters[i].animation->Bind(hierarchy);
+        characters[i].pose = rest_pose;
+        characters[i].animation->Update(i * 0.731f, characters[i].pose); //spread the instances over the clip
+        characters[i].global_transforms.resize(node_count);
+    }
+
+    const uint32_t joint_count = skeleton.GetJointCount();
+    eastl::vector<float4x4> palette(character_count * joint_count);
+    eastl::vector<float4x4> upload(palette.size()); //stands for the scene constant buffer, which the headless run never resets
+
+    auto evaluate = [&](uint32_t i)
+    {
+        Character& character = characters[i];
+        character.animation->Update(1.0f / 60.0f, character.pose);
+        hierarchy.ComputeGlobalTransforms(character.pose, character.global_transforms.data());
+        skeleton.ComputeJointMatrices(character.global_transforms.data(), palette.data() + i * joint_count);
+    };
+
+    const uint32_t frame_count = 120;
+    uint64_t serial_ticks = 0;
+    uint64_t parallel_ticks = 0;
+
+    for (uint32_t frame = 0; frame < frame_count; ++frame)
+    {
+        uint64_t start = stm_now();
+        if (frame % 2 == 0)
+        {
+            for (uint32_t i = 0; i < character_count; ++i)
+            {
+                evaluate(i);
+            }
+            memcpy(upload.data(), palette.data(), sizeof(float4x4) * palette.size());
+            serial_ticks += stm_since(start);
+        }
+        else
+        {
+            ParallelFor(character_count, evaluate);
+            memcpy(upload.data(), palette.data(), sizeof(float4x4) * palette.size());
+            parallel_ticks += stm_since(start);
+        }
+    }
+
+    eastl::vector<eastl::vector<uint32_t>> children(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        if (node_parents[i] >= 0)
+        {
+            children[node_parents[i]].push_back(i);
+        }
+    }
+
+    uint32_t mismatches = 0;
+    float max_error = 0.0f;
+    eastl::vector<float4x4> reference(node_count);
+    for (uint32_t i = 0; i < character_count; ++i)
+    {
+        ComputeGlobalTransformRecursive(hierarchy.indexToNode[0], children, hierarchy, characters[i].pose, linalg::identity, reference.data());
+
+        for (uint32_t node = 0; node < node_count; ++node)
+        {
+            const float4x4& transform = characters[i].global_transforms[hierarchy.nodeToIndex[node]];
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                float error = maxelem(abs(transform[c] - reference[node][c]));
+                max_error = eastl::max(max_error, error);
+                mismatches += error > 1e-4f ? 1 : 0;
+            }
+        }
+    }
+
+    float serial_ms = (float)stm_ms(serial_ticks) / (frame_count / 2);
+    float parallel_ms = (float)stm_ms(parallel_ticks) / (frame_count / 2);
+
+    RE_INFO("[AnimationSystem] {} characters x {} nodes : {:.3f} ms/frame across the task threads ({} target 1 ms), {:.3f} ms/frame serial",
+        character_count, node_count, parallel_ms, parallel_ms < 1.0f ? "within" : "above", serial_ms);
+    RE_INFO("[AnimationSystem] palette {:.1f} KB in one upload, {} mismatches against the recursive hierarchy walk, max error {}",
+        palette.size() * sizeof(float4x4) / 1024.0f, mismatches, max_error);
+
+    return mismatches == 0;
+}
+
+bool TestAnimationLOD()
+{
+    uint32_t failures = 0;
+    uint32_t seed = 12345;
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+    //skinned bounds : random joint matrices and vertices weighted over up to 4 joints
+    const uint32_t joint_count = 16;
+    const uint32_t vertex_count = 2000;
+
+    eastl::vector<float3> positions(vertex_count);
+    eastl::vector<ushort4> joint_ids(vertex_count);
+    eastl::vector<float4> joint_weights(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; ++i)
+    {
+        positions[i] = float3(random(), random(), random()) * 2.0f - 1.0f;
+        joint_ids[i] = ushort4(i % joint_count, (i * 7 + 1) % joint_count, (i * 3 + 2) % joint_count, (i * 5 + 3) % joint_count);
+
+        float4 weights = float4(random(), random(), i % 2 ? random() : 0.0f, i % 3 ? random() : 0.0f);
+        joint_weights[i] = weights / (weights.x + weights.y + weights.z + weights.w);
+    }
+
+    eastl::vector<float3> joint_min(joint_count);
+    eastl::vector<float3> joint_max(joint_count);
+    ComputeJointBounds(positions.data(), joint_ids.data(), joint_weights.data(), vertex_count, joint_count, joint_min.data(), joint_max.data());
+
+    for (uint32_t frame = 0; frame < 8; ++frame)
+    {
+        eastl::vector<float4x4> joint_matrices(joint_count);
+        for (uint32_t j = 0; j < joint_count; ++j)
+        {
+            float3 euler = float3(random(), random(), random()) * 360.0f;
+            float3 translation = float3(random(), random(), random()) * 4.0f - 2.0f;
+            joint_matrices[j] = mul(translation_matrix(translation), rotation_matrix(rotation_quat(euler)));
+        }
+
+        float3 bounds_min = float3(FLT_MAX);
+        float3 bounds_max = float3(-FLT_MAX);
+        ComputeSkinnedBounds(joint_min.data(), joint_max.data(), joint_matrices.data(), joint_count, bounds_min, bounds_max);
+
+        for (uint32_t i = 0; i < vertex_count; ++i)
+        {
+            float4 skinned = float4(0.0f);
+            for (uint32_t k = 0; k < 4; ++k)
+            {
+                skinned += mul(joint_matrices[joint_ids[i][k]], float4(positions[i], 1.0f)) * joint_weights[i][k];
+            }
+
+            if (minelem(skinned.xyz() - bounds_min) < -1e-4f || maxelem(skinned.xyz() - bounds_max) > 1e-4f)
+            {
+                RE_ERROR("[AnimationSystem] skinned vertex {} of frame {} is outside of the skinned bounds", i, frame);
+                ++failures;
+                break;
+            }
+        }
+    }
+
+    //box culling : a box is culled only if all its corners are behind one plane
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        float4 planes[6];
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            planes[p] = normalize_plane(float4(float3(random(), random(), random()) * 2.0f - 1.0f, random() * 2.0f));
+        }
+
+        float3 center = float3(random(), random(), random()) * 6.0f - 3.0f;
+        float3 extent = float3(random(), random(), random());
+
+        bool visible = true;
+        for (uint32_t p = 0; p < 6 && visible; ++p)
+        {
+            bool all_behind = true;
+            for (uint32_t c = 0; c < 8; ++c)
+            {
+                float3 corner = center + extent * float3(c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f, c & 4 ? 1.0f : -1.0f);
+                all_behind &= dot(corner, planes[p].xyz()) + planes[p].w < 0.0f;
+            }
+            visible = !all_behind;
+        }
+
+        if (FrustumCull(planes, 6, center - extent, center + extent) != visible)
+        {
+            RE_ERROR("[AnimationSystem] box {} : culling result differs from the corner test", i);
+            ++failures;
+        }
+    }
+
+    //screen size : a 2m box 10m away with a 60 degrees field of view, the eye inside of the bounds
+    float screen_size = AnimationSystem::GetScreenSize(float3(-1.0f), float3(1.0f), float3(0.0f, 0.0f, -10.0f), 60.0f);
+    float expected_size = sqrtf(3.0f) / (10.0f * tanf(radians(30.0f)));
+    if (fabsf(screen_size - expected_size) > 1e-4f ||
+        AnimationSystem::GetScreenSize(float3(-1.0f), float3(1.0f), float3(0.5f), 60.0f) != 1.0f ||
+        AnimationSystem::GetScreenSize(float3(-1.0f), float3(1.0f), float3(0.0f, 0.0f, -20.0f), 60.0f) >= screen_size)
+    {
+        RE_ERROR("[AnimationSystem] wrong screen size {}, expected {}", screen_size, expected_size);
+        ++failures;
+    }
+
+    //reduced set : a 1m chain ending with a hand and 1cm fingers, the hand only moves the fingers so both are left out
+    eastl::vector<int32_t> node_parents = { -1, 0, 1, 2, 3, 3, 3 };
+    AnimationHierarchy hierarchy;
+    hierarchy.Build(node_parents);
+
+    AnimationPose rest_pose;
+    rest_pose.translations = { float3(0.0f), float3(0.0f, 0.4f, 0.0f), float3(0.0f, 0.3f, 0.0f), float3(0.0f, 0.3f, 0.0f),
+        float3(0.01f, 0.0f, 0.0f), float3(0.0f, 0.01f, 0.0f), float3(0.0f, 0.0f, 0.01f) };
+
+    hierarchy.BuildReducedSet(rest_pose, 0.05f);
+    for (uint32_t node = 0; node < (uint32_t)node_parents.size(); ++node)
+    {
+        uint8_t expected = node < 3 ? 1 : 0;
+        if (hierarchy.reducedSet[hierarchy.nodeToIndex[node]] != expected)
+        {
+            RE_ERROR("[AnimationSystem] node {} should {}be in the reduced set", node, expected ? "" : "not ");
+            ++failures;
+        }
+    }
+
+    RE_INFO("[AnimationSystem] LOD verification : {} failures", failures);
+
+    return failures == 0;
+}
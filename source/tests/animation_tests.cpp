@@ -0,0 +1,191 @@
+#include "tests.h"
+#include "world/animation.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "EASTL/algorithm.h"
+
+//gltf is right handed, as AnimationClip converts the keyframes
+static float4 ConvertHandedness(AnimationChannelMode mode, const float4& value)
+{
+    switch (mode)
+    {
+    case AnimationChannelMode::Translation:
+        return float4(value.x, value.y, -value.z, 0.0f);
+    case AnimationChannelMode::Rotation:
+        return float4(value.x, value.y, -value.z, -value.w);
+    default:
+        return float4(value.xyz(), 0.0f);
+    }
+}
+
+//reference for the test : the linear scan and per sample conversion the clips were sampled with before
+static float4 SampleLinearScan(const AnimationChannel& channel, float time)
+{
+    const auto& keyframes = channel.keyframes;
+
+    size_t key = 0;
+    float alpha = 0.0f;
+    if (time >= keyframes.back().first)
+    {
+        key = keyframes.size() - 1;
+    }
+    else
+    {
+        for (size_t frame = 0; frame + 1 < keyframes.size(); ++frame)
+        {
+            if (keyframes[frame].first <= time && keyframes[frame + 1].first >= time)
+            {
+                key = frame;
+                alpha = (time - keyframes[frame].first) / (keyframes[frame + 1].first - keyframes[frame].first);
+                break;
+            }
+        }
+    }
+
+    size_t next_key = eastl::min(key + 1, keyframes.size() - 1);
+    float4 lower = ConvertHandedness(channel.mode, keyframes[key].second);
+    float4 upper = ConvertHandedness(channel.mode, keyframes[next_key].second);
+
+    if (channel.mode == AnimationChannelMode::Rotation)
+    {
+        if (dot(lower, upper) < 0.0f)
+        {
+            upper = -upper;
+        }
+        return normalize(lerp(lower, upper, alpha));
+    }
+
+    return lerp(lower, upper, alpha);
+}
+
+bool TestAnimationClipSampling()
+{
+    const uint32_t instance_count = GetTestSettings().animation_instances;
+
+    //a 60 seconds mocap-like clip at 30 fps, with a translation, a rotation and a scale track for each of 64 joints
+    const uint32_t joint_count = 64;
+    const uint32_t key_count = 1800;
+    const float key_interval = 1.0f / 30.0f;
+
+    eastl::vector<AnimationChannel> channels;
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+    {
+        for (uint32_t mode = 0; mode < 3; ++mode)
+        {
+            AnimationChannel channel;
+            channel.targetNode = joint;
+            channel.mode = (AnimationChannelMode)mode;
+            channel.keyframes.reserve(key_count);
+
+            for (uint32_t k = 0; k < key_count; ++k)
+            {
+                float t = k * key_interval;
+                float phase = t * (1.0f + 0.05f * joint) + (float)mode;
+
+                float4 value;
+                if (channel.mode == AnimationChannelMode::Rotation)
+                {
+                    float3 axis = normalize(float3(sinf(phase * 0.3f), 1.0f, cosf(phase * 0.7f)));
+                    float angle = 2.5f * sinf(phase);
+                    value = float4(axis * sinf(angle * 0.5f), cosf(angle * 0.5f));
+                }
+                else
+                {
+                    value = float4(sinf(phase), cosf(phase * 1.3f), sinf(phase * 0.7f), 0.0f);
+                }
+
+                channel.keyframes.push_back(eastl::make_pair(t, value));
+            }
+
+            channels.push_back(eastl::move(channel));
+        }
+    }
+
+    AnimationClip clip("benchmark", channels);
+
+    eastl::vector<AnimationCursor> cursors(instance_count);
+    eastl::vector<AnimationSample> samples(instance_count);
+    eastl::vector<AnimationSample> search_samples(instance_count); //both paths are checked, so they don't share their output
+    eastl::vector<float> times(instance_count);
+    for (uint32_t i = 0; i < instance_count; ++i)
+    {
+        clip.InitCursor(cursors[i]);
+        times[i] = fmodf(i * 0.731f, clip.GetDuration());
+    }
+
+    const uint32_t frame_count = 120;
+    const float delta_time = 1.0f / 60.0f;
+    const uint32_t reference_stride = 50; //the linear scan is too slow to check every instance
+
+    AnimationClipStats stats;
+    uint64_t cursor_ticks = 0;
+    uint64_t search_ticks = 0;
+    uint32_t mismatches = 0;
+    uint32_t search_mismatches = 0;
+    float max_error = 0.0f;
+
+    auto check = [&](const AnimationSample& sample, float time, uint32_t& mismatch_count)
+    {
+        for (uint32_t track = 0; track < clip.GetTrackCount(); ++track)
+        {
+            const AnimationChannel& channel = channels[clip.GetTargetNode(track) * 3 + (uint32_t)clip.GetMode(track)];
+            float4 expected = SampleLinearScan(channel, time);
+            float4 value = sample.GetFloat4(track);
+
+            float error = channel.mode == AnimationChannelMode::Rotation ?
+                1.0f - fabsf(dot(expected, value)) : //q and -q are the same rotation
+                length(expected - value);
+
+            max_error = max(max_error, error);
+            if (error > 1e-4f)
+            {
+                mismatch_count++;
+            }
+        }
+    };
+
+    for (uint32_t frame = 0; frame < frame_count; ++frame)
+    {
+        uint64_t ticks = stm_now();
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            clip.Sample(times[i], cursors[i], samples[i], &stats);
+        }
+        cursor_ticks += stm_now() - ticks;
+
+        //without cursors, every key is binary searched
+        AnimationCursor reset_cursor;
+        clip.InitCursor(reset_cursor);
+
+        ticks = stm_now();
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            eastl::fill(reset_cursor.keys.begin(), reset_cursor.keys.end(), key_count);
+            clip.Sample(times[i], reset_cursor, search_samples[i]);
+        }
+        search_ticks += stm_now() - ticks;
+
+        for (uint32_t i = 0; i < instance_count; i += reference_stride)
+        {
+            check(samples[i], times[i], mismatches);
+            check(search_samples[i], times[i], search_mismatches);
+        }
+
+        for (uint32_t i = 0; i < instance_count; ++i)
+        {
+            times[i] = fmodf(times[i] + delta_time, clip.GetDuration());
+        }
+    }
+
+    uint32_t samples_per_pass = instance_count * clip.GetTrackCount() * frame_count;
+    uint32_t legacy_size = (uint32_t)(sizeof(eastl::pair<float, float4>) * clip.GetKeyCount());
+
+    RE_INFO("[AnimationClip] {} instances x {} tracks x {} frames : cursors {:.2f} ms/frame ({} hits, {} searches), binary search {:.2f} ms/frame",
+        instance_count, clip.GetTrackCount(), frame_count, stm_ms(cursor_ticks) / frame_count, stats.cursor_hits, stats.binary_searches,
+        stm_ms(search_ticks) / frame_count);
+    RE_INFO("[AnimationClip] {:.1f} ns per track sample, clip {:.1f} KB ({:.1f} KB as float4 keyframes)",
+        stm_ns(cursor_ticks) / samples_per_pass, clip.GetMemorySize() / 1024.0f, legacy_size / 1024.0f);
+    RE_INFO("[AnimationClip] {} cursor and {} binary search mismatches against the linear scan, max error {}", mismatches, search_mismatches, max_error);
+
+    return mismatches == 0 && search_mismatches == 0;
+}
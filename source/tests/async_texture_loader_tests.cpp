@@ -0,0 +1,110 @@
+#include "tests.h"
+#include "renderer/async_texture_loader.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "EASTL/sort.h"
+#include <filesystem>
+
+static bool IsTextureFile(const std::filesystem::path& path)
+{
+    eastl::string extension = path.extension().string().c_str();
+    for (size_t i = 0; i < extension.size(); ++i)
+    {
+        extension[i] = (char)tolower(extension[i]);
+    }
+
+    return extension == ".dds" || extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+        extension == ".tga" || extension == ".bmp" || extension == ".hdr";
+}
+
+bool TestAsyncTextureLoader()
+{
+    const eastl::string& directory = GetTestSettings().texture_directory;
+    const uint32_t max_requests = GetTestSettings().texture_io_requests;
+
+    eastl::vector<eastl::string> files;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory.c_str(), error))
+    {
+        if (entry.is_regular_file() && IsTextureFile(entry.path()))
+        {
+            files.push_back(entry.path().string().c_str());
+        }
+    }
+    eastl::sort(files.begin(), files.end());
+
+    if (files.empty())
+    {
+        RE_WARN("[AsyncTextureLoader] no textures found in {}", directory);
+        return false;
+    }
+
+    eastl::vector<eastl::unique_ptr<TextureLoader>> serial_results(files.size());
+    uint64_t serial_bytes = 0;
+    uint64_t ticks = stm_now();
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        serial_results[i] = eastl::make_unique<TextureLoader>();
+        if (!serial_results[i]->Load(files[i], false))
+        {
+            serial_results[i].reset();
+            continue;
+        }
+        serial_bytes += serial_results[i]->GetFileSize();
+    }
+
+    double serial_seconds = stm_sec(stm_now() - ticks);
+
+    AsyncTextureLoader async_loader(max_requests);
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        async_loader.Request(files[i], false);
+    }
+
+    eastl::vector<eastl::unique_ptr<TextureLoader>> async_results(files.size());
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        async_results[i] = async_loader.Acquire(files[i], false);
+    }
+
+    AsyncTextureLoadStats stats = async_loader.GetStats();
+
+    uint32_t mismatches = 0;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const TextureLoader* serial = serial_results[i].get();
+        const TextureLoader* async = async_results[i].get();
+
+        bool match;
+        if (serial == nullptr || async == nullptr)
+        {
+            match = serial == async;
+        }
+        else
+        {
+            match = serial->GetWidth() == async->GetWidth() &&
+                serial->GetHeight() == async->GetHeight() &&
+                serial->GetDepth() == async->GetDepth() &&
+                serial->GetMipLevels() == async->GetMipLevels() &&
+                serial->GetArraySize() == async->GetArraySize() &&
+                serial->GetFormat() == async->GetFormat() &&
+                serial->GetDataSize() == async->GetDataSize() &&
+                memcmp(serial->GetData(), async->GetData(), serial->GetDataSize()) == 0;
+        }
+
+        if (!match)
+        {
+            RE_WARN("[AsyncTextureLoader] serial and async results of {} differ", files[i]);
+            mismatches++;
+        }
+    }
+
+    RE_INFO("[AsyncTextureLoader] verified {} textures, {} mismatches : serial {:.1f} MB/s, async {:.1f} MB/s with {} requests in flight (queue depth max {} average {:.1f})",
+        files.size(), mismatches,
+        serial_seconds > 0.0 ? serial_bytes / (1024.0 * 1024.0) / serial_seconds : 0.0,
+        stats.GetThroughput(), max_requests, stats.max_queue_depth, stats.average_queue_depth);
+
+    return mismatches == 0;
+}
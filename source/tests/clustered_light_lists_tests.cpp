@@ -0,0 +1,386 @@
+#include "tests.h"
+#include "renderer/lighting/clustered_light_lists.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "clustered_light_culling.hlsli"
+
+//CPU version of cull_lights in clustered_light_culling.hlsl : the groups run in the cluster order,
+//with the waves of waveSize lanes compacting the visible lights the same way
+static void CullLightsReference(const float4* viewLights, uint32_t lightCount, const float2* tileHZBDepth, uint32_t width, uint32_t height,
+    uint32_t tileSize, uint32_t sliceCount, float maxSliceDepth, const float4x4& mtxInvProjection, float zNear, uint32_t waveSize, uint32_t maxLightIndexCount,
+    eastl::vector<uint2>& lightGrids, eastl::vector<uint32_t>& lightIndices)
+{
+    const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
+    const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
+    const uint32_t tilesPerSlice = tileCountX * tileCountY;
+    const uint32_t groupSize = CLUSTERED_LIGHT_CULLING_GROUP_SIZE;
+    const uint32_t waveCount = DivideRoudingUp(groupSize, waveSize);
+
+    lightGrids.resize(tilesPerSlice * sliceCount);
+    lightIndices.resize(maxLightIndexCount);
+
+    uint32_t lightIndexCounter = 0;
+    eastl::vector<uint32_t> waveLightCounts(waveCount);
+
+    for (uint32_t cluster = 0; cluster < tilesPerSlice * sliceCount; ++cluster)
+    {
+        uint32_t slice = cluster / tilesPerSlice;
+        uint32_t tile = cluster % tilesPerSlice;
+
+        float2 tileDepthBounds = GetTileDepthBounds(tileHZBDepth[tile], zNear);
+        float2 depthRange = GetClusterDepthRange(slice, sliceCount, zNear, maxSliceDepth, tileDepthBounds);
+
+        if (depthRange.x > depthRange.y)
+        {
+            lightGrids[cluster] = uint2(0, 0);
+            continue;
+        }
+
+        ClusterAABB aabb = GetClusterAABB(tile % tileCountX, tile / tileCountX, tileSize, depthRange.x, depthRange.y, float2(width, height), mtxInvProjection);
+
+        uint32_t offset = 0;
+        uint32_t count = 0;
+
+        for (uint32_t pass = 0; pass < 2; ++pass)
+        {
+            bool write = pass == 1;
+            uint32_t visibleCount = 0;
+
+            for (uint32_t first = 0; first < lightCount; first += groupSize)
+            {
+                bool visible[groupSize] = {};
+                eastl::fill(waveLightCounts.begin(), waveLightCounts.end(), 0);
+
+                for (uint32_t lane = 0; lane < groupSize; ++lane)
+                {
+                    uint32_t lightIndex = first + lane;
+                    if (lightIndex < lightCount)
+                    {
+                        const float4& sphere = viewLights[lightIndex];
+                        visible[lane] = sphere.w >= 0.0f && TestSphereAABB(sphere.xyz(), sphere.w, aabb.minPoint, aabb.maxPoint);
+                    }
+
+                    waveLightCounts[lane / waveSize] += visible[lane] ? 1 : 0;
+                }
+
+                for (uint32_t lane = 0; write && lane < groupSize; ++lane)
+                {
+                    if (!visible[lane])
+                    {
+                        continue;
+                    }
+
+                    uint32_t wavePrefix = 0;
+                    for (uint32_t i = lane / waveSize * waveSize; i < lane; ++i)
+                    {
+                        wavePrefix += visible[i] ? 1 : 0;
+                    }
+
+                    uint32_t index = visibleCount + wavePrefix;
+                    for (uint32_t i = 0; i < lane / waveSize; ++i)
+                    {
+                        index += waveLightCounts[i];
+                    }
+
+                    if (index < count)
+                    {
+                        lightIndices[offset + index] = first + lane;
+                    }
+                }
+
+                for (uint32_t i = 0; i < waveCount; ++i)
+                {
+                    visibleCount += waveLightCounts[i];
+                }
+            }
+
+            if (!write)
+            {
+                offset = lightIndexCounter;
+                lightIndexCounter += visibleCount;
+                count = offset < maxLightIndexCount ? eastl::min(visibleCount, maxLightIndexCount - offset) : 0;
+                lightGrids[cluster] = uint2(offset, count);
+
+                if (count == 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool TestLightCulling()
+{
+    const uint32_t tileSize = ClusteredLightLists::tileSize;
+    const uint32_t sliceCount = ClusteredLightLists::sliceCount;
+    const float maxSliceDepth = ClusteredLightLists::maxSliceDepth;
+
+    const uint32_t width = 1280;
+    const uint32_t height = 720;
+    const float zNear = 0.1f;
+    const float tanHalfFov = tanf(0.5f * radians(60.0f));
+
+    float4x4 mtxProjection = float4x4(0.0f);
+    mtxProjection[0][0] = 1.0f / tanHalfFov / ((float)width / height);
+    mtxProjection[1][1] = 1.0f / tanHalfFov;
+    mtxProjection[3][2] = zNear;
+    mtxProjection[2][3] = 1.0f;
+    float4x4 mtxInvProjection = inverse(mtxProjection);
+
+    const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
+    const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
+    const uint32_t tilesPerSlice = tileCountX * tileCountY;
+    const uint32_t cellCount = tilesPerSlice * sliceCount;
+
+    uint32_t seed = 54321;
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+    //lights in view space as written by transform_lights, 1 in 8 outside the frustum
+    const uint32_t lightCount = 1500;
+    eastl::vector<float4> viewLights(lightCount);
+    eastl::vector<ClusteredLightBinner::Light> visibleLights;
+
+    for (uint32_t i = 0; i < lightCount; ++i)
+    {
+        float depth = zNear + 150.0f * random() * sqrtf(random());
+        float2 extent = float2(tanHalfFov * width / height, tanHalfFov) * depth * 1.2f;
+        float3 position = float3((random() * 2.0f - 1.0f) * extent.x, (random() * 2.0f - 1.0f) * extent.y, depth);
+        float radius = i % 128 == 0 ? 20.0f + 30.0f * random() : 0.5f + 4.5f * random();
+
+        if (i % 8 == 7)
+        {
+            viewLights[i] = float4(0.0f, 0.0f, 0.0f, -1.0f);
+        }
+        else
+        {
+            viewLights[i] = float4(position, radius);
+            visibleLights.push_back({ position, radius, i });
+        }
+    }
+
+    //HZB min/max depth of each tile : some only have sky, the others a random depth range
+    eastl::vector<float2> tileHZBDepth(tilesPerSlice);
+    eastl::vector<float2> tileDepthBounds(tilesPerSlice);
+    for (uint32_t i = 0; i < tilesPerSlice; ++i)
+    {
+        if (i % 11 == 0)
+        {
+            tileHZBDepth[i] = float2(0.0f, 0.0f);
+        }
+        else
+        {
+            float nearDepth = zNear + 200.0f * random() * random();
+            float farDepth = i % 5 == 0 ? FLT_MAX : nearDepth * (1.0f + 4.0f * random());
+            tileHZBDepth[i] = float2(zNear / farDepth, zNear / nearDepth);
+        }
+
+        tileDepthBounds[i] = GetTileDepthBounds(tileHZBDepth[i], zNear);
+    }
+
+    //the same clusters for the binner, clusters without pixels keep their slice bounds and are expected to be empty
+    eastl::vector<float3> clusterMin(cellCount);
+    eastl::vector<float3> clusterMax(cellCount);
+    eastl::vector<uint8_t> clusterEmpty(cellCount);
+    ClusteredLightLists::BuildClusterBounds(width, height, mtxInvProjection, zNear, clusterMin.data(), clusterMax.data());
+
+    for (uint32_t cluster = 0; cluster < cellCount; ++cluster)
+    {
+        uint32_t tile = cluster % tilesPerSlice;
+        float2 depthRange = GetClusterDepthRange(cluster / tilesPerSlice, sliceCount, zNear, maxSliceDepth, tileDepthBounds[tile]);
+
+        clusterEmpty[cluster] = depthRange.x > depthRange.y;
+        if (!clusterEmpty[cluster])
+        {
+            ClusterAABB aabb = GetClusterAABB(tile % tileCountX, tile / tileCountX, tileSize, depthRange.x, depthRange.y, float2(width, height), mtxInvProjection);
+            clusterMin[cluster] = aabb.minPoint;
+            clusterMax[cluster] = aabb.maxPoint;
+        }
+    }
+
+    ClusteredLightBinner binner;
+    binner.Bin(visibleLights.data(), (uint32_t)visibleLights.size(), tileCountX, tileCountY, sliceCount, clusterMin.data(), clusterMax.data());
+
+    const eastl::vector<uint2>& binnerGrids = binner.GetLightGrids();
+    const eastl::vector<uint32_t>& binnerIndices = binner.GetLightIndices();
+
+    uint32_t expectedLightIndexCount = 0;
+    for (uint32_t cluster = 0; cluster < cellCount; ++cluster)
+    {
+        expectedLightIndexCount += clusterEmpty[cluster] ? 0 : binnerGrids[cluster].y;
+    }
+
+    uint32_t failures = 0;
+    eastl::vector<uint2> lightGrids;
+    eastl::vector<uint32_t> lightIndices;
+
+    //every wave size, then an index list too small for all the lights, where the clusters keep the first lights of their lists
+    const uint32_t waveSizes[] = { 4, 16, 32, 64, 128, 32 };
+    for (uint32_t run = 0; run < sizeof(waveSizes) / sizeof(waveSizes[0]); ++run)
+    {
+        bool overflow = run == sizeof(waveSizes) / sizeof(waveSizes[0]) - 1;
+        uint32_t maxLightIndexCount = overflow ? expectedLightIndexCount / 2 : cellCount * ClusteredLightLists::maxAverageLightsPerCluster;
+
+        CullLightsReference(viewLights.data(), lightCount, tileHZBDepth.data(), width, height,
+            tileSize, sliceCount, maxSliceDepth, mtxInvProjection, zNear, waveSizes[run], maxLightIndexCount, lightGrids, lightIndices);
+
+        uint32_t mismatches = 0;
+        uint32_t truncated = 0;
+
+        for (uint32_t cluster = 0; cluster < cellCount; ++cluster)
+        {
+            uint2 grid = lightGrids[cluster];
+            uint2 expected = clusterEmpty[cluster] ? uint2(0, 0) : binnerGrids[cluster];
+
+            if (grid.y < expected.y)
+            {
+                ++truncated;
+            }
+
+            if ((overflow ? grid.y > expected.y : grid.y != expected.y) ||
+                (grid.y > 0 && grid.x + grid.y > maxLightIndexCount) ||
+                memcmp(lightIndices.data() + grid.x, binnerIndices.data() + expected.x, sizeof(uint32_t) * grid.y) != 0)
+            {
+                ++mismatches;
+            }
+        }
+
+        if (overflow && truncated == 0)
+        {
+            ++mismatches;
+        }
+
+        RE_INFO("[ClusteredLightLists] GPU culling reference, wave size {}{} : {} mismatching clusters, {} truncated",
+            waveSizes[run], overflow ? ", half sized index list" : "", mismatches, truncated);
+
+        failures += mismatches;
+    }
+
+    //shading : every light reaching a pixel in the depth range of its tile must be in the list of its cluster
+    CullLightsReference(viewLights.data(), lightCount, tileHZBDepth.data(), width, height,
+        tileSize, sliceCount, maxSliceDepth, mtxInvProjection, zNear, 32, cellCount * ClusteredLightLists::maxAverageLightsPerCluster, lightGrids, lightIndices);
+
+    float2 sliceParams = float2(1.0f / zNear, (float)sliceCount / log(maxSliceDepth / zNear));
+    uint32_t missingLights = 0;
+
+    for (uint32_t sample = 0; sample < 20000; ++sample)
+    {
+        uint2 pixel = uint2(eastl::min((uint32_t)(random() * width), width - 1), eastl::min((uint32_t)(random() * height), height - 1));
+        uint32_t tile = pixel.x / tileSize + pixel.y / tileSize * tileCountX;
+
+        //the lists do not go further than the last slice
+        float2 bounds = float2(tileDepthBounds[tile].x, eastl::min(tileDepthBounds[tile].y, maxSliceDepth));
+        if (bounds.x > bounds.y)
+        {
+            continue;
+        }
+
+        float depth = bounds.x + (bounds.y - bounds.x) * random();
+        float3 viewRay = GetClusterViewRay(float2(pixel) + 0.5f, float2(width, height), mtxInvProjection);
+        float3 position = viewRay * (depth / viewRay.z);
+
+        uint32_t slice = (uint32_t)eastl::clamp(log(depth * sliceParams.x) * sliceParams.y, 0.0f, (float)sliceCount - 1);
+        uint2 grid = lightGrids[tile + slice * tilesPerSlice];
+        const uint32_t* list = lightIndices.data() + grid.x;
+
+        for (uint32_t i = 0; i < lightCount; ++i)
+        {
+            if (viewLights[i].w >= 0.0f && length(viewLights[i].xyz() - position) < viewLights[i].w &&
+                eastl::find(list, list + grid.y, i) == list + grid.y)
+            {
+                ++missingLights;
+            }
+        }
+    }
+
+    RE_INFO("[ClusteredLightLists] GPU culling reference, {} lights missing at sampled pixels", missingLights);
+
+    return failures == 0 && missingLights == 0;
+}
+
+bool TestLightBinning()
+{
+    const uint32_t tileSize = ClusteredLightLists::tileSize;
+    const uint32_t sliceCount = ClusteredLightLists::sliceCount;
+
+    //same projection as Camera::SetPerpective : LH, reversed z, infinite far plane
+    const uint32_t width = 1920;
+    const uint32_t height = 1080;
+    const float zNear = 0.1f;
+    const float tanHalfFov = tanf(0.5f * radians(60.0f));
+
+    float4x4 mtxProjection = float4x4(0.0f);
+    mtxProjection[0][0] = 1.0f / tanHalfFov / ((float)width / height);
+    mtxProjection[1][1] = 1.0f / tanHalfFov;
+    mtxProjection[3][2] = zNear;
+    mtxProjection[2][3] = 1.0f;
+
+    const uint32_t tileCountX = DivideRoudingUp(width, tileSize);
+    const uint32_t tileCountY = DivideRoudingUp(height, tileSize);
+    const uint32_t cellCount = tileCountX * tileCountY * sliceCount;
+
+    eastl::vector<float3> clusterMin(cellCount);
+    eastl::vector<float3> clusterMax(cellCount);
+    ClusteredLightLists::BuildClusterBounds(width, height, inverse(mtxProjection), zNear, clusterMin.data(), clusterMax.data());
+
+    uint32_t seed = 12345;
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+    const uint32_t lightCounts[] = { 64, 256, 1024, 4096, 16384 };
+    const uint32_t iterations = 8;
+    uint32_t failures = 0;
+
+    ClusteredLightBinner binner;
+    ClusteredLightBinner reference;
+
+    for (uint32_t lightCount : lightCounts)
+    {
+        //lights around the view frustum, denser near the camera, with a few large ones
+        eastl::vector<ClusteredLightBinner::Light> lights(lightCount);
+        for (uint32_t i = 0; i < lightCount; ++i)
+        {
+            float depth = zNear + 300.0f * random() * sqrtf(random());
+            float2 extent = float2(tanHalfFov * width / height, tanHalfFov) * depth * 1.2f;
+
+            lights[i].position = float3((random() * 2.0f - 1.0f) * extent.x, (random() * 2.0f - 1.0f) * extent.y, depth);
+            lights[i].radius = i % 256 == 0 ? 20.0f + 30.0f * random() : 0.5f + 2.5f * random();
+            lights[i].index = i;
+        }
+
+        uint64_t binTicks = 0;
+        uint64_t referenceTicks = 0;
+
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            uint64_t start = stm_now();
+            binner.Bin(lights.data(), lightCount, tileCountX, tileCountY, sliceCount, clusterMin.data(), clusterMax.data());
+            binTicks += stm_since(start);
+
+            start = stm_now();
+            reference.BinReference(lights.data(), lightCount, tileCountX, tileCountY, sliceCount, clusterMin.data(), clusterMax.data());
+            referenceTicks += stm_since(start);
+        }
+
+        //both keep the input order in each cluster, only the offsets may differ
+        uint32_t mismatches = 0;
+        for (uint32_t cluster = 0; cluster < cellCount; ++cluster)
+        {
+            uint2 grid = binner.GetLightGrids()[cluster];
+            uint2 referenceGrid = reference.GetLightGrids()[cluster];
+
+            if (grid.y != referenceGrid.y ||
+                memcmp(&binner.GetLightIndices()[grid.x], &reference.GetLightIndices()[referenceGrid.x], sizeof(uint32_t) * grid.y) != 0)
+            {
+                ++mismatches;
+            }
+        }
+
+        RE_INFO("[ClusteredLightLists] {} lights, {} clusters, {} light indices : bitmask binning {:.3f} ms, reference {:.3f} ms, {} mismatching clusters",
+            lightCount, cellCount, (uint32_t)binner.GetLightIndices().size(),
+            stm_ms(binTicks) / iterations, stm_ms(referenceTicks) / iterations, mismatches);
+
+        failures += mismatches;
+    }
+
+    return failures == 0;
+}
@@ -0,0 +1,392 @@
+#include "tests.h"
+#include "renderer/lighting/hash_grid_radiance_cache.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "EASTL/sort.h"
+
+//CPU copy of the GPU table, the functions below do what the shaders do
+struct CpuHashGrid
+{
+    eastl::vector<uint> keys;
+    eastl::vector<HashGridCell> cells;
+
+    CpuHashGrid(uint32_t capacity) : keys(capacity, HASH_GRID_EMPTY_KEY), cells(capacity) {}
+};
+
+//QueryRadianceCache, returns the slot or HASH_GRID_INVALID_SLOT
+static uint32_t QueryCell(CpuHashGrid& grid, const HashGridRadianceCacheParams& params, const float3& position, const float3& normal)
+{
+    HashGridCellKey key = HashGridComputeKey(params, position, normal);
+    HashGridSlot slot = HashGridFindOrInsertCell(grid.keys.data(), params.capacity, key);
+
+    if (slot.index != HASH_GRID_INVALID_SLOT)
+    {
+        if (slot.inserted)
+        {
+            grid.cells[slot.index] = HashGridCreateCell(position, normal, params.frameIndex);
+        }
+        grid.cells[slot.index].lastUsedFrame = params.frameIndex;
+    }
+
+    return slot.index;
+}
+
+//compact_cells, returns the number of active cells
+static uint32_t CompactCells(CpuHashGrid& grid, uint32_t frameIndex, uint32_t maxAge)
+{
+    uint32_t activeCount = 0;
+    for (size_t slot = 0; slot < grid.keys.size(); ++slot)
+    {
+        if (grid.keys[slot] != HASH_GRID_EMPTY_KEY)
+        {
+            if (HashGridIsCellExpired(grid.cells[slot], frameIndex, maxAge))
+            {
+                grid.keys[slot] = HASH_GRID_EMPTY_KEY;
+                grid.cells[slot].sampleCount = 0;
+            }
+            else
+            {
+                activeCount++;
+            }
+        }
+    }
+    return activeCount;
+}
+
+//the inputs of the key, to tell the cells apart without the hashes
+struct CellCoordinates
+{
+    int x, y, z;
+    uint level;
+    uint direction;
+
+    bool operator<(const CellCoordinates& other) const
+    {
+        if (x != other.x) return x < other.x;
+        if (y != other.y) return y < other.y;
+        if (z != other.z) return z < other.z;
+        if (level != other.level) return level < other.level;
+        return direction < other.direction;
+    }
+
+    bool operator==(const CellCoordinates& other) const
+    {
+        return x == other.x && y == other.y && z == other.z && level == other.level && direction == other.direction;
+    }
+};
+
+static CellCoordinates GetCellCoordinates(const HashGridRadianceCacheParams& params, const float3& position, const float3& normal)
+{
+    CellCoordinates coordinates;
+    coordinates.level = HashGridLevel(params, position);
+    float size = HashGridLevelCellSize(params, coordinates.level);
+    coordinates.x = (int)floorf(position.x / size);
+    coordinates.y = (int)floorf(position.y / size);
+    coordinates.z = (int)floorf(position.z / size);
+    coordinates.direction = HashGridNormalDirection(normal);
+    return coordinates;
+}
+
+static HashGridRadianceCacheParams GetTestParams(uint32_t capacity)
+{
+    HashGridRadianceCacheParams params = {};
+    params.capacity = capacity;
+    params.cameraPosition = float3(1.5f, 2.0f, -3.0f);
+    params.cellSize = 0.1f;
+    params.lodScale = 2.0f * tanf(radians(60.0f) * 0.5f) / 1080.0f * 8.0f;
+    params.maxLevel = 12;
+    params.minSampleCount = 4;
+    return params;
+}
+
+bool TestRadianceCache()
+{
+    uint32_t seed = 13579;
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+    auto randomNormal = [&random]()
+    {
+        //mostly the axis aligned walls and floors of the scenes, with some noise
+        float3 normal;
+        uint32_t axis = (uint32_t)(random() * 8.0f);
+        float sign = random() < 0.5f ? -1.0f : 1.0f;
+        normal = axis < 3 ? float3(axis == 0 ? sign : 0.0f, axis == 1 ? sign : 0.0f, axis == 2 ? sign : 0.0f) : float3(random() - 0.5f, random() - 0.5f, random() - 0.5f);
+        return normalize(normal + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 0.01f);
+    };
+
+    uint32_t failures = 0;
+
+    //two points of the same cell have the same key, with any normal on the same side of the same axis
+    {
+        HashGridRadianceCacheParams params = GetTestParams(1u << 20);
+        uint32_t keyMismatches = 0;
+        uint32_t tested = 0;
+
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            float3 position = params.cameraPosition + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 200.0f;
+            float3 normal = randomNormal();
+
+            CellCoordinates coordinates = GetCellCoordinates(params, position, normal);
+            float size = HashGridLevelCellSize(params, coordinates.level);
+            float3 otherPosition = (float3((float)coordinates.x, (float)coordinates.y, (float)coordinates.z) + float3(random(), random(), random()) * 0.98f + 0.01f) * size;
+            float3 otherNormal = normalize(normal + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 0.01f);
+
+            if (!(GetCellCoordinates(params, otherPosition, otherNormal) == coordinates))
+            {
+                continue; //the other point is on a different level or axis
+            }
+
+            HashGridCellKey key = HashGridComputeKey(params, position, normal);
+            HashGridCellKey otherKey = HashGridComputeKey(params, otherPosition, otherNormal);
+            keyMismatches += (key.hash != otherKey.hash || key.checksum != otherKey.checksum || key.checksum == HASH_GRID_EMPTY_KEY) ? 1 : 0;
+            tested++;
+        }
+
+        RE_INFO("[HashGridRadianceCache] {} points against another point of their cell : {} different keys", tested, keyMismatches);
+        failures += keyMismatches + (tested < 50000 ? 1 : 0);
+    }
+
+    //the levels grow by one at most between close distances, and the cells are within a factor of 2 of the target size
+    {
+        HashGridRadianceCacheParams params = GetTestParams(1u << 20);
+        uint32_t levelErrors = 0;
+        uint32_t previousLevel = 0;
+        uint32_t levelCount = 0;
+
+        for (float distance = 0.01f; distance < 100000.0f; distance *= 1.001f)
+        {
+            float3 position = params.cameraPosition + float3(0.6f, -0.48f, 0.64f) * distance;
+            uint32_t level = HashGridLevel(params, position);
+            float size = HashGridLevelCellSize(params, level);
+            float targetSize = distance * params.lodScale;
+
+            levelErrors += (level < previousLevel || level > previousLevel + 1) ? 1 : 0;
+            levelErrors += (level > 0 && size > targetSize * 1.0001f) ? 1 : 0;
+            levelErrors += (level < params.maxLevel && targetSize >= size * 2.0f * 1.0001f) ? 1 : 0;
+
+            levelCount += level != previousLevel ? 1 : 0;
+            previousLevel = level;
+        }
+
+        RE_INFO("[HashGridRadianceCache] {} level changes from 1 cm to 100 km : {} errors", levelCount, levelErrors);
+        failures += levelErrors + (levelCount != params.maxLevel ? 1 : 0);
+    }
+
+    //distinct cells get distinct slots, and the keys stay found as the table fills up
+    {
+        const uint32_t capacity = 1u << 16;
+        HashGridRadianceCacheParams params = GetTestParams(capacity);
+
+        eastl::vector<eastl::pair<CellCoordinates, float3>> cells; //and a position in it
+        cells.reserve(capacity);
+        while (cells.size() < capacity)
+        {
+            float3 position = params.cameraPosition + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 100.0f;
+            cells.push_back({ GetCellCoordinates(params, position, float3(0.0f, 1.0f, 0.0f)), position });
+        }
+        eastl::sort(cells.begin(), cells.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        cells.erase(eastl::unique(cells.begin(), cells.end(), [](const auto& a, const auto& b) { return a.first == b.first; }), cells.end());
+        for (size_t i = cells.size() - 1; i > 0; --i) //the insertion order should not follow the coordinates
+        {
+            eastl::swap(cells[i], cells[(size_t)(random() * i)]);
+        }
+
+        CpuHashGrid grid(capacity);
+        eastl::vector<uint32_t> slots;
+        eastl::vector<uint32_t> owners(capacity, HASH_GRID_INVALID_SLOT);
+        uint32_t insertFailures = 0;
+        uint32_t aliasedCells = 0;
+        uint32_t lostCells = 0;
+
+        const float loads[] = { 0.25f, 0.5f, 0.75f, 0.9f };
+        for (float load : loads)
+        {
+            uint32_t count = eastl::min((uint32_t)(capacity * load), (uint32_t)cells.size());
+            uint32_t loadInsertFailures = 0;
+
+            for (uint32_t i = (uint32_t)slots.size(); i < count; ++i)
+            {
+                uint32_t slot = QueryCell(grid, params, cells[i].second, float3(0.0f, 1.0f, 0.0f));
+                slots.push_back(slot);
+
+                if (slot == HASH_GRID_INVALID_SLOT)
+                {
+                    loadInsertFailures++;
+                }
+                else if (owners[slot] != HASH_GRID_INVALID_SLOT)
+                {
+                    aliasedCells++;
+                }
+                else
+                {
+                    owners[slot] = i;
+                }
+            }
+
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                HashGridCellKey key = HashGridComputeKey(params, cells[i].second, float3(0.0f, 1.0f, 0.0f));
+                lostCells += HashGridFindCell(grid.keys.data(), capacity, key) != slots[i] ? 1 : 0;
+            }
+
+            RE_INFO("[HashGridRadianceCache] load {:.2f} : {:.3f}% of the cells did not find a free slot", load, 100.0f * loadInsertFailures / eastl::max(count, 1u));
+            insertFailures += loadInsertFailures;
+
+            if (load == 0.5f)
+            {
+                failures += loadInsertFailures * 1000 > count ? 1 : 0; //0.1%
+            }
+        }
+
+        RE_INFO("[HashGridRadianceCache] {} distinct cells : {} sharing a slot, {} not found again", cells.size(), aliasedCells, lostCells);
+        failures += aliasedCells + lostCells;
+    }
+
+    //the cells queried in the last frames stay, the others are evicted, and the holes they leave do not hide the remaining ones
+    {
+        const uint32_t capacity = 1u << 12;
+        const uint32_t maxAge = 30;
+        HashGridRadianceCacheParams params = GetTestParams(capacity);
+
+        eastl::vector<float3> positions;
+        for (uint32_t i = 0; i < 3000; ++i)
+        {
+            positions.push_back(params.cameraPosition + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 30.0f);
+        }
+
+        CpuHashGrid grid(capacity);
+        eastl::vector<uint32_t> slots(positions.size(), HASH_GRID_INVALID_SLOT);
+        uint32_t evictionErrors = 0;
+        uint32_t activeCount = 0;
+
+        for (uint32_t frame = 1; frame <= 100; ++frame)
+        {
+            params.frameIndex = frame;
+            activeCount = CompactCells(grid, frame, maxAge);
+
+            //the first half is only queried in the first 10 frames
+            for (size_t i = frame <= 10 ? 0 : positions.size() / 2; i < positions.size(); ++i)
+            {
+                uint32_t slot = QueryCell(grid, params, positions[i], float3(0.0f, 1.0f, 0.0f));
+                evictionErrors += (slots[i] != HASH_GRID_INVALID_SLOT && slot != slots[i]) ? 1 : 0; //moved
+                slots[i] = slot;
+            }
+
+            if (frame == 10 + maxAge + 1)
+            {
+                for (size_t i = 0; i < positions.size(); ++i)
+                {
+                    HashGridCellKey key = HashGridComputeKey(params, positions[i], float3(0.0f, 1.0f, 0.0f));
+                    bool found = HashGridFindCell(grid.keys.data(), capacity, key) != HASH_GRID_INVALID_SLOT;
+                    evictionErrors += (i < positions.size() / 2) == found ? 1 : 0;
+                }
+
+                eastl::fill(slots.begin(), slots.begin() + positions.size() / 2, HASH_GRID_INVALID_SLOT);
+            }
+        }
+
+        uint32_t liveCount = 0;
+        eastl::vector<uint> liveKeys;
+        for (uint32_t slot = 0; slot < capacity; ++slot)
+        {
+            if (grid.keys[slot] != HASH_GRID_EMPTY_KEY)
+            {
+                liveKeys.push_back(grid.keys[slot]);
+            }
+        }
+        liveCount = (uint32_t)liveKeys.size();
+        eastl::sort(liveKeys.begin(), liveKeys.end());
+        uint32_t duplicates = (uint32_t)(liveKeys.end() - eastl::unique(liveKeys.begin(), liveKeys.end()));
+
+        RE_INFO("[HashGridRadianceCache] {} live cells, {} active after the last compaction : {} eviction errors, {} duplicated keys",
+            liveCount, activeCount, evictionErrors, duplicates);
+        failures += evictionErrors + duplicates;
+    }
+
+    //a cell converges to the mean radiance with the variance of 2 * maxSampleCount - 1 rays, and forgets an old lighting at the rate of its average
+    {
+        const uint32_t maxSampleCount = 32;
+        const uint32_t cellCount = 4096;
+        const uint32_t frameCount = maxSampleCount * 16;
+
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        for (uint32_t i = 0; i < cellCount; ++i)
+        {
+            HashGridCell cell = HashGridCreateCell(float3(0.0f, 0.0f, 0.0f), float3(0.0f, 1.0f, 0.0f), 0);
+            for (uint32_t frame = 0; frame < frameCount; ++frame)
+            {
+                float sample = random() * 2.0f; //mean 1, variance 1/3
+                cell = HashGridAddSample(cell, float3(sample, sample, sample), maxSampleCount);
+            }
+
+            sum += cell.radiance.x;
+            sumSquares += cell.radiance.x * cell.radiance.x;
+        }
+
+        double mean = sum / cellCount;
+        double variance = sumSquares / cellCount - mean * mean;
+        double varianceRatio = variance / (1.0 / 3.0); //against a single ray
+        double expectedRatio = 1.0 / (2.0 * maxSampleCount - 1.0);
+
+        HashGridCell cell = HashGridCreateCell(float3(0.0f, 0.0f, 0.0f), float3(0.0f, 1.0f, 0.0f), 0);
+        for (uint32_t frame = 0; frame < frameCount; ++frame)
+        {
+            cell = HashGridAddSample(cell, float3(1.0f, 1.0f, 1.0f), maxSampleCount);
+        }
+
+        uint32_t decayErrors = 0;
+        float expected = 1.0f;
+        for (uint32_t frame = 0; frame < maxSampleCount * 4; ++frame)
+        {
+            cell = HashGridAddSample(cell, float3(0.0f, 0.0f, 0.0f), maxSampleCount);
+            expected *= 1.0f - 1.0f / maxSampleCount;
+            decayErrors += fabsf(cell.radiance.x - expected) > 1.0e-4f ? 1 : 0;
+        }
+
+        bool converged = fabs(mean - 1.0) < 0.02 && varianceRatio < expectedRatio * 1.25 && varianceRatio > expectedRatio * 0.75;
+
+        RE_INFO("[HashGridRadianceCache] a cell of {} samples : mean {:.4f}, variance {:.4f}x the one of a ray (expected {:.4f}x), {} decay errors",
+            maxSampleCount, mean, varianceRatio, expectedRatio, decayErrors);
+        failures += decayErrors + (converged ? 0 : 1);
+    }
+
+    //timings
+    {
+        const uint32_t capacity = 1u << 21;
+        HashGridRadianceCacheParams params = GetTestParams(capacity);
+        CpuHashGrid grid(capacity);
+
+        eastl::vector<float3> positions(capacity / 2);
+        for (float3& position : positions)
+        {
+            position = params.cameraPosition + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 200.0f;
+        }
+
+        uint64_t start = stm_now();
+        uint32_t found = 0;
+        for (uint32_t pass = 0; pass < 2; ++pass)
+        {
+            for (const float3& position : positions)
+            {
+                found += QueryCell(grid, params, position, float3(0.0f, 1.0f, 0.0f)) != HASH_GRID_INVALID_SLOT ? 1 : 0;
+            }
+        }
+        double time = stm_ms(stm_since(start));
+
+        RE_INFO("[HashGridRadianceCache] {} queries of {} points in a table of {} : {:.3f} ms, {:.1f} ns per query",
+            positions.size() * 2, positions.size(), capacity, time, time * 1.0e6 / (positions.size() * 2));
+        failures += found == 0 ? 1 : 0;
+    }
+
+    if (failures > 0)
+    {
+        RE_ERROR("[HashGridRadianceCache] verification failed : {} errors", failures);
+    }
+    else
+    {
+        RE_INFO("[HashGridRadianceCache] verification passed");
+    }
+
+    return failures == 0;
+}
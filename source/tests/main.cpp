@@ -0,0 +1,152 @@
+#include "tests.h"
+#include "core/engine.h"
+#include "utils/log.h"
+#include "rpmalloc/rpmalloc.h"
+#include <unistd.h>
+#include <limits.h>
+
+// runs the engine self tests on the mock backend.
+// usage : RealEngineTests [test names] [-texture_dir textures/] [-texture_io_requests 8] [-animation_instances 1000] [-skeleton_characters 500]
+// without names all the tests run, returns 1 if any of them failed
+
+struct TestCase
+{
+    const char* name;
+    bool (*function)();
+};
+
+static const TestCase s_tests[] =
+{
+    { "texture_io", TestAsyncTextureLoader },
+    { "tlas_tracker", TestTLASTracker },
+    { "animation_sampling", TestAnimationClipSampling },
+    { "animation_compression", TestAnimationCompression },
+    { "skeleton_evaluation", TestSkeletonEvaluation },
+    { "animation_lod", TestAnimationLOD },
+    { "animation_blending", TestAnimationBlending },
+    { "animation_state_machine", TestAnimationStateMachine },
+    { "light_binning", TestLightBinning },
+    { "light_culling", TestLightCulling },
+    { "light_tree", TestLightTree },
+    { "radiance_cache", TestRadianceCache },
+};
+
+static TestSettings s_settings;
+
+const TestSettings& GetTestSettings()
+{
+    return s_settings;
+}
+
+static const TestCase* FindTest(const char* name)
+{
+    for (const TestCase& test : s_tests)
+    {
+        if (strcmp(test.name, name) == 0)
+        {
+            return &test;
+        }
+    }
+    return nullptr;
+}
+
+static eastl::string GetWorkPath()
+{
+    char exe_file[PATH_MAX] = {};
+    ssize_t length = readlink("/proc/self/exe", exe_file, PATH_MAX - 1);
+    if (length <= 0)
+    {
+        return "./";
+    }
+
+    eastl::string work_path(exe_file, length);
+
+    size_t last_slash = work_path.find_last_of('/');
+    return work_path.substr(0, last_slash + 1);
+}
+
+int main(int argc, char* argv[])
+{
+    rpmalloc_initialize();
+
+    eastl::vector<const TestCase*> selected_tests;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : "";
+
+        if (strcmp(arg, "-texture_dir") == 0)
+        {
+            s_settings.texture_directory = value;
+            ++i;
+        }
+        else if (strcmp(arg, "-texture_io_requests") == 0)
+        {
+            s_settings.texture_io_requests = (uint32_t)atoi(value);
+            ++i;
+        }
+        else if (strcmp(arg, "-animation_instances") == 0)
+        {
+            s_settings.animation_instances = (uint32_t)atoi(value);
+            ++i;
+        }
+        else if (strcmp(arg, "-skeleton_characters") == 0)
+        {
+            s_settings.skeleton_characters = (uint32_t)atoi(value);
+            ++i;
+        }
+        else if (const TestCase* test = FindTest(arg))
+        {
+            selected_tests.push_back(test);
+        }
+        else
+        {
+            printf("unknown test or option : %s\n", arg);
+            return 1;
+        }
+    }
+
+    if (selected_tests.empty())
+    {
+        for (const TestCase& test : s_tests)
+        {
+            selected_tests.push_back(&test);
+        }
+    }
+
+    //the tests need the task scheduler, and some of them the renderer
+    Engine::GetInstance()->Init(GetWorkPath(), nullptr, 1920, 1080);
+
+    uint32_t failed_count = 0;
+    uint32_t skipped_count = 0;
+
+    for (const TestCase* test : selected_tests)
+    {
+        if (test->function == TestAsyncTextureLoader && s_settings.texture_directory.empty())
+        {
+            RE_WARN("[Tests] {} : skipped, it needs -texture_dir", test->name);
+            skipped_count++;
+            continue;
+        }
+
+        RE_INFO("[Tests] {} : running", test->name);
+
+        bool passed = test->function();
+        if (passed)
+        {
+            RE_INFO("[Tests] {} : passed", test->name);
+        }
+        else
+        {
+            RE_ERROR("[Tests] {} : FAILED", test->name);
+            failed_count++;
+        }
+    }
+
+    RE_INFO("[Tests] {} passed, {} failed, {} skipped", (uint32_t)selected_tests.size() - failed_count - skipped_count, failed_count, skipped_count);
+
+    Engine::GetInstance()->Shut();
+
+    return failed_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+#include "tests.h"
+#include "renderer/ray_tracing_tlas_tracker.h"
+#include "utils/log.h"
+#include "magic_enum/magic_enum.hpp"
+
+bool TestTLASTracker()
+{
+    IGfxRayTracingBLAS* blas_a = (IGfxRayTracingBLAS*)0x1000;
+    IGfxRayTracingBLAS* blas_b = (IGfxRayTracingBLAS*)0x2000;
+
+    eastl::vector<GfxRayTracingInstance> instances(4);
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        instances[i] = {};
+        instances[i].blas = i % 2 ? blas_b : blas_a;
+        instances[i].transform[0] = instances[i].transform[5] = instances[i].transform[10] = 1.0f;
+        instances[i].transform[3] = (float)i;
+        instances[i].instance_id = i;
+        instances[i].instance_mask = 0xFF;
+    }
+
+    struct Step
+    {
+        const char* name;
+        RayTracingTLASUpdate expected;
+    };
+    eastl::vector<eastl::pair<Step, RayTracingTLASUpdate>> results;
+
+    RayTracingTLASTracker tracker;
+    tracker.SetMaxRefits(2);
+
+    auto check = [&](const char* name, RayTracingTLASUpdate expected)
+    {
+        results.push_back({ { name, expected }, tracker.Update(instances.data(), (uint32_t)instances.size()) });
+    };
+
+    check("first update", RayTracingTLASUpdate::Rebuild);
+    check("unchanged", RayTracingTLASUpdate::None);
+
+    instances[1].transform[7] += 1.0f;
+    check("one instance moved", RayTracingTLASUpdate::Refit);
+    bool moved_counted = tracker.GetStats().moved_instances == 1 && tracker.GetStats().static_instances == 3;
+
+    check("unchanged after a refit", RayTracingTLASUpdate::None);
+
+    results.push_back({ { "blas updated", RayTracingTLASUpdate::Refit }, tracker.Update(instances.data(), (uint32_t)instances.size(), true) });
+    tracker.SetMaxRefits(3);
+
+    instances[2].transform[3] += 1.0f;
+    check("second refit", RayTracingTLASUpdate::Refit);
+
+    instances[2].transform[3] += 1.0f;
+    check("refit limit reached", RayTracingTLASUpdate::Rebuild);
+
+    instances[3].instance_mask = 0x1;
+    check("mask changed", RayTracingTLASUpdate::Rebuild);
+
+    instances[0].blas = blas_b;
+    check("blas changed", RayTracingTLASUpdate::Rebuild);
+
+    instances[0].flags = GfxRayTracingInstanceFlagFrontFaceCCW;
+    check("flags changed", RayTracingTLASUpdate::Rebuild);
+
+    instances.pop_back();
+    check("instance removed", RayTracingTLASUpdate::Rebuild);
+
+    tracker.Invalidate();
+    check("invalidated", RayTracingTLASUpdate::Rebuild);
+
+    uint32_t failures = moved_counted ? 0 : 1;
+    if (!moved_counted)
+    {
+        RE_WARN("[RayTracingTLASTracker] the moved instances are not counted correctly");
+    }
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Step& step = results[i].first;
+        if (results[i].second != step.expected)
+        {
+            RE_WARN("[RayTracingTLASTracker] {} : expected {}, got {}", step.name,
+                magic_enum::enum_name(step.expected), magic_enum::enum_name(results[i].second));
+            failures++;
+        }
+    }
+
+    RE_INFO("[RayTracingTLASTracker] verified {} steps, {} failures", results.size(), failures);
+
+    return failures == 0;
+}
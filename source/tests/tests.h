@@ -0,0 +1,53 @@
+#pragma once
+
+#include "EASTL/string.h"
+
+//options of the test runner, see main.cpp
+struct TestSettings
+{
+    eastl::string texture_directory; //the texture io test is skipped without it
+    uint32_t texture_io_requests = 8;
+    uint32_t animation_instances = 1000;
+    uint32_t skeleton_characters = 500;
+};
+
+const TestSettings& GetTestSettings();
+
+//each test logs its results and returns false on any failure
+
+//loads every texture of the directory serially then through the async loader, and compares the results
+bool TestAsyncTextureLoader();
+
+//checks the rebuild/refit decisions of RayTracingTLASTracker on handmade instance lists
+bool TestTLASTracker();
+
+//samples a long synthetic clip for many instances with the cursors, and checks them against a linear keyframe scan
+bool TestAnimationClipSampling();
+
+//compresses a synthetic clip on a synthetic skeleton, and compares the node positions sampled from the raw and compressed clips
+bool TestAnimationCompression();
+
+//evaluates synthetic characters across the task threads, and compares their global transforms against a recursive hierarchy walk
+bool TestSkeletonEvaluation();
+
+//checks the skinned bounds, box culling, screen sizes and reduced node sets of the animation LODs
+bool TestAnimationLOD();
+
+//checks pose blending, masks and additive layers on handmade poses, and times the blending of a 64 nodes pose
+bool TestAnimationBlending();
+
+//plays handmade clips through state machine transitions and layers, and compares the poses against the blending functions
+bool TestAnimationStateMachine();
+
+//bins 64 to 16k synthetic lights with ClusteredLightBinner::Bin and BinReference, and compares the light lists
+bool TestLightBinning();
+
+//runs a CPU version of the light culling shader, wave compaction included, against ClusteredLightBinner on the same clusters,
+//and checks that every light reaching a pixel is in its cluster
+bool TestLightCulling();
+
+//builds and refits light trees of synthetic lights, checks their bounds, determinism and sampling probabilities, and times them
+bool TestLightTree();
+
+//fills the hash grid of the radiance cache on the CPU, checks its keys, levels, probing, evictions and cell convergence
+bool TestRadianceCache();
@@ -0,0 +1,414 @@
+#include "tests.h"
+#include "renderer/lighting/tiled_light_trees.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+#include "EASTL/algorithm.h"
+
+//what CalculateLocalLight gives to a white lambertian surface, up to a constant
+static float GetLightContribution(const LocalLightData& light, const float3& position, const float3& normal)
+{
+    float3 toLight = light.position - position;
+    float distance = length(toLight);
+    if (distance <= 0.0f || distance >= light.radius)
+    {
+        return 0.0f;
+    }
+
+    float3 L = toLight / distance;
+    float s2 = (distance / light.radius) * (distance / light.radius);
+    float attenuation = (1.0f - s2) * (1.0f - s2) / (1.0f + light.falloff * s2);
+
+    if ((LocalLightType)light.type == LocalLightType::Spot)
+    {
+        float spot = eastl::clamp(dot(light.direction, L) * light.spotAngles.x + light.spotAngles.y, 0.0f, 1.0f);
+        attenuation *= spot * spot;
+    }
+
+    float cosTheta = dot(normal, normal) > 0.0f ? eastl::max(dot(normal, L), 0.0f) : 1.0f;
+    return LightTree::GetLightEnergy(light) * attenuation * cosTheta;
+}
+
+//a large room of lights, a quarter of them gathered around a few spots, with a few spot and rect lights and some long ranges
+static void GenerateLights(uint32_t count, uint32_t& seed, eastl::vector<LocalLightData>& lights)
+{
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+    float3 clumps[32];
+    for (uint32_t i = 0; i < 32; ++i)
+    {
+        clumps[i] = float3(random() * 200.0f - 100.0f, random() * 20.0f, random() * 200.0f - 100.0f);
+    }
+
+    lights.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        LocalLightData light = {};
+        light.type = (uint)(i % 16 == 15 ? LocalLightType::Rect : (i % 3 == 2 ? LocalLightType::Spot : LocalLightType::Point));
+        light.position = i % 4 == 0 ?
+            clumps[i / 4 % 32] + float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 4.0f :
+            float3(random() * 200.0f - 100.0f, random() * 20.0f, random() * 200.0f - 100.0f);
+        light.radius = i % 64 == 0 ? 40.0f + 20.0f * random() : 2.0f + 10.0f * random();
+        light.color = float3(random(), random(), random()) * (0.1f + 10.0f * random() * random());
+        light.falloff = 1.0f + 15.0f * random();
+
+        if ((LocalLightType)light.type == LocalLightType::Spot)
+        {
+            float3 direction = float3(random() - 0.5f, random() * 2.0f, random() - 0.5f); //mostly facing down
+            light.direction = normalize(direction);
+
+            float outerAngle = 10.0f + 70.0f * random();
+            float cosInnerAngle = cosf(radians(outerAngle * 0.7f));
+            float cosOuterAngle = cosf(radians(outerAngle));
+            float invAngleRange = 1.0f / eastl::max(cosInnerAngle - cosOuterAngle, 0.001f);
+            light.spotAngles = float3(invAngleRange, -cosOuterAngle * invAngleRange, radians(outerAngle));
+        }
+
+        lights[i] = light;
+    }
+}
+
+//every node bounds its children, and every light has one leaf
+static uint32_t CheckLightTree(const LightTree& tree, const eastl::vector<LocalLightData>& lights)
+{
+    const eastl::vector<LightTreeNode>& nodes = tree.GetNodes();
+    const eastl::vector<uint32_t>& leaves = tree.GetLightLeaves();
+
+    uint32_t errors = nodes.size() == 2 * lights.size() - 1 ? 0 : 1;
+
+    for (uint32_t light = 0; light < (uint32_t)lights.size(); ++light)
+    {
+        const LightTreeNode& leaf = nodes[leaves[light]];
+        if (leaf.child != (light | LIGHT_TREE_LEAF_BIT) || leaf.boundsMin != lights[light].position)
+        {
+            ++errors;
+        }
+    }
+
+    for (uint32_t i = 0; i < (uint32_t)nodes.size(); ++i)
+    {
+        const LightTreeNode& node = nodes[i];
+        if (IsLightTreeLeaf(node))
+        {
+            continue;
+        }
+
+        const LightTreeNode& left = nodes[node.child];
+        const LightTreeNode& right = nodes[node.child + 1];
+
+        if (node.child <= i || left.parent != i || right.parent != i)
+        {
+            ++errors;
+            continue;
+        }
+
+        for (const LightTreeNode* child : { &left, &right })
+        {
+            float angle = acosf(eastl::clamp(dot(node.axis, child->axis), -1.0f, 1.0f));
+
+            if (!all(gequal(child->boundsMin, node.boundsMin)) || !all(lequal(child->boundsMax, node.boundsMax)) ||
+                child->maxRadius > node.maxRadius || child->minFalloff < node.minFalloff || child->thetaE > node.thetaE ||
+                (node.thetaO < PI && angle + child->thetaO > node.thetaO + LIGHT_TREE_ANGLE_EPSILON))
+            {
+                ++errors;
+            }
+        }
+
+        if (fabsf(left.energy + right.energy - node.energy) > 1.0e-4f * node.energy)
+        {
+            ++errors;
+        }
+    }
+
+    return errors;
+}
+
+//probabilities of every light, walking down from the cut, and the probability of reaching a node whose children are both out of reach
+static void EnumerateLightTreePdf(const LightTreeNode* nodes, uint32_t nodeIndex, float probability, const float3& position, const float3& normal,
+    eastl::vector<float>& lightPdf, float& deadEndProbability)
+{
+    const LightTreeNode& node = nodes[nodeIndex];
+    if (IsLightTreeLeaf(node))
+    {
+        lightPdf[node.child & ~LIGHT_TREE_LEAF_BIT] = probability;
+        return;
+    }
+
+    float leftImportance = LightTreeImportance(nodes[node.child], position, normal);
+    float rightImportance = LightTreeImportance(nodes[node.child + 1], position, normal);
+    float importance = leftImportance + rightImportance;
+
+    if (importance <= 0.0f)
+    {
+        deadEndProbability += probability;
+        return;
+    }
+
+    if (leftImportance > 0.0f)
+    {
+        EnumerateLightTreePdf(nodes, node.child, probability * (leftImportance / importance), position, normal, lightPdf, deadEndProbability);
+    }
+
+    if (rightImportance > 0.0f)
+    {
+        EnumerateLightTreePdf(nodes, node.child + 1, probability * (rightImportance / importance), position, normal, lightPdf, deadEndProbability);
+    }
+}
+
+struct LightTreeSamplingErrors
+{
+    uint32_t cutOverlaps = 0; //lights under two nodes of a cut
+    uint32_t prunedLights = 0; //lights reaching the position but not under the cut
+    uint32_t zeroPdfLights = 0; //lights reaching the position which can not be sampled
+    uint32_t pdfMismatches = 0; //LightTreePdf against the enumeration and the sampled pdf
+    uint32_t pdfSums = 0; //the probabilities do not sum to one
+    uint32_t frequencies = 0; //a light is sampled more or less often than its pdf
+    uint32_t estimates = 0; //the estimate of the lighting is off by more than 5 sigmas
+
+    uint32_t Total() const { return cutOverlaps + prunedLights + zeroPdfLights + pdfMismatches + pdfSums + frequencies + estimates; }
+};
+
+static bool PdfEqual(float a, float b)
+{
+    return fabsf(a - b) <= 1.0e-3f * eastl::max(a, b) + 1.0e-9f;
+}
+
+//shading points inside random tile sized boxes, with the cut of their box
+static LightTreeSamplingErrors CheckLightTreeSampling(const LightTree& tree, const eastl::vector<LocalLightData>& lights, uint32_t& seed, float& varianceRatio)
+{
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+
+    const LightTreeNode* nodes = tree.GetNodes().data();
+    const eastl::vector<uint32_t>& leaves = tree.GetLightLeaves();
+    const uint32_t lightCount = (uint32_t)lights.size();
+    const uint32_t pointCount = 64;
+    const uint32_t sampleCount = 2048;
+
+    LightTreeSamplingErrors errors;
+    eastl::vector<float> contributions(lightCount);
+    eastl::vector<float> lightPdf(lightCount);
+    eastl::vector<float> enumeratedPdf(lightCount);
+    eastl::vector<uint32_t> sampledCount(lightCount);
+
+    double treeVarianceSum = 0.0;
+    double uniformVarianceSum = 0.0;
+
+    for (uint32_t point = 0; point < pointCount; ++point)
+    {
+        float3 boxCenter = float3(random() * 200.0f - 100.0f, random() * 20.0f, random() * 200.0f - 100.0f);
+        float3 boxExtent = float3(random(), random(), random()) * 4.0f + 0.2f;
+        float3 boxMin = boxCenter - boxExtent;
+        float3 boxMax = boxCenter + boxExtent;
+
+        float3 position = boxMin + (boxMax - boxMin) * float3(random(), random(), random());
+        float3 normal = point % 4 == 3 ? float3(0.0f, 0.0f, 0.0f) : normalize(float3(random() - 0.5f, random() - 0.3f, random() - 0.5f));
+
+        LightTreeCut cut = BuildLightTreeCut(nodes, boxMin, boxMax);
+
+        float exact = 0.0f;
+        float pdfSum = 0.0f;
+        uint32_t reachingLights = 0;
+
+        for (uint32_t light = 0; light < lightCount; ++light)
+        {
+            contributions[light] = GetLightContribution(lights[light], position, normal);
+            exact += contributions[light];
+            reachingLights += contributions[light] > 0.0f ? 1 : 0;
+
+            uint32_t cutNodes = 0;
+            for (uint32_t node = leaves[light]; node != LIGHT_TREE_INVALID_INDEX; node = nodes[node].parent)
+            {
+                cutNodes += eastl::find(cut.nodes, cut.nodes + cut.nodeCount, node) != cut.nodes + cut.nodeCount ? 1 : 0;
+            }
+
+            errors.cutOverlaps += cutNodes > 1 ? 1 : 0;
+            errors.prunedLights += cutNodes == 0 && contributions[light] > 0.0f ? 1 : 0;
+
+            lightPdf[light] = LightTreePdf(nodes, cut, position, normal, leaves[light]);
+            errors.zeroPdfLights += contributions[light] > 0.0f && lightPdf[light] <= 0.0f ? 1 : 0;
+            pdfSum += lightPdf[light];
+        }
+
+        //the same probabilities from the top
+        float cutImportance = 0.0f;
+        for (uint32_t i = 0; i < cut.nodeCount; ++i)
+        {
+            cutImportance += LightTreeImportance(nodes[cut.nodes[i]], position, normal);
+        }
+
+        eastl::fill(enumeratedPdf.begin(), enumeratedPdf.end(), 0.0f);
+        float deadEndProbability = 0.0f;
+        for (uint32_t i = 0; i < cut.nodeCount && cutImportance > 0.0f; ++i)
+        {
+            float importance = LightTreeImportance(nodes[cut.nodes[i]], position, normal);
+            if (importance > 0.0f)
+            {
+                EnumerateLightTreePdf(nodes, cut.nodes[i], importance / cutImportance, position, normal, enumeratedPdf, deadEndProbability);
+            }
+        }
+
+        for (uint32_t light = 0; light < lightCount; ++light)
+        {
+            errors.pdfMismatches += PdfEqual(lightPdf[light], enumeratedPdf[light]) ? 0 : 1;
+        }
+
+        if (cutImportance > 0.0f && fabsf(pdfSum + deadEndProbability - 1.0f) > 1.0e-3f)
+        {
+            ++errors.pdfSums;
+        }
+
+        if (cutImportance <= 0.0f)
+        {
+            errors.estimates += exact > 0.0f ? 1 : 0;
+            continue;
+        }
+
+        //sampling
+        eastl::fill(sampledCount.begin(), sampledCount.end(), 0);
+        double sum = 0.0;
+
+        for (uint32_t sample = 0; sample < sampleCount; ++sample)
+        {
+            LightTreeSample lightSample = SampleLightTree(nodes, cut, position, normal, eastl::min(random(), 0.99999994f));
+            if (lightSample.lightIndex == LIGHT_TREE_INVALID_INDEX)
+            {
+                continue;
+            }
+
+            sampledCount[lightSample.lightIndex]++;
+            errors.pdfMismatches += PdfEqual(lightSample.pdf, lightPdf[lightSample.lightIndex]) ? 0 : 1;
+
+            double estimate = contributions[lightSample.lightIndex] / lightSample.pdf;
+            sum += estimate;
+        }
+
+        for (uint32_t light = 0; light < lightCount; ++light)
+        {
+            float pdf = enumeratedPdf[light];
+            float frequency = (float)sampledCount[light] / sampleCount;
+            if (fabsf(frequency - pdf) > 5.0f * sqrtf(pdf * (1.0f - pdf) / sampleCount) + 1.0f / sampleCount)
+            {
+                ++errors.frequencies;
+            }
+        }
+
+        //the variance of one sample, from the enumerated probabilities since the rare samples may not show up
+        double variance = -(double)exact * exact;
+        double uniformVariance = -(double)exact * exact;
+        for (uint32_t light = 0; light < lightCount; ++light)
+        {
+            double contribution = contributions[light];
+            variance += enumeratedPdf[light] > 0.0f ? contribution * contribution / enumeratedPdf[light] : 0.0;
+            uniformVariance += contribution * contribution * lightCount;
+        }
+
+        double mean = sum / sampleCount;
+        if (fabs(mean - exact) > 5.0 * sqrt(eastl::max(variance, 0.0) / sampleCount) + 1.0e-4 * exact)
+        {
+            ++errors.estimates;
+        }
+
+        //against picking one of the lights uniformly, relative to the lighting
+        if (exact > 0.0f)
+        {
+            treeVarianceSum += variance / ((double)exact * exact);
+            uniformVarianceSum += uniformVariance / ((double)exact * exact);
+        }
+    }
+
+    varianceRatio = uniformVarianceSum > 0.0 ? (float)(treeVarianceSum / uniformVarianceSum) : 0.0f;
+    return errors;
+}
+
+bool TestLightTree()
+{
+    uint32_t seed = 24680;
+    uint32_t failures = 0;
+
+    eastl::vector<LocalLightData> lights;
+    GenerateLights(3000, seed, lights);
+
+    //the parallel build, a second one and a serial one must give the same nodes
+    LightTree tree;
+    tree.Build(lights.data(), (uint32_t)lights.size());
+
+    LightTree serialTree;
+    serialTree.Build(lights.data(), (uint32_t)lights.size(), false);
+
+    LightTree secondTree;
+    secondTree.Build(lights.data(), (uint32_t)lights.size());
+
+    uint32_t differences = 0;
+    for (const LightTree* other : { &serialTree, &secondTree })
+    {
+        differences += memcmp(tree.GetNodes().data(), other->GetNodes().data(), sizeof(LightTreeNode) * tree.GetNodes().size()) != 0 ? 1 : 0;
+        differences += tree.GetLightLeaves() != other->GetLightLeaves() ? 1 : 0;
+    }
+
+    RE_INFO("[TiledLightTrees] {} lights, {} nodes, depth {} : {} differences between the parallel, second and serial builds",
+        lights.size(), tree.GetNodes().size(), tree.GetDepth(), differences);
+    failures += differences;
+
+    //the built tree, then the tree refitted to lights moving a few meters
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        if (pass == 1)
+        {
+            auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return (seed >> 8) / 16777216.0f; };
+            for (size_t i = 0; i < lights.size(); ++i)
+            {
+                lights[i].position += float3(random() - 0.5f, random() - 0.5f, random() - 0.5f) * 4.0f;
+            }
+
+            float buildCost = tree.GetCost();
+            tree.Refit(lights.data(), (uint32_t)lights.size());
+            RE_INFO("[TiledLightTrees] refitted to moved lights, cost {:.3f}x the build", tree.GetCost() / buildCost);
+        }
+
+        uint32_t treeErrors = CheckLightTree(tree, lights);
+
+        float varianceRatio = 0.0f;
+        LightTreeSamplingErrors errors = CheckLightTreeSampling(tree, lights, seed, varianceRatio);
+
+        RE_INFO("[TiledLightTrees] {} : {} bound errors, {} cut overlaps, {} pruned lights, {} zero pdf lights, {} pdf mismatches, {} pdf sums, "
+            "{} frequencies, {} estimates off. variance {:.4f}x the one of uniform sampling",
+            pass == 0 ? "build" : "refit", treeErrors, errors.cutOverlaps, errors.prunedLights, errors.zeroPdfLights, errors.pdfMismatches, errors.pdfSums,
+            errors.frequencies, errors.estimates, varianceRatio);
+
+        failures += treeErrors + errors.Total();
+    }
+
+    //timings
+    const uint32_t lightCounts[] = { 10000, 50000 };
+    for (uint32_t lightCount : lightCounts)
+    {
+        GenerateLights(lightCount, seed, lights);
+
+        const uint32_t iterations = 10;
+        uint64_t buildTicks = 0;
+        uint64_t serialBuildTicks = 0;
+        uint64_t refitTicks = 0;
+
+        LightTree timedTree;
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            uint64_t start = stm_now();
+            timedTree.Build(lights.data(), lightCount, false);
+            serialBuildTicks += stm_since(start);
+
+            start = stm_now();
+            timedTree.Build(lights.data(), lightCount);
+            buildTicks += stm_since(start);
+
+            start = stm_now();
+            timedTree.Refit(lights.data(), lightCount);
+            refitTicks += stm_since(start);
+        }
+
+        RE_INFO("[TiledLightTrees] {} lights, depth {} : build {:.3f} ms, serial build {:.3f} ms, refit {:.3f} ms",
+            lightCount, timedTree.GetDepth(), stm_ms(buildTicks) / iterations, stm_ms(serialBuildTicks) / iterations, stm_ms(refitTicks) / iterations);
+
+        failures += CheckLightTree(timedTree, lights);
+    }
+
+    return failures == 0;
+}
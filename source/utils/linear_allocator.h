@@ -3,6 +3,7 @@
 #include "memory.h"
 #include "assert.h"
 #include "math.h"
+#include "EASTL/atomic.h"
 
 class LinearAllocator
 {
@@ -37,4 +38,89 @@ private:
     void* m_pMemory = nullptr;
     uint32_t m_nMemorySize = 0;
     uint32_t m_nPointerOffset = 0;
-};
\ No newline at end of file
+};
+
+//frame scoped allocator shared by multiple threads, each thread allocates from its own chunk.
+//new chunks are taken from the memory with an atomic add, so there is no lock.
+class ThreadLinearAllocator
+{
+public:
+    ThreadLinearAllocator(uint32_t memory_size, uint32_t thread_count, uint32_t chunk_size = 64 * 1024)
+    {
+        m_pMemory = RE_ALLOC(memory_size);
+        m_nMemorySize = memory_size;
+        m_nChunkSize = chunk_size;
+        m_pThreadChunks = new ThreadChunk[thread_count];
+        m_nThreadCount = thread_count;
+    }
+
+    ~ThreadLinearAllocator()
+    {
+        delete[] m_pThreadChunks;
+        RE_FREE(m_pMemory);
+    }
+
+    void* Alloc(uint32_t thread_index, uint32_t size, uint32_t alignment = 1)
+    {
+        RE_ASSERT(thread_index < m_nThreadCount);
+        ThreadChunk& chunk = m_pThreadChunks[thread_index];
+
+        uint32_t address = RoundUpPow2(chunk.offset, alignment);
+        if (address + size > chunk.end)
+        {
+            //allocations larger than a chunk get a dedicated one
+            uint32_t chunk_size = RoundUpPow2(max(size + alignment, m_nChunkSize), 256u);
+            uint32_t begin = m_nChunkOffset.fetch_add(chunk_size, eastl::memory_order_relaxed);
+            RE_ASSERT(begin + chunk_size <= m_nMemorySize);
+
+            chunk.offset = begin;
+            chunk.end = begin + chunk_size;
+            address = RoundUpPow2(chunk.offset, alignment);
+        }
+
+        chunk.offset = address + size;
+        chunk.allocated += size;
+
+        return (char*)m_pMemory + address;
+    }
+
+    //should be called when no thread is allocating
+    void Reset()
+    {
+        uint32_t allocated = 0;
+        for (uint32_t i = 0; i < m_nThreadCount; ++i)
+        {
+            allocated += m_pThreadChunks[i].allocated;
+            m_pThreadChunks[i] = ThreadChunk();
+        }
+
+        m_nLastFrameAllocated = allocated;
+        m_nLastFrameReserved = m_nChunkOffset.exchange(0);
+        m_nHighWaterMark = max(m_nHighWaterMark, m_nLastFrameReserved);
+    }
+
+    uint32_t GetMemorySize() const { return m_nMemorySize; }
+    uint32_t GetLastFrameAllocatedSize() const { return m_nLastFrameAllocated; } //requested by Alloc
+    uint32_t GetLastFrameReservedSize() const { return m_nLastFrameReserved; }   //taken by the chunks
+    uint32_t GetHighWaterMark() const { return m_nHighWaterMark; }
+
+private:
+    struct alignas(64) ThreadChunk //avoids false sharing
+    {
+        uint32_t offset = 0;
+        uint32_t end = 0;
+        uint32_t allocated = 0;
+    };
+
+    void* m_pMemory = nullptr;
+    uint32_t m_nMemorySize = 0;
+    uint32_t m_nChunkSize = 0;
+    eastl::atomic<uint32_t> m_nChunkOffset{ 0 };
+
+    ThreadChunk* m_pThreadChunks = nullptr;
+    uint32_t m_nThreadCount = 0;
+
+    uint32_t m_nLastFrameAllocated = 0;
+    uint32_t m_nLastFrameReserved = 0;
+    uint32_t m_nHighWaterMark = 0;
+};
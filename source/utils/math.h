@@ -227,6 +227,31 @@ inline bool FrustumCull(const float4* planes, uint32_t plane_count, float3 cente
     return true;
 }
 
+inline bool FrustumCull(const float4* planes, uint32_t plane_count, const float3& min, const float3& max)
+{
+    for (uint32_t i = 0; i < plane_count; i++)
+    {
+        //the corner furthest along the plane normal
+        float3 corner = select(gequal(planes[i].xyz(), 0.0f), max, min);
+        if (dot(corner, planes[i].xyz()) + planes[i].w < 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+inline void TransformAABB(const float4x4& mtx, const float3& min, const float3& max, float3& out_min, float3& out_max)
+{
+    float3 center = mul(mtx, float4((min + max) * 0.5f, 1.0f)).xyz();
+    float3 extent = (max - min) * 0.5f;
+    float3 world_extent = abs(mtx[0].xyz()) * extent.x + abs(mtx[1].xyz()) * extent.y + abs(mtx[2].xyz()) * extent.z;
+
+    out_min = center - world_extent;
+    out_max = center + world_extent;
+}
+
 // https://bartwronski.com/2017/04/13/cull-that-cone/
 inline float4 ConeBoundingSphere(float3 origin, float3 forward, float radius, float halfAngle)
 {
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "core/platform.h"
+#include "EASTL/string.h"
+#if RE_PLATFORM_WINDOWS
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//read only mapping of a whole file, the pages are loaded by the os on first access
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() = default;
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+    ~MemoryMappedFile()
+    {
+        Close();
+    }
+
+    bool Open(const eastl::string& file)
+    {
+        Close();
+
+#if RE_PLATFORM_WINDOWS
+        m_file = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+        {
+            Close();
+            return false;
+        }
+        m_size = (size_t)size.QuadPart;
+
+        m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (m_mapping == NULL)
+        {
+            Close();
+            return false;
+        }
+
+        m_pData = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        m_file = open(file.c_str(), O_RDONLY);
+        if (m_file < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(m_file, &st) != 0 || st.st_size == 0)
+        {
+            Close();
+            return false;
+        }
+        m_size = (size_t)st.st_size;
+
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+        m_pData = data != MAP_FAILED ? (const uint8_t*)data : nullptr;
+
+        if (m_pData)
+        {
+            madvise(data, m_size, MADV_SEQUENTIAL);
+        }
+#endif
+
+        if (m_pData == nullptr)
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+#if RE_PLATFORM_WINDOWS
+        if (m_pData)
+        {
+            UnmapViewOfFile(m_pData);
+        }
+        if (m_mapping != NULL)
+        {
+            CloseHandle(m_mapping);
+            m_mapping = NULL;
+        }
+        if (m_file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (m_pData)
+        {
+            munmap((void*)m_pData, m_size);
+        }
+        if (m_file >= 0)
+        {
+            close(m_file);
+            m_file = -1;
+        }
+#endif
+        m_pData = nullptr;
+        m_size = 0;
+    }
+
+    const uint8_t* GetData() const { return m_pData; }
+    size_t GetSize() const { return m_size; }
+
+private:
+#if RE_PLATFORM_WINDOWS
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = NULL;
+#else
+    int m_file = -1;
+#endif
+    const uint8_t* m_pData = nullptr;
+    size_t m_size = 0;
+};
@@ -3,5 +3,18 @@
 #include "gfx/gfx.h"
 #include "tracy/public/tracy/Tracy.hpp"
 
-#define CPU_EVENT(group, name) ZoneScopedN(name)
+//cpu timings of the event, collected only while a benchmark is running (see core/benchmark.h)
+class ScopedCpuEvent
+{
+public:
+    ScopedCpuEvent(const char* group, const char* name);
+    ~ScopedCpuEvent();
+
+private:
+    const char* m_group = nullptr;
+    const char* m_name = nullptr;
+    uint64_t m_startTime = 0;
+};
+
+#define CPU_EVENT(group, name) ZoneScopedN(name); ScopedCpuEvent __cpu_event(group, name)
 #define GPU_EVENT(pCommandList, event_name) ScopedGpuEvent __gpu_event(pCommandList, event_name, __FILE__, __FUNCTION__, __LINE__)
\ No newline at end of file
@@ -78,6 +78,8 @@ inline void SetCurrentThreadName(const eastl::string& name)
 {
 #if RE_PLATFORM_WINDOWS
     SetThreadDescription(GetCurrentThread(), string_to_wstring(name).c_str());
+#elif RE_PLATFORM_LINUX
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str()); //linux limits thread names to 16 characters
 #else
     pthread_setname_np(name.c_str());
 #endif
@@ -1,82 +1,535 @@
 #include "animation.h"
-#include "skeletal_mesh.h"
+#include "animation_compression.h"
+#include "utils/log.h"
+#include "EASTL/sort.h"
+#include "EASTL/algorithm.h"
 
-Animation::Animation(const eastl::string& name)
+static uint32_t GetComponentCount(AnimationChannelMode mode)
+{
+    return mode == AnimationChannelMode::Rotation ? 4 : 3;
+}
+
+//gltf is right handed
+static float4 ConvertHandedness(AnimationChannelMode mode, const float4& value)
+{
+    switch (mode)
+    {
+    case AnimationChannelMode::Translation:
+        return float4(value.x, value.y, -value.z, 0.0f);
+    case AnimationChannelMode::Rotation:
+        return float4(value.x, value.y, -value.z, -value.w);
+    default:
+        return float4(value.xyz(), 0.0f);
+    }
+}
+
+AnimationClip::AnimationClip(const eastl::string& name, const eastl::vector<AnimationChannel>& channels, const AnimationCompressionSettings* compression)
 {
     m_name = name;
+    m_bCompressed = compression != nullptr;
+
+    eastl::vector<uint32_t> order(channels.size());
+    for (uint32_t i = 0; i < (uint32_t)channels.size(); ++i)
+    {
+        order[i] = i;
+    }
+
+    eastl::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+        {
+            return (channels[a].mode == AnimationChannelMode::Rotation) < (channels[b].mode == AnimationChannelMode::Rotation);
+        });
+
+    eastl::vector<AnimationNodeTolerance> tolerances;
+    if (compression)
+    {
+        ComputeAnimationTolerances(*compression, channels, tolerances);
+    }
+
+    m_tracks.reserve(channels.size());
+    m_firstRotationTrack = (uint32_t)channels.size();
+
+    eastl::vector<float> times;
+    eastl::vector<float4> values;
+    eastl::vector<uint32_t> kept_keys;
+    eastl::vector<uint16_t> encoded;
+    eastl::vector<float4> decoded_values;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const AnimationChannel& channel = channels[order[i]];
+        RE_ASSERT(!channel.keyframes.empty());
+
+        uint32_t key_count = (uint32_t)channel.keyframes.size();
+        m_nRawKeyCount += key_count;
+
+        times.resize(key_count);
+        values.resize(key_count);
+        for (uint32_t k = 0; k < key_count; ++k)
+        {
+            times[k] = channel.keyframes[k].first;
+            values[k] = ConvertHandedness(channel.mode, channel.keyframes[k].second);
+
+            if (channel.mode == AnimationChannelMode::Rotation && k > 0 && dot(values[k - 1], values[k]) < 0.0f)
+            {
+                values[k] = -values[k]; //shortest path
+            }
+        }
+
+        Track track;
+        track.targetNode = channel.targetNode;
+        track.mode = channel.mode;
+        track.firstKey = (uint32_t)m_times.size();
+        track.components = GetComponentCount(channel.mode);
+        track.quantized = false;
+        track.rangeMin = float3(0.0f, 0.0f, 0.0f);
+        track.rangeExtent = float3(0.0f, 0.0f, 0.0f);
+
+        kept_keys.clear();
+        if (compression)
+        {
+            RE_ASSERT(channel.targetNode < tolerances.size());
+            const AnimationNodeTolerance& tolerance = tolerances[channel.targetNode];
+
+            if (channel.mode != AnimationChannelMode::Rotation)
+            {
+                float3 range_max = values[0].xyz();
+                track.rangeMin = range_max;
+                for (uint32_t k = 1; k < key_count; ++k)
+                {
+                    track.rangeMin = min(track.rangeMin, values[k].xyz());
+                    range_max = max(range_max, values[k].xyz());
+                }
+                track.rangeExtent = range_max - track.rangeMin;
+            }
+
+            float quantization_error = 0.0f;
+            encoded.resize(3 * key_count);
+            decoded_values.resize(key_count);
+            for (uint32_t k = 0; k < key_count; ++k)
+            {
+                EncodeKey(track, values[k], &encoded[3 * k]);
+                decoded_values[k] = DecodeKey(track, &encoded[3 * k]);
+                if (channel.mode == AnimationChannelMode::Rotation && dot(decoded_values[k], values[k]) < 0.0f)
+                {
+                    decoded_values[k] = -decoded_values[k]; //as flipped by Sample
+                }
+                quantization_error = max(quantization_error, GetAnimationKeyError(channel.mode, values[k], decoded_values[k], tolerance.reach));
+            }
+
+            //tracks with a too large range or reach for 16 bits keep their float values
+            track.quantized = quantization_error <= 0.5f * tolerance.position;
+
+            ReduceAnimationKeys(times.data(), values.data(), track.quantized ? decoded_values.data() : values.data(), key_count,
+                channel.mode, tolerance.reach, tolerance.position, kept_keys);
+        }
+        else
+        {
+            for (uint32_t k = 0; k < key_count; ++k)
+            {
+                kept_keys.push_back(k);
+            }
+        }
+
+        track.keyCount = (uint32_t)kept_keys.size();
+
+        if (channel.mode == AnimationChannelMode::Rotation && m_firstRotationTrack == (uint32_t)channels.size())
+        {
+            m_firstRotationTrack = (uint32_t)m_tracks.size();
+        }
+
+        for (uint32_t k = 0; k < track.keyCount; ++k)
+        {
+            m_times.push_back(times[kept_keys[k]]);
+        }
+
+        if (track.quantized)
+        {
+            track.valueOffset = (uint32_t)m_quantizedValues.size();
+            m_quantizedValues.resize(m_quantizedValues.size() + 3 * track.keyCount);
+
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                for (uint32_t k = 0; k < track.keyCount; ++k)
+                {
+                    m_quantizedValues[track.valueOffset + c * track.keyCount + k] = encoded[3 * kept_keys[k] + c];
+                }
+            }
+        }
+        else
+        {
+            track.valueOffset = (uint32_t)m_values.size();
+            m_values.resize(m_values.size() + track.components * track.keyCount);
+
+            for (uint32_t c = 0; c < track.components; ++c)
+            {
+                for (uint32_t k = 0; k < track.keyCount; ++k)
+                {
+                    m_values[track.valueOffset + c * track.keyCount + k] = values[kept_keys[k]][c];
+                }
+            }
+        }
+
+        m_duration = max(m_duration, channel.keyframes.back().first - channel.keyframes.front().first);
+        m_tracks.push_back(track);
+    }
+
+    if (compression)
+    {
+        RE_INFO("[AnimationClip] {} compressed : {} of {} keys, {:.1f} KB ({:.1f} KB as float4 keyframes)", m_name, GetKeyCount(), m_nRawKeyCount,
+            GetMemorySize() / 1024.0f, m_nRawKeyCount * sizeof(eastl::pair<float, float4>) / 1024.0f);
+    }
 }
 
-void Animation::Update(SkeletalMesh* mesh, float delta_time)
+uint32_t AnimationClip::GetMemorySize() const
 {
-    m_currentAnimTime += delta_time;
-    if (m_currentAnimTime > m_timeDuration)
+    return (uint32_t)(sizeof(Track) * m_tracks.size() + sizeof(float) * m_times.size() + sizeof(float) * m_values.size() + sizeof(uint16_t) * m_quantizedValues.size());
+}
+
+void AnimationClip::EncodeKey(const Track& track, const float4& value, uint16_t* encoded)
+{
+    if (track.mode == AnimationChannelMode::Rotation)
     {
-        m_currentAnimTime = m_currentAnimTime - m_timeDuration;
+        EncodeSmallestThree(value, encoded);
+        return;
     }
 
-    for (size_t i = 0; i < m_channels.size(); ++i)
+    for (uint32_t c = 0; c < 3; ++c)
     {
-        const AnimationChannel& channel = m_channels[i];
-        UpdateChannel(mesh, channel);
+        encoded[c] = QuantizeUnorm16(value[c], track.rangeMin[c], track.rangeExtent[c]);
     }
 }
 
-void Animation::UpdateChannel(SkeletalMesh* mesh, const AnimationChannel& channel)
+float4 AnimationClip::DecodeKey(const Track& track, const uint16_t* encoded)
 {
-    eastl::pair<float, float4> lower_frame;
-    eastl::pair<float, float4> upper_frame;
+    if (track.mode == AnimationChannelMode::Rotation)
+    {
+        return DecodeSmallestThree(encoded);
+    }
 
-    bool found = false;
-    for (size_t frame = 0; frame < channel.keyframes.size() - 1; ++frame)
+    return float4(DequantizeUnorm16(encoded[0], track.rangeMin.x, track.rangeExtent.x),
+        DequantizeUnorm16(encoded[1], track.rangeMin.y, track.rangeExtent.y),
+        DequantizeUnorm16(encoded[2], track.rangeMin.z, track.rangeExtent.z), 0.0f);
+}
+
+float4 AnimationClip::GetKeyValue(const Track& track, uint32_t key) const
+{
+    if (track.quantized)
     {
-        if (channel.keyframes[frame].first <= m_currentAnimTime &&
-            channel.keyframes[frame + 1].first >= m_currentAnimTime)
+        uint16_t encoded[3];
+        for (uint32_t c = 0; c < 3; ++c)
         {
-            lower_frame = channel.keyframes[frame];
-            upper_frame = channel.keyframes[frame + 1];
-            found = true;
-            break;
+            encoded[c] = m_quantizedValues[track.valueOffset + c * track.keyCount + key];
         }
+        return DecodeKey(track, encoded);
     }
 
-    float interpolation_value;
-    if (found)
+    float4 value(0.0f, 0.0f, 0.0f, 0.0f);
+    for (uint32_t c = 0; c < track.components; ++c)
     {
-        interpolation_value = (m_currentAnimTime - lower_frame.first) / (upper_frame.first - lower_frame.first);
+        value[c] = m_values[track.valueOffset + c * track.keyCount + key];
     }
-    else
+    return value;
+}
+
+void AnimationClip::InitCursor(AnimationCursor& cursor) const
+{
+    cursor.keys.clear();
+    cursor.keys.resize(m_tracks.size(), 0);
+}
+
+uint32_t AnimationClip::FindKey(const float* times, uint32_t key_count, float time, uint32_t& cursor, AnimationClipStats* stats)
+{
+    if (key_count < 2 || time <= times[0])
     {
-        lower_frame = upper_frame = channel.keyframes[0];
-        interpolation_value = 0.0f;
+        return 0;
     }
 
-    SkeletalMeshNode* node = mesh->GetNode(channel.targetNode);
+    if (time >= times[key_count - 1])
+    {
+        return key_count - 2;
+    }
 
-    switch (channel.mode)
+    //playing forward, the key is usually the same as last time or the next one
+    uint32_t key = cursor;
+    if (key + 1 < key_count && times[key] <= time && time < times[key + 1])
     {
-    case AnimationChannelMode::Translation:
+        if (stats) stats->cursor_hits++;
+        return key;
+    }
+
+    if (key + 2 < key_count && times[key + 1] <= time && time < times[key + 2])
     {
-        float3 lower_value = float3(lower_frame.second.x, lower_frame.second.y, -lower_frame.second.z);
-        float3 upper_value = float3(upper_frame.second.x, upper_frame.second.y, -upper_frame.second.z);
+        if (stats) stats->cursor_hits++;
+        cursor = key + 1;
+        return cursor;
+    }
+
+    if (stats) stats->binary_searches++;
+
+    const float* upper = eastl::upper_bound(times, times + key_count, time);
+    cursor = eastl::min((uint32_t)(upper - times) - 1, key_count - 2);
+    return cursor;
+}
+
+void AnimationClip::Sample(float time, AnimationCursor& cursor, AnimationSample& sample, AnimationClipStats* stats, const uint8_t* track_mask) const
+{
+    uint32_t track_count = (uint32_t)m_tracks.size();
+    RE_ASSERT(cursor.keys.size() == track_count);
 
-        node->translation = lerp(lower_value, upper_value, interpolation_value);
-        break;
+    if (sample.track_count != track_count)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            sample.values[c].resize(track_count);
+            sample.upper[c].resize(track_count);
+        }
+        sample.alpha.resize(track_count);
+        sample.track_count = track_count;
     }
-    case AnimationChannelMode::Rotation:
+
+    //gather the two keys around the time
+    for (uint32_t i = 0; i < track_count; ++i)
+    {
+        if (track_mask && !track_mask[i])
+        {
+            continue;
+        }
+
+        const Track& track = m_tracks[i];
+        const float* times = &m_times[track.firstKey];
+
+        uint32_t key = FindKey(times, track.keyCount, time, cursor.keys[i], stats);
+        uint32_t next_key = eastl::min(key + 1, track.keyCount - 1);
+
+        float duration = times[next_key] - times[key];
+        sample.alpha[i] = duration > 0.0f ? clamp((time - times[key]) / duration, 0.0f, 1.0f) : 0.0f;
+
+        if (track.quantized)
+        {
+            float4 lower = GetKeyValue(track, key);
+            float4 upper = GetKeyValue(track, next_key);
+            if (track.mode == AnimationChannelMode::Rotation && dot(lower, upper) < 0.0f)
+            {
+                upper = -upper; //the decoded keys have their largest component positive
+            }
+
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                sample.values[c][i] = lower[c];
+                sample.upper[c][i] = upper[c];
+            }
+        }
+        else
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                const float* values = &m_values[track.valueOffset + c * track.keyCount];
+                sample.values[c][i] = c < track.components ? values[key] : 0.0f;
+                sample.upper[c][i] = c < track.components ? values[next_key] : 0.0f;
+            }
+        }
+    }
+
+    //branchless loops over contiguous arrays, vectorized by the compiler
+    const float* alpha = sample.alpha.data();
+    for (uint32_t c = 0; c < 4; ++c)
     {
-        float4 lower_value = float4(lower_frame.second.x, lower_frame.second.y, -lower_frame.second.z, -lower_frame.second.w);
-        float4 upper_value = float4(upper_frame.second.x, upper_frame.second.y, -upper_frame.second.z, -upper_frame.second.w);
+        float* lower = sample.values[c].data();
+        const float* upper = sample.upper[c].data();
 
-        //node->rotation = slerp(lower_value, upper_value, interpolation_value);
-        node->rotation = rotation_slerp(lower_value, upper_value, interpolation_value);
-        break;
+        for (uint32_t i = 0; i < track_count; ++i)
+        {
+            lower[i] += (upper[i] - lower[i]) * alpha[i];
+        }
     }
-    case AnimationChannelMode::Scale:
+
+    float* x = sample.values[0].data();
+    float* y = sample.values[1].data();
+    float* z = sample.values[2].data();
+    float* w = sample.values[3].data();
+    for (uint32_t i = m_firstRotationTrack; i < track_count; ++i)
     {
-        node->scale = lerp(lower_frame.second.xyz(), upper_frame.second.xyz(), interpolation_value);
-        break;
+        float inv_length = 1.0f / sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i] + w[i] * w[i]);
+        x[i] *= inv_length;
+        y[i] *= inv_length;
+        z[i] *= inv_length;
+        w[i] *= inv_length;
     }
-    default:
-        break;
+}
+
+void AnimationHierarchy::Build(const eastl::vector<int32_t>& node_parents)
+{
+    uint32_t node_count = (uint32_t)node_parents.size();
+
+    eastl::vector<eastl::vector<uint32_t>> children(node_count);
+    indexToNode.clear();
+    indexToNode.reserve(node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        if (node_parents[i] < 0)
+        {
+            indexToNode.push_back(i);
+        }
+        else
+        {
+            children[node_parents[i]].push_back(i);
+        }
+    }
+
+    //breadth first, each node comes after its parent
+    for (size_t i = 0; i < indexToNode.size(); ++i)
+    {
+        const eastl::vector<uint32_t>& node_children = children[indexToNode[i]];
+        indexToNode.insert(indexToNode.end(), node_children.begin(), node_children.end());
+    }
+    RE_ASSERT(indexToNode.size() == node_count); //no cycle
+
+    nodeToIndex.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        nodeToIndex[indexToNode[i]] = i;
+    }
+
+    parents.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        int32_t parent = node_parents[indexToNode[i]];
+        parents[i] = parent < 0 ? -1 : (int32_t)nodeToIndex[parent];
+    }
+}
+
+void AnimationHierarchy::ComputeGlobalTransforms(const AnimationPose& pose, float4x4* global_transforms) const
+{
+    const float3* translations = pose.translations.data();
+    const float4* rotations = pose.rotations.data();
+    const float3* scales = pose.scales.data();
+
+    for (uint32_t i = 0; i < (uint32_t)parents.size(); ++i)
+    {
+        //T * R * S without the two matrix multiplications
+        float4x4 local = rotation_matrix(rotations[i]);
+        local[0] *= scales[i].x;
+        local[1] *= scales[i].y;
+        local[2] *= scales[i].z;
+        local[3] = float4(translations[i], 1.0f);
+
+        //the parent is always computed already, mul is vectorized with hlslpp
+        global_transforms[i] = parents[i] < 0 ? local : mul(global_transforms[parents[i]], local);
+    }
+}
+
+void AnimationHierarchy::BuildReducedSet(const AnimationPose& rest_pose, float min_reach_ratio)
+{
+    uint32_t node_count = GetNodeCount();
+    eastl::vector<float> reach(node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        reach[i] = length(rest_pose.translations[i]);
+    }
+
+    //children after their parents, so the reverse order sees all the children of a node before it
+    eastl::vector<uint8_t> has_children(node_count, 0);
+    for (uint32_t i = node_count; i-- > 0;)
+    {
+        int32_t parent = parents[i];
+        if (parent >= 0)
+        {
+            float chain = length(rest_pose.translations[i]) + (has_children[i] ? reach[i] : 0.0f);
+            reach[parent] = has_children[parent] ? eastl::max(reach[parent], chain) : chain;
+            has_children[parent] = 1;
+        }
+    }
+
+    float max_reach = 0.0f;
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        max_reach = eastl::max(max_reach, reach[i]);
+    }
+
+    reducedSet.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        reducedSet[i] = reach[i] >= min_reach_ratio * max_reach ? 1 : 0;
+    }
+}
+
+uint32_t AnimationHierarchy::GetReducedNodeCount() const
+{
+    uint32_t count = 0;
+    for (size_t i = 0; i < reducedSet.size(); ++i)
+    {
+        count += reducedSet[i];
+    }
+    return count;
+}
+
+Animation::Animation(eastl::shared_ptr<AnimationClip> clip)
+{
+    m_pClip = eastl::move(clip);
+    m_pClip->InitCursor(m_cursor);
+}
+
+void Animation::Bind(const AnimationHierarchy& hierarchy)
+{
+    m_trackTargets.resize(m_pClip->GetTrackCount());
+    for (uint32_t i = 0; i < m_pClip->GetTrackCount(); ++i)
+    {
+        m_trackTargets[i] = hierarchy.nodeToIndex[m_pClip->GetTargetNode(i)];
+    }
+
+    m_reducedTracks.clear();
+    if (!hierarchy.reducedSet.empty())
+    {
+        m_reducedTracks.resize(m_pClip->GetTrackCount());
+        for (uint32_t i = 0; i < m_pClip->GetTrackCount(); ++i)
+        {
+            m_reducedTracks[i] = hierarchy.reducedSet[m_trackTargets[i]];
+        }
+    }
+}
+
+void Animation::Update(float delta_time, AnimationPose& pose, bool reduced)
+{
+    RE_ASSERT(m_trackTargets.size() == m_pClip->GetTrackCount());
+
+    if (m_bPaused)
+    {
+        return;
+    }
+
+    m_currentAnimTime += delta_time;
+    if (m_currentAnimTime > m_pClip->GetDuration())
+    {
+        m_currentAnimTime = m_bLoop ? fmodf(m_currentAnimTime, m_pClip->GetDuration()) : m_pClip->GetDuration();
+    }
+
+    const uint8_t* track_mask = reduced && !m_reducedTracks.empty() ? m_reducedTracks.data() : nullptr;
+    m_pClip->Sample(m_currentAnimTime, m_cursor, m_sample, nullptr, track_mask);
+
+    for (uint32_t i = 0; i < m_pClip->GetTrackCount(); ++i)
+    {
+        if (track_mask && !track_mask[i])
+        {
+            continue;
+        }
+
+        uint32_t target = m_trackTargets[i];
+
+        switch (m_pClip->GetMode(i))
+        {
+        case AnimationChannelMode::Translation:
+            pose.translations[target] = m_sample.GetFloat3(i);
+            break;
+        case AnimationChannelMode::Rotation:
+            pose.rotations[target] = m_sample.GetFloat4(i);
+            break;
+        case AnimationChannelMode::Scale:
+            pose.scales[target] = m_sample.GetFloat3(i);
+            break;
+        default:
+            break;
+        }
     }
 }
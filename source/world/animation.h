@@ -3,6 +3,7 @@
 #include "utils/math.h"
 #include "EASTL/string.h"
 #include "EASTL/vector.h"
+#include "EASTL/shared_ptr.h"
 
 enum class AnimationChannelMode
 {
@@ -11,30 +12,164 @@ enum class AnimationChannelMode
     Scale,
 };
 
+//keyframes of one animated node property, used to build an AnimationClip
 struct AnimationChannel
 {
     uint32_t targetNode;
     AnimationChannelMode mode;
-    eastl::vector<eastl::pair<float, float4>> keyframes;
+    eastl::vector<eastl::pair<float, float4>> keyframes; //as stored in the gltf file
 };
 
-class SkeletalMesh;
+//the last key found for each track of a clip, most samples start their search there
+struct AnimationCursor
+{
+    eastl::vector<uint32_t> keys;
+};
 
-class Animation
+//sampled value of each track, one array per component
+struct AnimationSample
+{
+    eastl::vector<float> values[4];
+    uint32_t track_count = 0;
+
+    //upper keys and interpolation factors, gathered before the interpolation so that it runs over contiguous arrays
+    eastl::vector<float> upper[4];
+    eastl::vector<float> alpha;
+
+    float3 GetFloat3(uint32_t track) const { return float3(values[0][track], values[1][track], values[2][track]); }
+    float4 GetFloat4(uint32_t track) const { return float4(values[0][track], values[1][track], values[2][track], values[3][track]); }
+};
+
+struct AnimationClipStats
 {
-    friend class GLTFLoader;
+    uint32_t cursor_hits = 0;    //key found at the cursor or right after it
+    uint32_t binary_searches = 0;
+};
+
+struct AnimationCompressionSettings;
 
+//immutable keyframe data shared by the instances playing it.
+//tracks are sorted by mode with the rotations last, and store their times and values in separate arrays,
+//each value component of a track is contiguous. values are converted to the engine handedness at import,
+//and consecutive rotation keys are kept in the same hemisphere so that sampling is a plain nlerp.
+//with compression, the keys which can be interpolated are removed and the values are quantized (see animation_compression.h)
+class AnimationClip
+{
 public:
-    Animation(const eastl::string& name);
+    AnimationClip(const eastl::string& name, const eastl::vector<AnimationChannel>& channels, const AnimationCompressionSettings* compression = nullptr);
+
+    const eastl::string& GetName() const { return m_name; }
+    float GetDuration() const { return m_duration; }
+    uint32_t GetTrackCount() const { return (uint32_t)m_tracks.size(); }
+    uint32_t GetTargetNode(uint32_t track) const { return m_tracks[track].targetNode; }
+    AnimationChannelMode GetMode(uint32_t track) const { return m_tracks[track].mode; }
+    uint32_t GetKeyCount() const { return (uint32_t)m_times.size(); }
+    uint32_t GetRawKeyCount() const { return m_nRawKeyCount; } //before compression
+    uint32_t GetMemorySize() const;
+    bool IsCompressed() const { return m_bCompressed; }
 
-    void Update(SkeletalMesh* mesh, float delta_time);
+    void InitCursor(AnimationCursor& cursor) const;
+    //track_mask skips the tracks set to 0, their sample values are left as they were
+    void Sample(float time, AnimationCursor& cursor, AnimationSample& sample, AnimationClipStats* stats = nullptr, const uint8_t* track_mask = nullptr) const;
 
 private:
-    void UpdateChannel(SkeletalMesh* mesh, const AnimationChannel& channel);
+    static uint32_t FindKey(const float* times, uint32_t key_count, float time, uint32_t& cursor, AnimationClipStats* stats);
 
 private:
+    struct Track
+    {
+        uint32_t targetNode;
+        AnimationChannelMode mode;
+        uint32_t firstKey;    //in m_times
+        uint32_t keyCount;
+        uint32_t valueOffset; //in m_values, or m_quantizedValues if quantized. component c of key k is at valueOffset + c * keyCount + k
+        uint32_t components;
+
+        bool quantized;       //false if compression is off, or 16 bits are not enough for the tolerance
+
+        //quantization range of translations and scales
+        float3 rangeMin;
+        float3 rangeExtent;
+    };
+
+    static void EncodeKey(const Track& track, const float4& value, uint16_t* encoded);
+    static float4 DecodeKey(const Track& track, const uint16_t* encoded);
+    float4 GetKeyValue(const Track& track, uint32_t key) const;
+
     eastl::string m_name;
-    eastl::vector<AnimationChannel> m_channels;
-    float m_timeDuration = 0.0f;
+    eastl::vector<Track> m_tracks;
+    eastl::vector<float> m_times;
+    eastl::vector<float> m_values;
+    eastl::vector<uint16_t> m_quantizedValues; //3 components for all modes
+    bool m_bCompressed = false;
+    uint32_t m_nRawKeyCount = 0;
+    uint32_t m_firstRotationTrack = 0;
+    float m_duration = 0.0f;
+};
+
+//local transforms of the nodes of a mesh, in the order of its AnimationHierarchy
+struct AnimationPose
+{
+    eastl::vector<float3> translations;
+    eastl::vector<float4> rotations;
+    eastl::vector<float3> scales;
+};
+
+//node hierarchy flattened with the parents before their children, so that local to global is one linear pass
+struct AnimationHierarchy
+{
+    eastl::vector<int32_t> parents;      //-1 for roots
+    eastl::vector<uint32_t> nodeToIndex;
+    eastl::vector<uint32_t> indexToNode;
+
+    //nodes animated at reduced LOD, the others keep their rest pose
+    eastl::vector<uint8_t> reducedSet;
+
+    //node_parents is indexed by node id, -1 for roots
+    void Build(const eastl::vector<int32_t>& node_parents);
+    uint32_t GetNodeCount() const { return (uint32_t)parents.size(); }
+
+    //drops the nodes whose reach (longest chain of rest translations below them, or their own length for leaves)
+    //is under min_reach_ratio of the longest one, typically fingers and facial nodes
+    void BuildReducedSet(const AnimationPose& rest_pose, float min_reach_ratio);
+    uint32_t GetReducedNodeCount() const;
+
+    void ComputeGlobalTransforms(const AnimationPose& pose, float4x4* global_transforms) const;
+};
+
+//an instance playing a clip, the clip can be shared by many instances
+class Animation
+{
+public:
+    Animation(eastl::shared_ptr<AnimationClip> clip);
+
+    //maps the track targets to the hierarchy order
+    void Bind(const AnimationHierarchy& hierarchy);
+
+    //samples the clip into the animated nodes of the pose, only those of the hierarchy reduced set if reduced.
+    //thread safe across instances
+    void Update(float delta_time, AnimationPose& pose, bool reduced = false);
+
+    bool IsPaused() const { return m_bPaused; }
+    void SetPaused(bool value) { m_bPaused = value; }
+
+    //clips which do not loop stay on their last frame
+    bool IsLooping() const { return m_bLoop; }
+    void SetLooping(bool value) { m_bLoop = value; }
+
+    float GetTime() const { return m_currentAnimTime; }
+    void SetTime(float time) { m_currentAnimTime = time; }
+    float GetNormalizedTime() const { return m_pClip->GetDuration() > 0.0f ? m_currentAnimTime / m_pClip->GetDuration() : 1.0f; }
+
+    const AnimationClip* GetClip() const { return m_pClip.get(); }
+
+private:
+    eastl::shared_ptr<AnimationClip> m_pClip;
+    eastl::vector<uint32_t> m_trackTargets; //pose index of each track
+    eastl::vector<uint8_t> m_reducedTracks; //1 for the tracks targeting the reduced set
+    AnimationCursor m_cursor;
+    AnimationSample m_sample;
     float m_currentAnimTime = 0.0f;
-};
\ No newline at end of file
+    bool m_bPaused = false;
+    bool m_bLoop = true;
+};
@@ -0,0 +1,336 @@
+#include "animation_blend.h"
+#include "utils/log.h"
+
+//a float3 in an hlslpp register, with w in the last lane
+static inline hlslpp::float4 to_hlslpp(const float3& v, float w)
+{
+    return hlslpp::float4(v.x, v.y, v.z, w);
+}
+
+//the additive layers run on groups of 4 nodes transposed to SoA, one node per lane.
+//the poses stay AoS for the sampling and the skeleton, so the other layers, with a few lerps per node, are faster on one node per register
+struct SoaFloat3
+{
+    hlslpp::float4 x, y, z;
+};
+
+struct SoaQuaternion
+{
+    hlslpp::float4 x, y, z, w;
+};
+
+//the 4 nodes of a group from first, the last group is padded with pad
+template<typename T>
+static inline const T* GetNodeGroup(const eastl::vector<T>& values, uint32_t first, T* padded, const T& pad)
+{
+    uint32_t node_count = (uint32_t)values.size();
+    if (first + 4 <= node_count)
+    {
+        return values.data() + first;
+    }
+
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        padded[i] = first + i < node_count ? values[first + i] : pad;
+    }
+    return padded;
+}
+
+//the rows of the nodes are transposed in registers
+static inline SoaQuaternion Transpose(const hlslpp::float4& v0, const hlslpp::float4& v1, const hlslpp::float4& v2, const hlslpp::float4& v3)
+{
+    hlslpp::float4x4 m = hlslpp::transpose(hlslpp::float4x4(v0, v1, v2, v3));
+    return { hlslpp::float4(m.vec0), hlslpp::float4(m.vec1), hlslpp::float4(m.vec2), hlslpp::float4(m.vec3) };
+}
+
+static inline SoaFloat3 LoadSoa(const float3* v)
+{
+    SoaQuaternion soa = Transpose(to_hlslpp(v[0], 0.0f), to_hlslpp(v[1], 0.0f), to_hlslpp(v[2], 0.0f), to_hlslpp(v[3], 0.0f));
+    return { soa.x, soa.y, soa.z };
+}
+
+static inline SoaQuaternion LoadSoa(const float4* v)
+{
+    return Transpose(to_hlslpp(v[0]), to_hlslpp(v[1]), to_hlslpp(v[2]), to_hlslpp(v[3]));
+}
+
+//writes the nodes whose weight is positive, the other nodes are left untouched
+template<typename T>
+static inline void StoreSoa(const SoaQuaternion& soa, eastl::vector<T>& values, uint32_t first, const float* weights)
+{
+    SoaQuaternion aos = Transpose(soa.x, soa.y, soa.z, soa.w);
+
+    float rows[4][4];
+    hlslpp::store(aos.x, rows[0]);
+    hlslpp::store(aos.y, rows[1]);
+    hlslpp::store(aos.z, rows[2]);
+    hlslpp::store(aos.w, rows[3]);
+
+    uint32_t count = eastl::min((uint32_t)values.size() - first, 4u);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (weights[i] > 0.0f)
+        {
+            memcpy(&values[first + i], rows[i], sizeof(T));
+        }
+    }
+}
+
+static inline void StoreSoa(const SoaFloat3& soa, eastl::vector<float3>& values, uint32_t first, const float* weights)
+{
+    StoreSoa({ soa.x, soa.y, soa.z, hlslpp::float4(0.0f) }, values, first, weights);
+}
+
+//weight * mask of the 4 nodes from first, 0 for the padding and the negative weights
+static inline hlslpp::float4 GetNodeWeights(float weight, const AnimationMask* mask, uint32_t first, uint32_t node_count)
+{
+    float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < 4 && first + i < node_count; ++i)
+    {
+        weights[i] = mask ? weight * mask->weights[first + i] : weight;
+    }
+    return hlslpp::max(hlslpp::float4(weights[0], weights[1], weights[2], weights[3]), hlslpp::float4(0.0f));
+}
+
+static inline hlslpp::float4 Dot(const SoaQuaternion& a, const SoaQuaternion& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+static inline SoaQuaternion Scale(const SoaQuaternion& q, const hlslpp::float4& s)
+{
+    return { q.x * s, q.y * s, q.z * s, q.w * s };
+}
+
+//not rsqrt, its approximation is far from the precision of the scalar path
+static inline SoaQuaternion Normalize(const SoaQuaternion& q)
+{
+    return Scale(q, hlslpp::float4(1.0f) / hlslpp::sqrt(Dot(q, q)));
+}
+
+static inline SoaQuaternion Lerp(const SoaQuaternion& a, const SoaQuaternion& b, const hlslpp::float4& t)
+{
+    return { hlslpp::lerp(a.x, b.x, t), hlslpp::lerp(a.y, b.y, t), hlslpp::lerp(a.z, b.z, t), hlslpp::lerp(a.w, b.w, t) };
+}
+
+static inline SoaFloat3 Lerp(const SoaFloat3& a, const SoaFloat3& b, const hlslpp::float4& t)
+{
+    return { hlslpp::lerp(a.x, b.x, t), hlslpp::lerp(a.y, b.y, t), hlslpp::lerp(a.z, b.z, t) };
+}
+
+//-1 for the lanes where b must be flipped to the hemisphere of a, 1 otherwise
+static inline hlslpp::float4 HemisphereSign(const SoaQuaternion& a, const SoaQuaternion& b)
+{
+    return hlslpp::float4(1.0f) - hlslpp::float4(2.0f) * (Dot(a, b) < hlslpp::float4(0.0f));
+}
+
+//same as linalg qmul
+static inline SoaQuaternion Mul(const SoaQuaternion& a, const SoaQuaternion& b)
+{
+    return {
+        a.x * b.w + a.w * b.x + a.y * b.z - a.z * b.y,
+        a.y * b.w + a.w * b.y + a.z * b.x - a.x * b.z,
+        a.z * b.w + a.w * b.z + a.x * b.y - a.y * b.x,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+    };
+}
+
+void AnimationMask::Build(const AnimationHierarchy& hierarchy, uint32_t root_node, float weight)
+{
+    uint32_t node_count = hierarchy.GetNodeCount();
+    uint32_t root = hierarchy.nodeToIndex[root_node];
+
+    weights.assign(node_count, 0.0f);
+    weights[root] = weight;
+
+    //the nodes before the root cannot be its descendants, and the parents are always visited before their children
+    for (uint32_t i = root + 1; i < node_count; ++i)
+    {
+        int32_t parent = hierarchy.parents[i];
+        if (parent >= 0 && weights[parent] != 0.0f)
+        {
+            weights[i] = weight;
+        }
+    }
+}
+
+void AnimationPoseBlender::Begin(uint32_t node_count)
+{
+    m_translations.assign(node_count, float4(0.0f, 0.0f, 0.0f, 0.0f));
+    m_rotations.assign(node_count, float4(0.0f, 0.0f, 0.0f, 0.0f));
+    m_scales.assign(node_count, float4(0.0f, 0.0f, 0.0f, 0.0f));
+}
+
+void AnimationPoseBlender::Add(const AnimationPose& pose, float weight, const AnimationMask* mask)
+{
+    uint32_t node_count = (uint32_t)m_translations.size();
+    RE_ASSERT(pose.translations.size() == node_count);
+    RE_ASSERT(mask == nullptr || mask->weights.size() == node_count);
+
+    const float3* translations = pose.translations.data();
+    const float4* rotations = pose.rotations.data();
+    const float3* scales = pose.scales.data();
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        float node_weight = mask ? weight * mask->weights[i] : weight;
+        if (node_weight <= 0.0f)
+        {
+            continue;
+        }
+
+        //shortest path : flip the rotation to the hemisphere of what is accumulated so far
+        float rotation_weight = dot(m_rotations[i], rotations[i]) < 0.0f ? -node_weight : node_weight;
+
+        hlslpp::float4 translation = to_hlslpp(m_translations[i]) + to_hlslpp(translations[i], 1.0f) * hlslpp::float4(node_weight);
+        hlslpp::float4 rotation = to_hlslpp(m_rotations[i]) + to_hlslpp(rotations[i]) * hlslpp::float4(rotation_weight);
+        hlslpp::float4 scale = to_hlslpp(m_scales[i]) + to_hlslpp(scales[i], 0.0f) * hlslpp::float4(node_weight);
+
+        m_translations[i] = float4(translation.f32);
+        m_rotations[i] = float4(rotation.f32);
+        m_scales[i] = float4(scale.f32);
+    }
+}
+
+void AnimationPoseBlender::End(AnimationPose& pose) const
+{
+    uint32_t node_count = (uint32_t)m_translations.size();
+    RE_ASSERT(pose.translations.size() == node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        float weight_sum = m_translations[i].w;
+        if (weight_sum <= 0.0f)
+        {
+            continue;
+        }
+
+        hlslpp::float4 inv_weight_sum(1.0f / weight_sum);
+        hlslpp::float4 translation = to_hlslpp(m_translations[i]) * inv_weight_sum;
+        hlslpp::float4 rotation = hlslpp::normalize(to_hlslpp(m_rotations[i]));
+        hlslpp::float4 scale = to_hlslpp(m_scales[i]) * inv_weight_sum;
+
+        pose.translations[i] = float4(translation.f32).xyz();
+        pose.rotations[i] = float4(rotation.f32);
+        pose.scales[i] = float4(scale.f32).xyz();
+    }
+}
+
+void BlendPoses(const AnimationPose* const* poses, const float* weights, const AnimationMask* const* masks, uint32_t count,
+    AnimationPoseBlender& blender, AnimationPose& pose)
+{
+    blender.Begin((uint32_t)pose.translations.size());
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        blender.Add(*poses[i], weights[i], masks ? masks[i] : nullptr);
+    }
+
+    blender.End(pose);
+}
+
+void OverridePose(AnimationPose& pose, const AnimationPose& layer, float weight, const AnimationMask* mask)
+{
+    uint32_t node_count = (uint32_t)pose.translations.size();
+    RE_ASSERT(layer.translations.size() == node_count);
+    RE_ASSERT(mask == nullptr || mask->weights.size() == node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        float node_weight = mask ? weight * mask->weights[i] : weight;
+        if (node_weight <= 0.0f)
+        {
+            continue;
+        }
+
+        float4 layer_rotation = dot(pose.rotations[i], layer.rotations[i]) < 0.0f ? -layer.rotations[i] : layer.rotations[i];
+
+        hlslpp::float4 alpha(node_weight);
+        hlslpp::float4 translation = hlslpp::lerp(to_hlslpp(pose.translations[i], 0.0f), to_hlslpp(layer.translations[i], 0.0f), alpha);
+        hlslpp::float4 rotation = hlslpp::normalize(hlslpp::lerp(to_hlslpp(pose.rotations[i]), to_hlslpp(layer_rotation), alpha));
+        hlslpp::float4 scale = hlslpp::lerp(to_hlslpp(pose.scales[i], 0.0f), to_hlslpp(layer.scales[i], 0.0f), alpha);
+
+        pose.translations[i] = float4(translation.f32).xyz();
+        pose.rotations[i] = float4(rotation.f32);
+        pose.scales[i] = float4(scale.f32).xyz();
+    }
+}
+
+void MakeAdditivePose(const AnimationPose& pose, const AnimationPose& reference, AnimationPose& additive)
+{
+    uint32_t node_count = (uint32_t)pose.translations.size();
+    RE_ASSERT(reference.translations.size() == node_count);
+
+    additive.translations.resize(node_count);
+    additive.rotations.resize(node_count);
+    additive.scales.resize(node_count);
+
+    const float all_nodes[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    float3 padded_translations[4], padded_scales[4];
+    float4 padded_rotations[4];
+
+    for (uint32_t first = 0; first < node_count; first += 4)
+    {
+        SoaFloat3 translation = LoadSoa(GetNodeGroup(pose.translations, first, padded_translations, float3(0.0f, 0.0f, 0.0f)));
+        SoaQuaternion rotation = LoadSoa(GetNodeGroup(pose.rotations, first, padded_rotations, float4(0.0f, 0.0f, 0.0f, 1.0f)));
+        SoaFloat3 scale = LoadSoa(GetNodeGroup(pose.scales, first, padded_scales, float3(1.0f, 1.0f, 1.0f)));
+
+        SoaFloat3 reference_translation = LoadSoa(GetNodeGroup(reference.translations, first, padded_translations, float3(0.0f, 0.0f, 0.0f)));
+        SoaQuaternion reference_rotation = LoadSoa(GetNodeGroup(reference.rotations, first, padded_rotations, float4(0.0f, 0.0f, 0.0f, 1.0f)));
+        SoaFloat3 reference_scale = LoadSoa(GetNodeGroup(reference.scales, first, padded_scales, float3(1.0f, 1.0f, 1.0f)));
+
+        SoaQuaternion reference_inverse = { -reference_rotation.x, -reference_rotation.y, -reference_rotation.z, reference_rotation.w };
+
+        StoreSoa({ translation.x - reference_translation.x, translation.y - reference_translation.y, translation.z - reference_translation.z }, additive.translations, first, all_nodes);
+        StoreSoa(Mul(reference_inverse, rotation), additive.rotations, first, all_nodes);
+        StoreSoa({ scale.x / reference_scale.x, scale.y / reference_scale.y, scale.z / reference_scale.z }, additive.scales, first, all_nodes);
+    }
+}
+
+void AddPose(AnimationPose& pose, const AnimationPose& additive, float weight, const AnimationMask* mask)
+{
+    uint32_t node_count = (uint32_t)pose.translations.size();
+    RE_ASSERT(additive.translations.size() == node_count);
+    RE_ASSERT(mask == nullptr || mask->weights.size() == node_count);
+
+    const SoaQuaternion identity = { hlslpp::float4(0.0f), hlslpp::float4(0.0f), hlslpp::float4(0.0f), hlslpp::float4(1.0f) };
+    const SoaFloat3 one = { hlslpp::float4(1.0f), hlslpp::float4(1.0f), hlslpp::float4(1.0f) };
+
+    float3 padded_translations[4], padded_scales[4];
+    float4 padded_rotations[4];
+
+    for (uint32_t first = 0; first < node_count; first += 4)
+    {
+        hlslpp::float4 node_weight = GetNodeWeights(weight, mask, first, node_count);
+
+        float weights[4];
+        hlslpp::store(node_weight, weights);
+        if (weights[0] + weights[1] + weights[2] + weights[3] <= 0.0f)
+        {
+            continue;
+        }
+
+        SoaFloat3 translation = LoadSoa(GetNodeGroup(pose.translations, first, padded_translations, float3(0.0f, 0.0f, 0.0f)));
+        SoaQuaternion rotation = LoadSoa(GetNodeGroup(pose.rotations, first, padded_rotations, float4(0.0f, 0.0f, 0.0f, 1.0f)));
+        SoaFloat3 scale = LoadSoa(GetNodeGroup(pose.scales, first, padded_scales, float3(1.0f, 1.0f, 1.0f)));
+
+        SoaFloat3 additive_translation = LoadSoa(GetNodeGroup(additive.translations, first, padded_translations, float3(0.0f, 0.0f, 0.0f)));
+        SoaQuaternion additive_rotation = LoadSoa(GetNodeGroup(additive.rotations, first, padded_rotations, float4(0.0f, 0.0f, 0.0f, 1.0f)));
+        SoaFloat3 additive_scale = LoadSoa(GetNodeGroup(additive.scales, first, padded_scales, float3(1.0f, 1.0f, 1.0f)));
+
+        translation.x += additive_translation.x * node_weight;
+        translation.y += additive_translation.y * node_weight;
+        translation.z += additive_translation.z * node_weight;
+
+        //qnlerp from the identity
+        additive_rotation = Scale(additive_rotation, HemisphereSign(identity, additive_rotation));
+        rotation = Normalize(Mul(rotation, Normalize(Lerp(identity, additive_rotation, node_weight))));
+
+        SoaFloat3 scale_factor = Lerp(one, additive_scale, node_weight);
+        scale = { scale.x * scale_factor.x, scale.y * scale_factor.y, scale.z * scale_factor.z };
+
+        StoreSoa(translation, pose.translations, first, weights);
+        StoreSoa(rotation, pose.rotations, first, weights);
+        StoreSoa(scale, pose.scales, first, weights);
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "animation.h"
+
+//per node weights of a layer, in the order of an AnimationHierarchy
+struct AnimationMask
+{
+    eastl::vector<float> weights;
+
+    //root_node and all its descendants get weight, the other nodes 0
+    void Build(const AnimationHierarchy& hierarchy, uint32_t root_node, float weight = 1.0f);
+};
+
+//accumulates weighted poses and resolves their normalized average.
+//rotations are flipped to the hemisphere of the accumulated value before being added, and normalized at the end (nlerp).
+//the accumulators are float4 arrays processed with hlslpp, the weight sum of each node is kept in the w of its translation
+class AnimationPoseBlender
+{
+public:
+    void Begin(uint32_t node_count);
+
+    //the weight of each node is weight * mask, nodes with a zero weight are skipped
+    void Add(const AnimationPose& pose, float weight, const AnimationMask* mask = nullptr);
+
+    //writes the average to the nodes which got any weight, the other nodes of pose are left untouched
+    void End(AnimationPose& pose) const;
+
+private:
+    eastl::vector<float4> m_translations; //xyz : weighted sum, w : weight sum
+    eastl::vector<float4> m_rotations;
+    eastl::vector<float4> m_scales;
+};
+
+//blends count poses with their weights and optional masks (masks can be null), see AnimationPoseBlender
+void BlendPoses(const AnimationPose* const* poses, const float* weights, const AnimationMask* const* masks, uint32_t count,
+    AnimationPoseBlender& blender, AnimationPose& pose);
+
+//override layer : lerps pose towards layer by weight * mask
+void OverridePose(AnimationPose& pose, const AnimationPose& layer, float weight, const AnimationMask* mask = nullptr);
+
+//the difference of pose to reference, in the local space of each node
+void MakeAdditivePose(const AnimationPose& pose, const AnimationPose& reference, AnimationPose& additive);
+
+//additive layer : applies weight * mask of the difference made by MakeAdditivePose on top of pose
+void AddPose(AnimationPose& pose, const AnimationPose& additive, float weight, const AnimationMask* mask = nullptr);
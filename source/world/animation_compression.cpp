@@ -0,0 +1,208 @@
+#include "animation_compression.h"
+#include "utils/log.h"
+#include "EASTL/algorithm.h"
+
+void ComputeAnimationTolerances(const AnimationCompressionSettings& settings, const eastl::vector<AnimationChannel>& channels,
+    eastl::vector<AnimationNodeTolerance>& tolerances)
+{
+    uint32_t node_count = (uint32_t)settings.parents.size();
+    RE_ASSERT(settings.restTranslations.size() == node_count);
+
+    eastl::vector<float> lengths(node_count);
+    eastl::vector<float> scales(node_count, 1.0f);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        lengths[i] = length(settings.restTranslations[i]);
+    }
+
+    for (size_t i = 0; i < channels.size(); ++i)
+    {
+        const AnimationChannel& channel = channels[i];
+        RE_ASSERT(channel.targetNode < node_count);
+
+        for (size_t k = 0; k < channel.keyframes.size(); ++k)
+        {
+            float3 value = channel.keyframes[k].second.xyz();
+            if (channel.mode == AnimationChannelMode::Translation)
+            {
+                lengths[channel.targetNode] = eastl::max(lengths[channel.targetNode], length(value));
+            }
+            else if (channel.mode == AnimationChannelMode::Scale)
+            {
+                scales[channel.targetNode] = eastl::max(scales[channel.targetNode], maxelem(abs(value)));
+            }
+        }
+    }
+
+    eastl::vector<eastl::vector<uint32_t>> children(node_count);
+    eastl::vector<uint32_t> order; //parents before children
+    order.reserve(node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        if (settings.parents[i] < 0)
+        {
+            order.push_back(i);
+        }
+        else
+        {
+            children[settings.parents[i]].push_back(i);
+        }
+    }
+
+    eastl::vector<uint32_t> depth(node_count, 1); //nodes from the root, inclusive
+    eastl::vector<float> parent_scale(node_count, 1.0f); //scales the errors of the node in the parent space
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        uint32_t node = order[i];
+        for (size_t c = 0; c < children[node].size(); ++c)
+        {
+            uint32_t child = children[node][c];
+            depth[child] = depth[node] + 1;
+            parent_scale[child] = parent_scale[node] * scales[node];
+            order.push_back(child);
+        }
+    }
+
+    eastl::vector<uint32_t> height(node_count, 1); //nodes on the longest chain below, inclusive
+    eastl::vector<float> reach(node_count);
+    for (size_t i = order.size(); i-- > 0;)
+    {
+        uint32_t node = order[i];
+        float chain = children[node].empty() ? settings.leafLength : 0.0f;
+        for (size_t c = 0; c < children[node].size(); ++c)
+        {
+            uint32_t child = children[node][c];
+            height[node] = eastl::max(height[node], height[child] + 1);
+            chain = eastl::max(chain, lengths[child] + reach[child]);
+        }
+
+        //the scale of a node applies to its descendants
+        reach[node] = chain * scales[node];
+    }
+
+    tolerances.resize(node_count);
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        tolerances[i].position = settings.tolerance / ((float)(depth[i] + height[i] - 1) * parent_scale[i]);
+        tolerances[i].reach = reach[i];
+    }
+}
+
+float GetAnimationKeyError(AnimationChannelMode mode, const float4& value, const float4& approximation, float reach)
+{
+    switch (mode)
+    {
+    case AnimationChannelMode::Rotation:
+    {
+        //angle from the chord, acos of the dot product is not precise enough for small angles
+        float4 difference = dot(value, approximation) < 0.0f ? value + approximation : value - approximation;
+        return 4.0f * asinf(eastl::min(0.5f * length(difference), 1.0f)) * reach;
+    }
+    case AnimationChannelMode::Scale:
+        return length(value.xyz() - approximation.xyz()) * reach;
+    default:
+        return length(value.xyz() - approximation.xyz());
+    }
+}
+
+static float4 InterpolateKeys(AnimationChannelMode mode, const float4& a, const float4& b, float alpha)
+{
+    float4 value = lerp(a, b, alpha);
+    return mode == AnimationChannelMode::Rotation ? normalize(value) : value;
+}
+
+void ReduceAnimationKeys(const float* times, const float4* values, const float4* decoded_values, uint32_t count, AnimationChannelMode mode,
+    float reach, float max_error, eastl::vector<uint32_t>& kept_keys)
+{
+    const uint32_t max_segment_keys = 128; //bounds the import time of long constant tracks
+
+    kept_keys.push_back(0);
+
+    uint32_t anchor = 0;
+    while (anchor + 1 < count)
+    {
+        uint32_t end = anchor + 1;
+
+        for (uint32_t candidate = anchor + 2; candidate < count && candidate - anchor <= max_segment_keys; ++candidate)
+        {
+            float duration = times[candidate] - times[anchor];
+
+            //the skipped keys, and the middle of each original segment as nlerp is not linear
+            bool valid = true;
+            for (uint32_t k = anchor + 1; k <= candidate && valid; ++k)
+            {
+                float mid_time = 0.5f * (times[k - 1] + times[k]);
+                float alpha = duration > 0.0f ? (mid_time - times[anchor]) / duration : 0.0f;
+                float4 value = InterpolateKeys(mode, values[k - 1], values[k], 0.5f);
+                valid = GetAnimationKeyError(mode, value, InterpolateKeys(mode, decoded_values[anchor], decoded_values[candidate], alpha), reach) <= max_error;
+
+                if (valid && k < candidate)
+                {
+                    alpha = duration > 0.0f ? (times[k] - times[anchor]) / duration : 0.0f;
+                    valid = GetAnimationKeyError(mode, values[k], InterpolateKeys(mode, decoded_values[anchor], decoded_values[candidate], alpha), reach) <= max_error;
+                }
+            }
+
+            if (!valid)
+            {
+                break;
+            }
+            end = candidate;
+        }
+
+        kept_keys.push_back(end);
+        anchor = end;
+    }
+}
+
+static const float SMALLEST_THREE_RANGE = 0.70710678f; //1 / sqrt(2), the largest value of the three smallest components
+
+void EncodeSmallestThree(const float4& rotation, uint16_t* encoded)
+{
+    uint32_t largest = 0;
+    for (uint32_t c = 1; c < 4; ++c)
+    {
+        if (fabsf(rotation[c]) > fabsf(rotation[largest]))
+        {
+            largest = c;
+        }
+    }
+
+    //q and -q are the same rotation, the largest component is always stored positive
+    float4 q = rotation[largest] < 0.0f ? -rotation : rotation;
+
+    uint32_t n = 0;
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        if (c != largest)
+        {
+            float unorm = clamp(q[c] / SMALLEST_THREE_RANGE * 0.5f + 0.5f, 0.0f, 1.0f);
+            encoded[n++] = (uint16_t)(unorm * 32767.0f + 0.5f);
+        }
+    }
+
+    encoded[0] |= (uint16_t)((largest & 0x1) << 15);
+    encoded[1] |= (uint16_t)((largest >> 1) << 15);
+}
+
+float4 DecodeSmallestThree(const uint16_t* encoded)
+{
+    uint32_t largest = (encoded[0] >> 15) | ((encoded[1] >> 15) << 1);
+
+    float4 q;
+    float sum = 0.0f;
+    uint32_t n = 0;
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        if (c != largest)
+        {
+            float unorm = (encoded[n++] & 0x7fff) / 32767.0f;
+            q[c] = (unorm * 2.0f - 1.0f) * SMALLEST_THREE_RANGE;
+            sum += q[c] * q[c];
+        }
+    }
+
+    q[largest] = sqrtf(eastl::max(1.0f - sum, 0.0f));
+    return q;
+}
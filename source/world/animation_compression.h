@@ -0,0 +1,50 @@
+#pragma once
+
+#include "animation.h"
+
+struct AnimationCompressionSettings
+{
+    float tolerance = 0.001f;  //max position error of any node, in meters
+    float leafLength = 0.1f;   //reach assumed for the nodes without children, their rotation still moves the skinned vertices
+
+    //hierarchy of the animated nodes, indexed by AnimationChannel::targetNode
+    eastl::vector<int32_t> parents; //-1 for roots
+    eastl::vector<float3> restTranslations;
+};
+
+//a node error moves all its descendants, so each node gets the tolerance divided by the number of nodes on its longest
+//root to leaf path, and its rotation and scale errors are scaled by its reach (the length of its longest descendant chain).
+//a track is quantized if that uses at most half of its budget
+struct AnimationNodeTolerance
+{
+    float position; //translation error, in meters
+    float reach;    //converts rotation (radians) and scale errors to position errors
+};
+
+//the reach uses the longest translations and largest scales of the channels, which can stretch the rest pose
+void ComputeAnimationTolerances(const AnimationCompressionSettings& settings, const eastl::vector<AnimationChannel>& channels,
+    eastl::vector<AnimationNodeTolerance>& tolerances);
+
+//error of an approximated key, converted to a position error
+float GetAnimationKeyError(AnimationChannelMode mode, const float4& value, const float4& approximation, float reach);
+
+//returns the keys to keep, the ones in between are within max_error of the interpolation of their neighbours.
+//the neighbours are interpolated from their decoded values, so that the error includes the quantization.
+//values should be in the sampling layout (rotation keys in the same hemisphere)
+void ReduceAnimationKeys(const float* times, const float4* values, const float4* decoded_values, uint32_t count, AnimationChannelMode mode,
+    float reach, float max_error, eastl::vector<uint32_t>& kept_keys);
+
+//rotations : the three smallest components in 15 bits each, the index of the largest one in the top bits of the first two
+void EncodeSmallestThree(const float4& rotation, uint16_t* encoded);
+float4 DecodeSmallestThree(const uint16_t* encoded);
+
+//translations and scales : 16 bits per component against the range of their track
+inline uint16_t QuantizeUnorm16(float value, float min, float extent)
+{
+    return extent > 0.0f ? (uint16_t)(clamp((value - min) / extent, 0.0f, 1.0f) * 65535.0f + 0.5f) : 0;
+}
+
+inline float DequantizeUnorm16(uint16_t value, float min, float extent)
+{
+    return min + value * (extent / 65535.0f);
+}
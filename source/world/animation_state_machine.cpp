@@ -0,0 +1,372 @@
+#include "animation_state_machine.h"
+#include "utils/gui_util.h"
+#include "utils/fmt.h"
+#include "utils/log.h"
+#include "tinyxml2/tinyxml2.h"
+
+static eastl::string GetAttribute(const tinyxml2::XMLElement* element, const char* name)
+{
+    const char* value = element->Attribute(name);
+    return value ? value : "";
+}
+
+void AnimationStateMachineDesc::Load(const tinyxml2::XMLElement* element)
+{
+    for (const tinyxml2::XMLElement* child = element->FirstChildElement(); child != nullptr; child = child->NextSiblingElement())
+    {
+        if (strcmp(child->Value(), "parameter") == 0)
+        {
+            AnimationParameterDesc parameter;
+            parameter.name = GetAttribute(child, "name");
+            parameter.value = child->FloatAttribute("value", 0.0f);
+            parameters.push_back(parameter);
+        }
+        else if (strcmp(child->Value(), "state") == 0)
+        {
+            AnimationStateDesc state;
+            state.name = GetAttribute(child, "name");
+            state.clip = GetAttribute(child, "clip");
+            state.speed = child->FloatAttribute("speed", 1.0f);
+            state.loop = child->BoolAttribute("loop", true);
+            states.push_back(state);
+        }
+        else if (strcmp(child->Value(), "transition") == 0)
+        {
+            AnimationTransitionDesc transition;
+            transition.from = GetAttribute(child, "from");
+            transition.to = GetAttribute(child, "to");
+            transition.duration = child->FloatAttribute("duration", 0.2f);
+            transition.exitTime = child->FloatAttribute("exitTime", -1.0f);
+
+            for (const tinyxml2::XMLElement* condition_element = child->FirstChildElement("condition"); condition_element != nullptr;
+                condition_element = condition_element->NextSiblingElement("condition"))
+            {
+                AnimationConditionDesc condition;
+                condition.parameter = GetAttribute(condition_element, "parameter");
+
+                if (condition_element->FindAttribute("less"))
+                {
+                    condition.op = AnimationConditionOp::Less;
+                    condition.value = condition_element->FloatAttribute("less");
+                }
+                else
+                {
+                    condition.op = AnimationConditionOp::Greater;
+                    condition.value = condition_element->FloatAttribute("greater");
+                }
+                transition.conditions.push_back(condition);
+            }
+            transitions.push_back(transition);
+        }
+        else if (strcmp(child->Value(), "layer") == 0)
+        {
+            AnimationLayerDesc layer;
+            layer.clip = GetAttribute(child, "clip");
+            layer.mask = GetAttribute(child, "mask");
+            layer.weight = child->FloatAttribute("weight", 1.0f);
+            layer.weightParameter = GetAttribute(child, "weightParameter");
+            layer.additive = child->BoolAttribute("additive", false);
+            layers.push_back(layer);
+        }
+    }
+}
+
+static eastl::shared_ptr<AnimationClip> FindClip(const eastl::vector<eastl::shared_ptr<AnimationClip>>& clips, const eastl::string& name)
+{
+    for (size_t i = 0; i < clips.size(); ++i)
+    {
+        if (clips[i]->GetName() == name)
+        {
+            return clips[i];
+        }
+    }
+
+    RE_WARN("[AnimationStateMachine] unknown clip : {}", name);
+    return nullptr;
+}
+
+AnimationStateMachine::AnimationStateMachine(const AnimationStateMachineDesc& desc, const eastl::vector<eastl::shared_ptr<AnimationClip>>& clips)
+{
+    RE_ASSERT(!clips.empty());
+
+    for (size_t i = 0; i < desc.parameters.size(); ++i)
+    {
+        m_parameterNames.push_back(desc.parameters[i].name);
+        m_parameters.push_back(desc.parameters[i].value);
+    }
+
+    for (size_t i = 0; i < desc.states.size(); ++i)
+    {
+        eastl::shared_ptr<AnimationClip> clip = FindClip(clips, desc.states[i].clip);
+        if (clip)
+        {
+            State state;
+            state.name = desc.states[i].name;
+            state.animation = eastl::make_unique<Animation>(clip);
+            state.animation->SetLooping(desc.states[i].loop);
+            state.speed = desc.states[i].speed;
+            m_states.push_back(eastl::move(state));
+        }
+    }
+
+    if (m_states.empty())
+    {
+        for (size_t i = 0; i < clips.size(); ++i)
+        {
+            State state;
+            state.name = clips[i]->GetName().empty() ? fmt::format("clip_{}", i).c_str() : clips[i]->GetName();
+            state.animation = eastl::make_unique<Animation>(clips[i]);
+            state.speed = 1.0f;
+            m_states.push_back(eastl::move(state));
+        }
+    }
+
+    for (size_t i = 0; i < desc.transitions.size(); ++i)
+    {
+        const AnimationTransitionDesc& transition_desc = desc.transitions[i];
+
+        Transition transition;
+        transition.from = transition_desc.from.empty() ? INVALID_INDEX : FindState(transition_desc.from);
+        transition.to = FindState(transition_desc.to);
+        transition.duration = transition_desc.duration;
+        transition.exitTime = transition_desc.exitTime;
+
+        bool valid = transition.to != INVALID_INDEX && (transition_desc.from.empty() || transition.from != INVALID_INDEX);
+
+        for (size_t c = 0; c < transition_desc.conditions.size(); ++c)
+        {
+            Condition condition;
+            condition.parameter = FindParameter(transition_desc.conditions[c].parameter);
+            condition.op = transition_desc.conditions[c].op;
+            condition.value = transition_desc.conditions[c].value;
+            transition.conditions.push_back(condition);
+
+            valid &= condition.parameter != INVALID_INDEX;
+        }
+
+        if (valid)
+        {
+            m_transitions.push_back(eastl::move(transition));
+        }
+        else
+        {
+            RE_WARN("[AnimationStateMachine] invalid transition : {} -> {}", transition_desc.from, transition_desc.to);
+        }
+    }
+
+    for (size_t i = 0; i < desc.layers.size(); ++i)
+    {
+        const AnimationLayerDesc& layer_desc = desc.layers[i];
+
+        eastl::shared_ptr<AnimationClip> clip = FindClip(clips, layer_desc.clip);
+        uint32_t weight_parameter = layer_desc.weightParameter.empty() ? INVALID_INDEX : FindParameter(layer_desc.weightParameter);
+        if (!clip || (!layer_desc.weightParameter.empty() && weight_parameter == INVALID_INDEX))
+        {
+            RE_WARN("[AnimationStateMachine] invalid layer : {}", layer_desc.clip);
+            continue;
+        }
+
+        Layer layer;
+        layer.animation = eastl::make_unique<Animation>(clip);
+        layer.maskNode = layer_desc.mask;
+        layer.weight = layer_desc.weight;
+        layer.weightParameter = weight_parameter;
+        layer.additive = layer_desc.additive;
+        m_layers.push_back(eastl::move(layer));
+    }
+}
+
+void AnimationStateMachine::Bind(const AnimationHierarchy& hierarchy, const eastl::vector<eastl::string>& node_names, const AnimationPose& rest_pose)
+{
+    m_restPose = rest_pose;
+    m_targetPose = rest_pose;
+    m_layerPose = rest_pose;
+    m_additivePose = rest_pose;
+
+    for (size_t i = 0; i < m_states.size(); ++i)
+    {
+        m_states[i].animation->Bind(hierarchy);
+    }
+
+    for (size_t i = 0; i < m_layers.size(); ++i)
+    {
+        Layer& layer = m_layers[i];
+        layer.animation->Bind(hierarchy);
+
+        layer.mask.weights.clear();
+        if (!layer.maskNode.empty())
+        {
+            auto iter = eastl::find(node_names.begin(), node_names.end(), layer.maskNode);
+            if (iter != node_names.end())
+            {
+                layer.mask.Build(hierarchy, (uint32_t)(iter - node_names.begin()));
+            }
+            else
+            {
+                RE_WARN("[AnimationStateMachine] unknown mask node : {}", layer.maskNode);
+            }
+        }
+
+        if (layer.additive)
+        {
+            layer.reference = rest_pose;
+            layer.animation->Update(0.0f, layer.reference);
+        }
+    }
+}
+
+void AnimationStateMachine::Update(float delta_time, AnimationPose& pose, bool reduced)
+{
+    if (m_bPaused)
+    {
+        delta_time = 0.0f;
+    }
+
+    if (m_nTargetState == INVALID_INDEX)
+    {
+        StartTransitions();
+    }
+
+    const State& current = m_states[m_nCurrentState];
+    pose = m_restPose;
+    current.animation->Update(delta_time * current.speed, pose, reduced);
+
+    if (m_nTargetState != INVALID_INDEX)
+    {
+        const State& target = m_states[m_nTargetState];
+        m_targetPose = m_restPose;
+        target.animation->Update(delta_time * target.speed, m_targetPose, reduced);
+
+        m_transitionTime += delta_time;
+        float weight = m_transitionDuration > 0.0f ? min(m_transitionTime / m_transitionDuration, 1.0f) : 1.0f;
+
+        const AnimationPose* poses[] = { &pose, &m_targetPose };
+        float weights[] = { 1.0f - weight, weight };
+        BlendPoses(poses, weights, nullptr, 2, m_blender, pose);
+
+        if (weight >= 1.0f)
+        {
+            m_nCurrentState = m_nTargetState;
+            m_nTargetState = INVALID_INDEX;
+        }
+    }
+
+    for (size_t i = 0; i < m_layers.size(); ++i)
+    {
+        Layer& layer = m_layers[i];
+
+        //layers without weight are not evaluated, and their clip does not advance
+        float weight = layer.weight * (layer.weightParameter != INVALID_INDEX ? m_parameters[layer.weightParameter] : 1.0f);
+        if (weight <= 0.0f)
+        {
+            continue;
+        }
+
+        //additive layers start from their reference, so that the nodes they do not sample add nothing
+        m_layerPose = layer.additive ? layer.reference : m_restPose;
+        layer.animation->Update(delta_time, m_layerPose, reduced);
+
+        const AnimationMask* mask = layer.mask.weights.empty() ? nullptr : &layer.mask;
+        if (layer.additive)
+        {
+            MakeAdditivePose(m_layerPose, layer.reference, m_additivePose);
+            AddPose(pose, m_additivePose, weight, mask);
+        }
+        else
+        {
+            OverridePose(pose, m_layerPose, weight, mask);
+        }
+    }
+}
+
+void AnimationStateMachine::StartTransitions()
+{
+    const State& current = m_states[m_nCurrentState];
+
+    for (size_t i = 0; i < m_transitions.size(); ++i)
+    {
+        const Transition& transition = m_transitions[i];
+        if ((transition.from != INVALID_INDEX && transition.from != m_nCurrentState) || transition.to == m_nCurrentState)
+        {
+            continue;
+        }
+
+        if (transition.exitTime >= 0.0f && current.animation->GetNormalizedTime() < transition.exitTime)
+        {
+            continue;
+        }
+
+        bool passed = true;
+        for (size_t c = 0; c < transition.conditions.size() && passed; ++c)
+        {
+            const Condition& condition = transition.conditions[c];
+            float value = m_parameters[condition.parameter];
+            passed = condition.op == AnimationConditionOp::Greater ? value > condition.value : value < condition.value;
+        }
+
+        if (passed)
+        {
+            m_nTargetState = transition.to;
+            m_transitionTime = 0.0f;
+            m_transitionDuration = transition.duration;
+            m_states[m_nTargetState].animation->SetTime(0.0f);
+            break;
+        }
+    }
+}
+
+uint32_t AnimationStateMachine::FindParameter(const eastl::string& name) const
+{
+    auto iter = eastl::find(m_parameterNames.begin(), m_parameterNames.end(), name);
+    return iter != m_parameterNames.end() ? (uint32_t)(iter - m_parameterNames.begin()) : INVALID_INDEX;
+}
+
+uint32_t AnimationStateMachine::FindState(const eastl::string& name) const
+{
+    for (uint32_t i = 0; i < (uint32_t)m_states.size(); ++i)
+    {
+        if (m_states[i].name == name)
+        {
+            return i;
+        }
+    }
+    return INVALID_INDEX;
+}
+
+void AnimationStateMachine::SetParameter(const eastl::string& name, float value)
+{
+    uint32_t parameter = FindParameter(name);
+    if (parameter != INVALID_INDEX)
+    {
+        m_parameters[parameter] = value;
+    }
+}
+
+float AnimationStateMachine::GetParameter(const eastl::string& name) const
+{
+    uint32_t parameter = FindParameter(name);
+    return parameter != INVALID_INDEX ? m_parameters[parameter] : 0.0f;
+}
+
+void AnimationStateMachine::OnGui()
+{
+    ImGui::Checkbox("Pause Animation", &m_bPaused);
+
+    if (IsInTransition())
+    {
+        ImGui::Text("State : %s -> %s", m_states[m_nCurrentState].name.c_str(), m_states[m_nTargetState].name.c_str());
+    }
+    else
+    {
+        ImGui::Text("State : %s", m_states[m_nCurrentState].name.c_str());
+    }
+
+    for (size_t i = 0; i < m_parameters.size(); ++i)
+    {
+        ImGui::DragFloat(m_parameterNames[i].c_str(), &m_parameters[i], 0.01f);
+    }
+
+    const AnimationClip* clip = GetStateClip(m_nCurrentState);
+    ImGui::Text("Clip : %u of %u keys, %.1f KB%s", clip->GetKeyCount(), clip->GetRawKeyCount(), clip->GetMemorySize() / 1024.0f,
+        clip->IsCompressed() ? " (compressed)" : "");
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "animation_blend.h"
+#include "EASTL/unique_ptr.h"
+
+namespace tinyxml2
+{
+    class XMLElement;
+}
+
+struct AnimationParameterDesc
+{
+    eastl::string name;
+    float value = 0.0f;
+};
+
+enum class AnimationConditionOp
+{
+    Greater,
+    Less,
+};
+
+struct AnimationConditionDesc
+{
+    eastl::string parameter;
+    AnimationConditionOp op = AnimationConditionOp::Greater;
+    float value = 0.0f;
+};
+
+struct AnimationStateDesc
+{
+    eastl::string name;
+    eastl::string clip;
+    float speed = 1.0f;
+    bool loop = true;
+};
+
+struct AnimationTransitionDesc
+{
+    eastl::string from;      //empty for any state
+    eastl::string to;
+    float duration = 0.2f;   //cross fade, in seconds
+    float exitTime = -1.0f;  //normalized time of the current state before which the transition waits, negative to start at any time
+    eastl::vector<AnimationConditionDesc> conditions; //all of them must be true
+};
+
+//layers are applied in order on top of the states.
+//an additive layer adds the difference of its clip to the first frame of that clip
+struct AnimationLayerDesc
+{
+    eastl::string clip;
+    eastl::string mask;            //root node of the affected subtree, empty for all nodes
+    float weight = 1.0f;
+    eastl::string weightParameter; //multiplies the weight if set
+    bool additive = false;
+};
+
+struct AnimationStateMachineDesc
+{
+    eastl::vector<AnimationParameterDesc> parameters;
+    eastl::vector<AnimationStateDesc> states; //the first one is the initial state
+    eastl::vector<AnimationTransitionDesc> transitions;
+    eastl::vector<AnimationLayerDesc> layers;
+
+    //reads the children of a model element :
+    //<parameter name="speed" value="0"/>
+    //<state name="walk" clip="Walk" speed="1.0" loop="true"/>
+    //<transition from="idle" to="walk" duration="0.3" exitTime="-1"> <condition parameter="speed" greater="0.1"/> </transition>
+    //<layer clip="Wave" mask="spine_02" weight="1.0" weightParameter="wave" additive="false"/>
+    void Load(const tinyxml2::XMLElement* element);
+};
+
+//plays the clips of a skeletal mesh : the current state, cross faded to the next one during a transition, then the layers.
+//all poses are sampled on top of the rest pose, so the nodes a clip does not animate keep their rest transform
+class AnimationStateMachine
+{
+public:
+    //clips are found by name, without any state the machine has one state per clip and plays the first one
+    AnimationStateMachine(const AnimationStateMachineDesc& desc, const eastl::vector<eastl::shared_ptr<AnimationClip>>& clips);
+
+    //node_names is indexed by node id, rest_pose is in the hierarchy order
+    void Bind(const AnimationHierarchy& hierarchy, const eastl::vector<eastl::string>& node_names, const AnimationPose& rest_pose);
+
+    //evaluates the final local pose, only the nodes of the hierarchy reduced set are sampled if reduced.
+    //thread safe across state machines
+    void Update(float delta_time, AnimationPose& pose, bool reduced = false);
+
+    void SetParameter(const eastl::string& name, float value);
+    float GetParameter(const eastl::string& name) const;
+
+    bool IsPaused() const { return m_bPaused; }
+    void SetPaused(bool value) { m_bPaused = value; }
+
+    uint32_t GetCurrentState() const { return m_nCurrentState; }
+    bool IsInTransition() const { return m_nTargetState != INVALID_INDEX; }
+    const eastl::string& GetStateName(uint32_t state) const { return m_states[state].name; }
+    const AnimationClip* GetStateClip(uint32_t state) const { return m_states[state].animation->GetClip(); }
+
+    void OnGui();
+
+private:
+    static const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+    uint32_t FindParameter(const eastl::string& name) const;
+    uint32_t FindState(const eastl::string& name) const;
+    void StartTransitions();
+
+private:
+    struct State
+    {
+        eastl::string name;
+        eastl::unique_ptr<Animation> animation;
+        float speed;
+    };
+
+    struct Condition
+    {
+        uint32_t parameter;
+        AnimationConditionOp op;
+        float value;
+    };
+
+    struct Transition
+    {
+        uint32_t from; //INVALID_INDEX for any state
+        uint32_t to;
+        float duration;
+        float exitTime;
+        eastl::vector<Condition> conditions;
+    };
+
+    struct Layer
+    {
+        eastl::unique_ptr<Animation> animation;
+        eastl::string maskNode;
+        AnimationMask mask;
+        float weight;
+        uint32_t weightParameter;
+        bool additive;
+        AnimationPose reference; //first frame of the clip, for additive layers
+    };
+
+    eastl::vector<eastl::string> m_parameterNames;
+    eastl::vector<float> m_parameters;
+    eastl::vector<State> m_states;
+    eastl::vector<Transition> m_transitions;
+    eastl::vector<Layer> m_layers;
+
+    uint32_t m_nCurrentState = 0;
+    uint32_t m_nTargetState = INVALID_INDEX;
+    float m_transitionTime = 0.0f;
+    float m_transitionDuration = 0.0f;
+    bool m_bPaused = false;
+
+    AnimationPose m_restPose;
+    AnimationPose m_targetPose;
+    AnimationPose m_layerPose;
+    AnimationPose m_additivePose;
+    AnimationPoseBlender m_blender;
+};
@@ -0,0 +1,219 @@
+#include "animation_system.h"
+#include "animation.h"
+#include "skeleton.h"
+#include "skeletal_mesh.h"
+#include "camera.h"
+#include "renderer/renderer.h"
+#include "renderer/vertex_skinning.h"
+#include "utils/parallel_for.h"
+#include "utils/profiler.h"
+#include "utils/gui_util.h"
+#include "utils/log.h"
+#include "sokol/sokol_time.h"
+
+AnimationSystem::AnimationSystem(Renderer* pRenderer)
+{
+    m_pRenderer = pRenderer;
+}
+
+void AnimationSystem::AddMesh(SkeletalMesh* mesh)
+{
+    Instance instance;
+    instance.mesh = mesh;
+    instance.lod = AnimationLOD::Full;
+    instance.pendingTime = 0.0f;
+    instance.sampleFrame = m_nFrame;
+    m_instances.push_back(instance);
+
+    m_bLayoutChanged = true;
+}
+
+void AnimationSystem::RemoveMesh(SkeletalMesh* mesh)
+{
+    for (auto iter = m_instances.begin(); iter != m_instances.end(); ++iter)
+    {
+        if (iter->mesh == mesh)
+        {
+            m_instances.erase(iter);
+            m_bLayoutChanged = true;
+            break;
+        }
+    }
+}
+
+void AnimationSystem::Update(float delta_time, const Camera* camera)
+{
+    CPU_EVENT("Tick", "AnimationSystem::Update");
+
+    uint64_t start = stm_now();
+    ++m_nFrame;
+
+    uint32_t mesh_count = (uint32_t)m_instances.size();
+    uint32_t joint_count = 0;
+    uint32_t node_count = 0;
+
+    m_paletteOffsets.resize(mesh_count);
+    for (uint32_t i = 0; i < mesh_count; ++i)
+    {
+        m_paletteOffsets[i] = joint_count;
+        joint_count += m_instances[i].mesh->GetJointCount();
+        node_count += m_instances[i].mesh->GetNodeCount();
+    }
+    m_palette.resize(joint_count);
+
+    //the joint matrices of the previous skinning of each mesh, for VertexSkinning to skin the previous positions
+    bool skin_previous = m_pRenderer->GetVertexSkinning()->IsPreviousPositionEnabled();
+    if (skin_previous)
+    {
+        m_prevPalette.resize(joint_count);
+    }
+
+    m_stats = AnimationSystemStats();
+    m_evaluations.clear();
+
+    for (uint32_t i = 0; i < mesh_count; ++i)
+    {
+        Instance& instance = m_instances[i];
+        SkeletalMesh* mesh = instance.mesh;
+
+        AnimationLOD lod = m_bEnableLOD ? SelectLOD(mesh, camera) : AnimationLOD::Full;
+        bool resumed = instance.lod == AnimationLOD::Frozen && lod != AnimationLOD::Frozen;
+        instance.lod = lod;
+        instance.pendingTime += delta_time;
+
+        //the instances are spread over the frames of their interval, so that the cost stays even
+        uint32_t interval = lod == AnimationLOD::Full ? 1 : (lod == AnimationLOD::Reduced ? 2 : 4);
+        bool forced = m_bLayoutChanged || resumed;
+        bool sample = lod != AnimationLOD::Frozen && (forced || (m_nFrame + i) % interval == 0);
+
+        //a new layout also moves the palette range of the frozen meshes, which then keep their last samples
+        bool update_pose = m_bLayoutChanged || sample || lod == AnimationLOD::Reduced;
+
+        Evaluation evaluation;
+        evaluation.instance = i;
+        evaluation.deltaTime = 0.0f;
+        evaluation.sample = sample;
+        evaluation.reduced = lod == AnimationLOD::Reduced || lod == AnimationLOD::Minimal;
+        evaluation.resetPrevious = forced;
+
+        if (sample)
+        {
+            evaluation.deltaTime = instance.pendingTime;
+            instance.pendingTime = 0.0f;
+            instance.sampleFrame = m_nFrame;
+        }
+
+        //the Reduced LOD reaches the last sample on the frame before the next one
+        evaluation.interpolation = lod == AnimationLOD::Reduced && !forced ? min((m_nFrame - instance.sampleFrame + 1) / (float)interval, 1.0f) : 1.0f;
+
+        if (update_pose)
+        {
+            m_evaluations.push_back(evaluation);
+        }
+        mesh->SetPoseUpdated(update_pose);
+
+        m_stats.lod_meshes[(uint32_t)lod]++;
+        m_stats.skipped_samples += sample ? 0 : 1;
+        m_stats.skipped_nodes += !sample ? mesh->GetNodeCount() : (evaluation.reduced ? mesh->GetNodeCount() - mesh->GetReducedNodeCount() : 0);
+        m_stats.skipped_poses += update_pose ? 0 : 1;
+        m_stats.skipped_skinning += update_pose ? 0 : mesh->GetSkinnedMeshCount();
+    }
+
+    if (!m_evaluations.empty())
+    {
+        ParallelFor((uint32_t)m_evaluations.size(), [&](uint32_t i)
+            {
+                const Evaluation& evaluation = m_evaluations[i];
+                SkeletalMesh* mesh = m_instances[evaluation.instance].mesh;
+                uint32_t offset = m_paletteOffsets[evaluation.instance];
+
+                if (skin_previous)
+                {
+                    memcpy(m_prevPalette.data() + offset, m_palette.data() + offset, sizeof(float4x4) * mesh->GetJointCount());
+                }
+
+                mesh->UpdatePose(evaluation.deltaTime, evaluation.sample, evaluation.interpolation, evaluation.reduced, m_palette.data() + offset);
+
+                //a mesh resumed from the Frozen LOD was not displayed with its old matrices
+                if (skin_previous && evaluation.resetPrevious)
+                {
+                    memcpy(m_prevPalette.data() + offset, m_palette.data() + offset, sizeof(float4x4) * mesh->GetJointCount());
+                }
+            });
+    }
+
+    //the whole palette is uploaded, the meshes which were not updated keep their matrices from the previous frames
+    if (joint_count > 0)
+    {
+        uint32_t address = m_pRenderer->AllocateSceneConstant(m_palette.data(), sizeof(float4x4) * joint_count);
+        uint32_t prev_address = skin_previous ? m_pRenderer->AllocateSceneConstant(m_prevPalette.data(), sizeof(float4x4) * joint_count) : Skeleton::INVALID_ADDRESS;
+
+        for (uint32_t i = 0; i < mesh_count; ++i)
+        {
+            uint32_t offset = sizeof(float4x4) * m_paletteOffsets[i];
+            m_instances[i].mesh->SetJointMatricesAddress(address + offset, skin_previous ? prev_address + offset : Skeleton::INVALID_ADDRESS);
+        }
+    }
+
+    m_bLayoutChanged = false;
+
+    m_stats.meshes = mesh_count;
+    m_stats.nodes = node_count;
+    m_stats.joints = joint_count;
+    m_stats.update_time = (float)stm_ms(stm_since(start));
+}
+
+float AnimationSystem::GetScreenSize(const float3& bounds_min, const float3& bounds_max, const float3& eye, float fov)
+{
+    float3 center = (bounds_min + bounds_max) * 0.5f;
+    float radius = length(bounds_max - bounds_min) * 0.5f;
+    float distance = length(center - eye);
+
+    if (distance <= radius)
+    {
+        return 1.0f;
+    }
+
+    return radius / (distance * tanf(0.5f * radians(fov)));
+}
+
+AnimationLOD AnimationSystem::SelectLOD(const SkeletalMesh* mesh, const Camera* camera) const
+{
+    if (camera == nullptr)
+    {
+        return AnimationLOD::Full;
+    }
+
+    //the bounds are from the last evaluated pose, a margin lets the animation bring a mesh back into the frustum
+    float3 extent = (mesh->GetBoundsMax() - mesh->GetBoundsMin()) * 0.25f;
+    if (!FrustumCull(camera->GetFrustumPlanes(), 6, mesh->GetBoundsMin() - extent, mesh->GetBoundsMax() + extent))
+    {
+        return AnimationLOD::Frozen;
+    }
+
+    float screen_size = GetScreenSize(mesh->GetBoundsMin(), mesh->GetBoundsMax(), camera->GetPosition(), camera->GetFov());
+    if (screen_size >= m_fullLODScreenSize)
+    {
+        return AnimationLOD::Full;
+    }
+
+    return screen_size >= m_reducedLODScreenSize ? AnimationLOD::Reduced : AnimationLOD::Minimal;
+}
+
+void AnimationSystem::OnGui()
+{
+    if (ImGui::CollapsingHeader("Animation System"))
+    {
+        ImGui::Text("%u meshes, %u nodes, %u joints, palette %.1f KB", m_stats.meshes, m_stats.nodes, m_stats.joints, m_stats.joints * sizeof(float4x4) / 1024.0f);
+        ImGui::Text("Update : %.3f ms", m_stats.update_time);
+
+        ImGui::Checkbox("Enable LOD##AnimationSystem", &m_bEnableLOD);
+        ImGui::SliderFloat("Full LOD Screen Size", &m_fullLODScreenSize, 0.0f, 1.0f);
+        ImGui::SliderFloat("Reduced LOD Screen Size", &m_reducedLODScreenSize, 0.0f, m_fullLODScreenSize);
+
+        ImGui::Text("LOD : %u full, %u reduced, %u minimal, %u frozen", m_stats.lod_meshes[(uint32_t)AnimationLOD::Full], m_stats.lod_meshes[(uint32_t)AnimationLOD::Reduced],
+            m_stats.lod_meshes[(uint32_t)AnimationLOD::Minimal], m_stats.lod_meshes[(uint32_t)AnimationLOD::Frozen]);
+        ImGui::Text("Saved : %u samples (%u nodes), %u poses, %u skinning dispatches", m_stats.skipped_samples, m_stats.skipped_nodes,
+            m_stats.skipped_poses, m_stats.skipped_skinning);
+    }
+}
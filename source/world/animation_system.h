@@ -0,0 +1,94 @@
+#pragma once
+
+#include "utils/math.h"
+#include "EASTL/vector.h"
+
+class Renderer;
+class Camera;
+class SkeletalMesh;
+
+//chosen each frame from the visibility and projected size of the mesh bounds
+enum class AnimationLOD
+{
+    Full,    //sampled every frame
+    Reduced, //sampled every other frame with the reduced node set, the frames in between interpolate the last two samples
+    Minimal, //sampled, skinned and refit every 4 frames with the reduced node set
+    Frozen,  //outside of the frustum : neither sampled nor skinned, the time accumulates until it is visible again
+
+    Count,
+};
+
+struct AnimationSystemStats
+{
+    uint32_t meshes = 0;
+    uint32_t nodes = 0;
+    uint32_t joints = 0;
+    float update_time = 0.0f; //ms, pose evaluation and palette upload
+
+    uint32_t lod_meshes[(uint32_t)AnimationLOD::Count] = {};
+
+    //work saved by the LODs this frame
+    uint32_t skipped_samples = 0;  //meshes whose state machine did not run
+    uint32_t skipped_nodes = 0;    //nodes not sampled, by skipped samples and reduced sets
+    uint32_t skipped_poses = 0;    //meshes not posed at all : no global transforms, skinning dispatches or BLAS refits
+    uint32_t skipped_skinning = 0; //skinning dispatches
+};
+
+//evaluates the poses of all skeletal meshes across the task threads before the objects tick,
+//and uploads the joint matrices of all meshes as one contiguous palette.
+//it also works as the significance manager of the meshes, throttling the ones which are small on screen or not visible
+class AnimationSystem
+{
+public:
+    AnimationSystem(Renderer* pRenderer);
+
+    void AddMesh(SkeletalMesh* mesh);
+    void RemoveMesh(SkeletalMesh* mesh);
+
+    void Update(float delta_time, const Camera* camera);
+
+    //projected diameter of the bounds over the screen height, for a vertical field of view in degrees
+    static float GetScreenSize(const float3& bounds_min, const float3& bounds_max, const float3& eye, float fov);
+
+    const AnimationSystemStats& GetStats() const { return m_stats; }
+    void OnGui();
+
+private:
+    AnimationLOD SelectLOD(const SkeletalMesh* mesh, const Camera* camera) const;
+
+private:
+    struct Instance
+    {
+        SkeletalMesh* mesh;
+        AnimationLOD lod;
+        float pendingTime;   //accumulated while the mesh is not sampled
+        uint32_t sampleFrame; //frame of the last sample
+    };
+
+    Renderer* m_pRenderer = nullptr;
+
+    eastl::vector<Instance> m_instances;
+    eastl::vector<uint32_t> m_paletteOffsets; //first joint of each mesh
+    eastl::vector<float4x4> m_palette;        //kept across frames, for the meshes which are not updated
+    eastl::vector<float4x4> m_prevPalette;    //only if VertexSkinning skins the previous positions
+    bool m_bLayoutChanged = true;             //meshes were added or removed, all of them are updated
+    uint32_t m_nFrame = 0;
+
+    //evaluation of this frame, in the order of m_instances
+    struct Evaluation
+    {
+        uint32_t instance;
+        float deltaTime;
+        bool sample;
+        float interpolation;
+        bool reduced;
+        bool resetPrevious; //the previous joint matrices are set to the new ones
+    };
+    eastl::vector<Evaluation> m_evaluations;
+
+    bool m_bEnableLOD = true;
+    float m_fullLODScreenSize = 0.25f;    //screen sizes above which the meshes use the Full and Reduced LODs
+    float m_reducedLODScreenSize = 0.05f;
+
+    AnimationSystemStats m_stats;
+};
@@ -42,6 +42,7 @@ void BillboardSpriteRenderer::AddSprite(const float3& position, float size, Text
     sprite.texture = texture->GetSRV()->GetHeapIndex();
     sprite.objectID = objectID;
 
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_sprites.push_back(sprite);
 }
 
@@ -61,7 +62,8 @@ void BillboardSpriteRenderer::Render()
 
     eastl::sort(m_sprites.begin(), m_sprites.end(), [](const Sprite& a, const Sprite& b)
         {
-            return a.distance > b.distance;
+            //the add order depends on the scheduling, ties are broken by the object id
+            return a.distance > b.distance || (a.distance == b.distance && a.objectID < b.objectID);
         });
 
     uint32_t spriteCount = (uint32_t)m_sprites.size();
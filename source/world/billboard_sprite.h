@@ -1,6 +1,7 @@
 #pragma once
 
 #include "renderer/renderer.h"
+#include <mutex>
 
 class BillboardSpriteRenderer
 {
@@ -27,4 +28,5 @@ private:
         float distance;
     };
     eastl::vector<Sprite> m_sprites;
+    std::mutex m_mutex; //sprites are added from IVisibleObject::Render, which runs on the task threads
 };
\ No newline at end of file
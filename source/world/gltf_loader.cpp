@@ -1,15 +1,22 @@
 #include "gltf_loader.h"
 #include "static_mesh.h"
 #include "skeletal_mesh.h"
-#include "animation.h"
+#include "animation_compression.h"
 #include "skeleton.h"
 #include "mesh_material.h"
 #include "resource_cache.h"
+#include "renderer/texture_cooker.h"
 #include "core/engine.h"
 #include "utils/string.h"
 #include "utils/fmt.h"
+#include "utils/parallel_for.h"
+#include "renderer/renderer.h"
+#include "renderer/async_texture_loader.h"
 #include "tinyxml2/tinyxml2.h"
 #include "meshoptimizer/meshoptimizer.h"
+#include "EASTL/hash_map.h"
+#include "EASTL/hash_set.h"
+#include <mutex>
 
 #define CGLTF_IMPLEMENTATION
 #include "cgltf/cgltf.h"
@@ -137,6 +144,14 @@ void GLTFLoader::LoadSettings(tinyxml2::XMLElement* element)
     {
         m_anisotropicTexture = Engine::GetInstance()->GetAssetPath() + anisotropyT->Value();
     }
+
+    const tinyxml2::XMLAttribute* animation_tolerance = element->FindAttribute("animationTolerance");
+    if (animation_tolerance)
+    {
+        m_animationTolerance = animation_tolerance->FloatValue();
+    }
+
+    m_animationStates.Load(element);
 }
 
 void GLTFLoader::Load(const char* gltf_file)
@@ -153,11 +168,19 @@ void GLTFLoader::Load(const char* gltf_file)
 
     cgltf_load_buffers(&options, data, file.c_str());
 
+    PrefetchTextures(data);
+
     if (data->animations_count > 0)
     {
         SkeletalMesh* mesh = new SkeletalMesh(m_file);
         mesh->m_pRenderer = Engine::GetInstance()->GetRenderer();
-        mesh->m_pAnimation.reset(LoadAnimation(data, &data->animations[0])); //currently only load the first one
+
+        eastl::vector<eastl::shared_ptr<AnimationClip>> clips;
+        for (cgltf_size i = 0; i < data->animations_count; ++i)
+        {
+            clips.push_back(LoadAnimation(data, &data->animations[i]));
+        }
+        mesh->m_pAnimator = eastl::make_unique<AnimationStateMachine>(m_animationStates, clips);
         mesh->m_pSkeleton.reset(LoadSkeleton(data, &data->skins[0]));
 
         for (cgltf_size i = 0; i < data->nodes_count; ++i)
@@ -188,6 +211,9 @@ void GLTFLoader::Load(const char* gltf_file)
     }
 
     cgltf_free(data);
+
+    //drops the prefetched textures which were not used
+    Engine::GetInstance()->GetRenderer()->GetAsyncTextureLoader()->Reset();
 }
 
 void GLTFLoader::LoadStaticMeshNode(const cgltf_data* data, const cgltf_node* node, const float4x4& mtxParentToWorld)
@@ -207,11 +233,36 @@ void GLTFLoader::LoadStaticMeshNode(const cgltf_data* data, const cgltf_node* no
         uint32_t mesh_index = GetMeshIndex(data, node->mesh);
         bool bFrontFaceCCW = IsFrontFaceCCW(node);
 
+        eastl::vector<StaticMesh*> meshes;
+        StaticMesh* blas_owner = nullptr;
+
         for (cgltf_size i = 0; i < node->mesh->primitives_count; i++)
         {
             eastl::string name = fmt::format("mesh_{}_{} {}", mesh_index, i, (node->mesh->name ? node->mesh->name : "")).c_str();
 
             StaticMesh* mesh = LoadStaticMesh(&node->mesh->primitives[i], name, bFrontFaceCCW);
+            meshes.push_back(mesh);
+
+            //the primitives of a node share one blas, with a geometry each
+            if (!mesh->m_pMaterial->IsAlphaBlend())
+            {
+                if (blas_owner == nullptr)
+                {
+                    blas_owner = mesh;
+                }
+                else
+                {
+                    blas_owner->m_blasMembers.push_back(mesh);
+                    mesh->m_pBLASOwner = blas_owner;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < meshes.size(); ++i)
+        {
+            StaticMesh* mesh = meshes[i];
+            mesh->Create();
+            m_pWorld->AddObject(mesh);
 
             mesh->m_pMaterial->m_bFrontFaceCCW = bFrontFaceCCW;
             mesh->SetPosition(position);
@@ -226,7 +277,141 @@ void GLTFLoader::LoadStaticMeshNode(const cgltf_data* data, const cgltf_node* no
     }
 }
 
-Texture2D* GLTFLoader::LoadTexture(const cgltf_texture_view& texture_view, bool srgb)
+inline eastl::string GetTextureKey(const eastl::string& file, TextureUsage usage)
+{
+    return file + "#" + eastl::to_string((int)usage);
+}
+
+//source file and usage -> cooked file, shared by all the loaders so that a source is hashed once per run
+static eastl::hash_map<eastl::string, eastl::string> s_cookedTextures;
+static std::mutex s_cookedTexturesMutex;
+
+static bool FindCookedTexture(const eastl::string& key, eastl::string& cooked_file)
+{
+    std::lock_guard<std::mutex> lock(s_cookedTexturesMutex);
+
+    auto iter = s_cookedTextures.find(key);
+    if (iter == s_cookedTextures.end())
+    {
+        return false;
+    }
+
+    cooked_file = iter->second;
+    return true;
+}
+
+static void AddCookedTexture(const eastl::string& key, const eastl::string& cooked_file)
+{
+    std::lock_guard<std::mutex> lock(s_cookedTexturesMutex);
+    s_cookedTextures[key] = cooked_file;
+}
+
+//the same texture and usage as LoadMaterial
+static void GetMaterialTextures(const cgltf_material* material, eastl::vector<eastl::pair<const cgltf_texture_view*, TextureUsage>>& textures)
+{
+    if (material->has_pbr_metallic_roughness)
+    {
+        textures.push_back({ &material->pbr_metallic_roughness.base_color_texture, TextureUsage::Albedo });
+        textures.push_back({ &material->pbr_metallic_roughness.metallic_roughness_texture, TextureUsage::ORM });
+    }
+    else if (material->has_pbr_specular_glossiness)
+    {
+        textures.push_back({ &material->pbr_specular_glossiness.diffuse_texture, TextureUsage::Albedo });
+        textures.push_back({ &material->pbr_specular_glossiness.specular_glossiness_texture, TextureUsage::Albedo });
+    }
+
+    bool packed_ao = material->occlusion_texture.texture && material->has_pbr_metallic_roughness &&
+        material->occlusion_texture.texture == material->pbr_metallic_roughness.metallic_roughness_texture.texture;
+
+    textures.push_back({ &material->normal_texture, TextureUsage::Normal });
+    textures.push_back({ &material->emissive_texture, TextureUsage::Emissive });
+    textures.push_back({ &material->occlusion_texture, packed_ao ? TextureUsage::ORM : TextureUsage::Mask });
+
+    if (material->has_sheen)
+    {
+        textures.push_back({ &material->sheen.sheen_color_texture, TextureUsage::Albedo });
+        textures.push_back({ &material->sheen.sheen_roughness_texture, TextureUsage::Linear });
+    }
+
+    if (material->has_clearcoat)
+    {
+        textures.push_back({ &material->clearcoat.clearcoat_texture, TextureUsage::ORM });
+        textures.push_back({ &material->clearcoat.clearcoat_roughness_texture, TextureUsage::ORM });
+        textures.push_back({ &material->clearcoat.clearcoat_normal_texture, TextureUsage::Normal });
+    }
+}
+
+//cooks the textures of all materials in parallel, then maps and decodes them on task threads while the meshes are loaded
+void GLTFLoader::PrefetchTextures(const cgltf_data* data)
+{
+    size_t last_slash = m_file.find_last_of('/');
+    eastl::string path = Engine::GetInstance()->GetAssetPath() + m_file.substr(0, last_slash + 1);
+
+    eastl::vector<eastl::pair<const cgltf_texture_view*, TextureUsage>> texture_views;
+    for (cgltf_size i = 0; i < data->materials_count; ++i)
+    {
+        GetMaterialTextures(&data->materials[i], texture_views);
+    }
+
+    ResourceCache* cache = ResourceCache::GetInstance();
+    AsyncTextureLoader* pLoader = Engine::GetInstance()->GetRenderer()->GetAsyncTextureLoader();
+
+    eastl::hash_set<eastl::string> keys;
+    eastl::vector<eastl::pair<eastl::string, TextureUsage>> textures; //not cooked in this run yet
+    for (size_t i = 0; i < texture_views.size(); ++i)
+    {
+        const cgltf_texture* texture = texture_views[i].first->texture;
+        if (texture == nullptr || texture->image->uri == nullptr)
+        {
+            continue;
+        }
+
+        eastl::string file = path + texture->image->uri;
+        eastl::string key = GetTextureKey(file, texture_views[i].second);
+        if (!keys.insert(key).second)
+        {
+            continue;
+        }
+
+        //textures shared with the models loaded before are usually still in the resource cache
+        eastl::string cooked_file;
+        if (FindCookedTexture(key, cooked_file))
+        {
+            if (!cache->IsTexture2DCached(cooked_file))
+            {
+                pLoader->Request(cooked_file, TextureCooker::IsSRGB(texture_views[i].second));
+            }
+            continue;
+        }
+
+        textures.push_back({ file, texture_views[i].second });
+    }
+
+    if (textures.empty())
+    {
+        return;
+    }
+
+    eastl::vector<eastl::string> cooked_files(textures.size());
+    ParallelFor((uint32_t)textures.size(), [&](uint32_t i)
+        {
+            TextureCooker cooker;
+            cooked_files[i] = cooker.GetCookedFile(textures[i].first, textures[i].second);
+        });
+
+    for (size_t i = 0; i < textures.size(); ++i)
+    {
+        AddCookedTexture(GetTextureKey(textures[i].first, textures[i].second), cooked_files[i]);
+
+        //different sources may have the same content
+        if (!cache->IsTexture2DCached(cooked_files[i]))
+        {
+            pLoader->Request(cooked_files[i], TextureCooker::IsSRGB(textures[i].second));
+        }
+    }
+}
+
+Texture2D* GLTFLoader::LoadTexture(const cgltf_texture_view& texture_view, TextureUsage usage)
 {
     if (texture_view.texture == nullptr || texture_view.texture->image->uri == nullptr)
     {
@@ -235,8 +420,17 @@ Texture2D* GLTFLoader::LoadTexture(const cgltf_texture_view& texture_view, bool
 
     size_t last_slash = m_file.find_last_of('/');
     eastl::string path = Engine::GetInstance()->GetAssetPath() + m_file.substr(0, last_slash + 1);
+    eastl::string file = path + texture_view.texture->image->uri;
 
-    Texture2D* texture = ResourceCache::GetInstance()->GetTexture2D(path + texture_view.texture->image->uri, srgb);
+    eastl::string key = GetTextureKey(file, usage);
+    if (!FindCookedTexture(key, file))
+    {
+        TextureCooker cooker;
+        file = cooker.GetCookedFile(file, usage);
+        AddCookedTexture(key, file);
+    }
+
+    Texture2D* texture = ResourceCache::GetInstance()->GetTexture2D(file, TextureCooker::IsSRGB(usage), true);
 
     return texture;
 }
@@ -250,6 +444,7 @@ inline MaterialTextureInfo LoadTextureInfo(const Texture2D* texture, const cgltf
         info.index = texture->GetSRV()->GetHeapIndex();
         info.width = texture->GetTexture()->GetDesc().width;
         info.height = texture->GetTexture()->GetDesc().height;
+        info.streamingIndex = texture->GetStreamingIndex() != GFX_INVALID_RESOURCE ? texture->GetStreamingIndex() : INVALID_STREAMING_INDEX;
 
         if (texture_view.has_transform)
         {
@@ -276,9 +471,9 @@ MeshMaterial* GLTFLoader::LoadMaterial(const cgltf_material* gltf_material)
     if (gltf_material->has_pbr_metallic_roughness)
     {
         material->m_bPbrMetallicRoughness = true;
-        material->m_pAlbedoTexture = LoadTexture(gltf_material->pbr_metallic_roughness.base_color_texture, true);
+        material->m_pAlbedoTexture = LoadTexture(gltf_material->pbr_metallic_roughness.base_color_texture, TextureUsage::Albedo);
         material->m_materialCB.albedoTexture = LoadTextureInfo(material->m_pAlbedoTexture, gltf_material->pbr_metallic_roughness.base_color_texture);
-        material->m_pMetallicRoughnessTexture = LoadTexture(gltf_material->pbr_metallic_roughness.metallic_roughness_texture, false);
+        material->m_pMetallicRoughnessTexture = LoadTexture(gltf_material->pbr_metallic_roughness.metallic_roughness_texture, TextureUsage::ORM);
         material->m_materialCB.metallicRoughnessTexture = LoadTextureInfo(material->m_pMetallicRoughnessTexture, gltf_material->pbr_metallic_roughness.metallic_roughness_texture);
         material->m_albedoColor = float3(gltf_material->pbr_metallic_roughness.base_color_factor);
         material->m_metallic = gltf_material->pbr_metallic_roughness.metallic_factor;
@@ -287,20 +482,23 @@ MeshMaterial* GLTFLoader::LoadMaterial(const cgltf_material* gltf_material)
     else if (gltf_material->has_pbr_specular_glossiness)
     {
         material->m_bPbrSpecularGlossiness = true;
-        material->m_pDiffuseTexture = LoadTexture(gltf_material->pbr_specular_glossiness.diffuse_texture, true);
+        material->m_pDiffuseTexture = LoadTexture(gltf_material->pbr_specular_glossiness.diffuse_texture, TextureUsage::Albedo);
         material->m_materialCB.diffuseTexture = LoadTextureInfo(material->m_pDiffuseTexture, gltf_material->pbr_specular_glossiness.diffuse_texture);
-        material->m_pSpecularGlossinessTexture = LoadTexture(gltf_material->pbr_specular_glossiness.specular_glossiness_texture, true);
+        material->m_pSpecularGlossinessTexture = LoadTexture(gltf_material->pbr_specular_glossiness.specular_glossiness_texture, TextureUsage::Albedo);
         material->m_materialCB.specularGlossinessTexture = LoadTextureInfo(material->m_pSpecularGlossinessTexture, gltf_material->pbr_specular_glossiness.specular_glossiness_texture);
         material->m_diffuseColor = float3(gltf_material->pbr_specular_glossiness.diffuse_factor);
         material->m_specularColor = float3(gltf_material->pbr_specular_glossiness.specular_factor);
         material->m_glossiness = gltf_material->pbr_specular_glossiness.glossiness_factor;
     }
 
-    material->m_pNormalTexture = LoadTexture(gltf_material->normal_texture, false);
+    material->m_pNormalTexture = LoadTexture(gltf_material->normal_texture, TextureUsage::Normal);
     material->m_materialCB.normalTexture = LoadTextureInfo(material->m_pNormalTexture, gltf_material->normal_texture);
-    material->m_pEmissiveTexture = LoadTexture(gltf_material->emissive_texture, true);
+    material->m_pEmissiveTexture = LoadTexture(gltf_material->emissive_texture, TextureUsage::Emissive);
     material->m_materialCB.emissiveTexture = LoadTextureInfo(material->m_pEmissiveTexture, gltf_material->emissive_texture);
-    material->m_pAOTexture = LoadTexture(gltf_material->occlusion_texture, false);
+    //occlusion packed with metallic/roughness should be cooked once, the shaders sample it only once then
+    bool packed_ao = gltf_material->occlusion_texture.texture && gltf_material->has_pbr_metallic_roughness &&
+        gltf_material->occlusion_texture.texture == gltf_material->pbr_metallic_roughness.metallic_roughness_texture.texture;
+    material->m_pAOTexture = LoadTexture(gltf_material->occlusion_texture, packed_ao ? TextureUsage::ORM : TextureUsage::Mask);
     material->m_materialCB.aoTexture = LoadTextureInfo(material->m_pAOTexture, gltf_material->occlusion_texture);
 
     material->m_emissiveColor = float3(gltf_material->emissive_factor);
@@ -319,9 +517,9 @@ MeshMaterial* GLTFLoader::LoadMaterial(const cgltf_material* gltf_material)
     if (gltf_material->has_sheen)
     {
         material->m_shadingModel = ShadingModel::Sheen;
-        material->m_pSheenColorTexture = LoadTexture(gltf_material->sheen.sheen_color_texture, true);
+        material->m_pSheenColorTexture = LoadTexture(gltf_material->sheen.sheen_color_texture, TextureUsage::Albedo);
         material->m_sheenColor = float3(gltf_material->sheen.sheen_color_factor);
-        material->m_pSheenRoughnessTexture = LoadTexture(gltf_material->sheen.sheen_roughness_texture, false);
+        material->m_pSheenRoughnessTexture = LoadTexture(gltf_material->sheen.sheen_roughness_texture, TextureUsage::Linear);
         material->m_sheenRoughness = gltf_material->sheen.sheen_roughness_factor;
 
         material->m_materialCB.sheenColorTexture = LoadTextureInfo(material->m_pSheenColorTexture, gltf_material->sheen.sheen_color_texture);
@@ -331,9 +529,9 @@ MeshMaterial* GLTFLoader::LoadMaterial(const cgltf_material* gltf_material)
     if (gltf_material->has_clearcoat)
     {
         material->m_shadingModel = ShadingModel::ClearCoat;
-        material->m_pClearCoatTexture = LoadTexture(gltf_material->clearcoat.clearcoat_texture, false);
-        material->m_pClearCoatRoughnessTexture = LoadTexture(gltf_material->clearcoat.clearcoat_roughness_texture, false);
-        material->m_pClearCoatNormalTexture = LoadTexture(gltf_material->clearcoat.clearcoat_normal_texture, false);
+        material->m_pClearCoatTexture = LoadTexture(gltf_material->clearcoat.clearcoat_texture, TextureUsage::ORM);
+        material->m_pClearCoatRoughnessTexture = LoadTexture(gltf_material->clearcoat.clearcoat_roughness_texture, TextureUsage::ORM);
+        material->m_pClearCoatNormalTexture = LoadTexture(gltf_material->clearcoat.clearcoat_normal_texture, TextureUsage::Normal);
         material->m_clearCoat = gltf_material->clearcoat.clearcoat_factor;
         material->m_clearCoatRoughness = gltf_material->clearcoat.clearcoat_roughness_factor;
 
@@ -569,6 +767,7 @@ StaticMesh* GLTFLoader::LoadStaticMesh(const cgltf_primitive* primitive, const e
 
     Renderer* pRenderer = Engine::GetInstance()->GetRenderer();
     ResourceCache* cache = ResourceCache::GetInstance();
+    ResourceKey mesh_key = ResourceCache::MakeKey("model(" + m_file + " " + name + ")");
 
     mesh->m_pRenderer = pRenderer;
 
@@ -586,7 +785,7 @@ StaticMesh* GLTFLoader::LoadStaticMesh(const cgltf_primitive* primitive, const e
         indices.data = data;
     }
 
-    mesh->m_indexBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") IB", remapped_indices, (uint32_t)indices.stride * (uint32_t)index_count);
+    mesh->m_indexBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "IB"), remapped_indices, (uint32_t)indices.stride * (uint32_t)index_count);
     mesh->m_indexBufferFormat = indices.stride == 4 ? GfxFormat::R32UI : GfxFormat::R16UI;
     mesh->m_nIndexCount = (uint32_t)index_count;
     mesh->m_nVertexCount = (uint32_t)remapped_vertex_count;
@@ -596,7 +795,7 @@ StaticMesh* GLTFLoader::LoadStaticMesh(const cgltf_primitive* primitive, const e
         switch (vertex_types[i])
         {
         case cgltf_attribute_type_position:
-            mesh->m_posBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") pos", remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
+            mesh->m_posBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "pos"), remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
 
             {
                 IPhysicsSystem* physics = Engine::GetInstance()->GetWorld()->GetPhysicsSystem();
@@ -613,13 +812,13 @@ StaticMesh* GLTFLoader::LoadStaticMesh(const cgltf_primitive* primitive, const e
             }
             break;
         case cgltf_attribute_type_texcoord:
-            mesh->m_uvBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") UV", remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
+            mesh->m_uvBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "UV"), remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
             break;
         case cgltf_attribute_type_normal:
-            mesh->m_normalBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") normal", remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
+            mesh->m_normalBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "normal"), remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
             break;
         case cgltf_attribute_type_tangent:
-            mesh->m_tangentBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") tangent", remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
+            mesh->m_tangentBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "tangent"), remapped_vertices[i], (uint32_t)vertex_streams[i].stride * (uint32_t)remapped_vertex_count);
             break;
         default:
             break;
@@ -627,12 +826,9 @@ StaticMesh* GLTFLoader::LoadStaticMesh(const cgltf_primitive* primitive, const e
     }
 
     mesh->m_nMeshletCount = (uint32_t)meshlet_count;
-    mesh->m_meshletBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") meshlet", meshlet_bounds.data(), sizeof(MeshletBound) * (uint32_t)meshlet_bounds.size());
-    mesh->m_meshletVerticesBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") meshlet vertices", meshlet_vertices.data(), sizeof(unsigned int) * (uint32_t)meshlet_vertices.size());
-    mesh->m_meshletIndicesBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") meshlet indices", meshlet_triangles16.data(), sizeof(unsigned short) * (uint32_t)meshlet_triangles16.size());
-
-    mesh->Create();
-    m_pWorld->AddObject(mesh);
+    mesh->m_meshletBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "meshlet"), meshlet_bounds.data(), sizeof(MeshletBound) * (uint32_t)meshlet_bounds.size());
+    mesh->m_meshletVerticesBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "meshlet vertices"), meshlet_vertices.data(), sizeof(unsigned int) * (uint32_t)meshlet_vertices.size());
+    mesh->m_meshletIndicesBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "meshlet indices"), meshlet_triangles16.data(), sizeof(unsigned short) * (uint32_t)meshlet_triangles16.size());
 
     RE_FREE((void*)indices.data);
     for (size_t i = 0; i < vertex_streams.size(); ++i)
@@ -649,11 +845,10 @@ StaticMesh* GLTFLoader::LoadStaticMesh(const cgltf_primitive* primitive, const e
     return mesh;
 }
 
-Animation* GLTFLoader::LoadAnimation(const cgltf_data* data, const cgltf_animation* gltf_animation)
+eastl::shared_ptr<AnimationClip> GLTFLoader::LoadAnimation(const cgltf_data* data, const cgltf_animation* gltf_animation)
 {
-    Animation* animation = new Animation(gltf_animation->name ? gltf_animation->name : "");
-
-    animation->m_channels.reserve(gltf_animation->channels_count);
+    eastl::vector<AnimationChannel> channels;
+    channels.reserve(gltf_animation->channels_count);
     for (cgltf_size i = 0; i < gltf_animation->channels_count; ++i)
     {
         const cgltf_animation_channel* gltf_channel = &gltf_animation->channels[i];
@@ -701,14 +896,35 @@ Animation* GLTFLoader::LoadAnimation(const cgltf_data* data, const cgltf_animati
             channel.keyframes.push_back(eastl::make_pair(time, value));
         }
 
-        animation->m_channels.push_back(channel);
+        channels.push_back(eastl::move(channel));
+    }
 
-        RE_ASSERT(time_accessor->has_min && time_accessor->has_max);
-        float duration = time_accessor->max[0] - time_accessor->min[0];
-        animation->m_timeDuration = max(duration, animation->m_timeDuration);
+    //converted to the sampling layout once here
+    eastl::string name = gltf_animation->name ? gltf_animation->name : "";
+    if (m_animationTolerance <= 0.0f)
+    {
+        return eastl::make_shared<AnimationClip>(name, channels);
     }
 
-    return animation;
+    AnimationCompressionSettings compression;
+    compression.tolerance = m_animationTolerance;
+    compression.parents.resize(data->nodes_count);
+    compression.restTranslations.resize(data->nodes_count);
+
+    for (cgltf_size i = 0; i < data->nodes_count; ++i)
+    {
+        const cgltf_node* node = &data->nodes[i];
+        compression.parents[i] = node->parent ? (int32_t)GetNodeIndex(data, node->parent) : -1;
+
+        float3 translation = float3(node->translation);
+        if (node->has_matrix)
+        {
+            translation = float3(node->matrix[12], node->matrix[13], node->matrix[14]);
+        }
+        compression.restTranslations[i] = float3(translation.x, translation.y, -translation.z); //right-hand to left-hand
+    }
+
+    return eastl::make_shared<AnimationClip>(name, channels, &compression);
 }
 
 Skeleton* GLTFLoader::LoadSkeleton(const cgltf_data* data, const cgltf_skin* skin)
@@ -721,7 +937,6 @@ Skeleton* GLTFLoader::LoadSkeleton(const cgltf_data* data, const cgltf_skin* ski
     Skeleton* skeleton = new Skeleton(skin->name ? skin->name : "");
     skeleton->m_joints.resize(skin->joints_count);
     skeleton->m_inverseBindMatrices.resize(skin->joints_count);
-    skeleton->m_jointMatrices.resize(skin->joints_count);
 
     for (cgltf_size i = 0; i < skin->joints_count; ++i)
     {
@@ -815,24 +1030,37 @@ SkeletalMeshData* GLTFLoader::LoadSkeletalMesh(const cgltf_primitive* primitive,
     mesh->material.reset(LoadMaterial(primitive->material));
 
     ResourceCache* cache = ResourceCache::GetInstance();
+    ResourceKey mesh_key = ResourceCache::MakeKey("model(" + m_file + " " + name + ")");
 
     size_t index_count;
     meshopt_Stream indices = LoadBufferStream(primitive->indices, false, index_count);
 
-    mesh->indexBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") IB", indices.data, (uint32_t)indices.stride * (uint32_t)index_count);
+    mesh->indexBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "IB"), indices.data, (uint32_t)indices.stride * (uint32_t)index_count);
     mesh->indexBufferFormat = indices.stride == 4 ? GfxFormat::R32UI : GfxFormat::R16UI;
     mesh->indexCount = (uint32_t)index_count;
 
     size_t vertex_count;
     meshopt_Stream vertices;
 
+    //kept for the joint bounds
+    eastl::vector<float3> positions;
+    eastl::vector<ushort4> jointIDs;
+    eastl::vector<float4> jointWeights;
+
     for (cgltf_size i = 0; i < primitive->attributes_count; ++i)
     {
         switch (primitive->attributes[i].type)
         {
         case cgltf_attribute_type_position:
             vertices = LoadBufferStream(primitive->attributes[i].data, true, vertex_count);
-            mesh->staticPosBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") pos", vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
+            mesh->staticPosBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "pos"), vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
+
+            positions.resize(vertex_count);
+            for (size_t v = 0; v < vertex_count; ++v)
+            {
+                cgltf_accessor_read_float(primitive->attributes[i].data, v, &positions[v].x, 3);
+                positions[v].z = -positions[v].z; //right-hand to left-hand
+            }
 
             {
                 float3 min = float3(primitive->attributes[i].data->min);
@@ -853,23 +1081,22 @@ SkeletalMeshData* GLTFLoader::LoadSkeletalMesh(const cgltf_primitive* primitive,
             if (primitive->attributes[i].index == 0)
             {
                 vertices = LoadBufferStream(primitive->attributes[i].data, false, vertex_count);
-                mesh->uvBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") UV", vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
+                mesh->uvBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "UV"), vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
             }
             break;
         case cgltf_attribute_type_normal:
             vertices = LoadBufferStream(primitive->attributes[i].data, true, vertex_count);
-            mesh->staticNormalBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") normal", vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
+            mesh->staticNormalBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "normal"), vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
             break;
         case cgltf_attribute_type_tangent:
             vertices = LoadBufferStream(primitive->attributes[i].data, false, vertex_count);
-            mesh->staticTangentBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") tangent", vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
+            mesh->staticTangentBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "tangent"), vertices.data, (uint32_t)vertices.stride * (uint32_t)vertex_count);
             break;
         case cgltf_attribute_type_joints:
         {
             const cgltf_accessor* accessor = primitive->attributes[i].data;
 
-            eastl::vector<ushort4> jointIDs;
-            jointIDs.reserve(accessor->count * 4);
+            jointIDs.reserve(accessor->count);
 
             for (cgltf_size j = 0; j < accessor->count; ++j)
             {
@@ -879,14 +1106,13 @@ SkeletalMeshData* GLTFLoader::LoadSkeletalMesh(const cgltf_primitive* primitive,
                 jointIDs.push_back(ushort4(id[0], id[1], id[2], id[3]));
             }
 
-            mesh->jointIDBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") joint ID", jointIDs.data(), sizeof(ushort4) * (uint32_t)accessor->count);
+            mesh->jointIDBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "joint ID"), jointIDs.data(), sizeof(ushort4) * (uint32_t)accessor->count);
             break;
         }
         case cgltf_attribute_type_weights:
         {
             const cgltf_accessor* accessor = primitive->attributes[i].data;
 
-            eastl::vector<float4> jointWeights;
             jointWeights.reserve(accessor->count);
 
             for (cgltf_size j = 0; j < accessor->count; ++j)
@@ -897,7 +1123,7 @@ SkeletalMeshData* GLTFLoader::LoadSkeletalMesh(const cgltf_primitive* primitive,
                 jointWeights.push_back(float4(weight));
             }
 
-            mesh->jointWeightBuffer = cache->GetSceneBuffer("model(" + m_file + " " + name + ") joint weight", jointWeights.data(), sizeof(float4) * (uint32_t)accessor->count);
+            mesh->jointWeightBuffer = cache->GetSceneBuffer(ResourceCache::MakeKey(mesh_key, "joint weight"), jointWeights.data(), sizeof(float4) * (uint32_t)accessor->count);
             break;
         }
         default:
@@ -907,5 +1133,19 @@ SkeletalMeshData* GLTFLoader::LoadSkeletalMesh(const cgltf_primitive* primitive,
 
     mesh->vertexCount = (uint32_t)vertex_count;
 
+    if (!jointIDs.empty() && jointIDs.size() == positions.size() && jointWeights.size() == positions.size())
+    {
+        uint32_t joint_count = 0;
+        for (size_t v = 0; v < jointIDs.size(); ++v)
+        {
+            joint_count = eastl::max(joint_count, (uint32_t)maxelem(jointIDs[v]) + 1);
+        }
+
+        mesh->jointBoundsMin.resize(joint_count);
+        mesh->jointBoundsMax.resize(joint_count);
+        ComputeJointBounds(positions.data(), jointIDs.data(), jointWeights.data(), (uint32_t)positions.size(), joint_count,
+            mesh->jointBoundsMin.data(), mesh->jointBoundsMax.data());
+    }
+
     return mesh;
 }
@@ -1,16 +1,16 @@
 #pragma once
 
-#include "utils/math.h"
+#include "animation_state_machine.h"
 #include "EASTL/string.h"
 
 class World;
 class StaticMesh;
 class MeshMaterial;
 class Texture2D;
-class Animation;
 class Skeleton;
 struct SkeletalMeshNode;
 struct SkeletalMeshData;
+enum class TextureUsage;
 
 struct cgltf_data;
 struct cgltf_node;
@@ -37,13 +37,14 @@ private:
     void LoadStaticMeshNode(const cgltf_data* data, const cgltf_node* node, const float4x4& mtxParentToWorld);
     StaticMesh* LoadStaticMesh(const cgltf_primitive* primitive, const eastl::string& name, bool bFrontFaceCCW);
 
-    Animation* LoadAnimation(const cgltf_data* data, const cgltf_animation* animation);
+    eastl::shared_ptr<AnimationClip> LoadAnimation(const cgltf_data* data, const cgltf_animation* animation);
     Skeleton* LoadSkeleton(const cgltf_data* data, const cgltf_skin* skin);
     SkeletalMeshNode* LoadSkeletalMeshNode(const cgltf_data* data, const cgltf_node* node);
     SkeletalMeshData* LoadSkeletalMesh(const cgltf_primitive* primitive, const eastl::string& name);
 
+    void PrefetchTextures(const cgltf_data* data);
     MeshMaterial* LoadMaterial(const cgltf_material* gltf_material);
-    Texture2D* LoadTexture(const cgltf_texture_view& texture_view, bool srgb);
+    Texture2D* LoadTexture(const cgltf_texture_view& texture_view, TextureUsage usage);
 
 private:
     World* m_pWorld = nullptr;
@@ -55,4 +56,7 @@ private:
     float4x4 m_mtxWorld;
 
     eastl::string m_anisotropicTexture;
+
+    float m_animationTolerance = 0.001f; //max node error of the compressed animations in meters, 0 to keep the raw keyframes
+    AnimationStateMachineDesc m_animationStates;
 };
\ No newline at end of file
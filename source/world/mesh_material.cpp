@@ -2,9 +2,18 @@
 #include "resource_cache.h"
 #include "core/engine.h"
 #include "utils/gui_util.h"
+#include "EASTL/atomic.h"
+
+MeshMaterial::MeshMaterial()
+{
+    static eastl::atomic<uint32_t> s_nextID{ 0 };
+    m_nID = s_nextID++;
+}
 
 MeshMaterial::~MeshMaterial()
 {
+    Engine::GetInstance()->GetRenderer()->ReleaseSceneMaterial(m_nMaterialIndex);
+
     ResourceCache* cache = ResourceCache::GetInstance();
     cache->ReleaseTexture2D(m_pDiffuseTexture);
     cache->ReleaseTexture2D(m_pSpecularGlossinessTexture);
@@ -199,19 +208,6 @@ IGfxPipelineState* MeshMaterial::GetOutlinePSO()
     return m_pOutlinePSO;
 }
 
-IGfxPipelineState* MeshMaterial::GetVertexSkinningPSO()
-{
-    if (m_pVertexSkinningPSO == nullptr)
-    {
-        Renderer* pRenderer = Engine::GetInstance()->GetRenderer();
-
-        GfxComputePipelineDesc desc;
-        desc.cs = pRenderer->GetShader("vertex_skinning.hlsl", "main", GfxShaderType::CS);
-        m_pVertexSkinningPSO = pRenderer->GetPipelineState(desc, "vertex skinning PSO");
-    }
-    return m_pVertexSkinningPSO;
-}
-
 void MeshMaterial::UpdateConstants()
 {
     m_materialCB.shadingModel = (uint)m_shadingModel;
@@ -234,6 +230,16 @@ void MeshMaterial::UpdateConstants()
     m_materialCB.bRGNormalTexture = m_pNormalTexture && (m_pNormalTexture->GetTexture()->GetDesc().format == GfxFormat::BC5UNORM);
     m_materialCB.bRGClearCoatNormalTexture = m_pClearCoatNormalTexture && (m_pClearCoatNormalTexture->GetTexture()->GetDesc().format == GfxFormat::BC5UNORM);
     m_materialCB.bDoubleSided = m_bDoubleSided;
+
+    //the scene material is only re-uploaded when the constants changed
+    Renderer* pRenderer = Engine::GetInstance()->GetRenderer();
+    const ModelMaterialConstant* sceneMaterial = pRenderer->GetSceneMaterial(m_nMaterialIndex);
+    if (sceneMaterial == nullptr || memcmp(sceneMaterial, &m_materialCB, sizeof(ModelMaterialConstant)) != 0)
+    {
+        uint32_t index = pRenderer->AddSceneMaterial(m_materialCB);
+        pRenderer->ReleaseSceneMaterial(m_nMaterialIndex);
+        m_nMaterialIndex = index;
+    }
 }
 
 void MeshMaterial::OnGui()
@@ -9,8 +9,11 @@ class MeshMaterial
     friend class GLTFLoader;
     friend class World;
 public:
+    MeshMaterial();
     ~MeshMaterial();
 
+    uint32_t GetID() const { return m_nID; }
+
     IGfxPipelineState* GetPSO();
     IGfxPipelineState* GetShadowPSO();
     IGfxPipelineState* GetVelocityPSO();
@@ -19,10 +22,10 @@ public:
 
     IGfxPipelineState* GetMeshletPSO();
 
-    IGfxPipelineState* GetVertexSkinningPSO();
 
     void UpdateConstants();
     const ModelMaterialConstant* GetConstants() const { return &m_materialCB; }
+    uint32_t GetMaterialIndex() const { return m_nMaterialIndex; } //in the scene material buffer, valid after UpdateConstants
     void OnGui();
 
     bool IsFrontFaceCCW() const { return m_bFrontFaceCCW; }
@@ -34,8 +37,10 @@ private:
     void AddMaterialDefines(eastl::vector<eastl::string>& defines);
 
 private:
+    uint32_t m_nID = 0;
     eastl::string m_name;
     ModelMaterialConstant m_materialCB = {};
+    uint32_t m_nMaterialIndex = GFX_INVALID_RESOURCE;
 
     IGfxPipelineState* m_pPSO = nullptr;
     IGfxPipelineState* m_pShadowPSO = nullptr;
@@ -43,7 +48,6 @@ private:
     IGfxPipelineState* m_pIDPSO = nullptr;
     IGfxPipelineState* m_pOutlinePSO = nullptr;
     IGfxPipelineState* m_pMeshletPSO = nullptr;
-    IGfxPipelineState* m_pVertexSkinningPSO = nullptr;
 
     ShadingModel m_shadingModel = ShadingModel::Default;
 
@@ -1,6 +1,147 @@
 #include "resource_cache.h"
 #include "renderer/renderer.h"
+#include "renderer/texture_loader.h"
 #include "core/engine.h"
+#include "utils/gui_util.h"
+#include "xxHash/xxhash.h"
+
+template<typename T, typename Handle>
+typename ResourceCache::ResourceTable<T, Handle>::Slot* ResourceCache::ResourceTable<T, Handle>::Acquire(ResourceKey key, Handle& handle)
+{
+    auto iter = m_keyToSlot.find(key);
+    if (iter == m_keyToSlot.end())
+    {
+        return nullptr;
+    }
+
+    Slot* slot = &m_slots[iter->second];
+    slot->refCount++;
+    m_stats.references++;
+
+    handle.index = iter->second;
+    handle.generation = slot->generation;
+    return slot;
+}
+
+template<typename T, typename Handle>
+typename ResourceCache::ResourceTable<T, Handle>::Slot* ResourceCache::ResourceTable<T, Handle>::Get(Handle handle)
+{
+    if (handle.index >= m_slots.size())
+    {
+        return nullptr;
+    }
+
+    Slot* slot = &m_slots[handle.index];
+    if (slot->generation != handle.generation || slot->refCount == 0)
+    {
+        return nullptr;
+    }
+    return slot;
+}
+
+template<typename T, typename Handle>
+typename ResourceCache::ResourceTable<T, Handle>::Slot* ResourceCache::ResourceTable<T, Handle>::Find(uint64_t id)
+{
+    auto iter = m_idToSlot.find(id);
+    if (iter == m_idToSlot.end())
+    {
+        return nullptr;
+    }
+    return &m_slots[iter->second];
+}
+
+template<typename T, typename Handle>
+bool ResourceCache::ResourceTable<T, Handle>::Contains(ResourceKey key) const
+{
+    return m_keyToSlot.find(key) != m_keyToSlot.end();
+}
+
+template<typename T, typename Handle>
+Handle ResourceCache::ResourceTable<T, Handle>::Add(ResourceKey key, const T& resource, uint64_t id, uint32_t size)
+{
+    Handle handle = AddLoading(key);
+    SetResource(&m_slots[handle.index], resource, id, size);
+    return handle;
+}
+
+template<typename T, typename Handle>
+Handle ResourceCache::ResourceTable<T, Handle>::AddLoading(ResourceKey key)
+{
+    uint32_t index;
+    if (!m_freeSlots.empty())
+    {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)m_slots.size();
+        m_slots.emplace_back();
+    }
+
+    Slot& slot = m_slots[index];
+    slot.resource = {};
+    slot.key = key;
+    slot.id = 0;
+    slot.size = 0;
+    slot.refCount = 1;
+    slot.loading = true;
+
+    m_keyToSlot[key] = index;
+
+    m_stats.entries++;
+    m_stats.references++;
+
+    Handle handle;
+    handle.index = index;
+    handle.generation = slot.generation;
+    return handle;
+}
+
+template<typename T, typename Handle>
+void ResourceCache::ResourceTable<T, Handle>::SetResource(Slot* slot, const T& resource, uint64_t id, uint32_t size)
+{
+    RE_ASSERT(slot->loading);
+
+    slot->resource = resource;
+    slot->id = id;
+    slot->size = size;
+    slot->loading = false;
+
+    m_idToSlot[id] = (uint32_t)(slot - m_slots.data());
+    m_stats.bytes += size;
+}
+
+template<typename T, typename Handle>
+bool ResourceCache::ResourceTable<T, Handle>::Release(Slot* slot)
+{
+    RE_ASSERT(slot->refCount > 0);
+    m_stats.references--;
+
+    if (--slot->refCount > 0)
+    {
+        return false;
+    }
+
+    m_keyToSlot.erase(slot->key);
+    if (!slot->loading)
+    {
+        m_idToSlot.erase(slot->id);
+    }
+
+    m_stats.entries--;
+    m_stats.bytes -= slot->size;
+
+    slot->generation++;
+    m_freeSlots.push_back((uint32_t)(slot - m_slots.data()));
+    return true;
+}
+
+template<typename T, typename Handle>
+ResourceCacheStats ResourceCache::ResourceTable<T, Handle>::GetStats() const
+{
+    return m_stats;
+}
 
 ResourceCache* ResourceCache::GetInstance()
 {
@@ -8,23 +149,93 @@ ResourceCache* ResourceCache::GetInstance()
     return &cache;
 }
 
-Texture2D* ResourceCache::GetTexture2D(const eastl::string& file, bool srgb)
+ResourceKey ResourceCache::MakeKey(const eastl::string& name)
 {
-    auto iter = m_cachedTexture2D.find(file);
-    if (iter != m_cachedTexture2D.end())
+    return XXH3_64bits(name.data(), name.size());
+}
+
+ResourceKey ResourceCache::MakeKey(ResourceKey parent, const char* name)
+{
+    return XXH3_64bits_withSeed(name, strlen(name), parent);
+}
+
+Texture2DHandle ResourceCache::AcquireTexture2D(const eastl::string& file, bool srgb, bool streaming)
+{
+    ResourceKey key = MakeKey(file);
+
+    Texture2DHandle handle;
+
     {
-        iter->second.refCount++;
-        return (Texture2D*)iter->second.ptr;
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (m_texture2Ds.Acquire(key, handle))
+        {
+            //the slot is kept by our reference while it is loading
+            m_loadedCondition.wait(lock, [this, handle]() { return !m_texture2Ds.Get(handle)->loading; });
+
+            Texture2DTable::Slot* slot = m_texture2Ds.Get(handle);
+            if (slot->resource == nullptr)
+            {
+                //the file failed to load, it is tried again once the slot is released
+                ReleaseTexture2DSlot(slot);
+                return Texture2DHandle();
+            }
+            return handle;
+        }
+
+        handle = m_texture2Ds.AddLoading(key);
     }
 
     Renderer* pRenderer = Engine::GetInstance()->GetRenderer();
+    Texture2D* texture = nullptr;
+
+    eastl::unique_ptr<TextureLoader> loader = pRenderer->LoadTexture2D(file, srgb);
+    if (loader)
+    {
+        std::lock_guard<std::mutex> lock(m_uploadMutex);
+        texture = pRenderer->CreateTexture2D(*loader, file, srgb, streaming);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Texture2DTable::Slot* slot = m_texture2Ds.Get(handle);
+    m_texture2Ds.SetResource(slot, texture, GetResourceID(texture), texture ? texture->GetTexture()->GetRequiredStagingBufferSize() : 0);
+    m_loadedCondition.notify_all();
+
+    if (texture == nullptr)
+    {
+        ReleaseTexture2DSlot(slot);
+        return Texture2DHandle();
+    }
 
-    Resource texture;
-    texture.refCount = 1;
-    texture.ptr = pRenderer->CreateTexture2D(file, srgb);
-    m_cachedTexture2D.insert(eastl::make_pair(file, texture));
+    return handle;
+}
+
+Texture2D* ResourceCache::GetTexture2D(Texture2DHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-    return (Texture2D*)texture.ptr;
+    Texture2DTable::Slot* slot = const_cast<Texture2DTable&>(m_texture2Ds).Get(handle);
+    return slot ? slot->resource : nullptr;
+}
+
+void ResourceCache::ReleaseTexture2D(Texture2DHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Texture2DTable::Slot* slot = m_texture2Ds.Get(handle);
+    RE_ASSERT(slot != nullptr || !handle.IsValid());
+
+    if (slot)
+    {
+        ReleaseTexture2DSlot(slot);
+    }
+}
+
+Texture2D* ResourceCache::GetTexture2D(const eastl::string& file, bool srgb, bool streaming)
+{
+    Texture2DHandle handle = AcquireTexture2D(file, srgb, streaming);
+    return GetTexture2D(handle);
 }
 
 void ResourceCache::ReleaseTexture2D(Texture2D* texture)
@@ -34,42 +245,69 @@ void ResourceCache::ReleaseTexture2D(Texture2D* texture)
         return;
     }
 
-    for (auto iter = m_cachedTexture2D.begin(); iter != m_cachedTexture2D.end(); ++iter)
-    {
-        if (iter->second.ptr == texture)
-        {
-            iter->second.refCount--;
-            
-            if (iter->second.refCount == 0)
-            {
-                delete texture;
-                m_cachedTexture2D.erase(iter);
-            }
+    std::lock_guard<std::mutex> lock(m_mutex);
 
-            return;
-        }
+    Texture2DTable::Slot* slot = m_texture2Ds.Find(GetResourceID(texture));
+    RE_ASSERT(slot != nullptr);
+
+    if (slot)
+    {
+        ReleaseTexture2DSlot(slot);
     }
+}
 
-    RE_ASSERT(false);
+bool ResourceCache::IsTexture2DCached(const eastl::string& file) const
+{
+    ResourceKey key = MakeKey(file);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_texture2Ds.Contains(key);
 }
 
-OffsetAllocator::Allocation ResourceCache::GetSceneBuffer(const eastl::string& name, const void* data, uint32_t size)
+SceneBufferHandle ResourceCache::AcquireSceneBuffer(ResourceKey key, const void* data, uint32_t size)
 {
-    auto iter = m_cachedSceneBuffer.find(name);
-    if (iter != m_cachedSceneBuffer.end())
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SceneBufferHandle handle;
+    if (m_sceneBuffers.Acquire(key, handle))
     {
-        iter->second.refCount++;
-        return iter->second.allocation;
+        return handle;
     }
 
-    Renderer* pRenderer = Engine::GetInstance()->GetRenderer();
+    OffsetAllocator::Allocation allocation = Engine::GetInstance()->GetRenderer()->AllocateSceneStaticBuffer(data, size);
+    if (allocation.metadata == OffsetAllocator::Allocation::NO_SPACE)
+    {
+        return handle;
+    }
 
-    SceneBuffer buffer;
-    buffer.refCount = 1;
-    buffer.allocation = pRenderer->AllocateSceneStaticBuffer(data, size);
-    m_cachedSceneBuffer.insert(eastl::make_pair(name, buffer));
+    return m_sceneBuffers.Add(key, allocation, GetResourceID(allocation), size);
+}
 
-    return buffer.allocation;
+OffsetAllocator::Allocation ResourceCache::GetSceneBuffer(SceneBufferHandle handle) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SceneBufferTable::Slot* slot = const_cast<SceneBufferTable&>(m_sceneBuffers).Get(handle);
+    return slot ? slot->resource : OffsetAllocator::Allocation();
+}
+
+void ResourceCache::ReleaseSceneBuffer(SceneBufferHandle handle)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SceneBufferTable::Slot* slot = m_sceneBuffers.Get(handle);
+    RE_ASSERT(slot != nullptr || !handle.IsValid());
+
+    if (slot)
+    {
+        ReleaseSceneBufferSlot(slot);
+    }
+}
+
+OffsetAllocator::Allocation ResourceCache::GetSceneBuffer(ResourceKey key, const void* data, uint32_t size)
+{
+    SceneBufferHandle handle = AcquireSceneBuffer(key, data, size);
+    return GetSceneBuffer(handle);
 }
 
 void ResourceCache::RelaseSceneBuffer(OffsetAllocator::Allocation allocation)
@@ -79,22 +317,55 @@ void ResourceCache::RelaseSceneBuffer(OffsetAllocator::Allocation allocation)
         return;
     }
 
-    for (auto iter = m_cachedSceneBuffer.begin(); iter != m_cachedSceneBuffer.end(); ++iter)
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    SceneBufferTable::Slot* slot = m_sceneBuffers.Find(GetResourceID(allocation));
+    RE_ASSERT(slot != nullptr);
+
+    if (slot)
     {
-        if (iter->second.allocation.metadata == allocation.metadata &&
-            iter->second.allocation.offset == allocation.offset)
-        {
-            iter->second.refCount--;
+        ReleaseSceneBufferSlot(slot);
+    }
+}
 
-            if (iter->second.refCount == 0)
-            {
-                Engine::GetInstance()->GetRenderer()->FreeSceneStaticBuffer(allocation);
-                m_cachedSceneBuffer.erase(iter);
-            }
+void ResourceCache::ReleaseTexture2DSlot(Texture2DTable::Slot* slot)
+{
+    Texture2D* texture = slot->resource;
+    if (m_texture2Ds.Release(slot))
+    {
+        delete texture;
+    }
+}
 
-            return;
-        }
+void ResourceCache::ReleaseSceneBufferSlot(SceneBufferTable::Slot* slot)
+{
+    OffsetAllocator::Allocation allocation = slot->resource;
+    if (m_sceneBuffers.Release(slot))
+    {
+        Engine::GetInstance()->GetRenderer()->FreeSceneStaticBuffer(allocation);
     }
+}
+
+ResourceCacheStats ResourceCache::GetTexture2DStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_texture2Ds.GetStats();
+}
+
+ResourceCacheStats ResourceCache::GetSceneBufferStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sceneBuffers.GetStats();
+}
 
-    RE_ASSERT(false);
+void ResourceCache::OnGui()
+{
+    if (ImGui::CollapsingHeader("ResourceCache"))
+    {
+        ResourceCacheStats textures = GetTexture2DStats();
+        ResourceCacheStats buffers = GetSceneBufferStats();
+
+        ImGui::Text("Texture2D : %u entries, %u references, %.1f MB", textures.entries, textures.references, textures.bytes / (1024.0f * 1024.0f));
+        ImGui::Text("Scene buffers : %u entries, %u references, %.1f MB", buffers.entries, buffers.references, buffers.bytes / (1024.0f * 1024.0f));
+    }
 }
@@ -2,31 +2,117 @@
 
 #include "renderer/renderer.h"
 #include "EASTL/hash_map.h"
+#include <mutex>
+#include <condition_variable>
 
+//hash of a resource name, callers build it once instead of concatenating strings for every lookup
+typedef uint64_t ResourceKey;
+
+//generational handle, a stale handle of a released resource never aliases the one reusing its slot
+template<typename T>
+struct ResourceHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return index != UINT32_MAX; }
+};
+
+typedef ResourceHandle<Texture2D> Texture2DHandle;
+typedef ResourceHandle<OffsetAllocator::Allocation> SceneBufferHandle;
+
+struct ResourceCacheStats
+{
+    uint32_t entries = 0;
+    uint32_t references = 0;
+    uint64_t bytes = 0;
+};
+
+//refcounted cache of shared resources, every operation is O(1).
+//thread safe : a texture is loaded outside of the cache lock, in a slot which the other acquirers of its file wait for.
+//only its creation and upload are serialized, since the renderer upload queues are not thread safe
 class ResourceCache
 {
 public:
     static ResourceCache* GetInstance();
 
-    Texture2D* GetTexture2D(const eastl::string& file, bool srgb = true);
+    static ResourceKey MakeKey(const eastl::string& name);
+    static ResourceKey MakeKey(ResourceKey parent, const char* name); //e.g. one stream of a mesh
+
+    Texture2DHandle AcquireTexture2D(const eastl::string& file, bool srgb = true, bool streaming = false);
+    Texture2D* GetTexture2D(Texture2DHandle handle) const; //nullptr if the handle is stale
+    void ReleaseTexture2D(Texture2DHandle handle);
+
+    //pointer interface, released resources are found with a reverse lookup
+    Texture2D* GetTexture2D(const eastl::string& file, bool srgb = true, bool streaming = false);
     void ReleaseTexture2D(Texture2D* texture);
 
-    OffsetAllocator::Allocation GetSceneBuffer(const eastl::string& name, const void* data, uint32_t size);
+    bool IsTexture2DCached(const eastl::string& file) const; //without adding a reference
+
+    SceneBufferHandle AcquireSceneBuffer(ResourceKey key, const void* data, uint32_t size);
+    OffsetAllocator::Allocation GetSceneBuffer(SceneBufferHandle handle) const;
+    void ReleaseSceneBuffer(SceneBufferHandle handle);
+
+    OffsetAllocator::Allocation GetSceneBuffer(ResourceKey key, const void* data, uint32_t size);
     void RelaseSceneBuffer(OffsetAllocator::Allocation allocation);
 
+    ResourceCacheStats GetTexture2DStats() const;
+    ResourceCacheStats GetSceneBufferStats() const;
+
+    void OnGui();
+
 private:
-    struct Resource
+    template<typename T, typename Handle>
+    class ResourceTable
     {
-        void* ptr;
-        uint32_t refCount;
-    };
+    public:
+        struct Slot
+        {
+            T resource = {};
+            ResourceKey key = 0;
+            uint64_t id = 0; //for the reverse lookup
+            uint32_t size = 0;
+            uint32_t refCount = 0;
+            uint32_t generation = 0;
+            bool loading = false; //created outside of the cache lock, not in the reverse lookup yet
+        };
 
-    struct SceneBuffer
-    {
-        OffsetAllocator::Allocation allocation;
-        uint32_t refCount;
+        //returns the slot of the key with one more reference, or nullptr if it is not cached
+        Slot* Acquire(ResourceKey key, Handle& handle);
+        Slot* Get(Handle handle);
+        Slot* Find(uint64_t id);
+        bool Contains(ResourceKey key) const;
+
+        Handle Add(ResourceKey key, const T& resource, uint64_t id, uint32_t size);
+        Handle AddLoading(ResourceKey key); //the resource is set when it is loaded
+        void SetResource(Slot* slot, const T& resource, uint64_t id, uint32_t size);
+
+        //returns true if this was the last reference, the resource should be destroyed by the caller then
+        bool Release(Slot* slot);
+
+        ResourceCacheStats GetStats() const;
+
+    private:
+        eastl::vector<Slot> m_slots;
+        eastl::vector<uint32_t> m_freeSlots;
+        eastl::hash_map<ResourceKey, uint32_t> m_keyToSlot;
+        eastl::hash_map<uint64_t, uint32_t> m_idToSlot;
+        ResourceCacheStats m_stats;
     };
 
-    eastl::hash_map<eastl::string, Resource> m_cachedTexture2D;
-    eastl::hash_map<eastl::string, SceneBuffer> m_cachedSceneBuffer;
-};
\ No newline at end of file
+    static uint64_t GetResourceID(const Texture2D* texture) { return (uint64_t)texture; }
+    static uint64_t GetResourceID(const OffsetAllocator::Allocation& allocation) { return ((uint64_t)allocation.offset << 32) | allocation.metadata; }
+
+    typedef ResourceTable<Texture2D*, Texture2DHandle> Texture2DTable;
+    typedef ResourceTable<OffsetAllocator::Allocation, SceneBufferHandle> SceneBufferTable;
+
+    void ReleaseTexture2DSlot(Texture2DTable::Slot* slot);
+    void ReleaseSceneBufferSlot(SceneBufferTable::Slot* slot);
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_loadedCondition;
+    std::mutex m_uploadMutex;
+    Texture2DTable m_texture2Ds;
+    SceneBufferTable m_sceneBuffers;
+};
@@ -1,9 +1,10 @@
 #include "skeletal_mesh.h"
 #include "skeleton.h"
-#include "animation.h"
+#include "animation_system.h"
 #include "mesh_material.h"
 #include "resource_cache.h"
 #include "core/engine.h"
+#include "renderer/vertex_skinning.h"
 #include "utils/gui_util.h"
 
 SkeletalMeshData::~SkeletalMeshData()
@@ -26,6 +27,8 @@ SkeletalMeshData::~SkeletalMeshData()
     pRenderer->FreeSceneAnimationBuffer(animTangentBuffer);
 
     pRenderer->FreeSceneAnimationBuffer(prevAnimPosBuffer);
+
+    pRenderer->ReleaseRayTracingBLAS(blas);
 }
 
 SkeletalMesh::SkeletalMesh(const eastl::string& name)
@@ -33,8 +36,56 @@ SkeletalMesh::SkeletalMesh(const eastl::string& name)
     m_name = name;
 }
 
+SkeletalMesh::~SkeletalMesh()
+{
+    if (m_pAnimationSystem)
+    {
+        m_pAnimationSystem->RemoveMesh(this);
+    }
+}
+
 bool SkeletalMesh::Create()
 {
+    eastl::vector<int32_t> node_parents(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        node_parents[i] = (int32_t)m_nodes[i]->parent;
+    }
+    m_hierarchy.Build(node_parents);
+
+    uint32_t node_count = m_hierarchy.GetNodeCount();
+    m_pose.translations.resize(node_count);
+    m_pose.rotations.resize(node_count);
+    m_pose.scales.resize(node_count);
+    m_globalTransforms.resize(node_count);
+
+    for (uint32_t i = 0; i < node_count; ++i)
+    {
+        const SkeletalMeshNode* node = GetNode(m_hierarchy.indexToNode[i]);
+        m_pose.translations[i] = node->translation;
+        m_pose.rotations[i] = node->rotation;
+        m_pose.scales[i] = node->scale;
+    }
+
+    m_hierarchy.BuildReducedSet(m_pose, 0.05f);
+    m_nReducedNodeCount = m_hierarchy.GetReducedNodeCount();
+    m_samples[0] = m_pose;
+    m_samples[1] = m_pose;
+
+    eastl::vector<eastl::string> node_names(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); ++i)
+    {
+        node_names[i] = m_nodes[i]->name;
+    }
+    m_pAnimator->Bind(m_hierarchy, node_names, m_pose);
+    if (m_pSkeleton)
+    {
+        m_pSkeleton->Bind(m_hierarchy);
+    }
+
+    m_pAnimationSystem = Engine::GetInstance()->GetWorld()->GetAnimationSystem();
+    m_pAnimationSystem->AddMesh(this);
+
     for (size_t i = 0; i < m_nodes.size(); ++i)
     {
         for (size_t j = 0; j < m_nodes[i]->meshes.size(); ++j)
@@ -42,6 +93,7 @@ bool SkeletalMesh::Create()
             SkeletalMeshData* mesh = m_nodes[i]->meshes[j].get();
 
             Create(mesh);
+            m_nSkinnedMeshCount += mesh->material->IsVertexSkinned() ? 1 : 0;
         }
     }
 
@@ -97,9 +149,7 @@ void SkeletalMesh::Create(SkeletalMeshData* mesh)
         desc.flags = GfxRayTracingASFlagAllowCompaction | GfxRayTracingASFlagPreferFastTrace;
     }
 
-    IGfxDevice* device = m_pRenderer->GetDevice();
-    mesh->blas.reset(device->CreateRayTracingBLAS(desc, "BLAS : " + m_name));
-    m_pRenderer->BuildRayTracingBLAS(mesh->blas.get());
+    mesh->blas = m_pRenderer->CreateRayTracingBLAS(desc, "BLAS : " + m_name);
 }
 
 void SkeletalMesh::Tick(float delta_time)
@@ -109,21 +159,96 @@ void SkeletalMesh::Tick(float delta_time)
     float4x4 S = scaling_matrix(m_scale);
     m_mtxWorld = mul(T, mul(R, S));
 
-    m_pAnimation->Update(this, delta_time); //update node local transform
+    TransformAABB(m_mtxWorld, m_localBoundsMin, m_localBoundsMax, m_worldBoundsMin, m_worldBoundsMax);
+
+    //the pose was evaluated by AnimationSystem before the objects tick, or kept from an earlier frame.
+    //the animated position buffers are only swapped and skinned again when it changed, culled or not : the BLAS are refit from them.
+    //the previous positions are then the last skinning
+    //when AnimationSystem uploaded the previous joint matrices, VertexSkinning writes the previous positions from them
+    m_bSkinPrevPosition = m_pSkeleton && m_pSkeleton->GetPrevJointMatricesAddress() != Skeleton::INVALID_ADDRESS;
+    m_bPrevPositionValid = m_bPoseUpdated && (m_bSkinPrevPosition || m_bSkinned);
 
     for (size_t i = 0; i < m_rootNodes.size(); ++i)
     {
-        UpdateNodeTransform(GetNode(m_rootNodes[i])); //update node global transform
+        UpdateMeshConstants(GetNode(m_rootNodes[i]));
+    }
+
+    m_bSkinned |= m_bPoseUpdated;
+}
+
+void SkeletalMesh::UpdatePose(float delta_time, bool sample, float interpolation, bool reduced, float4x4* joint_matrices)
+{
+    if (sample)
+    {
+        eastl::swap(m_samples[0], m_samples[1]);
+        m_pAnimator->Update(delta_time, m_samples[1], reduced);
     }
 
+    const AnimationPose* pose = &m_samples[1];
+    if (interpolation < 1.0f)
+    {
+        m_pose = m_samples[0];
+        OverridePose(m_pose, m_samples[1], interpolation);
+        pose = &m_pose;
+    }
+
+    m_hierarchy.ComputeGlobalTransforms(*pose, m_globalTransforms.data());
+
     if (m_pSkeleton)
     {
-        m_pSkeleton->Update(this);
+        m_pSkeleton->ComputeJointMatrices(m_globalTransforms.data(), joint_matrices);
     }
 
-    for (size_t i = 0; i < m_rootNodes.size(); ++i)
+    UpdateBounds(joint_matrices);
+}
+
+void SkeletalMesh::UpdateBounds(const float4x4* joint_matrices)
+{
+    m_localBoundsMin = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+    m_localBoundsMax = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+    for (size_t i = 0; i < m_nodes.size(); ++i)
     {
-        UpdateMeshConstants(GetNode(m_rootNodes[i]));
+        for (size_t j = 0; j < m_nodes[i]->meshes.size(); ++j)
+        {
+            SkeletalMeshData* mesh = m_nodes[i]->meshes[j].get();
+
+            if (mesh->material->IsVertexSkinned() && !mesh->jointBoundsMin.empty())
+            {
+                uint32_t joint_count = eastl::min((uint32_t)mesh->jointBoundsMin.size(), GetJointCount());
+
+                mesh->boundsMin = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+                mesh->boundsMax = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+                ComputeSkinnedBounds(mesh->jointBoundsMin.data(), mesh->jointBoundsMax.data(), joint_matrices, joint_count, mesh->boundsMin, mesh->boundsMax);
+            }
+            else
+            {
+                //rigid meshes follow their node
+                float3 extent = float3(mesh->radius, mesh->radius, mesh->radius);
+                TransformAABB(GetNodeGlobalTransform(mesh->nodeID), mesh->center - extent, mesh->center + extent, mesh->boundsMin, mesh->boundsMax);
+            }
+
+            m_localBoundsMin = min(m_localBoundsMin, mesh->boundsMin);
+            m_localBoundsMax = max(m_localBoundsMax, mesh->boundsMax);
+        }
+    }
+
+    if (m_localBoundsMin.x > m_localBoundsMax.x)
+    {
+        m_localBoundsMin = m_localBoundsMax = float3(0.0f, 0.0f, 0.0f);
+    }
+}
+
+uint32_t SkeletalMesh::GetJointCount() const
+{
+    return m_pSkeleton ? m_pSkeleton->GetJointCount() : 0;
+}
+
+void SkeletalMesh::SetJointMatricesAddress(uint32_t address, uint32_t prev_address)
+{
+    if (m_pSkeleton)
+    {
+        m_pSkeleton->SetJointMatricesAddress(address, prev_address);
     }
 }
 
@@ -141,7 +266,7 @@ void SkeletalMesh::Render(Renderer* pRenderer)
 
 bool SkeletalMesh::FrustumCull(const float4* planes, uint32_t plane_count) const
 {
-    return ::FrustumCull(planes, plane_count, m_pos, m_radius); //todo : not correct
+    return ::FrustumCull(planes, plane_count, m_worldBoundsMin, m_worldBoundsMax);
 }
 
 SkeletalMeshNode* SkeletalMesh::GetNode(uint32_t node_id) const
@@ -150,31 +275,21 @@ SkeletalMeshNode* SkeletalMesh::GetNode(uint32_t node_id) const
     return m_nodes[node_id].get();
 }
 
-void SkeletalMesh::UpdateNodeTransform(SkeletalMeshNode* node)
-{
-    float4x4 T = translation_matrix(node->translation);
-    float4x4 R = rotation_matrix(node->rotation);
-    float4x4 S = scaling_matrix(node->scale);
-    node->globalTransform = mul(T, mul(R, S));
-
-    if (node->parent != -1)
-    {
-        node->globalTransform = mul(GetNode(node->parent)->globalTransform, node->globalTransform);
-    }
-
-    for (size_t i = 0; i < node->children.size(); ++i)
-    {
-        UpdateNodeTransform(GetNode(node->children[i]));
-    }
-}
-
 void SkeletalMesh::UpdateMeshConstants(SkeletalMeshNode* node)
 {
     for (size_t i = 0; i < node->meshes.size(); ++i)
     {
         SkeletalMeshData* mesh = node->meshes[i].get();
 
-        eastl::swap(mesh->prevAnimPosBuffer, mesh->animPosBuffer);
+        if (m_bPoseUpdated && !m_bSkinPrevPosition)
+        {
+            eastl::swap(mesh->prevAnimPosBuffer, mesh->animPosBuffer);
+        }
+
+        if (m_bPoseUpdated && mesh->material->IsVertexSkinned())
+        {
+            UpdateVertexSkinning(mesh);
+        }
 
         mesh->material->UpdateConstants();
 
@@ -200,28 +315,30 @@ void SkeletalMesh::UpdateMeshConstants(SkeletalMeshNode* node)
         }
 
         mesh->instanceData.bVertexAnimation = isSkinnedMesh;
-        mesh->instanceData.materialDataAddress = m_pRenderer->AllocateSceneConstant((void*)mesh->material->GetConstants(), sizeof(ModelMaterialConstant));
+        mesh->instanceData.materialIndex = mesh->material->GetMaterialIndex();
         mesh->instanceData.objectID = m_nID;
 
-        SkeletalMeshNode* node = GetNode(mesh->nodeID);
-        float4x4 mtxNodeWorld = mul(m_mtxWorld, node->globalTransform);
+        float4x4 mtxNodeWorld = mul(m_mtxWorld, GetNodeGlobalTransform(mesh->nodeID));
 
         mesh->instanceData.scale = max(max(abs(m_scale.x), abs(m_scale.y)), abs(m_scale.z)) * m_boundScaleFactor;
 
-        mesh->instanceData.center = mul(m_mtxWorld, float4(mesh->center, 1.0)).xyz(); //todo : not correct
-        mesh->instanceData.radius = mesh->radius * mesh->instanceData.scale;
-        m_radius = max(m_radius, mesh->instanceData.radius);
+        float3 bounds_min, bounds_max;
+        TransformAABB(m_mtxWorld, mesh->boundsMin, mesh->boundsMax, bounds_min, bounds_max);
+        mesh->instanceData.center = (bounds_min + bounds_max) * 0.5f;
+        mesh->instanceData.radius = length(bounds_max - bounds_min) * 0.5f;
 
         mesh->instanceData.mtxPrevWorld = mesh->instanceData.mtxWorld;
         mesh->instanceData.mtxWorld = isSkinnedMesh ? m_mtxWorld : mtxNodeWorld;
         mesh->instanceData.mtxWorldInverseTranspose = transpose(inverse(mesh->instanceData.mtxWorld));
 
         GfxRayTracingInstanceFlag flags = mesh->material->IsFrontFaceCCW() ? GfxRayTracingInstanceFlagFrontFaceCCW : 0;
-        mesh->instanceIndex = m_pRenderer->AddInstance(mesh->instanceData, mesh->blas.get(), flags);
+        uint32_t instance_mask = RT_INSTANCE_MASK_DYNAMIC | (mesh->material->IsAlphaTest() ? RT_INSTANCE_MASK_ALPHA_TEST : RT_INSTANCE_MASK_OPAQUE);
+        mesh->instanceIndex = m_pRenderer->AddInstance(mesh->instanceData, mesh->blas, instance_mask, flags);
 
         if (mesh->material->IsVertexSkinned())
         {
-            m_pRenderer->UpdateRayTracingBLAS(mesh->blas.get(), m_pRenderer->GetSceneAnimationBuffer(), mesh->animPosBuffer.offset);
+            m_pRenderer->UpdateRayTracingBLAS(mesh->blas, m_pRenderer->GetSceneAnimationBuffer(), mesh->animPosBuffer.offset,
+                mesh->instanceData.center, mesh->instanceData.radius, m_bPoseUpdated && !m_pAnimator->IsPaused());
         }
     }
 
@@ -238,12 +355,6 @@ void SkeletalMesh::Draw(const SkeletalMeshData* mesh)
         return; //todo
     }
 
-    if (mesh->material->IsVertexSkinned())
-    {
-        ComputeBatch& batch = m_pRenderer->AddAnimationBatch();
-        UpdateVertexSkinning(batch, mesh);
-    }
-
     RenderBatch& batch = m_pRenderer->AddBasePassBatch();
     Draw(batch, mesh, mesh->material->GetPSO());
 
@@ -266,38 +377,39 @@ void SkeletalMesh::Draw(const SkeletalMeshData* mesh)
     }
 }
 
-void SkeletalMesh::UpdateVertexSkinning(ComputeBatch& batch, const SkeletalMeshData* mesh)
+void SkeletalMesh::UpdateVertexSkinning(const SkeletalMeshData* mesh)
 {
-    batch.label = m_name.c_str();
-    batch.SetPipelineState(mesh->material->GetVertexSkinningPSO());
-
-    uint32_t cb[10] = {
-        mesh->vertexCount,
+    VertexSkinningJob job = {};
+    job.vertexCount = mesh->vertexCount;
+    job.jointIDBufferAddress = mesh->jointIDBuffer.offset;
+    job.jointWeightBufferAddress = mesh->jointWeightBuffer.offset;
 
-        mesh->staticPosBuffer.offset,
-        mesh->staticNormalBuffer.offset,
-        mesh->staticTangentBuffer.offset,
+    job.staticPosBufferAddress = mesh->staticPosBuffer.offset;
+    job.staticNormalBufferAddress = mesh->staticNormalBuffer.offset;
+    job.staticTangentBufferAddress = mesh->staticTangentBuffer.offset;
+    job.jointMatrixBufferAddress = m_pSkeleton->GetJointMatricesAddress();
 
-        mesh->animPosBuffer.offset,
-        mesh->animNormalBuffer.offset,
-        mesh->animTangentBuffer.offset,
+    job.animPosBufferAddress = mesh->animPosBuffer.offset;
+    job.animNormalBufferAddress = mesh->animNormalBuffer.offset;
+    job.animTangentBufferAddress = mesh->animTangentBuffer.offset;
 
-        mesh->jointIDBuffer.offset,
-        mesh->jointWeightBuffer.offset,
-        m_pSkeleton->GetJointMatricesAddress(),
-    };
+    job.prevJointMatrixBufferAddress = m_pSkeleton->GetPrevJointMatricesAddress();
+    job.prevAnimPosBufferAddress = mesh->prevAnimPosBuffer.offset;
 
-    batch.SetConstantBuffer(1, cb, sizeof(cb));
-    batch.Dispatch((mesh->vertexCount + 63) / 64, 1, 1);
+    m_pRenderer->AddVertexSkinningJob(job);
 }
 
 void SkeletalMesh::Draw(RenderBatch& batch, const SkeletalMeshData* mesh, IGfxPipelineState* pso)
 {
-    uint32_t root_consts[2] = { mesh->instanceIndex, mesh->prevAnimPosBuffer.offset };
+    //without a valid previous skinning, the velocity only comes from the world matrices
+    uint32_t prev_position = m_bPrevPositionValid ? mesh->prevAnimPosBuffer.offset : mesh->animPosBuffer.offset;
+    uint32_t root_consts[2] = { mesh->instanceIndex, prev_position };
 
     batch.label = m_name.c_str();
     batch.SetPipelineState(pso);
     batch.SetConstantBuffer(0, root_consts, sizeof(root_consts));
+    batch.center = mesh->instanceData.center;
+    batch.materialID = mesh->material->GetID();
 
     batch.SetIndexBuffer(m_pRenderer->GetSceneStaticBuffer(), mesh->indexBuffer.offset, mesh->indexBufferFormat);
     batch.DrawIndexed(mesh->indexCount);
@@ -307,5 +419,5 @@ void SkeletalMesh::OnGui()
 {
     IVisibleObject::OnGui();
 
-    //todo
+    m_pAnimator->OnGui();
 }
\ No newline at end of file
@@ -1,10 +1,11 @@
 #pragma once
 
 #include "visible_object.h"
+#include "animation_state_machine.h"
 
 class Skeleton;
-class Animation;
 class MeshMaterial;
+class AnimationSystem;
 
 struct SkeletalMeshData
 {
@@ -12,7 +13,7 @@ struct SkeletalMeshData
     uint32_t nodeID;
 
     eastl::unique_ptr<MeshMaterial> material;
-    eastl::unique_ptr<IGfxRayTracingBLAS> blas;
+    class RayTracingBLAS* blas = nullptr;
 
     OffsetAllocator::Allocation uvBuffer;
     OffsetAllocator::Allocation jointIDBuffer;
@@ -39,6 +40,12 @@ struct SkeletalMeshData
     float3 center;
     float radius = 0.0;
 
+    //bind space bounds of the vertices of each joint, and the bounds of the current pose in the mesh space
+    eastl::vector<float3> jointBoundsMin;
+    eastl::vector<float3> jointBoundsMax;
+    float3 boundsMin;
+    float3 boundsMax;
+
     ~SkeletalMeshData();
 };
 
@@ -50,12 +57,10 @@ struct SkeletalMeshNode
     eastl::vector<uint32_t> children;
     eastl::vector<eastl::unique_ptr<SkeletalMeshData>> meshes;
 
-    //local transform
+    //rest local transform
     float3 translation;
     float4 rotation;
     float3 scale;
-
-    float4x4 globalTransform;
 };
 
 class SkeletalMesh : public IVisibleObject
@@ -64,6 +69,7 @@ class SkeletalMesh : public IVisibleObject
 
 public:
     SkeletalMesh(const eastl::string& name);
+    ~SkeletalMesh();
 
     virtual bool Create() override;
     virtual void Tick(float delta_time) override;
@@ -72,15 +78,33 @@ public:
     virtual void OnGui() override;
 
     SkeletalMeshNode* GetNode(uint32_t node_id) const;
+    AnimationStateMachine* GetAnimator() const { return m_pAnimator.get(); }
+    const float4x4& GetNodeGlobalTransform(uint32_t node_id) const { return m_globalTransforms[m_hierarchy.nodeToIndex[node_id]]; }
+
+    //called by AnimationSystem from its worker threads, joint_matrices points to the mesh range of the frame palette.
+    //sample runs the state machine for delta_time, the pose is then interpolated from the previous sample to the new one by interpolation
+    void UpdatePose(float delta_time, bool sample, float interpolation, bool reduced, float4x4* joint_matrices);
+    uint32_t GetNodeCount() const { return m_hierarchy.GetNodeCount(); }
+    uint32_t GetReducedNodeCount() const { return m_nReducedNodeCount; }
+    uint32_t GetJointCount() const;
+    void SetJointMatricesAddress(uint32_t address, uint32_t prev_address);
+
+    //false if AnimationSystem did not update the pose this frame, then the skinning and the BLAS refit are skipped
+    void SetPoseUpdated(bool value) { m_bPoseUpdated = value; }
+    uint32_t GetSkinnedMeshCount() const { return m_nSkinnedMeshCount; }
+
+    //bounds of the last evaluated pose, in world space
+    const float3& GetBoundsMin() const { return m_worldBoundsMin; }
+    const float3& GetBoundsMax() const { return m_worldBoundsMax; }
 
 private:
     void Create(SkeletalMeshData* mesh);
 
-    void UpdateNodeTransform(SkeletalMeshNode* node);
     void UpdateMeshConstants(SkeletalMeshNode* node);
+    void UpdateBounds(const float4x4* joint_matrices);
 
     void Draw(const SkeletalMeshData* mesh);
-    void UpdateVertexSkinning(ComputeBatch& batch, const SkeletalMeshData* mesh);
+    void UpdateVertexSkinning(const SkeletalMeshData* mesh);
     void Draw(RenderBatch& batch, const SkeletalMeshData* mesh, IGfxPipelineState* pso);
 
 private:
@@ -90,11 +114,28 @@ private:
     float4x4 m_mtxWorld;
 
     eastl::unique_ptr<Skeleton> m_pSkeleton;
-    eastl::unique_ptr<Animation> m_pAnimation;
+    eastl::unique_ptr<AnimationStateMachine> m_pAnimator;
+    AnimationSystem* m_pAnimationSystem = nullptr;
 
     eastl::vector<eastl::unique_ptr<SkeletalMeshNode>> m_nodes;
     eastl::vector<uint32_t> m_rootNodes;
 
-    float m_radius = 0.0f;
+    AnimationHierarchy m_hierarchy;
+    AnimationPose m_samples[2]; //the previous and last samples of the state machine
+    AnimationPose m_pose;       //interpolated between the samples
+    eastl::vector<float4x4> m_globalTransforms; //in the hierarchy order
+    uint32_t m_nReducedNodeCount = 0;
+    uint32_t m_nSkinnedMeshCount = 0;
+
+    bool m_bPoseUpdated = false;
+    bool m_bSkinned = false;           //dispatched at least once
+    bool m_bPrevPositionValid = false; //the previous animated positions are those displayed last frame
+    bool m_bSkinPrevPosition = false;  //VertexSkinning writes the previous positions, the buffers are not swapped
+
+    float3 m_localBoundsMin = float3(0.0f, 0.0f, 0.0f);
+    float3 m_localBoundsMax = float3(0.0f, 0.0f, 0.0f);
+    float3 m_worldBoundsMin = float3(0.0f, 0.0f, 0.0f);
+    float3 m_worldBoundsMax = float3(0.0f, 0.0f, 0.0f);
+
     float m_boundScaleFactor = 3.0f;
 };
\ No newline at end of file
@@ -1,21 +1,67 @@
 #include "skeleton.h"
-#include "skeletal_mesh.h"
-#include "core/engine.h"
+#include "animation.h"
 
 Skeleton::Skeleton(const eastl::string& name)
 {
     m_name = name;
-    m_pRenderer = Engine::GetInstance()->GetRenderer();
 }
 
-void Skeleton::Update(const SkeletalMesh* mesh)
+void Skeleton::Bind(const AnimationHierarchy& hierarchy)
 {
+    m_jointIndices.resize(m_joints.size());
     for (size_t i = 0; i < m_joints.size(); ++i)
     {
-        const SkeletalMeshNode* node = mesh->GetNode(m_joints[i]);
+        m_jointIndices[i] = hierarchy.nodeToIndex[m_joints[i]];
+    }
+}
+
+void Skeleton::ComputeJointMatrices(const float4x4* global_transforms, float4x4* joint_matrices) const
+{
+    RE_ASSERT(m_jointIndices.size() == m_joints.size());
+
+    for (size_t i = 0; i < m_jointIndices.size(); ++i)
+    {
+        joint_matrices[i] = mul(global_transforms[m_jointIndices[i]], m_inverseBindMatrices[i]);
+    }
+}
 
-        m_jointMatrices[i] = mul(node->globalTransform, m_inverseBindMatrices[i]);
+void ComputeJointBounds(const float3* positions, const ushort4* joint_ids, const float4* joint_weights, uint32_t vertex_count,
+    uint32_t joint_count, float3* joint_min, float3* joint_max)
+{
+    for (uint32_t i = 0; i < joint_count; ++i)
+    {
+        joint_min[i] = float3(FLT_MAX, FLT_MAX, FLT_MAX);
+        joint_max[i] = float3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
     }
 
-    m_jointMatricesAddress = m_pRenderer->AllocateSceneConstant(m_jointMatrices.data(), sizeof(float4x4) * (uint32_t)m_jointMatrices.size());
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        for (uint32_t j = 0; j < 4; ++j)
+        {
+            uint32_t joint = joint_ids[v][j];
+            if (joint_weights[v][j] > 0.0f && joint < joint_count)
+            {
+                joint_min[joint] = min(joint_min[joint], positions[v]);
+                joint_max[joint] = max(joint_max[joint], positions[v]);
+            }
+        }
+    }
+}
+
+void ComputeSkinnedBounds(const float3* joint_min, const float3* joint_max, const float4x4* joint_matrices, uint32_t joint_count,
+    float3& min, float3& max)
+{
+    for (uint32_t i = 0; i < joint_count; ++i)
+    {
+        if (joint_min[i].x > joint_max[i].x)
+        {
+            continue;
+        }
+
+        float3 transformed_min, transformed_max;
+        TransformAABB(joint_matrices[i], joint_min[i], joint_max[i], transformed_min, transformed_max);
+
+        min = linalg::min(min, transformed_min);
+        max = linalg::max(max, transformed_max);
+    }
 }
@@ -4,26 +4,45 @@
 #include "EASTL/string.h"
 #include "EASTL/vector.h"
 
-class SkeletalMesh;
-class Renderer;
+struct AnimationHierarchy;
 
 class Skeleton
 {
     friend class GLTFLoader;
+    friend bool TestSkeletonEvaluation();
 
 public:
+    static const uint32_t INVALID_ADDRESS = 0xFFFFFFFF;
+
     Skeleton(const eastl::string& name);
 
-    void Update(const SkeletalMesh* mesh);
+    //maps the joint nodes to the hierarchy order
+    void Bind(const AnimationHierarchy& hierarchy);
+
+    uint32_t GetJointCount() const { return (uint32_t)m_joints.size(); }
+    void ComputeJointMatrices(const float4x4* global_transforms, float4x4* joint_matrices) const;
 
+    //the joint matrices of all meshes are uploaded together by AnimationSystem,
+    //the previous ones only if VertexSkinning skins the previous positions (INVALID_ADDRESS otherwise)
+    void SetJointMatricesAddress(uint32_t address, uint32_t prev_address) { m_jointMatricesAddress = address; m_prevJointMatricesAddress = prev_address; }
     uint32_t GetJointMatricesAddress() const { return m_jointMatricesAddress; }
+    uint32_t GetPrevJointMatricesAddress() const { return m_prevJointMatricesAddress; }
 
 private:
-    Renderer* m_pRenderer;
     eastl::string m_name;
-    eastl::vector<uint32_t> m_joints;
+    eastl::vector<uint32_t> m_joints; //node ids
+    eastl::vector<uint32_t> m_jointIndices; //in the hierarchy order
     eastl::vector<float4x4> m_inverseBindMatrices;
 
-    eastl::vector<float4x4> m_jointMatrices;
-    uint32_t m_jointMatricesAddress;
-};
\ No newline at end of file
+    uint32_t m_jointMatricesAddress = 0;
+    uint32_t m_prevJointMatricesAddress = INVALID_ADDRESS;
+};
+
+//bind space bounds of the vertices influenced by each joint, joints without any vertex get min > max
+void ComputeJointBounds(const float3* positions, const ushort4* joint_ids, const float4* joint_weights, uint32_t vertex_count,
+    uint32_t joint_count, float3* joint_min, float3* joint_max);
+
+//a skinned vertex is a weighted average of its position transformed by each of its joints,
+//so it stays inside the union of the joint bounds transformed by the joint matrices. min and max are grown to include it
+void ComputeSkinnedBounds(const float3* joint_min, const float3* joint_max, const float4x4* joint_matrices, uint32_t joint_count,
+    float3& min, float3& max);
@@ -2,6 +2,7 @@
 #include "mesh_material.h"
 #include "resource_cache.h"
 #include "core/engine.h"
+#include "renderer/ray_tracing_blas_builder.h"
 #include "utils/gui_util.h"
 
 StaticMesh::StaticMesh(const eastl::string& name)
@@ -24,6 +25,8 @@ StaticMesh::~StaticMesh()
 
     cache->RelaseSceneBuffer(m_indexBuffer);
 
+    m_pRenderer->ReleaseRayTracingBLAS(m_pBLAS);
+
     if (m_pRigidBody)
     {
         m_pRigidBody->RemoveFromPhysicsSystem();
@@ -34,25 +37,18 @@ bool StaticMesh::Create()
 {
     //todo : need to cache blas for same models
 
-    GfxRayTracingGeometry geometry;
-    geometry.vertex_buffer = m_pRenderer->GetSceneStaticBuffer();
-    geometry.vertex_buffer_offset = m_posBuffer.offset;
-    geometry.vertex_count = m_nVertexCount;
-    geometry.vertex_stride = sizeof(float3);
-    geometry.vertex_format = GfxFormat::RGB32F;
-    geometry.index_buffer = m_pRenderer->GetSceneStaticBuffer();
-    geometry.index_buffer_offset = m_indexBuffer.offset;
-    geometry.index_count = m_nIndexCount;
-    geometry.index_format = m_indexBufferFormat;
-    geometry.opaque = m_pMaterial->IsAlphaTest() ? false : true; //todo : alpha blend
-
-    GfxRayTracingBLASDesc desc;
-    desc.geometries.push_back(geometry);
-    desc.flags = GfxRayTracingASFlagAllowCompaction | GfxRayTracingASFlagPreferFastTrace;
+    if (m_pBLASOwner == nullptr && !m_pMaterial->IsAlphaBlend())
+    {
+        GfxRayTracingBLASDesc desc;
+        desc.geometries.push_back(GetRayTracingGeometry());
+        for (size_t i = 0; i < m_blasMembers.size(); ++i)
+        {
+            desc.geometries.push_back(m_blasMembers[i]->GetRayTracingGeometry());
+        }
+        desc.flags = GfxRayTracingASFlagAllowCompaction | GfxRayTracingASFlagPreferFastTrace;
 
-    IGfxDevice* device = m_pRenderer->GetDevice();
-    m_pBLAS.reset(device->CreateRayTracingBLAS(desc, "BLAS : " + m_name));
-    m_pRenderer->BuildRayTracingBLAS(m_pBLAS.get());
+        m_pBLAS = m_pRenderer->CreateRayTracingBLAS(desc, "BLAS : " + m_name);
+    }
 
     if (m_pShape)
     {
@@ -71,16 +67,36 @@ void StaticMesh::Tick(float delta_time)
         return; //todo
     }
 
-    if (m_pRigidBody && m_pRigidBody->GetMotionType() == PhysicsMotion::Dynamic)
+    if (m_pBLASOwner)
     {
-        m_pos = m_pRigidBody->GetPosition();
-        m_rotation = m_pRigidBody->GetRotation();
+        return; //added by the owner of the blas
     }
 
     UpdateConstants();
 
+    bool alpha_test = m_pMaterial->IsAlphaTest();
+    for (size_t i = 0; i < m_blasMembers.size(); ++i)
+    {
+        alpha_test |= m_blasMembers[i]->m_pMaterial->IsAlphaTest();
+    }
+
+    uint32_t instance_mask = alpha_test ? RT_INSTANCE_MASK_ALPHA_TEST : RT_INSTANCE_MASK_OPAQUE;
+    if (m_pRigidBody && m_pRigidBody->GetMotionType() == PhysicsMotion::Dynamic)
+    {
+        instance_mask |= RT_INSTANCE_MASK_DYNAMIC;
+    }
+
     GfxRayTracingInstanceFlag flags = m_pMaterial->IsFrontFaceCCW() ? GfxRayTracingInstanceFlagFrontFaceCCW : 0;
-    m_nInstanceIndex = m_pRenderer->AddInstance(m_instanceData, m_pBLAS.get(), flags);
+    m_nInstanceIndex = m_pRenderer->AddInstance(m_instanceData, m_pBLAS, instance_mask, flags);
+
+    //the shaders find the instance data of a geometry at instance id + geometry index, so the members follow the owner.
+    //the tlas instance uses the owner's transform for all geometries, the primitives of a node are not expected to move apart
+    for (size_t i = 0; i < m_blasMembers.size(); ++i)
+    {
+        StaticMesh* member = m_blasMembers[i];
+        member->UpdateConstants();
+        member->m_nInstanceIndex = m_pRenderer->AddInstance(member->m_instanceData, nullptr, 0, 0);
+    }
 }
 
 void StaticMesh::SetPhysicsBody(IPhysicsRigidBody* body)
@@ -94,8 +110,30 @@ void StaticMesh::SetPhysicsBody(IPhysicsRigidBody* body)
     }
 }
 
+GfxRayTracingGeometry StaticMesh::GetRayTracingGeometry() const
+{
+    GfxRayTracingGeometry geometry;
+    geometry.vertex_buffer = m_pRenderer->GetSceneStaticBuffer();
+    geometry.vertex_buffer_offset = m_posBuffer.offset;
+    geometry.vertex_count = m_nVertexCount;
+    geometry.vertex_stride = sizeof(float3);
+    geometry.vertex_format = GfxFormat::RGB32F;
+    geometry.index_buffer = m_pRenderer->GetSceneStaticBuffer();
+    geometry.index_buffer_offset = m_indexBuffer.offset;
+    geometry.index_count = m_nIndexCount;
+    geometry.index_format = m_indexBufferFormat;
+    geometry.opaque = m_pMaterial->IsAlphaTest() ? false : true;
+    return geometry;
+}
+
 void StaticMesh::UpdateConstants()
 {
+    if (m_pRigidBody && m_pRigidBody->GetMotionType() == PhysicsMotion::Dynamic)
+    {
+        m_pos = m_pRigidBody->GetPosition();
+        m_rotation = m_pRigidBody->GetRotation();
+    }
+
     m_pMaterial->UpdateConstants();
 
     m_instanceData.instanceType = (uint)InstanceType::Model;
@@ -114,7 +152,7 @@ void StaticMesh::UpdateConstants()
     m_instanceData.tangentBufferAddress = m_tangentBuffer.offset;
 
     m_instanceData.bVertexAnimation = false;
-    m_instanceData.materialDataAddress = m_pRenderer->AllocateSceneConstant((void*)m_pMaterial->GetConstants(), sizeof(ModelMaterialConstant));
+    m_instanceData.materialIndex = m_pMaterial->GetMaterialIndex();
     m_instanceData.objectID = m_nID;
     m_instanceData.scale = max(max(abs(m_scale.x), abs(m_scale.y)), abs(m_scale.z));
 
@@ -181,6 +219,8 @@ void StaticMesh::Draw(RenderBatch& batch, IGfxPipelineState* pso)
     batch.label = m_name.c_str();
     batch.SetPipelineState(pso);
     batch.SetConstantBuffer(0, root_consts, sizeof(root_consts));
+    batch.center = m_instanceData.center;
+    batch.materialID = m_pMaterial->GetID();
 
     batch.SetIndexBuffer(m_pRenderer->GetSceneStaticBuffer(), m_indexBuffer.offset, m_indexBufferFormat);
     batch.DrawIndexed(m_nIndexCount);
@@ -190,6 +230,7 @@ void StaticMesh::Dispatch(RenderBatch& batch, IGfxPipelineState* pso)
 {
     batch.label = m_name.c_str();
     batch.SetPipelineState(pso);
+    batch.materialID = m_pMaterial->GetID();
     batch.center = m_instanceData.center;
     batch.radius = m_instanceData.radius;
     batch.meshletCount = m_nMeshletCount;
@@ -32,6 +32,7 @@ public:
 
 private:
     void UpdateConstants();
+    GfxRayTracingGeometry GetRayTracingGeometry() const;
     void Draw(RenderBatch& batch, IGfxPipelineState* pso);
     void Dispatch(RenderBatch& batch, IGfxPipelineState* pso);
 
@@ -39,7 +40,9 @@ private:
     Renderer* m_pRenderer = nullptr;
     eastl::string m_name;
     eastl::unique_ptr<MeshMaterial> m_pMaterial = nullptr;
-    eastl::unique_ptr<IGfxRayTracingBLAS> m_pBLAS;
+    class RayTracingBLAS* m_pBLAS = nullptr;
+    eastl::vector<StaticMesh*> m_blasMembers; //the other primitives of the node, they are geometries of m_pBLAS
+    StaticMesh* m_pBLASOwner = nullptr;
     eastl::unique_ptr<IPhysicsRigidBody> m_pRigidBody;
     eastl::unique_ptr<IPhysicsShape> m_pShape;
 
@@ -8,6 +8,7 @@
 #include "static_mesh.h"
 #include "mesh_material.h"
 #include "billboard_sprite.h"
+#include "animation_system.h"
 #include "utils/assert.h"
 #include "utils/string.h"
 #include "utils/profiler.h"
@@ -26,6 +27,7 @@ World::World()
     m_pPhysicsSystem->Initialize();
 
     m_pBillboardSpriteRenderer = eastl::make_unique<BillboardSpriteRenderer>(pRenderer);
+    m_pAnimationSystem = eastl::make_unique<AnimationSystem>(pRenderer);
     m_boxShape.reset(m_pPhysicsSystem->CreateBoxShape(float3(1.0f, 1.0f, 1.0f)));
     m_sphereShape.reset(m_pPhysicsSystem->CreateSphereShape(1.0f));
 }
@@ -77,6 +79,7 @@ void World::Tick(float delta_time)
 
     m_pPhysicsSystem->Tick(delta_time);
     m_pCamera->Tick(delta_time);
+    m_pAnimationSystem->Update(delta_time, m_pCamera.get());
 
     for (auto iter = m_objects.begin(); iter != m_objects.end(); ++iter)
     {
@@ -85,24 +88,32 @@ void World::Tick(float delta_time)
 
     if (pRenderer->GetOutputType() != RendererOutput::Physics)
     {
-        eastl::vector<IVisibleObject*> visibleObjects(m_objects.size());
-        eastl::atomic<uint32_t> visibleCount{ 0 };
+        eastl::vector<uint8_t> visible(m_objects.size());
 
         ParallelFor((uint32_t)m_objects.size(), [&](uint32_t i)
             {
-                if (m_objects[i]->FrustumCull(m_pCamera->GetFrustumPlanes(), 6))
-                {
-                    uint32_t index = visibleCount.fetch_add(1);
-                    visibleObjects[index] = m_objects[i].get();
-                }
+                visible[i] = m_objects[i]->FrustumCull(m_pCamera->GetFrustumPlanes(), 6);
             });
 
-        visibleObjects.resize(visibleCount);
+        //compacted in the object order, so the batch order does not depend on the scheduling
+        eastl::vector<IVisibleObject*> visibleObjects;
+        visibleObjects.reserve(m_objects.size());
 
-        for (auto iter = visibleObjects.begin(); iter != visibleObjects.end(); ++iter)
+        for (size_t i = 0; i < m_objects.size(); ++i)
         {
-            (*iter)->Render(pRenderer);
+            if (visible[i])
+            {
+                visibleObjects.push_back(m_objects[i].get());
+            }
         }
+
+        ParallelFor((uint32_t)visibleObjects.size(), [&](uint32_t i)
+            {
+                pRenderer->SetBatchOrder(i + 1);
+                visibleObjects[i]->Render(pRenderer);
+            });
+
+        pRenderer->SetBatchOrder(UINT32_MAX);
     }
 
     m_pBillboardSpriteRenderer->Render();
@@ -306,42 +317,51 @@ void World::PhysicsTest(Renderer* pRenderer)
         !io.NavActive && 
         (ImGui::IsKeyReleased(ImGuiKey_Space) || ImGui::IsKeyReleased(ImGuiKey_GamepadFaceDown)))
     {
-        IPhysicsRigidBody* body = nullptr;
-        GLTFLoader loader(this);
+        SpawnRigidBody(pRenderer->GetFrameID() % 2 == 1,
+            m_pCamera->GetPosition() + m_pCamera->GetForward() * 1.0f,
+            m_pCamera->GetForward() * 10.0f);
+    }
+}
 
-        if (pRenderer->GetFrameID() % 2 == 1)
-        {
-            loader.Load("model/box.gltf");
-            body = m_pPhysicsSystem->CreateRigidBody(m_boxShape.get(), PhysicsMotion::Dynamic, PhysicsLayers::DYNAMIC, m_objects.back().get());
-        }
-        else
-        {
-            loader.Load("model/sphere.gltf");
-            body = m_pPhysicsSystem->CreateRigidBody(m_sphereShape.get(), PhysicsMotion::Dynamic, PhysicsLayers::DYNAMIC, m_objects.back().get());
-        }
+StaticMesh* World::SpawnRigidBody(bool box, const float3& position, const float3& velocity)
+{
+    IPhysicsRigidBody* body = nullptr;
+    GLTFLoader loader(this);
 
-        body->AddToPhysicsSystem(true);
-        body->SetLinearVelocity(m_pCamera->GetForward() * 10.0f);
+    if (box)
+    {
+        loader.Load("model/box.gltf");
+        body = m_pPhysicsSystem->CreateRigidBody(m_boxShape.get(), PhysicsMotion::Dynamic, PhysicsLayers::DYNAMIC, m_objects.back().get());
+    }
+    else
+    {
+        loader.Load("model/sphere.gltf");
+        body = m_pPhysicsSystem->CreateRigidBody(m_sphereShape.get(), PhysicsMotion::Dynamic, PhysicsLayers::DYNAMIC, m_objects.back().get());
+    }
 
-        StaticMesh* mesh = (StaticMesh*)m_objects.back().get();
-        mesh->SetPhysicsBody(body);
-        mesh->SetScale(float3(0.3));
-        mesh->SetPosition(m_pCamera->GetPosition() + m_pCamera->GetForward() * 1.0f);
+    body->AddToPhysicsSystem(true);
+    body->SetLinearVelocity(velocity);
 
-        auto WangHash = [](uint x)
-        {
-            x = (x ^ 61) ^ (x >> 16);
-            x *= 9;
-            x = x ^ (x >> 4);
-            x *= 0x27d4eb2d;
-            x = x ^ (x >> 15);
-            return x;
-        };
-        uint hash = WangHash((uint)m_objects.size());
-
-        MeshMaterial* material = mesh->GetMaterial();
-        material->m_bPbrMetallicRoughness = true;
-        material->m_albedoColor = float3(float(hash & 255), float((hash >> 8) & 255), float((hash >> 16) & 255)) / 255.0f;
-        material->m_roughness = float(hash >> 24) / 255.0f;
-    }
+    StaticMesh* mesh = (StaticMesh*)m_objects.back().get();
+    mesh->SetPhysicsBody(body);
+    mesh->SetScale(float3(0.3));
+    mesh->SetPosition(position);
+
+    auto WangHash = [](uint x)
+    {
+        x = (x ^ 61) ^ (x >> 16);
+        x *= 9;
+        x = x ^ (x >> 4);
+        x *= 0x27d4eb2d;
+        x = x ^ (x >> 15);
+        return x;
+    };
+    uint hash = WangHash((uint)m_objects.size());
+
+    MeshMaterial* material = mesh->GetMaterial();
+    material->m_bPbrMetallicRoughness = true;
+    material->m_albedoColor = float3(float(hash & 255), float((hash >> 8) & 255), float((hash >> 16) & 255)) / 255.0f;
+    material->m_roughness = float(hash >> 24) / 255.0f;
+
+    return mesh;
 }
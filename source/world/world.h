@@ -17,12 +17,14 @@ public:
 
     Camera* GetCamera() const { return m_pCamera.get(); }
     IPhysicsSystem* GetPhysicsSystem() const { return m_pPhysicsSystem.get(); }
+    class AnimationSystem* GetAnimationSystem() const { return m_pAnimationSystem.get(); }
     class BillboardSpriteRenderer* GetBillboardSpriteRenderer() const { return m_pBillboardSpriteRenderer.get(); }
 
     void LoadScene(const eastl::string& file);
     void SaveScene(const eastl::string& file);
 
     void AddObject(IVisibleObject* object);
+    class StaticMesh* SpawnRigidBody(bool box, const float3& position, const float3& velocity);
 
     void Tick(float delta_time);
 
@@ -44,6 +46,7 @@ private:
     eastl::unique_ptr<Camera> m_pCamera;
     eastl::unique_ptr<IPhysicsSystem> m_pPhysicsSystem;
     eastl::unique_ptr<class BillboardSpriteRenderer> m_pBillboardSpriteRenderer;
+    eastl::unique_ptr<class AnimationSystem> m_pAnimationSystem; //before m_objects, the skeletal meshes remove themselves from it
 
     eastl::vector<eastl::unique_ptr<IVisibleObject>> m_objects;
 